@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+#
+# Copyright 2011-2017 Blender Foundation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# <pep8 compliant>
+
+"""
+Render the bundled benchmark scenes with the standalone Cycles binary and
+collect the per scene statistics into a single JSON file.
+
+    ./run_benchmark.py --cycles /path/to/cycles --output results.json
+
+Every scene is rendered with a fixed seed and sample count, so results of
+different builds can be compared directly.
+"""
+
+import argparse
+import glob
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def render_scene(args, scene):
+    fd, stats_path = tempfile.mkstemp(suffix=".json")
+    os.close(fd)
+
+    command = [args.cycles,
+               "--background",
+               "--quiet",
+               "--device", args.device,
+               "--samples", str(args.samples),
+               "--seed", str(args.seed),
+               "--threads", str(args.threads),
+               "--stats-output", stats_path,
+               scene]
+
+    try:
+        runs = []
+        for i in range(args.repeat):
+            subprocess.check_call(command)
+            with open(stats_path) as f:
+                runs.append(json.load(f))
+    finally:
+        os.remove(stats_path)
+
+    # Report the fastest run, it is the least affected by other system load.
+    return min(runs, key=lambda stats: stats["time"]["render"])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run the Cycles benchmark scenes.")
+    parser.add_argument("--cycles", required=True, help="Path to the standalone Cycles binary")
+    parser.add_argument("--output", default="", help="File to write the combined JSON results to")
+    parser.add_argument("--device", default="CPU", help="Device to render with")
+    parser.add_argument("--samples", type=int, default=64, help="Number of samples per scene")
+    parser.add_argument("--seed", type=int, default=0, help="Integrator seed")
+    parser.add_argument("--threads", type=int, default=0, help="Number of render threads, 0 for automatic")
+    parser.add_argument("--repeat", type=int, default=1, help="Number of renders per scene")
+    parser.add_argument("scenes", nargs="*", help="Scenes to render, defaults to all bundled scenes")
+    args = parser.parse_args()
+
+    scenes = args.scenes
+    if not scenes:
+        scenes = sorted(glob.glob(os.path.join(os.path.dirname(os.path.abspath(__file__)), "*.xml")))
+
+    results = []
+    for scene in scenes:
+        stats = render_scene(args, scene)
+        results.append(stats)
+        print("%-20s %8.2fs  %12.0f samples/s" % (stats["scene"],
+                                                 stats["time"]["render"],
+                                                 stats["pixel_samples_per_second"]))
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump({"results": results}, f, indent=2)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include "device/device.h"
+#include "render/denoising.h"
+
+#include "util/util_args.h"
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_path.h"
+#include "util/util_string.h"
+#include "util/util_task.h"
+#include "util/util_time.h"
+#include "util/util_version.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct Options {
+	vector<string> input;
+	string output_dir;
+	string suffix;
+	int threads;
+	bool quiet;
+	DenoiseParams params;
+} options;
+
+static int files_parse(int argc, const char *argv[])
+{
+	for(int i = 0; i < argc; i++)
+		options.input.push_back(argv[i]);
+
+	return 0;
+}
+
+static string output_filepath(const string& input)
+{
+	string dir = (options.output_dir != "")? options.output_dir: path_dirname(input);
+	string filename = path_filename(input);
+	string extension = "";
+
+	size_t extension_pos = filename.rfind('.');
+	if(extension_pos != string::npos) {
+		extension = filename.substr(extension_pos);
+		filename = filename.substr(0, extension_pos);
+	}
+
+	return path_join(dir, filename + options.suffix + extension);
+}
+
+static void print_progress(int frame, int num_frames, const string& status)
+{
+	if(!options.quiet) {
+		printf("Frame %d/%d | %s\n", frame + 1, num_frames, status.c_str());
+		fflush(stdout);
+	}
+}
+
+static void options_parse(int argc, const char **argv)
+{
+	options.output_dir = "";
+	options.suffix = "_denoised";
+	options.threads = 0;
+	options.quiet = false;
+
+	int tile_size = options.params.tile_size.x;
+
+	/* parse options */
+	ArgParse ap;
+	bool help = false, debug = false, version = false;
+	int verbosity = 1;
+
+	ap.options ("Usage: cycles_denoise [options] file.exr ...",
+		"%*", files_parse, "",
+		"--samples %d", &options.params.samples, "Number of samples the images were rendered with",
+		"--output-dir %s", &options.output_dir, "Directory to write denoised images to, defaults to the input directory",
+		"--suffix %s", &options.suffix, "Suffix appended to the file name of denoised images",
+		"--radius %d", &options.params.radius, "Radius of the filter in pixels",
+		"--strength %f", &options.params.strength, "Strength of the filter, between 0 and 1",
+		"--feature-strength %f", &options.params.feature_strength, "Strength of the feature space filtering, between 0 and 1",
+		"--relative-pca", &options.params.relative_pca, "Use relative thresholding for the feature space reduction",
+		"--tile-size %d", &tile_size, "Tile size in pixels",
+		"--threads %d", &options.threads, "Number of denoising threads, 0 for automatic",
+		"--quiet", &options.quiet, "Don't print progress messages",
+#ifdef WITH_CYCLES_LOGGING
+		"--debug", &debug, "Enable debug logging",
+		"--verbose %d", &verbosity, "Set verbosity of the logger",
+#endif
+		"--help", &help, "Print help message",
+		"--version", &version, "Print version number",
+		NULL);
+
+	if(ap.parse(argc, argv) < 0) {
+		fprintf(stderr, "%s\n", ap.geterror().c_str());
+		ap.usage();
+		exit(EXIT_FAILURE);
+	}
+
+	if(debug) {
+		util_logging_start();
+		util_logging_verbosity_set(verbosity);
+	}
+
+	if(version) {
+		printf("%s\n", CYCLES_VERSION_STRING);
+		exit(EXIT_SUCCESS);
+	}
+	else if(help || options.input.empty()) {
+		ap.usage();
+		exit(EXIT_SUCCESS);
+	}
+
+	/* handle invalid configurations */
+	if(options.params.samples <= 0) {
+		fprintf(stderr, "Number of samples the images were rendered with must be specified\n");
+		exit(EXIT_FAILURE);
+	}
+	else if(tile_size <= 0) {
+		fprintf(stderr, "Invalid tile size: %d\n", tile_size);
+		exit(EXIT_FAILURE);
+	}
+	else if(options.params.radius <= 0) {
+		fprintf(stderr, "Invalid filter radius: %d\n", options.params.radius);
+		exit(EXIT_FAILURE);
+	}
+	else if(options.output_dir == "" && options.suffix == "") {
+		fprintf(stderr, "Output directory or suffix must be specified, not overwriting input images\n");
+		exit(EXIT_FAILURE);
+	}
+
+	options.params.tile_size = make_int2(tile_size, tile_size);
+}
+
+static bool denoise()
+{
+	/* find CPU device */
+	vector<DeviceInfo>& devices = Device::available_devices();
+	DeviceInfo device_info;
+	bool device_available = false;
+
+	foreach(DeviceInfo& device, devices) {
+		if(device.type == DEVICE_CPU) {
+			device_info = device;
+			device_available = true;
+			break;
+		}
+	}
+
+	if(!device_available) {
+		fprintf(stderr, "No CPU device available\n");
+		return false;
+	}
+
+	vector<string> output;
+	foreach(const string& input, options.input) {
+		output.push_back(output_filepath(input));
+	}
+
+	double start_time = time_dt();
+
+	Denoiser denoiser(device_info);
+	denoiser.params = options.params;
+	denoiser.progress_cb = function_bind(&print_progress, _1, _2, _3);
+
+	if(!denoiser.run(options.input, output)) {
+		fprintf(stderr, "%s\n", denoiser.error.c_str());
+		return false;
+	}
+
+	if(!options.quiet) {
+		printf("Denoised %d frames in %.2f seconds\n",
+		       (int)options.input.size(), time_dt() - start_time);
+	}
+
+	return true;
+}
+
+CCL_NAMESPACE_END
+
+using namespace ccl;
+
+int main(int argc, const char **argv)
+{
+	util_logging_init(argv[0]);
+	path_init();
+	options_parse(argc, argv);
+
+	TaskScheduler::init(options.threads);
+	bool success = denoise();
+	TaskScheduler::exit();
+
+	return (success)? EXIT_SUCCESS: EXIT_FAILURE;
+}
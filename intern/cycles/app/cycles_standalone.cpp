@@ -26,10 +26,12 @@
 #include "util/util_args.h"
 #include "util/util_foreach.h"
 #include "util/util_function.h"
+#include "util/util_guarded_allocator.h"
 #include "util/util_logging.h"
 #include "util/util_path.h"
 #include "util/util_progress.h"
 #include "util/util_string.h"
+#include "util/util_task.h"
 #include "util/util_time.h"
 #include "util/util_transform.h"
 #include "util/util_version.h"
@@ -49,6 +51,8 @@ struct Options {
 	int width, height;
 	SceneParams scene_params;
 	SessionParams session_params;
+	string stats_output;
+	int seed;
 	bool quiet;
 	bool show_help, interactive, pause;
 } options;
@@ -132,12 +136,84 @@ static void scene_init()
 		options.height = options.scene->camera->height;
 	}
 
+	/* Seed override, for reproducible benchmark runs */
+	if(options.seed >= 0) {
+		options.scene->integrator->seed = options.seed;
+		options.scene->integrator->tag_update(options.scene);
+	}
+
 	/* Calculate Viewplane */
 	options.scene->camera->compute_auto_viewplane();
 }
 
+static void session_write_stats(const string& filepath)
+{
+	Session *session = options.session;
+	FILE *f = path_fopen(filepath, "w");
+
+	if(!f) {
+		fprintf(stderr, "Failed to write statistics to %s\n", filepath.c_str());
+		return;
+	}
+
+	double total_time, render_time;
+	session->progress.get_time(total_time, render_time);
+	uint64_t pixel_samples = session->progress.get_pixel_samples();
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"scene\": \"%s\",\n", path_filename(options.filepath).c_str());
+	fprintf(f, "  \"version\": \"%s\",\n", CYCLES_VERSION_STRING);
+	fprintf(f, "  \"device\": \"%s\",\n", options.session_params.device.description.c_str());
+	fprintf(f, "  \"threads\": %d,\n", TaskScheduler::num_threads());
+	fprintf(f, "  \"width\": %d,\n", options.width);
+	fprintf(f, "  \"height\": %d,\n", options.height);
+	fprintf(f, "  \"samples\": %d,\n", options.session_params.samples);
+	fprintf(f, "  \"seed\": %d,\n", session->scene->integrator->seed);
+	fprintf(f, "  \"time\": {\n");
+	fprintf(f, "    \"total\": %f,\n", total_time);
+	fprintf(f, "    \"render\": %f", render_time);
+	for(int i = 0; i < STATS_TIME_NUM_TYPES; i++) {
+		StatsTime type = (StatsTime)i;
+		fprintf(f, ",\n    \"%s\": %f", Stats::time_name(type), session->stats.time_get(type));
+	}
+	fprintf(f, "\n  },\n");
+	fprintf(f, "  \"pixel_samples\": %llu,\n", (unsigned long long)pixel_samples);
+	fprintf(f, "  \"pixel_samples_per_second\": %f,\n",
+	        (render_time > 0.0)? pixel_samples / render_time: 0.0);
+	if(session->stats.kernel_stats_used) {
+		const KernelStats& kernel = session->stats.kernel;
+
+		fprintf(f, "  \"kernel\": {\n");
+		fprintf(f, "    \"rays\": {\n");
+		for(int type = 0; type < STATS_RAY_NUM_TYPES; type++) {
+			fprintf(f, "      \"%s\": [", Stats::ray_name((StatsRay)type));
+			for(int bounce = 0; bounce < STATS_MAX_BOUNCES; bounce++) {
+				fprintf(f, "%s%llu", (bounce)? ", ": "", (unsigned long long)kernel.rays[type][bounce]);
+			}
+			fprintf(f, "]%s\n", (type < STATS_RAY_NUM_TYPES - 1)? ",": "");
+		}
+		fprintf(f, "    },\n");
+		fprintf(f, "    \"rays_total\": %llu,\n", (unsigned long long)session->stats.kernel_rays_total());
+		fprintf(f, "    \"bvh_traversed_nodes\": %llu,\n", (unsigned long long)kernel.bvh_traversed_nodes);
+		fprintf(f, "    \"bvh_traversed_instances\": %llu,\n", (unsigned long long)kernel.bvh_traversed_instances);
+		fprintf(f, "    \"bvh_intersections\": %llu\n", (unsigned long long)kernel.bvh_intersections);
+		fprintf(f, "  },\n");
+	}
+	fprintf(f, "  \"memory\": {\n");
+	fprintf(f, "    \"device_peak\": %llu,\n", (unsigned long long)session->stats.mem_peak);
+	fprintf(f, "    \"host_peak\": %llu\n", (unsigned long long)util_guarded_get_mem_peak());
+	fprintf(f, "  }\n");
+	fprintf(f, "}\n");
+
+	fclose(f);
+}
+
 static void session_exit()
 {
+	if(options.session && options.stats_output != "") {
+		session_write_stats(options.stats_output);
+	}
+
 	if(options.session) {
 		delete options.session;
 		options.session = NULL;
@@ -330,6 +406,7 @@ static void options_parse(int argc, const char **argv)
 	options.filepath = "";
 	options.session = NULL;
 	options.quiet = false;
+	options.seed = -1;
 
 	/* device names */
 	string device_names = "";
@@ -368,6 +445,9 @@ static void options_parse(int argc, const char **argv)
 		"--quiet", &options.quiet, "In background mode, don't print progress messages",
 		"--samples %d", &options.session_params.samples, "Number of samples to render",
 		"--output %s", &options.session_params.output_path, "File path to write output image",
+		"--stats-output %s", &options.stats_output, "File path to write render statistics as JSON",
+		"--seed %d", &options.seed, "Override the integrator seed of the scene",
+		"--kernel-stats", &options.session_params.kernel_stats, "Gather ray, BVH and shader statistics on the CPU and print a summary after rendering",
 		"--threads %d", &options.session_params.threads, "CPU Rendering Threads",
 		"--width  %d", &options.width, "Window width in pixel",
 		"--height %d", &options.height, "Window height in pixel",
@@ -40,7 +40,9 @@
 
 #include "util/util_debug.h"
 #include "util/util_foreach.h"
+#include "util/util_logging.h"
 #include "util/util_path.h"
+#include "util/util_time.h"
 #include "util/util_transform.h"
 #include "util/util_xml.h"
 
@@ -368,6 +370,233 @@ static void xml_read_background(XMLReadState& state, pugi::xml_node node)
 	xml_read_shader_graph(state, shader, node);
 }
 
+/* Binary Mesh
+ *
+ * Sidecar file that <mesh src="file.cmesh"/> can reference instead of storing
+ * the geometry as text attributes. Arrays use the same layout as the Mesh
+ * arrays they end up in and are 16 byte aligned, so the file is memory mapped
+ * and arrays are copied straight into the mesh. Offsets are relative to the
+ * start of the file, an offset of zero means the array is not present.
+ * Written by io_export_cycles_xml.py. */
+
+#define BINARY_MESH_MAGIC "CYCLMESH"
+#define BINARY_MESH_VERSION 1
+
+enum BinaryMeshFlag {
+	/* All faces are triangles and nverts is omitted, triangles and
+	 * corner UVs are copied without re-indexing. */
+	BINARY_MESH_TRIANGLES = (1 << 0),
+};
+
+struct BinaryMeshHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t flags;
+
+	uint64_t num_verts;
+	uint64_t num_faces;
+	uint64_t num_corners;
+	uint64_t num_motion_steps;
+
+	uint64_t offset_P;         /* float3[num_verts] */
+	uint64_t offset_nverts;    /* int[num_faces] */
+	uint64_t offset_verts;     /* int[num_corners] */
+	uint64_t offset_UV;        /* float3[num_corners] */
+	uint64_t offset_N;         /* float3[num_verts] */
+	uint64_t offset_motion_P;  /* float3[(num_motion_steps - 1)*num_verts] */
+};
+
+static const void *binary_mesh_array(const uint8_t *data,
+                                     size_t size,
+                                     uint64_t offset,
+                                     uint64_t count,
+                                     size_t element_size)
+{
+	if(offset == 0 || offset % 16 != 0 || offset > size)
+		return NULL;
+	if(count > (size - offset) / element_size)
+		return NULL;
+
+	return data + offset;
+}
+
+static bool binary_mesh_check_indices(const int *verts, size_t num_corners, size_t num_verts)
+{
+	for(size_t i = 0; i < num_corners; i++)
+		if(verts[i] < 0 || verts[i] >= (int)num_verts)
+			return false;
+
+	return true;
+}
+
+static bool binary_mesh_check_face_sizes(const int *nverts, size_t num_faces, size_t num_corners)
+{
+	/* Faces are walked by their corner count, so the counts must add up to
+	 * exactly the corners stored in the file. */
+	uint64_t total = 0;
+
+	for(size_t i = 0; i < num_faces; i++) {
+		if(nverts[i] < 3)
+			return false;
+		total += (uint64_t)nverts[i];
+		if(total > (uint64_t)num_corners)
+			return false;
+	}
+
+	return total == (uint64_t)num_corners;
+}
+
+static bool xml_read_mesh_binary(Mesh *mesh, const string& filepath, int shader, bool smooth)
+{
+	size_t size;
+	const uint8_t *data = path_map_file(filepath, &size);
+
+	if(!data) {
+		fprintf(stderr, "Failed to read binary mesh \"%s\".\n", filepath.c_str());
+		return false;
+	}
+
+	BinaryMeshHeader header;
+	bool valid = (size >= sizeof(header));
+
+	if(valid) {
+		memcpy(&header, data, sizeof(header));
+		valid = memcmp(header.magic, BINARY_MESH_MAGIC, sizeof(header.magic)) == 0 &&
+		        header.version == BINARY_MESH_VERSION;
+	}
+
+	if(!valid) {
+		fprintf(stderr, "Invalid binary mesh \"%s\".\n", filepath.c_str());
+		path_unmap_file(data, size);
+		return false;
+	}
+
+	const bool triangles = (header.flags & BINARY_MESH_TRIANGLES) != 0;
+	const size_t num_verts = header.num_verts;
+	const size_t num_faces = header.num_faces;
+	const size_t num_corners = header.num_corners;
+
+	const float3 *P = (const float3*)binary_mesh_array(data, size, header.offset_P, num_verts, sizeof(float3));
+	const int *nverts = (const int*)binary_mesh_array(data, size, header.offset_nverts, num_faces, sizeof(int));
+	const int *verts = (const int*)binary_mesh_array(data, size, header.offset_verts, num_corners, sizeof(int));
+	const float3 *UV = (const float3*)binary_mesh_array(data, size, header.offset_UV, num_corners, sizeof(float3));
+	const float3 *N = (const float3*)binary_mesh_array(data, size, header.offset_N, num_verts, sizeof(float3));
+	const float3 *motion_P = NULL;
+
+	if(header.num_motion_steps > 1) {
+		motion_P = (const float3*)binary_mesh_array(data, size, header.offset_motion_P,
+		                                            (header.num_motion_steps - 1)*num_verts, sizeof(float3));
+	}
+
+	if(!P || !verts || (!triangles && !nverts) || (triangles && num_corners != num_faces*3) ||
+	   (!triangles && !binary_mesh_check_face_sizes(nverts, num_faces, num_corners)) ||
+	   !binary_mesh_check_indices(verts, num_corners, num_verts))
+	{
+		fprintf(stderr, "Corrupt binary mesh \"%s\".\n", filepath.c_str());
+		path_unmap_file(data, size);
+		return false;
+	}
+
+	if(mesh->subdivision_type == Mesh::SUBDIVISION_NONE) {
+		if(triangles) {
+			/* copy directly into mesh arrays */
+			mesh->resize_mesh(num_verts, num_faces);
+			memcpy(mesh->verts.data(), P, sizeof(float3)*num_verts);
+			memcpy(mesh->triangles.data(), verts, sizeof(int)*num_corners);
+
+			for(size_t i = 0; i < num_faces; i++) {
+				mesh->shader[i] = shader;
+				mesh->smooth[i] = smooth;
+			}
+		}
+		else {
+			size_t num_triangles = 0;
+			for(size_t i = 0; i < num_faces; i++)
+				num_triangles += nverts[i]-2;
+
+			mesh->reserve_mesh(num_verts, num_triangles);
+			mesh->verts.resize(num_verts);
+			memcpy(mesh->verts.data(), P, sizeof(float3)*num_verts);
+
+			int index_offset = 0;
+			for(size_t i = 0; i < num_faces; i++) {
+				for(int j = 0; j < nverts[i]-2; j++) {
+					mesh->add_triangle(verts[index_offset],
+					                   verts[index_offset + j + 1],
+					                   verts[index_offset + j + 2],
+					                   shader,
+					                   smooth);
+				}
+				index_offset += nverts[i];
+			}
+		}
+
+		if(UV) {
+			Attribute *attr = mesh->attributes.add(ATTR_STD_UV, ustring("UVMap"));
+			float3 *fdata = attr->data_float3();
+
+			if(triangles) {
+				memcpy(fdata, UV, sizeof(float3)*num_corners);
+			}
+			else {
+				int index_offset = 0;
+				for(size_t i = 0; i < num_faces; i++) {
+					for(int j = 0; j < nverts[i]-2; j++) {
+						fdata[0] = UV[index_offset];
+						fdata[1] = UV[index_offset + j + 1];
+						fdata[2] = UV[index_offset + j + 2];
+						fdata += 3;
+					}
+					index_offset += nverts[i];
+				}
+			}
+		}
+
+		if(N) {
+			Attribute *attr = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
+			memcpy(attr->data_float3(), N, sizeof(float3)*num_verts);
+		}
+
+		if(motion_P) {
+			mesh->use_motion_blur = true;
+			mesh->motion_steps = (uint)header.num_motion_steps;
+
+			Attribute *attr = mesh->attributes.add(ATTR_STD_MOTION_VERTEX_POSITION);
+			memcpy(attr->data_float3(), motion_P, sizeof(float3)*num_verts*(header.num_motion_steps - 1));
+		}
+	}
+	else {
+		mesh->verts.resize(num_verts);
+		memcpy(mesh->verts.data(), P, sizeof(float3)*num_verts);
+
+		size_t num_ngons = 0;
+		for(size_t i = 0; i < num_faces; i++)
+			num_ngons += ((triangles? 3: nverts[i]) == 4) ? 0 : 1;
+		mesh->reserve_subd_faces(num_faces, num_ngons, num_corners);
+
+		int index_offset = 0;
+		for(size_t i = 0; i < num_faces; i++) {
+			int num_face_corners = triangles? 3: nverts[i];
+			mesh->add_subd_face((int*)&verts[index_offset], num_face_corners, shader, smooth);
+			index_offset += num_face_corners;
+		}
+
+		if(UV) {
+			Attribute *attr = mesh->subd_attributes.add(ATTR_STD_UV, ustring("UVMap"));
+			memcpy(attr->data_float3(), UV, sizeof(float3)*num_corners);
+		}
+
+		if(N || motion_P) {
+			fprintf(stderr, "Binary mesh \"%s\": normals and motion are ignored for subdivision meshes.\n",
+			        filepath.c_str());
+		}
+	}
+
+	path_unmap_file(data, size);
+
+	return true;
+}
+
 /* Mesh */
 
 static Mesh *xml_add_mesh(Scene *scene, const Transform& tfm)
@@ -411,7 +640,13 @@ static void xml_read_mesh(const XMLReadState& state, pugi::xml_node node)
 		mesh->subdivision_type = Mesh::SUBDIVISION_LINEAR;
 	}
 
-	if(mesh->subdivision_type == Mesh::SUBDIVISION_NONE) {
+	string src;
+
+	if(xml_read_string(&src, node, "src")) {
+		/* geometry from binary sidecar file */
+		xml_read_mesh_binary(mesh, path_join(state.base, src), shader, smooth);
+	}
+	else if(mesh->subdivision_type == Mesh::SUBDIVISION_NONE) {
 		/* create vertices */
 		mesh->verts = P;
 
@@ -505,7 +740,9 @@ static void xml_read_mesh(const XMLReadState& state, pugi::xml_node node)
 				}
 			}
 		}
+	}
 
+	if(mesh->subdivision_type != Mesh::SUBDIVISION_NONE) {
 		/* setup subd params */
 		if(!mesh->subd_params) {
 			mesh->subd_params = new SubdParams(mesh);
@@ -681,6 +918,7 @@ static void xml_read_include(XMLReadState& state, const string& src)
 void xml_read_file(Scene *scene, const char *filepath)
 {
 	XMLReadState state;
+	double start_time = time_dt();
 
 	state.scene = scene;
 	state.tfm = transform_identity();
@@ -691,6 +929,9 @@ void xml_read_file(Scene *scene, const char *filepath)
 
 	xml_read_include(state, path_filename(filepath));
 
+	VLOG(1) << "Read scene file " << filepath << " in "
+	        << time_dt() - start_time << " seconds.";
+
 	scene->params.bvh_type = SceneParams::BVH_STATIC;
 }
 
@@ -17,12 +17,14 @@
 # XML exporter for generating test files, not intended for end users
 
 import os
+import struct
 import xml.etree.ElementTree as etree
 import xml.dom.minidom as dom
+from array import array
 
 import bpy
 from bpy_extras.io_utils import ExportHelper
-from bpy.props import PointerProperty, StringProperty
+from bpy.props import BoolProperty, PointerProperty, StringProperty
 
 def strip(root):
     root.text = None
@@ -40,6 +42,75 @@ def write(node, fname):
     f = open(fname, "w")
     f.write(s)
     
+# Binary mesh sidecar, must match BinaryMeshHeader in cycles_xml.cpp
+BINARY_MESH_MAGIC = b"CYCLMESH"
+BINARY_MESH_VERSION = 1
+BINARY_MESH_TRIANGLES = (1 << 0)
+BINARY_MESH_HEADER = "<8sII4Q6Q"
+
+def float3_array(values):
+    # float3 is padded to 16 bytes in Cycles
+    result = array('f', bytes(len(values) // 3 * 16))
+    result[0::4] = values[0::3]
+    result[1::4] = values[1::3]
+    result[2::4] = values[2::3]
+    return result
+
+def write_binary(mesh, fname):
+    num_verts = len(mesh.vertices)
+
+    co = array('f', bytes(num_verts * 3 * 4))
+    normal = array('f', bytes(num_verts * 3 * 4))
+    mesh.vertices.foreach_get("co", co)
+    mesh.vertices.foreach_get("normal", normal)
+
+    nverts = array('i')
+    verts = array('i')
+    uvs = array('f')
+    uv_layer = mesh.tessface_uv_textures.active
+
+    for i, f in enumerate(mesh.tessfaces):
+        nverts.append(len(f.vertices))
+        verts.extend(f.vertices)
+
+        if uv_layer:
+            uvf = uv_layer.data[i]
+            for uv in (uvf.uv1, uvf.uv2, uvf.uv3, uvf.uv4)[:len(f.vertices)]:
+                uvs.extend((uv[0], uv[1], 0.0))
+
+    flags = 0
+    if all(n == 3 for n in nverts):
+        flags |= BINARY_MESH_TRIANGLES
+
+    arrays = [float3_array(co),
+              None if flags & BINARY_MESH_TRIANGLES else nverts,
+              verts,
+              float3_array(uvs) if uv_layer else None,
+              float3_array(normal)]
+
+    # arrays follow the header, each 16 byte aligned
+    offsets = []
+    offset = struct.calcsize(BINARY_MESH_HEADER)
+    for a in arrays:
+        if a is None:
+            offsets.append(0)
+            continue
+        offset = (offset + 15) & ~15
+        offsets.append(offset)
+        offset += len(a) * a.itemsize
+
+    f = open(fname, "wb")
+    f.write(struct.pack(BINARY_MESH_HEADER, BINARY_MESH_MAGIC, BINARY_MESH_VERSION, flags,
+                        num_verts, len(nverts), len(verts), 0,
+                        *(offsets + [0])))
+
+    for a, offset in zip(arrays, offsets):
+        if a is not None:
+            f.write(bytes(offset - f.tell()))
+            a.tofile(f)
+
+    f.close()
+
 class CyclesXMLSettings(bpy.types.PropertyGroup):
     @classmethod
     def register(cls):
@@ -89,6 +160,13 @@ class ExportCyclesXML(bpy.types.Operator, ExportHelper):
 
     filename_ext = ".xml"
 
+    use_binary = BoolProperty(
+            name="Binary Geometry",
+            description="Write mesh data to a memory-mappable .cmesh file next to the .xml, "
+                        "which is much faster to load for large meshes",
+            default=False,
+            )
+
     @classmethod
     def poll(cls, context):
         return (context.active_object is not None)
@@ -108,6 +186,15 @@ class ExportCyclesXML(bpy.types.Operator, ExportHelper):
         if not mesh:
             raise Exception("No mesh data in active object")
 
+        if self.use_binary:
+            binary_filepath = os.path.splitext(filepath)[0] + ".cmesh"
+            write_binary(mesh, binary_filepath)
+
+            node = etree.Element('mesh', attrib={'src': os.path.basename(binary_filepath)})
+            write(node, filepath)
+
+            return {'FINISHED'}
+
         # generate mesh node
         nverts = ""
         verts = ""
@@ -527,6 +527,18 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                             "but time can be saved by manually stopping the render when the noise is low enough)",
                 default=False,
                 )
+        cls.use_kernel_stats = BoolProperty(
+                name="Statistics",
+                description="Count rays and BVH traversal steps and time shaders while rendering on the CPU, "
+                            "printing a summary to the console when the render is done",
+                default=False,
+                )
+        cls.use_half_buffers = BoolProperty(
+                name="Half Float Buffers",
+                description="Store color, normal and denoising feature passes of tiles that have all their samples "
+                            "in half float precision, reducing memory usage of large multi-pass renders",
+                default=False,
+                )
 
         cls.bake_type = EnumProperty(
             name="Bake Type",
@@ -644,6 +656,11 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         cls.debug_use_cpu_sse2 = BoolProperty(name="SSE2", default=True)
         cls.debug_use_qbvh = BoolProperty(name="QBVH", default=True)
         cls.debug_use_cpu_split_kernel = BoolProperty(name="Split Kernel", default=False)
+        cls.debug_use_cpu_svm_bake = BoolProperty(
+                name="Bake Shaders",
+                description="Compile shader node programs into native code with the system compiler",
+                default=False,
+                )
 
         cls.debug_use_cuda_adaptive_compile = BoolProperty(name="Adaptive Compile", default=False)
         cls.debug_use_cuda_split_kernel = BoolProperty(name="Split Kernel", default=False)
@@ -1146,6 +1163,12 @@ class CyclesCurveRenderSettings(bpy.types.PropertyGroup):
                 min=0, max=24,
                 default=4,
                 )
+        cls.use_compact_keys = BoolProperty(
+                name="Compact Keys",
+                description="Store strand keys quantized to 16 bits relative to the strand bounds, "
+                            "halving their memory usage at the cost of some precision",
+                default=False,
+                )
 
     @classmethod
     def unregister(cls):
@@ -1189,6 +1212,12 @@ class CyclesRenderLayerSettings(bpy.types.PropertyGroup):
                 default=False,
                 update=update_render_passes,
                 )
+        cls.pass_debug_shader_time = BoolProperty(
+                name="Debug Shader Time",
+                description="Store time spent evaluating shaders, in thousands of CPU clock ticks (CPU only)",
+                default=False,
+                update=update_render_passes,
+                )
 
         cls.use_denoising = BoolProperty(
                 name="Use Denoising",
@@ -265,6 +265,9 @@ class CyclesRender_PT_geometry(CyclesButtonsPanel, Panel):
         elif ccscene.primitive == 'CURVE_SEGMENTS':
             col.prop(ccscene, "subdivisions", text="Curve subdivisions")
 
+        if ccscene.primitive != 'TRIANGLES':
+            col.prop(ccscene, "use_compact_keys")
+
         row = col.row()
         row.prop(ccscene, "minimum_width", text="Min Pixels")
         row.prop(ccscene, "maximum_width", text="Max Extension")
@@ -404,6 +407,7 @@ class CyclesRender_PT_performance(CyclesButtonsPanel, Panel):
         sub.prop(rd, "tile_y", text="Y")
 
         sub.prop(cscene, "use_progressive_refine")
+        sub.prop(cscene, "use_half_buffers")
 
         subsub = sub.column(align=True)
         subsub.prop(rd, "use_save_buffers")
@@ -419,6 +423,7 @@ class CyclesRender_PT_performance(CyclesButtonsPanel, Panel):
 
         col.label(text="Final Render:")
         col.prop(rd, "use_persistent_data", text="Persistent Images")
+        col.prop(cscene, "use_kernel_stats")
 
         col.separator()
 
@@ -533,12 +538,13 @@ class CyclesRender_PT_layer_passes(CyclesButtonsPanel, Panel):
             sub.active = crl.use_denoising
             sub.prop(crl, "denoising_store_passes", text="Denoising")
 
-        if _cycles.with_cycles_debug:
+        if _cycles.with_cycles_debug or context.scene.cycles.device == 'CPU':
             col = layout.column()
             col.prop(crl, "pass_debug_bvh_traversed_nodes")
             col.prop(crl, "pass_debug_bvh_traversed_instances")
             col.prop(crl, "pass_debug_bvh_intersections")
             col.prop(crl, "pass_debug_ray_bounces")
+            col.prop(crl, "pass_debug_shader_time")
 
 
 class CyclesRender_PT_views(CyclesButtonsPanel, Panel):
@@ -1593,6 +1599,7 @@ class CyclesRender_PT_debug(CyclesButtonsPanel, Panel):
         row.prop(cscene, "debug_use_cpu_avx2", toggle=True)
         col.prop(cscene, "debug_use_qbvh")
         col.prop(cscene, "debug_use_cpu_split_kernel")
+        col.prop(cscene, "debug_use_cpu_svm_bake")
 
         col = layout.column()
         col.label('CUDA Flags:')
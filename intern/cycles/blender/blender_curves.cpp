@@ -820,6 +820,7 @@ void BlenderSync::sync_curve_settings()
 	curve_system_manager->resolution = get_int(csscene, "resolution");
 	curve_system_manager->subdivisions = get_int(csscene, "subdivisions");
 	curve_system_manager->use_backfacing = !get_boolean(csscene, "cull_backfacing");
+	curve_system_manager->use_compact_keys = get_boolean(csscene, "use_compact_keys");
 
 	/* Triangles */
 	if(curve_system_manager->primitive == CURVE_TRIANGLES) {
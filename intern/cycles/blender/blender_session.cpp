@@ -209,6 +209,7 @@ void BlenderSession::reset_session(BL::BlendData& b_data_, BL::Scene& b_scene_)
 	 * made by this render session
 	 */
 	session->stats.mem_peak = session->stats.mem_used;
+	session->stats.buffer_mem_peak = session->stats.buffer_mem_used;
 
 	/* sync object should be re-created */
 	sync = new BlenderSync(b_engine, b_data, b_scene, scene, !background, session->progress, is_cpu);
@@ -377,6 +378,9 @@ void BlenderSession::render()
 	SessionParams session_params = BlenderSync::get_session_params(b_engine, b_userpref, b_scene, background);
 	BufferParams buffer_params = BlenderSync::get_buffer_params(b_render, b_v3d, b_rv3d, scene->camera, width, height);
 
+	PointerRNA cscene = RNA_pointer_get(&b_scene.ptr, "cycles");
+	buffer_params.half_storage = get_boolean(cscene, "use_half_buffers");
+
 	/* render each layer */
 	BL::RenderSettings r = b_scene.render();
 	BL::RenderSettings::layers_iterator b_layer_iter;
@@ -901,6 +905,7 @@ void BlenderSession::update_status_progress()
 	char time_str[128];
 	float mem_used = (float)session->stats.mem_used / 1024.0f / 1024.0f;
 	float mem_peak = (float)session->stats.mem_peak / 1024.0f / 1024.0f;
+	float buffer_mem_peak = (float)session->stats.buffer_mem_peak / 1024.0f / 1024.0f;
 
 	get_status(status, substatus);
 	get_progress(progress, total_time, render_time);
@@ -927,6 +932,9 @@ void BlenderSession::update_status_progress()
 	}
 
 	timestatus += string_printf("Mem:%.2fM, Peak:%.2fM", (double)mem_used, (double)mem_peak);
+	if(background) {
+		timestatus += string_printf(", Buffers Peak:%.2fM", (double)buffer_mem_peak);
+	}
 
 	if(status.size() > 0)
 		status = " | " + status;
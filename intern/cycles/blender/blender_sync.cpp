@@ -514,12 +514,11 @@ PassType BlenderSync::get_pass_type(BL::RenderPass& b_pass)
 	MAP_PASS("AO", PASS_AO);
 	MAP_PASS("Shadow", PASS_SHADOW);
 
-#ifdef __KERNEL_DEBUG__
 	MAP_PASS("Debug BVH Traversed Nodes", PASS_BVH_TRAVERSED_NODES);
 	MAP_PASS("Debug BVH Traversed Instances", PASS_BVH_TRAVERSED_INSTANCES);
 	MAP_PASS("Debug BVH Intersections", PASS_BVH_INTERSECTIONS);
 	MAP_PASS("Debug Ray Bounces", PASS_RAY_BOUNCES);
-#endif
+	MAP_PASS("Debug Shader Time", PASS_SHADER_TIME);
 #undef MAP_PASS
 
 	return PASS_NONE;
@@ -588,7 +587,6 @@ array<Pass> BlenderSync::sync_render_passes(BL::RenderLayer& b_rlay,
 		b_engine.add_pass("Denoising Image",           3, "RGB", b_srlay.name().c_str());
 		b_engine.add_pass("Denoising Image Variance",  3, "RGB", b_srlay.name().c_str());
 	}
-#ifdef __KERNEL_DEBUG__
 	if(get_boolean(crp, "pass_debug_bvh_traversed_nodes")) {
 		b_engine.add_pass("Debug BVH Traversed Nodes", 1, "X", b_srlay.name().c_str());
 		Pass::add(PASS_BVH_TRAVERSED_NODES, passes);
@@ -605,7 +603,10 @@ array<Pass> BlenderSync::sync_render_passes(BL::RenderLayer& b_rlay,
 		b_engine.add_pass("Debug Ray Bounces", 1, "X", b_srlay.name().c_str());
 		Pass::add(PASS_RAY_BOUNCES, passes);
 	}
-#endif
+	if(get_boolean(crp, "pass_debug_shader_time")) {
+		b_engine.add_pass("Debug Shader Time", 1, "X", b_srlay.name().c_str());
+		Pass::add(PASS_SHADER_TIME, passes);
+	}
 
 	return passes;
 }
@@ -819,6 +820,7 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine& b_engine,
 	params.text_timeout = (double)get_float(cscene, "debug_text_timeout");
 
 	params.progressive_refine = get_boolean(cscene, "use_progressive_refine");
+	params.kernel_stats = get_boolean(cscene, "use_kernel_stats");
 
 	if(background) {
 		if(params.progressive_refine)
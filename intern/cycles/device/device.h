@@ -305,6 +305,12 @@ public:
 	/* open shading language, only for CPU device */
 	virtual void *osl_memory() { return NULL; }
 
+	/* shader programs baked into native code, only for CPU device */
+	virtual bool load_baked_shaders(const string& /*library_path*/,
+	                                int /*num_functions*/)
+	{ return false; }
+	virtual void free_baked_shaders() {}
+
 	/* load/compile kernels, must be called before adding tasks */ 
 	virtual bool load_kernels(
 	        const DeviceRequestedFeatures& /*requested_features*/)
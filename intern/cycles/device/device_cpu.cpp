@@ -41,8 +41,10 @@
 #include "kernel/osl/osl_globals.h"
 
 #include "render/buffers.h"
+#include "render/svm_bake.h"
 
 #include "util/util_debug.h"
+#include "util/util_dynlib.h"
 #include "util/util_foreach.h"
 #include "util/util_function.h"
 #include "util/util_logging.h"
@@ -52,6 +54,7 @@
 #include "util/util_progress.h"
 #include "util/util_system.h"
 #include "util/util_thread.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -169,9 +172,12 @@ public:
 
 	bool use_split_kernel;
 
+	DynamicLibrary *svm_baked_library;
+
 	DeviceRequestedFeatures requested_features;
 
 	KernelFunctions<void(*)(KernelGlobals *, float *, unsigned int *, int, int, int, int, int)>   path_trace_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, unsigned int *, int, int, int, int, int)>   path_trace_stats_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)>       convert_to_half_float_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)>       convert_to_byte_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uint4 *, float4 *, float*, int, int, int, int, int)> shader_kernel;
@@ -204,10 +210,19 @@ public:
 	      KERNEL_NAME_EVAL(cpu_avx, name), \
 	      KERNEL_NAME_EVAL(cpu_avx2, name)
 
+#define KERNEL_STATS_FUNCTIONS(name) \
+	      KERNEL_NAME_EVAL(cpu_stats, name), \
+	      KERNEL_NAME_EVAL(cpu_stats_sse2, name), \
+	      KERNEL_NAME_EVAL(cpu_stats_sse3, name), \
+	      KERNEL_NAME_EVAL(cpu_stats_sse41, name), \
+	      KERNEL_NAME_EVAL(cpu_stats_avx, name), \
+	      KERNEL_NAME_EVAL(cpu_stats_avx2, name)
+
 	CPUDevice(DeviceInfo& info, Stats &stats, bool background)
 	: Device(info, stats, background),
 #define REGISTER_KERNEL(name) name ## _kernel(KERNEL_FUNCTIONS(name))
 	  REGISTER_KERNEL(path_trace),
+	  path_trace_stats_kernel(KERNEL_STATS_FUNCTIONS(path_trace)),
 	  REGISTER_KERNEL(convert_to_half_float),
 	  REGISTER_KERNEL(convert_to_byte),
 	  REGISTER_KERNEL(shader),
@@ -235,6 +250,10 @@ public:
 			VLOG(1) << "Will be using split kernel.";
 		}
 
+		svm_baked_library = NULL;
+		kernel_globals.svm_baked = NULL;
+		kernel_globals.stats = NULL;
+
 #define REGISTER_SPLIT_KERNEL(name) split_kernels[#name] = KernelFunctions<void(*)(KernelGlobals*, KernelData*)>(KERNEL_FUNCTIONS(name))
 		REGISTER_SPLIT_KERNEL(path_init);
 		REGISTER_SPLIT_KERNEL(scene_intersect);
@@ -255,12 +274,14 @@ public:
 		REGISTER_SPLIT_KERNEL(indirect_subsurface);
 		REGISTER_SPLIT_KERNEL(buffer_update);
 #undef REGISTER_SPLIT_KERNEL
+#undef KERNEL_STATS_FUNCTIONS
 #undef KERNEL_FUNCTIONS
 	}
 
 	~CPUDevice()
 	{
 		task_pool.stop();
+		free_baked_shaders();
 	}
 
 	virtual bool show_samples() const
@@ -320,6 +341,50 @@ public:
 		return (device_ptr) (((char*) mem.device_pointer) + mem.memory_elements_size(offset));
 	}
 
+	bool load_baked_shaders(const string& library_path, int num_functions)
+	{
+		free_baked_shaders();
+
+		/* Split kernel always uses the interpreter. */
+		if(use_split_kernel) {
+			return false;
+		}
+
+		DynamicLibrary *lib = dynlib_open(library_path);
+		if(!lib) {
+			VLOG(1) << "Failed to load baked shaders: " << dynlib_error(NULL);
+			return false;
+		}
+
+		const SVMBakedFunction *functions =
+		        (const SVMBakedFunction*)dynlib_find_symbol(lib, SVM_BAKED_FUNCTIONS_SYMBOL);
+		const int *library_num_functions =
+		        (const int*)dynlib_find_symbol(lib, SVM_BAKED_NUM_FUNCTIONS_SYMBOL);
+
+		if(!functions || !library_num_functions || *library_num_functions != num_functions) {
+			VLOG(1) << "Baked shaders library " << library_path << " does not match the scene.";
+			dynlib_close(lib);
+			return false;
+		}
+
+		svm_baked_library = lib;
+		kernel_globals.svm_baked = functions;
+
+		VLOG(1) << "Using baked shaders from " << library_path << ".";
+
+		return true;
+	}
+
+	void free_baked_shaders()
+	{
+		kernel_globals.svm_baked = NULL;
+
+		if(svm_baked_library) {
+			dynlib_close(svm_baked_library);
+			svm_baked_library = NULL;
+		}
+	}
+
 	void const_copy_to(const char *name, void *host, size_t size)
 	{
 		kernel_const_copy(&kernel_globals, name, host, size);
@@ -369,10 +434,16 @@ public:
 		if(task->type == DeviceTask::RENDER) {
 			thread_render(*task);
 		}
-		else if(task->type == DeviceTask::FILM_CONVERT)
+		else if(task->type == DeviceTask::FILM_CONVERT) {
+			double start_time = time_dt();
 			thread_film_convert(*task);
-		else if(task->type == DeviceTask::SHADER)
+			stats.time_add(STATS_TIME_FILM_CONVERT, time_dt() - start_time);
+		}
+		else if(task->type == DeviceTask::SHADER) {
+			double start_time = time_dt();
 			thread_shader(*task);
+			stats.time_add(STATS_TIME_SHADER, time_dt() - start_time);
+		}
 	}
 
 	class CPUDeviceTask : public DeviceTask {
@@ -621,6 +692,17 @@ public:
 		int start_sample = tile.start_sample;
 		int end_sample = tile.start_sample + tile.num_samples;
 
+		/* Counters and timings are only compiled into the statistics kernels,
+		 * so the regular ones don't pay for them. */
+		const int debug_passes = PASS_BVH_TRAVERSED_NODES |
+		                         PASS_BVH_TRAVERSED_INSTANCES |
+		                         PASS_BVH_INTERSECTIONS |
+		                         PASS_RAY_BOUNCES;
+		const bool use_stats_kernel = (kg->stats != NULL) ||
+		                              (kg->__data.film.pass_flag & debug_passes);
+		void(*kernel)(KernelGlobals *, float *, unsigned int *, int, int, int, int, int) =
+		        use_stats_kernel? path_trace_stats_kernel(): path_trace_kernel();
+
 		for(int sample = start_sample; sample < end_sample; sample++) {
 			if(task.get_cancel() || task_pool.canceled()) {
 				if(task.need_finish_queue == false)
@@ -629,8 +711,8 @@ public:
 
 			for(int y = tile.y; y < tile.y + tile.h; y++) {
 				for(int x = tile.x; x < tile.x + tile.w; x++) {
-					path_trace_kernel()(kg, render_buffer, rng_state,
-					                    sample, x, y, tile.offset, tile.stride);
+					kernel(kg, render_buffer, rng_state,
+					       sample, x, y, tile.offset, tile.stride);
 				}
 			}
 
@@ -699,8 +781,25 @@ public:
 			}
 		}
 
+		/* Statistics are gathered per thread, the tick rate of the shader
+		 * timings is measured against the wall clock over all tiles. */
+		KernelStats *kernel_stats = NULL;
+		double stats_start_time = 0.0;
+		uint64_t stats_start_ticks = 0;
+
+		if(task.kernel_stats) {
+			kernel_stats = new KernelStats();
+			kernel_stats->reset(kernel_globals.__shader_flag.width / SHADER_SIZE);
+			kg->stats = kernel_stats;
+
+			stats_start_time = time_dt();
+			stats_start_ticks = stats_ticks();
+		}
+
 		RenderTile tile;
 		while(task.acquire_tile(this, tile)) {
+			double start_time = time_dt();
+
 			if(tile.task == RenderTile::PATH_TRACE) {
 				if(use_split_kernel) {
 					device_memory data;
@@ -709,9 +808,11 @@ public:
 				else {
 					path_trace(task, tile, kg);
 				}
+				stats.time_add(STATS_TIME_PATH_TRACE, time_dt() - start_time);
 			}
 			else if(tile.task == RenderTile::DENOISE) {
 				denoise(task, tile);
+				stats.time_add(STATS_TIME_DENOISE, time_dt() - start_time);
 			}
 
 			task.release_tile(tile);
@@ -722,6 +823,14 @@ public:
 			}
 		}
 
+		if(kernel_stats) {
+			double elapsed = time_dt() - stats_start_time;
+			uint64_t ticks = stats_ticks() - stats_start_ticks;
+
+			stats.kernel_add(*kernel_stats, (elapsed > 0.0)? ticks / elapsed: 0.0);
+			delete kernel_stats;
+		}
+
 		thread_kernel_globals_free((KernelGlobals*)kgbuffer.device_pointer);
 		kg->~KernelGlobals();
 		mem_free(kgbuffer);
@@ -821,6 +930,7 @@ protected:
 			kg.decoupled_volume_steps[i] = NULL;
 		}
 		kg.decoupled_volume_steps_index = 0;
+		kg.stats = NULL;
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
@@ -25,6 +25,26 @@
 
 CCL_NAMESPACE_BEGIN
 
+static bool network_compression = true;
+static bool network_compression_init = false;
+
+void network_compression_set(bool use_compression)
+{
+	network_compression = use_compression;
+	network_compression_init = true;
+}
+
+bool network_compression_get()
+{
+	if(!network_compression_init) {
+		const char *value = getenv("CYCLES_NETWORK_COMPRESSION");
+		network_compression = !(value && strcmp(value, "0") == 0);
+		network_compression_init = true;
+	}
+
+	return network_compression;
+}
+
 typedef map<device_ptr, device_ptr> PtrMap;
 typedef vector<uint8_t> DataVector;
 typedef map<device_ptr, DataVector> DataMap;
@@ -46,6 +66,7 @@ class NetworkDevice : public Device
 public:
 	boost::asio::io_service io_service;
 	tcp::socket socket;
+	NetworkSendQueue *send_queue;
 	device_ptr mem_counter;
 	DeviceTask the_task; /* todo: handle multiple tasks */
 
@@ -78,13 +99,19 @@ public:
 		if(error)
 			error_func.network_error(error.message());
 
+		/* requests which don't need a reply are queued, so several of them
+		 * can be in flight while the next one is being prepared */
+		send_queue = new NetworkSendQueue(socket, &error_func);
+
 		mem_counter = 0;
 	}
 
 	~NetworkDevice()
 	{
-		RPCSend snd(socket, &error_func, "stop");
+		RPCSend snd(*send_queue, &error_func, "stop");
 		snd.write();
+
+		delete send_queue;
 	}
 
 	void mem_alloc(const char *name, device_memory& mem, MemoryType type)
@@ -99,7 +126,7 @@ public:
 
 		mem.device_pointer = ++mem_counter;
 
-		RPCSend snd(socket, &error_func, "mem_alloc");
+		RPCSend snd(*send_queue, &error_func, "mem_alloc");
 
 		snd.add(mem);
 		snd.add(type);
@@ -110,7 +137,7 @@ public:
 	{
 		thread_scoped_lock lock(rpc_lock);
 
-		RPCSend snd(socket, &error_func, "mem_copy_to");
+		RPCSend snd(*send_queue, &error_func, "mem_copy_to");
 
 		snd.add(mem);
 		snd.write();
@@ -123,7 +150,7 @@ public:
 
 		size_t data_size = mem.memory_size();
 
-		RPCSend snd(socket, &error_func, "mem_copy_from");
+		RPCSend snd(*send_queue, &error_func, "mem_copy_from");
 
 		snd.add(mem);
 		snd.add(y);
@@ -140,7 +167,7 @@ public:
 	{
 		thread_scoped_lock lock(rpc_lock);
 
-		RPCSend snd(socket, &error_func, "mem_zero");
+		RPCSend snd(*send_queue, &error_func, "mem_zero");
 
 		snd.add(mem);
 		snd.write();
@@ -151,7 +178,7 @@ public:
 		if(mem.device_pointer) {
 			thread_scoped_lock lock(rpc_lock);
 
-			RPCSend snd(socket, &error_func, "mem_free");
+			RPCSend snd(*send_queue, &error_func, "mem_free");
 
 			snd.add(mem);
 			snd.write();
@@ -164,7 +191,7 @@ public:
 	{
 		thread_scoped_lock lock(rpc_lock);
 
-		RPCSend snd(socket, &error_func, "const_copy_to");
+		RPCSend snd(*send_queue, &error_func, "const_copy_to");
 
 		string name_string(name);
 
@@ -187,7 +214,7 @@ public:
 
 		mem.device_pointer = ++mem_counter;
 
-		RPCSend snd(socket, &error_func, "tex_alloc");
+		RPCSend snd(*send_queue, &error_func, "tex_alloc");
 
 		string name_string(name);
 
@@ -204,7 +231,7 @@ public:
 		if(mem.device_pointer) {
 			thread_scoped_lock lock(rpc_lock);
 
-			RPCSend snd(socket, &error_func, "tex_free");
+			RPCSend snd(*send_queue, &error_func, "tex_free");
 
 			snd.add(mem);
 			snd.write();
@@ -220,7 +247,7 @@ public:
 
 		thread_scoped_lock lock(rpc_lock);
 
-		RPCSend snd(socket, &error_func, "load_kernels");
+		RPCSend snd(*send_queue, &error_func, "load_kernels");
 		snd.add(requested_features.experimental);
 		snd.add(requested_features.max_closure);
 		snd.add(requested_features.max_nodes_group);
@@ -240,7 +267,7 @@ public:
 
 		the_task = task;
 
-		RPCSend snd(socket, &error_func, "task_add");
+		RPCSend snd(*send_queue, &error_func, "task_add");
 		snd.add(task);
 		snd.write();
 	}
@@ -249,7 +276,7 @@ public:
 	{
 		thread_scoped_lock lock(rpc_lock);
 
-		RPCSend snd(socket, &error_func, "task_wait");
+		RPCSend snd(*send_queue, &error_func, "task_wait");
 		snd.write();
 
 		lock.unlock();
@@ -274,14 +301,14 @@ public:
 					the_tiles.push_back(tile);
 
 					lock.lock();
-					RPCSend snd(socket, &error_func, "acquire_tile");
+					RPCSend snd(*send_queue, &error_func, "acquire_tile");
 					snd.add(tile);
 					snd.write();
 					lock.unlock();
 				}
 				else {
 					lock.lock();
-					RPCSend snd(socket, &error_func, "acquire_tile_none");
+					RPCSend snd(*send_queue, &error_func, "acquire_tile_none");
 					snd.write();
 					lock.unlock();
 				}
@@ -301,7 +328,7 @@ public:
 				the_task.release_tile(tile);
 
 				lock.lock();
-				RPCSend snd(socket, &error_func, "release_tile");
+				RPCSend snd(*send_queue, &error_func, "release_tile");
 				snd.write();
 				lock.unlock();
 			}
@@ -317,7 +344,7 @@ public:
 	void task_cancel()
 	{
 		thread_scoped_lock lock(rpc_lock);
-		RPCSend snd(socket, &error_func, "task_cancel");
+		RPCSend snd(*send_queue, &error_func, "task_cancel");
 		snd.write();
 	}
 
@@ -344,7 +371,6 @@ void device_network_info(vector<DeviceInfo>& devices)
 	info.id = "NETWORK";
 	info.num = 0;
 	info.advanced_shading = true; /* todo: get this info from device */
-	info.pack_images = false;
 
 	devices.push_back(info);
 }
@@ -371,7 +397,7 @@ public:
 		for(;;) {
 			listen_step();
 
-			if(stop)
+			if(stop || have_error())
 				break;
 		}
 	}
@@ -833,27 +859,32 @@ private:
 
 };
 
+void device_server_accept(Device *device, boost::asio::io_service& io_service, tcp::acceptor& acceptor)
+{
+	/* accept connection */
+	tcp::socket socket(io_service);
+	acceptor.accept(socket);
+
+	string remote_address = socket.remote_endpoint().address().to_string();
+	printf("Connected to remote client at: %s\n", remote_address.c_str());
+
+	DeviceServer server(device, socket);
+	server.listen();
+
+	printf("Disconnected.\n");
+}
+
 void Device::server_run()
 {
 	try {
 		/* starts thread that responds to discovery requests */
 		ServerDiscovery discovery;
 
-		for(;;) {
-			/* accept connection */
-			boost::asio::io_service io_service;
-			tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), SERVER_PORT));
-
-			tcp::socket socket(io_service);
-			acceptor.accept(socket);
-
-			string remote_address = socket.remote_endpoint().address().to_string();
-			printf("Connected to remote client at: %s\n", remote_address.c_str());
+		boost::asio::io_service io_service;
+		tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), SERVER_PORT));
 
-			DeviceServer server(this, socket);
-			server.listen();
-
-			printf("Disconnected.\n");
+		for(;;) {
+			device_server_accept(this, io_service, acceptor);
 		}
 	}
 	catch(exception& e) {
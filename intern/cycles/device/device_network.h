@@ -33,15 +33,27 @@
 #include <sstream>
 #include <deque>
 
+#ifdef WITH_LZO
+#  ifdef WITH_SYSTEM_LZO
+#    include <lzo/lzo1x.h>
+#  else
+#    include "minilzo.h"
+#  endif
+#endif
+
 #include "render/buffers.h"
 
 #include "util/util_foreach.h"
 #include "util/util_list.h"
+#include "util/util_logging.h"
 #include "util/util_map.h"
 #include "util/util_string.h"
+#include "util/util_thread.h"
 
 CCL_NAMESPACE_BEGIN
 
+class Device;
+
 using std::cout;
 using std::cerr;
 using std::hex;
@@ -55,6 +67,14 @@ static const int DISCOVER_PORT = 5121;
 static const string DISCOVER_REQUEST_MSG = "REQUEST_RENDER_SERVER_IP";
 static const string DISCOVER_REPLY_MSG = "REPLY_RENDER_SERVER_IP";
 
+/* Buffers are sent in chunks which are compressed individually, so that
+ * compression and decompression overlap with the transfer itself. */
+static const size_t NETWORK_CHUNK_SIZE = 1024*1024;
+
+/* Maximum number of requests and buffer chunks waiting to be sent on a
+ * client connection, before the device functions block. */
+static const size_t NETWORK_MAX_QUEUED_SENDS = 16;
+
 #if 0
 typedef boost::archive::text_oarchive o_archive;
 typedef boost::archive::text_iarchive i_archive;
@@ -99,16 +119,160 @@ private:
 };
 
 
+/* Compression of buffer chunks, enabled by default. It can be disabled with
+ * CYCLES_NETWORK_COMPRESSION=0 for fast networks where it does not pay off. */
+
+void network_compression_set(bool use_compression);
+bool network_compression_get();
+
+struct NetworkChunkHeader {
+	uint32_t size;
+	/* Equal to size for chunks sent uncompressed. */
+	uint32_t compressed_size;
+};
+
+/* Append a chunk with header to data, compressed if that makes it smaller. */
+static inline void network_chunk_pack(const uint8_t *chunk, size_t size, vector<char>& data)
+{
+	NetworkChunkHeader header;
+	header.size = size;
+	header.compressed_size = size;
+
+	size_t offset = data.size();
+
+#ifdef WITH_LZO
+	if(network_compression_get()) {
+		data.resize(offset + sizeof(header) + size + size/16 + 64 + 3);
+
+		vector<lzo_align_t> wrkmem((LZO1X_1_MEM_COMPRESS + sizeof(lzo_align_t) - 1) / sizeof(lzo_align_t));
+		lzo_uint out_len;
+		int r = lzo1x_1_compress(chunk, size, (uint8_t*)&data[offset + sizeof(header)], &out_len, &wrkmem[0]);
+
+		if(r == LZO_E_OK && out_len < size)
+			header.compressed_size = out_len;
+	}
+#endif
+
+	data.resize(offset + sizeof(header) + header.compressed_size);
+	memcpy(&data[offset], &header, sizeof(header));
+
+	if(header.compressed_size == header.size)
+		memcpy(&data[offset + sizeof(header)], chunk, size);
+}
+
+/* Decode a chunk received with the given header into the output buffer. */
+static inline bool network_chunk_unpack(const NetworkChunkHeader& header, const char *chunk, uint8_t *out)
+{
+	if(header.compressed_size == header.size) {
+		memcpy(out, chunk, header.size);
+		return true;
+	}
+
+#ifdef WITH_LZO
+	lzo_uint out_len = header.size;
+	int r = lzo1x_decompress_safe((const uint8_t*)chunk, header.compressed_size, out, &out_len, NULL);
+	return (r == LZO_E_OK && out_len == header.size);
+#else
+	return false;
+#endif
+}
+
+/* Queue of data to be sent, written to the socket by its own thread so the
+ * caller can prepare the next request or chunk in the meantime. */
+
+class NetworkSendQueue {
+public:
+	NetworkSendQueue(tcp::socket& socket_, NetworkError *e)
+	: socket(socket_), error_func(e), stop(false)
+	{
+		send_thread = new thread(function_bind(&NetworkSendQueue::run, this));
+	}
+
+	~NetworkSendQueue()
+	{
+		/* all queued data is sent before the thread finishes */
+		{
+			thread_scoped_lock lock(mutex);
+			stop = true;
+			cond.notify_all();
+		}
+
+		send_thread->join();
+		delete send_thread;
+	}
+
+	/* takes over the contents of data */
+	void push(vector<char>& data)
+	{
+		thread_scoped_lock lock(mutex);
+
+		while(queue.size() >= NETWORK_MAX_QUEUED_SENDS)
+			cond.wait(lock);
+
+		queue.push_back(vector<char>());
+		queue.back().swap(data);
+		cond.notify_all();
+	}
+
+protected:
+	void run()
+	{
+		thread_scoped_lock lock(mutex);
+
+		for(;;) {
+			while(queue.empty() && !stop)
+				cond.wait(lock);
+
+			if(queue.empty())
+				break;
+
+			vector<char> data;
+			data.swap(queue.front());
+			queue.pop_front();
+			cond.notify_all();
+
+			lock.unlock();
+
+			boost::system::error_code error;
+			boost::asio::write(socket,
+				boost::asio::buffer(data),
+				boost::asio::transfer_all(), error);
+
+			if(error.value())
+				error_func->network_error(error.message());
+
+			lock.lock();
+		}
+	}
+
+	tcp::socket& socket;
+	NetworkError *error_func;
+
+	thread *send_thread;
+	thread_mutex mutex;
+	thread_condition_variable cond;
+	std::deque<vector<char> > queue;
+	bool stop;
+};
+
 /* Remote procedure call Send */
 
 class RPCSend {
 public:
 	RPCSend(tcp::socket& socket_, NetworkError* e, const string& name_ = "")
-	: name(name_), socket(socket_), archive(archive_stream), sent(false)
+	: name(name_), socket(&socket_), queue(NULL), archive(archive_stream), sent(false)
 	{
 		archive & name_;
 		error_func = e;
-		fprintf(stderr, "rpc send %s\n", name.c_str());
+		VLOG(3) << "RPC send " << name;
+	}
+
+	RPCSend(NetworkSendQueue& queue_, NetworkError* e, const string& name_ = "")
+	: name(name_), socket(NULL), queue(&queue_), archive(archive_stream), sent(false)
+	{
+		archive & name_;
+		error_func = e;
+		VLOG(3) << "RPC send " << name;
 	}
 
 	~RPCSend()
@@ -147,49 +311,55 @@ public:
 
 	void write()
 	{
-		boost::system::error_code error;
-
 		/* get string from stream */
 		string archive_str = archive_stream.str();
 
-		/* first send fixed size header with size of following data */
+		/* fixed size header with size of following data */
 		ostringstream header_stream;
 		header_stream << setw(8) << hex << archive_str.size();
 		string header_str = header_stream.str();
 
-		boost::asio::write(socket,
-			boost::asio::buffer(header_str),
-			boost::asio::transfer_all(), error);
-
-		if(error.value())
-			error_func->network_error(error.message());
+		vector<char> data(header_str.begin(), header_str.end());
+		data.insert(data.end(), archive_str.begin(), archive_str.end());
 
-		/* then send actual data */
-		boost::asio::write(socket,
-			boost::asio::buffer(archive_str),
-			boost::asio::transfer_all(), error);
-		
-		if(error.value())
-			error_func->network_error(error.message());
+		output(data);
 
 		sent = true;
 	}
 
 	void write_buffer(void *buffer, size_t size)
 	{
+		for(size_t offset = 0; offset < size; offset += NETWORK_CHUNK_SIZE) {
+			size_t chunk_size = std::min(NETWORK_CHUNK_SIZE, size - offset);
+
+			vector<char> data;
+			network_chunk_pack((uint8_t*)buffer + offset, chunk_size, data);
+
+			output(data);
+		}
+	}
+
+protected:
+	void output(vector<char>& data)
+	{
+		if(queue) {
+			queue->push(data);
+			return;
+		}
+
 		boost::system::error_code error;
 
-		boost::asio::write(socket,
-			boost::asio::buffer(buffer, size),
+		boost::asio::write(*socket,
+			boost::asio::buffer(data),
 			boost::asio::transfer_all(), error);
-		
+
 		if(error.value())
 			error_func->network_error(error.message());
 	}
 
-protected:
 	string name;
-	tcp::socket& socket;
+	tcp::socket *socket;
+	NetworkSendQueue *queue;
 	ostringstream archive_stream;
 	o_archive archive;
 	bool sent;
@@ -237,7 +407,7 @@ public:
 					archive = new i_archive(*archive_stream);
 
 					*archive & name;
-					fprintf(stderr, "rpc receive %s\n", name.c_str());
+					VLOG(3) << "RPC receive " << name;
 				}
 				else {
 					error_func->network_error("Network receive error: data size doesn't match header");
@@ -273,15 +443,40 @@ public:
 
 	void read_buffer(void *buffer, size_t size)
 	{
-		boost::system::error_code error;
-		size_t len = boost::asio::read(socket, boost::asio::buffer(buffer, size), error);
+		vector<char> chunk;
 
-		if(error.value()) {
-			error_func->network_error(error.message());
-		}
+		for(size_t offset = 0; offset < size; offset += NETWORK_CHUNK_SIZE) {
+			size_t chunk_size = std::min(NETWORK_CHUNK_SIZE, size - offset);
 
-		if(len != size)
-			cout << "Network receive error: buffer size doesn't match expected size\n";
+			boost::system::error_code error;
+			NetworkChunkHeader header;
+			size_t len = boost::asio::read(socket, boost::asio::buffer(&header, sizeof(header)), error);
+
+			if(error.value()) {
+				error_func->network_error(error.message());
+				return;
+			}
+
+			if(len != sizeof(header) || header.size != chunk_size || header.compressed_size > chunk_size) {
+				error_func->network_error("Network receive error: buffer size doesn't match expected size");
+				return;
+			}
+
+			chunk.resize(header.compressed_size);
+			len = boost::asio::read(socket, boost::asio::buffer(chunk), error);
+
+			if(error.value()) {
+				error_func->network_error(error.message());
+				return;
+			}
+
+			if(len != header.compressed_size ||
+			   !network_chunk_unpack(header, (chunk.size())? &chunk[0]: NULL, (uint8_t*)buffer + offset))
+			{
+				error_func->network_error("Network receive error: corrupted buffer chunk");
+				return;
+			}
+		}
 	}
 
 	void read(DeviceTask& task)
@@ -318,6 +513,10 @@ protected:
 	NetworkError *error_func;
 };
 
+/* Accept a single client connection and serve it until the client disconnects. */
+
+void device_server_accept(Device *device, boost::asio::io_service& io_service, tcp::acceptor& acceptor);
+
 /* Server auto discovery */
 
 class ServerDiscovery {
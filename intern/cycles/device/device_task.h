@@ -78,6 +78,8 @@ public:
 
 	bool need_finish_queue;
 	bool integrator_branched;
+	/* Gather kernel statistics into the device Stats, CPU only. */
+	bool kernel_stats;
 	int2 requested_tile_size;
 protected:
 	double last_update_time;
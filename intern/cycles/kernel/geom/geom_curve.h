@@ -113,8 +113,8 @@ ccl_device float curve_thickness(KernelGlobals *kg, ShaderData *sd)
 		float4 P_curve[2];
 
 		if(sd->type & PRIMITIVE_CURVE) {
-			P_curve[0]= kernel_tex_fetch(__curve_keys, k0);
-			P_curve[1]= kernel_tex_fetch(__curve_keys, k1);
+			P_curve[0]= curve_key(kg, sd->prim, k0);
+			P_curve[1]= curve_key(kg, sd->prim, k1);
 		}
 		else {
 			motion_curve_keys(kg, sd->object, sd->prim, sd->time, k0, k1, P_curve);
@@ -137,8 +137,8 @@ ccl_device float3 curve_motion_center_location(KernelGlobals *kg, ShaderData *sd
 
 	float4 P_curve[2];
 
-	P_curve[0]= kernel_tex_fetch(__curve_keys, k0);
-	P_curve[1]= kernel_tex_fetch(__curve_keys, k1);
+	P_curve[0]= curve_key(kg, sd->prim, k0);
+	P_curve[1]= curve_key(kg, sd->prim, k1);
 
 	return float4_to_float3(P_curve[1]) * sd->u + float4_to_float3(P_curve[0]) * (1.0f - sd->u);
 }
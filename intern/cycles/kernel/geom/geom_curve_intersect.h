@@ -84,8 +84,12 @@ ccl_device_curveintersect bool cardinal_curve_intersect(
 #if defined(__KERNEL_AVX2__) && defined(__KERNEL_SSE__) && (!defined(_MSC_VER) || _MSC_VER > 1800)
 		avxf P_curve_0_1, P_curve_2_3;
 		if(is_curve_primitive) {
-			P_curve_0_1 = _mm256_loadu2_m128(&kg->__curve_keys.data[k0].x, &kg->__curve_keys.data[ka].x);
-			P_curve_2_3 = _mm256_loadu2_m128(&kg->__curve_keys.data[kb].x, &kg->__curve_keys.data[k1].x);
+			float4 keys[4] = {curve_key(kg, prim, ka),
+			                  curve_key(kg, prim, k0),
+			                  curve_key(kg, prim, k1),
+			                  curve_key(kg, prim, kb)};
+			P_curve_0_1 = _mm256_loadu2_m128(&keys[1].x, &keys[0].x);
+			P_curve_2_3 = _mm256_loadu2_m128(&keys[3].x, &keys[2].x);
 		}
 		else {
 			int fobject = (object == OBJECT_NONE) ? kernel_tex_fetch(__prim_object, curveAddr) : object;
@@ -95,10 +99,10 @@ ccl_device_curveintersect bool cardinal_curve_intersect(
 		ssef P_curve[4];
 
 		if(is_curve_primitive) {
-			P_curve[0] = load4f(&kg->__curve_keys.data[ka].x);
-			P_curve[1] = load4f(&kg->__curve_keys.data[k0].x);
-			P_curve[2] = load4f(&kg->__curve_keys.data[k1].x);
-			P_curve[3] = load4f(&kg->__curve_keys.data[kb].x);
+			P_curve[0] = load4f(curve_key(kg, prim, ka));
+			P_curve[1] = load4f(curve_key(kg, prim, k0));
+			P_curve[2] = load4f(curve_key(kg, prim, k1));
+			P_curve[3] = load4f(curve_key(kg, prim, kb));
 		}
 		else {
 			int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -190,10 +194,10 @@ ccl_device_curveintersect bool cardinal_curve_intersect(
 		float4 P_curve[4];
 
 		if(is_curve_primitive) {
-			P_curve[0] = kernel_tex_fetch(__curve_keys, ka);
-			P_curve[1] = kernel_tex_fetch(__curve_keys, k0);
-			P_curve[2] = kernel_tex_fetch(__curve_keys, k1);
-			P_curve[3] = kernel_tex_fetch(__curve_keys, kb);
+			P_curve[0] = curve_key(kg, prim, ka);
+			P_curve[1] = curve_key(kg, prim, k0);
+			P_curve[2] = curve_key(kg, prim, k1);
+			P_curve[3] = curve_key(kg, prim, kb);
 		}
 		else {
 			int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -549,8 +553,8 @@ ccl_device_curveintersect bool curve_intersect(KernelGlobals *kg,
 	float4 P_curve[2];
 
 	if(is_curve_primitive) {
-		P_curve[0] = kernel_tex_fetch(__curve_keys, k0);
-		P_curve[1] = kernel_tex_fetch(__curve_keys, k1);
+		P_curve[0] = curve_key(kg, prim, k0);
+		P_curve[1] = curve_key(kg, prim, k1);
 	}
 	else {
 		int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -584,8 +588,8 @@ ccl_device_curveintersect bool curve_intersect(KernelGlobals *kg,
 	ssef P_curve[2];
 
 	if(is_curve_primitive) {
-		P_curve[0] = load4f(&kg->__curve_keys.data[k0].x);
-		P_curve[1] = load4f(&kg->__curve_keys.data[k1].x);
+		P_curve[0] = load4f(curve_key(kg, prim, k0));
+		P_curve[1] = load4f(curve_key(kg, prim, k1));
 	}
 	else {
 		int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -821,10 +825,10 @@ ccl_device_inline float3 curve_refine(KernelGlobals *kg,
 		float4 P_curve[4];
 
 		if(sd->type & PRIMITIVE_CURVE) {
-			P_curve[0] = kernel_tex_fetch(__curve_keys, ka);
-			P_curve[1] = kernel_tex_fetch(__curve_keys, k0);
-			P_curve[2] = kernel_tex_fetch(__curve_keys, k1);
-			P_curve[3] = kernel_tex_fetch(__curve_keys, kb);
+			P_curve[0] = curve_key(kg, prim, ka);
+			P_curve[1] = curve_key(kg, prim, k0);
+			P_curve[2] = curve_key(kg, prim, k1);
+			P_curve[3] = curve_key(kg, prim, kb);
 		}
 		else {
 			motion_cardinal_curve_keys(kg, sd->object, sd->prim, sd->time, ka, k0, k1, kb, P_curve);
@@ -871,8 +875,8 @@ ccl_device_inline float3 curve_refine(KernelGlobals *kg,
 		float4 P_curve[2];
 
 		if(sd->type & PRIMITIVE_CURVE) {
-			P_curve[0]= kernel_tex_fetch(__curve_keys, k0);
-			P_curve[1]= kernel_tex_fetch(__curve_keys, k1);
+			P_curve[0]= curve_key(kg, prim, k0);
+			P_curve[1]= curve_key(kg, prim, k1);
 		}
 		else {
 			motion_curve_keys(kg, sd->object, sd->prim, sd->time, k0, k1, P_curve);
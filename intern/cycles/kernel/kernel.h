@@ -65,6 +65,24 @@ void kernel_tex_copy(KernelGlobals *kg,
 #define KERNEL_ARCH cpu_avx2
 #include "kernel/kernels/cpu/kernel_cpu.h"
 
+#define KERNEL_ARCH cpu_stats
+#include "kernel/kernels/cpu/kernel_cpu.h"
+
+#define KERNEL_ARCH cpu_stats_sse2
+#include "kernel/kernels/cpu/kernel_cpu.h"
+
+#define KERNEL_ARCH cpu_stats_sse3
+#include "kernel/kernels/cpu/kernel_cpu.h"
+
+#define KERNEL_ARCH cpu_stats_sse41
+#include "kernel/kernels/cpu/kernel_cpu.h"
+
+#define KERNEL_ARCH cpu_stats_avx
+#include "kernel/kernels/cpu/kernel_cpu.h"
+
+#define KERNEL_ARCH cpu_stats_avx2
+#include "kernel/kernels/cpu/kernel_cpu.h"
+
 CCL_NAMESPACE_END
 
 #endif /* __KERNEL_H__ */
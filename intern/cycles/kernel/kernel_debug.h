@@ -51,6 +51,14 @@ ccl_device_inline void kernel_write_debug_passes(KernelGlobals *kg,
 		                        sample,
 		                        debug_data->num_ray_bounces);
 	}
+#ifdef __KERNEL_STATS__
+	if((flag & PASS_SHADER_TIME) && kg->stats) {
+		/* In thousands of ticks, to stay in float precision. */
+		kernel_write_pass_float(buffer + kernel_data.film.pass_shader_time,
+		                        sample,
+		                        kg->stats->path_shader_ticks * 1e-3f);
+	}
+#endif
 }
 
 CCL_NAMESPACE_END
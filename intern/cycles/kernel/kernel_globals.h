@@ -44,6 +44,14 @@ struct OSLShadingSystem;
 
 struct Intersection;
 struct VolumeStep;
+struct KernelGlobals;
+struct KernelStats;
+
+/* Shader program baked into native code, see svm_bake.cpp. */
+typedef void (*SVMBakedFunction)(KernelGlobals *kg,
+                                 ShaderData *sd,
+                                 PathState *state,
+                                 int path_flag);
 
 typedef struct KernelGlobals {
 	vector<texture_image_float4> texture_float4_images;
@@ -59,6 +67,13 @@ typedef struct KernelGlobals {
 
 	KernelData __data;
 
+	/* Baked shader programs, indexed by shader and shader type. These are
+	 * compiled without OSL, so must be placed before the OSL members. */
+	const SVMBakedFunction *svm_baked;
+
+	/* Counters of the statistics mode, NULL when disabled. */
+	KernelStats *stats;
+
 #  ifdef __OSL__
 	/* On the CPU, we also have the OSL globals here. Most data structures are shared
 	 * with SVM, the difference is in the shaders and object/mesh attributes. */
@@ -128,6 +128,10 @@ ccl_device void kernel_path_indirect(KernelGlobals *kg,
 		                           NULL,
 		                           0.0f, 0.0f);
 
+#ifdef __KERNEL_STATS__
+		kernel_stats_ray(kg, state, &isect);
+#endif
+
 #ifdef __LAMP_MIS__
 		if(kernel_data.integrator.use_lamp_mis && !(state->flag & PATH_RAY_CAMERA)) {
 			/* ray starting from previous non-transparent bounce */
@@ -459,6 +463,10 @@ ccl_device_inline float kernel_path_integrate(KernelGlobals *kg,
 	debug_data_init(&debug_data);
 #endif  /* __KERNEL_DEBUG__ */
 
+#ifdef __KERNEL_STATS__
+	kernel_stats_path_begin(kg);
+#endif
+
 #ifdef __SUBSURFACE__
 	SubsurfaceIndirectRays ss_indirect;
 	kernel_path_subsurface_init_indirect(&ss_indirect);
@@ -497,6 +505,10 @@ ccl_device_inline float kernel_path_integrate(KernelGlobals *kg,
 		bool hit = scene_intersect(kg, ray, visibility, &isect, NULL, 0.0f, 0.0f);
 #endif  /* __HAIR__ */
 
+#ifdef __KERNEL_STATS__
+		kernel_stats_ray(kg, &state, &isect);
+#endif
+
 #ifdef __KERNEL_DEBUG__
 		if(state.flag & PATH_RAY_CAMERA) {
 			debug_data.num_bvh_traversed_nodes += isect.num_traversed_nodes;
@@ -289,6 +289,10 @@ ccl_device float kernel_branched_path_integrate(KernelGlobals *kg,
 	debug_data_init(&debug_data);
 #endif  /* __KERNEL_DEBUG__ */
 
+#ifdef __KERNEL_STATS__
+	kernel_stats_path_begin(kg);
+#endif
+
 	/* Main Loop
 	 * Here we only handle transparency intersections from the camera ray.
 	 * Indirect bounces are handled in kernel_branched_path_surface_indirect_light().
@@ -318,6 +322,10 @@ ccl_device float kernel_branched_path_integrate(KernelGlobals *kg,
 		bool hit = scene_intersect(kg, ray, visibility, &isect, NULL, 0.0f, 0.0f);
 #endif  /* __HAIR__ */
 
+#ifdef __KERNEL_STATS__
+		kernel_stats_ray(kg, &state, &isect);
+#endif
+
 #ifdef __KERNEL_DEBUG__
 		debug_data.num_bvh_traversed_nodes += isect.num_traversed_nodes;
 		debug_data.num_bvh_traversed_instances += isect.num_traversed_instances;
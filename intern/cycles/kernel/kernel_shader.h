@@ -31,6 +31,10 @@
 
 #include "kernel/svm/svm.h"
 
+#ifdef __KERNEL_STATS__
+#  include "kernel/kernel_stats.h"
+#endif
+
 CCL_NAMESPACE_BEGIN
 
 /* ShaderData setup from incoming ray */
@@ -870,6 +874,10 @@ ccl_device void shader_eval_surface(KernelGlobals *kg, ShaderData *sd, RNG *rng,
 	sd->num_closure_extra = 0;
 	sd->randb_closure = randb;
 
+#ifdef __KERNEL_STATS__
+	uint64_t stats_start = kernel_stats_shader_begin(kg);
+#endif
+
 #ifdef __OSL__
 	if(kg->osl)
 		OSLShader::eval_surface(kg, sd, state, path_flag, ctx);
@@ -887,6 +895,10 @@ ccl_device void shader_eval_surface(KernelGlobals *kg, ShaderData *sd, RNG *rng,
 #endif
 	}
 
+#ifdef __KERNEL_STATS__
+	kernel_stats_shader_end(kg, sd->shader, stats_start);
+#endif
+
 	if(rng && (sd->flag & SD_BSDF_NEEDS_LCG)) {
 		sd->lcg_state = lcg_state_init(rng, state->rng_offset, state->sample, 0xb4bc3953);
 	}
@@ -902,6 +914,10 @@ ccl_device float3 shader_eval_background(KernelGlobals *kg, ShaderData *sd,
 	sd->randb_closure = 0.0f;
 
 #ifdef __SVM__
+#ifdef __KERNEL_STATS__
+	uint64_t stats_start = kernel_stats_shader_begin(kg);
+#endif
+
 #ifdef __OSL__
 	if(kg->osl) {
 		OSLShader::eval_background(kg, sd, state, path_flag, ctx);
@@ -912,6 +928,10 @@ ccl_device float3 shader_eval_background(KernelGlobals *kg, ShaderData *sd,
 		svm_eval_nodes(kg, sd, state, SHADER_TYPE_SURFACE, path_flag);
 	}
 
+#ifdef __KERNEL_STATS__
+	kernel_stats_shader_end(kg, sd->shader, stats_start);
+#endif
+
 	float3 eval = make_float3(0.0f, 0.0f, 0.0f);
 
 	for(int i = 0; i < sd->num_closure; i++) {
@@ -1071,6 +1091,10 @@ ccl_device_inline void shader_eval_volume(KernelGlobals *kg,
 
 		/* evaluate shader */
 #ifdef __SVM__
+#  ifdef __KERNEL_STATS__
+		uint64_t stats_start = kernel_stats_shader_begin(kg);
+#  endif
+
 #  ifdef __OSL__
 		if(kg->osl) {
 			OSLShader::eval_volume(kg, sd, state, path_flag, ctx);
@@ -1080,6 +1104,10 @@ ccl_device_inline void shader_eval_volume(KernelGlobals *kg,
 		{
 			svm_eval_nodes(kg, sd, state, SHADER_TYPE_VOLUME, path_flag);
 		}
+
+#  ifdef __KERNEL_STATS__
+		kernel_stats_shader_end(kg, sd->shader, stats_start);
+#  endif
 #endif
 
 		/* merge closures to avoid exceeding number of closures limit */
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Statistics mode of the CPU kernel.
+ *
+ * Only used by the kernels compiled with __KERNEL_STATS__, which the device
+ * picks for statistics mode and debug passes. When the kernel globals have a
+ * KernelStats, rays are counted per type and bounce, traversal counters of
+ * the intersections are summed up and the time of every shader evaluation is
+ * measured with the CPU timestamp counter. */
+
+#ifndef __KERNEL_STATS_H__
+#define __KERNEL_STATS_H__
+
+#include "util/util_stats.h"
+
+CCL_NAMESPACE_BEGIN
+
+ccl_device_inline StatsRay kernel_stats_ray_type(int path_flag)
+{
+	if(path_flag & PATH_RAY_CAMERA)
+		return STATS_RAY_CAMERA;
+	else if(path_flag & PATH_RAY_VOLUME_SCATTER)
+		return STATS_RAY_VOLUME;
+	else if(path_flag & PATH_RAY_TRANSMIT)
+		return STATS_RAY_TRANSMIT;
+	else
+		return STATS_RAY_REFLECT;
+}
+
+/* Count a path ray and the BVH work to intersect it. */
+ccl_device_inline void kernel_stats_ray(KernelGlobals *kg,
+                                        ccl_addr_space PathState *state,
+                                        const Intersection *isect)
+{
+	KernelStats *stats = kg->stats;
+	if(stats == NULL) {
+		return;
+	}
+
+	int bounce = min(state->bounce, STATS_MAX_BOUNCES - 1);
+	stats->rays[kernel_stats_ray_type(state->flag)][bounce]++;
+	stats->bvh_traversed_nodes += isect->num_traversed_nodes;
+	stats->bvh_traversed_instances += isect->num_traversed_instances;
+	stats->bvh_intersections += isect->num_intersections;
+}
+
+ccl_device_inline void kernel_stats_shadow_ray(KernelGlobals *kg,
+                                               ccl_addr_space PathState *state)
+{
+	KernelStats *stats = kg->stats;
+	if(stats == NULL) {
+		return;
+	}
+
+	int bounce = min(state->bounce, STATS_MAX_BOUNCES - 1);
+	stats->rays[STATS_RAY_SHADOW][bounce]++;
+}
+
+/* Shader evaluations are timed between these two calls. */
+ccl_device_inline uint64_t kernel_stats_shader_begin(KernelGlobals *kg)
+{
+	return (kg->stats)? stats_ticks(): 0;
+}
+
+ccl_device_inline void kernel_stats_shader_end(KernelGlobals *kg, int shader, uint64_t start)
+{
+	KernelStats *stats = kg->stats;
+	if(stats == NULL) {
+		return;
+	}
+
+	uint64_t ticks = stats_ticks() - start;
+	int id = shader & SHADER_MASK;
+
+	if(id < (int)stats->shader_ticks.size()) {
+		stats->shader_ticks[id] += ticks;
+		stats->shader_evals[id]++;
+	}
+	stats->path_shader_ticks += ticks;
+}
+
+/* Shader time of the path is kept for the heatmap pass, which is
+ * written along with the debug passes. */
+ccl_device_inline void kernel_stats_path_begin(KernelGlobals *kg)
+{
+	if(kg->stats) {
+		kg->stats->path_shader_ticks = 0;
+	}
+}
+
+CCL_NAMESPACE_END
+
+#endif /* __KERNEL_STATS_H__ */
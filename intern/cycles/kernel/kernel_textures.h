@@ -48,6 +48,8 @@ KERNEL_TEX(float2, texture_float2, __tri_patch_uv)
 /* curves */
 KERNEL_TEX(float4, texture_float4, __curves)
 KERNEL_TEX(float4, texture_float4, __curve_keys)
+KERNEL_TEX(uint, texture_uint, __curve_keys_compact)
+KERNEL_TEX(float4, texture_float4, __curve_bounds)
 
 /* patches */
 KERNEL_TEX(uint, texture_uint, __patches)
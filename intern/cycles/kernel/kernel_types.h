@@ -95,6 +95,9 @@ CCL_NAMESPACE_BEGIN
 #  define __SHADOW_RECORD_ALL__
 #  define __VOLUME_DECOUPLED__
 #  define __VOLUME_RECORD_ALL__
+#  ifndef __SPLIT_KERNEL__
+#    define __SVM_BAKED__
+#  endif
 #endif  /* __KERNEL_CPU__ */
 
 #ifdef __KERNEL_CUDA__
@@ -199,7 +202,9 @@ CCL_NAMESPACE_BEGIN
 #  define __BAKING__
 #endif
 
-#ifdef WITH_CYCLES_DEBUG
+/* Statistics kernels are compiled separately on the CPU (see kernel_stats.cpp),
+ * with traversal counters and debug passes also in builds without debug. */
+#if defined(WITH_CYCLES_DEBUG) || defined(__KERNEL_STATS__)
 #  define __KERNEL_DEBUG__
 #endif
 
@@ -398,12 +403,12 @@ typedef enum PassType {
 	PASS_SUBSURFACE_INDIRECT = (1 << 23),
 	PASS_SUBSURFACE_COLOR = (1 << 24),
 	PASS_LIGHT = (1 << 25), /* no real pass, used to force use_light_pass */
-#ifdef __KERNEL_DEBUG__
+	/* Only written by kernels with __KERNEL_DEBUG__ or __KERNEL_STATS__. */
 	PASS_BVH_TRAVERSED_NODES = (1 << 26),
 	PASS_BVH_TRAVERSED_INSTANCES = (1 << 27),
 	PASS_BVH_INTERSECTIONS = (1 << 28),
 	PASS_RAY_BOUNCES = (1 << 29),
-#endif
+	PASS_SHADER_TIME = (1 << 30),
 } PassType;
 
 #define PASS_ALL (~0)
@@ -1197,12 +1202,13 @@ typedef struct KernelFilm {
 	int denoising_flags;
 	int pad;
 
-#ifdef __KERNEL_DEBUG__
 	int pass_bvh_traversed_nodes;
 	int pass_bvh_traversed_instances;
 	int pass_bvh_intersections;
 	int pass_ray_bounces;
-#endif
+
+	int pass_shader_time;
+	int pass_pad3, pass_pad4, pass_pad5;
 } KernelFilm;
 static_assert_align(KernelFilm, 16);
 
@@ -1315,6 +1321,7 @@ typedef enum CurveFlag {
 	CURVE_KN_INTERSECTCORRECTION = 16,		/* correct for width after determing closest midpoint? */
 	CURVE_KN_TRUETANGENTGNORMAL = 32,		/* use tangent normal for geometry? */
 	CURVE_KN_RIBBONS = 64,					/* use flat curve ribbons */
+	CURVE_KN_COMPACT_KEYS = 128,			/* keys quantized to 16 bits? */
 } CurveFlag;
 
 typedef struct KernelCurves {
@@ -191,6 +191,16 @@ CCL_NAMESPACE_BEGIN
 /* Main Interpreter Loop */
 ccl_device_noinline void svm_eval_nodes(KernelGlobals *kg, ShaderData *sd, ccl_addr_space PathState *state, ShaderType type, int path_flag)
 {
+#ifdef __SVM_BAKED__
+	if(kg->svm_baked != NULL && type <= SHADER_TYPE_DISPLACEMENT) {
+		SVMBakedFunction baked = kg->svm_baked[(sd->shader & SHADER_MASK)*SVM_BAKED_NUM_TYPES + type];
+		if(baked != NULL) {
+			baked(kg, sd, state, path_flag);
+			return;
+		}
+	}
+#endif
+
 	float stack[SVM_STACK_SIZE];
 	int offset = sd->shader & SHADER_MASK;
 
@@ -385,6 +385,9 @@ typedef enum ShaderType {
 	SHADER_TYPE_BUMP,
 } ShaderType;
 
+/* Shader types with their own program, baked shaders are indexed by these. */
+#define SVM_BAKED_NUM_TYPES (SHADER_TYPE_DISPLACEMENT + 1)
+
 /* Closure */
 
 typedef enum ClosureType {
@@ -44,6 +44,7 @@ BufferParams::BufferParams()
 
 	denoising_data_pass = false;
 	denoising_clean_pass = false;
+	half_storage = false;
 
 	Pass::add(PASS_COMBINED, passes);
 }
@@ -90,6 +91,44 @@ int BufferParams::get_denoising_offset()
 	return offset;
 }
 
+/* Flags each component of a pixel that may be stored in half float,
+ * returns the number of such components. */
+int BufferParams::get_half_components(array<bool>& half_components)
+{
+	int pass_stride = get_passes_size();
+	int num_half = 0;
+
+	half_components.resize(pass_stride);
+	for(int i = 0; i < pass_stride; i++)
+		half_components[i] = false;
+
+	if(!half_storage)
+		return 0;
+
+	int offset = 0;
+	for(size_t i = 0; i < passes.size(); i++) {
+		for(int j = 0; j < passes[i].components; j++)
+			half_components[offset + j] = passes[i].half_storage;
+		offset += passes[i].components;
+	}
+
+	if(denoising_data_pass) {
+		/* Normal, albedo and shadow features and their variances are
+		 * bounded and stored in half float. Depth and the noisy color are
+		 * what the filter is most sensitive to and stay in float. */
+		for(int j = DENOISING_PASS_NORMAL; j < DENOISING_PASS_DEPTH; j++)
+			half_components[offset + j] = true;
+		for(int j = DENOISING_PASS_SHADOW_A; j < DENOISING_PASS_COLOR; j++)
+			half_components[offset + j] = true;
+	}
+
+	for(int i = 0; i < pass_stride; i++)
+		if(half_components[i])
+			num_half++;
+
+	return num_half;
+}
+
 /* Render Buffer Task */
 
 RenderTile::RenderTile()
@@ -118,6 +157,9 @@ RenderTile::RenderTile()
 RenderBuffers::RenderBuffers(Device *device_)
 {
 	device = device_;
+	packed = false;
+	packed_scale = 1.0f;
+	map_count = 0;
 }
 
 RenderBuffers::~RenderBuffers()
@@ -128,6 +170,7 @@ RenderBuffers::~RenderBuffers()
 void RenderBuffers::device_free()
 {
 	if(buffer.device_pointer) {
+		device->stats.buffer_mem_free(buffer.memory_size());
 		device->mem_free(buffer);
 		buffer.clear();
 	}
@@ -136,6 +179,29 @@ void RenderBuffers::device_free()
 		device->mem_free(rng_state);
 		rng_state.clear();
 	}
+
+	packed_free();
+}
+
+void RenderBuffers::packed_free()
+{
+	if(!packed)
+		return;
+
+	size_t size = packed_half.size()*sizeof(half) + packed_float.size()*sizeof(float);
+	device->stats.mem_free(size);
+	device->stats.buffer_mem_free(size);
+
+	packed_half.clear();
+	packed_float.clear();
+	packed = false;
+}
+
+size_t RenderBuffers::memory_size()
+{
+	if(packed)
+		return packed_half.size()*sizeof(half) + packed_float.size()*sizeof(float);
+	return buffer.memory_size();
 }
 
 void RenderBuffers::reset(Device *device, BufferParams& params_)
@@ -149,6 +215,7 @@ void RenderBuffers::reset(Device *device, BufferParams& params_)
 	buffer.resize(params.width*params.height*params.get_passes_size());
 	device->mem_alloc("render_buffer", buffer, MEM_READ_WRITE);
 	device->mem_zero(buffer);
+	device->stats.buffer_mem_alloc(buffer.memory_size());
 
 	/* allocate rng state */
 	rng_state.resize(params.width, params.height);
@@ -156,8 +223,161 @@ void RenderBuffers::reset(Device *device, BufferParams& params_)
 	device->mem_alloc("rng_state", rng_state, MEM_READ_WRITE);
 }
 
+/* Conversion for packed storage. Unlike the kernel's float_to_half() this
+ * rounds to nearest and keeps denormals, so small per-sample averages like
+ * feature variances don't become zero and packing a buffer that was unpacked
+ * before gives back the same values. */
+static half pack_float_to_half(float f)
+{
+	uint u = __float_as_uint(f);
+	uint sign = (u >> 16) & 0x8000;
+	uint h;
+
+	u &= 0x7fffffff;
+
+	if(u >= 0x477ff000) {
+		/* Clamp to the largest finite half, NaN becomes zero. */
+		return (u > 0x7f800000)? 0: (half)(sign | 0x7bff);
+	}
+	else if(u >= 0x38800000) {
+		/* Normal, re-bias the exponent and round the mantissa. */
+		uint rest = u & 0x1fff;
+		h = (u - 0x38000000) >> 13;
+		if(rest > 0x1000 || (rest == 0x1000 && (h & 1)))
+			h++;
+	}
+	else if(u >= 0x33000000) {
+		/* Denormal. */
+		uint mantissa = (u & 0x7fffff) | 0x800000;
+		uint shift = 126 - (u >> 23);
+		uint rest = mantissa & ((1u << shift) - 1);
+		uint halfway = 1u << (shift - 1);
+		h = mantissa >> shift;
+		if(rest > halfway || (rest == halfway && (h & 1)))
+			h++;
+	}
+	else {
+		h = 0;
+	}
+
+	return (half)(sign | h);
+}
+
+static float pack_half_to_float(half h)
+{
+	uint sign = ((uint)h & 0x8000) << 16;
+	uint exponent = ((uint)h >> 10) & 0x1f;
+	uint mantissa = (uint)h & 0x3ff;
+
+	if(exponent == 0) {
+		float f = (float)mantissa*(1.0f/16777216.0f);
+		return sign? -f: f;
+	}
+
+	return __uint_as_float(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+void RenderBuffers::pack(int sample)
+{
+	if(packed || !buffer.device_pointer || !params.half_storage)
+		return;
+
+	array<bool> half_components;
+	int num_half = params.get_half_components(half_components);
+	if(num_half == 0)
+		return;
+
+	copy_from_device();
+
+	int pass_stride = params.get_passes_size();
+	int size = params.width*params.height;
+
+	packed_half.resize(size*num_half);
+	packed_float.resize(size*(pass_stride - num_half));
+
+	/* Store the per sample average, so bright accumulated sums stay
+	 * within half float range. */
+	packed_scale = (float)max(sample, 1);
+	float inv_scale = 1.0f/packed_scale;
+
+	float *in = (float*)buffer.data_pointer;
+	half *out_half = packed_half.data();
+	float *out_float = packed_float.data();
+
+	for(int i = 0; i < size; i++) {
+		for(int j = 0; j < pass_stride; j++, in++) {
+			if(half_components[j])
+				*(out_half++) = pack_float_to_half(*in * inv_scale);
+			else
+				*(out_float++) = *in;
+		}
+	}
+
+	device->stats.buffer_mem_free(buffer.memory_size());
+	device->mem_free(buffer);
+	buffer.clear();
+
+	size_t packed_size = packed_half.size()*sizeof(half) + packed_float.size()*sizeof(float);
+	device->stats.mem_alloc(packed_size);
+	device->stats.buffer_mem_alloc(packed_size);
+
+	packed = true;
+}
+
+void RenderBuffers::unpack_to(float *data)
+{
+	array<bool> half_components;
+	params.get_half_components(half_components);
+
+	int pass_stride = params.get_passes_size();
+	int size = params.width*params.height;
+
+	const half *in_half = packed_half.data();
+	const float *in_float = packed_float.data();
+
+	for(int i = 0; i < size; i++) {
+		for(int j = 0; j < pass_stride; j++, data++) {
+			if(half_components[j]) {
+				*data = pack_half_to_float(*(in_half++))*packed_scale;
+			}
+			else {
+				*data = *(in_float++);
+			}
+		}
+	}
+}
+
+void RenderBuffers::unpack()
+{
+	if(!packed)
+		return;
+
+	float *data = buffer.resize(params.width*params.height*params.get_passes_size());
+	unpack_to(data);
+	packed_free();
+
+	device->mem_alloc("render_buffer", buffer, MEM_READ_WRITE);
+	device->mem_copy_to(buffer);
+	device->stats.buffer_mem_alloc(buffer.memory_size());
+}
+
+float *RenderBuffers::host_data(array<float>& unpacked)
+{
+	if(!packed)
+		return (float*)buffer.data_pointer;
+
+	unpacked.resize(params.width*params.height*params.get_passes_size());
+	unpack_to(unpacked.data());
+
+	return unpacked.data();
+}
+
 bool RenderBuffers::copy_from_device(Device *from_device)
 {
+	/* packed storage only lives on the host */
+	if(packed)
+		return true;
+
 	if(!buffer.device_pointer)
 		return false;
 
@@ -182,7 +402,8 @@ bool RenderBuffers::get_denoising_pass_rect(int offset, float exposure, int samp
 	}
 
 	offset += params.get_denoising_offset();
-	float *in = (float*)buffer.data_pointer + offset;
+	array<float> unpacked;
+	float *in = host_data(unpacked) + offset;
 	int pass_stride = params.get_passes_size();
 	int size = params.width*params.height;
 
@@ -208,6 +429,8 @@ bool RenderBuffers::get_denoising_pass_rect(int offset, float exposure, int samp
 bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int components, float *pixels)
 {
 	int pass_offset = 0;
+	array<float> unpacked;
+	float *data = host_data(unpacked);
 
 	for(size_t j = 0; j < params.passes.size(); j++) {
 		Pass& pass = params.passes[j];
@@ -217,7 +440,7 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 			continue;
 		}
 
-		float *in = (float*)buffer.data_pointer + pass_offset;
+		float *in = data + pass_offset;
 		int pass_stride = params.get_passes_size();
 
 		float scale = (pass.filter)? 1.0f/(float)sample: 1.0f;
@@ -241,18 +464,17 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 					pixels[0] = saturate(f*scale_exposure);
 				}
 			}
-#ifdef WITH_CYCLES_DEBUG
 			else if(type == PASS_BVH_TRAVERSED_NODES ||
 			        type == PASS_BVH_TRAVERSED_INSTANCES ||
 			        type == PASS_BVH_INTERSECTIONS ||
-			        type == PASS_RAY_BOUNCES)
+			        type == PASS_RAY_BOUNCES ||
+			        type == PASS_SHADER_TIME)
 			{
 				for(int i = 0; i < size; i++, in += pass_stride, pixels++) {
 					float f = *in;
 					pixels[0] = f*scale;
 				}
 			}
-#endif
 			else {
 				for(int i = 0; i < size; i++, in += pass_stride, pixels++) {
 					float f = *in;
@@ -284,7 +506,7 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 					pass_offset += color_pass.components;
 				}
 
-				float *in_divide = (float*)buffer.data_pointer + pass_offset;
+				float *in_divide = data + pass_offset;
 
 				for(int i = 0; i < size; i++, in += pass_stride, in_divide += pass_stride, pixels += 3) {
 					float3 f = make_float3(in[0], in[1], in[2]);
@@ -333,7 +555,7 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 					pass_offset += color_pass.components;
 				}
 
-				float *in_weight = (float*)buffer.data_pointer + pass_offset;
+				float *in_weight = data + pass_offset;
 
 				for(int i = 0; i < size; i++, in += pass_stride, in_weight += pass_stride, pixels += 4) {
 					float4 f = make_float4(in[0], in[1], in[2], in[3]);
@@ -54,6 +54,8 @@ public:
 	bool denoising_data_pass;
 	/* If only some light path types should be denoised, an additional pass is needed. */
 	bool denoising_clean_pass;
+	/* Store passes that tolerate it in half float while a tile is idle. */
+	bool half_storage;
 
 	/* functions */
 	BufferParams();
@@ -63,6 +65,7 @@ public:
 	void add_pass(PassType type);
 	int get_passes_size();
 	int get_denoising_offset();
+	int get_half_components(array<bool>& half_components);
 };
 
 /* Render Buffers */
@@ -77,6 +80,15 @@ public:
 	/* random number generator state */
 	device_vector<uint> rng_state;
 
+	/* packed storage, used instead of the float buffer while the tile
+	 * is not accumulating samples (see pack()) */
+	bool packed;
+	array<half> packed_half;
+	array<float> packed_float;
+	float packed_scale;
+	/* number of denoising tasks currently reading this buffer */
+	int map_count;
+
 	Device *device;
 
 	explicit RenderBuffers(Device *device);
@@ -84,12 +96,22 @@ public:
 
 	void reset(Device *device, BufferParams& params);
 
+	/* Convert the float buffer to packed storage and free it on the device,
+	 * the kernel only ever accumulates into an unpacked float buffer. */
+	void pack(int sample);
+	void unpack();
+
 	bool copy_from_device(Device *from_device = NULL);
 	bool get_pass_rect(PassType type, float exposure, int sample, int components, float *pixels);
 	bool get_denoising_pass_rect(int offset, float exposure, int sample, int components, float *pixels);
 
+	size_t memory_size();
+
 protected:
 	void device_free();
+	void packed_free();
+	void unpack_to(float *data);
+	float *host_data(array<float>& unpacked);
 };
 
 /* Display Buffer
@@ -94,6 +94,7 @@ CurveSystemManager::CurveSystemManager()
 	use_encasing = true;
 	use_backfacing = false;
 	use_tangent_normal_geometry = false;
+	use_compact_keys = false;
 
 	need_update = true;
 	need_mesh_update = false;
@@ -136,6 +137,8 @@ void CurveSystemManager::device_update(Device *device,
 			kcurve->curveflags |= CURVE_KN_BACKFACING;
 		if(use_encasing)
 			kcurve->curveflags |= CURVE_KN_ENCLOSEFILTER;
+		if(use_compact_keys)
+			kcurve->curveflags |= CURVE_KN_COMPACT_KEYS;
 
 		kcurve->minimum_width = minimum_width;
 		kcurve->maximum_width = maximum_width;
@@ -166,6 +169,7 @@ bool CurveSystemManager::modified(const CurveSystemManager& CurveSystemManager)
 		triangle_method == CurveSystemManager.triangle_method &&
 		resolution == CurveSystemManager.resolution &&
 		use_curves == CurveSystemManager.use_curves &&
+		use_compact_keys == CurveSystemManager.use_compact_keys &&
 		subdivisions == CurveSystemManager.subdivisions);
 }
 
@@ -175,7 +179,8 @@ bool CurveSystemManager::modified_mesh(const CurveSystemManager& CurveSystemMana
 		curve_shape == CurveSystemManager.curve_shape &&
 		triangle_method == CurveSystemManager.triangle_method &&
 		resolution == CurveSystemManager.resolution &&
-		use_curves == CurveSystemManager.use_curves);
+		use_curves == CurveSystemManager.use_curves &&
+		use_compact_keys == CurveSystemManager.use_compact_keys);
 }
 
 void CurveSystemManager::tag_update(Scene * /*scene*/)
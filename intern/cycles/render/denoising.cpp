@@ -0,0 +1,556 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/denoising.h"
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_math.h"
+#include "util/util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Render buffer layout handed to the filter: the combined pass followed by
+ * the denoising data, the same way the film lays out the passes. */
+#define DENOISE_COMBINED_OFFSET 0
+#define DENOISE_DATA_OFFSET 4
+
+static int denoise_pass_stride()
+{
+	return align_up(DENOISE_DATA_OFFSET + DENOISING_PASS_SIZE_BASE, 4);
+}
+
+/* Passes as written by Blender into multilayer EXR files. */
+static const struct {
+	const char *name;
+	int offset;
+	const char *channels;
+} denoise_passes[] = {
+	{"Combined",                  DENOISE_COMBINED_OFFSET,                           "RGBA"},
+	{"Denoising Normal",          DENOISE_DATA_OFFSET + DENOISING_PASS_NORMAL,       "XYZ"},
+	{"Denoising Normal Variance", DENOISE_DATA_OFFSET + DENOISING_PASS_NORMAL_VAR,   "XYZ"},
+	{"Denoising Albedo",          DENOISE_DATA_OFFSET + DENOISING_PASS_ALBEDO,       "RGB"},
+	{"Denoising Albedo Variance", DENOISE_DATA_OFFSET + DENOISING_PASS_ALBEDO_VAR,   "RGB"},
+	{"Denoising Depth",           DENOISE_DATA_OFFSET + DENOISING_PASS_DEPTH,        "Z"},
+	{"Denoising Depth Variance",  DENOISE_DATA_OFFSET + DENOISING_PASS_DEPTH_VAR,    "Z"},
+	{"Denoising Shadow A",        DENOISE_DATA_OFFSET + DENOISING_PASS_SHADOW_A,     "XYV"},
+	{"Denoising Shadow B",        DENOISE_DATA_OFFSET + DENOISING_PASS_SHADOW_B,     "XYV"},
+	{"Denoising Image",           DENOISE_DATA_OFFSET + DENOISING_PASS_COLOR,        "RGB"},
+	{"Denoising Image Variance",  DENOISE_DATA_OFFSET + DENOISING_PASS_COLOR_VAR,    "RGB"},
+};
+
+static int denoise_pass_channel_offset(const string& pass, const string& channel)
+{
+	if(channel.size() != 1) {
+		return -1;
+	}
+
+	for(int i = 0; i < sizeof(denoise_passes)/sizeof(*denoise_passes); i++) {
+		if(pass == denoise_passes[i].name) {
+			const char *c = strchr(denoise_passes[i].channels, channel[0]);
+			return (c)? denoise_passes[i].offset + (int)(c - denoise_passes[i].channels): -1;
+		}
+	}
+
+	return -1;
+}
+
+/* Denoise Image */
+
+DenoiseImage::DenoiseImage()
+: width(0), height(0), num_channels(0)
+{
+}
+
+DenoiseImage::~DenoiseImage()
+{
+}
+
+bool DenoiseImage::parse_channels()
+{
+	vector<DenoiseImageLayer> found_layers;
+
+	/* Channels are named "layer.pass.channel". */
+	for(int i = 0; i < spec.nchannels; i++) {
+		const string& name = spec.channelnames[i];
+
+		size_t channel_pos = name.rfind('.');
+		if(channel_pos == string::npos || channel_pos == 0) {
+			continue;
+		}
+		size_t pass_pos = name.rfind('.', channel_pos - 1);
+		if(pass_pos == string::npos) {
+			continue;
+		}
+
+		string layer_name = name.substr(0, pass_pos);
+		string pass = name.substr(pass_pos + 1, channel_pos - pass_pos - 1);
+		string channel = name.substr(channel_pos + 1);
+
+		int offset = denoise_pass_channel_offset(pass, channel);
+		if(offset == -1) {
+			continue;
+		}
+
+		DenoiseImageLayer *layer = NULL;
+		foreach(DenoiseImageLayer& found_layer, found_layers) {
+			if(found_layer.name == layer_name) {
+				layer = &found_layer;
+				break;
+			}
+		}
+		if(!layer) {
+			found_layers.push_back(DenoiseImageLayer());
+			layer = &found_layers.back();
+			layer->name = layer_name;
+			for(int j = 0; j < 4; j++) {
+				layer->output_channels[j] = -1;
+			}
+		}
+
+		layer->input_channels.push_back(i);
+		layer->input_offsets.push_back(offset);
+		if(offset < DENOISE_DATA_OFFSET) {
+			layer->output_channels[offset - DENOISE_COMBINED_OFFSET] = i;
+		}
+	}
+
+	/* Only layers with all denoising passes are denoised, the others are
+	 * written back as they are. */
+	layers.clear();
+	foreach(DenoiseImageLayer& layer, found_layers) {
+		int num_data_channels = 0;
+		foreach(int offset, layer.input_offsets) {
+			if(offset >= DENOISE_DATA_OFFSET) {
+				num_data_channels++;
+			}
+		}
+
+		if(num_data_channels == 0) {
+			continue;
+		}
+		if(num_data_channels != DENOISING_PASS_SIZE_BASE) {
+			error = string_printf("Layer \"%s\" has incomplete denoising data passes", layer.name.c_str());
+			return false;
+		}
+		if(layer.output_channels[0] == -1 ||
+		   layer.output_channels[1] == -1 ||
+		   layer.output_channels[2] == -1)
+		{
+			error = string_printf("Layer \"%s\" has no combined pass", layer.name.c_str());
+			return false;
+		}
+
+		layers.push_back(layer);
+	}
+
+	return true;
+}
+
+bool DenoiseImage::load(const string& filepath)
+{
+	ImageInput *in = ImageInput::create(filepath);
+	if(!in) {
+		error = "Couldn't find a reader for " + filepath;
+		return false;
+	}
+
+	if(!in->open(filepath, spec)) {
+		error = "Couldn't open " + filepath + ": " + in->geterror();
+		delete in;
+		return false;
+	}
+
+	width = spec.width;
+	height = spec.height;
+	num_channels = spec.nchannels;
+
+	if(!parse_channels()) {
+		error = filepath + ": " + error;
+		in->close();
+		delete in;
+		return false;
+	}
+
+	pixels.resize(((size_t)width)*height*num_channels);
+	bool success = in->read_image(TypeDesc::FLOAT, pixels.data());
+	if(!success) {
+		error = "Couldn't read " + filepath + ": " + in->geterror();
+	}
+
+	in->close();
+	delete in;
+
+	return success;
+}
+
+bool DenoiseImage::save(const string& filepath)
+{
+	/* Leave out the denoising data of the layers that were denoised. */
+	vector<bool> skip_channel(num_channels, false);
+	foreach(DenoiseImageLayer& layer, layers) {
+		for(size_t i = 0; i < layer.input_channels.size(); i++) {
+			if(layer.input_offsets[i] >= DENOISE_DATA_OFFSET) {
+				skip_channel[layer.input_channels[i]] = true;
+			}
+		}
+	}
+
+	vector<int> channels;
+	ImageSpec out_spec = spec;
+	out_spec.channelnames.clear();
+	out_spec.channelformats.clear();
+	out_spec.alpha_channel = -1;
+	out_spec.z_channel = -1;
+
+	for(int i = 0; i < num_channels; i++) {
+		if(skip_channel[i]) {
+			continue;
+		}
+		channels.push_back(i);
+		out_spec.channelnames.push_back(spec.channelnames[i]);
+		if(spec.channelformats.size()) {
+			out_spec.channelformats.push_back(spec.channelformats[i]);
+		}
+	}
+	out_spec.nchannels = channels.size();
+
+	size_t num_pixels = ((size_t)width)*height;
+	array<float> out_pixels(num_pixels*channels.size());
+	for(size_t i = 0; i < num_pixels; i++) {
+		const float *in = pixels.data() + i*num_channels;
+		float *out = out_pixels.data() + i*channels.size();
+		for(size_t j = 0; j < channels.size(); j++) {
+			out[j] = in[channels[j]];
+		}
+	}
+
+	ImageOutput *out = ImageOutput::create(filepath);
+	if(!out) {
+		error = "Couldn't find a writer for " + filepath;
+		return false;
+	}
+
+	if(!out->open(filepath, out_spec)) {
+		error = "Couldn't open " + filepath + " for writing: " + out->geterror();
+		delete out;
+		return false;
+	}
+
+	bool success = out->write_image(TypeDesc::FLOAT, out_pixels.data());
+	if(!success) {
+		error = "Couldn't write " + filepath + ": " + out->geterror();
+	}
+
+	out->close();
+	delete out;
+
+	return success;
+}
+
+void DenoiseImage::read_layer_buffer(const DenoiseImageLayer& layer, int samples, float *buffer, int pass_stride)
+{
+	/* The file holds normalized values, the filter expects them accumulated
+	 * over all samples like in the render buffers. */
+	size_t num_pixels = ((size_t)width)*height;
+	size_t num_inputs = layer.input_channels.size();
+
+	memset(buffer, 0, sizeof(float)*num_pixels*pass_stride);
+
+	for(size_t i = 0; i < num_pixels; i++) {
+		const float *in = pixels.data() + i*num_channels;
+		float *out = buffer + i*pass_stride;
+		for(size_t j = 0; j < num_inputs; j++) {
+			out[layer.input_offsets[j]] = in[layer.input_channels[j]] * samples;
+		}
+	}
+}
+
+void DenoiseImage::write_layer_buffer(const DenoiseImageLayer& layer, int samples, const float *buffer, int pass_stride)
+{
+	size_t num_pixels = ((size_t)width)*height;
+	float scale = 1.0f/samples;
+
+	/* Only the color is denoised, alpha is kept as rendered. */
+	for(size_t i = 0; i < num_pixels; i++) {
+		const float *in = buffer + i*pass_stride + DENOISE_COMBINED_OFFSET;
+		float *out = pixels.data() + i*num_channels;
+		for(int j = 0; j < 3; j++) {
+			out[layer.output_channels[j]] = in[j] * scale;
+		}
+	}
+}
+
+/* Denoiser */
+
+Denoiser::Denoiser(DeviceInfo& device_info)
+: width(0), height(0), num_tiles(make_int2(0, 0)), next_tile(0)
+{
+	device = Device::create(device_info, stats, true);
+}
+
+Denoiser::~Denoiser()
+{
+	delete device;
+}
+
+bool Denoiser::acquire_tile(Device * /*device*/, RenderTile& tile)
+{
+	thread_scoped_lock tile_lock(tile_mutex);
+
+	if(next_tile >= num_tiles.x*num_tiles.y) {
+		return false;
+	}
+
+	int tile_x = next_tile % num_tiles.x;
+	int tile_y = next_tile / num_tiles.x;
+
+	tile.task = RenderTile::DENOISE;
+	tile.x = tile_x*params.tile_size.x;
+	tile.y = tile_y*params.tile_size.y;
+	tile.w = min(params.tile_size.x, width - tile.x);
+	tile.h = min(params.tile_size.y, height - tile.y);
+	tile.start_sample = 0;
+	tile.num_samples = params.samples;
+	tile.sample = 0;
+	tile.offset = 0;
+	tile.stride = width;
+	tile.tile_index = next_tile;
+	tile.buffer = buffer.device_pointer;
+	tile.buffers = NULL;
+
+	next_tile++;
+
+	return true;
+}
+
+void Denoiser::release_tile(RenderTile& /*tile*/)
+{
+	/* All tiles share the buffer of the whole layer, nothing to write back. */
+}
+
+void Denoiser::map_neighbor_tiles(RenderTile *tiles, Device *tile_device)
+{
+	for(int dy = -1, i = 0; dy <= 1; dy++) {
+		for(int dx = -1; dx <= 1; dx++, i++) {
+			int px = tiles[4].x + dx*params.tile_size.x;
+			int py = tiles[4].y + dy*params.tile_size.y;
+			if(px >= 0 && py >= 0 && px < width && py < height) {
+				tiles[i].buffer = buffer.device_pointer;
+				tiles[i].x = px;
+				tiles[i].y = py;
+				tiles[i].w = min(params.tile_size.x, width - px);
+				tiles[i].h = min(params.tile_size.y, height - py);
+				tiles[i].offset = 0;
+				tiles[i].stride = width;
+			}
+			else {
+				tiles[i].buffer = (device_ptr)NULL;
+				tiles[i].x = clamp(px, 0, width);
+				tiles[i].y = clamp(py, 0, height);
+				tiles[i].w = tiles[i].h = 0;
+			}
+			tiles[i].buffers = NULL;
+		}
+	}
+
+	device->map_neighbor_tiles(tile_device, tiles);
+}
+
+void Denoiser::unmap_neighbor_tiles(RenderTile *tiles, Device *tile_device)
+{
+	device->unmap_neighbor_tiles(tile_device, tiles);
+}
+
+bool Denoiser::denoise_layer(DenoiseImage *image, const DenoiseImageLayer& layer)
+{
+	int pass_stride = denoise_pass_stride();
+
+	width = image->width;
+	height = image->height;
+	num_tiles = make_int2(divide_up(width, params.tile_size.x),
+	                      divide_up(height, params.tile_size.y));
+	next_tile = 0;
+
+	float *data = buffer.resize(((size_t)width)*height*pass_stride);
+	if(!data) {
+		error = "Failed to allocate denoising buffer for layer " + layer.name;
+		return false;
+	}
+	image->read_layer_buffer(layer, params.samples, data, pass_stride);
+
+	device->mem_alloc("denoising_buffer", buffer, MEM_READ_WRITE);
+	device->mem_copy_to(buffer);
+
+	DeviceTask task(DeviceTask::RENDER);
+	task.acquire_tile = function_bind(&Denoiser::acquire_tile, this, _1, _2);
+	task.release_tile = function_bind(&Denoiser::release_tile, this, _1);
+	task.map_neighbor_tiles = function_bind(&Denoiser::map_neighbor_tiles, this, _1, _2);
+	task.unmap_neighbor_tiles = function_bind(&Denoiser::unmap_neighbor_tiles, this, _1, _2);
+	task.need_finish_queue = false;
+	task.integrator_branched = false;
+	task.requested_tile_size = params.tile_size;
+	task.passes_size = pass_stride;
+
+	task.denoising_radius = params.radius;
+	task.denoising_strength = params.strength;
+	task.denoising_feature_strength = params.feature_strength;
+	task.denoising_relative_pca = params.relative_pca;
+	task.pass_stride = pass_stride;
+	task.pass_denoising_data = DENOISE_DATA_OFFSET;
+	task.pass_denoising_clean = 0;
+
+	device->task_add(task);
+	device->task_wait();
+
+	device->mem_copy_from(buffer, 0, width, height, pass_stride*sizeof(float));
+	image->write_layer_buffer(layer, params.samples, data, pass_stride);
+
+	device->mem_free(buffer);
+	buffer.clear();
+
+	return true;
+}
+
+bool Denoiser::denoise_image(DenoiseImage *image)
+{
+	if(image->layers.empty()) {
+		error = "No layers with denoising data found";
+		return false;
+	}
+
+	foreach(const DenoiseImageLayer& layer, image->layers) {
+		double start_time = time_dt();
+
+		if(!denoise_layer(image, layer)) {
+			return false;
+		}
+
+		VLOG(1) << "Denoised layer " << layer.name << " in "
+		        << time_dt() - start_time << " seconds.";
+	}
+
+	return true;
+}
+
+bool Denoiser::run(const vector<string>& input, const vector<string>& output)
+{
+	assert(input.size() == output.size());
+
+	if(!device) {
+		error = "Failed to create denoising device";
+		return false;
+	}
+	if(params.samples <= 0) {
+		error = "Number of samples must be specified";
+		return false;
+	}
+
+	int num_frames = input.size();
+	if(num_frames == 0) {
+		return true;
+	}
+
+	/* Loading of the next frame and saving of the previous one run on their
+	 * own threads, while the device works on the current frame. */
+	DenoiseImage *current = new DenoiseImage();
+	DenoiseImage *saving = NULL;
+	thread *save_thread = NULL;
+	bool success = true;
+
+	if(progress_cb) {
+		progress_cb(0, num_frames, "Loading " + input[0]);
+	}
+	current->load(input[0]);
+
+	for(int frame = 0; frame < num_frames; frame++) {
+		DenoiseImage *next = NULL;
+		thread *load_thread = NULL;
+
+		if(frame + 1 < num_frames) {
+			next = new DenoiseImage();
+			load_thread = new thread(function_bind(&DenoiseImage::load, next, input[frame + 1]));
+		}
+
+		if(!current->error.empty()) {
+			error = current->error;
+			success = false;
+		}
+		else {
+			if(progress_cb) {
+				progress_cb(frame, num_frames, "Denoising " + input[frame]);
+			}
+			if(!denoise_image(current)) {
+				error = input[frame] + ": " + error;
+				success = false;
+			}
+		}
+
+		/* Only one frame is written at a time, to bound memory usage. */
+		if(save_thread) {
+			save_thread->join();
+			delete save_thread;
+			save_thread = NULL;
+
+			if(!saving->error.empty() && success) {
+				error = saving->error;
+				success = false;
+			}
+			delete saving;
+			saving = NULL;
+		}
+
+		if(success) {
+			if(progress_cb) {
+				progress_cb(frame, num_frames, "Saving " + output[frame]);
+			}
+			saving = current;
+			save_thread = new thread(function_bind(&DenoiseImage::save, saving, output[frame]));
+		}
+		else {
+			delete current;
+		}
+
+		if(load_thread) {
+			load_thread->join();
+			delete load_thread;
+		}
+		current = next;
+
+		if(!success) {
+			break;
+		}
+	}
+
+	if(save_thread) {
+		save_thread->join();
+		delete save_thread;
+
+		if(!saving->error.empty() && success) {
+			error = saving->error;
+			success = false;
+		}
+		delete saving;
+	}
+
+	delete current;
+
+	return success;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DENOISING_H__
+#define __DENOISING_H__
+
+/* Denoising of previously rendered images, outside of a render session.
+ *
+ * Multilayer EXR files written with the "Denoising Data" passes are read,
+ * split into tiles and run through the same filter kernels the device uses
+ * for denoising during rendering. While one frame is being denoised, the
+ * next one is loaded and the previous one written on separate threads. */
+
+#include "device/device.h"
+
+#include "render/buffers.h"
+
+#include "util/util_image.h"
+#include "util/util_stats.h"
+#include "util/util_string.h"
+#include "util/util_thread.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* A render layer found in the image, with the mapping of its file channels
+ * to the offsets in the render buffer layout expected by the filter. */
+
+struct DenoiseImageLayer {
+	string name;
+	/* File channel index and render buffer offset for every pass channel. */
+	vector<int> input_channels;
+	vector<int> input_offsets;
+	/* File channel indices of the combined RGBA pass, -1 if missing. */
+	int output_channels[4];
+};
+
+/* Image loaded from a file, with all channels kept so the ones that are
+ * not denoised can be written back unmodified. The denoising passes
+ * themselves are left out when saving. */
+
+class DenoiseImage {
+public:
+	DenoiseImage();
+	~DenoiseImage();
+
+	bool load(const string& filepath);
+	bool save(const string& filepath);
+
+	/* Fill a buffer in the render buffer layout for the given layer, and
+	 * write the denoised combined pass back into the image pixels. */
+	void read_layer_buffer(const DenoiseImageLayer& layer, int samples, float *buffer, int pass_stride);
+	void write_layer_buffer(const DenoiseImageLayer& layer, int samples, const float *buffer, int pass_stride);
+
+	int width, height;
+	int num_channels;
+	ImageSpec spec;
+	vector<DenoiseImageLayer> layers;
+	array<float> pixels;
+
+	string error;
+
+protected:
+	bool parse_channels();
+};
+
+/* Parameters of the filter, matching the ones of the render session. */
+
+struct DenoiseParams {
+	int radius;
+	float strength;
+	float feature_strength;
+	bool relative_pca;
+	int2 tile_size;
+	/* Number of samples the images were rendered with, the passes in the
+	 * file are normalized but the filter works on accumulated values. */
+	int samples;
+
+	DenoiseParams()
+	: radius(8),
+	  strength(0.5f),
+	  feature_strength(0.5f),
+	  relative_pca(false),
+	  tile_size(make_int2(64, 64)),
+	  samples(0)
+	{}
+};
+
+/* Denoises a sequence of frames on a device, pipelining file I/O with the
+ * computation of the current frame. */
+
+class Denoiser {
+public:
+	Denoiser(DeviceInfo& device_info);
+	~Denoiser();
+
+	bool run(const vector<string>& input, const vector<string>& output);
+
+	DenoiseParams params;
+	string error;
+
+	/* Called with the frame index, number of frames and status message. */
+	function<void(int, int, const string&)> progress_cb;
+
+protected:
+	bool denoise_image(DenoiseImage *image);
+	bool denoise_layer(DenoiseImage *image, const DenoiseImageLayer& layer);
+
+	/* Tile callbacks of the device task. */
+	bool acquire_tile(Device *device, RenderTile& tile);
+	void release_tile(RenderTile& tile);
+	void map_neighbor_tiles(RenderTile *tiles, Device *device);
+	void unmap_neighbor_tiles(RenderTile *tiles, Device *device);
+
+	Stats stats;
+	Device *device;
+
+	/* State of the layer being denoised. */
+	thread_mutex tile_mutex;
+	device_vector<float> buffer;
+	int width, height;
+	int2 num_tiles;
+	int next_tile;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __DENOISING_H__ */
@@ -50,6 +50,7 @@ void Pass::add(PassType type, array<Pass>& passes)
 	pass.type = type;
 	pass.filter = true;
 	pass.exposure = false;
+	pass.half_storage = false;
 	pass.divide_type = PASS_NONE;
 
 	switch(type) {
@@ -69,6 +70,7 @@ void Pass::add(PassType type, array<Pass>& passes)
 			break;
 		case PASS_NORMAL:
 			pass.components = 4;
+			pass.half_storage = true;
 			break;
 		case PASS_UV:
 			pass.components = 4;
@@ -90,45 +92,54 @@ void Pass::add(PassType type, array<Pass>& passes)
 		case PASS_TRANSMISSION_COLOR:
 		case PASS_SUBSURFACE_COLOR:
 			pass.components = 4;
+			pass.half_storage = true;
 			break;
 		case PASS_DIFFUSE_INDIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_storage = true;
 			pass.divide_type = PASS_DIFFUSE_COLOR;
 			break;
 		case PASS_GLOSSY_INDIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_storage = true;
 			pass.divide_type = PASS_GLOSSY_COLOR;
 			break;
 		case PASS_TRANSMISSION_INDIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_storage = true;
 			pass.divide_type = PASS_TRANSMISSION_COLOR;
 			break;
 		case PASS_SUBSURFACE_INDIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_storage = true;
 			pass.divide_type = PASS_SUBSURFACE_COLOR;
 			break;
 		case PASS_DIFFUSE_DIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_storage = true;
 			pass.divide_type = PASS_DIFFUSE_COLOR;
 			break;
 		case PASS_GLOSSY_DIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_storage = true;
 			pass.divide_type = PASS_GLOSSY_COLOR;
 			break;
 		case PASS_TRANSMISSION_DIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_storage = true;
 			pass.divide_type = PASS_TRANSMISSION_COLOR;
 			break;
 		case PASS_SUBSURFACE_DIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_storage = true;
 			pass.divide_type = PASS_SUBSURFACE_COLOR;
 			break;
 
@@ -136,9 +147,11 @@ void Pass::add(PassType type, array<Pass>& passes)
 		case PASS_BACKGROUND:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_storage = true;
 			break;
 		case PASS_AO:
 			pass.components = 4;
+			pass.half_storage = true;
 			break;
 		case PASS_SHADOW:
 			pass.components = 4;
@@ -153,15 +166,14 @@ void Pass::add(PassType type, array<Pass>& passes)
 			 */
 			pass.components = 0;
 			break;
-#ifdef WITH_CYCLES_DEBUG
 		case PASS_BVH_TRAVERSED_NODES:
 		case PASS_BVH_TRAVERSED_INSTANCES:
 		case PASS_BVH_INTERSECTIONS:
 		case PASS_RAY_BOUNCES:
+		case PASS_SHADER_TIME:
 			pass.components = 1;
 			pass.exposure = false;
 			break;
-#endif
 	}
 
 	passes.push_back_slow(pass);
@@ -419,7 +431,6 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 				kfilm->use_light_pass = 1;
 				break;
 
-#ifdef WITH_CYCLES_DEBUG
 			case PASS_BVH_TRAVERSED_NODES:
 				kfilm->pass_bvh_traversed_nodes = kfilm->pass_stride;
 				break;
@@ -432,7 +443,9 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 			case PASS_RAY_BOUNCES:
 				kfilm->pass_ray_bounces = kfilm->pass_stride;
 				break;
-#endif
+			case PASS_SHADER_TIME:
+				kfilm->pass_shader_time = kfilm->pass_stride;
+				break;
 
 			case PASS_NONE:
 				break;
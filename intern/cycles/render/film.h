@@ -44,6 +44,8 @@ public:
 	int components;
 	bool filter;
 	bool exposure;
+	/* Pass tolerates half float storage while its tile is idle. */
+	bool half_storage;
 	PassType divide_type;
 
 	static void add(PassType type, array<Pass>& passes);
@@ -37,6 +37,7 @@
 #include "util/util_logging.h"
 #include "util/util_progress.h"
 #include "util/util_set.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -526,6 +527,8 @@ void Mesh::clear()
 	curve_radius.clear();
 	curve_first_key.clear();
 	curve_shader.clear();
+	curve_compact_bounds.clear();
+	curve_compact_radius_step.clear();
 
 	subd_faces.clear();
 	subd_face_corners.clear();
@@ -865,6 +868,63 @@ void Mesh::add_undisplaced()
 	}
 }
 
+static uint curve_quantize(float f, float inv_step)
+{
+	return (uint)clamp((int)(f*inv_step + 0.5f), 0, 65535);
+}
+
+void Mesh::quantize_curve_keys()
+{
+	size_t curve_num = num_curves();
+
+	/* curves added since the last time were quantized */
+	size_t start = curve_compact_bounds.size();
+
+	if(start >= curve_num)
+		return;
+
+	curve_compact_bounds.resize(curve_num);
+	curve_compact_radius_step.resize(curve_num);
+
+	for(size_t i = start; i < curve_num; i++) {
+		Curve curve = get_curve(i);
+
+		/* per strand bounds, with positions quantized to 16 bits relative to
+		 * the largest extent and radii relative to the largest radius */
+		BoundBox bounds = BoundBox::empty;
+		float radius_max = 0.0f;
+
+		for(int k = 0; k < curve.num_keys; k++) {
+			bounds.grow(curve_keys[curve.first_key + k]);
+			radius_max = max(radius_max, curve_radius[curve.first_key + k]);
+		}
+
+		float3 size = bounds.size();
+		float step = max(size.x, max(size.y, size.z))/65535.0f;
+		float radius_step = radius_max/65535.0f;
+
+		float inv_step = (step > 0.0f)? 1.0f/step: 0.0f;
+		float inv_radius_step = (radius_step > 0.0f)? 1.0f/radius_step: 0.0f;
+
+		/* replace keys by the values the kernel decodes, so the BVH is built
+		 * for exactly the same curves */
+		for(int k = 0; k < curve.num_keys; k++) {
+			int key = curve.first_key + k;
+			float3 co = curve_keys[key];
+
+			co.x = bounds.min.x + curve_quantize(co.x - bounds.min.x, inv_step)*step;
+			co.y = bounds.min.y + curve_quantize(co.y - bounds.min.y, inv_step)*step;
+			co.z = bounds.min.z + curve_quantize(co.z - bounds.min.z, inv_step)*step;
+
+			curve_keys[key] = co;
+			curve_radius[key] = curve_quantize(curve_radius[key], inv_radius_step)*radius_step;
+		}
+
+		curve_compact_bounds[i] = make_float4(bounds.min.x, bounds.min.y, bounds.min.z, step);
+		curve_compact_radius_step[i] = radius_step;
+	}
+}
+
 void Mesh::pack_normals(Scene *scene, uint *tri_shader, float4 *vnormal)
 {
 	Attribute *attr_vN = attributes.find(ATTR_STD_VERTEX_NORMAL);
@@ -943,8 +1003,8 @@ void Mesh::pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, s
 {
 	size_t curve_keys_size = curve_keys.size();
 
-	/* pack curve keys */
-	if(curve_keys_size) {
+	/* pack curve keys, unless they are packed compact */
+	if(curve_keys_size && curve_key_co) {
 		float3 *keys_ptr = curve_keys.data();
 		float *radius_ptr = curve_radius.data();
 
@@ -970,6 +1030,39 @@ void Mesh::pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, s
 	}
 }
 
+void Mesh::pack_curves_compact(uint *curve_key_compact, float4 *curve_bounds, float4 *curve_data)
+{
+	size_t curve_num = num_curves();
+
+	assert(curve_compact_bounds.size() == curve_num);
+
+	for(size_t i = 0; i < curve_num; i++) {
+		Curve curve = get_curve(i);
+		float4 bounds = curve_compact_bounds[i];
+		float radius_step = curve_compact_radius_step[i];
+
+		/* keys were already quantized, so this gives back the exact values */
+		float inv_step = (bounds.w > 0.0f)? 1.0f/bounds.w: 0.0f;
+		float inv_radius_step = (radius_step > 0.0f)? 1.0f/radius_step: 0.0f;
+
+		for(int k = 0; k < curve.num_keys; k++) {
+			int key = curve.first_key + k;
+			float3 co = curve_keys[key];
+
+			uint x = curve_quantize(co.x - bounds.x, inv_step);
+			uint y = curve_quantize(co.y - bounds.y, inv_step);
+			uint z = curve_quantize(co.z - bounds.z, inv_step);
+			uint r = curve_quantize(curve_radius[key], inv_radius_step);
+
+			curve_key_compact[key*2 + 0] = x | (y << 16);
+			curve_key_compact[key*2 + 1] = z | (r << 16);
+		}
+
+		curve_bounds[i] = bounds;
+		curve_data[i].w = radius_step;
+	}
+}
+
 void Mesh::pack_patches(uint *patch_data, uint vert_offset, uint face_offset, uint corner_offset)
 {
 	size_t num_faces = subd_faces.size();
@@ -1764,16 +1857,45 @@ void MeshManager::device_update_mesh(Device *device,
 	if(curve_size != 0) {
 		progress.set_status("Updating Mesh", "Copying Strands to device");
 
-		float4 *curve_keys = dscene->curve_keys.resize(curve_key_size);
+		CurveSystemManager *curve_system_manager = scene->curve_system_manager;
+		bool use_compact_curves = curve_system_manager->use_curves &&
+		                          curve_system_manager->use_compact_keys;
+
 		float4 *curves = dscene->curves.resize(curve_size);
 
-		foreach(Mesh *mesh, scene->meshes) {
-			mesh->pack_curves(scene, &curve_keys[mesh->curvekey_offset], &curves[mesh->curve_offset], mesh->curvekey_offset);
-			if(progress.get_cancel()) return;
+		if(use_compact_curves) {
+			uint *curve_keys_compact = dscene->curve_keys_compact.resize(curve_key_size*2);
+			float4 *curve_bounds = dscene->curve_bounds.resize(curve_size);
+
+			foreach(Mesh *mesh, scene->meshes) {
+				mesh->pack_curves(scene, NULL, &curves[mesh->curve_offset], mesh->curvekey_offset);
+				mesh->pack_curves_compact(&curve_keys_compact[mesh->curvekey_offset*2],
+				                          &curve_bounds[mesh->curve_offset],
+				                          &curves[mesh->curve_offset]);
+				if(progress.get_cancel()) return;
+			}
+
+			device->tex_alloc("__curve_keys_compact", dscene->curve_keys_compact);
+			device->tex_alloc("__curve_bounds", dscene->curve_bounds);
+		}
+		else {
+			float4 *curve_keys = dscene->curve_keys.resize(curve_key_size);
+
+			foreach(Mesh *mesh, scene->meshes) {
+				mesh->pack_curves(scene, &curve_keys[mesh->curvekey_offset], &curves[mesh->curve_offset], mesh->curvekey_offset);
+				if(progress.get_cancel()) return;
+			}
+
+			device->tex_alloc("__curve_keys", dscene->curve_keys);
 		}
 
-		device->tex_alloc("__curve_keys", dscene->curve_keys);
 		device->tex_alloc("__curves", dscene->curves);
+
+		VLOG(1) << "Curve keys memory: "
+		        << string_human_readable_size(dscene->curve_keys.memory_size() +
+		                                      dscene->curve_keys_compact.memory_size() +
+		                                      dscene->curve_bounds.memory_size())
+		        << ((use_compact_curves)? " (compact)": "");
 	}
 
 	if(patch_size != 0) {
@@ -1955,6 +2077,10 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	VLOG(1) << "Total " << scene->meshes.size() << " meshes.";
 
+	CurveSystemManager *curve_system_manager = scene->curve_system_manager;
+	bool use_compact_curves = curve_system_manager->use_curves &&
+	                          curve_system_manager->use_compact_keys;
+
 	/* Update normals. */
 	foreach(Mesh *mesh, scene->meshes) {
 		foreach(Shader *shader, mesh->used_shaders) {
@@ -1972,6 +2098,12 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 			if(progress.get_cancel()) return;
 		}
+
+		if(use_compact_curves && mesh->curve_compact_bounds.size() != mesh->num_curves()) {
+			/* key positions change slightly, so the BVH needs an update too */
+			mesh->quantize_curve_keys();
+			mesh->need_update = true;
+		}
 	}
 
 	/* Tessellate meshes that are using subdivision */
@@ -1986,6 +2118,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		}
 	}
 
+	double tess_start_time = time_dt();
 	size_t i = 0;
 	foreach(Mesh *mesh, scene->meshes) {
 		if(mesh->need_update &&
@@ -2010,6 +2143,10 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		}
 	}
 
+	if(total_tess_needed) {
+		device->stats.time_add(STATS_TIME_TESSELLATE, time_dt() - tess_start_time);
+	}
+
 	/* Update images needed for true displacement. */
 	bool true_displacement_used = false;
 	bool old_need_object_flags_update = false;
@@ -2077,6 +2214,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		}
 	}
 
+	double bvh_start_time = time_dt();
 	TaskPool pool;
 
 	i = 0;
@@ -2099,6 +2237,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 	pool.wait_work(&summary);
 	VLOG(2) << "Objects BVH build pool statistics:\n"
 	        << summary.full_report();
+	device->stats.time_add(STATS_TIME_BVH_BUILD, time_dt() - bvh_start_time);
 
 	foreach(Shader *shader, scene->shaders) {
 		shader->need_update_attributes = false;
@@ -2119,7 +2258,9 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	if(progress.get_cancel()) return;
 
+	bvh_start_time = time_dt();
 	device_update_bvh(device, dscene, scene, progress);
+	device->stats.time_add(STATS_TIME_BVH_BUILD, time_dt() - bvh_start_time);
 	if(progress.get_cancel()) return;
 
 	device_update_mesh(device, dscene, scene, false, progress);
@@ -2157,6 +2298,8 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	device->tex_free(dscene->tri_patch_uv);
 	device->tex_free(dscene->curves);
 	device->tex_free(dscene->curve_keys);
+	device->tex_free(dscene->curve_keys_compact);
+	device->tex_free(dscene->curve_bounds);
 	device->tex_free(dscene->patches);
 	device->tex_free(dscene->attributes_map);
 	device->tex_free(dscene->attributes_float);
@@ -2179,6 +2322,8 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->tri_patch_uv.clear();
 	dscene->curves.clear();
 	dscene->curve_keys.clear();
+	dscene->curve_keys_compact.clear();
+	dscene->curve_bounds.clear();
 	dscene->patches.clear();
 	dscene->attributes_map.clear();
 	dscene->attributes_float.clear();
@@ -206,6 +206,11 @@ public:
 	array<int> curve_first_key;
 	array<int> curve_shader;
 
+	/* Quantization of curve keys for the compact device layout, per curve
+	 * the lower bound and step of key positions, and the step of radii. */
+	array<float4> curve_compact_bounds;
+	array<float> curve_compact_radius_step;
+
 	array<SubdFace> subd_faces;
 	array<int> subd_face_corners;
 	int num_ngons;
@@ -271,6 +276,7 @@ public:
 	void add_face_normals();
 	void add_vertex_normals();
 	void add_undisplaced();
+	void quantize_curve_keys();
 
 	void pack_normals(Scene *scene, uint *shader, float4 *vnormal);
 	void pack_verts(const vector<uint>& tri_prim_index,
@@ -280,6 +286,7 @@ public:
 	                size_t vert_offset,
 	                size_t tri_offset);
 	void pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, size_t curvekey_offset);
+	void pack_curves_compact(uint *curve_key_compact, float4 *curve_bounds, float4 *curve_data);
 	void pack_patches(uint *patch_data, uint vert_offset, uint face_offset, uint corner_offset);
 
 	void compute_bvh(DeviceScene *dscene,
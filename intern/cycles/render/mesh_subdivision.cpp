@@ -365,18 +365,41 @@ void Mesh::tessellate(DiagSplit *split)
 	Attribute *attr_vN = subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
 	float3* vN = attr_vN->data_float3();
 
+	/* patches are stored up front so they can be split and diced in parallel,
+	 * reserve space so pointers to them remain valid */
+	int num_patches = 0, num_subpatches = 0;
 	for(int f = 0; f < num_faces; f++) {
 		SubdFace& face = subd_faces[f];
+		num_patches += (face.is_quad())? 1: face.num_corners;
+		num_subpatches += (face.is_quad())? 4: face.num_corners;
+	}
+
+	vector<LinearQuadPatch> linear_patches;
+#ifdef WITH_OPENSUBDIV
+	vector<OsdPatch> osd_patches;
+
+	if(subdivision_type == SUBDIVISION_CATMULL_CLARK)
+		osd_patches.reserve(num_patches);
+	else
+#endif
+		linear_patches.reserve(num_patches);
+
+	vector<QuadDice::SubPatch> subpatches;
+	subpatches.reserve(num_subpatches);
+
+	for(int f = 0; f < num_faces; f++) {
+		SubdFace& face = subd_faces[f];
+		int *corners = &subd_face_corners[face.start_corner];
 
 		if(face.is_quad()) {
 			/* quad */
 			QuadDice::SubPatch subpatch;
 
-			LinearQuadPatch quad_patch;
 #ifdef WITH_OPENSUBDIV
-			OsdPatch osd_patch(&osd_data);
-
 			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
+				osd_patches.push_back(OsdPatch(&osd_data));
+				OsdPatch& osd_patch = osd_patches.back();
+
 				osd_patch.patch_index = face.ptex_offset;
 
 				subpatch.patch = &osd_patch;
@@ -384,18 +407,20 @@ void Mesh::tessellate(DiagSplit *split)
 			else
 #endif
 			{
+				linear_patches.push_back(LinearQuadPatch());
+				LinearQuadPatch& quad_patch = linear_patches.back();
 				float3 *hull = quad_patch.hull;
 				float3 *normals = quad_patch.normals;
 
 				quad_patch.patch_index = face.ptex_offset;
 
 				for(int i = 0; i < 4; i++) {
-					hull[i] = verts[subd_face_corners[face.start_corner+i]];
+					hull[i] = verts[corners[i]];
 				}
 
 				if(face.smooth) {
 					for(int i = 0; i < 4; i++) {
-						normals[i] = vN[subd_face_corners[face.start_corner+i]];
+						normals[i] = vN[corners[i]];
 					}
 				}
 				else {
@@ -413,6 +438,12 @@ void Mesh::tessellate(DiagSplit *split)
 
 			subpatch.patch->shader = face.shader;
 
+			/* sides in tu0, tu1, tv0, tv1 order */
+			subpatch.patch->set_edge(0, corners[0], corners[1], 0.0f, 1.0f);
+			subpatch.patch->set_edge(1, corners[3], corners[2], 0.0f, 1.0f);
+			subpatch.patch->set_edge(2, corners[0], corners[3], 0.0f, 1.0f);
+			subpatch.patch->set_edge(3, corners[1], corners[2], 0.0f, 1.0f);
+
 			/* Quad faces need to be split at least once to line up with split ngons, we do this
 			 * here in this manner because if we do it later edge factors may end up slightly off.
 			 */
@@ -420,73 +451,74 @@ void Mesh::tessellate(DiagSplit *split)
 			subpatch.P10 = make_float2(0.5f, 0.0f);
 			subpatch.P01 = make_float2(0.0f, 0.5f);
 			subpatch.P11 = make_float2(0.5f, 0.5f);
-			split->split_quad(subpatch.patch, &subpatch);
+			subpatches.push_back(subpatch);
 
 			subpatch.P00 = make_float2(0.5f, 0.0f);
 			subpatch.P10 = make_float2(1.0f, 0.0f);
 			subpatch.P01 = make_float2(0.5f, 0.5f);
 			subpatch.P11 = make_float2(1.0f, 0.5f);
-			split->split_quad(subpatch.patch, &subpatch);
+			subpatches.push_back(subpatch);
 
 			subpatch.P00 = make_float2(0.0f, 0.5f);
 			subpatch.P10 = make_float2(0.5f, 0.5f);
 			subpatch.P01 = make_float2(0.0f, 1.0f);
 			subpatch.P11 = make_float2(0.5f, 1.0f);
-			split->split_quad(subpatch.patch, &subpatch);
+			subpatches.push_back(subpatch);
 
 			subpatch.P00 = make_float2(0.5f, 0.5f);
 			subpatch.P10 = make_float2(1.0f, 0.5f);
 			subpatch.P01 = make_float2(0.5f, 1.0f);
 			subpatch.P11 = make_float2(1.0f, 1.0f);
-			split->split_quad(subpatch.patch, &subpatch);
+			subpatches.push_back(subpatch);
 		}
 		else {
 			/* ngon */
-#ifdef WITH_OPENSUBDIV
-			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
-				OsdPatch patch(&osd_data);
-
-				patch.shader = face.shader;
-
-				for(int corner = 0; corner < face.num_corners; corner++) {
-					patch.patch_index = face.ptex_offset + corner;
+			float3 center_vert = make_float3(0.0f, 0.0f, 0.0f);
+			float3 center_normal = make_float3(0.0f, 0.0f, 0.0f);
 
-					split->split_quad(&patch);
-				}
-			}
-			else
+#ifdef WITH_OPENSUBDIV
+			if(subdivision_type != SUBDIVISION_CATMULL_CLARK)
 #endif
 			{
-				float3 center_vert = make_float3(0.0f, 0.0f, 0.0f);
-				float3 center_normal = make_float3(0.0f, 0.0f, 0.0f);
-
 				float inv_num_corners = 1.0f/float(face.num_corners);
 				for(int corner = 0; corner < face.num_corners; corner++) {
-					center_vert += verts[subd_face_corners[face.start_corner + corner]] * inv_num_corners;
-					center_normal += vN[subd_face_corners[face.start_corner + corner]] * inv_num_corners;
+					center_vert += verts[corners[corner]] * inv_num_corners;
+					center_normal += vN[corners[corner]] * inv_num_corners;
 				}
+			}
 
-				for(int corner = 0; corner < face.num_corners; corner++) {
-					LinearQuadPatch patch;
-					float3 *hull = patch.hull;
-					float3 *normals = patch.normals;
+			for(int corner = 0; corner < face.num_corners; corner++) {
+				int v = corners[corner];
+				int v_next = corners[mod(corner + 1, face.num_corners)];
+				int v_prev = corners[mod(corner - 1, face.num_corners)];
 
-					patch.patch_index = face.ptex_offset + corner;
+				QuadDice::SubPatch subpatch;
 
-					patch.shader = face.shader;
+#ifdef WITH_OPENSUBDIV
+				if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
+					osd_patches.push_back(OsdPatch(&osd_data));
+					subpatch.patch = &osd_patches.back();
+				}
+				else
+#endif
+				{
+					linear_patches.push_back(LinearQuadPatch());
+					LinearQuadPatch& patch = linear_patches.back();
+					float3 *hull = patch.hull;
+					float3 *normals = patch.normals;
 
-					hull[0] = verts[subd_face_corners[face.start_corner + mod(corner + 0, face.num_corners)]];
-					hull[1] = verts[subd_face_corners[face.start_corner + mod(corner + 1, face.num_corners)]];
-					hull[2] = verts[subd_face_corners[face.start_corner + mod(corner - 1, face.num_corners)]];
+					hull[0] = verts[v];
+					hull[1] = verts[v_next];
+					hull[2] = verts[v_prev];
 					hull[3] = center_vert;
 
 					hull[1] = (hull[1] + hull[0]) * 0.5;
 					hull[2] = (hull[2] + hull[0]) * 0.5;
 
 					if(face.smooth) {
-						normals[0] = vN[subd_face_corners[face.start_corner + mod(corner + 0, face.num_corners)]];
-						normals[1] = vN[subd_face_corners[face.start_corner + mod(corner + 1, face.num_corners)]];
-						normals[2] = vN[subd_face_corners[face.start_corner + mod(corner - 1, face.num_corners)]];
+						normals[0] = vN[v];
+						normals[1] = vN[v_next];
+						normals[2] = vN[v_prev];
 						normals[3] = center_normal;
 
 						normals[1] = (normals[1] + normals[0]) * 0.5;
@@ -499,12 +531,28 @@ void Mesh::tessellate(DiagSplit *split)
 						}
 					}
 
-					split->split_quad(&patch);
+					subpatch.patch = &patch;
 				}
+
+				subpatch.patch->patch_index = face.ptex_offset + corner;
+				subpatch.patch->shader = face.shader;
+
+				/* outer sides are the halves of the mesh edges nearest to the
+				 * corner, inner sides are not shared with other faces */
+				subpatch.patch->set_edge(0, v, v_next, 0.0f, 0.5f);
+				subpatch.patch->set_edge(2, v, v_prev, 0.0f, 0.5f);
+
+				subpatch.P00 = make_float2(0.0f, 0.0f);
+				subpatch.P10 = make_float2(1.0f, 0.0f);
+				subpatch.P01 = make_float2(0.0f, 1.0f);
+				subpatch.P11 = make_float2(1.0f, 1.0f);
+				subpatches.push_back(subpatch);
 			}
 		}
 	}
 
+	split->split_quads(subpatches);
+
 	/* interpolate center points for attributes */
 	foreach(Attribute& attr, subd_attributes.attributes) {
 #ifdef WITH_OPENSUBDIV
@@ -180,6 +180,10 @@ void Object::apply_transform(bool apply_to_motion)
 			mesh->curve_radius[i] = radius;
 		}
 
+		/* keys are no longer quantized */
+		mesh->curve_compact_bounds.clear();
+		mesh->curve_compact_radius_step.clear();
+
 		if(apply_to_motion) {
 			Attribute *curve_attr = mesh->curve_attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
 
@@ -37,6 +37,7 @@
 #include "util/util_guarded_allocator.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -137,6 +138,7 @@ void Scene::device_update(Device *device_, Progress& progress)
 		device = device_;
 
 	bool print_stats = need_data_update();
+	double start_time = time_dt();
 
 	/* The order of updates is important, because there's dependencies between
 	 * the different managers, using data computed by previous managers.
@@ -239,6 +241,8 @@ void Scene::device_update(Device *device_, Progress& progress)
 		device->const_copy_to("__data", &dscene.data, sizeof(dscene.data));
 	}
 
+	device->stats.time_add(STATS_TIME_SCENE_UPDATE, time_dt() - start_time);
+
 	if(print_stats) {
 		size_t mem_used = util_guarded_get_mem_used();
 		size_t mem_peak = util_guarded_get_mem_peak();
@@ -80,6 +80,8 @@ public:
 
 	device_vector<float4> curves;
 	device_vector<float4> curve_keys;
+	device_vector<uint> curve_keys_compact;
+	device_vector<float4> curve_bounds;
 
 	device_vector<uint> patches;
 
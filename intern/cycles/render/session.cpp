@@ -20,12 +20,14 @@
 #include "render/buffers.h"
 #include "render/camera.h"
 #include "device/device.h"
+#include "render/film.h"
 #include "render/graph.h"
 #include "render/integrator.h"
 #include "render/mesh.h"
 #include "render/object.h"
 #include "render/scene.h"
 #include "render/session.h"
+#include "render/shader.h"
 #include "render/bake.h"
 
 #include "util/util_foreach.h"
@@ -376,6 +378,11 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	rtile.tile_index = tile->index;
 	rtile.task = (tile->state == Tile::DENOISE)? RenderTile::DENOISE: RenderTile::PATH_TRACE;
 
+	/* buffers of a tile waiting for denoising may have been packed */
+	if(tile->buffers && tile->buffers != buffers) {
+		tile->buffers->unpack();
+	}
+
 	tile_lock.unlock();
 
 	/* in case of a permanent buffer, return it, otherwise we will allocate
@@ -430,6 +437,7 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 				       rtile.h == stored_rtile.h);
 				tile_lock.unlock();
 				tile->buffers = stored_rtile.buffers;
+				tile->buffers->unpack();
 			}
 		}
 		else {
@@ -498,9 +506,29 @@ void Session::release_tile(RenderTile& rtile)
 		}
 	}
 
+	pack_tile_buffers(&tile_manager.state.tiles[rtile.tile_index]);
+
 	update_status_time();
 }
 
+/* Tiles that have all their samples and wait for their neighbors to be
+ * denoised or for the render to finish can be packed until they are mapped
+ * again. Tiles of earlier progressive refine passes still accumulate and
+ * stay in float. Must be called with tile_mutex held. */
+void Session::pack_tile_buffers(Tile *tile)
+{
+	RenderBuffers *tile_buffers = tile->buffers;
+
+	if(tile_buffers == NULL || tile_buffers == buffers)
+		return;
+	if(tile_buffers->map_count > 0 || tile->state == Tile::DENOISE)
+		return;
+	if(!tile_manager.done())
+		return;
+
+	tile_buffers->pack(tile_manager.state.sample + tile_manager.state.num_samples);
+}
+
 void Session::map_neighbor_tiles(RenderTile *tiles, Device *tile_device)
 {
 	thread_scoped_lock tile_lock(tile_mutex);
@@ -521,6 +549,9 @@ void Session::map_neighbor_tiles(RenderTile *tiles, Device *tile_device)
 				Tile *tile = &tile_manager.state.tiles[tile_index];
 				assert(tile->buffers);
 
+				tile->buffers->map_count++;
+				tile->buffers->unpack();
+
 				tiles[i].buffer = tile->buffers->buffer.device_pointer;
 				tiles[i].x = tile_manager.state.buffer.full_x + tile->x;
 				tiles[i].y = tile_manager.state.buffer.full_y + tile->y;
@@ -548,6 +579,17 @@ void Session::unmap_neighbor_tiles(RenderTile *tiles, Device *tile_device)
 {
 	thread_scoped_lock tile_lock(tile_mutex);
 	device->unmap_neighbor_tiles(tile_device, tiles);
+
+	int center_idx = tiles[4].tile_index;
+	for(int dy = -1, i = 0; dy <= 1; dy++) {
+		for(int dx = -1; dx <= 1; dx++, i++) {
+			if(tiles[i].buffers) {
+				int tile_index = center_idx + dy*tile_manager.state.tile_stride + dx;
+				tiles[i].buffers->map_count--;
+				pack_tile_buffers(&tile_manager.state.tiles[tile_index]);
+			}
+		}
+	}
 }
 
 void Session::run_cpu()
@@ -779,6 +821,20 @@ void Session::run()
 			run_cpu();
 	}
 
+	/* kernel statistics */
+	if(params.kernel_stats) {
+		vector<string> shader_names;
+		foreach(Shader *shader, scene->shaders) {
+			shader_names.push_back(shader->name.string());
+		}
+
+		string summary = stats.kernel_summary(shader_names);
+		if(!summary.empty()) {
+			printf("%s\n", summary.c_str());
+			fflush(stdout);
+		}
+	}
+
 	/* progress update */
 	if(progress.get_cancel())
 		progress.set_status("Cancel", progress.get_cancel_message());
@@ -986,6 +1042,8 @@ void Session::render()
 	task.integrator_branched = scene->integrator->method == Integrator::BRANCHED_PATH;
 	task.requested_tile_size = params.tile_size;
 	task.passes_size = tile_manager.params.get_passes_size();
+	task.kernel_stats = params.kernel_stats ||
+	                    Pass::contains(scene->film->passes, PASS_SHADER_TIME);
 
 	if(params.use_denoising) {
 		task.denoising_radius = params.denoising_radius;
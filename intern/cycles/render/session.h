@@ -63,6 +63,10 @@ public:
 	float denoising_feature_strength;
 	bool denoising_relative_pca;
 
+	/* Gather ray, BVH traversal and shader time statistics in the CPU
+	 * kernel, and print a summary when the session is done. */
+	bool kernel_stats;
+
 	double cancel_timeout;
 	double reset_timeout;
 	double text_timeout;
@@ -89,6 +93,8 @@ public:
 		denoising_feature_strength = 0.0f;
 		denoising_relative_pca = false;
 
+		kernel_stats = false;
+
 		display_buffer_linear = false;
 
 		cancel_timeout = 0.1;
@@ -192,6 +198,8 @@ protected:
 	void map_neighbor_tiles(RenderTile *tiles, Device *tile_device);
 	void unmap_neighbor_tiles(RenderTile *tiles, Device *tile_device);
 
+	void pack_tile_buffers(Tile *tile);
+
 	bool device_use_gl;
 
 	thread *session_thread;
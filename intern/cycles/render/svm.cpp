@@ -22,6 +22,7 @@
 #include "render/scene.h"
 #include "render/shader.h"
 #include "render/svm.h"
+#include "render/svm_bake.h"
 
 #include "util/util_debug.h"
 #include "util/util_logging.h"
@@ -132,6 +133,17 @@ void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 	dscene->svm_nodes.copy((uint4*)&svm_nodes[0], svm_nodes.size());
 	device->tex_alloc("__svm_nodes", dscene->svm_nodes);
 
+	/* Bake programs into native code, the interpreter is used as fallback. */
+	if(DebugFlags().cpu.svm_bake && device->info.type == DEVICE_CPU) {
+		progress.set_status("Updating Shaders", "Baking shaders");
+
+		const int num_shaders = scene->shaders.size();
+		string library = svm_bake_compile(svm_bake_source(svm_nodes, num_shaders));
+		if(library != "") {
+			device->load_baked_shaders(library, num_shaders * SVM_BAKED_NUM_TYPES);
+		}
+	}
+
 	for(i = 0; i < scene->shaders.size(); i++) {
 		Shader *shader = scene->shaders[i];
 		shader->need_update = false;
@@ -150,6 +162,7 @@ void SVMShaderManager::device_free(Device *device, DeviceScene *dscene, Scene *s
 {
 	device_free_common(device, dscene, scene);
 
+	device->free_baked_shaders();
 	device->tex_free(dscene->svm_nodes);
 	dscene->svm_nodes.clear();
 }
@@ -0,0 +1,396 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/svm_bake.h"
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_md5.h"
+#include "util/util_path.h"
+#include "util/util_set.h"
+#include "util/util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Kernel call for a node, matching the interpreter loop in svm.h. NULL for
+ * nodes which are not supported, programs using them are not baked. */
+static const char *svm_bake_node_call(int type)
+{
+	switch(type) {
+		case NODE_CLOSURE_BSDF: return "svm_node_closure_bsdf(kg, sd, stack, node, path_flag, &offset);";
+		case NODE_CLOSURE_EMISSION: return "svm_node_closure_emission(sd, stack, node);";
+		case NODE_CLOSURE_BACKGROUND: return "svm_node_closure_background(sd, stack, node);";
+		case NODE_CLOSURE_SET_WEIGHT: return "svm_node_closure_set_weight(sd, node.y, node.z, node.w);";
+		case NODE_CLOSURE_WEIGHT: return "svm_node_closure_weight(sd, stack, node.y);";
+		case NODE_EMISSION_WEIGHT: return "svm_node_emission_weight(kg, sd, stack, node);";
+		case NODE_MIX_CLOSURE: return "svm_node_mix_closure(sd, stack, node);";
+		case NODE_GEOMETRY: return "svm_node_geometry(kg, sd, stack, node.y, node.z);";
+		case NODE_CONVERT: return "svm_node_convert(sd, stack, node.y, node.z, node.w);";
+		case NODE_TEX_COORD: return "svm_node_tex_coord(kg, sd, path_flag, stack, node, &offset);";
+		case NODE_VALUE_F: return "svm_node_value_f(kg, sd, stack, node.y, node.z);";
+		case NODE_VALUE_V: return "svm_node_value_v(kg, sd, stack, node.y, &offset);";
+		case NODE_ATTR: return "svm_node_attr(kg, sd, stack, node);";
+		case NODE_GEOMETRY_BUMP_DX: return "svm_node_geometry_bump_dx(kg, sd, stack, node.y, node.z);";
+		case NODE_GEOMETRY_BUMP_DY: return "svm_node_geometry_bump_dy(kg, sd, stack, node.y, node.z);";
+		case NODE_SET_DISPLACEMENT: return "svm_node_set_displacement(kg, sd, stack, node.y);";
+		case NODE_TEX_IMAGE: return "svm_node_tex_image(kg, sd, stack, node);";
+		case NODE_TEX_IMAGE_BOX: return "svm_node_tex_image_box(kg, sd, stack, node);";
+		case NODE_TEX_NOISE: return "svm_node_tex_noise(kg, sd, stack, node, &offset);";
+		case NODE_SET_BUMP: return "svm_node_set_bump(kg, sd, stack, node);";
+		case NODE_ATTR_BUMP_DX: return "svm_node_attr_bump_dx(kg, sd, stack, node);";
+		case NODE_ATTR_BUMP_DY: return "svm_node_attr_bump_dy(kg, sd, stack, node);";
+		case NODE_TEX_COORD_BUMP_DX: return "svm_node_tex_coord_bump_dx(kg, sd, path_flag, stack, node, &offset);";
+		case NODE_TEX_COORD_BUMP_DY: return "svm_node_tex_coord_bump_dy(kg, sd, path_flag, stack, node, &offset);";
+		case NODE_CLOSURE_SET_NORMAL: return "svm_node_set_normal(kg, sd, stack, node.y, node.z);";
+		case NODE_ENTER_BUMP_EVAL: return "svm_node_enter_bump_eval(kg, sd, stack, node.y);";
+		case NODE_LEAVE_BUMP_EVAL: return "svm_node_leave_bump_eval(kg, sd, stack, node.y);";
+		case NODE_HSV: return "svm_node_hsv(kg, sd, stack, node, &offset);";
+		case NODE_CLOSURE_HOLDOUT: return "svm_node_closure_holdout(sd, stack, node);";
+		case NODE_CLOSURE_AMBIENT_OCCLUSION: return "svm_node_closure_ambient_occlusion(sd, stack, node);";
+		case NODE_FRESNEL: return "svm_node_fresnel(sd, stack, node.y, node.z, node.w);";
+		case NODE_LAYER_WEIGHT: return "svm_node_layer_weight(sd, stack, node);";
+		case NODE_CLOSURE_VOLUME: return "svm_node_closure_volume(kg, sd, stack, node, path_flag);";
+		case NODE_MATH: return "svm_node_math(kg, sd, stack, node.y, node.z, node.w, &offset);";
+		case NODE_VECTOR_MATH: return "svm_node_vector_math(kg, sd, stack, node.y, node.z, node.w, &offset);";
+		case NODE_RGB_RAMP: return "svm_node_rgb_ramp(kg, sd, stack, node, &offset);";
+		case NODE_GAMMA: return "svm_node_gamma(sd, stack, node.y, node.z, node.w);";
+		case NODE_BRIGHTCONTRAST: return "svm_node_brightness(sd, stack, node.y, node.z, node.w);";
+		case NODE_LIGHT_PATH: return "svm_node_light_path(sd, state, stack, node.y, node.z, path_flag);";
+		case NODE_OBJECT_INFO: return "svm_node_object_info(kg, sd, stack, node.y, node.z);";
+		case NODE_PARTICLE_INFO: return "svm_node_particle_info(kg, sd, stack, node.y, node.z);";
+		case NODE_HAIR_INFO: return "svm_node_hair_info(kg, sd, stack, node.y, node.z);";
+		case NODE_MAPPING: return "svm_node_mapping(kg, sd, stack, node.y, node.z, &offset);";
+		case NODE_MIN_MAX: return "svm_node_min_max(kg, sd, stack, node.y, node.z, &offset);";
+		case NODE_CAMERA: return "svm_node_camera(kg, sd, stack, node.y, node.z, node.w);";
+		case NODE_TEX_ENVIRONMENT: return "svm_node_tex_environment(kg, sd, stack, node);";
+		case NODE_TEX_SKY: return "svm_node_tex_sky(kg, sd, stack, node, &offset);";
+		case NODE_TEX_GRADIENT: return "svm_node_tex_gradient(sd, stack, node);";
+		case NODE_TEX_VORONOI: return "svm_node_tex_voronoi(kg, sd, stack, node, &offset);";
+		case NODE_TEX_MUSGRAVE: return "svm_node_tex_musgrave(kg, sd, stack, node, &offset);";
+		case NODE_TEX_WAVE: return "svm_node_tex_wave(kg, sd, stack, node, &offset);";
+		case NODE_TEX_MAGIC: return "svm_node_tex_magic(kg, sd, stack, node, &offset);";
+		case NODE_TEX_CHECKER: return "svm_node_tex_checker(kg, sd, stack, node);";
+		case NODE_TEX_BRICK: return "svm_node_tex_brick(kg, sd, stack, node, &offset);";
+		case NODE_NORMAL: return "svm_node_normal(kg, sd, stack, node.y, node.z, node.w, &offset);";
+		case NODE_LIGHT_FALLOFF: return "svm_node_light_falloff(sd, stack, node);";
+		case NODE_RGB_CURVES:
+		case NODE_VECTOR_CURVES: return "svm_node_curves(kg, sd, stack, node, &offset);";
+		case NODE_TANGENT: return "svm_node_tangent(kg, sd, stack, node);";
+		case NODE_NORMAL_MAP: return "svm_node_normal_map(kg, sd, stack, node);";
+		case NODE_INVERT: return "svm_node_invert(sd, stack, node.y, node.z, node.w);";
+		case NODE_MIX: return "svm_node_mix(kg, sd, stack, node.y, node.z, node.w, &offset);";
+		case NODE_SEPARATE_VECTOR: return "svm_node_separate_vector(sd, stack, node.y, node.z, node.w);";
+		case NODE_COMBINE_VECTOR: return "svm_node_combine_vector(sd, stack, node.y, node.z, node.w);";
+		case NODE_SEPARATE_HSV: return "svm_node_separate_hsv(kg, sd, stack, node.y, node.z, node.w, &offset);";
+		case NODE_COMBINE_HSV: return "svm_node_combine_hsv(kg, sd, stack, node.y, node.z, node.w, &offset);";
+		case NODE_VECTOR_TRANSFORM: return "svm_node_vector_transform(kg, sd, stack, node);";
+		case NODE_WIREFRAME: return "svm_node_wireframe(kg, sd, stack, node);";
+		case NODE_WAVELENGTH: return "svm_node_wavelength(sd, stack, node.y, node.z);";
+		case NODE_BLACKBODY: return "svm_node_blackbody(kg, sd, stack, node.y, node.z);";
+		case NODE_TEX_VOXEL: return "svm_node_tex_voxel(kg, sd, stack, node, &offset);";
+	}
+
+	return NULL;
+}
+
+/* Number of nodes an instruction occupies including its data nodes, as read
+ * by the kernel function. Zero for unknown instructions. */
+static int svm_bake_node_size(const vector<int4>& nodes, int offset)
+{
+	const int4& node = nodes[offset];
+
+	switch(node.x) {
+		case NODE_CLOSURE_BSDF:
+			/* Principled BSDF has four more data nodes. */
+			return ((node.y & 0xFF) == CLOSURE_BSDF_PRINCIPLED_ID)? 6: 2;
+		case NODE_TEX_COORD:
+		case NODE_TEX_COORD_BUMP_DX:
+		case NODE_TEX_COORD_BUMP_DY:
+			/* Object coordinates with an explicit object transform. */
+			return (node.y == NODE_TEXCO_OBJECT && node.w != 0)? 5: 1;
+		case NODE_TEX_VOXEL:
+			return (((node.z >> 24) & 0xFF) == NODE_TEX_VOXEL_SPACE_WORLD)? 5: 1;
+		case NODE_RGB_RAMP:
+		case NODE_RGB_CURVES:
+		case NODE_VECTOR_CURVES:
+			/* Table size follows in the first data node. */
+			if(offset + 1 >= nodes.size()) {
+				return 0;
+			}
+			return 2 + nodes[offset + 1].x;
+		case NODE_VALUE_V:
+		case NODE_TEX_NOISE:
+		case NODE_MATH:
+		case NODE_VECTOR_MATH:
+		case NODE_TEX_WAVE:
+		case NODE_TEX_MAGIC:
+		case NODE_NORMAL:
+		case NODE_MIX:
+		case NODE_SEPARATE_HSV:
+		case NODE_COMBINE_HSV:
+			return 2;
+		case NODE_MIN_MAX:
+		case NODE_TEX_MUSGRAVE:
+			return 3;
+		case NODE_TEX_BRICK:
+			return 4;
+		case NODE_MAPPING:
+			return 5;
+		case NODE_TEX_SKY:
+			return 9;
+		case NODE_JUMP_IF_ZERO:
+		case NODE_JUMP_IF_ONE:
+		case NODE_END:
+			return 1;
+	}
+
+	return (svm_bake_node_call(node.x) != NULL)? 1: 0;
+}
+
+/* Generate the body of a single program starting at entry. Returns false if
+ * the program can not be baked. */
+static bool svm_bake_program(const vector<int4>& nodes, int entry, string& code)
+{
+	/* Find instructions and jump targets. */
+	vector<int> instructions;
+	set<int> targets;
+
+	for(int offset = entry;;) {
+		if(offset < 0 || offset >= nodes.size()) {
+			return false;
+		}
+
+		const int4& node = nodes[offset];
+		instructions.push_back(offset);
+
+		if(node.x == NODE_END) {
+			break;
+		}
+		else if(node.x == NODE_JUMP_IF_ZERO || node.x == NODE_JUMP_IF_ONE) {
+			targets.insert(offset + 1 + node.y);
+		}
+
+		int size = svm_bake_node_size(nodes, offset);
+		if(size == 0) {
+			VLOG(2) << "Unsupported SVM node " << node.x << ", using interpreter.";
+			return false;
+		}
+		offset += size;
+	}
+
+	/* Jumps must land on an instruction of this program. */
+	foreach(int target, targets) {
+		if(!std::binary_search(instructions.begin(), instructions.end(), target)) {
+			return false;
+		}
+	}
+
+	foreach(int offset, instructions) {
+		const int4& node = nodes[offset];
+
+		if(targets.find(offset) != targets.end()) {
+			code += string_printf("node_%d:\n", offset);
+		}
+
+		switch(node.x) {
+			case NODE_END:
+				code += "\treturn;\n";
+				break;
+			case NODE_JUMP_IF_ZERO:
+				code += string_printf("\tif(stack_load_float(stack, %uu) == 0.0f) goto node_%d;\n",
+				                      (uint)node.z, offset + 1 + node.y);
+				break;
+			case NODE_JUMP_IF_ONE:
+				code += string_printf("\tif(stack_load_float(stack, %uu) == 1.0f) goto node_%d;\n",
+				                      (uint)node.z, offset + 1 + node.y);
+				break;
+			default: {
+				const char *call = svm_bake_node_call(node.x);
+
+				code += string_printf("\t{\n"
+				                      "\t\tconst uint4 node = make_uint4(%uu, %uu, %uu, %uu);\n",
+				                      (uint)node.x, (uint)node.y, (uint)node.z, (uint)node.w);
+				if(strstr(call, "&offset")) {
+					code += string_printf("\t\toffset = %d;\n", offset + 1);
+				}
+				code += string_printf("\t\t%s\n"
+				                      "\t}\n",
+				                      call);
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+string svm_bake_source(const vector<int4>& svm_nodes, int num_shaders)
+{
+	static const char *type_names[SVM_BAKED_NUM_TYPES] = {"surface", "volume", "displacement"};
+
+	string source =
+		"/* Shader programs baked by Cycles, do not edit. */\n"
+		"\n"
+		"#define CCL_NAMESPACE_BEGIN namespace ccl {\n"
+		"#define CCL_NAMESPACE_END }\n"
+#ifdef WITH_CYCLES_DEBUG
+		"#define WITH_CYCLES_DEBUG\n"
+#endif
+		"\n"
+		"#ifdef __SSE2__\n"
+		"#  define __KERNEL_SSE2__\n"
+		"#endif\n"
+		"#ifdef __SSE3__\n"
+		"#  define __KERNEL_SSE3__\n"
+		"#endif\n"
+		"#ifdef __SSSE3__\n"
+		"#  define __KERNEL_SSSE3__\n"
+		"#endif\n"
+		"#ifdef __SSE4_1__\n"
+		"#  define __KERNEL_SSE41__\n"
+		"#endif\n"
+		"#ifdef __AVX__\n"
+		"#  define __KERNEL_SSE__\n"
+		"#  define __KERNEL_AVX__\n"
+		"#endif\n"
+		"#ifdef __AVX2__\n"
+		"#  define __KERNEL_SSE__\n"
+		"#  define __KERNEL_AVX2__\n"
+		"#endif\n"
+		"\n"
+		"#include \"kernel/kernel_compat_cpu.h\"\n"
+		"#include \"kernel/kernel_math.h\"\n"
+		"#include \"kernel/kernel_types.h\"\n"
+		"#include \"kernel/split/kernel_split_data.h\"\n"
+		"#include \"kernel/kernel_globals.h\"\n"
+		"#include \"kernel/kernels/cpu/kernel_cpu_image.h\"\n"
+		"#include \"kernel/kernel_path.h\"\n"
+		"\n"
+		"CCL_NAMESPACE_BEGIN\n"
+		"\n";
+
+	string table;
+	int num_baked = 0;
+
+	for(int shader = 0; shader < num_shaders; shader++) {
+		const int4& jump = svm_nodes[shader];
+		const int entries[SVM_BAKED_NUM_TYPES] = {jump.y, jump.z, jump.w};
+
+		for(int type = 0; type < SVM_BAKED_NUM_TYPES; type++) {
+			string code;
+
+			if(!svm_bake_program(svm_nodes, entries[type], code)) {
+				table += "\tNULL,\n";
+				continue;
+			}
+
+			source += string_printf(
+				"/* Shader %d, %s. */\n"
+				"static void svm_baked_%d_%d(KernelGlobals *kg, ShaderData *sd, PathState *state, int path_flag)\n"
+				"{\n"
+				"\tfloat stack[SVM_STACK_SIZE];\n"
+				"\tint offset;\n"
+				"\n",
+				shader, type_names[type], shader, type);
+			source += code;
+			source += "}\n\n";
+
+			table += string_printf("\tccl::svm_baked_%d_%d,\n", shader, type);
+			num_baked++;
+		}
+	}
+
+	source += "CCL_NAMESPACE_END\n\n";
+	source += "extern \"C\" const ccl::SVMBakedFunction " SVM_BAKED_FUNCTIONS_SYMBOL "[] = {\n";
+	source += table;
+	source += "};\n\n";
+	source += string_printf("extern \"C\" const int " SVM_BAKED_NUM_FUNCTIONS_SYMBOL " = %d;\n",
+	                        num_shaders * SVM_BAKED_NUM_TYPES);
+
+	VLOG(1) << "Baked " << num_baked << " of "
+	        << num_shaders * SVM_BAKED_NUM_TYPES << " SVM programs.";
+
+	return source;
+}
+
+string svm_bake_compile(const string& source)
+{
+#ifdef _WIN32
+	(void)source;
+	VLOG(1) << "SVM baking is not supported on Windows.";
+	return "";
+#else
+	const char *compiler = getenv("CYCLES_SVM_BAKE_CXX");
+	if(compiler == NULL) {
+		compiler = "c++";
+	}
+
+	const string source_path = path_get("source");
+	string cflags = string_printf("-std=c++11 -O2 -ffast-math -fno-finite-math-only "
+	                              "-march=native -fPIC -shared -w "
+	                              "-I\"%s\"",
+	                              source_path.c_str());
+	const char *extra_cflags = getenv("CYCLES_SVM_BAKE_EXTRA_CFLAGS");
+	if(extra_cflags) {
+		cflags += string(" ") + string(extra_cflags);
+	}
+
+	/* Kernel sources and compiler arguments are part of the hash, so any
+	 * change to them rebuilds the library. */
+	const string kernel_md5 = path_files_md5_hash(source_path);
+	const string library_md5 = util_md5_string(kernel_md5 + compiler + cflags + source);
+	const string library = path_cache_get(path_join("kernels",
+		string_printf("cycles_svm_%s.so", library_md5.c_str())));
+
+	VLOG(1) << "Testing for baked shaders " << library << ".";
+	if(path_exists(library)) {
+		VLOG(1) << "Using previously baked shaders.";
+		return library;
+	}
+
+	path_create_directories(library);
+
+	string source_file = library + ".cpp";
+	string source_text = source;
+	if(!path_write_text(source_file, source_text)) {
+		fprintf(stderr, "Failed to write baked shader source %s.\n", source_file.c_str());
+		return "";
+	}
+
+	double starttime = time_dt();
+	string command = string_printf("\"%s\" %s -o \"%s\" \"%s\"",
+	                               compiler,
+	                               cflags.c_str(),
+	                               library.c_str(),
+	                               source_file.c_str());
+	VLOG(1) << "Compiling baked shaders: " << command;
+
+	if(system(command.c_str()) != 0 || !path_exists(library)) {
+		fprintf(stderr, "Baked shader compilation failed, using SVM interpreter.\n");
+		return "";
+	}
+
+	VLOG(1) << "Baked shader compilation finished in "
+	        << time_dt() - starttime << " seconds.";
+
+	return library;
+#endif
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SVM_BAKE_H__
+#define __SVM_BAKE_H__
+
+/* Baking of SVM programs into native CPU code.
+ *
+ * Every shader program is turned into a straight-line C++ function, calling
+ * the same svm_node_* kernel functions as the interpreter but with the node
+ * data embedded as constants, so the compiler can fold the opcode decoding
+ * and the per node switches away. The generated source is compiled with the
+ * system compiler into a shared library which the CPU device then loads.
+ * Programs which can not be baked are left to the interpreter. */
+
+#include "util/util_string.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Symbols exported by the baked library. */
+#define SVM_BAKED_FUNCTIONS_SYMBOL "svm_baked_functions"
+#define SVM_BAKED_NUM_FUNCTIONS_SYMBOL "svm_baked_num_functions"
+
+/* Generate source for the global SVM program, with one function for every
+ * shader and shader type. */
+string svm_bake_source(const vector<int4>& svm_nodes, int num_shaders);
+
+/* Compile the source into a shared library in the cache directory. Returns
+ * the library path, or an empty string on failure. */
+string svm_bake_compile(const string& source);
+
+CCL_NAMESPACE_END
+
+#endif /* __SVM_BAKE_H__ */
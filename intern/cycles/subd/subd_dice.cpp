@@ -31,36 +31,44 @@ EdgeDice::EdgeDice(const SubdParams& params_)
 {
 	mesh_P = NULL;
 	mesh_N = NULL;
+	mesh_ptex_uv = NULL;
+	mesh_ptex_face_id = NULL;
 	vert_offset = 0;
-
-	params.mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
-
-	if(params.ptex) {
-		params.mesh->attributes.add(ATTR_STD_PTEX_UV);
-		params.mesh->attributes.add(ATTR_STD_PTEX_FACE_ID);
-	}
+	tri_offset = 0;
 }
 
-void EdgeDice::reserve(int num_verts)
+void EdgeDice::reserve(int num_verts, int num_triangles)
 {
 	Mesh *mesh = params.mesh;
 
 	vert_offset = mesh->verts.size();
 	tri_offset = mesh->num_triangles();
 
-	/* todo: optimize so we can reserve in advance, this is like push_back_slow() */
-	if(vert_offset + num_verts > mesh->verts.capacity()) {
-		mesh->reserve_mesh(size_t((vert_offset + num_verts) * 1.2), mesh->num_triangles());
-	}
-
-	mesh->resize_mesh(vert_offset + num_verts, tri_offset);
+	mesh->resize_mesh(vert_offset + num_verts, tri_offset + num_triangles);
+	mesh->num_subd_verts += num_verts;
 
+	/* attributes are resized along with the mesh, get pointers once here
+	 * since adding attributes is not safe to do from multiple threads */
 	Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
 
+	if(params.ptex) {
+		Attribute *attr_ptex_uv = mesh->attributes.add(ATTR_STD_PTEX_UV);
+		Attribute *attr_ptex_face_id = mesh->attributes.add(ATTR_STD_PTEX_FACE_ID);
+
+		mesh_ptex_uv = attr_ptex_uv->data_float3();
+		mesh_ptex_face_id = attr_ptex_face_id->data_float();
+	}
+
 	mesh_P = mesh->verts.data();
 	mesh_N = attr_vN->data_float3();
 }
 
+void EdgeDice::set_offset(size_t vert_offset_, size_t tri_offset_)
+{
+	vert_offset = vert_offset_;
+	tri_offset = tri_offset_;
+}
+
 int EdgeDice::add_vert(Patch *patch, float2 uv)
 {
 	float3 P, N;
@@ -74,15 +82,9 @@ int EdgeDice::add_vert(Patch *patch, float2 uv)
 	params.mesh->vert_patch_uv[vert_offset] = make_float2(uv.x, uv.y);
 
 	if(params.ptex) {
-		Attribute *attr_ptex_uv = params.mesh->attributes.add(ATTR_STD_PTEX_UV);
-		params.mesh->attributes.resize();
-
-		float3 *ptex_uv = attr_ptex_uv->data_float3();
-		ptex_uv[vert_offset] = make_float3(uv.x, uv.y, 0.0f);
+		mesh_ptex_uv[vert_offset] = make_float3(uv.x, uv.y, 0.0f);
 	}
 
-	params.mesh->num_subd_verts++;
-
 	return vert_offset++;
 }
 
@@ -90,19 +92,17 @@ void EdgeDice::add_triangle(Patch *patch, int v0, int v1, int v2)
 {
 	Mesh *mesh = params.mesh;
 
-	/* todo: optimize so we can reserve in advance, this is like push_back_slow() */
-	if(mesh->triangles.size() == mesh->triangles.capacity())
-		mesh->reserve_mesh(mesh->verts.size(), size_t(max(mesh->num_triangles() + 1, 1) * 1.2));
+	assert(tri_offset < mesh->num_triangles());
 
-	mesh->add_triangle(v0, v1, v2, patch->shader, true);
-	params.mesh->triangle_patch[params.mesh->num_triangles()-1] = patch->patch_index;
+	mesh->triangles[tri_offset*3 + 0] = v0;
+	mesh->triangles[tri_offset*3 + 1] = v1;
+	mesh->triangles[tri_offset*3 + 2] = v2;
+	mesh->shader[tri_offset] = patch->shader;
+	mesh->smooth[tri_offset] = true;
+	mesh->triangle_patch[tri_offset] = patch->patch_index;
 
 	if(params.ptex) {
-		Attribute *attr_ptex_face_id = params.mesh->attributes.add(ATTR_STD_PTEX_FACE_ID);
-		params.mesh->attributes.resize();
-
-		float *ptex_face_id = attr_ptex_face_id->data_float();
-		ptex_face_id[tri_offset] = (float)patch->ptex_face_id();
+		mesh_ptex_face_id[tri_offset] = (float)patch->ptex_face_id();
 	}
 
 	tri_offset++;
@@ -152,11 +152,28 @@ QuadDice::QuadDice(const SubdParams& params_)
 {
 }
 
-void QuadDice::reserve(EdgeFactors& ef, int Mu, int Mv)
+void QuadDice::grid_size(EdgeFactors& ef, int *Mu, int *Mv)
 {
+	/* compute inner grid size with scale factor */
+	int mu = max(ef.tu0, ef.tu1);
+	int mv = max(ef.tv0, ef.tv1);
+
+	*Mu = max(mu, 2); // XXX handle 0 & 1?
+	*Mv = max(mv, 2); // XXX handle 0 & 1?
+}
+
+void QuadDice::count(EdgeFactors& ef, int *num_verts, int *num_triangles)
+{
+	int Mu, Mv;
+	grid_size(ef, &Mu, &Mv);
+
 	/* XXX need to make this also work for edge factor 0 and 1 */
-	int num_verts = (ef.tu0 + ef.tu1 + ef.tv0 + ef.tv1) + (Mu - 1)*(Mv - 1);
-	EdgeDice::reserve(num_verts);
+	*num_verts = (ef.tu0 + ef.tu1 + ef.tv0 + ef.tv1) + (Mu - 1)*(Mv - 1);
+
+	/* inner grid, and stitching of each side to the inner grid */
+	*num_triangles = 2*(Mu - 2)*(Mv - 2) +
+	                 (ef.tu0 + ef.tu1 + ef.tv0 + ef.tv1) +
+	                 2*(Mu - 2) + 2*(Mv - 2);
 }
 
 float2 QuadDice::map_uv(SubPatch& sub, float u, float v)
@@ -307,22 +324,25 @@ void QuadDice::add_grid(SubPatch& sub, int Mu, int Mv, int offset)
 
 void QuadDice::dice(SubPatch& sub, EdgeFactors& ef)
 {
-	/* compute inner grid size with scale factor */
-	int Mu = max(ef.tu0, ef.tu1);
-	int Mv = max(ef.tv0, ef.tv1);
+	int Mu, Mv;
+	grid_size(ef, &Mu, &Mv);
 
 #if 0 /* Doesnt work very well, especially at grazing angles. */
 	float S = scale_factor(sub, ef, Mu, Mv);
-#else
-	float S = 1.0f;
+	Mu = max((int)ceil(S*Mu), 2);
+	Mv = max((int)ceil(S*Mv), 2);
 #endif
 
-	Mu = max((int)ceil(S*Mu), 2); // XXX handle 0 & 1?
-	Mv = max((int)ceil(S*Mv), 2); // XXX handle 0 & 1?
+#ifndef NDEBUG
+	int num_verts, num_triangles;
+	count(ef, &num_verts, &num_triangles);
+
+	size_t vert_end = vert_offset + num_verts;
+	size_t tri_end = tri_offset + num_triangles;
+#endif
 
-	/* reserve space for new verts */
-	int offset = params.mesh->verts.size();
-	reserve(ef, Mu, Mv);
+	/* verts were reserved in advance */
+	int offset = vert_offset;
 
 	/* corners and inner grid */
 	add_corners(sub);
@@ -346,7 +366,8 @@ void QuadDice::dice(SubPatch& sub, EdgeFactors& ef)
 	add_side_v(sub, outer, inner, Mu, Mv, ef.tv1, 1, offset);
 	stitch_triangles(sub.patch, outer, inner);
 
-	assert(vert_offset == params.mesh->verts.size());
+	assert(vert_offset == vert_end);
+	assert(tri_offset == tri_end);
 }
 
 CCL_NAMESPACE_END
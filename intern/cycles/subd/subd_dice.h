@@ -56,19 +56,25 @@ struct SubdParams {
 
 };
 
-/* EdgeDice Base */
+/* EdgeDice Base
+ *
+ * Space for all verts and triangles is allocated in the mesh up front, after
+ * which multiple dicers can fill in disjoint ranges from different threads. */
 
 class EdgeDice {
 public:
 	SubdParams params;
 	float3 *mesh_P;
 	float3 *mesh_N;
+	float3 *mesh_ptex_uv;
+	float *mesh_ptex_face_id;
 	size_t vert_offset;
 	size_t tri_offset;
 
 	explicit EdgeDice(const SubdParams& params);
 
-	void reserve(int num_verts);
+	void reserve(int num_verts, int num_triangles);
+	void set_offset(size_t vert_offset, size_t tri_offset);
 
 	int add_vert(Patch *patch, float2 uv);
 	void add_triangle(Patch *patch, int v0, int v1, int v2);
@@ -109,7 +115,8 @@ public:
 
 	explicit QuadDice(const SubdParams& params);
 
-	void reserve(EdgeFactors& ef, int Mu, int Mv);
+	void grid_size(EdgeFactors& ef, int *Mu, int *Mv);
+	void count(EdgeFactors& ef, int *num_verts, int *num_triangles);
 	float3 eval_projected(SubPatch& sub, float u, float v);
 
 	float2 map_uv(SubPatch& sub, float u, float v);
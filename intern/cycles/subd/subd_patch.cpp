@@ -25,6 +25,26 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* Patch */
+
+Patch::Patch()
+{
+	patch_index = 0;
+	shader = 0;
+
+	for(int side = 0; side < 4; side++) {
+		set_edge(side, -1, -1, 0.0f, 1.0f);
+	}
+}
+
+void Patch::set_edge(int side, int v0, int v1, float t0, float t1)
+{
+	edges[side].v0 = v0;
+	edges[side].v1 = v1;
+	edges[side].t0 = t0;
+	edges[side].t1 = t1;
+}
+
 /* De Casteljau Evaluation */
 
 static void decasteljau_cubic(float3 *P, float3 *dt, float t, const float3 cp[4])
@@ -22,15 +22,30 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* Mesh edge a side of a patch lies on, used to share edge tessellation
+ * factors with the patch on the other side of the edge. */
+
+struct PatchEdge {
+	/* Mesh vertices of the edge, -1 for sides inside a face. */
+	int v0, v1;
+	/* Position of the start and end of the side along the edge. */
+	float t0, t1;
+};
+
 class Patch {
 public:
+	Patch();
 	virtual ~Patch() {}
 	virtual void eval(float3 *P, float3 *dPdu, float3 *dPdv, float3 *N, float u, float v) = 0;
 	virtual BoundBox bound() = 0;
 	virtual int ptex_face_id() { return -1; }
 
+	void set_edge(int side, int v0, int v1, float t0, float t1);
+
 	int patch_index;
 	int shader;
+	/* Sides in the order of the quad dice edge factors tu0, tu1, tv0, tv1. */
+	PatchEdge edges[4];
 };
 
 /* Linear Quad Patch */
@@ -22,11 +22,51 @@
 #include "subd/subd_split.h"
 
 #include "util/util_debug.h"
+#include "util/util_hash.h"
 #include "util/util_math.h"
+#include "util/util_task.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
 
+/* EdgeFactorCache */
+
+bool EdgeFactorCache::Key::operator<(const Key& other) const
+{
+	if(v0 != other.v0) return v0 < other.v0;
+	if(v1 != other.v1) return v1 < other.v1;
+	if(t0 != other.t0) return t0 < other.t0;
+	return t1 < other.t1;
+}
+
+EdgeFactorCache::Partition& EdgeFactorCache::partition(const Key& key)
+{
+	uint h = hash_int_2d(key.v0, key.v1);
+	return partitions[h % NUM_PARTITIONS];
+}
+
+bool EdgeFactorCache::find(const Key& key, int *T)
+{
+	Partition& part = partition(key);
+	thread_scoped_lock lock(part.mutex);
+
+	map<Key, int>::iterator it = part.factors.find(key);
+	if(it == part.factors.end())
+		return false;
+
+	*T = it->second;
+	return true;
+}
+
+int EdgeFactorCache::insert(const Key& key, int T)
+{
+	Partition& part = partition(key);
+	thread_scoped_lock lock(part.mutex);
+
+	/* if another thread computed the factor in the meantime, use that one */
+	return part.factors.insert(std::make_pair(key, T)).first->second;
+}
+
 /* DiagSplit */
 
 DiagSplit::DiagSplit(const SubdParams& params_)
@@ -34,10 +74,10 @@ DiagSplit::DiagSplit(const SubdParams& params_)
 {
 }
 
-void DiagSplit::dispatch(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef)
+void DiagSplit::dispatch(SplitTask& task, QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef)
 {
-	subpatches_quad.push_back(sub);
-	edgefactors_quad.push_back(ef);
+	task.subpatches.push_back(sub);
+	task.edgefactors.push_back(ef);
 }
 
 float3 DiagSplit::to_world(Patch *patch, float2 uv)
@@ -51,7 +91,70 @@ float3 DiagSplit::to_world(Patch *patch, float2 uv)
 	return P;
 }
 
+bool DiagSplit::edge_key(Patch *patch, float2 Pstart, float2 Pend, EdgeFactorCache::Key *key)
+{
+	/* find patch side the segment lies on, and its position along the side */
+	int side;
+	float s0, s1;
+
+	if(Pstart.y == 0.0f && Pend.y == 0.0f) {
+		side = 0; s0 = Pstart.x; s1 = Pend.x;
+	}
+	else if(Pstart.y == 1.0f && Pend.y == 1.0f) {
+		side = 1; s0 = Pstart.x; s1 = Pend.x;
+	}
+	else if(Pstart.x == 0.0f && Pend.x == 0.0f) {
+		side = 2; s0 = Pstart.y; s1 = Pend.y;
+	}
+	else if(Pstart.x == 1.0f && Pend.x == 1.0f) {
+		side = 3; s0 = Pstart.y; s1 = Pend.y;
+	}
+	else {
+		return false;
+	}
+
+	const PatchEdge& edge = patch->edges[side];
+
+	if(edge.v0 < 0 || edge.v1 < 0)
+		return false;
+
+	/* map to the mesh edge, oriented the same way for the patches on both
+	 * sides. segments are split at midpoints so this is exact. */
+	float t0 = edge.t0 + (edge.t1 - edge.t0)*s0;
+	float t1 = edge.t0 + (edge.t1 - edge.t0)*s1;
+
+	if(edge.v0 < edge.v1) {
+		key->v0 = edge.v0;
+		key->v1 = edge.v1;
+	}
+	else {
+		key->v0 = edge.v1;
+		key->v1 = edge.v0;
+		t0 = 1.0f - t0;
+		t1 = 1.0f - t1;
+	}
+
+	key->t0 = min(t0, t1);
+	key->t1 = max(t0, t1);
+
+	return true;
+}
+
 int DiagSplit::T(Patch *patch, float2 Pstart, float2 Pend)
+{
+	EdgeFactorCache::Key key;
+
+	if(!edge_key(patch, Pstart, Pend, &key))
+		return T_eval(patch, Pstart, Pend);
+
+	int t;
+	if(edge_cache.find(key, &t))
+		return t;
+
+	return edge_cache.insert(key, T_eval(patch, Pstart, Pend));
+}
+
+int DiagSplit::T_eval(Patch *patch, float2 Pstart, float2 Pend)
 {
 	float3 Plast = make_float3(0.0f, 0.0f, 0.0f);
 	float Lsum = 0.0f;
@@ -124,7 +227,7 @@ static void limit_edge_factors(const QuadDice::SubPatch& sub, QuadDice::EdgeFact
 	ef.tv1 = tv1 <= 1 ? 1 : min(ef.tv1, tv1);
 }
 
-void DiagSplit::split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int depth)
+void DiagSplit::split(SplitTask& task, QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int depth)
 {
 	if(depth > 32) {
 		/* We should never get here, but just in case end recursion safely. */
@@ -133,7 +236,7 @@ void DiagSplit::split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int de
 		ef.tv0 = 1;
 		ef.tv1 = 1;
 
-		dispatch(sub, ef);
+		dispatch(task, sub, ef);
 		return;
 	}
 
@@ -179,8 +282,8 @@ void DiagSplit::split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int de
 		limit_edge_factors(sub0, ef0, 1 << params.max_level);
 		limit_edge_factors(sub1, ef1, 1 << params.max_level);
 
-		split(sub0, ef0, depth+1);
-		split(sub1, ef1, depth+1);
+		split(task, sub0, ef0, depth+1);
+		split(task, sub1, ef1, depth+1);
 	}
 	else if(split_v) {
 		/* partition edges */
@@ -207,55 +310,109 @@ void DiagSplit::split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int de
 		limit_edge_factors(sub0, ef0, 1 << params.max_level);
 		limit_edge_factors(sub1, ef1, 1 << params.max_level);
 
-		split(sub0, ef0, depth+1);
-		split(sub1, ef1, depth+1);
+		split(task, sub0, ef0, depth+1);
+		split(task, sub1, ef1, depth+1);
 	}
 	else {
-		dispatch(sub, ef);
+		dispatch(task, sub, ef);
 	}
 }
 
-void DiagSplit::split_quad(Patch *patch, QuadDice::SubPatch *subpatch)
+void DiagSplit::split_task(const vector<QuadDice::SubPatch> *patches, SplitTask *task)
 {
-	QuadDice::SubPatch sub_split;
-	QuadDice::EdgeFactors ef_split;
+	QuadDice dice(params);
 
-	if(subpatch) {
-		sub_split = *subpatch;
-	}
-	else {
-		sub_split.patch = patch;
-		sub_split.P00 = make_float2(0.0f, 0.0f);
-		sub_split.P10 = make_float2(1.0f, 0.0f);
-		sub_split.P01 = make_float2(0.0f, 1.0f);
-		sub_split.P11 = make_float2(1.0f, 1.0f);
-	}
+	task->num_verts = 0;
+	task->num_triangles = 0;
 
-	ef_split.tu0 = T(patch, sub_split.P00, sub_split.P10);
-	ef_split.tu1 = T(patch, sub_split.P01, sub_split.P11);
-	ef_split.tv0 = T(patch, sub_split.P00, sub_split.P01);
-	ef_split.tv1 = T(patch, sub_split.P10, sub_split.P11);
+	for(size_t i = task->start; i < task->end; i++) {
+		QuadDice::SubPatch sub_split = (*patches)[i];
+		QuadDice::EdgeFactors ef_split;
+		Patch *patch = sub_split.patch;
 
-	limit_edge_factors(sub_split, ef_split, 1 << params.max_level);
+		ef_split.tu0 = T(patch, sub_split.P00, sub_split.P10);
+		ef_split.tu1 = T(patch, sub_split.P01, sub_split.P11);
+		ef_split.tv0 = T(patch, sub_split.P00, sub_split.P01);
+		ef_split.tv1 = T(patch, sub_split.P10, sub_split.P11);
 
-	split(sub_split, ef_split);
+		limit_edge_factors(sub_split, ef_split, 1 << params.max_level);
 
-	QuadDice dice(params);
+		split(*task, sub_split, ef_split);
+	}
 
-	for(size_t i = 0; i < subpatches_quad.size(); i++) {
-		QuadDice::SubPatch& sub = subpatches_quad[i];
-		QuadDice::EdgeFactors& ef = edgefactors_quad[i];
+	/* count verts and triangles, so the mesh can be resized once for all tasks */
+	for(size_t i = 0; i < task->subpatches.size(); i++) {
+		QuadDice::EdgeFactors& ef = task->edgefactors[i];
 
 		ef.tu0 = max(ef.tu0, 1);
 		ef.tu1 = max(ef.tu1, 1);
 		ef.tv0 = max(ef.tv0, 1);
 		ef.tv1 = max(ef.tv1, 1);
 
-		dice.dice(sub, ef);
+		int num_verts, num_triangles;
+		dice.count(ef, &num_verts, &num_triangles);
+
+		task->num_verts += num_verts;
+		task->num_triangles += num_triangles;
+	}
+}
+
+void DiagSplit::dice_task(const QuadDice *dice, SplitTask *task)
+{
+	QuadDice task_dice(*dice);
+	task_dice.set_offset(task->vert_offset, task->tri_offset);
+
+	for(size_t i = 0; i < task->subpatches.size(); i++) {
+		task_dice.dice(task->subpatches[i], task->edgefactors[i]);
+	}
+}
+
+void DiagSplit::split_quads(const vector<QuadDice::SubPatch>& patches)
+{
+	/* split patches into subpatches */
+	size_t num_tasks = divide_up(patches.size(), DSPLIT_PATCHES_PER_TASK);
+	vector<SplitTask> tasks(num_tasks);
+
+	TaskPool pool;
+
+	for(size_t i = 0; i < num_tasks; i++) {
+		tasks[i].start = i * DSPLIT_PATCHES_PER_TASK;
+		tasks[i].end = std::min(tasks[i].start + DSPLIT_PATCHES_PER_TASK, patches.size());
+
+		pool.push(function_bind(&DiagSplit::split_task, this, &patches, &tasks[i]));
+	}
+
+	pool.wait_work();
+
+	/* allocate mesh, keeping verts and triangles in patch order so the
+	 * result is the same as when dicing one patch at a time */
+	size_t num_verts = 0, num_triangles = 0;
+
+	for(size_t i = 0; i < num_tasks; i++) {
+		num_verts += tasks[i].num_verts;
+		num_triangles += tasks[i].num_triangles;
+	}
+
+	QuadDice dice(params);
+	dice.reserve(num_verts, num_triangles);
+
+	size_t vert_offset = dice.vert_offset;
+	size_t tri_offset = dice.tri_offset;
+
+	for(size_t i = 0; i < num_tasks; i++) {
+		tasks[i].vert_offset = vert_offset;
+		tasks[i].tri_offset = tri_offset;
+
+		vert_offset += tasks[i].num_verts;
+		tri_offset += tasks[i].num_triangles;
+	}
+
+	/* dice subpatches */
+	for(size_t i = 0; i < num_tasks; i++) {
+		pool.push(function_bind(&DiagSplit::dice_task, this, &dice, &tasks[i]));
 	}
 
-	subpatches_quad.clear();
-	edgefactors_quad.clear();
+	pool.wait_work();
 }
 
 CCL_NAMESPACE_END
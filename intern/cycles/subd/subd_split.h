@@ -24,6 +24,8 @@
 
 #include "subd/subd_dice.h"
 
+#include "util/util_map.h"
+#include "util/util_thread.h"
 #include "util/util_types.h"
 #include "util/util_vector.h"
 
@@ -34,11 +36,42 @@ class Patch;
 
 #define DSPLIT_NON_UNIFORM -1
 
-class DiagSplit {
+/* Number of patches split and diced by a single task. */
+#define DSPLIT_PATCHES_PER_TASK 32
+
+/* Edge tessellation factors of mesh edges, shared by the patches on either
+ * side of an edge. The first factor computed for an edge is the one used by
+ * both patches, so evaluating the patches in parallel and in any order still
+ * gives crack-free tessellation. */
+
+class EdgeFactorCache {
 public:
-	vector<QuadDice::SubPatch> subpatches_quad;
-	vector<QuadDice::EdgeFactors> edgefactors_quad;
+	struct Key {
+		/* Mesh vertices with v0 < v1, and the edge segment between them. */
+		int v0, v1;
+		float t0, t1;
+
+		bool operator<(const Key& other) const;
+	};
+
+	bool find(const Key& key, int *T);
+	int insert(const Key& key, int T);
+
+protected:
+	enum { NUM_PARTITIONS = 64 };
+
+	struct Partition {
+		thread_mutex mutex;
+		map<Key, int> factors;
+	};
+
+	Partition& partition(const Key& key);
+
+	Partition partitions[NUM_PARTITIONS];
+};
 
+class DiagSplit {
+public:
 	SubdParams params;
 
 	explicit DiagSplit(const SubdParams& params);
@@ -48,10 +81,33 @@ public:
 	void partition_edge(Patch *patch, float2 *P, int *t0, int *t1,
 		float2 Pstart, float2 Pend, int t);
 
-	void dispatch(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef);
-	void split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int depth=0);
+	/* Split and dice (parts of) patches into the mesh. Patches are split in
+	 * parallel, after which the mesh is resized and diced in parallel. */
+	void split_quads(const vector<QuadDice::SubPatch>& patches);
+
+protected:
+	/* Subpatches resulting from splitting a range of patches, along with the
+	 * range of verts and triangles they are diced into. */
+	struct SplitTask {
+		size_t start, end;
+
+		vector<QuadDice::SubPatch> subpatches;
+		vector<QuadDice::EdgeFactors> edgefactors;
+
+		size_t num_verts, num_triangles;
+		size_t vert_offset, tri_offset;
+	};
+
+	bool edge_key(Patch *patch, float2 Pstart, float2 Pend, EdgeFactorCache::Key *key);
+	int T_eval(Patch *patch, float2 Pstart, float2 Pend);
+
+	void dispatch(SplitTask& task, QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef);
+	void split(SplitTask& task, QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int depth=0);
+
+	void split_task(const vector<QuadDice::SubPatch> *patches, SplitTask *task);
+	void dice_task(const QuadDice *dice, SplitTask *task);
 
-	void split_quad(Patch *patch, QuadDice::SubPatch *subpatch=NULL);
+	EdgeFactorCache edge_cache;
 };
 
 CCL_NAMESPACE_END
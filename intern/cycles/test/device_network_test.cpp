@@ -0,0 +1,174 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+#include "device/device_network.h"
+
+#include "util/util_stats.h"
+#include "util/util_task.h"
+#include "util/util_thread.h"
+#include "util/util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Render server on the loopback interface, serving a single client. */
+struct LoopbackServer {
+	LoopbackServer(Device *device_)
+	: device(device_),
+	  acceptor(io_service, tcp::endpoint(boost::asio::ip::address_v4::loopback(), SERVER_PORT))
+	{
+		server_thread = new thread(function_bind(&LoopbackServer::run, this));
+	}
+
+	~LoopbackServer()
+	{
+		server_thread->join();
+		delete server_thread;
+	}
+
+	void run()
+	{
+		device_server_accept(device, io_service, acceptor);
+	}
+
+	Device *device;
+	boost::asio::io_service io_service;
+	tcp::acceptor acceptor;
+	thread *server_thread;
+};
+
+static const int NUM_SCENE_BUFFERS = 64;
+static const size_t SCENE_BUFFER_SIZE = 1024*1024;
+static const int NUM_TILES = 64;
+static const int TILE_SIZE = 128;
+
+/* Smoothly varying values, compressible like most scene data. */
+static void fill_buffer(device_vector<float>& mem, size_t size, int seed)
+{
+	float *data = mem.resize(size);
+	for(size_t i = 0; i < size; i++) {
+		data[i] = (float)((i / 16 + seed) % 1024);
+	}
+}
+
+static bool verify_buffer(device_vector<float>& mem, int seed)
+{
+	float *data = (float*)mem.data_pointer;
+	for(size_t i = 0; i < mem.size(); i++) {
+		if(data[i] != (float)((i / 16 + seed) % 1024)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void measure_throughput(Device *device, bool use_compression)
+{
+	network_compression_set(use_compression);
+
+	/* Scene upload, many buffers queued on the connection at once. */
+	vector<device_vector<float>*> scene_buffers;
+	for(int i = 0; i < NUM_SCENE_BUFFERS; i++) {
+		device_vector<float> *mem = new device_vector<float>();
+		fill_buffer(*mem, SCENE_BUFFER_SIZE, i);
+		scene_buffers.push_back(mem);
+	}
+
+	double start_time = time_dt();
+	for(int i = 0; i < NUM_SCENE_BUFFERS; i++) {
+		device->mem_alloc("scene", *scene_buffers[i], MEM_READ_ONLY);
+		device->mem_copy_to(*scene_buffers[i]);
+	}
+
+	/* Reading back waits for all queued requests to be handled. */
+	device_vector<float> &last = *scene_buffers.back();
+	memset((void*)last.data_pointer, 0, last.memory_size());
+	device->mem_copy_from(last, 0, 1, 1, last.memory_size());
+	double upload_time = time_dt() - start_time;
+
+	EXPECT_TRUE(verify_buffer(last, NUM_SCENE_BUFFERS - 1));
+
+	/* Tile return. */
+	vector<device_vector<float>*> tiles;
+	for(int i = 0; i < NUM_TILES; i++) {
+		device_vector<float> *mem = new device_vector<float>();
+		fill_buffer(*mem, TILE_SIZE*TILE_SIZE*4, i);
+		device->mem_alloc("tile", *mem, MEM_READ_WRITE);
+		device->mem_copy_to(*mem);
+		memset((void*)mem->data_pointer, 0, mem->memory_size());
+		tiles.push_back(mem);
+	}
+
+	start_time = time_dt();
+	for(int i = 0; i < NUM_TILES; i++) {
+		device->mem_copy_from(*tiles[i], 0, TILE_SIZE, TILE_SIZE, 4*sizeof(float));
+	}
+	double tile_time = time_dt() - start_time;
+
+	for(int i = 0; i < NUM_TILES; i++) {
+		EXPECT_TRUE(verify_buffer(*tiles[i], i));
+		device->mem_free(*tiles[i]);
+		delete tiles[i];
+	}
+	for(int i = 0; i < NUM_SCENE_BUFFERS; i++) {
+		device->mem_free(*scene_buffers[i]);
+		delete scene_buffers[i];
+	}
+
+	double scene_mb = NUM_SCENE_BUFFERS * SCENE_BUFFER_SIZE * sizeof(float) / (1024.0*1024.0);
+	double tile_mb = NUM_TILES * TILE_SIZE * TILE_SIZE * 4 * sizeof(float) / (1024.0*1024.0);
+
+	printf("%s: scene upload %.1f MB/s, tile return %.1f MB/s\n",
+	       (use_compression)? "compressed": "uncompressed",
+	       scene_mb / max(upload_time, 1e-6),
+	       tile_mb / max(tile_time, 1e-6));
+}
+
+}  // namespace
+
+TEST(device_network, loopback_throughput) {
+	TaskScheduler::init(0);
+
+	Stats server_stats;
+	DeviceInfo server_info;
+	Device *server_device = Device::create(server_info, server_stats, true);
+	ASSERT_TRUE(server_device != NULL);
+
+	{
+		LoopbackServer server(server_device);
+
+		Stats stats;
+		DeviceInfo info;
+		info.type = DEVICE_NETWORK;
+		Device *device = Device::create(info, stats, true);
+		EXPECT_TRUE(device != NULL);
+
+		measure_throughput(device, false);
+		measure_throughput(device, true);
+
+		/* Disconnects, which stops the server. */
+		delete device;
+	}
+
+	delete server_device;
+	TaskScheduler::exit();
+}
+
+CCL_NAMESPACE_END
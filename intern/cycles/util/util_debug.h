@@ -49,6 +49,10 @@ public:
 
 		/* Whether split kernel is used */
 		bool split_kernel;
+
+		/* Whether shader programs are baked into native code. Requires a
+		 * system C++ compiler and the kernel sources at run-time. */
+		bool svm_bake;
 	};
 
 	/* Descriptor of CUDA feature-set to be used. */
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/util_dynlib.h"
+
+#ifdef _WIN32
+#  include "util/util_windows.h"
+#else
+#  include <dlfcn.h>
+#endif
+
+CCL_NAMESPACE_BEGIN
+
+#ifdef _WIN32
+
+struct DynamicLibrary {
+	HMODULE handle;
+};
+
+DynamicLibrary *dynlib_open(const string& path)
+{
+	HMODULE handle = LoadLibraryA(path.c_str());
+
+	if(!handle) {
+		return NULL;
+	}
+
+	DynamicLibrary *lib = new DynamicLibrary();
+	lib->handle = handle;
+	return lib;
+}
+
+void *dynlib_find_symbol(DynamicLibrary *lib, const char *symbol)
+{
+	return (void*)GetProcAddress(lib->handle, symbol);
+}
+
+string dynlib_error(DynamicLibrary * /*lib*/)
+{
+	return string_printf("error code %d", (int)GetLastError());
+}
+
+void dynlib_close(DynamicLibrary *lib)
+{
+	FreeLibrary(lib->handle);
+	delete lib;
+}
+
+#else  /* _WIN32 */
+
+struct DynamicLibrary {
+	void *handle;
+};
+
+DynamicLibrary *dynlib_open(const string& path)
+{
+	void *handle = dlopen(path.c_str(), RTLD_LAZY | RTLD_LOCAL);
+
+	if(!handle) {
+		return NULL;
+	}
+
+	DynamicLibrary *lib = new DynamicLibrary();
+	lib->handle = handle;
+	return lib;
+}
+
+void *dynlib_find_symbol(DynamicLibrary *lib, const char *symbol)
+{
+	return dlsym(lib->handle, symbol);
+}
+
+string dynlib_error(DynamicLibrary * /*lib*/)
+{
+	const char *error = dlerror();
+	return (error)? error: "";
+}
+
+void dynlib_close(DynamicLibrary *lib)
+{
+	dlclose(lib->handle);
+	delete lib;
+}
+
+#endif  /* _WIN32 */
+
+CCL_NAMESPACE_END
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_DYNLIB_H__
+#define __UTIL_DYNLIB_H__
+
+/* Loading of shared libraries at run-time. */
+
+#include "util/util_string.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct DynamicLibrary;
+
+/* Returns NULL on failure, dynlib_error() then describes the problem. */
+DynamicLibrary *dynlib_open(const string& path);
+void *dynlib_find_symbol(DynamicLibrary *lib, const char *symbol);
+string dynlib_error(DynamicLibrary *lib);
+void dynlib_close(DynamicLibrary *lib);
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_DYNLIB_H__ */
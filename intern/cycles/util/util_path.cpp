@@ -36,8 +36,10 @@ OIIO_NAMESPACE_USING
 #else
 #  define DIR_SEP '/'
 #  include <dirent.h>
+#  include <fcntl.h>
 #  include <pwd.h>
 #  include <unistd.h>
+#  include <sys/mman.h>
 #  include <sys/types.h>
 #endif
 
@@ -755,6 +757,70 @@ bool path_read_text(const string& path, string& text)
 	return true;
 }
 
+const uint8_t *path_map_file(const string& path, size_t *r_size)
+{
+	size_t size = path_file_size(path);
+
+	*r_size = 0;
+	if(size == 0 || size == (size_t)-1) {
+		return NULL;
+	}
+
+#ifdef _WIN32
+	wstring path_wc = string_to_wstring(path_make_compatible(path));
+	HANDLE file = CreateFileW(path_wc.c_str(),
+	                          GENERIC_READ,
+	                          FILE_SHARE_READ,
+	                          NULL,
+	                          OPEN_EXISTING,
+	                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+	                          NULL);
+	if(file == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	void *data = NULL;
+	if(mapping != NULL) {
+		data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		/* The view keeps the mapping alive. */
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if(data == NULL) {
+		return NULL;
+	}
+#else  /* _WIN32 */
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd == -1) {
+		return NULL;
+	}
+	void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED) {
+		return NULL;
+	}
+#  ifdef MADV_SEQUENTIAL
+	madvise(data, size, MADV_SEQUENTIAL);
+#  endif
+#endif  /* _WIN32 */
+
+	*r_size = size;
+	return (const uint8_t*)data;
+}
+
+void path_unmap_file(const uint8_t *data, size_t size)
+{
+	if(data == NULL) {
+		return;
+	}
+#ifdef _WIN32
+	(void)size;
+	UnmapViewOfFile(data);
+#else
+	munmap((void*)data, size);
+#endif
+}
+
 uint64_t path_modified_time(const string& path)
 {
 	path_stat_t st;
@@ -62,6 +62,10 @@ bool path_write_text(const string& path, string& text);
 bool path_read_binary(const string& path, vector<uint8_t>& binary);
 bool path_read_text(const string& path, string& text);
 
+/* read-only memory mapping of a whole file, returns NULL on failure */
+const uint8_t *path_map_file(const string& path, size_t *r_size);
+void path_unmap_file(const uint8_t *data, size_t size);
+
 /* File manipulation. */
 bool path_remove(const string& path);
 
@@ -200,6 +200,13 @@ public:
 		total_pixel_samples = total_pixel_samples_;
 	}
 
+	uint64_t get_pixel_samples()
+	{
+		thread_scoped_lock lock(progress_mutex);
+
+		return pixel_samples;
+	}
+
 	float get_progress()
 	{
 		if(total_pixel_samples > 0) {
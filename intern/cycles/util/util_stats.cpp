@@ -0,0 +1,163 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "util/util_stats.h"
+
+CCL_NAMESPACE_BEGIN
+
+void Stats::kernel_add(const KernelStats& thread_stats, double ticks_per_second)
+{
+	thread_scoped_lock lock(kernel_mutex);
+
+	for(int type = 0; type < STATS_RAY_NUM_TYPES; type++) {
+		for(int bounce = 0; bounce < STATS_MAX_BOUNCES; bounce++) {
+			kernel.rays[type][bounce] += thread_stats.rays[type][bounce];
+		}
+	}
+
+	kernel.bvh_traversed_nodes += thread_stats.bvh_traversed_nodes;
+	kernel.bvh_traversed_instances += thread_stats.bvh_traversed_instances;
+	kernel.bvh_intersections += thread_stats.bvh_intersections;
+
+	size_t num_shaders = thread_stats.shader_ticks.size();
+	if(kernel.shader_evals.size() < num_shaders) {
+		kernel.shader_ticks.resize(num_shaders, 0);
+		kernel.shader_evals.resize(num_shaders, 0);
+		kernel_shader_time.resize(num_shaders, 0.0);
+	}
+
+	double seconds_per_tick = (ticks_per_second > 0.0)? 1.0 / ticks_per_second: 0.0;
+
+	for(size_t i = 0; i < num_shaders; i++) {
+		kernel.shader_ticks[i] += thread_stats.shader_ticks[i];
+		kernel.shader_evals[i] += thread_stats.shader_evals[i];
+		kernel_shader_time[i] += thread_stats.shader_ticks[i] * seconds_per_tick;
+	}
+
+	kernel_stats_used = true;
+}
+
+uint64_t Stats::kernel_rays_total() const
+{
+	uint64_t total = 0;
+
+	for(int type = 0; type < STATS_RAY_NUM_TYPES; type++) {
+		for(int bounce = 0; bounce < STATS_MAX_BOUNCES; bounce++) {
+			total += kernel.rays[type][bounce];
+		}
+	}
+
+	return total;
+}
+
+static bool shader_time_greater(const std::pair<double, int>& a,
+                                const std::pair<double, int>& b)
+{
+	return a.first > b.first;
+}
+
+string Stats::kernel_summary(const vector<string>& shader_names) const
+{
+	if(!kernel_stats_used) {
+		return "";
+	}
+
+	string summary = "Kernel statistics:\n\n";
+
+	/* Rays per type and bounce, up to the deepest bounce reached. */
+	int num_bounces = 1;
+	for(int type = 0; type < STATS_RAY_NUM_TYPES; type++) {
+		for(int bounce = 0; bounce < STATS_MAX_BOUNCES; bounce++) {
+			if(kernel.rays[type][bounce]) {
+				num_bounces = std::max(num_bounces, bounce + 1);
+			}
+		}
+	}
+
+	summary += string_printf("  %-10s", "Rays");
+	for(int bounce = 0; bounce < num_bounces; bounce++) {
+		string label = (bounce == STATS_MAX_BOUNCES - 1)?
+		        string_printf("%d+", bounce): string_printf("%d", bounce);
+		summary += string_printf(" %12s", label.c_str());
+	}
+	summary += string_printf(" %14s\n", "Total");
+
+	for(int type = 0; type < STATS_RAY_NUM_TYPES; type++) {
+		uint64_t total = 0;
+
+		summary += string_printf("  %-10s", ray_name((StatsRay)type));
+		for(int bounce = 0; bounce < num_bounces; bounce++) {
+			summary += string_printf(" %12llu", (unsigned long long)kernel.rays[type][bounce]);
+			total += kernel.rays[type][bounce];
+		}
+		summary += string_printf(" %14llu\n", (unsigned long long)total);
+	}
+
+	/* BVH traversal, shadow rays are not included. */
+	uint64_t num_rays = kernel_rays_total();
+	for(int bounce = 0; bounce < STATS_MAX_BOUNCES; bounce++) {
+		num_rays -= kernel.rays[STATS_RAY_SHADOW][bounce];
+	}
+	double inv_num_rays = (num_rays)? 1.0 / num_rays: 0.0;
+
+	summary += string_printf("\n  %-24s %16s %12s\n", "BVH", "Total", "Per Ray");
+	summary += string_printf("  %-24s %16llu %12.2f\n", "Traversed nodes",
+	                         (unsigned long long)kernel.bvh_traversed_nodes,
+	                         kernel.bvh_traversed_nodes * inv_num_rays);
+	summary += string_printf("  %-24s %16llu %12.2f\n", "Traversed instances",
+	                         (unsigned long long)kernel.bvh_traversed_instances,
+	                         kernel.bvh_traversed_instances * inv_num_rays);
+	summary += string_printf("  %-24s %16llu %12.2f\n", "Intersections",
+	                         (unsigned long long)kernel.bvh_intersections,
+	                         kernel.bvh_intersections * inv_num_rays);
+
+	/* Shaders, most expensive first. */
+	vector<std::pair<double, int> > shaders;
+	double total_time = 0.0;
+
+	for(size_t i = 0; i < kernel.shader_evals.size(); i++) {
+		if(kernel.shader_evals[i]) {
+			shaders.push_back(std::make_pair(kernel_shader_time[i], (int)i));
+			total_time += kernel_shader_time[i];
+		}
+	}
+
+	std::sort(shaders.begin(), shaders.end(), shader_time_greater);
+
+	summary += string_printf("\n  %-24s %16s %12s %8s %12s\n",
+	                         "Shader", "Evaluations", "Time (s)", "Time %", "Per Eval (us)");
+
+	for(size_t i = 0; i < shaders.size(); i++) {
+		int id = shaders[i].second;
+		double time = shaders[i].first;
+		uint64_t evals = kernel.shader_evals[id];
+		string name = (id < (int)shader_names.size())?
+		        shader_names[id]: string_printf("Shader %d", id);
+
+		summary += string_printf("  %-24s %16llu %12.3f %8.2f %12.3f\n",
+		                         name.substr(0, 24).c_str(),
+		                         (unsigned long long)evals,
+		                         time,
+		                         (total_time > 0.0)? 100.0 * time / total_time: 0.0,
+		                         1e6 * time / evals);
+	}
+
+	return summary;
+}
+
+CCL_NAMESPACE_END
@@ -18,14 +18,102 @@
 #define __UTIL_STATS_H__
 
 #include "util/util_atomic.h"
+#include "util/util_string.h"
+#include "util/util_thread.h"
+#include "util/util_vector.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  else
+#    include <x86intrin.h>
+#  endif
+#  define __STATS_TSC__
+#endif
 
 CCL_NAMESPACE_BEGIN
 
+/* Stages of a render which are timed, see Stats::time_add(). */
+typedef enum StatsTime {
+	STATS_TIME_SCENE_UPDATE = 0,
+	STATS_TIME_TESSELLATE,
+	STATS_TIME_BVH_BUILD,
+	STATS_TIME_PATH_TRACE,
+	STATS_TIME_DENOISE,
+	STATS_TIME_FILM_CONVERT,
+	STATS_TIME_SHADER,
+
+	STATS_TIME_NUM_TYPES,
+} StatsTime;
+
+/* Ray types counted by the kernel statistics, see KernelStats. */
+typedef enum StatsRay {
+	STATS_RAY_CAMERA = 0,
+	STATS_RAY_REFLECT,
+	STATS_RAY_TRANSMIT,
+	STATS_RAY_VOLUME,
+	STATS_RAY_SHADOW,
+
+	STATS_RAY_NUM_TYPES,
+} StatsRay;
+
+/* Timestamp counter, cheap enough to read around every shader evaluation.
+ * Returns zero on platforms where it is not available. */
+ccl_device_inline uint64_t stats_ticks()
+{
+#ifdef __STATS_TSC__
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/* Rays of deeper bounces are counted in the last bounce. */
+#define STATS_MAX_BOUNCES 16
+
+/* Counters gathered by the CPU kernel in statistics mode. Every render
+ * thread has its own, which is merged into Stats when the thread is done,
+ * so the kernel can increment them without atomics. Shader times are in
+ * ticks of the CPU timestamp counter. */
+struct KernelStats {
+	KernelStats()
+	{
+		reset(0);
+	}
+
+	void reset(int num_shaders)
+	{
+		memset(rays, 0, sizeof(rays));
+		bvh_traversed_nodes = 0;
+		bvh_traversed_instances = 0;
+		bvh_intersections = 0;
+		shader_ticks.clear();
+		shader_ticks.resize(num_shaders, 0);
+		shader_evals.clear();
+		shader_evals.resize(num_shaders, 0);
+		path_shader_ticks = 0;
+	}
+
+	uint64_t rays[STATS_RAY_NUM_TYPES][STATS_MAX_BOUNCES];
+	uint64_t bvh_traversed_nodes;
+	uint64_t bvh_traversed_instances;
+	uint64_t bvh_intersections;
+	vector<uint64_t> shader_ticks;
+	vector<uint64_t> shader_evals;
+
+	/* Shader ticks of the path being traced, for the heatmap pass. */
+	uint64_t path_shader_ticks;
+};
+
 class Stats {
 public:
 	enum static_init_t { static_init = 0 };
 
-	Stats() : mem_used(0), mem_peak(0) {}
+	Stats() : mem_used(0), mem_peak(0), buffer_mem_used(0), buffer_mem_peak(0),
+	          kernel_stats_used(false)
+	{
+		time_reset();
+	}
 	explicit Stats(static_init_t) {}
 
 	void mem_alloc(size_t size) {
@@ -38,8 +126,81 @@ public:
 		atomic_sub_and_fetch_z(&mem_used, size);
 	}
 
+	/* Render buffers are also included in mem_used, this only tracks
+	 * them separately for reporting. */
+	void buffer_mem_alloc(size_t size) {
+		atomic_add_and_fetch_z(&buffer_mem_used, size);
+		atomic_update_max_z(&buffer_mem_peak, buffer_mem_used);
+	}
+
+	void buffer_mem_free(size_t size) {
+		assert(buffer_mem_used >= size);
+		atomic_sub_and_fetch_z(&buffer_mem_used, size);
+	}
+
+	/* Times are accumulated over all threads, so parallel stages may add
+	 * up to more than the wall clock time. */
+	void time_add(StatsTime type, double seconds) {
+		atomic_add_and_fetch_uint64(&time_usec[type], (uint64_t)(seconds*1e6));
+	}
+
+	double time_get(StatsTime type) const {
+		return (double)time_usec[type] * 1e-6;
+	}
+
+	static const char *time_name(StatsTime type) {
+		switch(type) {
+			case STATS_TIME_SCENE_UPDATE: return "scene_update";
+			case STATS_TIME_TESSELLATE: return "tessellate";
+			case STATS_TIME_BVH_BUILD: return "bvh_build";
+			case STATS_TIME_PATH_TRACE: return "path_trace";
+			case STATS_TIME_DENOISE: return "denoise";
+			case STATS_TIME_FILM_CONVERT: return "film_convert";
+			case STATS_TIME_SHADER: return "shader";
+			case STATS_TIME_NUM_TYPES: break;
+		}
+		return "unknown";
+	}
+
+	void time_reset() {
+		for(int i = 0; i < STATS_TIME_NUM_TYPES; i++) {
+			time_usec[i] = 0;
+		}
+	}
+
+	/* Merge kernel statistics of a render thread. The shader time is
+	 * converted from ticks using the tick rate measured by the thread. */
+	void kernel_add(const KernelStats& thread_stats, double ticks_per_second);
+
+	static const char *ray_name(StatsRay type) {
+		switch(type) {
+			case STATS_RAY_CAMERA: return "camera";
+			case STATS_RAY_REFLECT: return "reflect";
+			case STATS_RAY_TRANSMIT: return "transmit";
+			case STATS_RAY_VOLUME: return "volume";
+			case STATS_RAY_SHADOW: return "shadow";
+			case STATS_RAY_NUM_TYPES: break;
+		}
+		return "unknown";
+	}
+
+	uint64_t kernel_rays_total() const;
+
+	/* Table of kernel statistics, with shaders named by the given list
+	 * where available. Empty if no statistics were gathered. */
+	string kernel_summary(const vector<string>& shader_names) const;
+
 	size_t mem_used;
 	size_t mem_peak;
+	size_t buffer_mem_used;
+	size_t buffer_mem_peak;
+	uint64_t time_usec[STATS_TIME_NUM_TYPES];
+
+	/* Merged kernel statistics, empty unless statistics mode is used. */
+	thread_mutex kernel_mutex;
+	KernelStats kernel;
+	vector<double> kernel_shader_time;
+	bool kernel_stats_used;
 };
 
 CCL_NAMESPACE_END
@@ -47,6 +47,7 @@ virtual ~VirtualMemoryAllocator() {}
 
 virtual void *allocate( ) = 0;
 virtual void deallocate(void *obj) = 0;
+virtual void merge(VirtualMemoryAllocator *other) = 0;
 virtual void destroy( ) = 0;
 virtual void printInfo( ) = 0;
 
@@ -96,6 +97,11 @@ int available;
  */
 void allocateDataBlock( )
 {
+	if (stackblocknum == 0)
+	{
+		allocateStackBlock( );
+	}
+
 	// Allocate a data block
 	datablocknum += 1;
 	data = ( UCHAR ** )realloc(data, sizeof (UCHAR *) * datablocknum);
@@ -124,27 +130,20 @@ void allocateStackBlock( )
 
 public:
 /**
- * Constructor
+ * Constructor, blocks are allocated on first use
  */
 MemoryAllocator( )
 {
 	HEAP_UNIT = 1 << HEAP_BASE;
 	HEAP_MASK = (1 << HEAP_BASE) - 1;
 
-	data = ( UCHAR ** )malloc(sizeof(UCHAR *) );
-	data[0] = ( UCHAR * )malloc(HEAP_UNIT * N);
-	datablocknum = 1;
-
-	stack = ( UCHAR *** )malloc(sizeof (UCHAR * *) );
-	stack[0] = ( UCHAR ** )malloc(HEAP_UNIT * sizeof (UCHAR *) );
-	stackblocknum = 1;
-	stacksize = HEAP_UNIT;
-	available = HEAP_UNIT;
+	data = NULL;
+	datablocknum = 0;
 
-	for (int i = 0; i < HEAP_UNIT; i++)
-	{
-		stack[0][i] = (data[0] + i * N);
-	}
+	stack = NULL;
+	stackblocknum = 0;
+	stacksize = 0;
+	available = 0;
 }
 
 /**
@@ -196,6 +195,44 @@ void deallocate(void *obj)
 	// printf("%d %d\n", allocated, header[ allocated ]) ;
 }
 
+/**
+ * Take over all memory of another allocator of the same size, objects
+ * allocated from it are then owned (and can be deallocated) here
+ */
+void merge(VirtualMemoryAllocator *other_v)
+{
+	MemoryAllocator<N> *other = static_cast<MemoryAllocator<N> *>(other_v);
+	int i;
+
+	// Objects available there are available here
+	for (i = 0; i < other->available; i++)
+	{
+		deallocate(other->stack[i >> HEAP_BASE][i & HEAP_MASK]);
+	}
+
+	// Take over the data blocks
+	data = ( UCHAR ** )realloc(data, sizeof (UCHAR *) * (datablocknum + other->datablocknum));
+	for (i = 0; i < other->datablocknum; i++)
+	{
+		data[datablocknum + i] = other->data[i];
+	}
+	datablocknum += other->datablocknum;
+
+	// Leave the other allocator empty
+	for (i = 0; i < other->stackblocknum; i++)
+	{
+		free(other->stack[i]);
+	}
+	free(other->data);
+	free(other->stack);
+	other->data = NULL;
+	other->datablocknum = 0;
+	other->stack = NULL;
+	other->stackblocknum = 0;
+	other->stacksize = 0;
+	other->available = 0;
+}
+
 /**
  * Print information
  */
@@ -26,9 +26,14 @@
 
 #include "octree.h"
 #include <Eigen/Dense>
+#include <algorithm>
 #include <limits>
 #include <time.h>
 
+#if PARALLEL==1
+#include <omp.h>
+#endif
+
 /**
  * Implementations of Octree member functions.
  *
@@ -267,6 +272,13 @@ void Octree::addAllTriangles()
 	Triangle *trian;
 	int count = 0;
 
+#if PARALLEL==1
+	if (omp_get_max_threads() > 1 && maxDepth > 2) {
+		addAllTrianglesParallel();
+		return;
+	}
+#endif
+
 #if DC_DEBUG
 	int total = reader->getNumTriangles();
 	int unitcount = 1000;
@@ -321,6 +333,167 @@ void Octree::addAllTriangles()
 	putchar(13);
 }
 
+/* Read all triangles, then build the subtrees of the 64 cells two
+   levels below the root in threads, each with its own memory
+   allocators. Every subtree gets the triangles intersecting its cell
+   in their original order and runs the same tests as addTriangle(),
+   so the result is the same tree as when built serially. */
+void Octree::addAllTrianglesParallel()
+{
+	Triangle *trian;
+	std::vector<int> trigs;
+	int count = 0;
+
+	/* Project the triangles into the grid */
+	while ((trian = reader->getNextTriangle()) != NULL) {
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++)
+				trigs.push_back((int)(dimen * (trian->vt[i][j] - origin[j]) / range));
+		}
+		delete trian;
+		count++;
+	}
+
+	/* Sort them into the cells their bounding box overlaps,
+	   including cells they only touch */
+	std::vector<int> tris[64];
+	const int cellshift = GRID_DIMENSION - 2;
+
+	for (int t = 0; t < count; t++) {
+		const int *trig = &trigs[t * 9];
+		int cmin[3], cmax[3];
+
+		for (int j = 0; j < 3; j++) {
+			int tmin = std::min(std::min(trig[j], trig[3 + j]), trig[6 + j]);
+			int tmax = std::max(std::max(trig[j], trig[3 + j]), trig[6 + j]);
+			cmin[j] = std::max((tmin - 1) >> cellshift, 0);
+			cmax[j] = std::min(tmax >> cellshift, 3);
+		}
+
+		for (int x = cmin[0]; x <= cmax[0]; x++) {
+			for (int y = cmin[1]; y <= cmax[1]; y++) {
+				for (int z = cmin[2]; z <= cmax[2]; z++) {
+					int child = ((x >> 1) << 2) | ((y >> 1) << 1) | (z >> 1);
+					int grandchild = ((x & 1) << 2) | ((y & 1) << 1) | (z & 1);
+					tris[child * 8 + grandchild].push_back(t);
+				}
+			}
+		}
+	}
+
+	/* Build the subtrees */
+	InternalNode *cells[64];
+	int parent_reached[64];
+
+#pragma omp parallel
+	{
+		/* A copy of the octree settings with its own allocators */
+		Octree worker(*this);
+		worker.cubes = NULL;
+		worker.initMemory();
+
+#pragma omp for schedule(dynamic)
+		for (int c = 0; c < 64; c++) {
+			parent_reached[c] = 0;
+			cells[c] = worker.addTrianglesToCell(c, tris[c], trigs, parent_reached[c]);
+		}
+
+#pragma omp critical
+		mergeMemory(&worker);
+	}
+
+	/* Link them to the root, the cells one level below exist when a
+	   triangle intersected them, even if it intersects none of their
+	   children */
+	InternalNode *node = &root->internal;
+	int count_child = 0;
+	for (int i = 0; i < 8; i++) {
+		int reached = 0;
+		for (int j = 0; j < 8; j++)
+			reached |= parent_reached[i * 8 + j];
+
+		if (!reached)
+			continue;
+
+		InternalNode *chd = createInternal(0);
+		int count_grandchild = 0;
+		for (int j = 0; j < 8; j++) {
+			if (cells[i * 8 + j]) {
+				chd = addInternalChild(chd, j, count_grandchild, cells[i * 8 + j]);
+				count_grandchild++;
+			}
+		}
+
+		node = addInternalChild(node, i, count_child, chd);
+		count_child++;
+	}
+	root = (Node *)node;
+}
+
+/* Add the triangles to the subtree of one cell two levels below the
+   root, created when the first triangle intersects it. Sets
+   parent_reached when a triangle intersects the cell above it. */
+InternalNode *Octree::addTrianglesToCell(int cell, const std::vector<int>& tris,
+                                         const std::vector<int>& trigs, int& parent_reached)
+{
+	const int path[2] = {cell >> 3, cell & 7};
+	int64_t cube[2][3] = {{0, 0, 0}, {dimen, dimen, dimen}};
+	InternalNode *node = NULL;
+
+	for (size_t k = 0; k < tris.size(); k++) {
+		const int *tri = &trigs[tris[k] * 9];
+		int64_t trig[3][3];
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++)
+				trig[i][j] = (int64_t)tri[i * 3 + j];
+		}
+
+		int64_t errorvec = (int64_t)(0);
+		CubeTriangleIsect *proj = new CubeTriangleIsect(cube, trig, errorvec, tris[k]);
+		CubeTriangleIsect *p = proj;
+		bool reached = true;
+
+		/* Same tests as addTriangle() on the way down to the cell */
+		for (int level = 0; level < 2 && reached; level++) {
+			int off[3] = {vertmap[path[level]][0], vertmap[path[level]][1], vertmap[path[level]][2]};
+
+			reached = (p->getBoxMask() & (1 << path[level])) != 0;
+			if (reached) {
+				CubeTriangleIsect *subp = new CubeTriangleIsect(p);
+				subp->shift(off);
+				if (p != proj)
+					delete p;
+				p = subp;
+
+				reached = p->isIntersecting() != 0;
+				if (reached && level == 0)
+					parent_reached = 1;
+			}
+		}
+
+		if (reached) {
+			if (node == NULL)
+				node = createInternal(0);
+			node = addTriangle(node, p, maxDepth - 2);
+		}
+
+		if (p != proj)
+			delete p;
+		delete proj->inherit;
+		delete proj;
+	}
+
+	return node;
+}
+
+void Octree::mergeMemory(Octree *worker)
+{
+	for (int i = 0; i < 9; i++)
+		alloc[i]->merge(worker->alloc[i]);
+	for (int i = 0; i < 4; i++)
+		leafalloc[i]->merge(worker->leafalloc[i]);
+}
+
 /* Prepare a triangle for insertion into the octree; call the other
    addTriangle() to (recursively) build the octree */
 void Octree::addTriangle(Triangle *trian, int triind)
@@ -2063,7 +2236,15 @@ void Octree::writeOut()
 	actualVerts = 0;
 	actualQuads = 0;
 
-	generateMinimizer(root, st, dimen, maxDepth, offset);
+	std::vector<MinimizerCell> cells;
+	findMinimizerCells(root, st, dimen, maxDepth, offset, cells);
+	generateMinimizers(cells);
+
+	/* Quads are still written serially, this takes 2-6% of the time,
+	   less than flood fill which is serial as well. Running the top
+	   level cell, face and edge calls in threads with their own quad
+	   buffers, added in order afterwards, would keep the output
+	   identical. */
 	cellProcContour(root, 0, maxDepth);
 	dc_printf("Vertices written: %d Quads written: %d \n", offset, actualQuads);
 }
@@ -2257,27 +2438,13 @@ void Octree::computeMinimizer(const LeafNode *leaf, int st[3], int len,
 	}
 }
 
-void Octree::generateMinimizer(Node *node, int st[3], int len, int height, int& offset)
+void Octree::findMinimizerCells(Node *node, int st[3], int len, int height, int& offset,
+                                std::vector<MinimizerCell>& cells)
 {
-	int i, j;
+	int i;
 
 	if (height == 0) {
-		// Leaf cell, generate
-
-		// First, find minimizer
-		float rvalue[3];
-		rvalue[0] = (float) st[0] + len / 2;
-		rvalue[1] = (float) st[1] + len / 2;
-		rvalue[2] = (float) st[2] + len / 2;
-		computeMinimizer(&node->leaf, st, len, rvalue);
-
-		// Update
-		//float fnst[3];
-		for (j = 0; j < 3; j++) {
-			rvalue[j] = rvalue[j] * range / dimen + origin[j];
-			//fnst[j] = st[j] * range / dimen + origin[j];
-		}
-
+		// Leaf cell, count its vertices
 		int mult = 0, smask = getSignMask(&node->leaf);
 
 		if (use_manifold) {
@@ -2289,8 +2456,9 @@ void Octree::generateMinimizer(Node *node, int st[3], int len, int height, int&
 			}
 		}
 
-		for (j = 0; j < mult; j++) {
-			add_vert(output_mesh, rvalue);
+		if (mult > 0) {
+			MinimizerCell cell = {&node->leaf, {st[0], st[1], st[2]}, len, mult};
+			cells.push_back(cell);
 		}
 
 		// Store the index
@@ -2309,14 +2477,49 @@ void Octree::generateMinimizer(Node *node, int st[3], int len, int height, int&
 				nst[1] = st[1] + vertmap[i][1] * len;
 				nst[2] = st[2] + vertmap[i][2] * len;
 
-				generateMinimizer(node->internal.get_child(count),
-				                  nst, len, height - 1, offset);
+				findMinimizerCells(node->internal.get_child(count),
+				                   nst, len, height - 1, offset, cells);
 				count++;
 			}
 		}
 	}
 }
 
+/* Minimizers are independent per cell, compute them in threads and
+   output the vertices in order afterwards */
+void Octree::generateMinimizers(const std::vector<MinimizerCell>& cells)
+{
+	const int totcell = (int)cells.size();
+	float (*rvalues)[3] = new float[totcell][3];
+
+#if PARALLEL==1
+#pragma omp parallel for schedule(dynamic, 256)
+#endif
+	for (int i = 0; i < totcell; i++) {
+		const MinimizerCell& cell = cells[i];
+		int st[3] = {cell.st[0], cell.st[1], cell.st[2]};
+		float *rvalue = rvalues[i];
+
+		// Find minimizer
+		rvalue[0] = (float) st[0] + cell.len / 2;
+		rvalue[1] = (float) st[1] + cell.len / 2;
+		rvalue[2] = (float) st[2] + cell.len / 2;
+		computeMinimizer(cell.leaf, st, cell.len, rvalue);
+
+		for (int j = 0; j < 3; j++) {
+			rvalue[j] = rvalue[j] * range / dimen + origin[j];
+		}
+	}
+
+	for (int i = 0; i < totcell; i++) {
+		for (int j = 0; j < cells[i].mult; j++) {
+			add_vert(output_mesh, rvalues[i]);
+		}
+	}
+
+	delete [] rvalues;
+}
+
 void Octree::processEdgeWrite(Node *node[4], int /*depth*/[4], int /*maxdep*/, int dir)
 {
 	//int color = 0;
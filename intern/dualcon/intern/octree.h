@@ -27,6 +27,7 @@
 #include <cstring>
 #include <stdio.h>
 #include <math.h>
+#include <vector>
 #include "GeoCommon.h"
 #include "Projections.h"
 #include "ModelReader.h"
@@ -223,6 +224,16 @@ struct PathList {
 };
 
 
+/**
+ * Leaf cell generating output vertices, see Octree::writeOut()
+ */
+struct MinimizerCell {
+	const LeafNode *leaf;
+	int st[3];
+	int len;
+	int mult;
+};
+
 /**
  * Class for building and processing an octree
  */
@@ -339,6 +350,18 @@ class Octree
 	void addTriangle(Triangle *trian, int triind);
 	InternalNode *addTriangle(InternalNode *node, CubeTriangleIsect *p, int height);
 
+	/**
+	 * Add triangles in threads, each building the subtree of one of the
+	 * cells two levels below the root
+	 */
+	void addAllTrianglesParallel();
+	InternalNode *addTrianglesToCell(int cell, const std::vector<int>& tris,
+	                                 const std::vector<int>& trigs, int& parent_reached);
+	/**
+	 * Take over the memory of a copy of this octree that built a subtree
+	 */
+	void mergeMemory(Octree *worker);
+
 	/**
 	 * Method to update minimizer in a cell: update edge intersections instead
 	 */
@@ -421,7 +444,9 @@ class Octree
 	void writeOut();
 
 	void countIntersection(Node *node, int height, int& nedge, int& ncell, int& nface);
-	void generateMinimizer(Node *node, int st[3], int len, int height, int& offset);
+	void findMinimizerCells(Node *node, int st[3], int len, int height, int& offset,
+	                        std::vector<MinimizerCell>& cells);
+	void generateMinimizers(const std::vector<MinimizerCell>& cells);
 	void computeMinimizer(const LeafNode * leaf, int st[3], int len,
 	                      float rvalue[3]) const;
 	/**
@@ -112,6 +112,10 @@ struct LinearSolver
 
 	EigenSparseLU *sparseLU;
 
+	/* sparsity pattern sparseLU was analyzed for (compressed column format) */
+	std::vector<int> pattern_outer;
+	std::vector<int> pattern_inner;
+
 	int num_variables;
 	std::vector<Variable> variable;
 
@@ -258,6 +262,24 @@ void EIG_linear_solver_matrix_add(LinearSolver *solver, int row, int col, double
 	}
 }
 
+void EIG_linear_solver_matrix_reset(LinearSolver *solver)
+{
+	/* nothing constructed yet */
+	if (solver->state == LinearSolver::STATE_VARIABLES_CONSTRUCT)
+		return;
+
+	solver->Mtriplets.clear();
+
+	for (int i = 0; i < solver->num_variables; i++)
+		solver->variable[i].a.clear();
+
+	for (int rhs = 0; rhs < solver->num_rhs; rhs++)
+		solver->b[rhs].setZero(solver->m);
+
+	/* keep sparseLU, the analysis is reused if the pattern of the new matrix matches */
+	solver->state = LinearSolver::STATE_MATRIX_CONSTRUCT;
+}
+
 /* Right hand side */
 
 void EIG_linear_solver_right_hand_side_add(LinearSolver *solver, int rhs, int index, double value)
@@ -275,6 +297,17 @@ void EIG_linear_solver_right_hand_side_add(LinearSolver *solver, int rhs, int in
 
 /* Solve */
 
+static bool linear_solver_pattern_matches(LinearSolver *solver, const EigenSparseMatrix& M)
+{
+	const int outer_len = M.outerSize() + 1;
+	const int inner_len = M.nonZeros();
+
+	return ((solver->pattern_outer.size() == (size_t)outer_len) &&
+	        (solver->pattern_inner.size() == (size_t)inner_len) &&
+	        std::equal(M.outerIndexPtr(), M.outerIndexPtr() + outer_len, solver->pattern_outer.begin()) &&
+	        std::equal(M.innerIndexPtr(), M.innerIndexPtr() + inner_len, solver->pattern_inner.begin()));
+}
+
 bool EIG_linear_solver_solve(LinearSolver *solver)
 {
 	/* nothing to solve, perhaps all variables were locked */
@@ -299,11 +332,21 @@ bool EIG_linear_solver_solve(LinearSolver *solver)
 		EigenSparseMatrix& M = (solver->least_squares)? solver->MtM: solver->M;
 		M.makeCompressed();
 
+		/* the ordering & symbolic factorization only depend on the sparsity pattern,
+		 * so they can be reused when only the values changed (see EIG_linear_solver_matrix_reset) */
+		if (solver->sparseLU == NULL || !linear_solver_pattern_matches(solver, M)) {
+			delete solver->sparseLU;
+			solver->sparseLU = new EigenSparseLU();
+			solver->sparseLU->analyzePattern(M);
+
+			solver->pattern_outer.assign(M.outerIndexPtr(), M.outerIndexPtr() + M.outerSize() + 1);
+			solver->pattern_inner.assign(M.innerIndexPtr(), M.innerIndexPtr() + M.nonZeros());
+		}
+
 		/* perform sparse LU factorization */
-		EigenSparseLU *sparseLU = new EigenSparseLU();
-		solver->sparseLU = sparseLU;
+		EigenSparseLU *sparseLU = solver->sparseLU;
 
-		sparseLU->compute(M);
+		sparseLU->factorize(M);
 		result = (sparseLU->info() == Eigen::Success);
 
 		solver->state = LinearSolver::STATE_MATRIX_SOLVED;
@@ -58,6 +58,12 @@ void EIG_linear_solver_variable_unlock(LinearSolver *solver, int index);
 void EIG_linear_solver_matrix_add(LinearSolver *solver, int row, int col, double value);
 void EIG_linear_solver_right_hand_side_add(LinearSolver *solver, int rhs, int index, double value);
 
+/* Clear A and b, to fill in new values with the same variables.
+ * When the new matrix has the same sparsity pattern, the symbolic
+ * factorization of the previous solve is reused. */
+
+void EIG_linear_solver_matrix_reset(LinearSolver *solver);
+
 /* Solve. Repeated solves are supported, by changing b between solves. */
 
 bool EIG_linear_solver_solve(LinearSolver *solver);
@@ -33,6 +33,7 @@
 #include <INTERPOLATE.h>
 #include "SPHERE.h"
 #include <zlib.h>
+#include <algorithm>
 
 #include "float.h"
 
@@ -98,7 +99,9 @@ FLUID_3D::FLUID_3D(int *res, float dx, float dtdef, int init_heat, int init_fire
 	_xVelocityTemp = new float[_totalCells];
 	_yVelocityTemp = new float[_totalCells];
 	_zVelocityTemp = new float[_totalCells];
-	_densityTemp   = new float[_totalCells];
+
+	_totalTiles = tileCount(_res);
+	_activeTiles = new unsigned char[TILES_TOT * _totalTiles];
 
 	// DG TODO: check if alloc went fine
 
@@ -122,20 +125,20 @@ FLUID_3D::FLUID_3D(int *res, float dx, float dtdef, int init_heat, int init_fire
 	}
 
 	/* heat */
-	_heat = _heatOld = _heatTemp = NULL;
+	_heat = _heatOld = NULL;
 	if (init_heat) {
 		initHeat();
 	}
 	// Fire simulation
-	_flame = _fuel = _fuelTemp = _fuelOld = NULL;
-	_react = _reactTemp = _reactOld = NULL;
+	_flame = _fuel = _fuelOld = NULL;
+	_react = _reactOld = NULL;
 	if (init_fire) {
 		initFire();
 	}
 	// Smoke color
-	_color_r = _color_rOld = _color_rTemp = NULL;
-	_color_g = _color_gOld = _color_gTemp = NULL;
-	_color_b = _color_bOld = _color_bTemp = NULL;
+	_color_r = _color_rOld = NULL;
+	_color_g = _color_gOld = NULL;
+	_color_b = _color_bOld = NULL;
 	if (init_colors) {
 		initColors(0.0f, 0.0f, 0.0f);
 	}
@@ -157,7 +160,6 @@ void FLUID_3D::initHeat()
 	if (!_heat) {
 		_heat         = new float[_totalCells];
 		_heatOld      = new float[_totalCells];
-		_heatTemp      = new float[_totalCells];
 
 		for (int x = 0; x < _totalCells; x++)
 		{
@@ -172,20 +174,16 @@ void FLUID_3D::initFire()
 	if (!_flame) {
 		_flame		= new float[_totalCells];
 		_fuel		= new float[_totalCells];
-		_fuelTemp	= new float[_totalCells];
 		_fuelOld	= new float[_totalCells];
 		_react		= new float[_totalCells];
-		_reactTemp	= new float[_totalCells];
 		_reactOld	= new float[_totalCells];
 
 		for (int x = 0; x < _totalCells; x++)
 		{
 			_flame[x]		= 0.0f;
 			_fuel[x]		= 0.0f;
-			_fuelTemp[x]	= 0.0f;
 			_fuelOld[x]		= 0.0f;
 			_react[x]		= 0.0f;
-			_reactTemp[x]	= 0.0f;
 			_reactOld[x]	= 0.0f;
 		}
 	}
@@ -196,13 +194,10 @@ void FLUID_3D::initColors(float init_r, float init_g, float init_b)
 	if (!_color_r) {
 		_color_r		= new float[_totalCells];
 		_color_rOld		= new float[_totalCells];
-		_color_rTemp	= new float[_totalCells];
 		_color_g		= new float[_totalCells];
 		_color_gOld		= new float[_totalCells];
-		_color_gTemp	= new float[_totalCells];
 		_color_b		= new float[_totalCells];
 		_color_bOld		= new float[_totalCells];
-		_color_bTemp	= new float[_totalCells];
 
 		for (int x = 0; x < _totalCells; x++)
 		{
@@ -281,33 +276,28 @@ FLUID_3D::~FLUID_3D()
 	if (_xVelocityTemp) delete[] _xVelocityTemp;
 	if (_yVelocityTemp) delete[] _yVelocityTemp;
 	if (_zVelocityTemp) delete[] _zVelocityTemp;
-	if (_densityTemp) delete[] _densityTemp;
-	if (_heatTemp) delete[] _heatTemp;
+	if (_activeTiles) delete[] _activeTiles;
 
 	if (_flame) delete[] _flame;
 	if (_fuel) delete[] _fuel;
-	if (_fuelTemp) delete[] _fuelTemp;
 	if (_fuelOld) delete[] _fuelOld;
 	if (_react) delete[] _react;
-	if (_reactTemp) delete[] _reactTemp;
 	if (_reactOld) delete[] _reactOld;
 
 	if (_color_r) delete[] _color_r;
 	if (_color_rOld) delete[] _color_rOld;
-	if (_color_rTemp) delete[] _color_rTemp;
 	if (_color_g) delete[] _color_g;
 	if (_color_gOld) delete[] _color_gOld;
-	if (_color_gTemp) delete[] _color_gTemp;
 	if (_color_b) delete[] _color_b;
 	if (_color_bOld) delete[] _color_bOld;
-	if (_color_bTemp) delete[] _color_bTemp;
 
     // printf("deleted fluid\n");
 }
 
 // init direct access functions from blender
 void FLUID_3D::initBlenderRNA(float *alpha, float *beta, float *dt_factor, float *vorticity, int *borderCollision, float *burning_rate,
-							  float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *flame_ignition_temp, float *flame_max_temp)
+							  float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *flame_ignition_temp, float *flame_max_temp,
+							  char *pressure_solver)
 {
 	_alpha = alpha;
 	_beta = beta;
@@ -320,6 +310,7 @@ void FLUID_3D::initBlenderRNA(float *alpha, float *beta, float *dt_factor, float
 	_flame_vorticity = flame_vorticity;
 	_ignition_temp = flame_ignition_temp;
 	_max_temp = flame_max_temp;
+	_pressureSolver = pressure_solver;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -366,6 +357,7 @@ void FLUID_3D::step(float dt, float gravity[3])
 #endif
 
 	wipeBoundariesSL(0, _zRes);
+	updateForceTiles();
 
 #if PARALLEL==1
 	#pragma omp parallel
@@ -400,30 +392,54 @@ void FLUID_3D::step(float dt, float gravity[3])
 	SWAP_POINTERS(_zVelocity, _zVelocityTemp);
 #if PARALLEL==1
 	}	// end of single
+	}	// end of parallel
+#endif
 
-	#pragma omp barrier
-
-	#pragma omp for
-	for (int i=0; i<2; i++)
+	if (*_pressureSolver == 1)
 	{
-		if (i==0)
-		{
-#endif
-			project();
-#if PARALLEL==1
+		/*
+		* Outside of the parallel section, the multigrid pressure
+		* solver uses all threads on its own.
+		*/
+		project();
+
+		if (_heat) {
+			diffuseHeat();
 		}
-		else if (i==1)
+	}
+	else
+	{
+		/*
+		* The Jacobi preconditioned solver is serial,
+		* so heat diffusion runs next to it.
+		*/
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static,1)
+		for (int i=0; i<2; i++)
 		{
+			if (i==0)
+			{
 #endif
-			if (_heat) {
-				diffuseHeat();
+				project();
+#if PARALLEL==1
 			}
+			else if (i==1)
+			{
+#endif
+				if (_heat) {
+					diffuseHeat();
+				}
 #if PARALLEL==1
+			}
 		}
+#endif
 	}
 
-	#pragma omp barrier
+	updateActiveTiles();
 
+#if PARALLEL==1
+	#pragma omp parallel
+	{
 	#pragma omp single
 	{
 #endif
@@ -997,7 +1013,10 @@ void FLUID_3D::project()
 	fixObstacleCompression(_divergence);
 
 	// solve Poisson equation
-	solvePressurePre(_pressure, _divergence, _obstacles);
+	if (*_pressureSolver == 1)
+		solvePressureMG(_pressure, _divergence, _obstacles);
+	else
+		solvePressurePre(_pressure, _divergence, _obstacles);
 
 	setObstaclePressure(_pressure, 0, _zRes);
 
@@ -1435,17 +1454,28 @@ void FLUID_3D::fixObstacleCompression(float *divergence)
 //////////////////////////////////////////////////////////////////////
 void FLUID_3D::addBuoyancy(float *heat, float *density, float gravity[3], int zBegin, int zEnd)
 {
+	const unsigned char *tiles = activeTiles(TILES_BUOYANCY);
+	const int xTiles = SMOKE_TILE_RES(_xRes);
+	const int yTiles = SMOKE_TILE_RES(_yRes);
 	int index = zBegin*_slabSize;
 
 	for (int z = zBegin; z < zEnd; z++)
 		for (int y = 0; y < _yRes; y++)
+		{
+			const unsigned char *tileRow = tiles + ((z >> SMOKE_TILE_SHIFT) * yTiles + (y >> SMOKE_TILE_SHIFT)) * xTiles;
+
 			for (int x = 0; x < _xRes; x++, index++)
 			{
+				// no smoke or heat
+				if (!tileRow[x >> SMOKE_TILE_SHIFT])
+					continue;
+
 				float buoyancy = *_alpha * density[index] + (*_beta * (((heat) ? heat[index] : 0.0f) - _tempAmb));
 				_xForce[index] -= gravity[0] * buoyancy;
 				_yForce[index] -= gravity[1] * buoyancy;
 				_zForce[index] -= gravity[2] * buoyancy;
 			}
+		}
 }
 
 
@@ -1503,6 +1533,11 @@ void FLUID_3D::addVorticity(int zBegin, int zEnd)
 	objvelocity[1] = _yVelocityOb;
 	objvelocity[2] = _zVelocityOb;
 
+	// skip still air, where all of the vorticity is zero
+	const unsigned char *tiles = activeTiles(TILES_VORTICITY);
+	const int xTiles = SMOKE_TILE_RES(_xRes);
+	const int yTiles = SMOKE_TILE_RES(_yRes);
+
 	size_t vIndex=_xRes + 1;
 	for (int z = zBegin + bb1; z < (zEnd - bt1); z++)
 	{
@@ -1511,9 +1546,11 @@ void FLUID_3D::addVorticity(int zBegin, int zEnd)
 
 		for (int y = 1; y < _yRes - 1; y++, index += 2)
 		{
+			const unsigned char *tileRow = tiles + ((z >> SMOKE_TILE_SHIFT) * yTiles + (y >> SMOKE_TILE_SHIFT)) * xTiles;
+
 			for (int x = 1; x < _xRes - 1; x++, index++)
 			{
-				if (!_obstacles[index])
+				if (!_obstacles[index] && tileRow[x >> SMOKE_TILE_SHIFT])
 				{
 					int obpos[6];
 
@@ -1574,11 +1611,13 @@ void FLUID_3D::addVorticity(int zBegin, int zEnd)
 
 		for (int y = 1; y < _yRes - 1; y++, index += 2)
 		{
+			const unsigned char *tileRow = tiles + ((z >> SMOKE_TILE_SHIFT) * yTiles + (y >> SMOKE_TILE_SHIFT)) * xTiles;
+
 			for (int x = 1; x < _xRes - 1; x++, index++)
 			{
 				//
 
-				if (!_obstacles[index])
+				if (!_obstacles[index] && tileRow[x >> SMOKE_TILE_SHIFT])
 				{
 					float N[3];
 
@@ -1626,6 +1665,86 @@ void FLUID_3D::addVorticity(int zBegin, int zEnd)
 }
 
 
+//////////////////////////////////////////////////////////////////////
+// Find the tiles of the scalar fields that the coming advection
+// has to process, everything else stays zero, and allocate the
+// intermediate results for those tiles. Called before the fields
+// are swapped to "Old" for the advection.
+//////////////////////////////////////////////////////////////////////
+void FLUID_3D::updateActiveTiles()
+{
+	const float dt0 = _dt / _dx;
+	float *maxVel = new float[_zRes];
+
+	// furthest distance any cell is advected
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 0; z < _zRes; z++)
+	{
+		float vel = 0.0f;
+		for (size_t index = (size_t)z * _slabSize; index < (size_t)(z + 1) * _slabSize; index++) {
+			vel = max(vel, fabsf(_xVelocity[index]));
+			vel = max(vel, fabsf(_yVelocity[index]));
+			vel = max(vel, fabsf(_zVelocity[index]));
+		}
+		maxVel[z] = vel;
+	}
+	const float maxDistance = dt0 * *max_element(maxVel, maxVel + _zRes);
+	delete[] maxVel;
+
+	markActiveTiles(_density, _res, maxDistance, _activeTiles + TILES_DENSITY * _totalTiles);
+	_densityTemp.allocate(activeTiles(TILES_DENSITY), _res);
+	if (_heat) {
+		markActiveTiles(_heat, _res, maxDistance, _activeTiles + TILES_HEAT * _totalTiles);
+		_heatTemp.allocate(activeTiles(TILES_HEAT), _res);
+	}
+	if (_fuel) {
+		markActiveTiles(_fuel, _res, maxDistance, _activeTiles + TILES_FUEL * _totalTiles);
+		markActiveTiles(_react, _res, maxDistance, _activeTiles + TILES_REACT * _totalTiles);
+		_fuelTemp.allocate(activeTiles(TILES_FUEL), _res);
+		_reactTemp.allocate(activeTiles(TILES_REACT), _res);
+	}
+	if (_color_r) {
+		markActiveTiles(_color_r, _res, maxDistance, _activeTiles + TILES_COLOR_R * _totalTiles);
+		markActiveTiles(_color_g, _res, maxDistance, _activeTiles + TILES_COLOR_G * _totalTiles);
+		markActiveTiles(_color_b, _res, maxDistance, _activeTiles + TILES_COLOR_B * _totalTiles);
+		_color_rTemp.allocate(activeTiles(TILES_COLOR_R), _res);
+		_color_gTemp.allocate(activeTiles(TILES_COLOR_G), _res);
+		_color_bTemp.allocate(activeTiles(TILES_COLOR_B), _res);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// Find the tiles in which buoyancy and vorticity confinement can add
+// forces, elsewhere they add zero. Buoyancy is zero where there is
+// neither smoke nor heat (ambient temperature is zero), vorticity
+// where the air within two cells doesn't move.
+//////////////////////////////////////////////////////////////////////
+void FLUID_3D::updateForceTiles()
+{
+	unsigned char *tiles = _activeTiles + TILES_BUOYANCY * _totalTiles;
+
+	memset(tiles, 0, _totalTiles);
+	markNonZeroTiles(_density, _res, tiles);
+	if (_heat) {
+		markNonZeroTiles(_heat, _res, tiles);
+	}
+
+	if (_vorticityEps + (*_flame_vorticity) / _constantScaling > 0.0f) {
+		tiles = _activeTiles + TILES_VORTICITY * _totalTiles;
+
+		memset(tiles, 0, _totalTiles);
+		markNonZeroTiles(_xVelocity, _res, tiles);
+		markNonZeroTiles(_yVelocity, _res, tiles);
+		markNonZeroTiles(_zVelocity, _res, tiles);
+		markNonZeroTiles(_xVelocityOb, _res, tiles);
+		markNonZeroTiles(_yVelocityOb, _res, tiles);
+		markNonZeroTiles(_zVelocityOb, _res, tiles);
+		dilateTiles(tiles, _res, 1);
+	}
+}
+
 void FLUID_3D::advectMacCormackBegin(int zBegin, int zEnd)
 {
 	Vec3Int res = Vec3Int(_xRes,_yRes,_zRes);
@@ -1651,18 +1770,18 @@ void FLUID_3D::advectMacCormackEnd1(int zBegin, int zEnd)
 
 	// advectFieldMacCormack1(dt, xVelocity, yVelocity, zVelocity, oldField, newField, res)
 
-	advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _densityOld, _densityTemp, res, zBegin, zEnd);
+	advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _densityOld, _densityTemp, res, zBegin, zEnd, activeTiles(TILES_DENSITY));
 	if (_heat) {
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _heatOld, _heatTemp, res, zBegin, zEnd);
+		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _heatOld, _heatTemp, res, zBegin, zEnd, activeTiles(TILES_HEAT));
 	}
 	if (_fuel) {
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _fuelOld, _fuelTemp, res, zBegin, zEnd);
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _reactOld, _reactTemp, res, zBegin, zEnd);
+		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _fuelOld, _fuelTemp, res, zBegin, zEnd, activeTiles(TILES_FUEL));
+		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _reactOld, _reactTemp, res, zBegin, zEnd, activeTiles(TILES_REACT));
 	}
 	if (_color_r) {
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_rOld, _color_rTemp, res, zBegin, zEnd);
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_gOld, _color_gTemp, res, zBegin, zEnd);
-		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_bOld, _color_bTemp, res, zBegin, zEnd);
+		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_rOld, _color_rTemp, res, zBegin, zEnd, activeTiles(TILES_COLOR_R));
+		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_gOld, _color_gTemp, res, zBegin, zEnd, activeTiles(TILES_COLOR_G));
+		advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_bOld, _color_bTemp, res, zBegin, zEnd, activeTiles(TILES_COLOR_B));
 	}
 	advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _xVelocityOld, _xVelocity, res, zBegin, zEnd);
 	advectFieldMacCormack1(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _yVelocityOld, _yVelocity, res, zBegin, zEnd);
@@ -1685,18 +1804,18 @@ void FLUID_3D::advectMacCormackEnd2(int zBegin, int zEnd)
 	// advectFieldMacCormack2(dt, xVelocity, yVelocity, zVelocity, oldField, newField, tempfield, temp, res, obstacles)
 
 	/* finish advection */
-	advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _densityOld, _density, _densityTemp, t1, res, _obstacles, zBegin, zEnd);
+	advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _densityOld, _density, _densityTemp, t1, res, _obstacles, zBegin, zEnd, activeTiles(TILES_DENSITY));
 	if (_heat) {
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _heatOld, _heat, _heatTemp, t1, res, _obstacles, zBegin, zEnd);
+		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _heatOld, _heat, _heatTemp, t1, res, _obstacles, zBegin, zEnd, activeTiles(TILES_HEAT));
 	}
 	if (_fuel) {
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _fuelOld, _fuel, _fuelTemp, t1, res, _obstacles, zBegin, zEnd);
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _reactOld, _react, _reactTemp, t1, res, _obstacles, zBegin, zEnd);
+		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _fuelOld, _fuel, _fuelTemp, t1, res, _obstacles, zBegin, zEnd, activeTiles(TILES_FUEL));
+		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _reactOld, _react, _reactTemp, t1, res, _obstacles, zBegin, zEnd, activeTiles(TILES_REACT));
 	}
 	if (_color_r) {
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_rOld, _color_r, _color_rTemp, t1, res, _obstacles, zBegin, zEnd);
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_gOld, _color_g, _color_gTemp, t1, res, _obstacles, zBegin, zEnd);
-		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_bOld, _color_b, _color_bTemp, t1, res, _obstacles, zBegin, zEnd);
+		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_rOld, _color_r, _color_rTemp, t1, res, _obstacles, zBegin, zEnd, activeTiles(TILES_COLOR_R));
+		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_gOld, _color_g, _color_gTemp, t1, res, _obstacles, zBegin, zEnd, activeTiles(TILES_COLOR_G));
+		advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _color_bOld, _color_b, _color_bTemp, t1, res, _obstacles, zBegin, zEnd, activeTiles(TILES_COLOR_B));
 	}
 	advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _xVelocityOld, _xVelocityTemp, _xVelocity, t1, res, _obstacles, zBegin, zEnd);
 	advectFieldMacCormack2(dt0, _xVelocityOld, _yVelocityOld, _zVelocityOld, _yVelocityOld, _yVelocityTemp, _yVelocity, t1, res, _obstacles, zBegin, zEnd);
@@ -1727,66 +1846,109 @@ void FLUID_3D::advectMacCormackEnd2(int zBegin, int zEnd)
 
 
 void FLUID_3D::processBurn(float *fuel, float *smoke, float *react, float *heat,
-						   float *r, float *g, float *b, int total_cells, float dt)
+						   float *r, float *g, float *b, Vec3Int res, float dt)
 {
 	float burning_rate = *_burning_rate;
 	float flame_smoke = *_flame_smoke;
 	float ignition_point = *_ignition_temp;
 	float temp_max = *_max_temp;
 
-	for (int index = 0; index < total_cells; index++)
-	{
-		float orig_fuel = fuel[index];
-		float orig_smoke = smoke[index];
-		float smoke_emit = 0.0f;
-		float flame = 0.0f;
-
-		/* process fuel */
-		fuel[index] -= burning_rate * dt;
-		if (fuel[index] < 0.0f) fuel[index] = 0.0f;
-		/* process reaction coordinate */
-		if (orig_fuel > FLT_EPSILON) {
-			react[index] *= fuel[index]/orig_fuel;
-			flame = pow(react[index], 0.5f);
-		}
-		else {
-			react[index] = 0.0f;
-		}
+	/* nothing changes in tiles without fuel, reaction and smoke */
+	unsigned char *tiles = new unsigned char[tileCount(res)];
+	const int xTiles = SMOKE_TILE_RES(res[0]);
+	const int yTiles = SMOKE_TILE_RES(res[1]);
+	int index = 0;
+
+	memset(tiles, 0, tileCount(res));
+	markNonZeroTiles(fuel, res, tiles);
+	markNonZeroTiles(react, res, tiles);
+	markNonZeroTiles(smoke, res, tiles);
+
+	for (int z = 0; z < res[2]; z++)
+		for (int y = 0; y < res[1]; y++)
+		{
+			const unsigned char *tileRow = tiles + ((z >> SMOKE_TILE_SHIFT) * yTiles + (y >> SMOKE_TILE_SHIFT)) * xTiles;
+
+			for (int x = 0; x < res[0]; x++, index++)
+			{
+				if (!tileRow[x >> SMOKE_TILE_SHIFT])
+					continue;
+
+				float orig_fuel = fuel[index];
+				float orig_smoke = smoke[index];
+				float smoke_emit = 0.0f;
+				float flame = 0.0f;
+
+				/* process fuel */
+				fuel[index] -= burning_rate * dt;
+				if (fuel[index] < 0.0f) fuel[index] = 0.0f;
+				/* process reaction coordinate */
+				if (orig_fuel > FLT_EPSILON) {
+					react[index] *= fuel[index]/orig_fuel;
+					flame = pow(react[index], 0.5f);
+				}
+				else {
+					react[index] = 0.0f;
+				}
 
-		/* emit smoke based on fuel burn rate and "flame_smoke" factor */
-		smoke_emit = (orig_fuel < 1.0f) ? (1.0f - orig_fuel)*0.5f : 0.0f;
-		smoke_emit = (smoke_emit + 0.5f) * (orig_fuel-fuel[index]) * 0.1f * flame_smoke;
-		smoke[index] += smoke_emit;
-		CLAMP(smoke[index], 0.0f, 1.0f);
-
-		/* set fluid temperature from the flame temperature profile */
-		if (heat && flame)
-			heat[index] = (1.0f - flame)*ignition_point + flame*temp_max;
-
-		/* mix new color */
-		if (r && smoke_emit > FLT_EPSILON) {
-			float smoke_factor = smoke[index]/(orig_smoke+smoke_emit);
-			r[index] = (r[index] + _flame_smoke_color[0] * smoke_emit) * smoke_factor;
-			g[index] = (g[index] + _flame_smoke_color[1] * smoke_emit) * smoke_factor;
-			b[index] = (b[index] + _flame_smoke_color[2] * smoke_emit) * smoke_factor;
+				/* emit smoke based on fuel burn rate and "flame_smoke" factor */
+				smoke_emit = (orig_fuel < 1.0f) ? (1.0f - orig_fuel)*0.5f : 0.0f;
+				smoke_emit = (smoke_emit + 0.5f) * (orig_fuel-fuel[index]) * 0.1f * flame_smoke;
+				smoke[index] += smoke_emit;
+				CLAMP(smoke[index], 0.0f, 1.0f);
+
+				/* set fluid temperature from the flame temperature profile */
+				if (heat && flame)
+					heat[index] = (1.0f - flame)*ignition_point + flame*temp_max;
+
+				/* mix new color */
+				if (r && smoke_emit > FLT_EPSILON) {
+					float smoke_factor = smoke[index]/(orig_smoke+smoke_emit);
+					r[index] = (r[index] + _flame_smoke_color[0] * smoke_emit) * smoke_factor;
+					g[index] = (g[index] + _flame_smoke_color[1] * smoke_emit) * smoke_factor;
+					b[index] = (b[index] + _flame_smoke_color[2] * smoke_emit) * smoke_factor;
+				}
+			}
 		}
-	}
+
+	delete[] tiles;
 }
 
-void FLUID_3D::updateFlame(float *react, float *flame, int total_cells)
+void FLUID_3D::updateFlame(float *react, float *flame, Vec3Int res)
 {
-	for (int index = 0; index < total_cells; index++)
-	{
-		/* model flame temperature curve from the reaction coordinate (fuel)
-		 *	TODO: Would probably be best to get rid of whole "flame" data field.
-		 *		 Currently it's just sqrt mirror of reaction coordinate, and therefore
-		 *		 basically just waste of memory and disk space...
-		 */
-		if (react[index]>0.0f) {
-			/* do a smooth falloff for rest of the values */
-			flame[index] = pow(react[index], 0.5f);
+	/* flame stays zero in tiles without reaction */
+	unsigned char *tiles = new unsigned char[tileCount(res)];
+	const int xTiles = SMOKE_TILE_RES(res[0]);
+	const int yTiles = SMOKE_TILE_RES(res[1]);
+	int index = 0;
+
+	memset(tiles, 0, tileCount(res));
+	markNonZeroTiles(react, res, tiles);
+	markNonZeroTiles(flame, res, tiles);
+
+	for (int z = 0; z < res[2]; z++)
+		for (int y = 0; y < res[1]; y++)
+		{
+			const unsigned char *tileRow = tiles + ((z >> SMOKE_TILE_SHIFT) * yTiles + (y >> SMOKE_TILE_SHIFT)) * xTiles;
+
+			for (int x = 0; x < res[0]; x++, index++)
+			{
+				if (!tileRow[x >> SMOKE_TILE_SHIFT])
+					continue;
+
+				/* model flame temperature curve from the reaction coordinate (fuel)
+				 *	TODO: Would probably be best to get rid of whole "flame" data field.
+				 *		 Currently it's just sqrt mirror of reaction coordinate, and therefore
+				 *		 basically just waste of memory and disk space...
+				 */
+				if (react[index]>0.0f) {
+					/* do a smooth falloff for rest of the values */
+					flame[index] = pow(react[index], 0.5f);
+				}
+				else
+					flame[index] = 0.0f;
+			}
 		}
-		else
-			flame[index] = 0.0f;
-	}
+
+	delete[] tiles;
 }
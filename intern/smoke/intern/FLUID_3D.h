@@ -43,6 +43,74 @@ using namespace std;
 using namespace BasicVector;
 struct WTURBULENCE;
 
+// scalar fields are only advected inside tiles of SMOKE_TILE_SIZE^3 cells
+// which can receive non-zero values, see FLUID_3D::markActiveTiles()
+#define SMOKE_TILE_SHIFT 3
+#define SMOKE_TILE_SIZE (1 << SMOKE_TILE_SHIFT)
+#define SMOKE_TILE_RES(res) (((res) + SMOKE_TILE_SIZE - 1) >> SMOKE_TILE_SHIFT)
+#define SMOKE_TILE_CELLS (1 << (3 * SMOKE_TILE_SHIFT))
+
+// Scalar field that only stores the marked tiles, cells of the other
+// tiles read as zero. Holds the intermediate result of the MacCormack
+// advection, which is zero outside of the active tiles.
+struct TILED_FIELD
+{
+	public:
+		TILED_FIELD() : _xTiles(0), _slabTiles(0), _totalTiles(0), _allocTiles(0), _tiles(NULL), _data(NULL) {};
+		~TILED_FIELD();
+
+		// storage for the marked tiles, values are undefined until written
+		void allocate(const unsigned char *tiles, Vec3Int res);
+
+		// unmarked tiles read as zero
+		float get(int x, int y, int z) const {
+			return _tiles[tile(x, y, z)][cell(x, y, z)];
+		};
+		// the 2x2x2 cells from x, y, z on, ordered as in the trilinear interpolation
+		void corners(int x, int y, int z, float v[8]) const {
+			const int mask = SMOKE_TILE_SIZE - 1;
+			if ((x & mask) != mask && (y & mask) != mask && (z & mask) != mask) {
+				// all within one tile
+				const int dy = SMOKE_TILE_SIZE;
+				const int dz = SMOKE_TILE_SIZE * SMOKE_TILE_SIZE;
+				const float *c = _tiles[tile(x, y, z)] + cell(x, y, z);
+				v[0] = c[0];      v[1] = c[dy];      v[2] = c[1];      v[3] = c[dy + 1];
+				v[4] = c[dz];     v[5] = c[dz + dy]; v[6] = c[dz + 1]; v[7] = c[dz + dy + 1];
+			}
+			else {
+				v[0] = get(x, y, z);         v[1] = get(x, y + 1, z);
+				v[2] = get(x + 1, y, z);     v[3] = get(x + 1, y + 1, z);
+				v[4] = get(x, y, z + 1);     v[5] = get(x, y + 1, z + 1);
+				v[6] = get(x + 1, y, z + 1); v[7] = get(x + 1, y + 1, z + 1);
+			}
+		};
+		// only valid for cells of the marked tiles
+		float &at(int x, int y, int z) {
+			return _tiles[tile(x, y, z)][cell(x, y, z)];
+		};
+
+		size_t allocatedCells() const { return _allocTiles * SMOKE_TILE_CELLS; };
+
+	private:
+		int tile(int x, int y, int z) const {
+			return (z >> SMOKE_TILE_SHIFT) * _slabTiles + (y >> SMOKE_TILE_SHIFT) * _xTiles + (x >> SMOKE_TILE_SHIFT);
+		};
+		static int cell(int x, int y, int z) {
+			const int mask = SMOKE_TILE_SIZE - 1;
+			return ((z & mask) << (2 * SMOKE_TILE_SHIFT)) | ((y & mask) << SMOKE_TILE_SHIFT) | (x & mask);
+		};
+
+		// not copyable
+		TILED_FIELD(const TILED_FIELD &);
+		TILED_FIELD &operator=(const TILED_FIELD &);
+
+		int _xTiles, _slabTiles;
+		size_t _totalTiles, _allocTiles;
+		float **_tiles; // stored tile, or _zeroTile when not marked
+		float *_data;
+		float _zeroTile[SMOKE_TILE_CELLS];
+};
+
 struct FLUID_3D  
 {
 	public:
@@ -55,7 +123,8 @@ struct FLUID_3D
 		void initColors(float init_r, float init_g, float init_b);
 
 		void initBlenderRNA(float *alpha, float *beta, float *dt_factor, float *vorticity, int *border_colli, float *burning_rate,
-							float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *ignition_temp, float *max_temp);
+							float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *ignition_temp, float *max_temp,
+							char *pressure_solver);
 		
 		// create & allocate vector noise advection 
 		void initVectorNoise(int amplify);
@@ -117,32 +186,41 @@ struct FLUID_3D
 		float* _xVelocityTemp;
 		float* _yVelocityTemp;
 		float* _zVelocityTemp;
-		float* _heatTemp;
-		float* _densityTemp;
+		TILED_FIELD _heatTemp;
+		TILED_FIELD _densityTemp;
 
 		// fire simulation
 		float *_flame;
 		float *_fuel;
-		float *_fuelTemp;
+		TILED_FIELD _fuelTemp;
 		float *_fuelOld;
 		float *_react;
-		float *_reactTemp;
+		TILED_FIELD _reactTemp;
 		float *_reactOld;
 
 		// smoke color
 		float *_color_r;
 		float *_color_rOld;
-		float *_color_rTemp;
+		TILED_FIELD _color_rTemp;
 		float *_color_g;
 		float *_color_gOld;
-		float *_color_gTemp;
+		TILED_FIELD _color_gTemp;
 		float *_color_b;
 		float *_color_bOld;
-		float *_color_bTemp;
+		TILED_FIELD _color_bTemp;
 
+		// tiles of the scalar fields in which advection can give non-zero
+		// values, followed by the tiles in which buoyancy and vorticity
+		// can add forces, _totalTiles each in the order of the TILES_* enum
+		enum { TILES_DENSITY, TILES_HEAT, TILES_FUEL, TILES_REACT, TILES_COLOR_R, TILES_COLOR_G, TILES_COLOR_B,
+		       TILES_BUOYANCY, TILES_VORTICITY, TILES_TOT };
+		size_t _totalTiles;
+		unsigned char *_activeTiles;
+		const unsigned char *activeTiles(int field) const { return _activeTiles + field * _totalTiles; };
 
 		// CG fields
 		int _iterations;
+		char *_pressureSolver; // RNA pointer, 0: Jacobi preconditioned CG, 1: multigrid preconditioned CG
 
 		// simulation constants
 		float _dt;
@@ -187,6 +265,7 @@ struct FLUID_3D
 		void diffuseColor();
 		void solvePressure(float* field, float* b, unsigned char* skip);
 		void solvePressurePre(float* field, float* b, unsigned char* skip);
+		void solvePressureMG(float* field, float* b, unsigned char* skip);
 		void solveHeat(float* field, float* b, unsigned char* skip);
 		void solveDiffusion(float* field, float* b, float* factor);
 
@@ -200,6 +279,8 @@ struct FLUID_3D
 	public:
 		// advection, accessed e.g. by WTURBULENCE class
 		//void advectMacCormack();
+		void updateActiveTiles();
+		void updateForceTiles();
 		void advectMacCormackBegin(int zBegin, int zEnd);
 		void advectMacCormackEnd1(int zBegin, int zEnd);
 		void advectMacCormackEnd2(int zBegin, int zEnd);
@@ -215,8 +296,8 @@ struct FLUID_3D
 		float *_ignition_temp; // RNA pointer
 		float *_max_temp; // RNA pointer
 		void processBurn(float *fuel, float *smoke, float *react, float *heat,
-						 float *r, float *g, float *b, int total_cells, float dt);
-		void updateFlame(float *react, float *flame, int total_cells);
+						 float *r, float *g, float *b, Vec3Int res, float dt);
+		void updateFlame(float *react, float *flame, Vec3Int res);
 
 		// boundary setting functions
 		static void copyBorderX(float* field, Vec3Int res, int zBegin, int zEnd);
@@ -236,13 +317,27 @@ struct FLUID_3D
 
 		
 
-		// static advection functions, also used by WTURBULENCE
+		// static advection functions, also used by WTURBULENCE,
+		// cells outside of the active tiles (if given) are set to zero
 		static void advectFieldSemiLagrange(const float dt, const float* velx, const float* vely,  const float* velz,
-				float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd);
+				float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd, const unsigned char *tiles = NULL);
 		static void advectFieldMacCormack1(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
-				float* oldField, float* tempResult, Vec3Int res, int zBegin, int zEnd);
+				float* oldField, float* tempResult, Vec3Int res, int zBegin, int zEnd, const unsigned char *tiles = NULL);
 		static void advectFieldMacCormack2(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
-				float* oldField, float* newField, float* tempResult, float* temp1,Vec3Int res, const unsigned char* obstacles, int zBegin, int zEnd);
+				float* oldField, float* newField, float* tempResult, float* temp1,Vec3Int res, const unsigned char* obstacles, int zBegin, int zEnd,
+				const unsigned char *tiles = NULL);
+		// scalar advection with the intermediate result stored in the active tiles only
+		static void advectFieldMacCormack1(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity,
+				float* oldField, TILED_FIELD &tempResult, Vec3Int res, int zBegin, int zEnd, const unsigned char *tiles);
+		static void advectFieldMacCormack2(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity,
+				float* oldField, float* newField, TILED_FIELD &tempResult, float* temp1, Vec3Int res, const unsigned char* obstacles, int zBegin, int zEnd,
+				const unsigned char *tiles);
+
+		// sparse advection helpers
+		static size_t tileCount(Vec3Int res);
+		static void markNonZeroTiles(const float *field, Vec3Int res, unsigned char *tiles);
+		static void dilateTiles(unsigned char *tiles, Vec3Int res, int reach);
+		static void markActiveTiles(const float *field, Vec3Int res, float maxDistance, unsigned char *tiles);
 
 
 		// temp ones for testing
@@ -253,9 +348,10 @@ struct FLUID_3D
 
 		// maccormack helper functions
 		static void clampExtrema(const float dt, const float* xVelocity, const float* yVelocity,  const float* zVelocity,
-				float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd);
+				float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd, const unsigned char *tiles = NULL);
 		static void clampOutsideRays(const float dt, const float* xVelocity, const float* yVelocity,  const float* zVelocity,
-				float* oldField, float* newField, Vec3Int res, const unsigned char* obstacles, const float *oldAdvection, int zBegin, int zEnd);
+				float* oldField, float* newField, Vec3Int res, const unsigned char* obstacles, const float *oldAdvection, int zBegin, int zEnd,
+				const unsigned char *tiles = NULL);
 
 
 
@@ -28,6 +28,7 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "FLUID_3D.h"
+#include <algorithm>
 #include <cstring>
 #define SOLVER_ACCURACY 1e-06
 
@@ -326,3 +327,646 @@ void FLUID_3D::solvePressurePre(float* field, float* b, unsigned char* skip)
 	if (_direction) delete[] _direction;
 	if (_q)       delete[] _q;
 }
+
+//////////////////////////////////////////////////////////////////////
+// Multigrid preconditioned CG for the pressure
+//
+// One V-cycle over a hierarchy of coarser grids is used as preconditioner,
+// keeping the iteration count roughly independent of the resolution.
+// A coarse cell is an obstacle when all of its 2x2x2 children are,
+// obstacle cells are left out on all levels (their values stay zero).
+// Open domain borders keep their zero pressure on all levels.
+//
+// Smoothing is red-black Gauss-Seidel, reversed after the coarse grid
+// correction and the restriction is the transpose of the prolongation,
+// so the preconditioner stays symmetric as CG requires.
+//
+// All loops are parallel over z-slabs, sums are done per slab and
+// added in order, so results don't depend on the number of threads.
+//////////////////////////////////////////////////////////////////////
+
+#define MG_SMOOTH_ITERATIONS 2
+#define MG_COARSE_ITERATIONS 16
+// stop coarsening when a side would get less interior cells than this
+#define MG_COARSE_MIN_RES 4
+// don't start threads for slabs of coarse levels
+#define MG_PARALLEL_MIN_Z 16
+
+struct MG_LEVEL {
+	int xRes, yRes, zRes; // including the one cell border
+	int slabSize;
+	size_t totalCells;
+	unsigned char *skip;
+	unsigned char *diag; // number of neighbors that are not obstacles
+	float *interpNorm; // normalization of the prolongation from the next coarser level
+	float *x, *b, *r;
+	// temporaries for restriction to and prolongation from this level,
+	// (fine z, fine y, x) and (fine z, y, x) sized
+	float *t1, *t2;
+};
+
+static const float mg_inv_diag[7] = {0.0f, 1.0f, 1.0f / 2.0f, 1.0f / 3.0f, 1.0f / 4.0f, 1.0f / 5.0f, 1.0f / 6.0f};
+
+static void mg_level_init(MG_LEVEL *lev, int xRes, int yRes, int zRes, bool alloc_data)
+{
+	lev->xRes = xRes;
+	lev->yRes = yRes;
+	lev->zRes = zRes;
+	lev->slabSize = xRes * yRes;
+	lev->totalCells = (size_t)xRes * yRes * zRes;
+
+	lev->diag = new unsigned char[lev->totalCells];
+	lev->interpNorm = new float[lev->totalCells];
+	lev->r = new float[lev->totalCells];
+	memset(lev->diag, 0, sizeof(unsigned char) * lev->totalCells);
+	memset(lev->interpNorm, 0, sizeof(float) * lev->totalCells);
+	memset(lev->r, 0, sizeof(float) * lev->totalCells);
+
+	lev->t1 = lev->t2 = NULL;
+
+	if (alloc_data) {
+		lev->skip = new unsigned char[lev->totalCells];
+		lev->x = new float[lev->totalCells];
+		lev->b = new float[lev->totalCells];
+		memset(lev->x, 0, sizeof(float) * lev->totalCells);
+		memset(lev->b, 0, sizeof(float) * lev->totalCells);
+	}
+	else {
+		lev->skip = NULL;
+		lev->x = lev->b = NULL;
+	}
+}
+
+static void mg_level_free(MG_LEVEL *lev, bool free_data)
+{
+	delete[] lev->diag;
+	delete[] lev->interpNorm;
+	delete[] lev->r;
+	if (lev->t1) delete[] lev->t1;
+	if (lev->t2) delete[] lev->t2;
+
+	if (free_data) {
+		delete[] lev->skip;
+		delete[] lev->x;
+		delete[] lev->b;
+	}
+}
+
+static void mg_level_diag(MG_LEVEL *lev)
+{
+	const int xRes = lev->xRes, slabSize = lev->slabSize;
+	const unsigned char *skip = lev->skip;
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (lev->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int z = 1; z < lev->zRes - 1; z++) {
+		size_t index = (size_t)z * slabSize + xRes + 1;
+		for (int y = 1; y < lev->yRes - 1; y++, index += 2) {
+			for (int x = 1; x < xRes - 1; x++, index++) {
+				if (skip[index]) {
+					lev->diag[index] = 0;
+					continue;
+				}
+				lev->diag[index] = (!skip[index + 1]) + (!skip[index - 1]) +
+				                   (!skip[index + xRes]) + (!skip[index - xRes]) +
+				                   (!skip[index + slabSize]) + (!skip[index - slabSize]);
+			}
+		}
+	}
+}
+
+// range of fine cells covered by coarse cell c along one axis,
+// border cells map to the border
+static void mg_children(int c, int fineRes, int coarseRes, int *r_begin, int *r_end)
+{
+	if (c == 0) {
+		*r_begin = *r_end = 0;
+	}
+	else if (c == coarseRes - 1) {
+		*r_begin = *r_end = fineRes - 1;
+	}
+	else {
+		*r_begin = 2 * c - 1;
+		*r_end = min(2 * c, fineRes - 2);
+	}
+}
+
+// prolongation weights along one axis: 3/4 from the parent, 1/4 from its other neighbor
+static void mg_interp_axis(int f, int *r_c, float *r_w)
+{
+	const int parent = (f + 1) / 2;
+	r_c[0] = parent;
+	r_c[1] = (f & 1) ? parent - 1 : parent + 1;
+	r_w[0] = 0.75f;
+	r_w[1] = 0.25f;
+}
+
+static void mg_level_coarsen(const MG_LEVEL *fine, MG_LEVEL *coarse)
+{
+	mg_level_init(coarse, (fine->xRes - 1) / 2 + 2, (fine->yRes - 1) / 2 + 2, (fine->zRes - 1) / 2 + 2, true);
+	coarse->t1 = new float[(size_t)fine->zRes * fine->yRes * coarse->xRes];
+	coarse->t2 = new float[(size_t)fine->zRes * coarse->yRes * coarse->xRes];
+
+	// coarse cells are obstacles when all children are
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (coarse->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int z = 0; z < coarse->zRes; z++) {
+		int zBegin, zEnd, yBegin, yEnd, xBegin, xEnd;
+		mg_children(z, fine->zRes, coarse->zRes, &zBegin, &zEnd);
+
+		for (int y = 0; y < coarse->yRes; y++) {
+			mg_children(y, fine->yRes, coarse->yRes, &yBegin, &yEnd);
+
+			for (int x = 0; x < coarse->xRes; x++) {
+				unsigned char skip = 1;
+				mg_children(x, fine->xRes, coarse->xRes, &xBegin, &xEnd);
+
+				for (int fz = zBegin; fz <= zEnd && skip; fz++)
+					for (int fy = yBegin; fy <= yEnd && skip; fy++)
+						for (int fx = xBegin; fx <= xEnd && skip; fx++)
+							skip = fine->skip[(size_t)fz * fine->slabSize + fy * fine->xRes + fx];
+
+				coarse->skip[(size_t)z * coarse->slabSize + y * coarse->xRes + x] = skip;
+			}
+		}
+	}
+
+	mg_level_diag(coarse);
+
+	// the prolongation only takes values from coarse cells that aren't obstacles,
+	// store the inverse of the sum of weights used for each fine cell
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (fine->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int z = 1; z < fine->zRes - 1; z++) {
+		int cz[2], cy[2], cx[2];
+		float wz[2], wy[2], wx[2];
+		size_t index = (size_t)z * fine->slabSize + fine->xRes + 1;
+
+		mg_interp_axis(z, cz, wz);
+		for (int y = 1; y < fine->yRes - 1; y++, index += 2) {
+			mg_interp_axis(y, cy, wy);
+			for (int x = 1; x < fine->xRes - 1; x++, index++) {
+				float sum = 0.0f;
+
+				if (fine->skip[index]) {
+					fine->interpNorm[index] = 0.0f;
+					continue;
+				}
+
+				mg_interp_axis(x, cx, wx);
+				for (int k = 0; k < 2; k++)
+					for (int j = 0; j < 2; j++)
+						for (int i = 0; i < 2; i++)
+							if (!coarse->skip[(size_t)cz[k] * coarse->slabSize + cy[j] * coarse->xRes + cx[i]])
+								sum += wz[k] * wy[j] * wx[i];
+
+				fine->interpNorm[index] = (sum > 0.0f) ? 1.0f / sum : 0.0f;
+			}
+		}
+	}
+}
+
+static void mg_zero(MG_LEVEL *lev)
+{
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (lev->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int z = 1; z < lev->zRes - 1; z++)
+		memset(lev->x + (size_t)z * lev->slabSize, 0, sizeof(float) * lev->slabSize);
+}
+
+// one Gauss-Seidel sweep over the cells of one color,
+// neighbors that are obstacles or open borders hold zero
+static void mg_smooth(MG_LEVEL *lev, int color)
+{
+	const int xRes = lev->xRes, slabSize = lev->slabSize;
+	float *x = lev->x;
+	const float *b = lev->b;
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (lev->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int z = 1; z < lev->zRes - 1; z++) {
+		for (int y = 1; y < lev->yRes - 1; y++) {
+			const int xBegin = 1 + ((1 + y + z + color) & 1);
+			size_t index = (size_t)z * slabSize + y * xRes + xBegin;
+
+			for (int xi = xBegin; xi < xRes - 1; xi += 2, index += 2) {
+				const unsigned char diag = lev->diag[index];
+				if (diag == 0)
+					continue;
+
+				x[index] = (b[index] +
+				            x[index + 1] + x[index - 1] +
+				            x[index + xRes] + x[index - xRes] +
+				            x[index + slabSize] + x[index - slabSize]) * mg_inv_diag[diag];
+			}
+		}
+	}
+}
+
+// residual, already scaled by the prolongation normalization for restriction
+static void mg_residual(MG_LEVEL *lev)
+{
+	const int xRes = lev->xRes, slabSize = lev->slabSize;
+	const float *x = lev->x;
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (lev->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int z = 1; z < lev->zRes - 1; z++) {
+		size_t index = (size_t)z * slabSize + xRes + 1;
+		for (int y = 1; y < lev->yRes - 1; y++, index += 2) {
+			for (int xi = 1; xi < xRes - 1; xi++, index++) {
+				const unsigned char diag = lev->diag[index];
+				if (diag == 0) {
+					lev->r[index] = 0.0f;
+					continue;
+				}
+
+				lev->r[index] = (lev->b[index] - (diag * x[index] -
+				                 x[index + 1] - x[index - 1] -
+				                 x[index + xRes] - x[index - xRes] -
+				                 x[index + slabSize] - x[index - slabSize])) * lev->interpNorm[index];
+			}
+		}
+	}
+}
+
+// transpose of the prolongation, done one axis at a time, the factor 1/2 comes
+// from averaging the 8 children (1/8) and the doubled cell size in the coarse stencil (4)
+static void mg_restrict(const MG_LEVEL *fine, MG_LEVEL *coarse)
+{
+	static const float w[4] = {0.25f, 0.75f, 0.75f, 0.25f};
+	const int cxRes = coarse->xRes, cyRes = coarse->yRes;
+
+	// x axis, into (fine z, fine y, coarse x)
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (fine->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int fz = 1; fz < fine->zRes - 1; fz++) {
+		for (int fy = 1; fy < fine->yRes - 1; fy++) {
+			const float *r = fine->r + (size_t)fz * fine->slabSize + fy * fine->xRes;
+			float *t = coarse->t1 + ((size_t)fz * fine->yRes + fy) * cxRes;
+			for (int cx = 1; cx < cxRes - 1; cx++) {
+				float sum = 0.0f;
+				for (int i = 0; i < 4; i++) {
+					const int fx = 2 * cx - 2 + i;
+					if (fx <= fine->xRes - 2)
+						sum += w[i] * r[fx];
+				}
+				t[cx] = sum;
+			}
+		}
+	}
+
+	// y axis, into (fine z, coarse y, coarse x)
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (fine->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int fz = 1; fz < fine->zRes - 1; fz++) {
+		for (int cy = 1; cy < cyRes - 1; cy++) {
+			float *t = coarse->t2 + ((size_t)fz * cyRes + cy) * cxRes;
+			memset(t, 0, sizeof(float) * cxRes);
+			for (int j = 0; j < 4; j++) {
+				const int fy = 2 * cy - 2 + j;
+				if (fy < 1 || fy > fine->yRes - 2)
+					continue;
+				const float *t1 = coarse->t1 + ((size_t)fz * fine->yRes + fy) * cxRes;
+				for (int cx = 1; cx < cxRes - 1; cx++)
+					t[cx] += w[j] * t1[cx];
+			}
+		}
+	}
+
+	// z axis
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (coarse->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int cz = 1; cz < coarse->zRes - 1; cz++) {
+		size_t index = (size_t)cz * coarse->slabSize + cxRes + 1;
+		for (int cy = 1; cy < cyRes - 1; cy++, index += 2) {
+			for (int cx = 1; cx < cxRes - 1; cx++, index++) {
+				float sum = 0.0f;
+
+				if (coarse->skip[index]) {
+					coarse->b[index] = 0.0f;
+					continue;
+				}
+
+				for (int k = 0; k < 4; k++) {
+					const int fz = 2 * cz - 2 + k;
+					if (fz >= 1 && fz <= fine->zRes - 2)
+						sum += w[k] * coarse->t2[((size_t)fz * cyRes + cy) * cxRes + cx];
+				}
+
+				coarse->b[index] = 0.5f * sum;
+			}
+		}
+	}
+}
+
+// add the trilinearly interpolated coarse correction, one axis at a time
+static void mg_prolongate(MG_LEVEL *coarse, MG_LEVEL *fine)
+{
+	const int cxRes = coarse->xRes, cyRes = coarse->yRes;
+
+	// z axis, into (fine z, coarse y, coarse x)
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (fine->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int fz = 1; fz < fine->zRes - 1; fz++) {
+		int cz[2];
+		float wz[2];
+		mg_interp_axis(fz, cz, wz);
+
+		const float *x0 = coarse->x + (size_t)cz[0] * coarse->slabSize;
+		const float *x1 = coarse->x + (size_t)cz[1] * coarse->slabSize;
+		float *t = coarse->t2 + (size_t)fz * cyRes * cxRes;
+		for (int i = 0; i < coarse->slabSize; i++)
+			t[i] = wz[0] * x0[i] + wz[1] * x1[i];
+	}
+
+	// y axis, into (fine z, fine y, coarse x)
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (fine->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int fz = 1; fz < fine->zRes - 1; fz++) {
+		for (int fy = 1; fy < fine->yRes - 1; fy++) {
+			int cy[2];
+			float wy[2];
+			mg_interp_axis(fy, cy, wy);
+
+			const float *t0 = coarse->t2 + ((size_t)fz * cyRes + cy[0]) * cxRes;
+			const float *t1 = coarse->t2 + ((size_t)fz * cyRes + cy[1]) * cxRes;
+			float *t = coarse->t1 + ((size_t)fz * fine->yRes + fy) * cxRes;
+			for (int cx = 0; cx < cxRes; cx++)
+				t[cx] = wy[0] * t0[cx] + wy[1] * t1[cx];
+		}
+	}
+
+	// x axis
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static) if (fine->zRes > MG_PARALLEL_MIN_Z)
+#endif
+	for (int fz = 1; fz < fine->zRes - 1; fz++) {
+		size_t index = (size_t)fz * fine->slabSize + fine->xRes + 1;
+		for (int fy = 1; fy < fine->yRes - 1; fy++, index += 2) {
+			const float *t = coarse->t1 + ((size_t)fz * fine->yRes + fy) * cxRes;
+			for (int fx = 1; fx < fine->xRes - 1; fx++, index++) {
+				const int parent = (fx + 1) >> 1;
+				const int other = (fx & 1) ? parent - 1 : parent + 1;
+
+				if (fine->interpNorm[index] == 0.0f)
+					continue;
+
+				fine->x[index] += (0.75f * t[parent] + 0.25f * t[other]) * fine->interpNorm[index];
+			}
+		}
+	}
+}
+
+static void mg_vcycle(MG_LEVEL *levels, int numLevels, int l)
+{
+	MG_LEVEL *lev = &levels[l];
+
+	mg_zero(lev);
+
+	if (l == numLevels - 1) {
+		for (int i = 0; i < MG_COARSE_ITERATIONS; i++) {
+			mg_smooth(lev, 0);
+			mg_smooth(lev, 1);
+		}
+		for (int i = 0; i < MG_COARSE_ITERATIONS; i++) {
+			mg_smooth(lev, 1);
+			mg_smooth(lev, 0);
+		}
+		return;
+	}
+
+	for (int i = 0; i < MG_SMOOTH_ITERATIONS; i++) {
+		mg_smooth(lev, 0);
+		mg_smooth(lev, 1);
+	}
+
+	mg_residual(lev);
+	mg_restrict(lev, lev + 1);
+	mg_vcycle(levels, numLevels, l + 1);
+	mg_prolongate(lev + 1, lev);
+
+	for (int i = 0; i < MG_SMOOTH_ITERATIONS; i++) {
+		mg_smooth(lev, 1);
+		mg_smooth(lev, 0);
+	}
+}
+
+void FLUID_3D::solvePressureMG(float* field, float* b, unsigned char* skip)
+{
+	float *_q, *_h, *_residual, *_direction;
+	// per slab sums, added in order afterwards
+	double *_slabDot = new double[_zRes];
+	float *_slabMax = new float[_zRes];
+
+	// i = 0
+	int i = 0;
+
+	_residual     = new float[_totalCells]; // set 0
+	_direction    = new float[_totalCells]; // set 0
+	_q            = new float[_totalCells]; // set 0
+	_h            = new float[_totalCells]; // set 0
+
+	memset(_residual, 0, sizeof(float)*_totalCells);
+	memset(_q, 0, sizeof(float)*_totalCells);
+	memset(_direction, 0, sizeof(float)*_totalCells);
+	memset(_h, 0, sizeof(float)*_totalCells);
+	memset(_slabDot, 0, sizeof(double)*_zRes);
+	memset(_slabMax, 0, sizeof(float)*_zRes);
+
+	// build the grid hierarchy, the finest level works on the CG vectors
+	MG_LEVEL levels[16];
+	int numLevels = 1;
+
+	mg_level_init(&levels[0], _xRes, _yRes, _zRes, false);
+	levels[0].skip = skip;
+	levels[0].x = _h;
+	levels[0].b = _residual;
+	mg_level_diag(&levels[0]);
+
+	while (numLevels < 16) {
+		const MG_LEVEL *lev = &levels[numLevels - 1];
+		if (min(lev->xRes - 2, min(lev->yRes - 2, lev->zRes - 2)) < 2 * MG_COARSE_MIN_RES)
+			break;
+		mg_level_coarsen(lev, &levels[numLevels]);
+		numLevels++;
+	}
+
+	const unsigned char *diag = levels[0].diag;
+	const int xRes = _xRes, slabSize = _slabSize;
+
+	// r = b - Ax
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 1; z < _zRes - 1; z++) {
+		size_t index = (size_t)z * slabSize + xRes + 1;
+		for (int y = 1; y < _yRes - 1; y++, index += 2)
+			for (int x = 1; x < xRes - 1; x++, index++)
+			{
+				// if the cell is a variable
+				if (!skip[index])
+				{
+					_residual[index] = b[index] - (diag[index] * field[index] +
+					field[index - 1] * (skip[index - 1] ? 0.0f : -1.0f) +
+					field[index + 1] * (skip[index + 1] ? 0.0f : -1.0f) +
+					field[index - xRes] * (skip[index - xRes] ? 0.0f : -1.0f) +
+					field[index + xRes] * (skip[index + xRes] ? 0.0f : -1.0f) +
+					field[index - slabSize] * (skip[index - slabSize] ? 0.0f : -1.0f) +
+					field[index + slabSize] * (skip[index + slabSize] ? 0.0f : -1.0f));
+				}
+				else
+				{
+					_residual[index] = 0.0f;
+				}
+			}
+	}
+
+	// h = M^-1 * r
+	mg_vcycle(levels, numLevels, 0);
+
+	// p = h
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int z = 1; z < _zRes - 1; z++) {
+		size_t index = (size_t)z * slabSize + xRes + 1;
+		double dot = 0.0;
+		for (int y = 1; y < _yRes - 1; y++, index += 2)
+			for (int x = 1; x < xRes - 1; x++, index++)
+			{
+				_direction[index] = _h[index];
+				dot += _residual[index] * _h[index];
+			}
+		_slabDot[z] = dot;
+	}
+
+	double deltaNew = 0.0;
+	for (int z = 1; z < _zRes - 1; z++)
+		deltaNew += _slabDot[z];
+
+	// same stopping criterion as the Jacobi preconditioned solver
+	const float eps  = SOLVER_ACCURACY;
+	float maxR = 2.0f * eps;
+	while ((i < _iterations) && (maxR > 0.001f * eps))
+	{
+		// q = Ad, direction is zero in obstacles
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (int z = 1; z < _zRes - 1; z++) {
+			size_t index = (size_t)z * slabSize + xRes + 1;
+			double dot = 0.0;
+			for (int y = 1; y < _yRes - 1; y++, index += 2)
+				for (int x = 1; x < xRes - 1; x++, index++)
+				{
+					if (diag[index])
+					{
+						_q[index] = diag[index] * _direction[index] -
+						_direction[index - 1] - _direction[index + 1] -
+						_direction[index - xRes] - _direction[index + xRes] -
+						_direction[index - slabSize] - _direction[index + slabSize];
+					}
+					else
+					{
+						_q[index] = 0.0f;
+					}
+					dot += _direction[index] * _q[index];
+				}
+			_slabDot[z] = dot;
+		}
+
+		double alpha = 0.0;
+		for (int z = 1; z < _zRes - 1; z++)
+			alpha += _slabDot[z];
+
+		if (fabs(alpha) > 0.0)
+			alpha = deltaNew / alpha;
+
+		// x = x + alpha * d, r = r - alpha * q
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (int z = 1; z < _zRes - 1; z++) {
+			size_t index = (size_t)z * slabSize + xRes + 1;
+			float slabMax = 0.0f;
+			for (int y = 1; y < _yRes - 1; y++, index += 2)
+				for (int x = 1; x < xRes - 1; x++, index++)
+				{
+					field[index] += (float)alpha * _direction[index];
+					_residual[index] -= (float)alpha * _q[index];
+
+					const float tmp = _residual[index] * _residual[index] * mg_inv_diag[diag[index]];
+					slabMax = (tmp > slabMax) ? tmp : slabMax;
+				}
+			_slabMax[z] = slabMax;
+		}
+
+		maxR = 0.0f;
+		for (int z = 1; z < _zRes - 1; z++)
+			maxR = (_slabMax[z] > maxR) ? _slabMax[z] : maxR;
+
+		// i = i + 1
+		i++;
+
+		if (maxR <= 0.001f * eps)
+			break;
+
+		// h = M^-1 * r
+		mg_vcycle(levels, numLevels, 0);
+
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (int z = 1; z < _zRes - 1; z++) {
+			size_t index = (size_t)z * slabSize + xRes + 1;
+			double dot = 0.0;
+			for (int y = 1; y < _yRes - 1; y++, index += 2)
+				for (int x = 1; x < xRes - 1; x++, index++)
+					dot += _residual[index] * _h[index];
+			_slabDot[z] = dot;
+		}
+
+		double deltaOld = deltaNew;
+		deltaNew = 0.0;
+		for (int z = 1; z < _zRes - 1; z++)
+			deltaNew += _slabDot[z];
+
+		// beta = deltaNew / deltaOld
+		const float beta = (float)(deltaNew / deltaOld);
+
+		// d = h + beta * d
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (int z = 1; z < _zRes - 1; z++) {
+			size_t index = (size_t)z * slabSize + xRes + 1;
+			for (int y = 1; y < _yRes - 1; y++, index += 2)
+				for (int x = 1; x < xRes - 1; x++, index++)
+					_direction[index] = _h[index] + beta * _direction[index];
+		}
+	}
+	// cout << i << " iterations converged to " << sqrt(maxR) << endl;
+
+	mg_level_free(&levels[0], false);
+	for (int l = 1; l < numLevels; l++)
+		mg_level_free(&levels[l], true);
+
+	if (_h) delete[] _h;
+	if (_residual) delete[] _residual;
+	if (_direction) delete[] _direction;
+	if (_q)       delete[] _q;
+	delete[] _slabDot;
+	delete[] _slabMax;
+}
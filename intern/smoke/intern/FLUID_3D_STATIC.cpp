@@ -28,6 +28,7 @@
 //		- MiikaH
 //////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <zlib.h>
 #include "FLUID_3D.h"
 #include "IMAGE.h"
@@ -293,23 +294,67 @@ void FLUID_3D::copyBorderZ(float* field, Vec3Int res, int zBegin, int zEnd)
 	}
 }
 
+//////////////////////////////////////////////////////////////////////
+// cell access of the advected fields, by index into a dense field or
+// by position into a tiled one
+//////////////////////////////////////////////////////////////////////
+struct DenseCells
+{
+	float *field;
+
+	DenseCells(float *field) : field(field) {};
+	float get(int index, int, int, int) const { return field[index]; };
+	void corners(int index, int, int, int, int xres, int slabSize, float v[8]) const {
+		v[0] = field[index];                   v[1] = field[index + xres];
+		v[2] = field[index + 1];               v[3] = field[index + xres + 1];
+		v[4] = field[index + slabSize];        v[5] = field[index + slabSize + xres];
+		v[6] = field[index + slabSize + 1];    v[7] = field[index + slabSize + xres + 1];
+	};
+	void set(int index, int, int, int, float value) { field[index] = value; };
+	void clear(int index, int, int, int) { field[index] = 0.0f; };
+};
+
+struct TiledCells
+{
+	TILED_FIELD *field;
+
+	TiledCells(TILED_FIELD *field) : field(field) {};
+	float get(int, int x, int y, int z) const { return field->get(x, y, z); };
+	void corners(int, int x, int y, int z, int, int, float v[8]) const { field->corners(x, y, z, v); };
+	void set(int, int x, int y, int z, float value) { field->at(x, y, z) = value; };
+	// cells outside of the active tiles aren't stored
+	void clear(int, int, int, int) {};
+};
+
 /////////////////////////////////////////////////////////////////////
 // advect field with the semi lagrangian method
 //////////////////////////////////////////////////////////////////////
-void FLUID_3D::advectFieldSemiLagrange(const float dt, const float* velx, const float* vely,  const float* velz,
-		float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd)
+template<typename Source, typename Target>
+static void advectSemiLagrange(const float dt, const float* velx, const float* vely,  const float* velz,
+		const Source &oldField, Target newField, Vec3Int res, int zBegin, int zEnd, const unsigned char *tiles)
 {
 	const int xres = res[0];
 	const int yres = res[1];
 	const int zres = res[2];
 	const int slabSize = res[0] * res[1];
+	const int xTiles = SMOKE_TILE_RES(xres);
+	const int yTiles = SMOKE_TILE_RES(yres);
 
 
 	for (int z = zBegin; z < zEnd; z++)
 		for (int y = 0; y < yres; y++)
+		{
+			const unsigned char *tileRow = (tiles) ? tiles + ((z >> SMOKE_TILE_SHIFT) * yTiles + (y >> SMOKE_TILE_SHIFT)) * xTiles : NULL;
+
 			for (int x = 0; x < xres; x++)
 			{
 				const int index = x + y * xres + z * xres*yres;
+
+				// nothing non-zero within reach
+				if (tileRow && !tileRow[x >> SMOKE_TILE_SHIFT]) {
+					newField.clear(index, x, y, z);
+					continue;
+				}
 				
         // backtrace
 				float xTrace = x - dt * velx[index];
@@ -326,11 +371,8 @@ void FLUID_3D::advectFieldSemiLagrange(const float dt, const float* velx, const
 
 				// locate neighbors to interpolate
 				const int x0 = (int)xTrace;
-				const int x1 = x0 + 1;
 				const int y0 = (int)yTrace;
-				const int y1 = y0 + 1;
 				const int z0 = (int)zTrace;
-				const int z1 = z0 + 1;
 
 				// get interpolation weights
 				const float s1 = xTrace - x0;
@@ -341,25 +383,27 @@ void FLUID_3D::advectFieldSemiLagrange(const float dt, const float* velx, const
 				const float u0 = 1.0f - u1;
 
 				const int i000 = x0 + y0 * xres + z0 * slabSize;
-				const int i010 = x0 + y1 * xres + z0 * slabSize;
-				const int i100 = x1 + y0 * xres + z0 * slabSize;
-				const int i110 = x1 + y1 * xres + z0 * slabSize;
-				const int i001 = x0 + y0 * xres + z1 * slabSize;
-				const int i011 = x0 + y1 * xres + z1 * slabSize;
-				const int i101 = x1 + y0 * xres + z1 * slabSize;
-				const int i111 = x1 + y1 * xres + z1 * slabSize;
+				float v[8];
+				oldField.corners(i000, x0, y0, z0, xres, slabSize, v);
 
 				// interpolate
-				// (indices could be computed once)
-				newField[index] = u0 * (s0 * (t0 * oldField[i000] +
-							t1 * oldField[i010]) +
-						s1 * (t0 * oldField[i100] +
-							t1 * oldField[i110])) +
-					u1 * (s0 * (t0 * oldField[i001] +
-								t1 * oldField[i011]) +
-							s1 * (t0 * oldField[i101] +
-								t1 * oldField[i111]));
+				newField.set(index, x, y, z,
+					u0 * (s0 * (t0 * v[0] +
+							t1 * v[1]) +
+						s1 * (t0 * v[2] +
+							t1 * v[3])) +
+					u1 * (s0 * (t0 * v[4] +
+								t1 * v[5]) +
+							s1 * (t0 * v[6] +
+								t1 * v[7])));
 			}
+		}
+}
+
+void FLUID_3D::advectFieldSemiLagrange(const float dt, const float* velx, const float* vely,  const float* velz,
+		float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd, const unsigned char *tiles)
+{
+	advectSemiLagrange(dt, velx, vely, velz, DenseCells(oldField), DenseCells(newField), res, zBegin, zEnd, tiles);
 }
 
 
@@ -369,7 +413,7 @@ void FLUID_3D::advectFieldSemiLagrange(const float dt, const float* velx, const
 // comments are the pseudocode from selle's paper
 //////////////////////////////////////////////////////////////////////
 void FLUID_3D::advectFieldMacCormack1(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
-				float* oldField, float* tempResult, Vec3Int res, int zBegin, int zEnd)
+				float* oldField, float* tempResult, Vec3Int res, int zBegin, int zEnd, const unsigned char *tiles)
 {
 	/*const int sx= res[0];
 	const int sy= res[1];
@@ -384,15 +428,28 @@ void FLUID_3D::advectFieldMacCormack1(const float dt, const float* xVelocity, co
 
 
 	// phiHatN1 = A(phiN)
-	advectFieldSemiLagrange(  dt, xVelocity, yVelocity, zVelocity, phiN, phiN1, res, zBegin, zEnd);		// uses wide data from old field and velocities (both are whole)
+	advectFieldSemiLagrange(  dt, xVelocity, yVelocity, zVelocity, phiN, phiN1, res, zBegin, zEnd, tiles);		// uses wide data from old field and velocities (both are whole)
+}
+
+void FLUID_3D::advectFieldMacCormack1(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity,
+				float* oldField, TILED_FIELD &tempResult, Vec3Int res, int zBegin, int zEnd, const unsigned char *tiles)
+{
+	// phiHatN1 = A(phiN)
+	advectSemiLagrange(dt, xVelocity, yVelocity, zVelocity, DenseCells(oldField), TiledCells(&tempResult), res, zBegin, zEnd, tiles);
 }
 
 
 
-void FLUID_3D::advectFieldMacCormack2(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
-				float* oldField, float* newField, float* tempResult, float* temp1, Vec3Int res, const unsigned char* obstacles, int zBegin, int zEnd)
+template<typename Advection>
+static void clampOutsideRays(const float dt, const float* velx, const float* vely,  const float* velz,
+				float* oldField, float* newField, Vec3Int res, const unsigned char* obstacles, const Advection &oldAdvection, int zBegin, int zEnd,
+				const unsigned char *tiles);
+
+template<typename Advection>
+static void advectMacCormack2(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
+				float* oldField, float* newField, const Advection &phiHatN, float* temp1, Vec3Int res, const unsigned char* obstacles, int zBegin, int zEnd,
+				const unsigned char *tiles)
 {
-	float* phiHatN  = tempResult;
 	float* t1  = temp1;
 	const int sx= res[0];
 	const int sy= res[1];
@@ -403,7 +460,7 @@ void FLUID_3D::advectFieldMacCormack2(const float dt, const float* xVelocity, co
 
 
 	// phiHatN = A^R(phiHatN1)
-	advectFieldSemiLagrange( -1.0f*dt, xVelocity, yVelocity, zVelocity, phiHatN, t1, res, zBegin, zEnd);		// uses wide data from old field and velocities (both are whole)
+	advectSemiLagrange( -1.0f*dt, xVelocity, yVelocity, zVelocity, phiHatN, DenseCells(t1), res, zBegin, zEnd, tiles);		// uses wide data from old field and velocities (both are whole)
 
 	// phiN1 = phiHatN1 + (phiN - phiHatN) / 2
 	const int border = 0; 
@@ -411,32 +468,48 @@ void FLUID_3D::advectFieldMacCormack2(const float dt, const float* xVelocity, co
 		for (int y = border; y < sy-border; y++)
 			for (int x = border; x < sx-border; x++) {
 				int index = x + y * sx + z * sx*sy;
-				phiN1[index] = phiHatN[index] + (phiN[index] - t1[index]) * 0.50f;
+				phiN1[index] = phiHatN.get(index, x, y, z) + (phiN[index] - t1[index]) * 0.50f;
 				//phiN1[index] = phiHatN1[index]; // debug, correction off
 			}
-	copyBorderX(phiN1, res, zBegin, zEnd);
-	copyBorderY(phiN1, res, zBegin, zEnd);
-	copyBorderZ(phiN1, res, zBegin, zEnd);
+	FLUID_3D::copyBorderX(phiN1, res, zBegin, zEnd);
+	FLUID_3D::copyBorderY(phiN1, res, zBegin, zEnd);
+	FLUID_3D::copyBorderZ(phiN1, res, zBegin, zEnd);
 
 	// clamp any newly created extrema
-	clampExtrema(dt, xVelocity, yVelocity, zVelocity, oldField, newField, res, zBegin, zEnd);		// uses wide data from old field and velocities (both are whole)
+	FLUID_3D::clampExtrema(dt, xVelocity, yVelocity, zVelocity, oldField, newField, res, zBegin, zEnd, tiles);		// uses wide data from old field and velocities (both are whole)
 
 	// if the error estimate was bad, revert to first order
-	clampOutsideRays(dt, xVelocity, yVelocity, zVelocity, oldField, newField, res, obstacles, phiHatN, zBegin, zEnd);	// phiHatN is only used at cells within thread range, so its ok
+	clampOutsideRays(dt, xVelocity, yVelocity, zVelocity, oldField, newField, res, obstacles, phiHatN, zBegin, zEnd, tiles);	// phiHatN is only used at cells within thread range, so its ok
 
 } 
 
+void FLUID_3D::advectFieldMacCormack2(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
+				float* oldField, float* newField, float* tempResult, float* temp1, Vec3Int res, const unsigned char* obstacles, int zBegin, int zEnd,
+				const unsigned char *tiles)
+{
+	advectMacCormack2(dt, xVelocity, yVelocity, zVelocity, oldField, newField, DenseCells(tempResult), temp1, res, obstacles, zBegin, zEnd, tiles);
+}
+
+void FLUID_3D::advectFieldMacCormack2(const float dt, const float* xVelocity, const float* yVelocity, const float* zVelocity, 
+				float* oldField, float* newField, TILED_FIELD &tempResult, float* temp1, Vec3Int res, const unsigned char* obstacles, int zBegin, int zEnd,
+				const unsigned char *tiles)
+{
+	advectMacCormack2(dt, xVelocity, yVelocity, zVelocity, oldField, newField, TiledCells(&tempResult), temp1, res, obstacles, zBegin, zEnd, tiles);
+}
+
 
 //////////////////////////////////////////////////////////////////////
 // Clamp the extrema generated by the BFECC error correction
 //////////////////////////////////////////////////////////////////////
 void FLUID_3D::clampExtrema(const float dt, const float* velx, const float* vely,  const float* velz,
-		float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd)
+		float* oldField, float* newField, Vec3Int res, int zBegin, int zEnd, const unsigned char *tiles)
 {
 	const int xres= res[0];
 	const int yres= res[1];
 	const int zres= res[2];
 	const int slabSize = res[0] * res[1];
+	const int xTiles = SMOKE_TILE_RES(xres);
+	const int yTiles = SMOKE_TILE_RES(yres);
 
 	int bb=0;
 	int bt=0;
@@ -447,8 +520,15 @@ void FLUID_3D::clampExtrema(const float dt, const float* velx, const float* vely
 
 	for (int z = zBegin+bb; z < zEnd-bt; z++)
 		for (int y = 1; y < yres-1; y++)
+		{
+			const unsigned char *tileRow = (tiles) ? tiles + ((z >> SMOKE_TILE_SHIFT) * yTiles + (y >> SMOKE_TILE_SHIFT)) * xTiles : NULL;
+
 			for (int x = 1; x < xres-1; x++)
 			{
+				// zero already, as is everything around
+				if (tileRow && !tileRow[x >> SMOKE_TILE_SHIFT])
+					continue;
+
 				const int index = x + y * xres+ z * xres*yres;
 				// backtrace
 				float xTrace = x - dt * velx[index];
@@ -507,6 +587,7 @@ void FLUID_3D::clampExtrema(const float dt, const float* velx, const float* vely
 				newField[index] = (newField[index] > maxField) ? maxField : newField[index];
 				newField[index] = (newField[index] < minField) ? minField : newField[index];
 			}
+		}
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -514,13 +595,17 @@ void FLUID_3D::clampExtrema(const float dt, const float* velx, const float* vely
 // order -- in this case the error correction term was totally
 // incorrect
 //////////////////////////////////////////////////////////////////////
-void FLUID_3D::clampOutsideRays(const float dt, const float* velx, const float* vely,  const float* velz,
-				float* oldField, float* newField, Vec3Int res, const unsigned char* obstacles, const float *oldAdvection, int zBegin, int zEnd)
+template<typename Advection>
+static void clampOutsideRays(const float dt, const float* velx, const float* vely,  const float* velz,
+				float* oldField, float* newField, Vec3Int res, const unsigned char* obstacles, const Advection &oldAdvection, int zBegin, int zEnd,
+				const unsigned char *tiles)
 {
 	const int sx= res[0];
 	const int sy= res[1];
 	const int sz= res[2];
 	const int slabSize = res[0] * res[1];
+	const int xTiles = SMOKE_TILE_RES(sx);
+	const int yTiles = SMOKE_TILE_RES(sy);
 
 	int bb=0;
 	int bt=0;
@@ -530,8 +615,15 @@ void FLUID_3D::clampOutsideRays(const float dt, const float* velx, const float*
 
 	for (int z = zBegin+bb; z < zEnd-bt; z++)
 		for (int y = 1; y < sy-1; y++)
+		{
+			const unsigned char *tileRow = (tiles) ? tiles + ((z >> SMOKE_TILE_SHIFT) * yTiles + (y >> SMOKE_TILE_SHIFT)) * xTiles : NULL;
+
 			for (int x = 1; x < sx-1; x++)
 			{
+				// zero already, as is the old advection
+				if (tileRow && !tileRow[x >> SMOKE_TILE_SHIFT])
+					continue;
+
 				const int index = x + y * sx+ z * slabSize;
 				// backtrace
 				float xBackward = x + dt * velx[index];
@@ -550,7 +642,7 @@ void FLUID_3D::clampOutsideRays(const float dt, const float* velx, const float*
 					(yBackward < 1.0f) || (yBackward > sy - 2.0f) ||
 					(xBackward < 1.0f) || (xBackward > sx - 2.0f);
 				// reuse old advection instead of doing another one...
-				if(hasObstacle) { newField[index] = oldAdvection[index]; continue; }
+				if(hasObstacle) { newField[index] = oldAdvection.get(index, x, y, z); continue; }
 
 				// clamp to prevent an out of bounds access when looking into
 				// the _obstacles array
@@ -589,7 +681,7 @@ void FLUID_3D::clampOutsideRays(const float dt, const float* velx, const float*
 						obstacles[x1 + y1 * sx + z1*slabSize] ;
 				}
 				// reuse old advection instead of doing another one...
-				if(hasObstacle) { newField[index] = oldAdvection[index]; continue; }
+				if(hasObstacle) { newField[index] = oldAdvection.get(index, x, y, z); continue; }
 
 				x0 = (int)xTrace;
 				x1 = x0 + 1;
@@ -609,7 +701,7 @@ void FLUID_3D::clampOutsideRays(const float dt, const float* velx, const float*
 						obstacles[x1 + y1 * sx + z1*slabSize] ;
 				} // obstacle array
 				// reuse old advection instead of doing another one...
-				if(hasObstacle) { newField[index] = oldAdvection[index]; continue; }
+				if(hasObstacle) { newField[index] = oldAdvection.get(index, x, y, z); continue; }
 
 				// see if either the forward or backward ray went into
 				// a boundary
@@ -643,4 +735,153 @@ void FLUID_3D::clampOutsideRays(const float dt, const float* velx, const float*
 									t1 * oldField[i111])); 
 				}
 			} // xyz
+		}
+}
+
+void FLUID_3D::clampOutsideRays(const float dt, const float* velx, const float* vely,  const float* velz,
+				float* oldField, float* newField, Vec3Int res, const unsigned char* obstacles, const float *oldAdvection, int zBegin, int zEnd,
+				const unsigned char *tiles)
+{
+	::clampOutsideRays(dt, velx, vely, velz, oldField, newField, res, obstacles, DenseCells((float *)oldAdvection), zBegin, zEnd, tiles);
+}
+
+//////////////////////////////////////////////////////////////////////
+// number of tiles of SMOKE_TILE_SIZE^3 cells covering a grid
+//////////////////////////////////////////////////////////////////////
+size_t FLUID_3D::tileCount(Vec3Int res)
+{
+	return (size_t)SMOKE_TILE_RES(res[0]) * SMOKE_TILE_RES(res[1]) * SMOKE_TILE_RES(res[2]);
+}
+
+// grow the marked tiles by reach tiles along one axis
+static void dilateTilesAxis(const unsigned char *src, unsigned char *dst, const int tileRes[3], int axis, int reach)
+{
+	const int stride = (axis == 0) ? 1 : (axis == 1) ? tileRes[0] : tileRes[0] * tileRes[1];
+	int index = 0;
+
+	for (int z = 0; z < tileRes[2]; z++)
+		for (int y = 0; y < tileRes[1]; y++)
+			for (int x = 0; x < tileRes[0]; x++, index++)
+			{
+				const int pos = (axis == 0) ? x : (axis == 1) ? y : z;
+				const int kEnd = min(reach, tileRes[axis] - 1 - pos);
+				unsigned char active = 0;
+
+				for (int k = -min(reach, pos); k <= kEnd && !active; k++)
+					active = src[index + k * stride];
+
+				dst[index] = active;
+			}
+}
+
+//////////////////////////////////////////////////////////////////////
+// Add the tiles in which field has non-zero values to the marked ones
+//////////////////////////////////////////////////////////////////////
+void FLUID_3D::markNonZeroTiles(const float *field, Vec3Int res, unsigned char *tiles)
+{
+	const int xres = res[0];
+	const int yres = res[1];
+	const int zres = res[2];
+	const int slabSize = res[0] * res[1];
+	const int tileRes[3] = {SMOKE_TILE_RES(xres), SMOKE_TILE_RES(yres), SMOKE_TILE_RES(zres)};
+	const int tileSlabSize = tileRes[0] * tileRes[1];
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int tz = 0; tz < tileRes[2]; tz++)
+	{
+		unsigned char *tileSlab = tiles + (size_t)tz * tileSlabSize;
+		const int zEnd = min((tz + 1) << SMOKE_TILE_SHIFT, zres);
+
+		for (int z = tz << SMOKE_TILE_SHIFT; z < zEnd; z++)
+			for (int y = 0; y < yres; y++)
+			{
+				unsigned char *tileRow = tileSlab + (y >> SMOKE_TILE_SHIFT) * tileRes[0];
+				const float *row = field + (size_t)z * slabSize + y * xres;
+
+				for (int x = 0; x < xres; x++)
+					tileRow[x >> SMOKE_TILE_SHIFT] |= (row[x] != 0.0f);
+			}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// Grow the marked tiles by reach tiles in every direction
+//////////////////////////////////////////////////////////////////////
+void FLUID_3D::dilateTiles(unsigned char *tiles, Vec3Int res, int reach)
+{
+	const int tileRes[3] = {SMOKE_TILE_RES(res[0]), SMOKE_TILE_RES(res[1]), SMOKE_TILE_RES(res[2])};
+	unsigned char *temp = new unsigned char[tileCount(res)];
+
+	dilateTilesAxis(tiles, temp, tileRes, 0, reach);
+	dilateTilesAxis(temp, tiles, tileRes, 1, reach);
+	dilateTilesAxis(tiles, temp, tileRes, 2, reach);
+	memcpy(tiles, temp, tileCount(res));
+
+	delete[] temp;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Mark the tiles in which a MacCormack advection of field, with
+// velocities moving no cell further than maxDistance cells, can give
+// non-zero values. Both semi-Lagrangian passes and the clamping read
+// at most ceil(maxDistance) + 1 cells away from a cell, so outside of
+// the marked tiles the result is exactly zero and the advection can
+// skip those cells.
+//////////////////////////////////////////////////////////////////////
+void FLUID_3D::markActiveTiles(const float *field, Vec3Int res, float maxDistance, unsigned char *tiles)
+{
+	// tiles with non-zero values
+	memset(tiles, 0, tileCount(res));
+	markNonZeroTiles(field, res, tiles);
+
+	// grow by the reach of the two passes, with a cell of margin for rounding
+	const int reach = 2 * ((int)ceilf(maxDistance) + 2);
+	dilateTiles(tiles, res, SMOKE_TILE_RES(reach));
+}
+
+//////////////////////////////////////////////////////////////////////
+// tiled field storage
+//////////////////////////////////////////////////////////////////////
+TILED_FIELD::~TILED_FIELD()
+{
+	if (_tiles) delete[] _tiles;
+	if (_data) delete[] _data;
+}
+
+void TILED_FIELD::allocate(const unsigned char *tiles, Vec3Int res)
+{
+	const size_t totalTiles = FLUID_3D::tileCount(res);
+	size_t usedTiles = 0;
+
+	if (totalTiles != _totalTiles) {
+		if (_tiles) delete[] _tiles;
+		_tiles = new float*[totalTiles];
+		_totalTiles = totalTiles;
+		memset(_zeroTile, 0, sizeof(_zeroTile));
+	}
+	_xTiles = SMOKE_TILE_RES(res[0]);
+	_slabTiles = _xTiles * SMOKE_TILE_RES(res[1]);
+
+	for (size_t i = 0; i < totalTiles; i++)
+		if (tiles[i]) usedTiles++;
+
+	// follow the size of the smoke, with some room to grow into
+	if (usedTiles > _allocTiles || usedTiles < _allocTiles / 2) {
+		if (_data) delete[] _data;
+		_allocTiles = usedTiles + usedTiles / 4;
+		_data = (_allocTiles) ? new float[_allocTiles * SMOKE_TILE_CELLS] : NULL;
+	}
+
+	float *data = _data;
+	for (size_t i = 0; i < totalTiles; i++) {
+		if (tiles[i]) {
+			_tiles[i] = data;
+			data += SMOKE_TILE_CELLS;
+		}
+		else {
+			_tiles[i] = _zeroTile;
+		}
+	}
 }
@@ -819,9 +819,10 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
 	// enlarge timestep to match grid
 	const float dt = dtOrg * _amplify;
 	const float invAmp = 1.0f / _amplify;
-	float *tempFuelBig = NULL, *tempReactBig = NULL;
-	float *tempColor_rBig = NULL, *tempColor_gBig = NULL, *tempColor_bBig = NULL;
-	float *tempDensityBig = (float *)calloc(_totalCellsBig, sizeof(float));
+	// intermediate results of the advection, in the active tiles only
+	TILED_FIELD tempDensityBig, tempFuelBig, tempReactBig;
+	TILED_FIELD tempColor_rBig, tempColor_gBig, tempColor_bBig;
+	float *tempSm = (float *)calloc(_totalCellsSm, sizeof(float));
 	float *tempBig = (float *)calloc(_totalCellsBig, sizeof(float));
 	float *bigUx = (float *)calloc(_totalCellsBig, sizeof(float));
 	float *bigUy = (float *)calloc(_totalCellsBig, sizeof(float));
@@ -831,21 +832,12 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
 	float *eigMin  = (float *)calloc(_totalCellsSm, sizeof(float));
 	float *eigMax  = (float *)calloc(_totalCellsSm, sizeof(float));
 
-	if (_fuelBig) {
-		tempFuelBig = (float *)calloc(_totalCellsBig, sizeof(float));
-		tempReactBig = (float *)calloc(_totalCellsBig, sizeof(float));
-	}
-	if (_color_rBig) {
-		tempColor_rBig = (float *)calloc(_totalCellsBig, sizeof(float));
-		tempColor_gBig = (float *)calloc(_totalCellsBig, sizeof(float));
-		tempColor_bBig = (float *)calloc(_totalCellsBig, sizeof(float));
-	}
-
 	memset(_tcTemp, 0, sizeof(float)*_totalCellsSm);
 
 
 	// prepare textures
-	advectTextureCoordinates(dtOrg, xvel,yvel,zvel, tempDensityBig, tempBig);
+	advectTextureCoordinates(dtOrg, xvel,yvel,zvel, tempSm, tempBig);
+	free(tempSm);
 
 	// do wavelet decomposition of energy
 	computeEnergy(_energy, xvel, yvel, zvel, obstacles);
@@ -1063,6 +1055,16 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
   totalSubsteps = (totalSubsteps > maxSubSteps) ? maxSubSteps : totalSubsteps;
   const float dtSubdiv = dt / (float)totalSubsteps;
 
+  // tiles of the fields that can become non-zero in a substep, see FLUID_3D::markActiveTiles()
+  const size_t totalTilesBig = FLUID_3D::tileCount(_resBig);
+  unsigned char *tilesDensityBig = (unsigned char *)malloc(totalTilesBig * 6);
+  unsigned char *tilesFuelBig = tilesDensityBig + totalTilesBig;
+  unsigned char *tilesReactBig = tilesDensityBig + totalTilesBig * 2;
+  unsigned char *tilesColor_rBig = tilesDensityBig + totalTilesBig * 3;
+  unsigned char *tilesColor_gBig = tilesDensityBig + totalTilesBig * 4;
+  unsigned char *tilesColor_bBig = tilesDensityBig + totalTilesBig * 5;
+  const float maxDistance = maxVelMag / (float)totalSubsteps;
+
   // set boundaries of big velocity grid
   FLUID_3D::setZeroX(bigUx, _resBig, 0 , _resBig[2]); 
   FLUID_3D::setZeroY(bigUy, _resBig, 0 , _resBig[2]); 
@@ -1084,6 +1086,22 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
   // do the MacCormack advection, with substepping if necessary
   for(int substep = 0; substep < totalSubsteps; substep++)
   {
+	FLUID_3D::markActiveTiles(_densityBigOld, _resBig, maxDistance, tilesDensityBig);
+	tempDensityBig.allocate(tilesDensityBig, _resBig);
+	if (_fuelBig) {
+		FLUID_3D::markActiveTiles(_fuelBigOld, _resBig, maxDistance, tilesFuelBig);
+		FLUID_3D::markActiveTiles(_reactBigOld, _resBig, maxDistance, tilesReactBig);
+		tempFuelBig.allocate(tilesFuelBig, _resBig);
+		tempReactBig.allocate(tilesReactBig, _resBig);
+	}
+	if (_color_rBig) {
+		FLUID_3D::markActiveTiles(_color_rBigOld, _resBig, maxDistance, tilesColor_rBig);
+		FLUID_3D::markActiveTiles(_color_gBigOld, _resBig, maxDistance, tilesColor_gBig);
+		FLUID_3D::markActiveTiles(_color_bBigOld, _resBig, maxDistance, tilesColor_bBig);
+		tempColor_rBig.allocate(tilesColor_rBig, _resBig);
+		tempColor_gBig.allocate(tilesColor_gBig, _resBig);
+		tempColor_bBig.allocate(tilesColor_bBig, _resBig);
+	}
 
 #if PARALLEL==1
 	#pragma omp parallel
@@ -1096,20 +1114,20 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
 		int zEnd = (int)((float)(i+1)*partSize + 0.5f);
 #endif
 		FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-		    _densityBigOld, tempDensityBig, _resBig, zBegin, zEnd);
+		    _densityBigOld, tempDensityBig, _resBig, zBegin, zEnd, tilesDensityBig);
 		if (_fuelBig) {
 			FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-				_fuelBigOld, tempFuelBig, _resBig, zBegin, zEnd);
+				_fuelBigOld, tempFuelBig, _resBig, zBegin, zEnd, tilesFuelBig);
 			FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-				_reactBigOld, tempReactBig, _resBig, zBegin, zEnd);
+				_reactBigOld, tempReactBig, _resBig, zBegin, zEnd, tilesReactBig);
 		}
 		if (_color_rBig) {
 			FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_rBigOld, tempColor_rBig, _resBig, zBegin, zEnd);
+				_color_rBigOld, tempColor_rBig, _resBig, zBegin, zEnd, tilesColor_rBig);
 			FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_gBigOld, tempColor_gBig, _resBig, zBegin, zEnd);
+				_color_gBigOld, tempColor_gBig, _resBig, zBegin, zEnd, tilesColor_gBig);
 			FLUID_3D::advectFieldMacCormack1(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_bBigOld, tempColor_bBig, _resBig, zBegin, zEnd);
+				_color_bBigOld, tempColor_bBig, _resBig, zBegin, zEnd, tilesColor_bBig);
 		}
 #if PARALLEL==1
 	}
@@ -1123,20 +1141,20 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
 		int zEnd = (int)((float)(i+1)*partSize + 0.5f);
 #endif
 		FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-		    _densityBigOld, _densityBig, tempDensityBig, tempBig, _resBig, NULL, zBegin, zEnd);
+		    _densityBigOld, _densityBig, tempDensityBig, tempBig, _resBig, NULL, zBegin, zEnd, tilesDensityBig);
 		if (_fuelBig) {
 			FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-				_fuelBigOld, _fuelBig, tempFuelBig, tempBig, _resBig, NULL, zBegin, zEnd);
+				_fuelBigOld, _fuelBig, tempFuelBig, tempBig, _resBig, NULL, zBegin, zEnd, tilesFuelBig);
 			FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-				_reactBigOld, _reactBig, tempReactBig, tempBig, _resBig, NULL, zBegin, zEnd);
+				_reactBigOld, _reactBig, tempReactBig, tempBig, _resBig, NULL, zBegin, zEnd, tilesReactBig);
 		}
 		if (_color_rBig) {
 			FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_rBigOld, _color_rBig, tempColor_rBig, tempBig, _resBig, NULL, zBegin, zEnd);
+				_color_rBigOld, _color_rBig, tempColor_rBig, tempBig, _resBig, NULL, zBegin, zEnd, tilesColor_rBig);
 			FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_gBigOld, _color_gBig, tempColor_gBig, tempBig, _resBig, NULL, zBegin, zEnd);
+				_color_gBigOld, _color_gBig, tempColor_gBig, tempBig, _resBig, NULL, zBegin, zEnd, tilesColor_gBig);
 			FLUID_3D::advectFieldMacCormack2(dtSubdiv, bigUx, bigUy, bigUz, 
-				_color_bBigOld, _color_bBig, tempColor_bBig, tempBig, _resBig, NULL, zBegin, zEnd);
+				_color_bBigOld, _color_bBig, tempColor_bBig, tempBig, _resBig, NULL, zBegin, zEnd, tilesColor_bBig);
 		}
 #if PARALLEL==1
 	}
@@ -1153,12 +1171,7 @@ void WTURBULENCE::stepTurbulenceFull(float dtOrg, float* xvel, float* yvel, floa
 	}
   } // substep
 
-  free(tempDensityBig);
-  if (tempFuelBig) free(tempFuelBig);
-  if (tempReactBig) free(tempReactBig);
-  if (tempColor_rBig) free(tempColor_rBig);
-  if (tempColor_gBig) free(tempColor_gBig);
-  if (tempColor_bBig) free(tempColor_bBig);
+  free(tilesDensityBig);
   free(tempBig);
   free(bigUx);
   free(bigUy);
@@ -77,12 +77,12 @@ extern "C" void smoke_step(FLUID_3D *fluid, float gravity[3], float dtSubdiv)
 {
 	if (fluid->_fuel) {
 		fluid->processBurn(fluid->_fuel, fluid->_density, fluid->_react, fluid->_heat,
-						   fluid->_color_r, fluid->_color_g, fluid->_color_b, fluid->_totalCells, (*fluid->_dtFactor)*dtSubdiv);
+						   fluid->_color_r, fluid->_color_g, fluid->_color_b, fluid->_res, (*fluid->_dtFactor)*dtSubdiv);
 	}
 	fluid->step(dtSubdiv, gravity);
 
 	if (fluid->_fuel) {
-		fluid->updateFlame(fluid->_react, fluid->_flame, fluid->_totalCells);
+		fluid->updateFlame(fluid->_react, fluid->_flame, fluid->_res);
 	}
 }
 
@@ -90,19 +90,21 @@ extern "C" void smoke_turbulence_step(WTURBULENCE *wt, FLUID_3D *fluid)
 {
 	if (wt->_fuelBig) {
 		fluid->processBurn(wt->_fuelBig, wt->_densityBig, wt->_reactBig, 0,
-						   wt->_color_rBig, wt->_color_gBig, wt->_color_bBig, wt->_totalCellsBig, fluid->_dt);
+						   wt->_color_rBig, wt->_color_gBig, wt->_color_bBig, wt->_resBig, fluid->_dt);
 	}
 	wt->stepTurbulenceFull(fluid->_dt/fluid->_dx, fluid->_xVelocity, fluid->_yVelocity, fluid->_zVelocity, fluid->_obstacles);
 
 	if (wt->_fuelBig) {
-		fluid->updateFlame(wt->_reactBig, wt->_flameBig, wt->_totalCellsBig);
+		fluid->updateFlame(wt->_reactBig, wt->_flameBig, wt->_resBig);
 	}
 }
 
 extern "C" void smoke_initBlenderRNA(FLUID_3D *fluid, float *alpha, float *beta, float *dt_factor, float *vorticity, int *border_colli, float *burning_rate,
-									 float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *flame_ignition_temp, float *flame_max_temp)
+									 float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *flame_ignition_temp, float *flame_max_temp,
+									 char *pressure_solver)
 {
-	fluid->initBlenderRNA(alpha, beta, dt_factor, vorticity, border_colli, burning_rate, flame_smoke, flame_smoke_color, flame_vorticity, flame_ignition_temp, flame_max_temp);
+	fluid->initBlenderRNA(alpha, beta, dt_factor, vorticity, border_colli, burning_rate, flame_smoke, flame_smoke_color, flame_vorticity, flame_ignition_temp, flame_max_temp,
+						  pressure_solver);
 }
 
 extern "C" void smoke_initWaveletBlenderRNA(WTURBULENCE *wt, float *strength)
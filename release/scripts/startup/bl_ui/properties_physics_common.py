@@ -164,6 +164,7 @@ def point_cache_ui(self, context, cache, enabled, cachetype):
             col = split.column()
             col.active = cache.use_disk_cache
             col.prop(cache, "use_library_path", "Use Lib Path")
+            col.prop(cache, "use_disk_cache_packed")
 
             row = layout.row()
             row.enabled = enabled and bpy.data.is_saved
@@ -179,6 +180,8 @@ def point_cache_ui(self, context, cache, enabled, cachetype):
                 col = layout.column(align=True)
                 col.label(text="Linked object baking requires Disk Cache to be enabled", icon='INFO')
         else:
+            if cachetype == 'DYNAMIC_PAINT':
+                layout.prop(cache, "use_disk_cache_packed")
             layout.separator()
 
         split = layout.split()
@@ -68,6 +68,8 @@ class PHYSICS_PT_smoke(PhysicButtonsPanel, Panel):
             col.prop(domain, "time_scale", text="Scale")
             col.label(text="Border Collisions:")
             col.prop(domain, "collision_extents", text="")
+            col.label(text="Pressure Solver:")
+            col.prop(domain, "pressure_solver", text="")
 
             col = split.column()
             col.label(text="Behavior:")
@@ -323,6 +325,7 @@ class PHYSICS_PT_smoke_cache(PhysicButtonsPanel, Panel):
         if cache_file_format == 'POINTCACHE':
             layout.label(text="Compression:")
             layout.row().prop(domain, "point_cache_compress_type", expand=True)
+            layout.prop(domain.point_cache, "use_disk_cache_packed")
         elif cache_file_format == 'OPENVDB':
             if not bpy.app.build_options.openvdb:
                 layout.label("Built without OpenVDB support")
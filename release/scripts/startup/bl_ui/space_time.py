@@ -79,6 +79,14 @@ class TIME_HT_header(Header):
 
         layout.prop(scene, "sync_mode", text="")
 
+        row = layout.row(align=True)
+        row.prop(scene, "cache_prefetch_frames", text="Prefetch")
+        if scene.cache_prefetch_frames:
+            # frames read ahead & how many cache reads found their data in memory
+            frames, hit_rate = scene.cache_prefetch_statistics()
+            row.label(text="%d/%d, %d%% hit" % (frames, scene.cache_prefetch_frames, round(hit_rate * 100.0)),
+                      translate=False)
+
         layout.separator()
 
         row = layout.row(align=True)
@@ -0,0 +1,50 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+#ifndef __BKE_CACHE_PREFETCH_H__
+#define __BKE_CACHE_PREFETCH_H__
+
+/** \file BKE_cache_prefetch.h
+ *  \ingroup bke
+ *
+ * Reading of cache files (point caches, mesh caches) ahead of the current frame,
+ * so playback doesn't wait for the disk.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void BKE_cache_prefetch_frame_set(int cfra, int depth);
+int  BKE_cache_prefetch_depth(int *r_step);
+
+void  BKE_cache_prefetch_request(const char *filepath, size_t offset, size_t len, int ahead);
+void *BKE_cache_prefetch_get(const char *filepath, size_t offset, size_t len, size_t *r_len);
+void  BKE_cache_prefetch_invalidate(const char *filepath);
+
+void BKE_cache_prefetch_stats(int *r_frames, float *r_hit_rate, size_t *r_mem);
+
+void BKE_cache_prefetch_exit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __BKE_CACHE_PREFETCH_H__ */
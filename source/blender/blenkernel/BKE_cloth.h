@@ -71,6 +71,7 @@ typedef struct ClothSolverResult {
 	int max_iterations, min_iterations;
 	float avg_iterations;
 	float max_error, min_error, avg_error;
+	float collision_time; /* seconds spent in collision detection and response */
 } ClothSolverResult;
 
 /**
@@ -42,6 +42,7 @@ struct ListBase;
 struct bArmature;
 struct Main;
 struct ModifierData;
+struct Mesh;
 struct BMEditMesh;
 struct DepsNodeHandle;
 
@@ -424,6 +425,27 @@ void        modifier_path_init(char *path, int path_maxlen, const char *name);
 const char *modifier_path_relbase(struct Object *ob);
 
 
+/* modifier_cache.c */
+bool modifier_cache_is_enabled(void);
+unsigned int modifier_cache_key_mesh(
+        struct Object *ob, struct Mesh *me, const float (*vertexCos)[3], const int numVerts,
+        const CustomDataMask dataMask, const int flag);
+bool modifier_cache_is_supported(struct Object *ob, struct ModifierData *md);
+bool modifier_cache_key_modifier(
+        struct Object *ob, struct ModifierData *md, const CustomDataMask mask, unsigned int *r_key);
+bool modifier_cache_store(
+        struct ModifierData *md, const unsigned int key, const double eval_time,
+        struct DerivedMesh *dm, struct DerivedMesh *orcodm, struct DerivedMesh *clothorcodm,
+        const CustomDataMask append_mask);
+bool modifier_cache_has(struct ModifierData *md, const unsigned int key);
+bool modifier_cache_lookup(
+        struct ModifierData *md, const unsigned int key,
+        struct DerivedMesh **r_dm, struct DerivedMesh **r_orcodm, struct DerivedMesh **r_clothorcodm,
+        CustomDataMask *r_append_mask);
+void modifier_cache_tag(struct ModifierData *md, const bool is_hit);
+void modifier_cache_stats_get(struct ModifierData *md, int *r_hits, int *r_misses);
+void modifier_cache_free(struct ModifierData *md);
+
 /* wrappers for modifier callbacks */
 
 struct DerivedMesh *modwrap_applyModifier(
@@ -54,6 +54,8 @@
 /* Add the blendfile name after blendcache_ */
 #define PTCACHE_EXT ".bphys"
 #define PTCACHE_PATH "blendcache_"
+/* Single file containing all frames, see PTCACHE_DISK_PACKED */
+#define PTCACHE_PACKED_EXT ".bpack"
 
 /* File open options, for BKE_ptcache_file_open */
 #define PTCACHE_FILE_READ   0
@@ -112,6 +114,15 @@ typedef struct PTCacheData {
 typedef struct PTCacheFile {
 	FILE *fp;
 
+	/* Packed disk cache (fp is NULL), frames are read from the memory mapped file
+	 * and written to a buffer, which is added to the file on closing. */
+	struct PTCachePacked *packed;
+	unsigned char *mem;
+	size_t mem_len, mem_pos, mem_alloc;
+	/* compressed writes that are deferred to a task (PTCachePackedChunk) */
+	struct ListBase chunks;
+	int mode;
+
 	int frame, old_format;
 	unsigned int totpoint, type;
 	unsigned int data_types, flag;
@@ -333,6 +344,9 @@ void BKE_ptcache_mem_to_disk(struct PTCacheID *pid);
 /* Convert disk cache to memory cache and vice versa. Clears the cache that was converted. */
 void BKE_ptcache_toggle_disk_cache(struct PTCacheID *pid);
 
+/* Convert disk cache files between one file per frame and a single packed file */
+void BKE_ptcache_toggle_disk_packed(struct PTCacheID *pid);
+
 /* Rename all disk cache files with a new name. Doesn't touch the actual content of the files. */
 void BKE_ptcache_disk_cache_rename(struct PTCacheID *pid, const char *name_src, const char *name_dst);
 
@@ -75,6 +75,8 @@ static DerivedMesh *navmesh_dm_createNavMeshForVisualization(DerivedMesh *dm);
 
 #include "BLI_sys_types.h" /* for intptr_t support */
 
+#include "PIL_time.h"
+
 #include "GPU_buffers.h"
 #include "GPU_glew.h"
 #include "GPU_shader.h"
@@ -1726,6 +1728,83 @@ static void dm_ensure_display_normals(DerivedMesh *dm)
 	}
 }
 
+/**
+ * Calculate cache keys for the modifiers starting at \a *r_md,
+ * then resume evaluation after the last one with a cached result.
+ *
+ * \return The number of modifiers with a valid key (written to \a r_keys).
+ */
+static int mesh_calc_modifiers_cache_resume(
+        Scene *scene, Object *ob, Mesh *me, const int required_mode,
+        const CustomDataMask dataMask, const int flag,
+        unsigned int *r_keys, ModifierData **r_md, CDMaskLink **r_curr, int *r_index,
+        float (**r_deformedVerts)[3], const int numVerts, float (*inputVertexCos)[3],
+        DerivedMesh **r_dm, DerivedMesh **r_orcodm, DerivedMesh **r_clothorcodm, CustomDataMask *r_append_mask)
+{
+	ModifierData *md;
+	CDMaskLink *curr;
+	int keys_len = 0;
+	int resume_index = -1;
+
+	/* the key of the input mesh is only needed when there is something to cache */
+	if (!modifier_cache_is_supported(ob, *r_md)) {
+		return 0;
+	}
+
+	unsigned int key = modifier_cache_key_mesh(ob, me, (const float (*)[3])*r_deformedVerts, numVerts, dataMask, flag);
+
+	for (md = *r_md, curr = *r_curr; md; md = md->next, curr = curr->next, keys_len++) {
+		if (!modifier_cache_key_modifier(ob, md, curr->mask, &key)) {
+			break;
+		}
+		r_keys[keys_len] = key;
+
+		if (modifier_cache_has(md, key)) {
+			resume_index = keys_len;
+		}
+	}
+
+	if (resume_index == -1) {
+		return keys_len;
+	}
+
+	md = *r_md;
+	curr = *r_curr;
+	for (int i = 0; i < resume_index; i++) {
+		md = md->next;
+		curr = curr->next;
+	}
+
+	DerivedMesh *dm, *orcodm, *clothorcodm;
+	if (!modifier_cache_lookup(md, r_keys[resume_index], &dm, &orcodm, &clothorcodm, r_append_mask)) {
+		/* freed by another thread in the meantime */
+		return keys_len;
+	}
+
+	if (*r_deformedVerts && (*r_deformedVerts != inputVertexCos)) {
+		MEM_freeN(*r_deformedVerts);
+	}
+	*r_deformedVerts = NULL;
+
+	*r_dm = dm;
+	*r_orcodm = orcodm;
+	*r_clothorcodm = clothorcodm;
+
+	/* the modifiers which results are re-used */
+	for (ModifierData *md_iter = *r_md; md_iter != md->next; md_iter = md_iter->next) {
+		if (modifier_isEnabled(scene, md_iter, required_mode)) {
+			modifier_cache_tag(md_iter, true);
+		}
+	}
+
+	/* continue after the cached modifier */
+	*r_md = md->next;
+	*r_curr = curr->next;
+	*r_index = resume_index + 1;
+
+	return keys_len;
+}
+
 /**
  * new value for useDeform -1  (hack for the gameengine):
  *
@@ -1778,6 +1857,16 @@ static void mesh_calc_modifiers(
 	ModifierApplyFlag app_flags = useRenderParams ? MOD_APPLY_RENDER : 0;
 	ModifierApplyFlag deform_app_flags = app_flags;
 
+	/* Cached results of the modifier stack (see modifier_cache.c),
+	 * only used for interactive updates of regular objects. */
+	const bool use_mod_cache = (
+	        useCache && (useDeform > 0) && (index == -1) && !build_shapekey_layers &&
+	        (ob->mode == OB_MODE_OBJECT) && modifier_cache_is_enabled());
+	unsigned int *mod_cache_keys = NULL;
+	int mod_cache_keys_len = 0;  /* modifiers (from the first non-deform one) with a valid key */
+	int mod_index = 0;
+	double mod_cache_time = 0.0;
+
 
 	if (useCache)
 		app_flags |= MOD_APPLY_USECACHE;
@@ -1887,8 +1976,23 @@ static void mesh_calc_modifiers(
 	orcodm = NULL;
 	clothorcodm = NULL;
 
-	for (; md; md = md->next, curr = curr->next) {
+	if (use_mod_cache && md) {
+		int mod_len = 0;
+		for (ModifierData *md_iter = md; md_iter; md_iter = md_iter->next) {
+			mod_len++;
+		}
+		mod_cache_keys = MEM_mallocN(sizeof(*mod_cache_keys) * (size_t)mod_len, __func__);
+		mod_cache_keys_len = mesh_calc_modifiers_cache_resume(
+		        scene, ob, me, required_mode, dataMask, (need_mapping ? 1 : 0) | (useRenderParams ? 2 : 0),
+		        mod_cache_keys, &md, &curr, &mod_index,
+		        &deformedVerts, numVerts, inputVertexCos,
+		        &dm, &orcodm, &clothorcodm, &append_mask);
+		isPrevDeform = false;
+	}
+
+	for (; md; md = md->next, curr = curr->next, mod_index++) {
 		const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+		const double mod_time_start = (mod_index < mod_cache_keys_len) ? PIL_check_seconds_timer() : 0.0;
 
 		md->scene = scene;
 
@@ -1987,6 +2091,11 @@ static void mesh_calc_modifiers(
 			}
 
 			modwrap_deformVerts(md, ob, dm, deformedVerts, numVerts, deform_app_flags);
+
+			if (mod_index < mod_cache_keys_len) {
+				mod_cache_time += PIL_check_seconds_timer() - mod_time_start;
+				modifier_cache_tag(md, false);
+			}
 		}
 		else {
 			DerivedMesh *ndm;
@@ -2129,6 +2238,20 @@ static void mesh_calc_modifiers(
 			}
 
 			dm->deformedOnly = false;
+
+			if (mod_index < mod_cache_keys_len) {
+				mod_cache_time += PIL_check_seconds_timer() - mod_time_start;
+				modifier_cache_tag(md, false);
+
+				/* only store when the result is complete (no pending deformed coordinates) */
+				if ((deformedVerts == NULL) &&
+				    modifier_cache_store(
+				        md, mod_cache_keys[mod_index], mod_cache_time,
+				        dm, orcodm, clothorcodm, append_mask))
+				{
+					mod_cache_time = 0.0;
+				}
+			}
 		}
 
 		isPrevDeform = (mti->type == eModifierTypeType_OnlyDeform);
@@ -2252,6 +2375,10 @@ static void mesh_calc_modifiers(
 		MEM_freeN(deformedVerts);
 
 	BLI_linklist_free((LinkNode *)datamasks, NULL);
+
+	if (mod_cache_keys) {
+		MEM_freeN(mod_cache_keys);
+	}
 }
 
 float (*editbmesh_get_vertex_cos(BMEditMesh *em, int *r_numVerts))[3]
@@ -49,6 +49,7 @@
 #include "BKE_blender_version.h"  /* own include */
 #include "BKE_blendfile.h"
 #include "BKE_brush.h"
+#include "BKE_cache_prefetch.h"
 #include "BKE_cachefile.h"
 #include "BKE_context.h"
 #include "BKE_depsgraph.h"
@@ -86,6 +87,7 @@ void BKE_blender_free(void)
 	
 	IMB_exit();
 	BKE_cachefiles_exit();
+	BKE_cache_prefetch_exit();
 	BKE_images_exit();
 	DAG_exit();
 
@@ -0,0 +1,506 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenkernel/intern/cache_prefetch.c
+ *  \ingroup bke
+ *
+ * Reading of cache files ahead of the current frame.
+ *
+ * Readers of disk caches request the data they will need for the next frames
+ * (#BKE_cache_prefetch_request), a background thread reads it into memory,
+ * and once the frame is reached the reader takes the data (#BKE_cache_prefetch_get)
+ * instead of reading the file itself. Data is identified by file path and byte range,
+ * so any reader of files can use it.
+ *
+ * Only data for the frames up to #Scene.cache_prefetch ahead of the current frame
+ * (in the direction of playback) is kept, the rest is freed on frame changes.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_fileops.h"
+#include "BLI_ghash.h"
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "BKE_cache_prefetch.h"
+
+/* memory used for data which hasn't been taken yet, further requests are ignored above this */
+#define CACHE_PREFETCH_MEM_MAX ((size_t)512 * 1024 * 1024)
+
+/* number of lookups after which the statistics are halved, so the hit rate follows recent playback */
+#define CACHE_PREFETCH_STATS_WINDOW 256.0f
+
+enum {
+	PREFETCH_QUEUED  = 0,
+	PREFETCH_READING = 1,
+	PREFETCH_READY   = 2,
+};
+
+typedef struct PrefetchEntry {
+	struct PrefetchEntry *next, *prev;
+
+	/* key */
+	char *filepath;
+	size_t offset, len;  /* a len of zero reads until the end of the file */
+
+	int frame;  /* scene frame the data is needed for */
+	int state;
+	bool discard;  /* removed while reading, the reading thread frees it */
+
+	void *data;
+	size_t data_len;
+} PrefetchEntry;
+
+typedef struct CachePrefetch {
+	ThreadCondition cond;
+	ListBase threads;
+	bool is_running, stop;
+
+	ListBase entries;  /* in order of request */
+	GHash *entries_hash;
+	size_t mem;
+
+	int cfra, step, depth;
+
+	float hits, misses;
+} CachePrefetch;
+
+static ThreadMutex prefetch_lock = BLI_MUTEX_INITIALIZER;
+static CachePrefetch prefetch;
+
+/* -------------------------------------------------------------------- */
+/** \name Entries
+ *
+ * All functions expect #prefetch_lock to be held.
+ * \{ */
+
+static unsigned int prefetch_entry_hash(const void *key)
+{
+	const PrefetchEntry *entry = key;
+	size_t hash = BLI_ghashutil_strhash_p(entry->filepath);
+
+	hash = BLI_ghashutil_combine_hash(hash, BLI_ghashutil_uinthash((unsigned int)entry->offset));
+	hash = BLI_ghashutil_combine_hash(hash, BLI_ghashutil_uinthash((unsigned int)entry->len));
+
+	return (unsigned int)hash;
+}
+
+static bool prefetch_entry_cmp(const void *a, const void *b)
+{
+	const PrefetchEntry *entry_a = a, *entry_b = b;
+
+	return ((entry_a->offset != entry_b->offset) ||
+	        (entry_a->len != entry_b->len) ||
+	        !STREQ(entry_a->filepath, entry_b->filepath));
+}
+
+static PrefetchEntry *prefetch_entry_find(const char *filepath, size_t offset, size_t len)
+{
+	PrefetchEntry key;
+
+	if (prefetch.entries_hash == NULL)
+		return NULL;
+
+	key.filepath = (char *)filepath;
+	key.offset = offset;
+	key.len = len;
+
+	return BLI_ghash_lookup(prefetch.entries_hash, &key);
+}
+
+static void prefetch_entry_free(PrefetchEntry *entry)
+{
+	if (entry->data)
+		MEM_freeN(entry->data);
+
+	MEM_freeN(entry->filepath);
+	MEM_freeN(entry);
+}
+
+static void prefetch_entry_remove(PrefetchEntry *entry)
+{
+	BLI_ghash_remove(prefetch.entries_hash, entry, NULL, NULL);
+	BLI_remlink(&prefetch.entries, entry);
+
+	switch (entry->state) {
+		case PREFETCH_QUEUED:
+			prefetch_entry_free(entry);
+			break;
+		case PREFETCH_READING:
+			entry->discard = true;
+			break;
+		case PREFETCH_READY:
+			prefetch.mem -= entry->data_len;
+			prefetch_entry_free(entry);
+			break;
+	}
+}
+
+/* the queued entry needed first */
+static PrefetchEntry *prefetch_queue_next(void)
+{
+	PrefetchEntry *entry, *entry_next = NULL;
+
+	for (entry = prefetch.entries.first; entry; entry = entry->next) {
+		if (entry->state == PREFETCH_QUEUED) {
+			if (entry_next == NULL ||
+			    (entry->frame - entry_next->frame) * prefetch.step < 0)
+			{
+				entry_next = entry;
+			}
+		}
+	}
+
+	return entry_next;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Reading Thread
+ * \{ */
+
+static void *prefetch_file_read(const char *filepath, size_t offset, size_t len, size_t *r_len)
+{
+	FILE *fp = BLI_fopen(filepath, "rb");
+	void *data = NULL;
+
+	if (fp == NULL)
+		return NULL;
+
+	if (len == 0 && fseek(fp, 0, SEEK_END) == 0) {
+		const long size = ftell(fp);
+
+		if (size > (long)offset)
+			len = (size_t)size - offset;
+	}
+
+	if (len && fseek(fp, (long)offset, SEEK_SET) == 0) {
+		data = MEM_mallocN(len, "CachePrefetch data");
+
+		if (fread(data, sizeof(unsigned char), len, fp) != len) {
+			MEM_freeN(data);
+			data = NULL;
+		}
+	}
+
+	fclose(fp);
+
+	*r_len = len;
+	return data;
+}
+
+static void *prefetch_thread(void *UNUSED(arg))
+{
+	BLI_mutex_lock(&prefetch_lock);
+
+	while (!prefetch.stop) {
+		PrefetchEntry *entry = prefetch_queue_next();
+		void *data;
+		size_t data_len = 0;
+
+		if (entry == NULL) {
+			BLI_condition_wait(&prefetch.cond, &prefetch_lock);
+			continue;
+		}
+
+		entry->state = PREFETCH_READING;
+		BLI_mutex_unlock(&prefetch_lock);
+
+		data = prefetch_file_read(entry->filepath, entry->offset, entry->len, &data_len);
+
+		BLI_mutex_lock(&prefetch_lock);
+
+		if (entry->discard) {
+			if (data)
+				MEM_freeN(data);
+			prefetch_entry_free(entry);
+		}
+		else if (data == NULL || prefetch.mem + data_len > CACHE_PREFETCH_MEM_MAX) {
+			if (data)
+				MEM_freeN(data);
+			entry->state = PREFETCH_READY;
+			prefetch_entry_remove(entry);
+		}
+		else {
+			entry->data = data;
+			entry->data_len = data_len;
+			entry->state = PREFETCH_READY;
+			prefetch.mem += data_len;
+		}
+	}
+
+	BLI_mutex_unlock(&prefetch_lock);
+
+	return NULL;
+}
+
+static void prefetch_thread_ensure(void)
+{
+	if (!prefetch.is_running) {
+		BLI_condition_init(&prefetch.cond);
+		BLI_init_threads(&prefetch.threads, prefetch_thread, 1);
+		BLI_insert_thread(&prefetch.threads, NULL);
+		prefetch.is_running = true;
+		prefetch.stop = false;
+	}
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Public API
+ * \{ */
+
+/**
+ * Set the current scene frame, data for frames which are no longer ahead is freed.
+ *
+ * \param depth: Number of frames to read ahead, zero disables prefetching.
+ */
+void BKE_cache_prefetch_frame_set(int cfra, int depth)
+{
+	PrefetchEntry *entry, *entry_next;
+
+	BLI_mutex_lock(&prefetch_lock);
+
+	if (depth != prefetch.depth) {
+		prefetch.hits = prefetch.misses = 0.0f;
+	}
+
+	if (cfra != prefetch.cfra) {
+		prefetch.step = (cfra > prefetch.cfra) ? 1 : -1;
+	}
+	else if (prefetch.step == 0) {
+		prefetch.step = 1;
+	}
+
+	prefetch.cfra = cfra;
+	prefetch.depth = depth;
+
+	for (entry = prefetch.entries.first; entry; entry = entry_next) {
+		const int ahead = (entry->frame - cfra) * prefetch.step;
+
+		entry_next = entry->next;
+
+		if (ahead < 0 || ahead > depth)
+			prefetch_entry_remove(entry);
+	}
+
+	BLI_mutex_unlock(&prefetch_lock);
+}
+
+/**
+ * \return the number of frames to read ahead (zero when disabled),
+ * \a r_step is set to the direction of playback (1 or -1).
+ */
+int BKE_cache_prefetch_depth(int *r_step)
+{
+	int depth;
+
+	BLI_mutex_lock(&prefetch_lock);
+	depth = prefetch.depth;
+	*r_step = prefetch.step;
+	BLI_mutex_unlock(&prefetch_lock);
+
+	return depth;
+}
+
+/**
+ * Request data to be read in the background.
+ *
+ * \param len: Number of bytes to read from \a offset, zero to read the whole file.
+ * \param ahead: Number of frames after the current one the data is needed for.
+ */
+void BKE_cache_prefetch_request(const char *filepath, size_t offset, size_t len, int ahead)
+{
+	PrefetchEntry *entry;
+
+	BLI_mutex_lock(&prefetch_lock);
+
+	if (ahead > 0 && ahead <= prefetch.depth && !prefetch.stop) {
+		const int frame = prefetch.cfra + prefetch.step * ahead;
+
+		entry = prefetch_entry_find(filepath, offset, len);
+
+		if (entry) {
+			entry->frame = frame;
+		}
+		else if (prefetch.mem < CACHE_PREFETCH_MEM_MAX) {
+			if (prefetch.entries_hash == NULL) {
+				prefetch.entries_hash = BLI_ghash_new(prefetch_entry_hash, prefetch_entry_cmp, __func__);
+			}
+
+			entry = MEM_callocN(sizeof(PrefetchEntry), __func__);
+			entry->filepath = BLI_strdup(filepath);
+			entry->offset = offset;
+			entry->len = len;
+			entry->frame = frame;
+			entry->state = PREFETCH_QUEUED;
+
+			BLI_addtail(&prefetch.entries, entry);
+			BLI_ghash_insert(prefetch.entries_hash, entry, entry);
+
+			prefetch_thread_ensure();
+			BLI_condition_notify_one(&prefetch.cond);
+		}
+	}
+
+	BLI_mutex_unlock(&prefetch_lock);
+}
+
+/**
+ * Take data read by the background thread, the caller owns the returned memory.
+ *
+ * \return NULL when the data isn't (yet) in memory, the caller reads the file instead.
+ */
+void *BKE_cache_prefetch_get(const char *filepath, size_t offset, size_t len, size_t *r_len)
+{
+	PrefetchEntry *entry;
+	void *data = NULL;
+
+	BLI_mutex_lock(&prefetch_lock);
+
+	if (prefetch.depth) {
+		entry = prefetch_entry_find(filepath, offset, len);
+
+		if (entry && entry->state == PREFETCH_READY) {
+			data = entry->data;
+			*r_len = entry->data_len;
+
+			entry->data = NULL;
+			prefetch_entry_remove(entry);
+			prefetch.hits += 1.0f;
+		}
+		else {
+			prefetch.misses += 1.0f;
+		}
+
+		if (prefetch.hits + prefetch.misses > CACHE_PREFETCH_STATS_WINDOW) {
+			prefetch.hits *= 0.5f;
+			prefetch.misses *= 0.5f;
+		}
+	}
+
+	BLI_mutex_unlock(&prefetch_lock);
+
+	return data;
+}
+
+/**
+ * Free all data read from \a filepath, call before writing to the file.
+ */
+void BKE_cache_prefetch_invalidate(const char *filepath)
+{
+	PrefetchEntry *entry, *entry_next;
+
+	BLI_mutex_lock(&prefetch_lock);
+
+	for (entry = prefetch.entries.first; entry; entry = entry_next) {
+		entry_next = entry->next;
+
+		if (STREQ(entry->filepath, filepath))
+			prefetch_entry_remove(entry);
+	}
+
+	BLI_mutex_unlock(&prefetch_lock);
+}
+
+/**
+ * \param r_frames: Number of frames ahead of the current one for which all requested data is in memory.
+ * \param r_hit_rate: Fraction of recent reads which found their data in memory.
+ * \param r_mem: Memory used by data which wasn't taken yet.
+ */
+void BKE_cache_prefetch_stats(int *r_frames, float *r_hit_rate, size_t *r_mem)
+{
+	PrefetchEntry *entry;
+	int frames = 0;
+
+	BLI_mutex_lock(&prefetch_lock);
+
+	if (prefetch.depth > 0) {
+		int *ready = MEM_callocN(sizeof(int) * (size_t)(prefetch.depth + 1), __func__);
+		int *pending = MEM_callocN(sizeof(int) * (size_t)(prefetch.depth + 1), __func__);
+
+		for (entry = prefetch.entries.first; entry; entry = entry->next) {
+			const int ahead = (entry->frame - prefetch.cfra) * prefetch.step;
+
+			if (ahead >= 1 && ahead <= prefetch.depth) {
+				if (entry->state == PREFETCH_READY)
+					ready[ahead]++;
+				else
+					pending[ahead]++;
+			}
+		}
+
+		while (frames < prefetch.depth && ready[frames + 1] && !pending[frames + 1]) {
+			frames++;
+		}
+
+		MEM_freeN(ready);
+		MEM_freeN(pending);
+	}
+
+	*r_frames = frames;
+	*r_hit_rate = (prefetch.hits + prefetch.misses > 0.0f) ?
+	              prefetch.hits / (prefetch.hits + prefetch.misses) : 0.0f;
+	*r_mem = prefetch.mem;
+
+	BLI_mutex_unlock(&prefetch_lock);
+}
+
+void BKE_cache_prefetch_exit(void)
+{
+	PrefetchEntry *entry, *entry_next;
+	bool is_running;
+
+	BLI_mutex_lock(&prefetch_lock);
+
+	for (entry = prefetch.entries.first; entry; entry = entry_next) {
+		entry_next = entry->next;
+		prefetch_entry_remove(entry);
+	}
+
+	prefetch.stop = true;
+	is_running = prefetch.is_running;
+
+	if (is_running)
+		BLI_condition_notify_all(&prefetch.cond);
+
+	BLI_mutex_unlock(&prefetch_lock);
+
+	if (is_running) {
+		BLI_end_threads(&prefetch.threads);
+		BLI_condition_end(&prefetch.cond);
+		prefetch.is_running = false;
+	}
+
+	if (prefetch.entries_hash) {
+		BLI_ghash_free(prefetch.entries_hash, NULL, NULL);
+		prefetch.entries_hash = NULL;
+	}
+}
+
+/** \} */
@@ -44,6 +44,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_math.h"
 #include "BLI_edgehash.h"
+#include "BLI_task.h"
 
 #include "BKE_cloth.h"
 #include "BKE_effect.h"
@@ -226,165 +227,203 @@ DO_INLINE void collision_interpolateOnTriangle ( float to[3], float v1[3], float
 	VECADDMUL(to, v3, w3);
 }
 
-static int cloth_collision_response_static ( ClothModifierData *clmd, CollisionModifierData *collmd, CollPair *collpair, CollPair *collision_end )
+/* impulses of one collision pair on the cloth triangle vertices */
+typedef struct CollPairImpulse {
+	float i1[3], i2[3], i3[3];
+	bool has_impulse;
+} CollPairImpulse;
+
+typedef struct ClothCollisionResponseData {
+	ClothModifierData *clmd;
+	CollisionModifierData *collmd;
+	CollPair *collisions;
+	CollPairImpulse *impulses;
+} ClothCollisionResponseData;
+
+/* only reads the cloth vertices, so pairs can be computed in parallel */
+static void cloth_collision_response_pair_cb(void *userdata, const int index)
 {
-	int result = 0;
-	Cloth *cloth1;
+	ClothCollisionResponseData *data = userdata;
+	ClothModifierData *clmd = data->clmd;
+	CollisionModifierData *collmd = data->collmd;
+	CollPair *collpair = &data->collisions[index];
+	CollPairImpulse *pair_impulse = &data->impulses[index];
+	Cloth *cloth1 = clmd->clothObject;
 	float w1, w2, w3, u1, u2, u3;
 	float v1[3], v2[3], relativeVelocity[3];
 	float magrelVel;
 	float epsilon2 = BLI_bvhtree_get_epsilon ( collmd->bvhtree );
+	float *i1 = pair_impulse->i1, *i2 = pair_impulse->i2, *i3 = pair_impulse->i3;
 
-	cloth1 = clmd->clothObject;
+	zero_v3(i1);
+	zero_v3(i2);
+	zero_v3(i3);
+	pair_impulse->has_impulse = false;
 
-	for ( ; collpair != collision_end; collpair++ ) {
-		float i1[3], i2[3], i3[3];
+	/* only handle static collisions here */
+	if ( collpair->flag & COLLISION_IN_FUTURE )
+		return;
 
-		zero_v3(i1);
-		zero_v3(i2);
-		zero_v3(i3);
+	/* compute barycentric coordinates for both collision points */
+	collision_compute_barycentric ( collpair->pa,
+		cloth1->verts[collpair->ap1].txold,
+		cloth1->verts[collpair->ap2].txold,
+		cloth1->verts[collpair->ap3].txold,
+		&w1, &w2, &w3 );
 
-		/* only handle static collisions here */
-		if ( collpair->flag & COLLISION_IN_FUTURE )
-			continue;
+	/* was: txold */
+	collision_compute_barycentric ( collpair->pb,
+		collmd->current_x[collpair->bp1].co,
+		collmd->current_x[collpair->bp2].co,
+		collmd->current_x[collpair->bp3].co,
+		&u1, &u2, &u3 );
 
-		/* compute barycentric coordinates for both collision points */
-		collision_compute_barycentric ( collpair->pa,
-			cloth1->verts[collpair->ap1].txold,
-			cloth1->verts[collpair->ap2].txold,
-			cloth1->verts[collpair->ap3].txold,
-			&w1, &w2, &w3 );
+	/* Calculate relative "velocity". */
+	collision_interpolateOnTriangle ( v1, cloth1->verts[collpair->ap1].tv, cloth1->verts[collpair->ap2].tv, cloth1->verts[collpair->ap3].tv, w1, w2, w3 );
 
-		/* was: txold */
-		collision_compute_barycentric ( collpair->pb,
-			collmd->current_x[collpair->bp1].co,
-			collmd->current_x[collpair->bp2].co,
-			collmd->current_x[collpair->bp3].co,
-			&u1, &u2, &u3 );
+	collision_interpolateOnTriangle ( v2, collmd->current_v[collpair->bp1].co, collmd->current_v[collpair->bp2].co, collmd->current_v[collpair->bp3].co, u1, u2, u3 );
 
-		/* Calculate relative "velocity". */
-		collision_interpolateOnTriangle ( v1, cloth1->verts[collpair->ap1].tv, cloth1->verts[collpair->ap2].tv, cloth1->verts[collpair->ap3].tv, w1, w2, w3 );
+	sub_v3_v3v3(relativeVelocity, v2, v1);
 
-		collision_interpolateOnTriangle ( v2, collmd->current_v[collpair->bp1].co, collmd->current_v[collpair->bp2].co, collmd->current_v[collpair->bp3].co, u1, u2, u3 );
+	/* Calculate the normal component of the relative velocity (actually only the magnitude - the direction is stored in 'normal'). */
+	magrelVel = dot_v3v3(relativeVelocity, collpair->normal);
 
-		sub_v3_v3v3(relativeVelocity, v2, v1);
+	/* printf("magrelVel: %f\n", magrelVel); */
 
-		/* Calculate the normal component of the relative velocity (actually only the magnitude - the direction is stored in 'normal'). */
-		magrelVel = dot_v3v3(relativeVelocity, collpair->normal);
+	/* Calculate masses of points.
+	 * TODO */
 
-		/* printf("magrelVel: %f\n", magrelVel); */
+	/* If v_n_mag < 0 the edges are approaching each other. */
+	if ( magrelVel > ALMOST_ZERO ) {
+		/* Calculate Impulse magnitude to stop all motion in normal direction. */
+		float magtangent = 0, repulse = 0, d = 0;
+		double impulse = 0.0;
+		float vrel_t_pre[3];
+		float temp[3], spf;
 
-		/* Calculate masses of points.
-		 * TODO */
+		/* calculate tangential velocity */
+		copy_v3_v3 ( temp, collpair->normal );
+		mul_v3_fl(temp, magrelVel);
+		sub_v3_v3v3(vrel_t_pre, relativeVelocity, temp);
 
-		/* If v_n_mag < 0 the edges are approaching each other. */
-		if ( magrelVel > ALMOST_ZERO ) {
-			/* Calculate Impulse magnitude to stop all motion in normal direction. */
-			float magtangent = 0, repulse = 0, d = 0;
-			double impulse = 0.0;
-			float vrel_t_pre[3];
-			float temp[3], spf;
+		/* Decrease in magnitude of relative tangential velocity due to coulomb friction
+		 * in original formula "magrelVel" should be the "change of relative velocity in normal direction" */
+		magtangent = min_ff(clmd->coll_parms->friction * 0.01f * magrelVel, len_v3(vrel_t_pre));
 
-			/* calculate tangential velocity */
-			copy_v3_v3 ( temp, collpair->normal );
-			mul_v3_fl(temp, magrelVel);
-			sub_v3_v3v3(vrel_t_pre, relativeVelocity, temp);
+		/* Apply friction impulse. */
+		if ( magtangent > ALMOST_ZERO ) {
+			normalize_v3(vrel_t_pre);
 
-			/* Decrease in magnitude of relative tangential velocity due to coulomb friction
-			 * in original formula "magrelVel" should be the "change of relative velocity in normal direction" */
-			magtangent = min_ff(clmd->coll_parms->friction * 0.01f * magrelVel, len_v3(vrel_t_pre));
+			impulse = magtangent / ( 1.0f + w1*w1 + w2*w2 + w3*w3 ); /* 2.0 * */
+			VECADDMUL ( i1, vrel_t_pre, w1 * impulse );
+			VECADDMUL ( i2, vrel_t_pre, w2 * impulse );
+			VECADDMUL ( i3, vrel_t_pre, w3 * impulse );
+		}
 
-			/* Apply friction impulse. */
-			if ( magtangent > ALMOST_ZERO ) {
-				normalize_v3(vrel_t_pre);
+		/* Apply velocity stopping impulse
+		 * I_c = m * v_N / 2.0
+		 * no 2.0 * magrelVel normally, but looks nicer DG */
+		impulse =  magrelVel / ( 1.0 + w1*w1 + w2*w2 + w3*w3 );
+
+		VECADDMUL ( i1, collpair->normal, w1 * impulse );
+		VECADDMUL ( i2, collpair->normal, w2 * impulse );
+		VECADDMUL ( i3, collpair->normal, w3 * impulse );
+
+		/* Apply repulse impulse if distance too short
+		 * I_r = -min(dt*kd, m(0, 1d/dt - v_n))
+		 * DG: this formula ineeds to be changed for this code since we apply impulses/repulses like this:
+		 * v += impulse; x_new = x + v;
+		 * We don't use dt!!
+		 * DG TODO: Fix usage of dt here! */
+		spf = (float)clmd->sim_parms->stepsPerFrame / clmd->sim_parms->timescale;
+
+		d = clmd->coll_parms->epsilon*8.0f/9.0f + epsilon2*8.0f/9.0f - collpair->distance;
+		if ( ( magrelVel < 0.1f*d*spf ) && ( d > ALMOST_ZERO ) ) {
+			repulse = MIN2 ( d*1.0f/spf, 0.1f*d*spf - magrelVel );
+
+			/* stay on the safe side and clamp repulse */
+			if ( impulse > ALMOST_ZERO )
+				repulse = min_ff( repulse, 5.0*impulse );
+			repulse = max_ff(impulse, repulse);
+
+			impulse = repulse / ( 1.0f + w1*w1 + w2*w2 + w3*w3 ); /* original 2.0 / 0.25 */
+			VECADDMUL ( i1, collpair->normal,  impulse );
+			VECADDMUL ( i2, collpair->normal,  impulse );
+			VECADDMUL ( i3, collpair->normal,  impulse );
+		}
 
-				impulse = magtangent / ( 1.0f + w1*w1 + w2*w2 + w3*w3 ); /* 2.0 * */
-				VECADDMUL ( i1, vrel_t_pre, w1 * impulse );
-				VECADDMUL ( i2, vrel_t_pre, w2 * impulse );
-				VECADDMUL ( i3, vrel_t_pre, w3 * impulse );
-			}
+		pair_impulse->has_impulse = true;
+	}
+	else {
+		/* Apply repulse impulse if distance too short
+		 * I_r = -min(dt*kd, max(0, 1d/dt - v_n))
+		 * DG: this formula ineeds to be changed for this code since we apply impulses/repulses like this:
+		 * v += impulse; x_new = x + v;
+		 * We don't use dt!! */
+		float spf = (float)clmd->sim_parms->stepsPerFrame / clmd->sim_parms->timescale;
 
-			/* Apply velocity stopping impulse
-			 * I_c = m * v_N / 2.0
-			 * no 2.0 * magrelVel normally, but looks nicer DG */
-			impulse =  magrelVel / ( 1.0 + w1*w1 + w2*w2 + w3*w3 );
+		float d = clmd->coll_parms->epsilon*8.0f/9.0f + epsilon2*8.0f/9.0f - (float)collpair->distance;
+		if ( d > ALMOST_ZERO) {
+			/* stay on the safe side and clamp repulse */
+			float repulse = d*1.0f/spf;
 
-			VECADDMUL ( i1, collpair->normal, w1 * impulse );
-			cloth1->verts[collpair->ap1].impulse_count++;
+			float impulse = repulse / ( 3.0f * ( 1.0f + w1*w1 + w2*w2 + w3*w3 )); /* original 2.0 / 0.25 */
 
-			VECADDMUL ( i2, collpair->normal, w2 * impulse );
-			cloth1->verts[collpair->ap2].impulse_count++;
-
-			VECADDMUL ( i3, collpair->normal, w3 * impulse );
-			cloth1->verts[collpair->ap3].impulse_count++;
-
-			/* Apply repulse impulse if distance too short
-			 * I_r = -min(dt*kd, m(0, 1d/dt - v_n))
-			 * DG: this formula ineeds to be changed for this code since we apply impulses/repulses like this:
-			 * v += impulse; x_new = x + v;
-			 * We don't use dt!!
-			 * DG TODO: Fix usage of dt here! */
-			spf = (float)clmd->sim_parms->stepsPerFrame / clmd->sim_parms->timescale;
-
-			d = clmd->coll_parms->epsilon*8.0f/9.0f + epsilon2*8.0f/9.0f - collpair->distance;
-			if ( ( magrelVel < 0.1f*d*spf ) && ( d > ALMOST_ZERO ) ) {
-				repulse = MIN2 ( d*1.0f/spf, 0.1f*d*spf - magrelVel );
-
-				/* stay on the safe side and clamp repulse */
-				if ( impulse > ALMOST_ZERO )
-					repulse = min_ff( repulse, 5.0*impulse );
-				repulse = max_ff(impulse, repulse);
-
-				impulse = repulse / ( 1.0f + w1*w1 + w2*w2 + w3*w3 ); /* original 2.0 / 0.25 */
-				VECADDMUL ( i1, collpair->normal,  impulse );
-				VECADDMUL ( i2, collpair->normal,  impulse );
-				VECADDMUL ( i3, collpair->normal,  impulse );
-			}
+			VECADDMUL ( i1, collpair->normal,  impulse );
+			VECADDMUL ( i2, collpair->normal,  impulse );
+			VECADDMUL ( i3, collpair->normal,  impulse );
 
-			result = 1;
+			pair_impulse->has_impulse = true;
 		}
-		else {
-			/* Apply repulse impulse if distance too short
-			 * I_r = -min(dt*kd, max(0, 1d/dt - v_n))
-			 * DG: this formula ineeds to be changed for this code since we apply impulses/repulses like this:
-			 * v += impulse; x_new = x + v;
-			 * We don't use dt!! */
-			float spf = (float)clmd->sim_parms->stepsPerFrame / clmd->sim_parms->timescale;
+	}
+}
 
-			float d = clmd->coll_parms->epsilon*8.0f/9.0f + epsilon2*8.0f/9.0f - (float)collpair->distance;
-			if ( d > ALMOST_ZERO) {
-				/* stay on the safe side and clamp repulse */
-				float repulse = d*1.0f/spf;
+static int cloth_collision_response_static ( ClothModifierData *clmd, CollisionModifierData *collmd, CollPair *collpair, CollPair *collision_end )
+{
+	ClothCollisionResponseData data;
+	ClothVertex *verts = clmd->clothObject->verts;
+	const int collisions_num = (int)(collision_end - collpair);
+	int result = 0;
+	int i, j;
 
-				float impulse = repulse / ( 3.0f * ( 1.0f + w1*w1 + w2*w2 + w3*w3 )); /* original 2.0 / 0.25 */
+	if (collisions_num == 0)
+		return 0;
 
-				VECADDMUL ( i1, collpair->normal,  impulse );
-				VECADDMUL ( i2, collpair->normal,  impulse );
-				VECADDMUL ( i3, collpair->normal,  impulse );
+	data.clmd = clmd;
+	data.collmd = collmd;
+	data.collisions = collpair;
+	data.impulses = MEM_mallocN(sizeof(*data.impulses) * (size_t)collisions_num, __func__);
 
-				cloth1->verts[collpair->ap1].impulse_count++;
-				cloth1->verts[collpair->ap2].impulse_count++;
-				cloth1->verts[collpair->ap3].impulse_count++;
+	BLI_task_parallel_range(0, collisions_num, &data, cloth_collision_response_pair_cb, collisions_num > 256);
 
-				result = 1;
-			}
-		}
+	/* apply in order of pairs, keeping the largest impulse per axis,
+	 * so the result doesn't depend on the number of threads */
+	for (i = 0; i < collisions_num; i++, collpair++) {
+		const CollPairImpulse *pair_impulse = &data.impulses[i];
 
-		if (result) {
-			int i = 0;
+		if (!pair_impulse->has_impulse)
+			continue;
 
-			for (i = 0; i < 3; i++) {
-				if (cloth1->verts[collpair->ap1].impulse_count > 0 && ABS(cloth1->verts[collpair->ap1].impulse[i]) < ABS(i1[i]))
-					cloth1->verts[collpair->ap1].impulse[i] = i1[i];
+		verts[collpair->ap1].impulse_count++;
+		verts[collpair->ap2].impulse_count++;
+		verts[collpair->ap3].impulse_count++;
 
-				if (cloth1->verts[collpair->ap2].impulse_count > 0 && ABS(cloth1->verts[collpair->ap2].impulse[i]) < ABS(i2[i]))
-					cloth1->verts[collpair->ap2].impulse[i] = i2[i];
+		for (j = 0; j < 3; j++) {
+			if (ABS(verts[collpair->ap1].impulse[j]) < ABS(pair_impulse->i1[j]))
+				verts[collpair->ap1].impulse[j] = pair_impulse->i1[j];
 
-				if (cloth1->verts[collpair->ap3].impulse_count > 0 && ABS(cloth1->verts[collpair->ap3].impulse[i]) < ABS(i3[i]))
-					cloth1->verts[collpair->ap3].impulse[i] = i3[i];
-			}
+			if (ABS(verts[collpair->ap2].impulse[j]) < ABS(pair_impulse->i2[j]))
+				verts[collpair->ap2].impulse[j] = pair_impulse->i2[j];
+
+			if (ABS(verts[collpair->ap3].impulse[j]) < ABS(pair_impulse->i3[j]))
+				verts[collpair->ap3].impulse[j] = pair_impulse->i3[j];
 		}
+
+		result = 1;
 	}
+
+	MEM_freeN(data.impulses);
+
 	return result;
 }
 
@@ -619,18 +658,65 @@ void free_collider_cache(ListBase **colliders)
 }
 
 
+/* number of overlaps checked per task */
+#define CLOTH_NEARCHECK_CHUNK_SIZE 1024
+
+typedef struct ClothNearcheckData {
+	ClothModifierData *clmd;
+	CollisionModifierData *collmd;
+	BVHTreeOverlap *overlap;
+	int numresult;
+	double dt;
+	CollPair *collisions;
+	int *chunk_collisions_num;
+} ClothNearcheckData;
+
+static void cloth_bvh_objcollisions_nearcheck_cb(void *userdata, const int chunk)
+{
+	ClothNearcheckData *data = userdata;
+	const int start = chunk * CLOTH_NEARCHECK_CHUNK_SIZE;
+	const int end = min_ii(start + CLOTH_NEARCHECK_CHUNK_SIZE, data->numresult);
+	CollPair *collisions_chunk = data->collisions + start;
+	CollPair *collisions_index = collisions_chunk;
+	int i;
+
+	for (i = start; i < end; i++) {
+		collisions_index = cloth_collision((ModifierData *)data->clmd, (ModifierData *)data->collmd,
+		                                   data->overlap + i, collisions_index, data->dt);
+	}
+
+	data->chunk_collisions_num[chunk] = (int)(collisions_index - collisions_chunk);
+}
+
 static void cloth_bvh_objcollisions_nearcheck ( ClothModifierData * clmd, CollisionModifierData *collmd,
 	CollPair **collisions, CollPair **collisions_index, int numresult, BVHTreeOverlap *overlap, double dt)
 {
-	int i;
-	
-	*collisions = (CollPair *) MEM_mallocN(sizeof(CollPair) * numresult * 4, "collision array" ); // * 4 since cloth_collision_static can return more than 1 collision
-	*collisions_index = *collisions;
+	ClothNearcheckData data;
+	const int chunks = (numresult + CLOTH_NEARCHECK_CHUNK_SIZE - 1) / CLOTH_NEARCHECK_CHUNK_SIZE;
+	int chunk;
 
-	for ( i = 0; i < numresult; i++ ) {
-		*collisions_index = cloth_collision((ModifierData *)clmd, (ModifierData *)collmd,
-		                                    overlap+i, *collisions_index, dt);
+	/* cloth_collision adds at most one pair per overlap, so each chunk writes within its own range */
+	*collisions = (CollPair *) MEM_mallocN(sizeof(CollPair) * numresult, "collision array" );
+
+	data.clmd = clmd;
+	data.collmd = collmd;
+	data.overlap = overlap;
+	data.numresult = numresult;
+	data.dt = dt;
+	data.collisions = *collisions;
+	data.chunk_collisions_num = MEM_mallocN(sizeof(int) * chunks, __func__);
+
+	BLI_task_parallel_range(0, chunks, &data, cloth_bvh_objcollisions_nearcheck_cb, chunks > 1);
+
+	/* pack the pairs of all chunks, in order of overlaps */
+	*collisions_index = *collisions;
+	for (chunk = 0; chunk < chunks; chunk++) {
+		memmove(*collisions_index, *collisions + chunk * CLOTH_NEARCHECK_CHUNK_SIZE,
+		        sizeof(CollPair) * data.chunk_collisions_num[chunk]);
+		*collisions_index += data.chunk_collisions_num[chunk];
 	}
+
+	MEM_freeN(data.chunk_collisions_num);
 }
 
 static int cloth_bvh_objcollisions_resolve ( ClothModifierData * clmd, CollisionModifierData *collmd, CollPair *collisions, CollPair *collisions_index)
@@ -675,6 +761,40 @@ static int cloth_bvh_objcollisions_resolve ( ClothModifierData * clmd, Collision
 	return ret;
 }
 
+typedef struct ClothObjCollisionsData {
+	ClothModifierData *clmd;
+	Object **collobjs;
+	CollPair **collisions, **collisions_index;
+	double dt;
+} ClothObjCollisionsData;
+
+/* find the collision pairs with one collider */
+static void cloth_bvh_objcollisions_find_cb(void *userdata, const int i)
+{
+	ClothObjCollisionsData *data = userdata;
+	ClothModifierData *clmd = data->clmd;
+	Object *collob = data->collobjs[i];
+	CollisionModifierData *collmd = (CollisionModifierData *)modifiers_findByType(collob, eModifierType_Collision);
+	BVHTreeOverlap *overlap = NULL;
+	unsigned int result = 0;
+
+	if (!collmd->bvhtree)
+		return;
+
+	/* search for overlapping collision pairs */
+	overlap = BLI_bvhtree_overlap(clmd->clothObject->bvhtree, collmd->bvhtree, &result, NULL, NULL);
+
+	// go to next object if no overlap is there
+	if ( result && overlap ) {
+		/* check if collisions really happen (costly near check) */
+		cloth_bvh_objcollisions_nearcheck ( clmd, collmd, &data->collisions[i],
+			&data->collisions_index[i], result, overlap, data->dt);
+	}
+
+	if ( overlap )
+		MEM_freeN ( overlap );
+}
+
 // cloth - object collisions
 int cloth_bvh_objcollision(Object *ob, ClothModifierData *clmd, float step, float dt )
 {
@@ -686,6 +806,8 @@ int cloth_bvh_objcollision(Object *ob, ClothModifierData *clmd, float step, floa
 	int ret = 0, ret2 = 0;
 	Object **collobjs = NULL;
 	unsigned int numcollobj = 0;
+	CollPair **collisions, **collisions_index;
+	ClothObjCollisionsData data;
 
 	if ((clmd->sim_parms->flags & CLOTH_SIMSETTINGS_FLAG_COLLOBJ) || cloth_bvh==NULL)
 		return 0;
@@ -719,49 +841,32 @@ int cloth_bvh_objcollision(Object *ob, ClothModifierData *clmd, float step, floa
 		collision_move_object ( collmd, step + dt, step );
 	}
 
+	collisions = MEM_callocN(sizeof(CollPair *) *numcollobj, "CollPair");
+	collisions_index = MEM_callocN(sizeof(CollPair *) *numcollobj, "CollPair");
+
+	/* The pairs only depend on the start positions of the cloth (txold) and the colliders,
+	 * which don't change in the rounds below: find them once, for all colliders in parallel. */
+	data.clmd = clmd;
+	data.collobjs = collobjs;
+	data.collisions = collisions;
+	data.collisions_index = collisions_index;
+	data.dt = dt/(float)clmd->coll_parms->loop_count;
+
+	BLI_task_parallel_range(0, (int)numcollobj, &data, cloth_bvh_objcollisions_find_cb, numcollobj > 1);
+
 	do {
-		CollPair **collisions, **collisions_index;
-		
 		ret2 = 0;
 
-		collisions = MEM_callocN(sizeof(CollPair *) *numcollobj, "CollPair");
-		collisions_index = MEM_callocN(sizeof(CollPair *) *numcollobj, "CollPair");
-		
-		// check all collision objects
+		// resolve nearby collisions, one collider after the other (they change the velocities)
 		for (i = 0; i < numcollobj; i++) {
-			Object *collob= collobjs[i];
-			CollisionModifierData *collmd = (CollisionModifierData *)modifiers_findByType(collob, eModifierType_Collision);
-			BVHTreeOverlap *overlap = NULL;
-			unsigned int result = 0;
-			
-			if (!collmd->bvhtree)
-				continue;
-			
-			/* search for overlapping collision pairs */
-			overlap = BLI_bvhtree_overlap(cloth_bvh, collmd->bvhtree, &result, NULL, NULL);
-				
-			// go to next object if no overlap is there
-			if ( result && overlap ) {
-				/* check if collisions really happen (costly near check) */
-				cloth_bvh_objcollisions_nearcheck ( clmd, collmd, &collisions[i], 
-					&collisions_index[i], result, overlap, dt/(float)clmd->coll_parms->loop_count);
-			
-				// resolve nearby collisions
+			if (collisions[i]) {
+				CollisionModifierData *collmd = (CollisionModifierData *)modifiers_findByType(collobjs[i], eModifierType_Collision);
+
 				ret += cloth_bvh_objcollisions_resolve ( clmd, collmd, collisions[i],  collisions_index[i]);
 				ret2 += ret;
 			}
-
-			if ( overlap )
-				MEM_freeN ( overlap );
 		}
 		rounds++;
-		
-		for (i = 0; i < numcollobj; i++) {
-			if ( collisions[i] ) MEM_freeN ( collisions[i] );
-		}
-			
-		MEM_freeN(collisions);
-		MEM_freeN(collisions_index);
 
 		////////////////////////////////////////////////////////////
 		// update positions
@@ -883,6 +988,13 @@ int cloth_bvh_objcollision(Object *ob, ClothModifierData *clmd, float step, floa
 		}
 	}
 	while ( ret2 && ( clmd->coll_parms->loop_count>rounds ) );
+
+	for (i = 0; i < numcollobj; i++) {
+		if ( collisions[i] ) MEM_freeN ( collisions[i] );
+	}
+
+	MEM_freeN(collisions);
+	MEM_freeN(collisions_index);
 	
 	if (collobjs)
 		MEM_freeN(collobjs);
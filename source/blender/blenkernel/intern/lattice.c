@@ -40,6 +40,7 @@
 #include "BLI_listbase.h"
 #include "BLI_bitmap.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
@@ -343,6 +344,11 @@ typedef struct LatticeDeformData {
 	Object *object;
 	float *latticedata;
 	float latmat[4][4];
+
+	/* looked up once on init, since 'calc_latt_deform' runs for every vertex (from multiple threads) */
+	Lattice *lt;
+	MDeformVert *dvert;
+	int defgrp_index;
 } LatticeDeformData;
 
 LatticeDeformData *init_latt_deform(Object *oblatt, Object *ob)
@@ -405,110 +411,99 @@ LatticeDeformData *init_latt_deform(Object *oblatt, Object *ob)
 	lattice_deform_data->object = oblatt;
 	copy_m4_m4(lattice_deform_data->latmat, latmat);
 
+	/* vgroup influence */
+	lattice_deform_data->lt = lt;
+	lattice_deform_data->dvert = lt->dvert;
+	lattice_deform_data->defgrp_index = -1;
+	if (lt->vgroup[0] && lt->dvert) {
+		lattice_deform_data->defgrp_index = defgroup_name_index(oblatt, lt->vgroup);
+	}
+
 	return lattice_deform_data;
 }
 
-void calc_latt_deform(LatticeDeformData *lattice_deform_data, float co[3], float weight)
+/**
+ * Calculate the 4 basis weights along one lattice axis,
+ * as well as the (clamped) index of the lattice point each weight applies to.
+ */
+BLI_INLINE void latt_deform_axis_weights(
+        const float co, const float ofs, const float delta, const int pnts, const short type,
+        float r_weights[4], int r_index[4])
 {
-	Object *ob = lattice_deform_data->object;
-	Lattice *lt = ob->data;
-	float u, v, w, tu[4], tv[4], tw[4];
-	float vec[3];
-	int idx_w, idx_v, idx_u;
-	int ui, vi, wi, uu, vv, ww;
+	int i, co_index;
 
-	/* vgroup influence */
-	int defgrp_index = -1;
-	float co_prev[3], weight_blend = 0.0f;
-	MDeformVert *dvert = BKE_lattice_deform_verts_get(ob);
-
-
-	if (lt->editlatt) lt = lt->editlatt->latt;
-	if (lattice_deform_data->latticedata == NULL) return;
+	if (pnts > 1) {
+		float fac = (co - ofs) / delta;
+		co_index = (int)floorf(fac);
+		fac -= (float)co_index;
+		key_curve_position_weights(fac, r_weights, type);
+	}
+	else {
+		r_weights[0] = r_weights[2] = r_weights[3] = 0.0f; r_weights[1] = 1.0f;
+		co_index = 0;
+	}
 
-	if (lt->vgroup[0] && dvert) {
-		defgrp_index = defgroup_name_index(ob, lt->vgroup);
-		copy_v3_v3(co_prev, co);
+	for (i = 0; i < 4; i++) {
+		const int index = co_index + i - 1;
+		r_index[i] = (index > 0) ? min_ii(index, pnts - 1) : 0;
 	}
+}
+
+void calc_latt_deform(LatticeDeformData *lattice_deform_data, float co[3], float weight)
+{
+	const Lattice *lt = lattice_deform_data->lt;
+	const float *latticedata = lattice_deform_data->latticedata;
+	const int defgrp_index = lattice_deform_data->defgrp_index;
+	const MDeformVert *dvert = lattice_deform_data->dvert;
+	float tu[4], tv[4], tw[4];
+	int iu[4], iv[4], iw[4];
+	float vec[3], co_delta[3] = {0.0f, 0.0f, 0.0f};
+	float weight_blend = 0.0f;
+	int uu, vv, ww;
+
+	if (latticedata == NULL) return;
 
 	/* co is in local coords, treat with latmat */
 	mul_v3_m4v3(vec, lattice_deform_data->latmat, co);
 
 	/* u v w coords */
+	latt_deform_axis_weights(vec[0], lt->fu, lt->du, lt->pntsu, lt->typeu, tu, iu);
+	latt_deform_axis_weights(vec[1], lt->fv, lt->dv, lt->pntsv, lt->typev, tv, iv);
+	latt_deform_axis_weights(vec[2], lt->fw, lt->dw, lt->pntsw, lt->typew, tw, iw);
 
-	if (lt->pntsu > 1) {
-		u = (vec[0] - lt->fu) / lt->du;
-		ui = (int)floor(u);
-		u -= ui;
-		key_curve_position_weights(u, tu, lt->typeu);
-	}
-	else {
-		tu[0] = tu[2] = tu[3] = 0.0; tu[1] = 1.0;
-		ui = 0;
-	}
-
-	if (lt->pntsv > 1) {
-		v = (vec[1] - lt->fv) / lt->dv;
-		vi = (int)floor(v);
-		v -= vi;
-		key_curve_position_weights(v, tv, lt->typev);
-	}
-	else {
-		tv[0] = tv[2] = tv[3] = 0.0; tv[1] = 1.0;
-		vi = 0;
-	}
-
-	if (lt->pntsw > 1) {
-		w = (vec[2] - lt->fw) / lt->dw;
-		wi = (int)floor(w);
-		w -= wi;
-		key_curve_position_weights(w, tw, lt->typew);
-	}
-	else {
-		tw[0] = tw[2] = tw[3] = 0.0; tw[1] = 1.0;
-		wi = 0;
+	for (uu = 0; uu < 4; uu++) {
+		tu[uu] *= weight;
 	}
 
-	for (ww = wi - 1; ww <= wi + 2; ww++) {
-		w = tw[ww - wi + 1];
+	/* The inner (u) loop has a fixed length of 4 and no branches,
+	 * zero weights (linear interpolation, lattice borders) simply add nothing,
+	 * this lets the compiler unroll & vectorize the 4x4x4 point evaluation. */
+	for (ww = 0; ww < 4; ww++) {
+		const float w = tw[ww];
 
 		if (w != 0.0f) {
-			if (ww > 0) {
-				if (ww < lt->pntsw) idx_w = ww * lt->pntsu * lt->pntsv;
-				else                idx_w = (lt->pntsw - 1) * lt->pntsu * lt->pntsv;
-			}
-			else {
-				idx_w = 0;
-			}
+			const int idx_w = iw[ww] * lt->pntsu * lt->pntsv;
 
-			for (vv = vi - 1; vv <= vi + 2; vv++) {
-				v = w * tv[vv - vi + 1];
+			for (vv = 0; vv < 4; vv++) {
+				const float v = w * tv[vv];
 
 				if (v != 0.0f) {
-					if (vv > 0) {
-						if (vv < lt->pntsv) idx_v = idx_w + vv * lt->pntsu;
-						else                idx_v = idx_w + (lt->pntsv - 1) * lt->pntsu;
-					}
-					else {
-						idx_v = idx_w;
+					const int idx_v = idx_w + iv[vv] * lt->pntsu;
+
+					for (uu = 0; uu < 4; uu++) {
+						const float *fp = &latticedata[(idx_v + iu[uu]) * 3];
+						const float u = v * tu[uu];
+						co_delta[0] += fp[0] * u;
+						co_delta[1] += fp[1] * u;
+						co_delta[2] += fp[2] * u;
 					}
 
-					for (uu = ui - 1; uu <= ui + 2; uu++) {
-						u = weight * v * tu[uu - ui + 1];
-
-						if (u != 0.0f) {
-							if (uu > 0) {
-								if (uu < lt->pntsu) idx_u = idx_v + uu;
-								else                idx_u = idx_v + (lt->pntsu - 1);
+					if (defgrp_index != -1) {
+						for (uu = 0; uu < 4; uu++) {
+							const float u = v * tu[uu];
+							if (u != 0.0f) {
+								weight_blend += (u * defvert_find_weight(&dvert[idx_v + iu[uu]], defgrp_index));
 							}
-							else {
-								idx_u = idx_v;
-							}
-
-							madd_v3_v3fl(co, &lattice_deform_data->latticedata[idx_u * 3], u);
-
-							if (defgrp_index != -1)
-								weight_blend += (u * defvert_find_weight(dvert + idx_u, defgrp_index));
 						}
 					}
 				}
@@ -516,9 +511,12 @@ void calc_latt_deform(LatticeDeformData *lattice_deform_data, float co[3], float
 		}
 	}
 
-	if (defgrp_index != -1)
-		interp_v3_v3v3(co, co_prev, co, weight_blend);
-
+	if (defgrp_index != -1) {
+		madd_v3_v3fl(co, co_delta, weight_blend);
+	}
+	else {
+		add_v3_v3(co, co_delta);
+	}
 }
 
 void end_latt_deform(LatticeDeformData *lattice_deform_data)
@@ -705,6 +703,46 @@ static bool calc_curve_deform(Scene *scene, Object *par, float co[3],
 	return false;
 }
 
+typedef struct CurveDeformUserdata {
+	Scene *scene;
+	Object *cuOb;
+	CurveDeform *cd;
+	float (*vertexCos)[3];
+	const MDeformVert *dvert;
+	int defgrp_index;
+	short defaxis;
+	bool use_curvespace;
+} CurveDeformUserdata;
+
+static void curve_deform_vert_task(void *userdata, const int index)
+{
+	const CurveDeformUserdata *data = userdata;
+	float *co = data->vertexCos[index];
+
+	if (data->dvert != NULL) {
+		const float weight = defvert_find_weight(&data->dvert[index], data->defgrp_index);
+
+		if (weight > 0.0f) {
+			float vec[3];
+
+			if (data->use_curvespace) {
+				mul_m4_v3(data->cd->curvespace, co);
+			}
+			copy_v3_v3(vec, co);
+			calc_curve_deform(data->scene, data->cuOb, vec, data->defaxis, data->cd, NULL);
+			interp_v3_v3v3(co, co, vec, weight);
+			mul_m4_v3(data->cd->objectspace, co);
+		}
+	}
+	else {
+		if (data->use_curvespace) {
+			mul_m4_v3(data->cd->curvespace, co);
+		}
+		calc_curve_deform(data->scene, data->cuOb, co, data->defaxis, data->cd, NULL);
+		mul_m4_v3(data->cd->objectspace, co);
+	}
+}
+
 void curve_deform_verts(
         Scene *scene, Object *cuOb, Object *target, DerivedMesh *dm, float (*vertexCos)[3],
         int numVerts, const char *vgroup, short defaxis)
@@ -754,71 +792,49 @@ void curve_deform_verts(
 		}
 	}
 
-	if (dvert) {
-		MDeformVert *dvert_iter;
-		float vec[3];
-
-		if (cu->flag & CU_DEFORM_BOUNDS_OFF) {
-			for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-				const float weight = defvert_find_weight(dvert_iter, defgrp_index);
+#ifdef CYCLIC_DEPENDENCY_WORKAROUND
+	/* ensure the path exists before evaluating from threads (see 'calc_curve_deform') */
+	if (cuOb->curve_cache == NULL) {
+		BKE_displist_make_curveTypes(scene, cuOb, false);
+	}
+#endif
 
-				if (weight > 0.0f) {
-					mul_m4_v3(cd.curvespace, vertexCos[a]);
-					copy_v3_v3(vec, vertexCos[a]);
-					calc_curve_deform(scene, cuOb, vec, defaxis, &cd, NULL);
-					interp_v3_v3v3(vertexCos[a], vertexCos[a], vec, weight);
-					mul_m4_v3(cd.objectspace, vertexCos[a]);
-				}
-			}
-		}
-		else {
-			/* set mesh min/max bounds */
-			INIT_MINMAX(cd.dmin, cd.dmax);
+	if (!(cu->flag & CU_DEFORM_BOUNDS_OFF)) {
+		/* set mesh min/max bounds */
+		INIT_MINMAX(cd.dmin, cd.dmax);
 
+		if (dvert) {
+			MDeformVert *dvert_iter;
 			for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
 				if (defvert_find_weight(dvert_iter, defgrp_index) > 0.0f) {
 					mul_m4_v3(cd.curvespace, vertexCos[a]);
 					minmax_v3v3_v3(cd.dmin, cd.dmax, vertexCos[a]);
 				}
 			}
-
-			for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-				const float weight = defvert_find_weight(dvert_iter, defgrp_index);
-
-				if (weight > 0.0f) {
-					/* already in 'cd.curvespace', prev for loop */
-					copy_v3_v3(vec, vertexCos[a]);
-					calc_curve_deform(scene, cuOb, vec, defaxis, &cd, NULL);
-					interp_v3_v3v3(vertexCos[a], vertexCos[a], vec, weight);
-					mul_m4_v3(cd.objectspace, vertexCos[a]);
-				}
-			}
-		}
-	}
-	else {
-		if (cu->flag & CU_DEFORM_BOUNDS_OFF) {
-			for (a = 0; a < numVerts; a++) {
-				mul_m4_v3(cd.curvespace, vertexCos[a]);
-				calc_curve_deform(scene, cuOb, vertexCos[a], defaxis, &cd, NULL);
-				mul_m4_v3(cd.objectspace, vertexCos[a]);
-			}
 		}
 		else {
-			/* set mesh min max bounds */
-			INIT_MINMAX(cd.dmin, cd.dmax);
-				
 			for (a = 0; a < numVerts; a++) {
 				mul_m4_v3(cd.curvespace, vertexCos[a]);
 				minmax_v3v3_v3(cd.dmin, cd.dmax, vertexCos[a]);
 			}
-	
-			for (a = 0; a < numVerts; a++) {
-				/* already in 'cd.curvespace', prev for loop */
-				calc_curve_deform(scene, cuOb, vertexCos[a], defaxis, &cd, NULL);
-				mul_m4_v3(cd.objectspace, vertexCos[a]);
-			}
 		}
 	}
+
+	{
+		CurveDeformUserdata data = {
+		    .scene = scene,
+		    .cuOb = cuOb,
+		    .cd = &cd,
+		    .vertexCos = vertexCos,
+		    .dvert = dvert,
+		    .defgrp_index = defgrp_index,
+		    .defaxis = defaxis,
+		    /* otherwise the bounds calculation already moved them into 'cd.curvespace' */
+		    .use_curvespace = (cu->flag & CU_DEFORM_BOUNDS_OFF) != 0,
+		};
+
+		BLI_task_parallel_range(0, numVerts, &data, curve_deform_vert_task, numVerts > 1000);
+	}
 }
 
 /* input vec and orco = local coord in armature space */
@@ -856,12 +872,35 @@ void curve_deform_vector(Scene *scene, Object *cuOb, Object *target,
 
 }
 
+typedef struct LatticeDeformUserdata {
+	LatticeDeformData *lattice_deform_data;
+	float (*vertexCos)[3];
+	const MDeformVert *dvert;
+	int defgrp_index;
+	float fac;
+} LatticeDeformUserdata;
+
+static void lattice_deform_vert_task(void *userdata, const int index)
+{
+	const LatticeDeformUserdata *data = userdata;
+
+	if (data->dvert != NULL) {
+		const float weight = defvert_find_weight(&data->dvert[index], data->defgrp_index);
+		if (weight > 0.0f) {
+			calc_latt_deform(data->lattice_deform_data, data->vertexCos[index], weight * data->fac);
+		}
+	}
+	else {
+		calc_latt_deform(data->lattice_deform_data, data->vertexCos[index], data->fac);
+	}
+}
+
 void lattice_deform_verts(Object *laOb, Object *target, DerivedMesh *dm,
                           float (*vertexCos)[3], int numVerts, const char *vgroup, float fac)
 {
 	LatticeDeformData *lattice_deform_data;
-	int a;
-	bool use_vgroups;
+	MDeformVert *dvert = NULL;
+	int defgrp_index = -1;
 
 	if (laOb->type != OB_LATTICE)
 		return;
@@ -872,43 +911,32 @@ void lattice_deform_verts(Object *laOb, Object *target, DerivedMesh *dm,
 	 * we want either a Mesh with no derived data, or derived data with
 	 * deformverts
 	 */
-	if (target && target->type == OB_MESH) {
+	if (vgroup && vgroup[0] && target && target->type == OB_MESH) {
 		/* if there's derived data without deformverts, don't use vgroups */
 		if (dm) {
-			use_vgroups = (dm->getVertDataArray(dm, CD_MDEFORMVERT) != NULL);
+			dvert = dm->getVertDataArray(dm, CD_MDEFORMVERT);
 		}
 		else {
-			Mesh *me = target->data;
-			use_vgroups = (me->dvert != NULL);
+			dvert = ((Mesh *)target->data)->dvert;
 		}
-	}
-	else {
-		use_vgroups = false;
-	}
-	
-	if (vgroup && vgroup[0] && use_vgroups) {
-		Mesh *me = target->data;
-		const int defgrp_index = defgroup_name_index(target, vgroup);
-		float weight;
-
-		if (defgrp_index >= 0 && (me->dvert || dm)) {
-			MDeformVert *dvert = me->dvert;
-			
-			for (a = 0; a < numVerts; a++, dvert++) {
-				if (dm) dvert = dm->getVertData(dm, a, CD_MDEFORMVERT);
 
-				weight = defvert_find_weight(dvert, defgrp_index);
-
-				if (weight > 0.0f)
-					calc_latt_deform(lattice_deform_data, vertexCos[a], weight * fac);
-			}
+		if (dvert) {
+			defgrp_index = defgroup_name_index(target, vgroup);
 		}
 	}
-	else {
-		for (a = 0; a < numVerts; a++) {
-			calc_latt_deform(lattice_deform_data, vertexCos[a], fac);
-		}
+
+	if (dvert == NULL || defgrp_index != -1) {
+		LatticeDeformUserdata data = {
+		    .lattice_deform_data = lattice_deform_data,
+		    .vertexCos = vertexCos,
+		    .dvert = dvert,
+		    .defgrp_index = defgrp_index,
+		    .fac = fac,
+		};
+
+		BLI_task_parallel_range(0, numVerts, &data, lattice_deform_vert_task, numVerts > 1000);
 	}
+
 	end_latt_deform(lattice_deform_data);
 }
 
@@ -142,6 +142,7 @@ void modifier_free(ModifierData *md)
 
 	if (mti->freeData) mti->freeData(md);
 	if (md->error) MEM_freeN(md->error);
+	modifier_cache_free(md);
 
 	MEM_freeN(md);
 }
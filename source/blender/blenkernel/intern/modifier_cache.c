@@ -0,0 +1,614 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenkernel/intern/modifier_cache.c
+ *  \ingroup bke
+ *
+ * Cache of intermediate modifier stack results.
+ *
+ * Once evaluating modifiers has taken long enough, the result is stored along with a key,
+ * calculated from the input mesh, the settings of all modifiers up to (and including) the last one
+ * and the objects they use. When the stack is evaluated again, evaluation resumes after the last modifier
+ * with a cached result matching its key, so only the modifiers after the first changed one run again.
+ *
+ * Cached results of all objects share a memory limit (#UserDef.modcachelimit),
+ * the least recently used results are freed first.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_color_types.h"
+#include "DNA_defs.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_userdef_types.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_listbase.h"
+#include "BLI_threads.h"
+
+#include "BKE_cdderivedmesh.h"
+#include "BKE_customdata.h"
+#include "BKE_DerivedMesh.h"
+#include "BKE_modifier.h"
+
+/* Only cache results which took at least this long (in seconds) to calculate,
+ * since storing and restoring a result isn't free either. */
+#define MODIFIER_CACHE_TIME_MIN 0.005
+
+/* When stored results of a modifier keep being replaced without being used (the input changes on
+ * every evaluation, e.g. playback of a deforming mesh), only store every 2^n-th result, up to this n. */
+#define MODIFIER_CACHE_SKIP_LEVEL_MAX 4
+
+typedef struct ModifierCacheRuntime {
+	/* links in the least-recently-used list, only while a result is cached */
+	struct ModifierCacheRuntime *next, *prev;
+	ModifierData *md;
+
+	/* the cached result, NULL when nothing is stored */
+	DerivedMesh *dm, *orcodm, *clothorcodm;
+	CustomDataMask append_mask;
+	unsigned int key;
+	size_t mem_size;
+	/* the stored result matched a key since it was stored */
+	bool is_used;
+
+	/* results not to store, after unused ones were replaced (see #MODIFIER_CACHE_SKIP_LEVEL_MAX) */
+	int skip_level, skip_count;
+
+	/* times the result of the modifier was re-used or calculated */
+	int hits, misses;
+} ModifierCacheRuntime;
+
+static struct {
+	ListBase lru;  /* most recently used first */
+	size_t mem_size;
+} modifier_cache = {{NULL}};
+
+static ThreadMutex modifier_cache_lock = BLI_MUTEX_INITIALIZER;
+
+/* -------------------------------------------------------------------- */
+/** \name Keys
+ * \{ */
+
+static void modifier_cache_key_customdata(BLI_HashMurmur2A *mm2, const CustomData *cdata, const int totelem)
+{
+	BLI_hash_mm2a_add_int(mm2, totelem);
+	for (int i = 0; i < cdata->totlayer; i++) {
+		const CustomDataLayer *layer = &cdata->layers[i];
+		BLI_hash_mm2a_add_int(mm2, layer->type);
+		BLI_hash_mm2a_add_int(mm2, layer->flag);
+		BLI_hash_mm2a_add(mm2, (const unsigned char *)layer->name, strlen(layer->name));
+
+		if (layer->data == NULL) {
+			continue;
+		}
+
+		if (layer->type == CD_MDEFORMVERT) {
+			const MDeformVert *dvert = layer->data;
+			for (int j = 0; j < totelem; j++, dvert++) {
+				BLI_hash_mm2a_add_int(mm2, dvert->totweight);
+				if (dvert->dw) {
+					BLI_hash_mm2a_add(mm2, (const unsigned char *)dvert->dw, sizeof(*dvert->dw) * (size_t)dvert->totweight);
+				}
+			}
+		}
+		else {
+			BLI_hash_mm2a_add(mm2, layer->data, (size_t)CustomData_sizeof(layer->type) * (size_t)totelem);
+		}
+	}
+}
+
+/**
+ * Key for the input of the modifier stack,
+ * \a vertexCos are the deformed coordinates when leading deform modifiers have been applied (may be NULL).
+ */
+unsigned int modifier_cache_key_mesh(
+        Object *ob, Mesh *me, const float (*vertexCos)[3], const int numVerts,
+        const CustomDataMask dataMask, const int flag)
+{
+	BLI_HashMurmur2A mm2;
+	BLI_hash_mm2a_init(&mm2, 0);
+
+	BLI_hash_mm2a_add(&mm2, (const unsigned char *)&dataMask, sizeof(dataMask));
+	BLI_hash_mm2a_add_int(&mm2, flag);
+
+	BLI_hash_mm2a_add_int(&mm2, me->flag);
+	BLI_hash_mm2a_add_int(&mm2, me->texflag);
+	BLI_hash_mm2a_add(&mm2, (const unsigned char *)&me->smoothresh, sizeof(me->smoothresh));
+	BLI_hash_mm2a_add(&mm2, (const unsigned char *)me->loc, sizeof(me->loc));
+	BLI_hash_mm2a_add(&mm2, (const unsigned char *)me->size, sizeof(me->size));
+
+	modifier_cache_key_customdata(&mm2, &me->vdata, me->totvert);
+	modifier_cache_key_customdata(&mm2, &me->edata, me->totedge);
+	modifier_cache_key_customdata(&mm2, &me->ldata, me->totloop);
+	modifier_cache_key_customdata(&mm2, &me->pdata, me->totpoly);
+
+	if (vertexCos) {
+		BLI_hash_mm2a_add(&mm2, (const unsigned char *)vertexCos, sizeof(*vertexCos) * (size_t)numVerts);
+	}
+
+	/* vertex groups are looked up by name */
+	for (const bDeformGroup *dg = ob->defbase.first; dg; dg = dg->next) {
+		BLI_hash_mm2a_add(&mm2, (const unsigned char *)dg->name, strlen(dg->name));
+	}
+
+	return BLI_hash_mm2a_end(&mm2);
+}
+
+/* Settings stored outside of the modifier struct, all other pointers are runtime data or IDs. */
+static void modifier_cache_key_curvemapping(BLI_HashMurmur2A *mm2, const CurveMapping *cumap)
+{
+	if (cumap == NULL) {
+		return;
+	}
+
+	BLI_hash_mm2a_add_int(mm2, cumap->flag);
+	BLI_hash_mm2a_add(mm2, (const unsigned char *)&cumap->clipr, sizeof(cumap->clipr));
+	BLI_hash_mm2a_add(mm2, (const unsigned char *)cumap->black, sizeof(cumap->black));
+	BLI_hash_mm2a_add(mm2, (const unsigned char *)cumap->white, sizeof(cumap->white));
+	for (int i = 0; i < CM_TOT; i++) {
+		const CurveMap *cuma = &cumap->cm[i];
+		BLI_hash_mm2a_add_int(mm2, cuma->flag);
+		BLI_hash_mm2a_add_int(mm2, cuma->totpoint);
+		if (cuma->curve) {
+			BLI_hash_mm2a_add(mm2, (const unsigned char *)cuma->curve, sizeof(*cuma->curve) * (size_t)cuma->totpoint);
+		}
+	}
+}
+
+typedef struct ModifierCacheKeyData {
+	BLI_HashMurmur2A *mm2;  /* NULL when only checking the used IDs are supported */
+	bool is_supported;
+	bool has_objects;
+} ModifierCacheKeyData;
+
+static bool modifier_cache_id_is_supported(ID *id)
+{
+	/* textures, images etc. may change without us knowing */
+	if (GS(id->name) != ID_OB) {
+		return false;
+	}
+
+	Object *ob = (Object *)id;
+	if (ob->type == OB_EMPTY) {
+		/* only the transform is used */
+		return true;
+	}
+	else if ((ob->type == OB_MESH) && (((Mesh *)ob->data)->edit_btmesh == NULL)) {
+		return (ob->derivedFinal == NULL) || (ob->derivedFinal->type == DM_TYPE_CDDM);
+	}
+	else {
+		/* the data of other object types (lattice points, curves, poses...) isn't tracked */
+		return false;
+	}
+}
+
+static void modifier_cache_key_id_cb(void *userData, Object *UNUSED(ob), ID **idpoin, int UNUSED(cb_flag))
+{
+	ModifierCacheKeyData *data = userData;
+	ID *id = *idpoin;
+
+	if (id == NULL || !data->is_supported) {
+		return;
+	}
+
+	if (!modifier_cache_id_is_supported(id)) {
+		data->is_supported = false;
+		return;
+	}
+
+	if (data->mm2 == NULL) {
+		return;
+	}
+
+	Object *ob = (Object *)id;
+	data->has_objects = true;
+	BLI_hash_mm2a_add(data->mm2, (const unsigned char *)ob->obmat, sizeof(ob->obmat));
+	BLI_hash_mm2a_add_int(data->mm2, ob->totcol);
+
+	if (ob->type == OB_MESH) {
+		DerivedMesh *dm = ob->derivedFinal;
+		if (dm == NULL) {
+			Mesh *me = ob->data;
+			BLI_hash_mm2a_add(data->mm2, (const unsigned char *)me->mvert, sizeof(*me->mvert) * (size_t)me->totvert);
+			BLI_hash_mm2a_add(data->mm2, (const unsigned char *)me->medge, sizeof(*me->medge) * (size_t)me->totedge);
+			BLI_hash_mm2a_add(data->mm2, (const unsigned char *)me->mloop, sizeof(*me->mloop) * (size_t)me->totloop);
+			BLI_hash_mm2a_add(data->mm2, (const unsigned char *)me->mpoly, sizeof(*me->mpoly) * (size_t)me->totpoly);
+		}
+		else {
+			BLI_hash_mm2a_add_int(data->mm2, dm->getNumVerts(dm));
+			BLI_hash_mm2a_add_int(data->mm2, dm->getNumPolys(dm));
+			BLI_hash_mm2a_add(data->mm2, (const unsigned char *)dm->getVertArray(dm),
+			                  sizeof(MVert) * (size_t)dm->getNumVerts(dm));
+			BLI_hash_mm2a_add(data->mm2, (const unsigned char *)dm->getEdgeArray(dm),
+			                  sizeof(MEdge) * (size_t)dm->getNumEdges(dm));
+			BLI_hash_mm2a_add(data->mm2, (const unsigned char *)dm->getLoopArray(dm),
+			                  sizeof(MLoop) * (size_t)dm->getNumLoops(dm));
+			BLI_hash_mm2a_add(data->mm2, (const unsigned char *)dm->getPolyArray(dm),
+			                  sizeof(MPoly) * (size_t)dm->getNumPolys(dm));
+		}
+	}
+}
+
+static void modifier_cache_key_object_cb(void *userData, Object *ob, Object **obpoin, int cb_flag)
+{
+	modifier_cache_key_id_cb(userData, ob, (ID **)obpoin, cb_flag);
+}
+
+static bool modifier_cache_type_is_supported(const ModifierData *md)
+{
+	switch ((ModifierType)md->type) {
+		/* simulations & modifiers storing state between evaluations */
+		case eModifierType_Softbody:
+		case eModifierType_ParticleSystem:
+		case eModifierType_ParticleInstance:
+		case eModifierType_Explode:
+		case eModifierType_Cloth:
+		case eModifierType_Collision:
+		case eModifierType_Fluidsim:
+		case eModifierType_Surface:
+		case eModifierType_Smoke:
+		case eModifierType_DynamicPaint:
+		case eModifierType_Ocean:
+		/* data from files */
+		case eModifierType_MeshCache:
+		case eModifierType_MeshSequenceCache:
+		/* sculpt data */
+		case eModifierType_Multires:
+		/* bind data & settings stored outside of the modifier,
+		 * (see modifier_cache_key_curvemapping for settings which are part of the key) */
+		case eModifierType_Hook:
+		case eModifierType_Warp:
+		case eModifierType_MeshDeform:
+		case eModifierType_SurfaceDeform:
+		case eModifierType_LaplacianDeform:
+		case eModifierType_CorrectiveSmooth:
+			return false;
+		default:
+			return true;
+	}
+}
+
+static void modifier_cache_foreach_id(Object *ob, ModifierData *md, ModifierCacheKeyData *data)
+{
+	const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+
+	if (mti->foreachIDLink) {
+		mti->foreachIDLink(md, ob, modifier_cache_key_id_cb, data);
+	}
+	else if (mti->foreachObjectLink) {
+		mti->foreachObjectLink(md, ob, modifier_cache_key_object_cb, data);
+	}
+}
+
+/**
+ * \return false when the result of \a md can't be cached,
+ * used to skip calculating keys when the stack can't use the cache at all.
+ */
+bool modifier_cache_is_supported(Object *ob, ModifierData *md)
+{
+	const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+
+	if ((md->mode & eModifierMode_Virtual) ||
+	    !modifier_cache_type_is_supported(md) ||
+	    (mti->dependsOnTime && mti->dependsOnTime(md)))
+	{
+		return false;
+	}
+
+	ModifierCacheKeyData data = {NULL, true, false};
+	modifier_cache_foreach_id(ob, md, &data);
+
+	return data.is_supported;
+}
+
+/**
+ * Add \a md to the key of the modifiers before it.
+ *
+ * \param mask: The data mask the modifier is evaluated with.
+ * \return false when the result of this modifier can't be cached,
+ * in this case none of the following modifiers can be cached either.
+ */
+bool modifier_cache_key_modifier(Object *ob, ModifierData *md, const CustomDataMask mask, unsigned int *r_key)
+{
+	const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+
+	if ((md->mode & eModifierMode_Virtual) ||
+	    !modifier_cache_type_is_supported(md) ||
+	    (mti->dependsOnTime && mti->dependsOnTime(md)))
+	{
+		return false;
+	}
+
+	BLI_HashMurmur2A mm2;
+	BLI_hash_mm2a_init(&mm2, *r_key);
+
+	BLI_hash_mm2a_add_int(&mm2, md->type);
+	BLI_hash_mm2a_add_int(&mm2, (int)(md->mode & (eModifierMode_Realtime | eModifierMode_Render |
+	                                              eModifierMode_DisableTemporary)));
+	BLI_hash_mm2a_add(&mm2, (const unsigned char *)&mask, sizeof(mask));
+
+	/* settings, skip runtime data at the end of the modifier */
+	size_t settings_size = (size_t)mti->structSize - sizeof(ModifierData);
+	if (md->type == eModifierType_Subsurf) {
+		settings_size = offsetof(SubsurfModifierData, emCache) - sizeof(ModifierData);
+	}
+	else if (md->type == eModifierType_LaplacianSmooth) {
+		settings_size = offsetof(LaplacianSmoothModifierData, cache) - sizeof(ModifierData);
+	}
+	BLI_hash_mm2a_add(&mm2, ((const unsigned char *)md) + sizeof(ModifierData), settings_size);
+
+	if (md->type == eModifierType_WeightVGEdit) {
+		modifier_cache_key_curvemapping(&mm2, ((WeightVGEditModifierData *)md)->cmap_curve);
+	}
+
+	ModifierCacheKeyData data = {&mm2, true, false};
+	modifier_cache_foreach_id(ob, md, &data);
+
+	if (!data.is_supported) {
+		return false;
+	}
+
+	if (data.has_objects) {
+		/* results are often relative to the other objects */
+		BLI_hash_mm2a_add(&mm2, (const unsigned char *)ob->obmat, sizeof(ob->obmat));
+	}
+
+	*r_key = BLI_hash_mm2a_end(&mm2);
+	return true;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Storage
+ * \{ */
+
+static size_t modifier_cache_dm_mem_size(DerivedMesh *dm)
+{
+	size_t mem_size = 0;
+	const struct { const CustomData *cdata; int totelem; } cdata_arr[] = {
+		{&dm->vertData, dm->numVertData},
+		{&dm->edgeData, dm->numEdgeData},
+		{&dm->loopData, dm->numLoopData},
+		{&dm->polyData, dm->numPolyData},
+	};
+
+	for (int i = 0; i < ARRAY_SIZE(cdata_arr); i++) {
+		const CustomData *cdata = cdata_arr[i].cdata;
+		for (int j = 0; j < cdata->totlayer; j++) {
+			mem_size += (size_t)CustomData_sizeof(cdata->layers[j].type) * (size_t)cdata_arr[i].totelem;
+		}
+	}
+	/* mvert, medge... arrays of derived meshes which don't store them as layers */
+	if (dm->type != DM_TYPE_CDDM) {
+		mem_size += sizeof(MVert) * (size_t)dm->getNumVerts(dm);
+		mem_size += sizeof(MEdge) * (size_t)dm->getNumEdges(dm);
+		mem_size += sizeof(MLoop) * (size_t)dm->getNumLoops(dm);
+		mem_size += sizeof(MPoly) * (size_t)dm->getNumPolys(dm);
+	}
+	return mem_size;
+}
+
+static ModifierCacheRuntime *modifier_cache_runtime_ensure(ModifierData *md)
+{
+	ModifierCacheRuntime *runtime = md->runtime;
+	if (runtime == NULL) {
+		runtime = MEM_callocN(sizeof(*runtime), __func__);
+		runtime->md = md;
+		md->runtime = runtime;
+	}
+	return runtime;
+}
+
+static void modifier_cache_runtime_clear(ModifierCacheRuntime *runtime)
+{
+	if (runtime->dm == NULL) {
+		return;
+	}
+
+	BLI_remlink(&modifier_cache.lru, runtime);
+	modifier_cache.mem_size -= runtime->mem_size;
+
+	runtime->dm->release(runtime->dm);
+	if (runtime->orcodm) {
+		runtime->orcodm->release(runtime->orcodm);
+	}
+	if (runtime->clothorcodm) {
+		runtime->clothorcodm->release(runtime->clothorcodm);
+	}
+	runtime->dm = runtime->orcodm = runtime->clothorcodm = NULL;
+	runtime->mem_size = 0;
+}
+
+bool modifier_cache_is_enabled(void)
+{
+	return (U.modcachelimit > 0);
+}
+
+/**
+ * Store the result of the modifier stack up to (and including) \a md.
+ *
+ * \param eval_time: Time spent evaluating the modifiers since the last cached result,
+ * results which are fast to calculate aren't stored.
+ * \return true when the result was stored.
+ */
+bool modifier_cache_store(
+        ModifierData *md, const unsigned int key, const double eval_time,
+        DerivedMesh *dm, DerivedMesh *orcodm, DerivedMesh *clothorcodm, const CustomDataMask append_mask)
+{
+	const size_t mem_limit = (size_t)U.modcachelimit * 1024 * 1024;
+
+	if (eval_time < MODIFIER_CACHE_TIME_MIN) {
+		return false;
+	}
+
+	size_t mem_size = modifier_cache_dm_mem_size(dm);
+	if (orcodm) {
+		mem_size += modifier_cache_dm_mem_size(orcodm);
+	}
+	if (clothorcodm) {
+		mem_size += modifier_cache_dm_mem_size(clothorcodm);
+	}
+	if (mem_size > mem_limit) {
+		return false;
+	}
+
+	BLI_mutex_lock(&modifier_cache_lock);
+	ModifierCacheRuntime *runtime = modifier_cache_runtime_ensure(md);
+	if (runtime->dm && !runtime->is_used) {
+		if (runtime->skip_count > 0) {
+			runtime->skip_count--;
+			BLI_mutex_unlock(&modifier_cache_lock);
+			return false;
+		}
+		runtime->skip_level = MIN2(runtime->skip_level + 1, MODIFIER_CACHE_SKIP_LEVEL_MAX);
+		runtime->skip_count = (1 << runtime->skip_level) - 1;
+	}
+	BLI_mutex_unlock(&modifier_cache_lock);
+
+	/* copy outside the lock, the input is only used by this thread */
+	DerivedMesh *dm_copy = CDDM_copy(dm);
+	DerivedMesh *orcodm_copy = orcodm ? CDDM_copy(orcodm) : NULL;
+	DerivedMesh *clothorcodm_copy = clothorcodm ? CDDM_copy(clothorcodm) : NULL;
+
+	BLI_mutex_lock(&modifier_cache_lock);
+
+	modifier_cache_runtime_clear(runtime);
+
+	runtime->dm = dm_copy;
+	runtime->orcodm = orcodm_copy;
+	runtime->clothorcodm = clothorcodm_copy;
+	runtime->append_mask = append_mask;
+	runtime->key = key;
+	runtime->mem_size = mem_size;
+	runtime->is_used = false;
+
+	BLI_addhead(&modifier_cache.lru, runtime);
+	modifier_cache.mem_size += mem_size;
+
+	/* free the least recently used results */
+	while (modifier_cache.mem_size > mem_limit) {
+		ModifierCacheRuntime *runtime_last = modifier_cache.lru.last;
+		BLI_assert(runtime_last != runtime);
+		modifier_cache_runtime_clear(runtime_last);
+	}
+
+	BLI_mutex_unlock(&modifier_cache_lock);
+
+	return true;
+}
+
+/**
+ * \return true when \a md has a cached result matching \a key.
+ */
+bool modifier_cache_has(ModifierData *md, const unsigned int key)
+{
+	bool found;
+
+	BLI_mutex_lock(&modifier_cache_lock);
+	ModifierCacheRuntime *runtime = md->runtime;
+	found = (runtime && runtime->dm && (runtime->key == key));
+	if (found) {
+		runtime->is_used = true;
+		runtime->skip_level = runtime->skip_count = 0;
+	}
+	BLI_mutex_unlock(&modifier_cache_lock);
+
+	return found;
+}
+
+/**
+ * Get a copy of the cached result of \a md (when it matches \a key).
+ */
+bool modifier_cache_lookup(
+        ModifierData *md, const unsigned int key,
+        DerivedMesh **r_dm, DerivedMesh **r_orcodm, DerivedMesh **r_clothorcodm, CustomDataMask *r_append_mask)
+{
+	bool found = false;
+
+	BLI_mutex_lock(&modifier_cache_lock);
+
+	ModifierCacheRuntime *runtime = md->runtime;
+	if (runtime && runtime->dm && (runtime->key == key)) {
+		*r_dm = CDDM_copy(runtime->dm);
+		*r_orcodm = runtime->orcodm ? CDDM_copy(runtime->orcodm) : NULL;
+		*r_clothorcodm = runtime->clothorcodm ? CDDM_copy(runtime->clothorcodm) : NULL;
+		*r_append_mask = runtime->append_mask;
+
+		BLI_remlink(&modifier_cache.lru, runtime);
+		BLI_addhead(&modifier_cache.lru, runtime);
+		found = true;
+	}
+
+	BLI_mutex_unlock(&modifier_cache_lock);
+
+	return found;
+}
+
+/**
+ * Count an evaluation of the stack for the statistics of \a md.
+ *
+ * \param is_hit: The result of the modifier was re-used.
+ */
+void modifier_cache_tag(ModifierData *md, const bool is_hit)
+{
+	BLI_mutex_lock(&modifier_cache_lock);
+	ModifierCacheRuntime *runtime = modifier_cache_runtime_ensure(md);
+	if (is_hit) {
+		runtime->hits++;
+	}
+	else {
+		runtime->misses++;
+	}
+	BLI_mutex_unlock(&modifier_cache_lock);
+}
+
+void modifier_cache_stats_get(ModifierData *md, int *r_hits, int *r_misses)
+{
+	BLI_mutex_lock(&modifier_cache_lock);
+	const ModifierCacheRuntime *runtime = md->runtime;
+	*r_hits = runtime ? runtime->hits : 0;
+	*r_misses = runtime ? runtime->misses : 0;
+	BLI_mutex_unlock(&modifier_cache_lock);
+}
+
+void modifier_cache_free(ModifierData *md)
+{
+	if (md->runtime == NULL) {
+		return;
+	}
+
+	BLI_mutex_lock(&modifier_cache_lock);
+	ModifierCacheRuntime *runtime = md->runtime;
+	modifier_cache_runtime_clear(runtime);
+	MEM_freeN(runtime);
+	md->runtime = NULL;
+	BLI_mutex_unlock(&modifier_cache_lock);
+}
+
+/** \} */
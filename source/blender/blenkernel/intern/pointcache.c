@@ -47,6 +47,8 @@
 #include "DNA_smoke_types.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_math.h"
 #include "BLI_utildefines.h"
@@ -57,6 +59,7 @@
 
 #include "BKE_appdir.h"
 #include "BKE_anim.h"
+#include "BKE_cache_prefetch.h"
 #include "BKE_cloth.h"
 #include "BKE_dynamicpaint.h"
 #include "BKE_global.h"
@@ -107,6 +110,16 @@
 #  include "BLI_winstuff.h"
 #endif
 
+/* memory mapped reading of packed caches */
+#include <fcntl.h>
+#ifdef WIN32
+#  include <io.h>
+#  include "mmap_win.h"
+#else
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
 #define PTCACHE_DATA_FROM(data, type, from)  \
 	if (data[type]) { \
 		memcpy(data[type], from, ptcache_data_size[type]); \
@@ -141,6 +154,7 @@ static int ptcache_file_compressed_read(PTCacheFile *pf, unsigned char *result,
 static int ptcache_file_compressed_write(PTCacheFile *pf, unsigned char *in, unsigned int in_len, unsigned char *out, int mode);
 static int ptcache_file_write(PTCacheFile *pf, const void *f, unsigned int tot, unsigned int size);
 static int ptcache_file_read(PTCacheFile *pf, void *f, unsigned int tot, unsigned int size);
+static void ptcache_file_seek(PTCacheFile *pf, long offset, int origin);
 
 /* Common functions */
 static int ptcache_basic_header_read(PTCacheFile *pf)
@@ -148,10 +162,10 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
 	int error=0;
 
 	/* Custom functions should read these basic elements too! */
-	if (!error && !fread(&pf->totpoint, sizeof(unsigned int), 1, pf->fp))
+	if (!error && !ptcache_file_read(pf, &pf->totpoint, 1, sizeof(unsigned int)))
 		error = 1;
 	
-	if (!error && !fread(&pf->data_types, sizeof(unsigned int), 1, pf->fp))
+	if (!error && !ptcache_file_read(pf, &pf->data_types, 1, sizeof(unsigned int)))
 		error = 1;
 
 	return !error;
@@ -159,10 +173,10 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
 static int ptcache_basic_header_write(PTCacheFile *pf)
 {
 	/* Custom functions should write these basic elements too! */
-	if (!fwrite(&pf->totpoint, sizeof(unsigned int), 1, pf->fp))
+	if (!ptcache_file_write(pf, &pf->totpoint, 1, sizeof(unsigned int)))
 		return 0;
 	
-	if (!fwrite(&pf->data_types, sizeof(unsigned int), 1, pf->fp))
+	if (!ptcache_file_write(pf, &pf->data_types, 1, sizeof(unsigned int)))
 		return 0;
 
 	return 1;
@@ -777,7 +791,7 @@ static int ptcache_smoke_read(PTCacheFile *pf, void *smoke_v)
 	if (!STREQLEN(version, SMOKE_CACHE_VERSION, 4))
 	{
 		/* reset file pointer */
-		fseek(pf->fp, -4, SEEK_CUR);
+		ptcache_file_seek(pf, -4, SEEK_CUR);
 		return ptcache_smoke_read_old(pf, smoke_v);
 	}
 
@@ -1866,6 +1880,751 @@ static int ptcache_filename(PTCacheID *pid, char *filename, int cfra, short do_p
 	return len; /* make sure the above string is always 16 chars */
 }
 
+/* -------------------------------------------------------------------- */
+/* Packed disk cache
+ *
+ * With PTCACHE_DISK_PACKED all frames of a cache are stored in a single file,
+ * reading a frame doesn't need to open a file (or search the directory for it),
+ * the file is memory mapped and frames are found using an index.
+ *
+ * The file starts with a PTCachePackedHeader, followed by a PTCachePackedRecord for every frame,
+ * each one followed by the same data a file of the per-frame layout contains.
+ * Records are only appended, rewriting or clearing a frame marks its old record as removed,
+ * the frame index is built from the record headers when the file is opened.
+ *
+ * Compression of larger data is done in a task pool. While baking, frames are added to the file
+ * in batches so the simulation of the next frames doesn't wait for the compression.
+ */
+
+#define PTCACHE_PACKED_ID "BPHYSPAK"
+#define PTCACHE_PACKED_VERSION 1
+
+/* PTCachePackedRecord.flag */
+#define PTCACHE_PACKED_RECORD_REMOVED 1
+
+/* compressing smaller data isn't worth a task */
+#define PTCACHE_PACKED_CHUNK_TASK_MIN (16 * 1024)
+/* limit the memory used by frames waiting to be written while baking */
+#define PTCACHE_PACKED_PENDING_MEM_MAX (256 * 1024 * 1024)
+
+typedef struct PTCachePackedHeader {
+	char id[8];
+	unsigned int version, pad;
+	/* end of the last record, anything after it is left from removed frames or an interrupted write */
+	uint64_t data_len;
+} PTCachePackedHeader;
+
+typedef struct PTCachePackedRecord {
+	int frame;
+	unsigned int flag;
+	uint64_t data_len;
+} PTCachePackedRecord;
+
+/* frame index entry */
+typedef struct PTCachePackedFrame {
+	size_t offset;  /* of the record */
+	size_t data_len;
+} PTCachePackedFrame;
+
+/* compressed write of a frame, done in a task */
+typedef struct PTCachePackedChunk {
+	struct PTCachePackedChunk *next, *prev;
+	size_t mem_pos;  /* position in the frame data the chunk is written at */
+	unsigned char *in, *out;
+	unsigned int in_len;
+	size_t out_len;
+	int mode;
+	unsigned char compressed;
+	unsigned char props[16];
+	size_t props_len;
+} PTCachePackedChunk;
+
+typedef struct PTCachePacked {
+	char filepath[MAX_PTCACHE_FILE];
+	/* only kept open while writing */
+	FILE *fp;
+	size_t data_len;
+	/* frame number -> PTCachePackedFrame */
+	GHash *frames;
+
+	unsigned char *map;
+	size_t map_len;
+
+	/* frames waiting to be written (PTCacheFile in LinkData) */
+	TaskPool *task_pool;
+	ListBase pending;
+	int pending_len;
+	size_t pending_mem;
+	bool is_baking;
+} PTCachePacked;
+
+/* mmap_win.h isn't thread safe */
+static ThreadMutex ptcache_packed_map_lock = BLI_MUTEX_INITIALIZER;
+
+static bool ptcache_use_packed(const PTCacheID *pid)
+{
+	return ((pid->cache->flag & PTCACHE_DISK_PACKED) &&
+	        (pid->cache->flag & PTCACHE_EXTERNAL) == 0 &&
+	        (pid->file_type == PTCACHE_FILE_PTCACHE));
+}
+
+/* compress in into out, r_compressed is set to the mode used (0 when in should be stored as is) */
+static int ptcache_compress(
+        const unsigned char *in, unsigned int in_len, unsigned char *out, size_t *r_out_len,
+        unsigned char *props, size_t *r_props_len, int mode, unsigned char *r_compressed)
+{
+	int r = 0;
+	unsigned char compressed = 0;
+	size_t out_len = 0;
+	size_t sizeOfIt = 5;
+
+	(void)mode; /* unused when building w/o compression */
+
+#ifdef WITH_LZO
+	out_len= LZO_OUT_LEN(in_len);
+	if (mode == 1) {
+		LZO_HEAP_ALLOC(wrkmem, LZO1X_MEM_COMPRESS);
+		
+		r = lzo1x_1_compress(in, (lzo_uint)in_len, out, (lzo_uint *)&out_len, wrkmem);
+		if (!(r == LZO_E_OK) || (out_len >= in_len))
+			compressed = 0;
+		else
+			compressed = 1;
+	}
+#endif
+#ifdef WITH_LZMA
+	if (mode == 2) {
+		
+		r = LzmaCompress(out, &out_len, in, in_len, //assume sizeof(char)==1....
+		                 props, &sizeOfIt, 5, 1 << 24, 3, 0, 2, 32, 2);
+
+		if (!(r == SZ_OK) || (out_len >= in_len))
+			compressed = 0;
+		else
+			compressed = 2;
+	}
+#endif
+
+	UNUSED_VARS(in, in_len, out, props);
+
+	*r_out_len = out_len;
+	*r_props_len = sizeOfIt;
+	*r_compressed = compressed;
+
+	return r;
+}
+
+static void ptcache_packed_chunk_free(PTCachePackedChunk *chunk)
+{
+	MEM_SAFE_FREE(chunk->in);
+	MEM_SAFE_FREE(chunk->out);
+	MEM_freeN(chunk);
+}
+
+static void ptcache_packed_chunk_compress_task(TaskPool *__restrict UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	PTCachePackedChunk *chunk = taskdata;
+
+	ptcache_compress(chunk->in, chunk->in_len, chunk->out, &chunk->out_len,
+	                 chunk->props, &chunk->props_len, chunk->mode, &chunk->compressed);
+
+	/* only keep what's written */
+	if (chunk->compressed) {
+		MEM_SAFE_FREE(chunk->in);
+	}
+	else {
+		MEM_SAFE_FREE(chunk->out);
+	}
+}
+
+/* same data as ptcache_file_compressed_write */
+static size_t ptcache_packed_chunk_len(const PTCachePackedChunk *chunk)
+{
+	size_t len = sizeof(unsigned char);
+
+	if (chunk->compressed)
+		len += sizeof(unsigned int) + chunk->out_len;
+	else
+		len += chunk->in_len;
+
+	if (chunk->compressed == 2)
+		len += sizeof(unsigned int) + chunk->props_len;
+
+	return len;
+}
+static bool ptcache_packed_chunk_write(FILE *fp, const PTCachePackedChunk *chunk)
+{
+	unsigned int size;
+	bool ok = (fwrite(&chunk->compressed, sizeof(unsigned char), 1, fp) == 1);
+
+	if (chunk->compressed) {
+		size = (unsigned int)chunk->out_len;
+		ok = ok && (fwrite(&size, sizeof(unsigned int), 1, fp) == 1);
+		ok = ok && (fwrite(chunk->out, sizeof(unsigned char), chunk->out_len, fp) == chunk->out_len);
+	}
+	else {
+		ok = ok && (fwrite(chunk->in, sizeof(unsigned char), chunk->in_len, fp) == chunk->in_len);
+	}
+
+	if (chunk->compressed == 2) {
+		size = (unsigned int)chunk->props_len;
+		ok = ok && (fwrite(&size, sizeof(unsigned int), 1, fp) == 1);
+		ok = ok && (fwrite(chunk->props, sizeof(unsigned char), chunk->props_len, fp) == chunk->props_len);
+	}
+
+	return ok;
+}
+
+static void ptcache_file_free(PTCacheFile *pf)
+{
+	PTCachePackedChunk *chunk;
+
+	while ((chunk = BLI_pophead(&pf->chunks))) {
+		ptcache_packed_chunk_free(chunk);
+	}
+
+	if (pf->mem_alloc)
+		MEM_freeN(pf->mem);
+
+	MEM_freeN(pf);
+}
+
+static bool ptcache_packed_filename(PTCacheID *pid, char *filename)
+{
+	const int len = ptcache_filename(pid, filename, 0, 1, 0);
+
+	if (len == 0)
+		return false;
+
+	if (pid->cache->index < 0)
+		pid->cache->index = pid->stack_index = BKE_object_insert_ptcache(pid->ob);
+
+	BLI_snprintf(filename + len, MAX_PTCACHE_FILE - len, "_%02u%s", pid->stack_index, PTCACHE_PACKED_EXT);
+
+	return true;
+}
+
+static bool ptcache_packed_write_header(PTCachePacked *packed)
+{
+	PTCachePackedHeader header = {{0}};
+
+	memcpy(header.id, PTCACHE_PACKED_ID, sizeof(header.id));
+	header.version = PTCACHE_PACKED_VERSION;
+	header.data_len = packed->data_len;
+
+	return ((fseek(packed->fp, 0, SEEK_SET) == 0) &&
+	        (fwrite(&header, sizeof(header), 1, packed->fp) == 1));
+}
+
+/* open the file for adding & removing frames, creating it when there is none yet */
+static bool ptcache_packed_file_ensure(PTCachePacked *packed)
+{
+	if (packed->fp)
+		return true;
+
+	if (packed->data_len) {
+		packed->fp = BLI_fopen(packed->filepath, "rb+");
+	}
+	else {
+		BLI_make_existing_file(packed->filepath);
+		packed->fp = BLI_fopen(packed->filepath, "wb+");
+
+		if (packed->fp) {
+			packed->data_len = sizeof(PTCachePackedHeader);
+			if (!ptcache_packed_write_header(packed)) {
+				fclose(packed->fp);
+				packed->fp = NULL;
+				packed->data_len = 0;
+			}
+		}
+	}
+
+	return (packed->fp != NULL);
+}
+static void ptcache_packed_file_release(PTCachePacked *packed)
+{
+	if (packed->fp) {
+		fclose(packed->fp);
+		packed->fp = NULL;
+	}
+}
+
+static void ptcache_packed_unmap(PTCachePacked *packed)
+{
+	if (packed->map) {
+		BLI_mutex_lock(&ptcache_packed_map_lock);
+		munmap(packed->map, packed->map_len);
+		BLI_mutex_unlock(&ptcache_packed_map_lock);
+
+		packed->map = NULL;
+		packed->map_len = 0;
+	}
+}
+static bool ptcache_packed_map(PTCachePacked *packed)
+{
+	void *map;
+	int file;
+
+	/* new frames written over removed ones are visible through the existing map */
+	if (packed->map && packed->map_len >= packed->data_len)
+		return true;
+
+	ptcache_packed_unmap(packed);
+
+#ifdef WIN32
+	/* mmap_win.h can't map more than 4GB */
+	if (packed->data_len > UINT32_MAX)
+		return false;
+#endif
+
+	file = BLI_open(packed->filepath, O_BINARY | O_RDONLY, 0);
+	if (file == -1)
+		return false;
+
+	BLI_mutex_lock(&ptcache_packed_map_lock);
+	map = mmap(NULL, packed->data_len, PROT_READ, MAP_SHARED, file, 0);
+	BLI_mutex_unlock(&ptcache_packed_map_lock);
+
+	close(file);
+
+	if (map == MAP_FAILED)
+		return false;
+
+	packed->map = map;
+	packed->map_len = packed->data_len;
+
+	return true;
+}
+
+static void ptcache_packed_index_build(PTCachePacked *packed, FILE *fp)
+{
+	PTCachePackedRecord record;
+	size_t offset = sizeof(PTCachePackedHeader);
+	size_t file_len = BLI_file_descriptor_size(fileno(fp));
+
+	/* reading past the end of the mapped file raises SIGBUS, so don't trust the header */
+	if (file_len == (size_t)-1)
+		file_len = 0;
+	packed->data_len = MIN2(packed->data_len, file_len);
+
+	while (packed->data_len >= offset && packed->data_len - offset >= sizeof(record)) {
+		if (fseek(fp, offset, SEEK_SET) != 0 || fread(&record, sizeof(record), 1, fp) != 1)
+			break;
+
+		if (record.data_len > packed->data_len - offset - sizeof(record))
+			break;
+
+		if ((record.flag & PTCACHE_PACKED_RECORD_REMOVED) == 0) {
+			PTCachePackedFrame *entry;
+			void **val_p;
+
+			if (!BLI_ghash_ensure_p(packed->frames, SET_INT_IN_POINTER(record.frame), &val_p))
+				*val_p = MEM_mallocN(sizeof(PTCachePackedFrame), "PTCachePackedFrame");
+
+			entry = *val_p;
+			entry->offset = offset;
+			entry->data_len = (size_t)record.data_len;
+		}
+
+		offset += sizeof(record) + (size_t)record.data_len;
+	}
+
+	/* skip a truncated record */
+	packed->data_len = offset;
+}
+
+/* when create is set, the file is created on writing the first frame */
+static PTCachePacked *ptcache_packed_open(const char *filepath, bool create)
+{
+	PTCachePacked *packed;
+	PTCachePackedHeader header;
+	FILE *fp = BLI_fopen(filepath, "rb");
+
+	if (fp) {
+		if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		    !STREQLEN(header.id, PTCACHE_PACKED_ID, sizeof(header.id)) ||
+		    header.version != PTCACHE_PACKED_VERSION)
+		{
+			if (G.debug & G_DEBUG)
+				printf("Invalid packed point cache file: %s\n", filepath);
+
+			fclose(fp);
+			fp = NULL;
+		}
+	}
+
+	if (fp == NULL && !create)
+		return NULL;
+
+	packed = MEM_callocN(sizeof(PTCachePacked), "PTCachePacked");
+	BLI_strncpy(packed->filepath, filepath, sizeof(packed->filepath));
+	packed->frames = BLI_ghash_int_new(__func__);
+
+	if (fp) {
+		packed->data_len = (size_t)header.data_len;
+		ptcache_packed_index_build(packed, fp);
+		fclose(fp);
+	}
+
+	return packed;
+}
+
+static bool ptcache_packed_frame_pending(const PTCachePacked *packed, int frame)
+{
+	LinkData *link;
+
+	for (link = packed->pending.first; link; link = link->next) {
+		if (((PTCacheFile *)link->data)->frame == frame)
+			return true;
+	}
+
+	return false;
+}
+
+static void ptcache_packed_frame_remove(PTCachePacked *packed, int frame)
+{
+	PTCachePackedFrame *entry = BLI_ghash_popkey(packed->frames, SET_INT_IN_POINTER(frame), NULL);
+
+	if (entry) {
+		if (ptcache_packed_file_ensure(packed)) {
+			const unsigned int flag = PTCACHE_PACKED_RECORD_REMOVED;
+
+			if (fseek(packed->fp, entry->offset + offsetof(PTCachePackedRecord, flag), SEEK_SET) == 0)
+				fwrite(&flag, sizeof(flag), 1, packed->fp);
+		}
+
+		MEM_freeN(entry);
+	}
+}
+
+/* removed records at the end of the file are written over by new frames */
+static void ptcache_packed_trim(PTCachePacked *packed)
+{
+	GHashIterator gh_iter;
+	size_t data_len = sizeof(PTCachePackedHeader);
+
+	GHASH_ITER (gh_iter, packed->frames) {
+		const PTCachePackedFrame *entry = BLI_ghashIterator_getValue(&gh_iter);
+		data_len = MAX2(data_len, entry->offset + sizeof(PTCachePackedRecord) + entry->data_len);
+	}
+
+	if (data_len < packed->data_len) {
+		packed->data_len = data_len;
+
+		if (ptcache_packed_file_ensure(packed) && ptcache_packed_write_header(packed)) {
+			/* pages past the new end are still mapped but never read */
+			int error;
+
+			fflush(packed->fp);
+#ifdef WIN32
+			error = _chsize_s(_fileno(packed->fp), data_len);
+#else
+			error = ftruncate(fileno(packed->fp), data_len);
+#endif
+			if (error != 0 && (G.debug & G_DEBUG))
+				printf("Failed to truncate packed point cache file: %s\n", packed->filepath);
+		}
+	}
+}
+
+static bool ptcache_packed_append(PTCachePacked *packed, PTCacheFile *pf)
+{
+	PTCachePackedRecord record = {0};
+	PTCachePackedChunk *chunk;
+	PTCachePackedFrame *entry;
+	FILE *fp;
+	size_t mem_pos = 0;
+	bool ok;
+
+	if (!ptcache_packed_file_ensure(packed))
+		return false;
+
+	/* space of trimmed frames is written again */
+	BKE_cache_prefetch_invalidate(packed->filepath);
+
+	ptcache_packed_frame_remove(packed, pf->frame);
+
+	record.frame = pf->frame;
+	record.data_len = pf->mem_len;
+
+	for (chunk = pf->chunks.first; chunk; chunk = chunk->next)
+		record.data_len += ptcache_packed_chunk_len(chunk);
+
+	fp = packed->fp;
+	ok = ((fseek(fp, packed->data_len, SEEK_SET) == 0) &&
+	      (fwrite(&record, sizeof(record), 1, fp) == 1));
+
+	/* frame data, with the compressed chunks in between */
+	for (chunk = pf->chunks.first; chunk && ok; chunk = chunk->next) {
+		const size_t len = chunk->mem_pos - mem_pos;
+
+		ok = ((fwrite(pf->mem + mem_pos, sizeof(unsigned char), len, fp) == len) &&
+		      ptcache_packed_chunk_write(fp, chunk));
+		mem_pos = chunk->mem_pos;
+	}
+
+	if (ok) {
+		const size_t len = pf->mem_len - mem_pos;
+		ok = (fwrite(pf->mem + mem_pos, sizeof(unsigned char), len, fp) == len);
+	}
+
+	if (!ok)
+		return false;
+
+	entry = MEM_mallocN(sizeof(PTCachePackedFrame), "PTCachePackedFrame");
+	entry->offset = packed->data_len;
+	entry->data_len = (size_t)record.data_len;
+	BLI_ghash_insert(packed->frames, SET_INT_IN_POINTER(pf->frame), entry);
+
+	packed->data_len += sizeof(record) + (size_t)record.data_len;
+
+	return ptcache_packed_write_header(packed);
+}
+
+/* wait for the compression of pending frames and write them */
+static void ptcache_packed_flush(PTCachePacked *packed)
+{
+	LinkData *link;
+
+	if (packed->task_pool) {
+		BLI_task_pool_work_and_wait(packed->task_pool);
+		BLI_task_pool_free(packed->task_pool);
+		packed->task_pool = NULL;
+	}
+
+	while ((link = BLI_pophead(&packed->pending))) {
+		PTCacheFile *pf = link->data;
+
+		if (!ptcache_packed_append(packed, pf) && (G.debug & G_DEBUG))
+			printf("Error writing to disk cache\n");
+
+		ptcache_file_free(pf);
+		MEM_freeN(link);
+	}
+
+	packed->pending_len = 0;
+	packed->pending_mem = 0;
+}
+
+static void ptcache_packed_free(PTCachePacked *packed)
+{
+	ptcache_packed_flush(packed);
+	ptcache_packed_file_release(packed);
+	ptcache_packed_unmap(packed);
+
+	BLI_ghash_free(packed->frames, NULL, MEM_freeN);
+	MEM_freeN(packed);
+}
+
+/* takes ownership of pf */
+static void ptcache_packed_frame_add(PTCachePacked *packed, PTCacheFile *pf)
+{
+	if (BLI_listbase_is_empty(&pf->chunks) && BLI_listbase_is_empty(&packed->pending)) {
+		if (!ptcache_packed_append(packed, pf) && (G.debug & G_DEBUG))
+			printf("Error writing to disk cache\n");
+
+		ptcache_file_free(pf);
+	}
+	else {
+		PTCachePackedChunk *chunk;
+
+		BLI_addtail(&packed->pending, BLI_genericNodeN(pf));
+		packed->pending_len++;
+		packed->pending_mem += pf->mem_len;
+
+		for (chunk = pf->chunks.first; chunk; chunk = chunk->next)
+			packed->pending_mem += 2 * (size_t)chunk->in_len;
+
+		if (!packed->is_baking ||
+		    packed->pending_len >= BLI_task_scheduler_num_threads(BLI_task_scheduler_get()) ||
+		    packed->pending_mem >= PTCACHE_PACKED_PENDING_MEM_MAX)
+		{
+			ptcache_packed_flush(packed);
+		}
+	}
+
+	if (!packed->is_baking)
+		ptcache_packed_file_release(packed);
+}
+
+static bool ptcache_packed_frame_read(PTCachePacked *packed, int frame, PTCacheFile *pf)
+{
+	const PTCachePackedFrame *entry;
+	const size_t offset_data = sizeof(PTCachePackedRecord);
+
+	if (ptcache_packed_frame_pending(packed, frame))
+		ptcache_packed_flush(packed);
+
+	entry = BLI_ghash_lookup(packed->frames, SET_INT_IN_POINTER(frame));
+
+	if (entry == NULL)
+		return false;
+
+	if (packed->fp)
+		fflush(packed->fp);
+
+	pf->mem = BKE_cache_prefetch_get(packed->filepath, entry->offset + offset_data, entry->data_len, &pf->mem_len);
+
+	if (pf->mem) {
+		/* read in the background during playback */
+		pf->mem_alloc = pf->mem_len;
+		return true;
+	}
+	else if (ptcache_packed_map(packed)) {
+		pf->mem = packed->map + entry->offset + offset_data;
+	}
+	else {
+		/* read into memory when the file can't be mapped */
+		FILE *fp = BLI_fopen(packed->filepath, "rb");
+		bool ok;
+
+		if (fp == NULL)
+			return false;
+
+		pf->mem = MEM_mallocN(entry->data_len, "PTCacheFile mem");
+		pf->mem_alloc = entry->data_len;
+
+		ok = ((fseek(fp, entry->offset + offset_data, SEEK_SET) == 0) &&
+		      (fread(pf->mem, sizeof(unsigned char), entry->data_len, fp) == entry->data_len));
+		fclose(fp);
+
+		if (!ok)
+			return false;
+	}
+
+	pf->mem_len = entry->data_len;
+
+	return true;
+}
+
+static PTCachePacked *ptcache_packed_get(PTCacheID *pid, bool create)
+{
+	PointCache *cache = pid->cache;
+	char filepath[MAX_PTCACHE_FILE];
+
+	if (!ptcache_packed_filename(pid, filepath))
+		return NULL;
+
+	/* the cache was renamed or the blend file saved elsewhere */
+	if (cache->packed && !STREQ(cache->packed->filepath, filepath)) {
+		ptcache_packed_free(cache->packed);
+		cache->packed = NULL;
+	}
+
+	if (cache->packed == NULL)
+		cache->packed = ptcache_packed_open(filepath, create);
+
+	return cache->packed;
+}
+
+static bool ptcache_packed_frame_exists(PTCacheID *pid, int frame)
+{
+	PTCachePacked *packed = ptcache_packed_get(pid, false);
+
+	return (packed &&
+	        (BLI_ghash_haskey(packed->frames, SET_INT_IN_POINTER(frame)) ||
+	         ptcache_packed_frame_pending(packed, frame)));
+}
+
+static void ptcache_packed_clear(PTCacheID *pid, int mode, int cfra)
+{
+	PointCache *cache = pid->cache;
+	PTCachePacked *packed = ptcache_packed_get(pid, false);
+	const int sta = cache->startframe, end = cache->endframe;
+
+	if (packed == NULL)
+		return;
+
+	ptcache_packed_flush(packed);
+
+	if (mode == PTCACHE_CLEAR_ALL) {
+		/* the file is deleted below */
+		BLI_ghash_clear(packed->frames, NULL, MEM_freeN);
+		cache->last_exact = MIN2(cache->startframe, 0);
+	}
+	else {
+		GHashIterator gh_iter;
+		int *frames = MEM_mallocN(sizeof(int) * BLI_ghash_size(packed->frames), __func__);
+		int frames_len = 0;
+
+		GHASH_ITER (gh_iter, packed->frames) {
+			const int frame = GET_INT_FROM_POINTER(BLI_ghashIterator_getKey(&gh_iter));
+
+			if ((mode == PTCACHE_CLEAR_BEFORE && frame < cfra) ||
+			    (mode == PTCACHE_CLEAR_AFTER && frame > cfra))
+			{
+				frames[frames_len++] = frame;
+			}
+		}
+
+		for (int i = 0; i < frames_len; i++) {
+			ptcache_packed_frame_remove(packed, frames[i]);
+
+			if (cache->cached_frames && frames[i] >= sta && frames[i] <= end)
+				cache->cached_frames[frames[i] - sta] = 0;
+		}
+
+		MEM_freeN(frames);
+
+		ptcache_packed_trim(packed);
+	}
+
+	if (BLI_ghash_size(packed->frames) == 0) {
+		ptcache_packed_file_release(packed);
+		ptcache_packed_unmap(packed);
+		BKE_cache_prefetch_invalidate(packed->filepath);
+		BLI_delete(packed->filepath, false, false);
+		packed->data_len = 0;
+	}
+	else if (!packed->is_baking) {
+		ptcache_packed_file_release(packed);
+	}
+}
+
+static PTCacheFile *ptcache_packed_file_open(PTCacheID *pid, int mode, int cfra)
+{
+	PTCachePacked *packed;
+	PTCacheFile *pf;
+
+	/* frames can't be updated in place */
+	if (mode == PTCACHE_FILE_UPDATE)
+		return NULL;
+
+	packed = ptcache_packed_get(pid, mode == PTCACHE_FILE_WRITE);
+
+	if (packed == NULL)
+		return NULL;
+
+	pf = MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
+	pf->packed = packed;
+	pf->mode = mode;
+	pf->frame = cfra;
+
+	if (mode == PTCACHE_FILE_READ) {
+		if (!ptcache_packed_frame_read(packed, cfra, pf)) {
+			ptcache_file_free(pf);
+			return NULL;
+		}
+	}
+	else {
+		packed->is_baking = (pid->cache->flag & PTCACHE_BAKING) != 0;
+	}
+
+	return pf;
+}
+
+/* write the frames still waiting for compression, called when baking ends */
+static void ptcache_packed_bake_finish(PointCache *cache)
+{
+	if (cache->packed) {
+		ptcache_packed_flush(cache->packed);
+		ptcache_packed_file_release(cache->packed);
+		cache->packed->is_baking = false;
+	}
+}
+
+/* -------------------------------------------------------------------- */
+
 /* youll need to close yourself after! */
 static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 {
@@ -1879,17 +2638,35 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 		return NULL;
 #endif
 	if (!G.relbase_valid && (pid->cache->flag & PTCACHE_EXTERNAL)==0) return NULL; /* save blend file before using disk pointcache */
+
+	if (ptcache_use_packed(pid))
+		return ptcache_packed_file_open(pid, mode, cfra);
 	
 	ptcache_filename(pid, filename, cfra, 1, 1);
 
 	if (mode==PTCACHE_FILE_READ) {
+		size_t mem_len;
+		unsigned char *mem = BKE_cache_prefetch_get(filename, 0, 0, &mem_len);
+
+		/* read in the background during playback */
+		if (mem) {
+			pf = MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
+			pf->mem = mem;
+			pf->mem_len = pf->mem_alloc = mem_len;
+			pf->frame = cfra;
+			pf->mode = mode;
+			return pf;
+		}
+
 		fp = BLI_fopen(filename, "rb");
 	}
 	else if (mode==PTCACHE_FILE_WRITE) {
+		BKE_cache_prefetch_invalidate(filename);
 		BLI_make_existing_file(filename); /* will create the dir if needs be, same as //textures is created */
 		fp = BLI_fopen(filename, "wb");
 	}
 	else if (mode==PTCACHE_FILE_UPDATE) {
+		BKE_cache_prefetch_invalidate(filename);
 		BLI_make_existing_file(filename);
 		fp = BLI_fopen(filename, "rb+");
 	}
@@ -1897,19 +2674,51 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 	if (!fp)
 		return NULL;
 
-	pf= MEM_mallocN(sizeof(PTCacheFile), "PTCacheFile");
+	pf= MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
 	pf->fp= fp;
 	pf->old_format = 0;
 	pf->frame = cfra;
+	pf->mode = mode;
 
 	return pf;
 }
 static void ptcache_file_close(PTCacheFile *pf)
 {
 	if (pf) {
-		fclose(pf->fp);
-		MEM_freeN(pf);
+		if (pf->fp) {
+			fclose(pf->fp);
+			ptcache_file_free(pf);
+		}
+		else if (pf->mode == PTCACHE_FILE_WRITE) {
+			ptcache_packed_frame_add(pf->packed, pf);
+		}
+		else {
+			ptcache_file_free(pf);
+		}
+	}
+}
+
+/* data of the packed file (read directly from the memory map) */
+static unsigned char *ptcache_file_mem_read(PTCacheFile *pf, size_t len)
+{
+	unsigned char *data = NULL;
+
+	if (pf->mem_pos + len <= pf->mem_len) {
+		data = pf->mem + pf->mem_pos;
+		pf->mem_pos += len;
+	}
+
+	return data;
+}
+static void ptcache_file_mem_write(PTCacheFile *pf, const void *data, size_t len)
+{
+	if (pf->mem_len + len > pf->mem_alloc) {
+		pf->mem_alloc = MAX3(pf->mem_alloc * 2, pf->mem_len + len, 4096);
+		pf->mem = pf->mem ? MEM_reallocN(pf->mem, pf->mem_alloc) : MEM_mallocN(pf->mem_alloc, "PTCacheFile mem");
 	}
+
+	memcpy(pf->mem + pf->mem_len, data, len);
+	pf->mem_len += len;
 }
 
 static int ptcache_file_compressed_read(PTCacheFile *pf, unsigned char *result, unsigned int len)
@@ -1932,23 +2741,33 @@ static int ptcache_file_compressed_read(PTCacheFile *pf, unsigned char *result,
 			/* do nothing */
 		}
 		else {
-			in = (unsigned char *)MEM_callocN(sizeof(unsigned char)*in_len, "pointcache_compressed_buffer");
-			ptcache_file_read(pf, in, in_len, sizeof(unsigned char));
+			/* the packed cache is decompressed in place */
+			if (pf->fp == NULL) {
+				in = ptcache_file_mem_read(pf, in_len);
+			}
+			else {
+				in = (unsigned char *)MEM_callocN(sizeof(unsigned char)*in_len, "pointcache_compressed_buffer");
+				ptcache_file_read(pf, in, in_len, sizeof(unsigned char));
+			}
+
+			if (in) {
 #ifdef WITH_LZO
-			if (compressed == 1)
-				r = lzo1x_decompress_safe(in, (lzo_uint)in_len, result, (lzo_uint *)&out_len, NULL);
+				if (compressed == 1)
+					r = lzo1x_decompress_safe(in, (lzo_uint)in_len, result, (lzo_uint *)&out_len, NULL);
 #endif
 #ifdef WITH_LZMA
-			if (compressed == 2) {
-				size_t sizeOfIt;
-				size_t leni = in_len, leno = len;
-				ptcache_file_read(pf, &size, 1, sizeof(unsigned int));
-				sizeOfIt = (size_t)size;
-				ptcache_file_read(pf, props, sizeOfIt, sizeof(unsigned char));
-				r = LzmaUncompress(result, &leno, in, &leni, props, sizeOfIt);
-			}
+				if (compressed == 2) {
+					size_t sizeOfIt;
+					size_t leni = in_len, leno = len;
+					ptcache_file_read(pf, &size, 1, sizeof(unsigned int));
+					sizeOfIt = (size_t)size;
+					ptcache_file_read(pf, props, sizeOfIt, sizeof(unsigned char));
+					r = LzmaUncompress(result, &leno, in, &leni, props, sizeOfIt);
+				}
 #endif
-			MEM_freeN(in);
+				if (pf->fp)
+					MEM_freeN(in);
+			}
 		}
 	}
 	else {
@@ -1967,32 +2786,29 @@ static int ptcache_file_compressed_write(PTCacheFile *pf, unsigned char *in, uns
 	unsigned char *props = MEM_callocN(16 * sizeof(char), "tmp");
 	size_t sizeOfIt = 5;
 
-	(void)mode; /* unused when building w/o compression */
+	/* packed cache, compress in a task and add the result when the frame is written */
+	if (pf->fp == NULL && mode && in_len >= PTCACHE_PACKED_CHUNK_TASK_MIN) {
+		PTCachePacked *packed = pf->packed;
+		PTCachePackedChunk *chunk = MEM_callocN(sizeof(PTCachePackedChunk), "PTCachePackedChunk");
 
-#ifdef WITH_LZO
-	out_len= LZO_OUT_LEN(in_len);
-	if (mode == 1) {
-		LZO_HEAP_ALLOC(wrkmem, LZO1X_MEM_COMPRESS);
-		
-		r = lzo1x_1_compress(in, (lzo_uint)in_len, out, (lzo_uint *)&out_len, wrkmem);
-		if (!(r == LZO_E_OK) || (out_len >= in_len))
-			compressed = 0;
-		else
-			compressed = 1;
-	}
-#endif
-#ifdef WITH_LZMA
-	if (mode == 2) {
-		
-		r = LzmaCompress(out, &out_len, in, in_len, //assume sizeof(char)==1....
-		                 props, &sizeOfIt, 5, 1 << 24, 3, 0, 2, 32, 2);
+		chunk->mem_pos = pf->mem_len;
+		chunk->in = MEM_mallocN(in_len, "pointcache_chunk_in");
+		memcpy(chunk->in, in, in_len);
+		chunk->in_len = in_len;
+		chunk->out = MEM_mallocN(LZO_OUT_LEN(in_len), "pointcache_chunk_out");
+		chunk->mode = mode;
+		BLI_addtail(&pf->chunks, chunk);
 
-		if (!(r == SZ_OK) || (out_len >= in_len))
-			compressed = 0;
-		else
-			compressed = 2;
+		if (packed->task_pool == NULL)
+			packed->task_pool = BLI_task_pool_create(BLI_task_scheduler_get(), packed);
+
+		BLI_task_pool_push(packed->task_pool, ptcache_packed_chunk_compress_task, chunk, false, TASK_PRIORITY_LOW);
+
+		MEM_freeN(props);
+		return r;
 	}
-#endif
+
+	r = ptcache_compress(in, in_len, out, &out_len, props, &sizeOfIt, mode, &compressed);
 	
 	ptcache_file_write(pf, &compressed, 1, sizeof(unsigned char));
 	if (compressed) {
@@ -2015,12 +2831,67 @@ static int ptcache_file_compressed_write(PTCacheFile *pf, unsigned char *in, uns
 }
 static int ptcache_file_read(PTCacheFile *pf, void *f, unsigned int tot, unsigned int size)
 {
+	if (pf->fp == NULL) {
+		const void *data = ptcache_file_mem_read(pf, (size_t)tot * size);
+
+		if (data == NULL)
+			return 0;
+
+		memcpy(f, data, (size_t)tot * size);
+		return 1;
+	}
+
 	return (fread(f, size, tot, pf->fp) == tot);
 }
 static int ptcache_file_write(PTCacheFile *pf, const void *f, unsigned int tot, unsigned int size)
 {
+	if (pf->fp == NULL) {
+		ptcache_file_mem_write(pf, f, (size_t)tot * size);
+		return 1;
+	}
+
 	return (fwrite(f, size, tot, pf->fp) == tot);
 }
+static void ptcache_file_seek(PTCacheFile *pf, long offset, int origin)
+{
+	if (pf->fp == NULL) {
+		const long pos = (origin == SEEK_CUR) ? (long)pf->mem_pos + offset : offset;
+		pf->mem_pos = (size_t)CLAMPIS(pos, 0, (long)pf->mem_len);
+	}
+	else {
+		fseek(pf->fp, offset, origin);
+	}
+}
+/* the rest of the file, for copying frames between disk cache layouts */
+static unsigned char *ptcache_file_read_remaining(PTCacheFile *pf, size_t *r_len)
+{
+	unsigned char *data = NULL;
+	size_t len;
+
+	if (pf->fp) {
+		const long pos = ftell(pf->fp);
+
+		fseek(pf->fp, 0, SEEK_END);
+		len = (size_t)(ftell(pf->fp) - pos);
+		fseek(pf->fp, pos, SEEK_SET);
+	}
+	else {
+		len = pf->mem_len - pf->mem_pos;
+	}
+
+	if (len) {
+		data = MEM_mallocN(len, __func__);
+
+		if (!ptcache_file_read(pf, data, len, sizeof(unsigned char))) {
+			MEM_freeN(data);
+			data = NULL;
+			len = 0;
+		}
+	}
+
+	*r_len = len;
+	return data;
+}
 static int ptcache_file_data_read(PTCacheFile *pf)
 {
 	int i;
@@ -2051,13 +2922,13 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 	
 	pf->data_types = 0;
 	
-	if (fread(bphysics, sizeof(char), 8, pf->fp) != 8)
+	if (!ptcache_file_read(pf, bphysics, 8, sizeof(char)))
 		error = 1;
 	
 	if (!error && !STREQLEN(bphysics, "BPHYSICS", 8))
 		error = 1;
 
-	if (!error && !fread(&typeflag, sizeof(unsigned int), 1, pf->fp))
+	if (!error && !ptcache_file_read(pf, &typeflag, 1, sizeof(unsigned int)))
 		error = 1;
 
 	pf->type = (typeflag & PTCACHE_TYPEFLAG_TYPEMASK);
@@ -2065,7 +2936,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 	
 	/* if there was an error set file as it was */
 	if (error)
-		fseek(pf->fp, 0, SEEK_SET);
+		ptcache_file_seek(pf, 0, SEEK_SET);
 
 	return !error;
 }
@@ -2074,10 +2945,10 @@ static int ptcache_file_header_begin_write(PTCacheFile *pf)
 	const char *bphysics = "BPHYSICS";
 	unsigned int typeflag = pf->type + pf->flag;
 	
-	if (fwrite(bphysics, sizeof(char), 8, pf->fp) != 8)
+	if (!ptcache_file_write(pf, bphysics, 8, sizeof(char)))
 		return 0;
 
-	if (!fwrite(&typeflag, sizeof(unsigned int), 1, pf->fp))
+	if (!ptcache_file_write(pf, &typeflag, 1, sizeof(unsigned int)))
 		return 0;
 	
 	return 1;
@@ -2630,6 +3501,51 @@ static int ptcache_interpolate(PTCacheID *pid, float cfra, int cfra1, int cfra2)
 
 	return 1;
 }
+/* request the following frames to be read in the background during playback */
+static void ptcache_prefetch(PTCacheID *pid, int cfra)
+{
+	PointCache *cache = pid->cache;
+	PTCachePacked *packed = NULL;
+	char filename[MAX_PTCACHE_FILE];
+	int step;
+	const int depth = BKE_cache_prefetch_depth(&step);
+
+	if (depth == 0 ||
+	    (cache->flag & PTCACHE_DISK_CACHE) == 0 ||
+	    (cache->flag & PTCACHE_BAKING) ||
+	    (pid->file_type != PTCACHE_FILE_PTCACHE))
+	{
+		return;
+	}
+
+	if (ptcache_use_packed(pid)) {
+		packed = ptcache_packed_get(pid, false);
+
+		if (packed == NULL)
+			return;
+	}
+
+	for (int ahead = 1; ahead <= depth; ahead++) {
+		const int frame = cfra + step * ahead;
+
+		if (frame < cache->startframe || frame > cache->endframe)
+			break;
+
+		if (packed) {
+			const PTCachePackedFrame *entry = BLI_ghash_lookup(packed->frames, SET_INT_IN_POINTER(frame));
+
+			if (entry) {
+				BKE_cache_prefetch_request(packed->filepath, entry->offset + sizeof(PTCachePackedRecord),
+				                           entry->data_len, ahead);
+			}
+		}
+		else if (BKE_ptcache_id_exist(pid, frame)) {
+			ptcache_filename(pid, filename, frame, 1, 1);
+			BKE_cache_prefetch_request(filename, 0, 0, ahead);
+		}
+	}
+}
+
 /* reads cache from disk or memory */
 /* possible to get old or interpolated result */
 int BKE_ptcache_read(PTCacheID *pid, float cfra, bool no_extrapolate_old)
@@ -2721,6 +3637,9 @@ int BKE_ptcache_read(PTCacheID *pid, float cfra, bool no_extrapolate_old)
 		BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_AFTER, MAX2(cfrai, pid->cache->last_exact));
 	}
 
+	if (ret)
+		ptcache_prefetch(pid, cfrai);
+
 	return ret;
 }
 static int ptcache_write_stream(PTCacheID *pid, int cfra, int totpoint)
@@ -2978,7 +3897,13 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
 	case PTCACHE_CLEAR_ALL:
 	case PTCACHE_CLEAR_BEFORE:
 	case PTCACHE_CLEAR_AFTER:
-		if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+		if ((pid->cache->flag & PTCACHE_DISK_CACHE) && ptcache_use_packed(pid)) {
+			ptcache_packed_clear(pid, mode, cfra);
+
+			if (mode == PTCACHE_CLEAR_ALL && pid->cache->cached_frames)
+				memset(pid->cache->cached_frames, 0, MEM_allocN_len(pid->cache->cached_frames));
+		}
+		else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 			ptcache_path(pid, path);
 			
 			dir = opendir(path);
@@ -3067,8 +3992,20 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
 	case PTCACHE_CLEAR_FRAME:
 		if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 			if (BKE_ptcache_id_exist(pid, cfra)) {
-				ptcache_filename(pid, filename, cfra, 1, 1); /* no path */
-				BLI_delete(filename, false, false);
+				if (ptcache_use_packed(pid)) {
+					PTCachePacked *packed = ptcache_packed_get(pid, false);
+
+					ptcache_packed_flush(packed);
+					ptcache_packed_frame_remove(packed, cfra);
+					ptcache_packed_trim(packed);
+
+					if (!packed->is_baking)
+						ptcache_packed_file_release(packed);
+				}
+				else {
+					ptcache_filename(pid, filename, cfra, 1, 1); /* no path */
+					BLI_delete(filename, false, false);
+				}
 			}
 		}
 		else {
@@ -3103,6 +4040,9 @@ int  BKE_ptcache_id_exist(PTCacheID *pid, int cfra)
 	
 	if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 		char filename[MAX_PTCACHE_FILE];
+
+		if (ptcache_use_packed(pid))
+			return ptcache_packed_frame_exists(pid, cfra);
 		
 		ptcache_filename(pid, filename, cfra, 1, 1);
 
@@ -3179,7 +4119,29 @@ void BKE_ptcache_id_time(PTCacheID *pid, Scene *scene, float cfra, int *startfra
 
 		cache->cached_frames = MEM_callocN(sizeof(char) * (cache->endframe-cache->startframe+1), "cached frames array");
 
-		if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+		if ((pid->cache->flag & PTCACHE_DISK_CACHE) && ptcache_use_packed(pid)) {
+			PTCachePacked *packed = ptcache_packed_get(pid, false);
+
+			if (packed) {
+				GHashIterator gh_iter;
+				LinkData *link;
+
+				GHASH_ITER (gh_iter, packed->frames) {
+					const int frame = GET_INT_FROM_POINTER(BLI_ghashIterator_getKey(&gh_iter));
+
+					if (frame >= sta && frame <= end)
+						cache->cached_frames[frame-sta] = 1;
+				}
+
+				for (link = packed->pending.first; link; link = link->next) {
+					const int frame = ((PTCacheFile *)link->data)->frame;
+
+					if (frame >= sta && frame <= end)
+						cache->cached_frames[frame-sta] = 1;
+				}
+			}
+		}
+		else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 			/* mode is same as fopen's modes */
 			DIR *dir; 
 			struct dirent *de;
@@ -3381,7 +4343,7 @@ void BKE_ptcache_remove(void)
 			if (FILENAME_IS_CURRPAR(de->d_name)) {
 				/* do nothing */
 			}
-			else if (strstr(de->d_name, PTCACHE_EXT)) { /* do we have the right extension?*/
+			else if (strstr(de->d_name, PTCACHE_EXT) || strstr(de->d_name, PTCACHE_PACKED_EXT)) { /* do we have the right extension?*/
 				BLI_join_dirfile(path_full, sizeof(path_full), path, de->d_name);
 				BLI_delete(path_full, false, false);
 			}
@@ -3438,6 +4400,8 @@ void BKE_ptcache_free(PointCache *cache)
 		cache->free_edit(cache->edit);
 	if (cache->cached_frames)
 		MEM_freeN(cache->cached_frames);
+	if (cache->packed)
+		ptcache_packed_free(cache->packed);
 	MEM_freeN(cache);
 }
 void BKE_ptcache_free_list(ListBase *ptcaches)
@@ -3461,7 +4425,7 @@ static PointCache *ptcache_copy(PointCache *cache, const bool copy_data)
 		ncache->cached_frames = NULL;
 
 		/* flag is a mix of user settings and simulator/baking state */
-		ncache->flag= ncache->flag & (PTCACHE_DISK_CACHE|PTCACHE_EXTERNAL|PTCACHE_IGNORE_LIBPATH);
+		ncache->flag= ncache->flag & (PTCACHE_DISK_CACHE|PTCACHE_DISK_PACKED|PTCACHE_EXTERNAL|PTCACHE_IGNORE_LIBPATH);
 		ncache->simframe= 0;
 	}
 	else {
@@ -3487,6 +4451,7 @@ static PointCache *ptcache_copy(PointCache *cache, const bool copy_data)
 
 	/* hmm, should these be copied over instead? */
 	ncache->edit = NULL;
+	ncache->packed = NULL;
 
 	return ncache;
 }
@@ -3698,6 +4663,7 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 
 	/* clear baking flag */
 	if (pid) {
+		ptcache_packed_bake_finish(cache);
 		cache->flag &= ~(PTCACHE_BAKING|PTCACHE_REDO_NEEDED);
 		cache->flag |= PTCACHE_SIMULATION_VALID;
 		if (bake) {
@@ -3718,6 +4684,8 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 
 				cache = pid->cache;
 
+				ptcache_packed_bake_finish(cache);
+
 				if (baker->quick_step > 1)
 					cache->flag &= ~(PTCACHE_BAKING|PTCACHE_OUTDATED);
 				else
@@ -3834,6 +4802,64 @@ void BKE_ptcache_toggle_disk_cache(PTCacheID *pid)
 	}
 }
 
+void BKE_ptcache_toggle_disk_packed(PTCacheID *pid)
+{
+	PointCache *cache = pid->cache;
+	int baked = cache->flag & PTCACHE_BAKED;
+	int last_exact = cache->last_exact;
+	int cfra;
+
+	if ((cache->flag & PTCACHE_DISK_CACHE) == 0 ||
+	    (cache->flag & PTCACHE_EXTERNAL) ||
+	    (pid->file_type != PTCACHE_FILE_PTCACHE))
+	{
+		return;
+	}
+
+	/* both layouts store the same data for a frame, copy it over (frame 0 is the info file) */
+	for (cfra = MIN2(cache->startframe, 0); cfra <= cache->endframe; cfra++) {
+		PTCacheFile *pf;
+		unsigned char *data = NULL;
+		size_t data_len = 0;
+
+		/* PTCACHE_DISK_PACKED was changed already */
+		cache->flag ^= PTCACHE_DISK_PACKED;
+		pf = ptcache_file_open(pid, PTCACHE_FILE_READ, cfra);
+		if (pf) {
+			data = ptcache_file_read_remaining(pf, &data_len);
+			ptcache_file_close(pf);
+		}
+		cache->flag ^= PTCACHE_DISK_PACKED;
+
+		if (data) {
+			pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, cfra);
+			if (pf) {
+				ptcache_file_write(pf, data, data_len, sizeof(unsigned char));
+				ptcache_file_close(pf);
+			}
+			MEM_freeN(data);
+		}
+	}
+
+	/* remove the files of the other layout */
+	cache->flag &= ~PTCACHE_BAKED;
+	cache->flag ^= PTCACHE_DISK_PACKED;
+	BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_ALL, 0);
+	cache->flag ^= PTCACHE_DISK_PACKED;
+	cache->flag |= baked;
+
+	cache->last_exact = last_exact;
+
+	if (cache->cached_frames) {
+		MEM_freeN(cache->cached_frames);
+		cache->cached_frames = NULL;
+	}
+
+	BKE_ptcache_id_time(pid, NULL, 0.0f, NULL, NULL, NULL);
+
+	BKE_ptcache_update_info(pid);
+}
+
 void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const char *name_dst)
 {
 	char old_name[80];
@@ -3850,6 +4876,24 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
 	/* save old name */
 	BLI_strncpy(old_name, pid->cache->name, sizeof(old_name));
 
+	if (ptcache_use_packed(pid)) {
+		if (pid->cache->packed) {
+			ptcache_packed_free(pid->cache->packed);
+			pid->cache->packed = NULL;
+		}
+
+		BLI_strncpy(pid->cache->name, name_src, sizeof(pid->cache->name));
+		ptcache_packed_filename(pid, old_path_full);
+		BLI_strncpy(pid->cache->name, name_dst, sizeof(pid->cache->name));
+		ptcache_packed_filename(pid, new_path_full);
+
+		if (BLI_exists(old_path_full))
+			BLI_rename(old_path_full, new_path_full);
+
+		BLI_strncpy(pid->cache->name, old_name, sizeof(pid->cache->name));
+		return;
+	}
+
 	/* get "from" filename */
 	BLI_strncpy(pid->cache->name, name_src, sizeof(pid->cache->name));
 
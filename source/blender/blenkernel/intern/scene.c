@@ -66,6 +66,7 @@
 #include "BKE_animsys.h"
 #include "BKE_action.h"
 #include "BKE_armature.h"
+#include "BKE_cache_prefetch.h"
 #include "BKE_cachefile.h"
 #include "BKE_colortools.h"
 #include "BKE_depsgraph.h"
@@ -760,6 +761,8 @@ void BKE_scene_init(Scene *sce)
 	sce->physics_settings.gravity[2] = -9.81f;
 	sce->physics_settings.flag = PHYS_GLOBAL_GRAVITY;
 
+	sce->cache_prefetch = 8;
+
 	sce->unit.scale_length = 1.0f;
 
 	pset = &sce->toolsettings->particle;
@@ -2029,6 +2032,9 @@ void BKE_scene_update_for_newframe_ex(EvaluationContext *eval_ctx, Main *bmain,
 	/* update animated image textures for particles, modifiers, gpu, etc,
 	 * call this at the start so modifiers with textures don't lag 1 frame */
 	BKE_image_update_frame(bmain, sce->r.cfra);
+
+	/* disk caches read during evaluation request the next frames */
+	BKE_cache_prefetch_frame_set(sce->r.cfra, sce->cache_prefetch);
 	
 #ifdef WITH_LEGACY_DEPSGRAPH
 	/* rebuild rigid body worlds before doing the actual frame update
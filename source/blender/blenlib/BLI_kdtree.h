@@ -66,6 +66,15 @@ void BLI_kdtree_range_search_cb(
         const KDTree *tree, const float co[3], float range,
         bool (*search_cb)(void *user_data, int index, const float co[3], float dist_sq), void *user_data);
 
+/* Batched queries, spread over threads. */
+void BLI_kdtree_find_nearest_batch(
+        const KDTree *tree, const float (*co)[3], unsigned int co_num,
+        KDTreeNearest *r_nearest) ATTR_NONNULL(1, 2, 4);
+void BLI_kdtree_find_nearest_n_batch(
+        const KDTree *tree, const float (*co)[3], unsigned int co_num,
+        KDTreeNearest *r_nearest, int *r_found,
+        unsigned int n) ATTR_NONNULL(1, 2, 4);
+
 /* Normal use is deprecated */
 /* remove __normal functions when last users drop */
 int BLI_kdtree_find_nearest_n__normal(
@@ -46,6 +46,9 @@ typedef struct BLI_mempool BLI_mempool;
 
 BLI_mempool *BLI_mempool_create(unsigned int esize, unsigned int totelem,
                                 unsigned int pchunk, unsigned int flag) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+BLI_mempool *BLI_mempool_create_concurrent(unsigned int esize, unsigned int totelem,
+                                           unsigned int pchunk, unsigned int flag,
+                                           unsigned int thread_num) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
 void        *BLI_mempool_alloc(BLI_mempool *pool) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
 void        *BLI_mempool_calloc(BLI_mempool *pool) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
 void         BLI_mempool_free(BLI_mempool *pool, void *addr) ATTR_NONNULL(1, 2);
@@ -56,6 +59,11 @@ void         BLI_mempool_destroy(BLI_mempool *pool) ATTR_NONNULL(1);
 int          BLI_mempool_count(BLI_mempool *pool) ATTR_NONNULL(1);
 void        *BLI_mempool_findelem(BLI_mempool *pool, unsigned int index) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
 
+/* only for pools created with BLI_mempool_create_concurrent */
+void        *BLI_mempool_alloc_thread(BLI_mempool *pool, const int thread_id) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void        *BLI_mempool_calloc_thread(BLI_mempool *pool, const int thread_id) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void         BLI_mempool_free_thread(BLI_mempool *pool, void *addr, const int thread_id) ATTR_NONNULL(1, 2);
+
 void        BLI_mempool_as_table(BLI_mempool *pool, void **data) ATTR_NONNULL(1, 2);
 void      **BLI_mempool_as_tableN(BLI_mempool *pool, const char *allocstr) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1, 2);
 void        BLI_mempool_as_array(BLI_mempool *pool, void *data) ATTR_NONNULL(1, 2);
@@ -82,6 +90,15 @@ enum {
 	 * \note order of iteration is only assured to be the order of allocation when no chunks have been freed.
 	 */
 	BLI_MEMPOOL_ALLOW_ITER = (1 << 0),
+	/** allow allocating and freeing from multiple threads,
+	 * using #BLI_mempool_alloc_thread & #BLI_mempool_free_thread with the task scheduler thread index.
+	 * Set by #BLI_mempool_create_concurrent.
+	 *
+	 * \note each element is one pointer larger (to store the thread which owns it).
+	 * \note the regular alloc/free functions act as thread 0 (main thread).
+	 * \note clear, iteration and conversion to arrays must not run while other threads use the pool.
+	 */
+	BLI_MEMPOOL_CONCURRENT = (1 << 1),
 };
 
 void  BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter) ATTR_NONNULL();
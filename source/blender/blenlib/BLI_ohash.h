@@ -0,0 +1,187 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+#ifndef __BLI_OHASH_H__
+#define __BLI_OHASH_H__
+
+/** \file BLI_ohash.h
+ *  \ingroup bli
+ *
+ * Open addressing variant of #GHash and #GSet.
+ *
+ * The API mirrors the GHash one (same callbacks, same function names with
+ * an 'o' prefix), so callers can switch by renaming. Keys, values and hashes
+ * are stored inline in a single array, lookups don't chase pointers.
+ *
+ * \note Unlike GHash, pointers returned by #BLI_ohash_lookup_p and
+ * #BLI_ohash_ensure_p are only valid until the next insertion or removal,
+ * and entries may not be removed while iterating (use #BLI_ohash_pop).
+ */
+
+#include "BLI_sys_types.h" /* for bool */
+#include "BLI_compiler_attrs.h"
+#include "BLI_ghash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OHash OHash;
+
+typedef struct OHashIterator {
+	OHash *oh;
+	struct OHashSlot *curr_slot;
+	unsigned int curr_index;
+} OHashIterator;
+
+typedef struct OHashIterState {
+	unsigned int curr_index;
+} OHashIterState;
+
+enum {
+	OHASH_FLAG_ALLOW_DUPES  = (1 << 0),  /* Only checked for in debug mode */
+	OHASH_FLAG_ALLOW_SHRINK = (1 << 1),  /* Allow to shrink the slots array. */
+};
+
+/* *** */
+
+OHash *BLI_ohash_new_ex(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+                        const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_copy(OHash *oh, GHashKeyCopyFP keycopyfp,
+                      GHashValCopyFP valcopyfp) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void   BLI_ohash_free(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void   BLI_ohash_reserve(OHash *oh, const unsigned int nentries_reserve);
+void   BLI_ohash_insert(OHash *oh, void *key, void *val);
+bool   BLI_ohash_reinsert(OHash *oh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void  *BLI_ohash_lookup(OHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+void  *BLI_ohash_lookup_default(OHash *oh, const void *key, void *val_default) ATTR_WARN_UNUSED_RESULT;
+void **BLI_ohash_lookup_p(OHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_ohash_ensure_p(OHash *oh, void *key, void ***r_val) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_ohash_ensure_p_ex(OHash *oh, const void *key, void ***r_key, void ***r_val) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_ohash_remove(OHash *oh, const void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void   BLI_ohash_clear(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void   BLI_ohash_clear_ex(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp,
+                          const unsigned int nentries_reserve);
+void  *BLI_ohash_popkey(OHash *oh, const void *key, GHashKeyFreeFP keyfreefp) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_ohash_haskey(OHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_ohash_pop(OHash *oh, OHashIterState *state, void **r_key, void **r_val) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+unsigned int BLI_ohash_size(OHash *oh) ATTR_WARN_UNUSED_RESULT;
+void   BLI_ohash_flag_set(OHash *oh, unsigned int flag);
+void   BLI_ohash_flag_clear(OHash *oh, unsigned int flag);
+
+/* *** */
+
+void           BLI_ohashIterator_init(OHashIterator *ohi, OHash *oh);
+void           BLI_ohashIterator_step(OHashIterator *ohi);
+
+BLI_INLINE void  *BLI_ohashIterator_getKey(OHashIterator *ohi) ATTR_WARN_UNUSED_RESULT;
+BLI_INLINE void  *BLI_ohashIterator_getValue(OHashIterator *ohi) ATTR_WARN_UNUSED_RESULT;
+BLI_INLINE void **BLI_ohashIterator_getValue_p(OHashIterator *ohi) ATTR_WARN_UNUSED_RESULT;
+BLI_INLINE bool   BLI_ohashIterator_done(OHashIterator *ohi) ATTR_WARN_UNUSED_RESULT;
+
+struct _oh_Slot { void *key, *val; unsigned int hash, dist; };
+BLI_INLINE void  *BLI_ohashIterator_getKey(OHashIterator *ohi)     { return  ((struct _oh_Slot *)ohi->curr_slot)->key; }
+BLI_INLINE void  *BLI_ohashIterator_getValue(OHashIterator *ohi)   { return  ((struct _oh_Slot *)ohi->curr_slot)->val; }
+BLI_INLINE void **BLI_ohashIterator_getValue_p(OHashIterator *ohi) { return &((struct _oh_Slot *)ohi->curr_slot)->val; }
+BLI_INLINE bool   BLI_ohashIterator_done(OHashIterator *ohi)       { return !ohi->curr_slot; }
+/* disallow further access */
+#ifdef __GNUC__
+#  pragma GCC poison _oh_Slot
+#else
+#  define _oh_Slot void
+#endif
+
+#define OHASH_ITER(oh_iter_, ohash_) \
+	for (BLI_ohashIterator_init(&oh_iter_, ohash_); \
+	     BLI_ohashIterator_done(&oh_iter_) == false; \
+	     BLI_ohashIterator_step(&oh_iter_))
+
+#define OHASH_ITER_INDEX(oh_iter_, ohash_, i_) \
+	for (BLI_ohashIterator_init(&oh_iter_, ohash_), i_ = 0; \
+	     BLI_ohashIterator_done(&oh_iter_) == false; \
+	     BLI_ohashIterator_step(&oh_iter_), i_++)
+
+OHash *BLI_ohash_ptr_new_ex(const char *info,
+                            const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_ptr_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_str_new_ex(const char *info,
+                            const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_str_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_int_new_ex(const char *info,
+                            const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_int_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+
+/* Average and longest probe sequence, for debugging and benchmarks. */
+double BLI_ohash_calc_quality_ex(OHash *oh, double *r_load, int *r_dist_max);
+double BLI_ohash_calc_quality(OHash *oh);
+
+/** \name OSet API
+ * A 'set' implementation (unordered collection of unique elements),
+ * the open addressing counterpart of #GSet, values are not used.
+ * \{ */
+
+typedef struct OSet OSet;
+
+typedef OHashIterator OSetIterator;
+typedef OHashIterState OSetIterState;
+
+OSet  *BLI_oset_new_ex(GSetHashFP hashfp, GSetCmpFP cmpfp, const char *info,
+                       const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OSet  *BLI_oset_new(GSetHashFP hashfp, GSetCmpFP cmpfp, const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void   BLI_oset_free(OSet *os, GSetKeyFreeFP keyfreefp);
+void   BLI_oset_reserve(OSet *os, const unsigned int nentries_reserve);
+void   BLI_oset_insert(OSet *os, void *key);
+bool   BLI_oset_add(OSet *os, void *key);
+bool   BLI_oset_ensure_p_ex(OSet *os, const void *key, void ***r_key);
+bool   BLI_oset_haskey(OSet *os, const void *key) ATTR_WARN_UNUSED_RESULT;
+void  *BLI_oset_lookup(OSet *os, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_oset_remove(OSet *os, const void *key, GSetKeyFreeFP keyfreefp);
+void   BLI_oset_clear(OSet *os, GSetKeyFreeFP keyfreefp);
+void   BLI_oset_clear_ex(OSet *os, GSetKeyFreeFP keyfreefp, const unsigned int nentries_reserve);
+bool   BLI_oset_pop(OSet *os, OSetIterState *state, void **r_key) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+unsigned int BLI_oset_size(OSet *os) ATTR_WARN_UNUSED_RESULT;
+void   BLI_oset_flag_set(OSet *os, unsigned int flag);
+void   BLI_oset_flag_clear(OSet *os, unsigned int flag);
+
+BLI_INLINE void BLI_osetIterator_init(OSetIterator *osi, OSet *os) { BLI_ohashIterator_init((OHashIterator *)osi, (OHash *)os); }
+BLI_INLINE void BLI_osetIterator_step(OSetIterator *osi) { BLI_ohashIterator_step((OHashIterator *)osi); }
+BLI_INLINE void *BLI_osetIterator_getKey(OSetIterator *osi) { return BLI_ohashIterator_getKey((OHashIterator *)osi); }
+BLI_INLINE bool BLI_osetIterator_done(OSetIterator *osi) { return BLI_ohashIterator_done((OHashIterator *)osi); }
+
+#define OSET_ITER(os_iter_, oset_) \
+	for (BLI_osetIterator_init(&os_iter_, oset_); \
+	     BLI_osetIterator_done(&os_iter_) == false; \
+	     BLI_osetIterator_step(&os_iter_))
+
+OSet  *BLI_oset_ptr_new_ex(const char *info,
+                           const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OSet  *BLI_oset_ptr_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OSet  *BLI_oset_str_new_ex(const char *info,
+                           const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OSet  *BLI_oset_str_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+
+/** \} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLI_OHASH_H__ */
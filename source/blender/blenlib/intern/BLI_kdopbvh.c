@@ -68,9 +68,18 @@
 /* Check tree is valid. */
 // #define USE_VERIFY_TREE
 
+/* Ray-cast children of a node at once (see #dfs_raycast_simd). */
+#ifdef __SSE2__
+#  define USE_KDOPBVH_SIMD
+#  include <emmintrin.h>
+#endif
+
 
 #define MAX_TREETYPE 32
 
+/* Number of bins along each axis to evaluate the surface area heuristic. */
+#define SAH_BINS 16
+
 /* Setting zero so we can catch bugs in BLI_task/KDOPBVH.
  * TODO(sergey): Deduplicate the limits with PBVH from BKE.
  */
@@ -106,6 +115,7 @@ struct BVHTree {
 	BVHNode *nodearray;     /* pre-alloc branch nodes */
 	BVHNode **nodechild;    /* pre-alloc childs for nodes */
 	float   *nodebv;        /* pre-alloc bounding-volumes for nodes */
+	float   *nodebv_simd;   /* packed AABB's of the children of each branch, 4 children per SIMD group (optional) */
 	float epsilon;          /* epslion is used for inflation of the k-dop	   */
 	int totleaf;            /* leafs */
 	int totbranch;
@@ -115,8 +125,8 @@ struct BVHTree {
 };
 
 /* optimization, ensure we stay small */
-BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
-                  (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
+BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 56) ||
+                  (sizeof(void *) == 4 && sizeof(BVHTree) <= 36),
                   "over sized")
 
 /* avoid duplicating vars in BVHOverlapData_Thread */
@@ -950,6 +960,451 @@ static void non_recursive_bvh_div_nodes(
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+
+/** \name SAH Build
+ *
+ * Alternative to the implicit tree, leafs are split with a binned surface area heuristic
+ * (on the X/Y/Z bounds of the leafs centroids), which gives tighter bounds for uneven geometry.
+ *
+ * Each branch is split in two until it has tree_type children, always splitting the child
+ * with the largest area. Like the implicit tree the build is done per depth level in parallel,
+ * branches are numbered breadth first, so all the childs have an index greater than the parent.
+ * \{ */
+
+typedef struct BVHSahRange {
+	int begin, end;
+} BVHSahRange;
+
+typedef struct BVHSahCluster {
+	int begin, end;
+	float bv[6];
+} BVHSahCluster;
+
+typedef struct BVHSahBin {
+	float bv[6];
+	int count;
+} BVHSahBin;
+
+BLI_INLINE void sah_bounds_init(float bv[6])
+{
+	bv[0] = bv[2] = bv[4] = FLT_MAX;
+	bv[1] = bv[3] = bv[5] = -FLT_MAX;
+}
+
+BLI_INLINE void sah_bounds_add(float bv[6], const float bv_other[6])
+{
+	int i;
+	for (i = 0; i < 6; i += 2) {
+		if (bv_other[i] < bv[i]) bv[i] = bv_other[i];
+		if (bv_other[i + 1] > bv[i + 1]) bv[i + 1] = bv_other[i + 1];
+	}
+}
+
+/* half the surface area, only the relative cost matters */
+BLI_INLINE float sah_bounds_area(const float bv[6])
+{
+	const float dx = bv[1] - bv[0];
+	const float dy = bv[3] - bv[2];
+	const float dz = bv[5] - bv[4];
+
+	if (dx < 0.0f) {
+		return 0.0f;
+	}
+	return dx * dy + dy * dz + dz * dx;
+}
+
+BLI_INLINE int sah_bin_index(const float bv[6], const int axis, const float bin_min, const float bin_scale)
+{
+	const float centroid = (bv[2 * axis] + bv[2 * axis + 1]) * 0.5f;
+	const int bin = (int)((centroid - bin_min) * bin_scale);
+	return CLAMPIS(bin, 0, SAH_BINS - 1);
+}
+
+/**
+ * Split the leafs in ``[begin, end)`` in two, returns the first leaf of the right side.
+ */
+static int bvh_sah_split(BVHNode **leafs_array, const int begin, const int end,
+                         float r_bv_left[6], float r_bv_right[6])
+{
+	BVHSahBin bins[3][SAH_BINS];
+	float bin_min[3], bin_scale[3];
+	float centroid_bv[6];
+	float bv_accum[SAH_BINS][6];
+	float best_cost = FLT_MAX;
+	int best_axis = -1, best_bin = 0;
+	int axis, i, j;
+
+	sah_bounds_init(centroid_bv);
+	for (i = begin; i < end; i++) {
+		const float *bv = leafs_array[i]->bv;
+		for (axis = 0; axis < 3; axis++) {
+			const float centroid = (bv[2 * axis] + bv[2 * axis + 1]) * 0.5f;
+			if (centroid < centroid_bv[2 * axis]) centroid_bv[2 * axis] = centroid;
+			if (centroid > centroid_bv[2 * axis + 1]) centroid_bv[2 * axis + 1] = centroid;
+		}
+	}
+
+	for (axis = 0; axis < 3; axis++) {
+		const float extent = centroid_bv[2 * axis + 1] - centroid_bv[2 * axis];
+		bin_min[axis] = centroid_bv[2 * axis];
+		/* zero scale puts all leafs in the first bin, the axis is skipped */
+		bin_scale[axis] = (extent > 0.0f) ? ((float)SAH_BINS * 0.9999f) / extent : 0.0f;
+
+		for (j = 0; j < SAH_BINS; j++) {
+			sah_bounds_init(bins[axis][j].bv);
+			bins[axis][j].count = 0;
+		}
+	}
+
+	for (i = begin; i < end; i++) {
+		const float *bv = leafs_array[i]->bv;
+		for (axis = 0; axis < 3; axis++) {
+			BVHSahBin *bin = &bins[axis][sah_bin_index(bv, axis, bin_min[axis], bin_scale[axis])];
+			sah_bounds_add(bin->bv, bv);
+			bin->count++;
+		}
+	}
+
+	/* sweep from the right storing the accumulated bounds, then from the left evaluating the cost */
+	for (axis = 0; axis < 3; axis++) {
+		float bv_left[6];
+		int count_left = 0, count_right[SAH_BINS];
+
+		if (bin_scale[axis] == 0.0f) {
+			continue;
+		}
+
+		sah_bounds_init(bv_accum[SAH_BINS - 1]);
+		sah_bounds_add(bv_accum[SAH_BINS - 1], bins[axis][SAH_BINS - 1].bv);
+		count_right[SAH_BINS - 1] = bins[axis][SAH_BINS - 1].count;
+		for (j = SAH_BINS - 2; j > 0; j--) {
+			memcpy(bv_accum[j], bv_accum[j + 1], sizeof(bv_accum[j]));
+			sah_bounds_add(bv_accum[j], bins[axis][j].bv);
+			count_right[j] = count_right[j + 1] + bins[axis][j].count;
+		}
+
+		sah_bounds_init(bv_left);
+		for (j = 0; j < SAH_BINS - 1; j++) {
+			float cost;
+
+			sah_bounds_add(bv_left, bins[axis][j].bv);
+			count_left += bins[axis][j].count;
+
+			if (count_left == 0 || count_right[j + 1] == 0) {
+				continue;
+			}
+
+			cost = ((float)count_left * sah_bounds_area(bv_left) +
+			        (float)count_right[j + 1] * sah_bounds_area(bv_accum[j + 1]));
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_axis = axis;
+				best_bin = j;
+				memcpy(r_bv_left, bv_left, sizeof(float[6]));
+				memcpy(r_bv_right, bv_accum[j + 1], sizeof(float[6]));
+			}
+		}
+	}
+
+	if (best_axis == -1) {
+		/* all centroids are at the same location, split in the middle */
+		const int mid = (begin + end) / 2;
+
+		sah_bounds_init(r_bv_left);
+		sah_bounds_init(r_bv_right);
+		for (i = begin; i < mid; i++) {
+			sah_bounds_add(r_bv_left, leafs_array[i]->bv);
+		}
+		for (i = mid; i < end; i++) {
+			sah_bounds_add(r_bv_right, leafs_array[i]->bv);
+		}
+		return mid;
+	}
+
+	/* partition, both sides are known to be non empty */
+	i = begin;
+	j = end - 1;
+	while (i <= j) {
+		if (sah_bin_index(leafs_array[i]->bv, best_axis, bin_min[best_axis], bin_scale[best_axis]) <= best_bin) {
+			i++;
+		}
+		else {
+			SWAP(BVHNode *, leafs_array[i], leafs_array[j]);
+			j--;
+		}
+	}
+
+	BLI_assert(i > begin && i < end);
+	return i;
+}
+
+typedef struct BVHSahBuildData {
+	const BVHTree *tree;
+	BVHNode *branches_array;
+	BVHNode **leafs_array;
+
+	/* leafs of each branch */
+	const BVHSahRange *ranges;
+	/* leafs of the children of the branches on the current level */
+	BVHSahRange *child_ranges;
+	int level_begin;
+} BVHSahBuildData;
+
+static void bvh_sah_div_nodes_task_cb(void *userdata, const int j)
+{
+	BVHSahBuildData *data = userdata;
+	const int tree_type = data->tree->tree_type;
+	BVHNode *parent = &data->branches_array[j];
+	BVHSahRange *child_ranges = &data->child_ranges[(j - data->level_begin) * tree_type];
+	BVHSahCluster clusters[MAX_TREETYPE];
+	int clusters_len = 1;
+	int k;
+
+	refit_kdop_hull(data->tree, parent, data->ranges[j].begin, data->ranges[j].end);
+
+	clusters[0].begin = data->ranges[j].begin;
+	clusters[0].end = data->ranges[j].end;
+	memcpy(clusters[0].bv, parent->bv, sizeof(clusters[0].bv));
+
+	/* split the largest cluster until there is one per child */
+	while (clusters_len < tree_type) {
+		float area_best = -1.0f;
+		int k_best = -1;
+
+		for (k = 0; k < clusters_len; k++) {
+			if (clusters[k].end - clusters[k].begin > 1) {
+				const float area = sah_bounds_area(clusters[k].bv);
+				if (area > area_best) {
+					area_best = area;
+					k_best = k;
+				}
+			}
+		}
+
+		if (k_best == -1) {
+			break;
+		}
+		else {
+			BVHSahCluster *cluster = &clusters[k_best];
+			BVHSahCluster *cluster_new = &clusters[clusters_len++];
+
+			cluster_new->end = cluster->end;
+			cluster_new->begin = cluster->end = bvh_sah_split(
+			        data->leafs_array, cluster->begin, cluster->end, cluster->bv, cluster_new->bv);
+		}
+	}
+
+	/* Unlike the implicit tree the split axis isn't always the largest one,
+	 * use the axis the children are spread the most along as main axis. */
+	{
+		float center_bv[6];
+		sah_bounds_init(center_bv);
+		for (k = 0; k < clusters_len; k++) {
+			int axis;
+			for (axis = 0; axis < 3; axis++) {
+				const float center = clusters[k].bv[2 * axis] + clusters[k].bv[2 * axis + 1];
+				if (center < center_bv[2 * axis]) center_bv[2 * axis] = center;
+				if (center > center_bv[2 * axis + 1]) center_bv[2 * axis + 1] = center;
+			}
+		}
+		parent->main_axis = get_largest_axis(center_bv) / 2;
+	}
+
+	/* order the children along the main axis, #dfs_raycast relies on it to dive in the nearest child first */
+	for (k = 1; k < clusters_len; k++) {
+		const int axis = parent->main_axis;
+		BVHSahCluster cluster = clusters[k];
+		const float center = cluster.bv[2 * axis] + cluster.bv[2 * axis + 1];
+		int i = k;
+
+		while (i > 0 && (clusters[i - 1].bv[2 * axis] + clusters[i - 1].bv[2 * axis + 1]) > center) {
+			clusters[i] = clusters[i - 1];
+			i--;
+		}
+		clusters[i] = cluster;
+	}
+
+	/* branch children are linked once all the branches of this level are numbered */
+	for (k = 0; k < tree_type; k++) {
+		if (k < clusters_len) {
+			child_ranges[k].begin = clusters[k].begin;
+			child_ranges[k].end = clusters[k].end;
+
+			if (clusters[k].end - clusters[k].begin == 1) {
+				parent->children[k] = data->leafs_array[clusters[k].begin];
+				parent->children[k]->parent = parent;
+				continue;
+			}
+		}
+		parent->children[k] = NULL;
+	}
+	parent->totnode = (char)clusters_len;
+}
+
+/**
+ * Make sure the node arrays can hold the (at most ``totleaf - 1``) branches of the SAH tree,
+ * only needed for trees with more than 2 children, since the implicit tree packs the leafs tighter.
+ */
+static void bvhtree_sah_ensure_nodes(BVHTree *tree)
+{
+	const int numnodes = tree->totleaf + (tree->totleaf - 1) + tree->tree_type;
+	int i;
+
+	if (MEM_allocN_len(tree->nodearray) / sizeof(BVHNode) >= (size_t)numnodes) {
+		return;
+	}
+
+	tree->nodes = MEM_recallocN(tree->nodes, sizeof(BVHNode *) * (size_t)numnodes);
+	tree->nodebv = MEM_recallocN(tree->nodebv, sizeof(float) * (size_t)(tree->axis * numnodes));
+	tree->nodechild = MEM_recallocN(tree->nodechild, sizeof(BVHNode *) * (size_t)(tree->tree_type * numnodes));
+	tree->nodearray = MEM_recallocN(tree->nodearray, sizeof(BVHNode) * (size_t)numnodes);
+
+	/* re-link, no branches exist yet and leafs are still in insertion order */
+	for (i = 0; i < numnodes; i++) {
+		tree->nodearray[i].bv = &tree->nodebv[i * tree->axis];
+		tree->nodearray[i].children = &tree->nodechild[i * tree->tree_type];
+	}
+	for (i = 0; i < tree->totleaf; i++) {
+		tree->nodes[i] = &tree->nodearray[i];
+	}
+}
+
+static void bvhtree_sah_build(BVHTree *tree)
+{
+	const int tree_type = tree->tree_type;
+	BVHSahRange *ranges, *child_ranges;
+	BVHNode *branches_array;
+	int level_begin, level_end;
+	int child_ranges_len;
+	int i;
+
+	BLI_assert(tree->totleaf > 1 && tree->start_axis == 0);
+
+	bvhtree_sah_ensure_nodes(tree);
+
+	branches_array = tree->nodearray + tree->totleaf;
+
+	ranges = MEM_mallocN(sizeof(*ranges) * (size_t)(tree->totleaf - 1), __func__);
+	child_ranges_len = tree_type;
+	child_ranges = MEM_mallocN(sizeof(*child_ranges) * (size_t)child_ranges_len, __func__);
+
+	ranges[0].begin = 0;
+	ranges[0].end = tree->totleaf;
+	branches_array[0].parent = NULL;
+	tree->totbranch = 1;
+
+	BVHSahBuildData cb_data = {
+		.tree = tree, .branches_array = branches_array, .leafs_array = tree->nodes,
+		.ranges = ranges, .child_ranges = NULL, .level_begin = 0,
+	};
+
+	/* Loop tree levels (log N) loops */
+	for (level_begin = 0, level_end = 1; level_begin != level_end; level_begin = level_end, level_end = tree->totbranch) {
+		const int level_len = level_end - level_begin;
+
+		if (child_ranges_len < level_len * tree_type) {
+			child_ranges_len = level_len * tree_type;
+			child_ranges = MEM_reallocN(child_ranges, sizeof(*child_ranges) * (size_t)child_ranges_len);
+		}
+
+		cb_data.child_ranges = child_ranges;
+		cb_data.level_begin = level_begin;
+
+		BLI_task_parallel_range(
+		        level_begin, level_end, &cb_data, bvh_sah_div_nodes_task_cb,
+		        tree->totleaf > KDOPBVH_THREAD_LEAF_THRESHOLD);
+
+		/* number the branches of the next level */
+		for (i = level_begin; i < level_end; i++) {
+			BVHNode *parent = &branches_array[i];
+			const BVHSahRange *parent_child_ranges = &child_ranges[(i - level_begin) * tree_type];
+			int k;
+
+			for (k = 0; k < parent->totnode; k++) {
+				if (parent_child_ranges[k].end - parent_child_ranges[k].begin > 1) {
+					BLI_assert(tree->totbranch < tree->totleaf - 1);
+					ranges[tree->totbranch] = parent_child_ranges[k];
+					parent->children[k] = &branches_array[tree->totbranch];
+					parent->children[k]->parent = parent;
+					tree->totbranch++;
+				}
+			}
+		}
+	}
+
+	MEM_freeN(ranges);
+	MEM_freeN(child_ranges);
+
+	/* current code expects the branches to be linked to the nodes array
+	 * we perform that linkage here */
+	for (i = 0; i < tree->totbranch; i++) {
+		tree->nodes[tree->totleaf + i] = branches_array + i;
+	}
+}
+
+/** \} */
+
+
+#ifdef USE_KDOPBVH_SIMD
+
+/* -------------------------------------------------------------------- */
+
+/** \name SIMD Child Bounds
+ *
+ * The X/Y/Z bounds of the children of each branch are stored together,
+ * as groups of 4 children (xmin[4], xmax[4], ymin[4], ymax[4], zmin[4], zmax[4]),
+ * so a ray can be tested against 4 children at once, see #dfs_raycast_simd.
+ * Only used for trees with 4 or 8 children which include the X/Y/Z axes.
+ * \{ */
+
+#define SIMD_GROUP_FLOATS (6 * 4)
+
+static void bvhtree_simd_pack(BVHTree *tree)
+{
+	const int groups = tree->tree_type / 4;
+	int i;
+
+	if ((tree->tree_type % 4) != 0 || tree->start_axis != 0 || tree->totbranch == 0) {
+		return;
+	}
+
+	if (tree->nodebv_simd == NULL) {
+		tree->nodebv_simd = MEM_mallocN_aligned(
+		        sizeof(float) * SIMD_GROUP_FLOATS * (size_t)(groups * tree->totbranch), 16, "BVHNodeBVSimd");
+	}
+
+	for (i = 0; i < tree->totbranch; i++) {
+		const BVHNode *node = tree->nodes[tree->totleaf + i];
+		float *bv_simd = &tree->nodebv_simd[(size_t)(i * groups) * SIMD_GROUP_FLOATS];
+		int k, j;
+
+		BLI_assert(node == &tree->nodearray[tree->totleaf + i]);
+
+		for (k = 0; k < tree->tree_type; k++) {
+			float *bv_group = &bv_simd[(k / 4) * SIMD_GROUP_FLOATS];
+			const int lane = k % 4;
+
+			if (k < node->totnode) {
+				for (j = 0; j < 6; j++) {
+					bv_group[j * 4 + lane] = node->children[k]->bv[j];
+				}
+			}
+			else {
+				/* inverted bounds never hit */
+				for (j = 0; j < 6; j += 2) {
+					bv_group[j * 4 + lane] = FLT_MAX;
+					bv_group[(j + 1) * 4 + lane] = -FLT_MAX;
+				}
+			}
+		}
+	}
+}
+
+/** \} */
+
+#endif  /* USE_KDOPBVH_SIMD */
+
 
 /* -------------------------------------------------------------------- */
 
@@ -1050,11 +1505,16 @@ void BLI_bvhtree_free(BVHTree *tree)
 		MEM_freeN(tree->nodearray);
 		MEM_freeN(tree->nodebv);
 		MEM_freeN(tree->nodechild);
+		MEM_SAFE_FREE(tree->nodebv_simd);
 		MEM_freeN(tree);
 	}
 }
 
-void BLI_bvhtree_balance(BVHTree *tree)
+/**
+ * \param flag: #BVH_BALANCE_SAH to split the leafs using the surface area heuristic
+ * instead of building an implicit tree (ignored for trees without X/Y/Z axes).
+ */
+void BLI_bvhtree_balance_ex(BVHTree *tree, const int flag)
 {
 	int i;
 
@@ -1065,14 +1525,23 @@ void BLI_bvhtree_balance(BVHTree *tree)
 	 * (some big bug goes here if its being called more than once per tree) */
 	BLI_assert(tree->totbranch == 0);
 
-	/* Build the implicit tree */
-	non_recursive_bvh_div_nodes(tree, branches_array, leafs_array, tree->totleaf);
+	if ((flag & BVH_BALANCE_SAH) && (tree->start_axis == 0) && (tree->totleaf > 1)) {
+		bvhtree_sah_build(tree);
+	}
+	else {
+		/* Build the implicit tree */
+		non_recursive_bvh_div_nodes(tree, branches_array, leafs_array, tree->totleaf);
 
-	/* current code expects the branches to be linked to the nodes array
-	 * we perform that linkage here */
-	tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
-	for (i = 0; i < tree->totbranch; i++)
-		tree->nodes[tree->totleaf + i] = branches_array + i;
+		/* current code expects the branches to be linked to the nodes array
+		 * we perform that linkage here */
+		tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
+		for (i = 0; i < tree->totbranch; i++)
+			tree->nodes[tree->totleaf + i] = branches_array + i;
+	}
+
+#ifdef USE_KDOPBVH_SIMD
+	bvhtree_simd_pack(tree);
+#endif
 
 #ifdef USE_SKIP_LINKS
 	build_skip_links(tree, tree->nodes[tree->totleaf], NULL, NULL);
@@ -1087,6 +1556,11 @@ void BLI_bvhtree_balance(BVHTree *tree)
 #endif
 }
 
+void BLI_bvhtree_balance(BVHTree *tree)
+{
+	BLI_bvhtree_balance_ex(tree, 0);
+}
+
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints)
 {
 	axis_t axis_iter;
@@ -1148,6 +1622,12 @@ void BLI_bvhtree_update_tree(BVHTree *tree)
 
 	for (; index >= root; index--)
 		node_join(tree, *index);
+
+#ifdef USE_KDOPBVH_SIMD
+	if (tree->nodebv_simd) {
+		bvhtree_simd_pack(tree);
+	}
+#endif
 }
 /**
  * Number of times #BLI_bvhtree_insert has been called.
@@ -1708,6 +2188,94 @@ static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
 	}
 }
 
+#ifdef USE_KDOPBVH_SIMD
+/**
+ * Same as #dfs_raycast (without radius support), except the ray is tested against
+ * 4 children at once using #BVHTree.nodebv_simd, the children which are hit
+ * are visited nearest first.
+ *
+ * \note \a node must be a branch which is known to be hit by the ray.
+ */
+static void dfs_raycast_simd(BVHRayCastData *data, const BVHNode *node)
+{
+	const BVHTree *tree = data->tree;
+	const int groups = tree->tree_type / 4;
+	const float *bv_simd = &tree->nodebv_simd[(size_t)((node - tree->nodearray - tree->totleaf) * groups) *
+	                                          SIMD_GROUP_FLOATS];
+	float dist[MAX_TREETYPE];
+	int order[MAX_TREETYPE];
+	int order_len = 0;
+	int g, i;
+
+	const __m128 origin_x = _mm_set1_ps(data->ray.origin[0]);
+	const __m128 origin_y = _mm_set1_ps(data->ray.origin[1]);
+	const __m128 origin_z = _mm_set1_ps(data->ray.origin[2]);
+	const __m128 idot_x = _mm_set1_ps(data->idot_axis[0]);
+	const __m128 idot_y = _mm_set1_ps(data->idot_axis[1]);
+	const __m128 idot_z = _mm_set1_ps(data->idot_axis[2]);
+	const __m128 hit_dist = _mm_set1_ps(data->hit.dist);
+
+	for (g = 0; g < groups; g++) {
+		const __m128 *bv = (const __m128 *)&bv_simd[g * SIMD_GROUP_FLOATS];
+		const __m128 t1x = _mm_mul_ps(_mm_sub_ps(bv[data->index[0]], origin_x), idot_x);
+		const __m128 t2x = _mm_mul_ps(_mm_sub_ps(bv[data->index[1]], origin_x), idot_x);
+		const __m128 t1y = _mm_mul_ps(_mm_sub_ps(bv[data->index[2]], origin_y), idot_y);
+		const __m128 t2y = _mm_mul_ps(_mm_sub_ps(bv[data->index[3]], origin_y), idot_y);
+		const __m128 t1z = _mm_mul_ps(_mm_sub_ps(bv[data->index[4]], origin_z), idot_z);
+		const __m128 t2z = _mm_mul_ps(_mm_sub_ps(bv[data->index[5]], origin_z), idot_z);
+		const __m128 t_near = _mm_max_ps(_mm_max_ps(t1x, t1y), t1z);
+		const __m128 t_far = _mm_min_ps(_mm_min_ps(t2x, t2y), t2z);
+		const __m128 mask = _mm_and_ps(
+		        _mm_and_ps(_mm_cmple_ps(t_near, t_far), _mm_cmpge_ps(t_far, _mm_setzero_ps())),
+		        _mm_cmplt_ps(t_near, hit_dist));
+		const int hit_mask = _mm_movemask_ps(mask);
+
+		if (hit_mask == 0) {
+			continue;
+		}
+
+		_mm_storeu_ps(&dist[g * 4], t_near);
+
+		/* insert the hits sorted by distance */
+		for (i = 0; i < 4; i++) {
+			const int k = g * 4 + i;
+			if ((hit_mask & (1 << i)) && (k < node->totnode)) {
+				int j = order_len++;
+				while (j > 0 && dist[order[j - 1]] > dist[k]) {
+					order[j] = order[j - 1];
+					j--;
+				}
+				order[j] = k;
+			}
+		}
+	}
+
+	for (i = 0; i < order_len; i++) {
+		const BVHNode *child = node->children[order[i]];
+		const float child_dist = dist[order[i]];
+
+		/* a nearer hit may have been found meanwhile */
+		if (child_dist >= data->hit.dist) {
+			break;
+		}
+
+		if (child->totnode == 0) {
+			if (data->callback) {
+				data->callback(data->userdata, child->index, &data->ray, &data->hit);
+			}
+			else {
+				data->hit.index = child->index;
+				data->hit.dist  = child_dist;
+				madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, child_dist);
+			}
+		}
+		else {
+			dfs_raycast_simd(data, child);
+		}
+	}
+}
+#endif  /* USE_KDOPBVH_SIMD */
+
 /**
  * A version of #dfs_raycast with minor changes to reset the index & dist each ray cast.
  */
@@ -1834,7 +2402,17 @@ int BLI_bvhtree_ray_cast_ex(
 	}
 
 	if (root) {
-		dfs_raycast(&data, root);
+#ifdef USE_KDOPBVH_SIMD
+		if (tree->nodebv_simd && (radius == 0.0f)) {
+			if (fast_ray_nearest_hit(&data, root) < data.hit.dist) {
+				dfs_raycast_simd(&data, root);
+			}
+		}
+		else
+#endif
+		{
+			dfs_raycast(&data, root);
+		}
 //		iterative_raycast(&data, root);
 	}
 
@@ -25,10 +25,13 @@
  *  \ingroup bli
  */
 
+#include <stdlib.h>
+
 #include "MEM_guardedalloc.h"
 
 #include "BLI_math.h"
 #include "BLI_kdtree.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLI_strict_flags.h"
 
@@ -61,6 +64,15 @@ struct KDTree {
 
 #define KD_NODE_UNSET ((unsigned int)-1)
 
+/* Balancing and batched queries only use threads above these sizes. */
+#define KD_THREAD_BALANCE_THRESHOLD 10000
+#define KD_THREAD_QUERY_THRESHOLD 1024
+/* Levels of the tree split level by level before the subtrees are balanced in parallel,
+ * (1 << KD_THREAD_BALANCE_LEVELS) subtrees are left. */
+#define KD_THREAD_BALANCE_LEVELS 8
+/* Number of queries handled by one task of the batched queries. */
+#define KD_QUERY_CHUNK_SIZE 256
+
 /**
  * Creates or free a kdtree
  */
@@ -113,18 +125,15 @@ void BLI_kdtree_insert(KDTree *tree, int index, const float co[3])
 #endif
 }
 
-static unsigned int kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsigned int axis, const unsigned int ofs)
+/**
+ * Quicksort style sorting around the median on \a axis,
+ * only the median is at its sorted position afterwards.
+ */
+static unsigned int kdtree_balance_partition(KDTreeNode *nodes, unsigned int totnode, unsigned int axis)
 {
-	KDTreeNode *node;
 	float co;
 	unsigned int left, right, median, i, j;
 
-	if (totnode <= 0)
-		return KD_NODE_UNSET;
-	else if (totnode == 1)
-		return 0 + ofs;
-	
-	/* quicksort style sorting around median */
 	left = 0;
 	right = totnode - 1;
 	median = totnode / 2;
@@ -151,6 +160,29 @@ static unsigned int kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsi
 			left = i + 1;
 	}
 
+	return median;
+}
+
+/**
+ * The index of the root of a balanced subtree is known before balancing it.
+ */
+BLI_INLINE unsigned int kdtree_balance_root(unsigned int totnode, const unsigned int ofs)
+{
+	return (totnode == 0) ? KD_NODE_UNSET : (totnode / 2) + ofs;
+}
+
+static unsigned int kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsigned int axis, const unsigned int ofs)
+{
+	KDTreeNode *node;
+	unsigned int median;
+
+	if (totnode <= 0)
+		return KD_NODE_UNSET;
+	else if (totnode == 1)
+		return 0 + ofs;
+
+	median = kdtree_balance_partition(nodes, totnode, axis);
+
 	/* set node and sort subnodes */
 	node = &nodes[median];
 	node->d = axis;
@@ -161,9 +193,99 @@ static unsigned int kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsi
 	return median + ofs;
 }
 
+/* -------------------------------------------------------------------- */
+/* Threaded balancing
+ *
+ * The top levels are split level by level, each level partitioning all its subtrees in parallel,
+ * then the remaining subtrees are balanced in parallel. The result is the same as #kdtree_balance. */
+
+typedef struct KDTreeBalanceRange {
+	unsigned int ofs, totnode;
+} KDTreeBalanceRange;
+
+typedef struct KDTreeBalanceData {
+	KDTreeNode *nodes;
+	const KDTreeBalanceRange *ranges;
+	KDTreeBalanceRange *ranges_next;
+	unsigned int axis;
+} KDTreeBalanceData;
+
+static void kdtree_balance_level_cb(void *userdata, const int i)
+{
+	KDTreeBalanceData *data = userdata;
+	const KDTreeBalanceRange *range = &data->ranges[i];
+	KDTreeBalanceRange *range_left = &data->ranges_next[i * 2];
+	KDTreeBalanceRange *range_right = &data->ranges_next[i * 2 + 1];
+
+	if (range->totnode <= 1) {
+		/* Leaf or empty, nothing left to split. */
+		*range_left = *range;
+		range_right->ofs = range->ofs;
+		range_right->totnode = 0;
+		return;
+	}
+
+	const unsigned int median = kdtree_balance_partition(&data->nodes[range->ofs], range->totnode, data->axis);
+	KDTreeNode *node = &data->nodes[range->ofs + median];
+
+	range_left->ofs = range->ofs;
+	range_left->totnode = median;
+	range_right->ofs = range->ofs + median + 1;
+	range_right->totnode = range->totnode - (median + 1);
+
+	node->d = data->axis;
+	node->left = kdtree_balance_root(range_left->totnode, range_left->ofs);
+	node->right = kdtree_balance_root(range_right->totnode, range_right->ofs);
+}
+
+static void kdtree_balance_subtree_cb(void *userdata, const int i)
+{
+	KDTreeBalanceData *data = userdata;
+	const KDTreeBalanceRange *range = &data->ranges[i];
+
+	if (range->totnode > 1) {
+		kdtree_balance(&data->nodes[range->ofs], range->totnode, data->axis, range->ofs);
+	}
+}
+
+static unsigned int kdtree_balance_threaded(KDTreeNode *nodes, unsigned int totnode)
+{
+	KDTreeBalanceRange *ranges = MEM_mallocN(sizeof(*ranges) << KD_THREAD_BALANCE_LEVELS, __func__);
+	KDTreeBalanceRange *ranges_next = MEM_mallocN(sizeof(*ranges) << KD_THREAD_BALANCE_LEVELS, __func__);
+	KDTreeBalanceData data = {.nodes = nodes, .axis = 0};
+	unsigned int level, ranges_len = 1;
+
+	ranges[0].ofs = 0;
+	ranges[0].totnode = totnode;
+
+	for (level = 0; level < KD_THREAD_BALANCE_LEVELS; level++) {
+		data.ranges = ranges;
+		data.ranges_next = ranges_next;
+
+		BLI_task_parallel_range(0, (int)ranges_len, &data, kdtree_balance_level_cb, true);
+
+		SWAP(KDTreeBalanceRange *, ranges, ranges_next);
+		ranges_len *= 2;
+		data.axis = (data.axis + 1) % 3;
+	}
+
+	data.ranges = ranges;
+	BLI_task_parallel_range(0, (int)ranges_len, &data, kdtree_balance_subtree_cb, true);
+
+	MEM_freeN(ranges);
+	MEM_freeN(ranges_next);
+
+	return kdtree_balance_root(totnode, 0);
+}
+
 void BLI_kdtree_balance(KDTree *tree)
 {
-	tree->root = kdtree_balance(tree->nodes, tree->totnode, 0, 0);
+	if (tree->totnode > KD_THREAD_BALANCE_THRESHOLD) {
+		tree->root = kdtree_balance_threaded(tree->nodes, tree->totnode);
+	}
+	else {
+		tree->root = kdtree_balance(tree->nodes, tree->totnode, 0, 0);
+	}
 
 #ifdef DEBUG
 	tree->is_balanced = true;
@@ -674,3 +796,173 @@ finally:
 	if (stack != defaultstack)
 		MEM_freeN(stack);
 }
+
+/* -------------------------------------------------------------------- */
+/* Batched queries
+ *
+ * Queries are visited in Morton order, so consecutive queries (handled by the same thread)
+ * traverse mostly the same nodes, which are likely still in the cache. */
+
+typedef struct KDTreeQueryOrder {
+	unsigned int code;
+	unsigned int index;
+} KDTreeQueryOrder;
+
+typedef struct KDTreeBatchData {
+	const KDTree *tree;
+	const float (*co)[3];
+	const KDTreeQueryOrder *order;
+	unsigned int co_num;
+
+	KDTreeNearest *r_nearest;
+	int *r_found;
+	unsigned int n;
+} KDTreeBatchData;
+
+/* Spread the lower 10 bits of \a x, two zero bits between each. */
+BLI_INLINE unsigned int kdtree_morton_expand(unsigned int x)
+{
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x <<  8)) & 0x0300f00f;
+	x = (x | (x <<  4)) & 0x030c30c3;
+	x = (x | (x <<  2)) & 0x09249249;
+	return x;
+}
+
+static int kdtree_query_order_cmp(const void *a_v, const void *b_v)
+{
+	const KDTreeQueryOrder *a = a_v, *b = b_v;
+
+	if (a->code < b->code)
+		return -1;
+	else if (a->code > b->code)
+		return 1;
+	else
+		return 0;
+}
+
+/**
+ * \return the queries order, sorted along a Morton curve over their bounds.
+ */
+static KDTreeQueryOrder *kdtree_query_order(const float (*co)[3], unsigned int co_num)
+{
+	KDTreeQueryOrder *order = MEM_mallocN(sizeof(*order) * co_num, __func__);
+	float min[3], max[3], scale[3];
+	unsigned int i;
+
+	INIT_MINMAX(min, max);
+	for (i = 0; i < co_num; i++) {
+		minmax_v3v3_v3(min, max, co[i]);
+	}
+
+	for (i = 0; i < 3; i++) {
+		const float size = max[i] - min[i];
+		scale[i] = (size > 0.0f) ? 1023.0f / size : 0.0f;
+	}
+
+	for (i = 0; i < co_num; i++) {
+		unsigned int code = 0, axis;
+
+		for (axis = 0; axis < 3; axis++) {
+			const unsigned int x = MIN2((unsigned int)((co[i][axis] - min[axis]) * scale[axis]), 1023u);
+			code |= kdtree_morton_expand(x) << (2 - axis);
+		}
+
+		order[i].code = code;
+		order[i].index = i;
+	}
+
+	qsort(order, co_num, sizeof(*order), kdtree_query_order_cmp);
+
+	return order;
+}
+
+static void kdtree_find_nearest_batch_cb(void *userdata, const int chunk)
+{
+	KDTreeBatchData *data = userdata;
+	const unsigned int start = (unsigned int)chunk * KD_QUERY_CHUNK_SIZE;
+	const unsigned int end = MIN2(start + KD_QUERY_CHUNK_SIZE, data->co_num);
+	unsigned int i;
+
+	for (i = start; i < end; i++) {
+		const unsigned int index = data->order[i].index;
+		KDTreeNearest *nearest = &data->r_nearest[index];
+
+		if (BLI_kdtree_find_nearest(data->tree, data->co[index], nearest) == -1) {
+			nearest->index = -1;
+		}
+	}
+}
+
+static void kdtree_find_nearest_n_batch_cb(void *userdata, const int chunk)
+{
+	KDTreeBatchData *data = userdata;
+	const unsigned int start = (unsigned int)chunk * KD_QUERY_CHUNK_SIZE;
+	const unsigned int end = MIN2(start + KD_QUERY_CHUNK_SIZE, data->co_num);
+	unsigned int i;
+
+	for (i = start; i < end; i++) {
+		const unsigned int index = data->order[i].index;
+		const int found = BLI_kdtree_find_nearest_n(
+		        data->tree, data->co[index], &data->r_nearest[(size_t)index * data->n], data->n);
+
+		if (data->r_found) {
+			data->r_found[index] = found;
+		}
+	}
+}
+
+static void kdtree_query_batch(
+        KDTreeBatchData *data, TaskParallelRangeFunc func)
+{
+	const int chunks = (int)((data->co_num + KD_QUERY_CHUNK_SIZE - 1) / KD_QUERY_CHUNK_SIZE);
+
+	data->order = kdtree_query_order(data->co, data->co_num);
+
+	BLI_task_parallel_range(0, chunks, data, func, data->co_num > KD_THREAD_QUERY_THRESHOLD);
+
+	MEM_freeN((void *)data->order);
+}
+
+/**
+ * Find the nearest point of every coordinate in \a co, the queries are spread over threads.
+ *
+ * \param r_nearest  An array sized \a co_num, index is -1 when nothing was found.
+ */
+void BLI_kdtree_find_nearest_batch(
+        const KDTree *tree, const float (*co)[3], unsigned int co_num,
+        KDTreeNearest *r_nearest)
+{
+	KDTreeBatchData data = {
+		.tree = tree, .co = co, .co_num = co_num,
+		.r_nearest = r_nearest,
+	};
+
+	if (co_num == 0)
+		return;
+
+	kdtree_query_batch(&data, kdtree_find_nearest_batch_cb);
+}
+
+/**
+ * Batched version of #BLI_kdtree_find_nearest_n.
+ *
+ * \param r_nearest  An array sized \a co_num * \a n, the results of each query are contiguous.
+ * \param r_found  Optional array sized \a co_num, the number of points found by each query.
+ */
+void BLI_kdtree_find_nearest_n_batch(
+        const KDTree *tree, const float (*co)[3], unsigned int co_num,
+        KDTreeNearest *r_nearest, int *r_found,
+        unsigned int n)
+{
+	KDTreeBatchData data = {
+		.tree = tree, .co = co, .co_num = co_num,
+		.r_nearest = r_nearest, .r_found = r_found, .n = n,
+	};
+
+	if (co_num == 0)
+		return;
+
+	kdtree_query_batch(&data, kdtree_find_nearest_n_batch_cb);
+}
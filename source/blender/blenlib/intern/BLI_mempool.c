@@ -36,6 +36,8 @@
  * - Freeing chunks.
  * - Iterating over allocated chunks
  *   (optionally when using the #BLI_MEMPOOL_ALLOW_ITER flag).
+ * - Allocating and freeing from multiple threads
+ *   (optionally when using the #BLI_MEMPOOL_CONCURRENT flag).
  */
 
 #include <string.h>
@@ -47,6 +49,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_strict_flags.h"  /* keep last */
 
 #ifdef WITH_MEM_VALGRIND
@@ -118,6 +122,33 @@ typedef struct BLI_mempool_chunk {
 #endif
 } BLI_mempool_chunk;
 
+#define MEMPOOL_CACHE_LINE_SIZE 64
+
+/**
+ * Per thread cache of a #BLI_MEMPOOL_CONCURRENT pool.
+ *
+ * Each thread allocates from its own chunks, elements are returned to the thread owning
+ * their chunk. Elements freed by other threads are pushed onto \a free_remote without locking,
+ * the owner takes the whole list back once its own free list is empty.
+ */
+typedef struct BLI_mempool_thread {
+	BLI_freenode *free;         /* only accessed by the owning thread */
+	BLI_freenode *free_remote;  /* atomic, elements freed by other threads */
+	int totused;                /* allocated minus freed by this thread, can be negative */
+	/* avoid false sharing between threads, the array is allocated cache line aligned */
+	char _pad[MEMPOOL_CACHE_LINE_SIZE - (2 * sizeof(void *)) - sizeof(int)];
+} BLI_mempool_thread;
+
+BLI_STATIC_ASSERT(sizeof(BLI_mempool_thread) == MEMPOOL_CACHE_LINE_SIZE, "BLI_mempool_thread must fill a cache line")
+
+typedef struct BLI_mempool_concurrent {
+	BLI_mempool_thread *threads;
+	unsigned int thread_num;
+	/* protects appending to #BLI_mempool.chunks,
+	 * an atomic spin-lock since this file is also used without BLI_threads (makesdna) */
+	uint32_t chunk_lock;
+} BLI_mempool_concurrent;
+
 /**
  * The mempool, stores and tracks memory \a chunks and elements within those chunks \a free.
  */
@@ -136,6 +167,7 @@ struct BLI_mempool {
 	BLI_freenode *free;         /* free element list. Interleaved into chunk datas. */
 	unsigned int maxchunks;     /* use to know how many chunks to keep for BLI_mempool_clear */
 	unsigned int totused;       /* number of elements currently in use */
+	BLI_mempool_concurrent *concurrent;  /* only for #BLI_MEMPOOL_CONCURRENT */
 #ifdef USE_TOTALLOC
 	unsigned int totalloc;          /* number of elements allocated in total */
 #endif
@@ -143,6 +175,10 @@ struct BLI_mempool {
 
 #define MEMPOOL_ELEM_SIZE_MIN (sizeof(void *) * 2)
 
+/* concurrent pools store the thread owning the chunk after each element */
+#define MEMPOOL_ELEM_OWNER_SIZE ((unsigned int)sizeof(intptr_t))
+#define ELEM_OWNER(pool, elem)  (*(intptr_t *)((char *)(elem) + (pool)->esize - MEMPOOL_ELEM_OWNER_SIZE))
+
 #ifdef USE_DATA_PTR
 #  define CHUNK_DATA(chunk) (chunk)->_data
 #else
@@ -192,6 +228,28 @@ BLI_INLINE unsigned int mempool_maxchunks(const unsigned int totelem, const unsi
 	return (totelem <= pchunk) ? 1 : ((totelem / pchunk) + 1);
 }
 
+/**
+ * \return the element size as requested on creation (without the owner of concurrent pools).
+ */
+BLI_INLINE unsigned int mempool_elem_size(const BLI_mempool *pool)
+{
+	return (pool->flag & BLI_MEMPOOL_CONCURRENT) ? pool->esize - MEMPOOL_ELEM_OWNER_SIZE : pool->esize;
+}
+
+static unsigned int mempool_count(const BLI_mempool *pool)
+{
+	if (pool->flag & BLI_MEMPOOL_CONCURRENT) {
+		int totused = 0;
+		unsigned int i;
+		for (i = 0; i < pool->concurrent->thread_num; i++) {
+			totused += pool->concurrent->threads[i].totused;
+		}
+		BLI_assert(totused >= 0);
+		return (unsigned int)totused;
+	}
+	return pool->totused;
+}
+
 static BLI_mempool_chunk *mempool_chunk_alloc(BLI_mempool *pool)
 {
 	BLI_mempool_chunk *mpchunk;
@@ -270,6 +328,84 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool, BLI_mempool_chunk *mpc
 	return curnode;
 }
 
+/**
+ * Initialize a chunk of a concurrent pool, owned by \a thread_id, and add it into \a pool->chunks
+ *
+ * \param free_next  The free list to append after the elements of this chunk.
+ * \return The first element of the chunk.
+ */
+static BLI_freenode *mempool_chunk_add_thread(BLI_mempool *pool, BLI_mempool_chunk *mpchunk,
+                                              const int thread_id, BLI_freenode *free_next)
+{
+	BLI_mempool_concurrent *concurrent = pool->concurrent;
+	const unsigned int esize = pool->esize;
+	BLI_freenode *curnode = CHUNK_DATA(mpchunk);
+	unsigned int j;
+
+	/* loop through the allocated data, building the pointer structures */
+	j = pool->pchunk;
+	while (j--) {
+		curnode->next = j ? NODE_STEP_NEXT(curnode) : free_next;
+		if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+			curnode->freeword = FREEWORD;
+		}
+		ELEM_OWNER(pool, curnode) = thread_id;
+		curnode = NODE_STEP_NEXT(curnode);
+	}
+
+	/* append, other threads may be adding chunks too */
+	mpchunk->next = NULL;
+
+	while (atomic_cas_uint32(&concurrent->chunk_lock, 0, 1) != 0) {
+		/* pass */
+	}
+	if (pool->chunk_tail) {
+		pool->chunk_tail->next = mpchunk;
+	}
+	else {
+		BLI_assert(pool->chunks == NULL);
+		pool->chunks = mpchunk;
+	}
+	pool->chunk_tail = mpchunk;
+	atomic_cas_uint32(&concurrent->chunk_lock, 1, 0);
+
+	return CHUNK_DATA(mpchunk);
+}
+
+/**
+ * Push an element freed by another thread, without locking.
+ */
+static void mempool_free_remote_push(BLI_mempool_thread *thread, BLI_freenode *node)
+{
+	size_t head = atomic_cas_z((size_t *)&thread->free_remote, 0, 0);
+	while (true) {
+		size_t head_prev;
+		node->next = (BLI_freenode *)head;
+		head_prev = atomic_cas_z((size_t *)&thread->free_remote, head, (size_t)node);
+		if (head_prev == head) {
+			break;
+		}
+		head = head_prev;
+	}
+}
+
+/**
+ * Take all elements freed by other threads, since the list is only ever taken as a whole
+ * there is no ABA problem.
+ */
+static BLI_freenode *mempool_free_remote_take(BLI_mempool_thread *thread)
+{
+	size_t head = atomic_cas_z((size_t *)&thread->free_remote, 0, 0);
+	while (head) {
+		const size_t head_prev = atomic_cas_z((size_t *)&thread->free_remote, head, 0);
+		if (head_prev == head) {
+			break;
+		}
+		head = head_prev;
+	}
+	return (BLI_freenode *)head;
+}
+
 static void mempool_chunk_free(BLI_mempool_chunk *mpchunk)
 {
 
@@ -289,8 +425,9 @@ static void mempool_chunk_free_all(BLI_mempool_chunk *mpchunk)
 	}
 }
 
-BLI_mempool *BLI_mempool_create(unsigned int esize, unsigned int totelem,
-                                unsigned int pchunk, unsigned int flag)
+static BLI_mempool *mempool_create(unsigned int esize, unsigned int totelem,
+                                   unsigned int pchunk, unsigned int flag,
+                                   const unsigned int thread_num)
 {
 	BLI_mempool *pool;
 	BLI_freenode *lasttail = NULL;
@@ -308,6 +445,12 @@ BLI_mempool *BLI_mempool_create(unsigned int esize, unsigned int totelem,
 		esize = MAX2(esize, (unsigned int)sizeof(BLI_freenode));
 	}
 
+	if (flag & BLI_MEMPOOL_CONCURRENT) {
+		/* keep the owner aligned */
+		esize = ((esize + MEMPOOL_ELEM_OWNER_SIZE - 1) / MEMPOOL_ELEM_OWNER_SIZE) * MEMPOOL_ELEM_OWNER_SIZE;
+		esize += MEMPOOL_ELEM_OWNER_SIZE;
+	}
+
 	maxchunks = mempool_maxchunks(totelem, pchunk);
 
 	pool->chunks = NULL;
@@ -334,12 +477,30 @@ BLI_mempool *BLI_mempool_create(unsigned int esize, unsigned int totelem,
 	pool->totalloc = 0;
 #endif
 	pool->totused = 0;
+	pool->concurrent = NULL;
+
+	if (flag & BLI_MEMPOOL_CONCURRENT) {
+		/* one cache per thread of the task scheduler, thread 0 being the main thread */
+		BLI_mempool_concurrent *concurrent = MEM_mallocN(sizeof(*concurrent), "memory pool concurrent");
+		concurrent->thread_num = thread_num;
+		concurrent->threads = MEM_mallocN_aligned(sizeof(*concurrent->threads) * concurrent->thread_num,
+		                                          MEMPOOL_CACHE_LINE_SIZE, "memory pool threads");
+		memset(concurrent->threads, 0, sizeof(*concurrent->threads) * concurrent->thread_num);
+		concurrent->chunk_lock = 0;
+		pool->concurrent = concurrent;
+	}
 
 	if (totelem) {
 		/* allocate the actual chunks */
 		for (i = 0; i < maxchunks; i++) {
 			BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
-			lasttail = mempool_chunk_add(pool, mpchunk, lasttail);
+			if (pool->concurrent) {
+				BLI_mempool_thread *thread = &pool->concurrent->threads[0];
+				thread->free = mempool_chunk_add_thread(pool, mpchunk, 0, thread->free);
+			}
+			else {
+				lasttail = mempool_chunk_add(pool, mpchunk, lasttail);
+			}
 		}
 	}
 
@@ -350,10 +511,36 @@ BLI_mempool *BLI_mempool_create(unsigned int esize, unsigned int totelem,
 	return pool;
 }
 
+BLI_mempool *BLI_mempool_create(unsigned int esize, unsigned int totelem,
+                                unsigned int pchunk, unsigned int flag)
+{
+	BLI_assert((flag & BLI_MEMPOOL_CONCURRENT) == 0);
+	return mempool_create(esize, totelem, pchunk, flag, 0);
+}
+
+/**
+ * Create a pool which can be used from multiple threads at once (see #BLI_MEMPOOL_CONCURRENT).
+ *
+ * \param thread_num: The number of threads using the pool, thread indices passed
+ * to #BLI_mempool_alloc_thread & #BLI_mempool_free_thread must be below this,
+ * typically the task scheduler thread count plus one (for the main thread).
+ */
+BLI_mempool *BLI_mempool_create_concurrent(unsigned int esize, unsigned int totelem,
+                                           unsigned int pchunk, unsigned int flag,
+                                           unsigned int thread_num)
+{
+	BLI_assert(thread_num != 0);
+	return mempool_create(esize, totelem, pchunk, flag | BLI_MEMPOOL_CONCURRENT, thread_num);
+}
+
 void *BLI_mempool_alloc(BLI_mempool *pool)
 {
 	BLI_freenode *free_pop;
 
+	if (UNLIKELY(pool->flag & BLI_MEMPOOL_CONCURRENT)) {
+		return BLI_mempool_alloc_thread(pool, 0);
+	}
+
 	if (UNLIKELY(pool->free == NULL)) {
 		/* need to allocate a new chunk */
 		BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
@@ -381,7 +568,7 @@ void *BLI_mempool_alloc(BLI_mempool *pool)
 void *BLI_mempool_calloc(BLI_mempool *pool)
 {
 	void *retval = BLI_mempool_alloc(pool);
-	memset(retval, 0, (size_t)pool->esize);
+	memset(retval, 0, (size_t)mempool_elem_size(pool));
 	return retval;
 }
 
@@ -394,6 +581,11 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 {
 	BLI_freenode *newhead = addr;
 
+	if (UNLIKELY(pool->flag & BLI_MEMPOOL_CONCURRENT)) {
+		BLI_mempool_free_thread(pool, addr, 0);
+		return;
+	}
+
 #ifndef NDEBUG
 	{
 		BLI_mempool_chunk *chunk;
@@ -411,7 +603,7 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 
 	/* enable for debugging */
 	if (UNLIKELY(mempool_debug_memset)) {
-		memset(addr, 255, pool->esize);
+		memset(addr, 255, mempool_elem_size(pool));
 	}
 #endif
 
@@ -472,16 +664,113 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 	}
 }
 
+/**
+ * Allocate an element of a #BLI_MEMPOOL_CONCURRENT pool.
+ *
+ * \param thread_id  The thread index given by the task scheduler (0 for the main thread),
+ * no two threads may use the same index at once.
+ */
+void *BLI_mempool_alloc_thread(BLI_mempool *pool, const int thread_id)
+{
+	BLI_mempool_thread *thread;
+	BLI_freenode *free_pop;
+
+	BLI_assert(pool->flag & BLI_MEMPOOL_CONCURRENT);
+	BLI_assert((unsigned int)thread_id < pool->concurrent->thread_num);
+
+	thread = &pool->concurrent->threads[thread_id];
+
+	if (UNLIKELY(thread->free == NULL)) {
+		/* take back the elements other threads have freed, before allocating a new chunk */
+		thread->free = mempool_free_remote_take(thread);
+
+		if (thread->free == NULL) {
+			BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+			thread->free = mempool_chunk_add_thread(pool, mpchunk, thread_id, NULL);
+		}
+	}
+
+	free_pop = thread->free;
+
+	BLI_assert(ELEM_OWNER(pool, free_pop) == thread_id);
+
+	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+		free_pop->freeword = USEDWORD;
+	}
+
+	thread->free = free_pop->next;
+	thread->totused++;
+
+#ifdef WITH_MEM_VALGRIND
+	VALGRIND_MEMPOOL_ALLOC(pool, free_pop, pool->esize);
+#endif
+
+	return (void *)free_pop;
+}
+
+void *BLI_mempool_calloc_thread(BLI_mempool *pool, const int thread_id)
+{
+	void *retval = BLI_mempool_alloc_thread(pool, thread_id);
+	memset(retval, 0, (size_t)mempool_elem_size(pool));
+	return retval;
+}
+
+/**
+ * Free an element of a #BLI_MEMPOOL_CONCURRENT pool,
+ * the element may have been allocated by another thread.
+ *
+ * \note unlike #BLI_mempool_free chunks are only freed on clear or destroy.
+ */
+void BLI_mempool_free_thread(BLI_mempool *pool, void *addr, const int thread_id)
+{
+	BLI_freenode *newhead = addr;
+	const intptr_t owner = ELEM_OWNER(pool, addr);
+
+	BLI_assert(pool->flag & BLI_MEMPOOL_CONCURRENT);
+	BLI_assert((unsigned int)thread_id < pool->concurrent->thread_num);
+	BLI_assert(owner >= 0 && owner < (intptr_t)pool->concurrent->thread_num);
+
+#ifndef NDEBUG
+	/* enable for debugging */
+	if (UNLIKELY(mempool_debug_memset)) {
+		memset(addr, 255, mempool_elem_size(pool));
+	}
+#endif
+
+	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+#ifndef NDEBUG
+		/* this will detect double free's */
+		BLI_assert(newhead->freeword != FREEWORD);
+#endif
+		newhead->freeword = FREEWORD;
+	}
+
+	pool->concurrent->threads[thread_id].totused--;
+
+#ifdef WITH_MEM_VALGRIND
+	VALGRIND_MEMPOOL_FREE(pool, addr);
+#endif
+
+	if (owner == thread_id) {
+		BLI_mempool_thread *thread = &pool->concurrent->threads[thread_id];
+		newhead->next = thread->free;
+		thread->free = newhead;
+	}
+	else {
+		mempool_free_remote_push(&pool->concurrent->threads[owner], newhead);
+	}
+}
+
 int BLI_mempool_count(BLI_mempool *pool)
 {
-	return (int)pool->totused;
+	return (int)mempool_count(pool);
 }
 
 void *BLI_mempool_findelem(BLI_mempool *pool, unsigned int index)
 {
 	BLI_assert(pool->flag & BLI_MEMPOOL_ALLOW_ITER);
 
-	if (index < pool->totused) {
+	if (index < mempool_count(pool)) {
 		/* we could have some faster mem chunk stepping code inline */
 		BLI_mempool_iter iter;
 		void *elem;
@@ -512,7 +801,7 @@ void BLI_mempool_as_table(BLI_mempool *pool, void **data)
 	while ((elem = BLI_mempool_iterstep(&iter))) {
 		*p++ = elem;
 	}
-	BLI_assert((unsigned int)(p - data) == pool->totused);
+	BLI_assert((unsigned int)(p - data) == mempool_count(pool));
 }
 
 /**
@@ -520,7 +809,7 @@ void BLI_mempool_as_table(BLI_mempool *pool, void **data)
  */
 void **BLI_mempool_as_tableN(BLI_mempool *pool, const char *allocstr)
 {
-	void **data = MEM_mallocN((size_t)pool->totused * sizeof(void *), allocstr);
+	void **data = MEM_mallocN((size_t)mempool_count(pool) * sizeof(void *), allocstr);
 	BLI_mempool_as_table(pool, data);
 	return data;
 }
@@ -530,7 +819,7 @@ void **BLI_mempool_as_tableN(BLI_mempool *pool, const char *allocstr)
  */
 void BLI_mempool_as_array(BLI_mempool *pool, void *data)
 {
-	const unsigned int esize = pool->esize;
+	const unsigned int esize = mempool_elem_size(pool);
 	BLI_mempool_iter iter;
 	char *elem, *p = data;
 	BLI_assert(pool->flag & BLI_MEMPOOL_ALLOW_ITER);
@@ -539,7 +828,7 @@ void BLI_mempool_as_array(BLI_mempool *pool, void *data)
 		memcpy(p, elem, (size_t)esize);
 		p = NODE_STEP_NEXT(p);
 	}
-	BLI_assert((unsigned int)(p - (char *)data) == pool->totused * esize);
+	BLI_assert((unsigned int)(p - (char *)data) == mempool_count(pool) * esize);
 }
 
 /**
@@ -547,7 +836,7 @@ void BLI_mempool_as_array(BLI_mempool *pool, void *data)
  */
 void *BLI_mempool_as_arrayN(BLI_mempool *pool, const char *allocstr)
 {
-	char *data = MEM_mallocN((size_t)(pool->totused * pool->esize), allocstr);
+	char *data = MEM_mallocN((size_t)(mempool_count(pool) * mempool_elem_size(pool)), allocstr);
 	BLI_mempool_as_array(pool, data);
 	return data;
 }
@@ -685,6 +974,18 @@ void BLI_mempool_clear_ex(BLI_mempool *pool, const int totelem_reserve)
 	pool->chunks = NULL;
 	pool->chunk_tail = NULL;
 
+	if (pool->concurrent) {
+		/* the remaining chunks are given to the main thread */
+		BLI_mempool_thread *thread = &pool->concurrent->threads[0];
+		memset(pool->concurrent->threads, 0, sizeof(*pool->concurrent->threads) * pool->concurrent->thread_num);
+
+		while ((mpchunk = chunks_temp)) {
+			chunks_temp = mpchunk->next;
+			thread->free = mempool_chunk_add_thread(pool, mpchunk, 0, thread->free);
+		}
+		return;
+	}
+
 	while ((mpchunk = chunks_temp)) {
 		chunks_temp = mpchunk->next;
 		lasttail = mempool_chunk_add(pool, mpchunk, lasttail);
@@ -706,6 +1007,11 @@ void BLI_mempool_destroy(BLI_mempool *pool)
 {
 	mempool_chunk_free_all(pool->chunks);
 
+	if (pool->concurrent) {
+		MEM_freeN(pool->concurrent->threads);
+		MEM_freeN(pool->concurrent);
+	}
+
 #ifdef WITH_MEM_VALGRIND
 	VALGRIND_DESTROY_MEMPOOL(pool);
 #endif
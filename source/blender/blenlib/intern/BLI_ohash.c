@@ -0,0 +1,1023 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenlib/intern/BLI_ohash.c
+ *  \ingroup bli
+ *
+ * A general (pointer -> pointer) open addressing hash table.
+ *
+ * Slots store the key, value and full hash inline, collisions are resolved
+ * with linear probing using Robin Hood insertion: an entry which is further
+ * from its ideal slot takes the place of one which is closer. This keeps
+ * probe sequences short and lets lookups stop as soon as they reach an entry
+ * closer to its ideal slot than the key would be. Removal shifts following
+ * entries back, so there are no tombstones.
+ *
+ * The number of slots is a power of two, and hashes are scrambled with a
+ * multiplicative (Fibonacci) hash before being reduced to a slot index, so
+ * weak hash functions like #BLI_ghashutil_ptrhash don't cluster.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_sys_types.h"  /* for intptr_t support */
+#include "BLI_utildefines.h"
+
+#include "BLI_ohash.h"
+#include "BLI_strict_flags.h"
+
+#define OHASH_SLOT_BIT_MIN 3
+#define OHASH_SLOT_BIT_MAX 31
+
+/**
+ * \note Robin Hood hashing keeps probe sequences short up to high loads,
+ * so a max load of 7/8 is used (GHash uses 3/4 with chaining).
+ * Min load is a quarter of the max load, to avoid resizing too quickly.
+ */
+#define OHASH_LIMIT_GROW(_nslots)   (((_nslots) * 7) /  8)
+#define OHASH_LIMIT_SHRINK(_nslots) (((_nslots) * 7) / 32)
+
+/* WARNING! Keep in sync with ugly _oh_Slot in header!!! */
+typedef struct OHashSlot {
+	void *key;
+	void *val;
+	unsigned int hash;
+	/* Distance to the ideal slot plus one, zero for empty slots. */
+	unsigned int dist;
+} OHashSlot;
+
+struct OHash {
+	GHashHashFP hashfp;
+	GHashCmpFP cmpfp;
+
+	OHashSlot *slots;
+	unsigned int nslots;
+	unsigned int slot_mask, slot_bit, slot_bit_min;
+	unsigned int limit_grow, limit_shrink;
+
+	unsigned int nentries;
+	unsigned int flag;
+};
+
+
+/* -------------------------------------------------------------------- */
+/* OHash API */
+
+/** \name Internal Utility API
+ * \{ */
+
+BLI_INLINE unsigned int ohash_keyhash(OHash *oh, const void *key)
+{
+	return oh->hashfp(key);
+}
+
+BLI_INLINE unsigned int ohash_slot_index(OHash *oh, const unsigned int hash)
+{
+	/* Fibonacci hashing, the high bits of the product are the best mixed. */
+	return (unsigned int)((hash * 2654435769u) >> (32u - oh->slot_bit)) & oh->slot_mask;
+}
+
+/**
+ * Place an entry which is known not to be in the table, starting at \a index
+ * where it would be \a dist away from its ideal slot.
+ *
+ * \return the slot the entry ends up in, entries it displaces are moved further.
+ */
+static OHashSlot *ohash_insert_at(
+        OHash *oh, unsigned int index, unsigned int dist,
+        void *key, void *val, const unsigned int hash)
+{
+	OHashSlot *slots = oh->slots;
+	OHashSlot *slot_inserted = NULL;
+	OHashSlot entry = {key, val, hash, dist};
+
+	for (;; index = (index + 1) & oh->slot_mask, entry.dist++) {
+		OHashSlot *slot = &slots[index];
+
+		if (slot->dist == 0) {
+			*slot = entry;
+			if (slot_inserted == NULL) {
+				slot_inserted = slot;
+			}
+			break;
+		}
+		else if (slot->dist < entry.dist) {
+			SWAP(OHashSlot, *slot, entry);
+			if (slot_inserted == NULL) {
+				slot_inserted = slot;
+			}
+		}
+	}
+
+	oh->nentries++;
+
+	return slot_inserted;
+}
+
+/**
+ * Resize the slots array, entries are placed again using their stored hash.
+ */
+static void ohash_slots_resize(OHash *oh, const unsigned int slot_bit)
+{
+	OHashSlot *slots_old = oh->slots;
+	const unsigned int nslots_old = oh->nslots;
+	const unsigned int nentries = oh->nentries;
+	unsigned int i;
+
+	BLI_assert((oh->slot_bit != slot_bit) || !oh->slots);
+
+	oh->slot_bit = slot_bit;
+	oh->nslots = 1u << slot_bit;
+	oh->slot_mask = oh->nslots - 1;
+	oh->limit_grow = OHASH_LIMIT_GROW(oh->nslots);
+	oh->limit_shrink = OHASH_LIMIT_SHRINK(oh->nslots);
+
+	oh->slots = MEM_callocN(sizeof(*oh->slots) * (size_t)oh->nslots, __func__);
+	oh->nentries = 0;
+
+	if (slots_old) {
+		for (i = 0; i < nslots_old; i++) {
+			OHashSlot *slot = &slots_old[i];
+			if (slot->dist) {
+				ohash_insert_at(oh, ohash_slot_index(oh, slot->hash), 1, slot->key, slot->val, slot->hash);
+			}
+		}
+		MEM_freeN(slots_old);
+	}
+
+	BLI_assert(oh->nentries == nentries);
+	UNUSED_VARS_NDEBUG(nentries);
+}
+
+/**
+ * Grow the slots array so it can hold \a nentries,
+ * if \a user_defined the size is kept as minimum when shrinking.
+ */
+static void ohash_slots_expand(OHash *oh, const unsigned int nentries, const bool user_defined)
+{
+	unsigned int slot_bit = oh->slot_bit;
+
+	if (LIKELY(oh->slots && (nentries <= oh->limit_grow))) {
+		return;
+	}
+
+	while ((nentries > OHASH_LIMIT_GROW(1u << slot_bit)) &&
+	       (slot_bit < OHASH_SLOT_BIT_MAX))
+	{
+		slot_bit++;
+	}
+
+	if (user_defined) {
+		oh->slot_bit_min = slot_bit;
+	}
+
+	if ((slot_bit == oh->slot_bit) && oh->slots) {
+		return;
+	}
+
+	ohash_slots_resize(oh, slot_bit);
+}
+
+static void ohash_slots_contract(OHash *oh, const unsigned int nentries, const bool user_defined)
+{
+	unsigned int slot_bit = oh->slot_bit;
+
+	if (!(user_defined || (oh->flag & OHASH_FLAG_ALLOW_SHRINK))) {
+		return;
+	}
+
+	if (LIKELY(oh->slots && (nentries > oh->limit_shrink))) {
+		return;
+	}
+
+	while ((nentries < OHASH_LIMIT_SHRINK(1u << slot_bit)) &&
+	       (slot_bit > oh->slot_bit_min))
+	{
+		slot_bit--;
+	}
+
+	if (user_defined) {
+		oh->slot_bit_min = slot_bit;
+	}
+
+	if ((slot_bit == oh->slot_bit) && oh->slots) {
+		return;
+	}
+
+	ohash_slots_resize(oh, slot_bit);
+}
+
+/**
+ * Clear and reset \a oh slots, reserve again slots for given number of entries.
+ */
+static void ohash_slots_reset(OHash *oh, const unsigned int nentries)
+{
+	MEM_SAFE_FREE(oh->slots);
+
+	oh->slot_bit = OHASH_SLOT_BIT_MIN;
+	oh->slot_bit_min = OHASH_SLOT_BIT_MIN;
+	oh->nslots = 0;
+	oh->nentries = 0;
+
+	ohash_slots_expand(oh, nentries, (nentries != 0));
+}
+
+/**
+ * Internal lookup function, returns the slot holding \a key or NULL.
+ */
+BLI_INLINE OHashSlot *ohash_lookup_slot_ex(OHash *oh, const void *key, const unsigned int hash)
+{
+	OHashSlot *slots = oh->slots;
+	unsigned int index = ohash_slot_index(oh, hash);
+	unsigned int dist;
+
+	for (dist = 1;; index = (index + 1) & oh->slot_mask, dist++) {
+		OHashSlot *slot = &slots[index];
+
+		/* An empty slot, or an entry closer to its ideal slot than the key would
+		 * be, means the key would have been placed before it. */
+		if (slot->dist < dist) {
+			return NULL;
+		}
+		else if ((slot->hash == hash) && (oh->cmpfp(key, slot->key) == false)) {
+			return slot;
+		}
+	}
+}
+
+BLI_INLINE OHashSlot *ohash_lookup_slot(OHash *oh, const void *key)
+{
+	return ohash_lookup_slot_ex(oh, key, ohash_keyhash(oh, key));
+}
+
+/**
+ * Find \a key, or the place it should be inserted at.
+ *
+ * \return the slot holding \a key, or NULL with \a r_index and \a r_dist set.
+ */
+BLI_INLINE OHashSlot *ohash_lookup_slot_or_insert_point(
+        OHash *oh, const void *key, const unsigned int hash,
+        unsigned int *r_index, unsigned int *r_dist)
+{
+	OHashSlot *slots = oh->slots;
+	unsigned int index = ohash_slot_index(oh, hash);
+	unsigned int dist;
+
+	for (dist = 1;; index = (index + 1) & oh->slot_mask, dist++) {
+		OHashSlot *slot = &slots[index];
+
+		if (slot->dist < dist) {
+			*r_index = index;
+			*r_dist = dist;
+			return NULL;
+		}
+		else if ((slot->hash == hash) && (oh->cmpfp(key, slot->key) == false)) {
+			return slot;
+		}
+	}
+}
+
+/**
+ * Remove the entry in \a slot, following entries are shifted back.
+ */
+static void ohash_remove_slot(OHash *oh, OHashSlot *slot)
+{
+	OHashSlot *slots = oh->slots;
+	unsigned int index = (unsigned int)(slot - slots);
+	unsigned int index_next = (index + 1) & oh->slot_mask;
+
+	while (slots[index_next].dist > 1) {
+		slots[index] = slots[index_next];
+		slots[index].dist--;
+		index = index_next;
+		index_next = (index_next + 1) & oh->slot_mask;
+	}
+
+	slots[index].key = NULL;
+	slots[index].val = NULL;
+	slots[index].dist = 0;
+
+	oh->nentries--;
+}
+
+BLI_INLINE void ohash_slot_free(OHashSlot *slot, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	if (keyfreefp) {
+		keyfreefp(slot->key);
+	}
+	if (valfreefp) {
+		valfreefp(slot->val);
+	}
+}
+
+static void ohash_free_cb(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	unsigned int i;
+
+	BLI_assert(keyfreefp || valfreefp);
+
+	for (i = 0; i < oh->nslots; i++) {
+		if (oh->slots[i].dist) {
+			ohash_slot_free(&oh->slots[i], keyfreefp, valfreefp);
+		}
+	}
+}
+
+BLI_INLINE void ohash_insert_ex(OHash *oh, void *key, void *val)
+{
+	const unsigned int hash = ohash_keyhash(oh, key);
+
+	BLI_assert((oh->flag & OHASH_FLAG_ALLOW_DUPES) || (ohash_lookup_slot_ex(oh, key, hash) == NULL));
+
+	ohash_slots_expand(oh, oh->nentries + 1, false);
+	ohash_insert_at(oh, ohash_slot_index(oh, hash), 1, key, val, hash);
+}
+
+/**
+ * Ensure \a key is in the table, the slot is returned in \a r_slot.
+ *
+ * \return true when the key was already present.
+ */
+BLI_INLINE bool ohash_ensure_slot(OHash *oh, const void *key, OHashSlot **r_slot)
+{
+	const unsigned int hash = ohash_keyhash(oh, key);
+	unsigned int index, dist;
+	OHashSlot *slot;
+
+	/* Grow first, the slot returned must stay valid. */
+	ohash_slots_expand(oh, oh->nentries + 1, false);
+
+	slot = ohash_lookup_slot_or_insert_point(oh, key, hash, &index, &dist);
+	if (slot) {
+		*r_slot = slot;
+		return true;
+	}
+
+	*r_slot = ohash_insert_at(oh, index, dist, (void *)key, NULL, hash);
+	return false;
+}
+
+/**
+ * Remove the entry of \a key and return it in \a r_slot, without freeing.
+ */
+BLI_INLINE bool ohash_remove_ex(OHash *oh, const void *key, OHashSlot *r_slot)
+{
+	OHashSlot *slot = ohash_lookup_slot(oh, key);
+
+	if (slot == NULL) {
+		return false;
+	}
+
+	*r_slot = *slot;
+	ohash_remove_slot(oh, slot);
+	ohash_slots_contract(oh, oh->nentries, false);
+
+	return true;
+}
+
+static OHash *ohash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+                        const unsigned int nentries_reserve)
+{
+	OHash *oh = MEM_mallocN(sizeof(*oh), info);
+
+	oh->hashfp = hashfp;
+	oh->cmpfp = cmpfp;
+
+	oh->slots = NULL;
+	oh->flag = 0;
+
+	ohash_slots_reset(oh, nentries_reserve);
+
+	return oh;
+}
+
+/** \} */
+
+
+/** \name Public API
+ * \{ */
+
+/**
+ * Creates a new, empty OHash.
+ *
+ * \param hashfp  Hash callback.
+ * \param cmpfp  Comparison callback.
+ * \param info  Identifier string for the OHash.
+ * \param nentries_reserve  Optionally reserve the number of members that the hash will hold.
+ * Use this to avoid resizing slots if the size is known or can be closely approximated.
+ * \return  An empty OHash.
+ */
+OHash *BLI_ohash_new_ex(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+                        const unsigned int nentries_reserve)
+{
+	return ohash_new(hashfp, cmpfp, info, nentries_reserve);
+}
+
+/**
+ * Wraps #BLI_ohash_new_ex with zero entries reserved.
+ */
+OHash *BLI_ohash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+	return BLI_ohash_new_ex(hashfp, cmpfp, info, 0);
+}
+
+/**
+ * Copy given OHash. Keys and values are also copied if relevant callback is provided, else pointers remain the same.
+ */
+OHash *BLI_ohash_copy(OHash *oh, GHashKeyCopyFP keycopyfp, GHashValCopyFP valcopyfp)
+{
+	OHash *oh_new = MEM_mallocN(sizeof(*oh_new), __func__);
+	unsigned int i;
+
+	*oh_new = *oh;
+	oh_new->slots = MEM_mallocN(sizeof(*oh->slots) * (size_t)oh->nslots, __func__);
+	memcpy(oh_new->slots, oh->slots, sizeof(*oh->slots) * (size_t)oh->nslots);
+
+	if (keycopyfp || valcopyfp) {
+		for (i = 0; i < oh_new->nslots; i++) {
+			OHashSlot *slot = &oh_new->slots[i];
+			if (slot->dist) {
+				if (keycopyfp) {
+					slot->key = keycopyfp(slot->key);
+				}
+				if (valcopyfp) {
+					slot->val = valcopyfp(slot->val);
+				}
+			}
+		}
+	}
+
+	return oh_new;
+}
+
+/**
+ * Reserve given amount of entries (resize \a oh accordingly if needed).
+ */
+void BLI_ohash_reserve(OHash *oh, const unsigned int nentries_reserve)
+{
+	ohash_slots_expand(oh, nentries_reserve, true);
+	ohash_slots_contract(oh, nentries_reserve, true);
+}
+
+/**
+ * \return size of the OHash.
+ */
+unsigned int BLI_ohash_size(OHash *oh)
+{
+	return oh->nentries;
+}
+
+/**
+ * Insert a key/value pair into the \a oh.
+ *
+ * \note Duplicates are not checked,
+ * the caller is expected to ensure elements are unique unless
+ * OHASH_FLAG_ALLOW_DUPES flag is set.
+ */
+void BLI_ohash_insert(OHash *oh, void *key, void *val)
+{
+	ohash_insert_ex(oh, key, val);
+}
+
+/**
+ * Inserts a new value to a key that may already be in ohash.
+ *
+ * Avoids #BLI_ohash_remove, #BLI_ohash_insert calls (double lookups)
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_ohash_reinsert(OHash *oh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	OHashSlot *slot;
+
+	if (ohash_ensure_slot(oh, key, &slot)) {
+		ohash_slot_free(slot, keyfreefp, valfreefp);
+		slot->key = key;
+		slot->val = val;
+		return false;
+	}
+
+	slot->val = val;
+	return true;
+}
+
+/**
+ * Lookup the value of \a key in \a oh.
+ *
+ * \param key  The key to lookup.
+ * \returns the value for \a key or NULL.
+ *
+ * \note When NULL is a valid value, use #BLI_ohash_lookup_p to differentiate a missing key
+ * from a key with a NULL value. (Avoids calling #BLI_ohash_haskey before #BLI_ohash_lookup)
+ */
+void *BLI_ohash_lookup(OHash *oh, const void *key)
+{
+	OHashSlot *slot = ohash_lookup_slot(oh, key);
+	return slot ? slot->val : NULL;
+}
+
+/**
+ * A version of #BLI_ohash_lookup which accepts a fallback argument.
+ */
+void *BLI_ohash_lookup_default(OHash *oh, const void *key, void *val_default)
+{
+	OHashSlot *slot = ohash_lookup_slot(oh, key);
+	return slot ? slot->val : val_default;
+}
+
+/**
+ * Lookup a pointer to the value of \a key in \a oh.
+ *
+ * \param key  The key to lookup.
+ * \returns the pointer to value for \a key or NULL.
+ *
+ * \note This has 2 main benefits over #BLI_ohash_lookup.
+ * - A NULL return always means that \a key isn't in \a oh.
+ * - The value can be modified in-place without further function calls (faster).
+ *
+ * \warning The pointer is invalidated by the next insertion or removal.
+ */
+void **BLI_ohash_lookup_p(OHash *oh, const void *key)
+{
+	OHashSlot *slot = ohash_lookup_slot(oh, key);
+	return slot ? &slot->val : NULL;
+}
+
+/**
+ * Ensure \a key is exists in \a oh.
+ *
+ * This handles the common situation where the caller needs ensure a key is added to \a oh,
+ * constructing a new value in the case the key isn't found.
+ * Otherwise use the existing value.
+ *
+ * Such situations typically incur multiple lookups, however this function
+ * avoids them by ensuring the key is added,
+ * returning a pointer to the value so it can be used or initialized by the caller.
+ *
+ * \returns true when the value didn't need to be added.
+ * (when false, the caller _must_ initialize the value).
+ */
+bool BLI_ohash_ensure_p(OHash *oh, void *key, void ***r_val)
+{
+	OHashSlot *slot;
+	const bool haskey = ohash_ensure_slot(oh, key, &slot);
+
+	*r_val = &slot->val;
+	return haskey;
+}
+
+/**
+ * A version of #BLI_ohash_ensure_p that allows caller to re-assign the key.
+ * Typically used when the key is to be duplicated.
+ *
+ * \warning Caller _must_ write to \a r_key when returning false.
+ */
+bool BLI_ohash_ensure_p_ex(OHash *oh, const void *key, void ***r_key, void ***r_val)
+{
+	OHashSlot *slot;
+	const bool haskey = ohash_ensure_slot(oh, key, &slot);
+
+	if (!haskey) {
+		/* pass, caller must assign */
+		slot->key = NULL;
+	}
+
+	*r_key = &slot->key;
+	*r_val = &slot->val;
+	return haskey;
+}
+
+/**
+ * Remove \a key from \a oh, or return false if the key wasn't found.
+ *
+ * \param key  The key to remove.
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ * \return true if \a key was removed from \a oh.
+ */
+bool BLI_ohash_remove(OHash *oh, const void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	OHashSlot slot;
+
+	if (ohash_remove_ex(oh, key, &slot)) {
+		ohash_slot_free(&slot, keyfreefp, valfreefp);
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Remove \a key from \a oh, returning the value or NULL if the key wasn't found.
+ *
+ * \param key  The key to remove.
+ * \param keyfreefp  Optional callback to free the key.
+ * \return the value of \a key int \a oh or NULL.
+ */
+void *BLI_ohash_popkey(OHash *oh, const void *key, GHashKeyFreeFP keyfreefp)
+{
+	OHashSlot slot;
+
+	if (ohash_remove_ex(oh, key, &slot)) {
+		ohash_slot_free(&slot, keyfreefp, NULL);
+		return slot.val;
+	}
+
+	return NULL;
+}
+
+/**
+ * \return true if the \a key is in \a oh.
+ */
+bool BLI_ohash_haskey(OHash *oh, const void *key)
+{
+	return (ohash_lookup_slot(oh, key) != NULL);
+}
+
+/**
+ * Remove a random entry from \a oh, returning true if a key/value pair could be removed, false otherwise.
+ *
+ * \param r_key: The removed key.
+ * \param r_val: The removed value.
+ * \param state: Used for efficient removal.
+ * \return true if there was something to pop, false if ohash was already empty.
+ */
+bool BLI_ohash_pop(OHash *oh, OHashIterState *state, void **r_key, void **r_val)
+{
+	unsigned int index = state->curr_index;
+
+	if (oh->nentries == 0) {
+		*r_key = *r_val = NULL;
+		return false;
+	}
+
+	/* Insertions (and the backward shift of removal, across the end of the slots array)
+	 * may place entries behind the current index, so wrap around. */
+	if (index >= oh->nslots) {
+		index = 0;
+	}
+	while (oh->slots[index].dist == 0) {
+		index = (index + 1) & oh->slot_mask;
+	}
+
+	*r_key = oh->slots[index].key;
+	*r_val = oh->slots[index].val;
+	ohash_remove_slot(oh, &oh->slots[index]);
+
+	/* Don't step, removal may have moved the next entry into this slot. */
+	state->curr_index = index;
+	return true;
+}
+
+/**
+ * Reset \a oh clearing all entries.
+ *
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ * \param nentries_reserve  Optionally reserve the number of members that the hash will hold.
+ */
+void BLI_ohash_clear_ex(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp,
+                        const unsigned int nentries_reserve)
+{
+	if (keyfreefp || valfreefp) {
+		ohash_free_cb(oh, keyfreefp, valfreefp);
+	}
+
+	ohash_slots_reset(oh, nentries_reserve);
+}
+
+/**
+ * Wraps #BLI_ohash_clear_ex with zero entries reserved.
+ */
+void BLI_ohash_clear(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	BLI_ohash_clear_ex(oh, keyfreefp, valfreefp, 0);
+}
+
+/**
+ * Frees the OHash and its members.
+ *
+ * \param oh  The OHash to free.
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ */
+void BLI_ohash_free(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	BLI_assert((int)oh->nslots > 0);
+
+	if (keyfreefp || valfreefp) {
+		ohash_free_cb(oh, keyfreefp, valfreefp);
+	}
+
+	MEM_freeN(oh->slots);
+	MEM_freeN(oh);
+}
+
+/**
+ * Sets a OHash flag.
+ */
+void BLI_ohash_flag_set(OHash *oh, unsigned int flag)
+{
+	oh->flag |= flag;
+}
+
+/**
+ * Clear a OHash flag.
+ */
+void BLI_ohash_flag_clear(OHash *oh, unsigned int flag)
+{
+	oh->flag &= ~flag;
+}
+
+/** \} */
+
+
+/* -------------------------------------------------------------------- */
+/* OHash Iterator API */
+
+/** \name Iterator API
+ * \{ */
+
+BLI_INLINE void ohashIterator_next_slot(OHashIterator *ohi)
+{
+	OHash *oh = ohi->oh;
+
+	for (; ohi->curr_index < oh->nslots; ohi->curr_index++) {
+		if (oh->slots[ohi->curr_index].dist) {
+			ohi->curr_slot = &oh->slots[ohi->curr_index];
+			return;
+		}
+	}
+
+	ohi->curr_slot = NULL;
+}
+
+/**
+ * Init an already allocated OHashIterator. The hash table must not
+ * be mutated while the iterator is in use, and the iterator will
+ * step exactly BLI_ohash_size(oh) times before becoming done.
+ *
+ * \param ohi The OHashIterator to initialize.
+ * \param oh The OHash to iterate over.
+ */
+void BLI_ohashIterator_init(OHashIterator *ohi, OHash *oh)
+{
+	ohi->oh = oh;
+	ohi->curr_index = 0;
+	ohi->curr_slot = NULL;
+
+	if (oh->nentries) {
+		ohashIterator_next_slot(ohi);
+	}
+}
+
+/**
+ * Steps the iterator to the next index.
+ *
+ * \param ohi The iterator.
+ */
+void BLI_ohashIterator_step(OHashIterator *ohi)
+{
+	if (ohi->curr_slot) {
+		ohi->curr_index++;
+		ohashIterator_next_slot(ohi);
+	}
+}
+
+/** \} */
+
+
+/** \name Convenience OHash Creation Functions
+ * \{ */
+
+OHash *BLI_ohash_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+	return BLI_ohash_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info, nentries_reserve);
+}
+OHash *BLI_ohash_ptr_new(const char *info)
+{
+	return BLI_ohash_ptr_new_ex(info, 0);
+}
+
+OHash *BLI_ohash_str_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+	return BLI_ohash_new_ex(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info, nentries_reserve);
+}
+OHash *BLI_ohash_str_new(const char *info)
+{
+	return BLI_ohash_str_new_ex(info, 0);
+}
+
+OHash *BLI_ohash_int_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+	return BLI_ohash_new_ex(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, info, nentries_reserve);
+}
+OHash *BLI_ohash_int_new(const char *info)
+{
+	return BLI_ohash_int_new_ex(info, 0);
+}
+
+/** \} */
+
+
+/* -------------------------------------------------------------------- */
+/* OSet API */
+
+/** \name OSet Public API
+ *
+ * Use ghash API to give 'set' functionality, values are left NULL.
+ * \{ */
+
+OSet *BLI_oset_new_ex(GSetHashFP hashfp, GSetCmpFP cmpfp, const char *info,
+                      const unsigned int nentries_reserve)
+{
+	return (OSet *)ohash_new(hashfp, cmpfp, info, nentries_reserve);
+}
+
+OSet *BLI_oset_new(GSetHashFP hashfp, GSetCmpFP cmpfp, const char *info)
+{
+	return BLI_oset_new_ex(hashfp, cmpfp, info, 0);
+}
+
+void BLI_oset_free(OSet *os, GSetKeyFreeFP keyfreefp)
+{
+	BLI_ohash_free((OHash *)os, keyfreefp, NULL);
+}
+
+void BLI_oset_reserve(OSet *os, const unsigned int nentries_reserve)
+{
+	BLI_ohash_reserve((OHash *)os, nentries_reserve);
+}
+
+unsigned int BLI_oset_size(OSet *os)
+{
+	return ((OHash *)os)->nentries;
+}
+
+/**
+ * Adds the key to the set (no checks for unique keys!).
+ * Matching #BLI_ohash_insert
+ */
+void BLI_oset_insert(OSet *os, void *key)
+{
+	ohash_insert_ex((OHash *)os, key, NULL);
+}
+
+/**
+ * A version of BLI_oset_insert which checks first if the key is in the set.
+ * \returns true if a new key has been added.
+ */
+bool BLI_oset_add(OSet *os, void *key)
+{
+	OHashSlot *slot;
+	return !ohash_ensure_slot((OHash *)os, key, &slot);
+}
+
+/**
+ * Set counterpart to #BLI_ohash_ensure_p_ex.
+ * similar to BLI_oset_add, except it returns the key pointer.
+ *
+ * \warning Caller _must_ write to \a r_key when returning false.
+ */
+bool BLI_oset_ensure_p_ex(OSet *os, const void *key, void ***r_key)
+{
+	OHashSlot *slot;
+	const bool haskey = ohash_ensure_slot((OHash *)os, key, &slot);
+
+	if (!haskey) {
+		/* pass, caller must assign */
+		slot->key = NULL;
+	}
+
+	*r_key = &slot->key;
+	return haskey;
+}
+
+bool BLI_oset_haskey(OSet *os, const void *key)
+{
+	return (ohash_lookup_slot((OHash *)os, key) != NULL);
+}
+
+/**
+ * Returns the pointer to the key if it's found.
+ */
+void *BLI_oset_lookup(OSet *os, const void *key)
+{
+	OHashSlot *slot = ohash_lookup_slot((OHash *)os, key);
+	return slot ? slot->key : NULL;
+}
+
+bool BLI_oset_remove(OSet *os, const void *key, GSetKeyFreeFP keyfreefp)
+{
+	return BLI_ohash_remove((OHash *)os, key, keyfreefp, NULL);
+}
+
+void BLI_oset_clear_ex(OSet *os, GSetKeyFreeFP keyfreefp, const unsigned int nentries_reserve)
+{
+	BLI_ohash_clear_ex((OHash *)os, keyfreefp, NULL, nentries_reserve);
+}
+
+void BLI_oset_clear(OSet *os, GSetKeyFreeFP keyfreefp)
+{
+	BLI_ohash_clear_ex((OHash *)os, keyfreefp, NULL, 0);
+}
+
+/**
+ * Remove a random entry from \a os, returning true if a key could be removed, false otherwise.
+ */
+bool BLI_oset_pop(OSet *os, OSetIterState *state, void **r_key)
+{
+	void *val;
+	return BLI_ohash_pop((OHash *)os, (OHashIterState *)state, r_key, &val);
+}
+
+void BLI_oset_flag_set(OSet *os, unsigned int flag)
+{
+	((OHash *)os)->flag |= flag;
+}
+
+void BLI_oset_flag_clear(OSet *os, unsigned int flag)
+{
+	((OHash *)os)->flag &= ~flag;
+}
+
+OSet *BLI_oset_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+	return BLI_oset_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info, nentries_reserve);
+}
+OSet *BLI_oset_ptr_new(const char *info)
+{
+	return BLI_oset_ptr_new_ex(info, 0);
+}
+
+OSet *BLI_oset_str_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+	return BLI_oset_new_ex(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info, nentries_reserve);
+}
+OSet *BLI_oset_str_new(const char *info)
+{
+	return BLI_oset_str_new_ex(info, 0);
+}
+
+/** \} */
+
+
+/** \name Debugging & Introspection
+ * \{ */
+
+/**
+ * Measure how well the hash function performs, as the average distance of
+ * entries to their ideal slot (1.0 is optimal).
+ *
+ * \param r_load  The load factor of the table.
+ * \param r_dist_max  The longest probe sequence.
+ */
+double BLI_ohash_calc_quality_ex(OHash *oh, double *r_load, int *r_dist_max)
+{
+	uint64_t dist_sum = 0;
+	unsigned int dist_max = 0;
+	unsigned int i;
+
+	for (i = 0; i < oh->nslots; i++) {
+		const unsigned int dist = oh->slots[i].dist;
+		dist_sum += dist;
+		dist_max = MAX2(dist_max, dist);
+	}
+
+	if (r_load) {
+		*r_load = (double)oh->nentries / (double)oh->nslots;
+	}
+	if (r_dist_max) {
+		*r_dist_max = (int)dist_max;
+	}
+
+	return (oh->nentries) ? (double)dist_sum / (double)oh->nentries : 0.0;
+}
+
+double BLI_ohash_calc_quality(OHash *oh)
+{
+	return BLI_ohash_calc_quality_ex(oh, NULL, NULL);
+}
+
+/** \} */
@@ -112,6 +112,7 @@
 
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BLI_strict_flags.h"
 
@@ -161,6 +162,19 @@
  * so 4 -> 7, 5 -> 10, 6 -> 15... etc.
  */
 #  define BCHUNK_HASH_TABLE_ACCUMULATE_STEPS 4
+
+/* Calculate the hash array for large arrays using multiple threads.
+ * Each value only depends on its own data and the values ahead of it,
+ * so the array is split into blocks which are hashed & accumulated in parallel.
+ * The result is identical to the single threaded version.
+ */
+#  define USE_HASH_TABLE_THREADED
+#  ifdef USE_HASH_TABLE_THREADED
+/* Number of hash values each task handles. */
+#    define BCHUNK_HASH_THREADED_BLOCK (1 << 14)
+/* Only use threads for arrays with more hash values than this. */
+#    define BCHUNK_HASH_THREADED_MIN (BCHUNK_HASH_THREADED_BLOCK * 4)
+#  endif
 #else
 /* How many items to hash (multiplied by stride)
  */
@@ -845,6 +859,91 @@ static void hash_accum(hash_key *hash_array, const size_t hash_array_len, size_t
 	}
 }
 
+#ifdef USE_HASH_TABLE_THREADED
+
+/* Threaded version of #hash_array_from_data followed by #hash_accum,
+ * only used for the (potentially very large) hash array of the new data.
+ *
+ * Each block hashes its own range as well as the values ahead of it which are read while accumulating,
+ * so blocks don't depend on each other and the hash array is only written once. */
+
+typedef struct HashArrayThreadData {
+	const BArrayInfo *info;
+	const uchar *data_slice;
+	hash_key *hash_array;
+	size_t hash_array_len;
+	size_t hash_array_search_len;
+	size_t iter_steps;
+	/* number of values past the end of each block needed to accumulate the block */
+	size_t read_ahead_len;
+} HashArrayThreadData;
+
+static void hash_array_accum_task_cb(void *userdata, const int iter)
+{
+	const HashArrayThreadData *data = userdata;
+	const size_t stride = data->info->chunk_stride;
+	const size_t i_start = (size_t)iter * BCHUNK_HASH_THREADED_BLOCK;
+	const size_t i_end = MIN2(i_start + BCHUNK_HASH_THREADED_BLOCK, data->hash_array_len);
+	const size_t i_end_read = MIN2(i_end + data->read_ahead_len, data->hash_array_len);
+	const size_t buf_len = i_end_read - i_start;
+	hash_key *buf = MEM_mallocN(sizeof(*buf) * buf_len, __func__);
+
+	hash_array_from_data(data->info, &data->data_slice[i_start * stride], buf_len * stride, buf);
+
+	/* Same as #hash_accum, values past the end of the block become invalid
+	 * (they're missing values further ahead), but are never read by the block itself. */
+	const size_t buf_search_len = (data->hash_array_search_len > i_start) ?
+	        MIN2(data->hash_array_search_len - i_start, buf_len) : 0;
+	size_t iter_steps = data->iter_steps;
+	while (iter_steps != 0) {
+		const size_t hash_offset = iter_steps;
+		const size_t buf_read_len = (buf_len > hash_offset) ? buf_len - hash_offset : 0;
+		const size_t buf_step_len = MIN2(buf_search_len, buf_read_len);
+		for (size_t i = 0; i < buf_step_len; i++) {
+			buf[i] += (buf[i + hash_offset]) * ((buf[i] & 0xff) + 1);
+		}
+		iter_steps -= 1;
+	}
+
+	memcpy(&data->hash_array[i_start], buf, sizeof(*buf) * (i_end - i_start));
+	MEM_freeN(buf);
+}
+
+/**
+ * Calculate the accumulated hash array for \a data_slice,
+ * matching the result of #hash_array_from_data followed by #hash_accum.
+ */
+static void hash_array_accum_from_data(
+        const BArrayInfo *info, const uchar *data_slice, const size_t data_slice_len,
+        hash_key *hash_array, const size_t hash_array_len, size_t iter_steps)
+{
+	if (hash_array_len <= BCHUNK_HASH_THREADED_MIN) {
+		hash_array_from_data(info, data_slice, data_slice_len, hash_array);
+		hash_accum(hash_array, hash_array_len, iter_steps);
+		return;
+	}
+
+	if (UNLIKELY((iter_steps > hash_array_len))) {
+		iter_steps = hash_array_len;
+	}
+
+	const int blocks_len = (int)((hash_array_len + (BCHUNK_HASH_THREADED_BLOCK - 1)) / BCHUNK_HASH_THREADED_BLOCK);
+	HashArrayThreadData data = {
+		.info = info,
+		.data_slice = data_slice,
+		.hash_array = hash_array,
+		.hash_array_len = hash_array_len,
+		.hash_array_search_len = hash_array_len - iter_steps,
+		.iter_steps = iter_steps,
+		/* 'triangle-number', the sum of all offsets */
+		.read_ahead_len = (iter_steps * (iter_steps + 1)) / 2,
+	};
+
+	BLI_task_parallel_range(0, blocks_len, &data, hash_array_accum_task_cb, true);
+}
+
+#endif  /* USE_HASH_TABLE_THREADED */
+
 /**
  * When we only need a single value, can use a small optimization.
  * we can avoid accumulating the tail of the array a little, each iteration.
@@ -1207,9 +1306,15 @@ static BChunkList *bchunk_list_from_data_merge(
 		size_t i_table_start = i_prev;
 		const size_t table_hash_array_len = (data_len - i_prev) / info->chunk_stride;
 		hash_key  *table_hash_array = MEM_mallocN(sizeof(*table_hash_array) * table_hash_array_len, __func__);
+#ifdef USE_HASH_TABLE_THREADED
+		hash_array_accum_from_data(
+		        info, &data[i_prev], data_len - i_prev,
+		        table_hash_array, table_hash_array_len, info->accum_steps);
+#else
 		hash_array_from_data(info, &data[i_prev], data_len - i_prev, table_hash_array);
 
 		hash_accum(table_hash_array, table_hash_array_len, info->accum_steps);
+#endif
 #else
 		/* dummy vars */
 		uint i_table_start = 0;
@@ -4063,6 +4063,7 @@ static void direct_link_pointcache(FileData *fd, PointCache *cache)
 	cache->edit = NULL;
 	cache->free_edit = NULL;
 	cache->cached_frames = NULL;
+	cache->packed = NULL;
 }
 
 static void direct_link_pointcache_list(FileData *fd, ListBase *ptcaches, PointCache **ocache, int force_disk)
@@ -5098,6 +5099,7 @@ static void direct_link_modifiers(FileData *fd, ListBase *lb)
 	for (md=lb->first; md; md=md->next) {
 		md->error = NULL;
 		md->scene = NULL;
+		md->runtime = NULL;
 		
 		/* if modifiers disappear, or for upward compatibility */
 		if (NULL == modifierType_getInfo(md->type))
@@ -5374,6 +5376,13 @@ static void direct_link_modifiers(FileData *fd, ListBase *lb)
 			/* runtime only */
 			csmd->delta_cache = NULL;
 			csmd->delta_cache_num = 0;
+			csmd->topology_cache = NULL;
+		}
+		else if (md->type == eModifierType_LaplacianSmooth) {
+			LaplacianSmoothModifierData *smd = (LaplacianSmoothModifierData *)md;
+
+			/* runtime only */
+			smd->cache = NULL;
 		}
 		else if (md->type == eModifierType_MeshSequenceCache) {
 			MeshSeqCacheModifierData *msmcd = (MeshSeqCacheModifierData *)md;
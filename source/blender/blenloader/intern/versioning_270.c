@@ -1671,6 +1671,15 @@ void blo_do_versions_270(FileData *fd, Library *UNUSED(lib), Main *main)
 			CustomData_set_layer_name(&me->vdata, CD_MDEFORMVERT, 0, "");
 		}
 	}
+
+	{
+		/* To be added to next subversion bump! */
+		if (!DNA_struct_elem_find(fd->filesdna, "Scene", "char", "cache_prefetch")) {
+			for (Scene *scene = main->scene.first; scene; scene = scene->id.next) {
+				scene->cache_prefetch = 8;
+			}
+		}
+	}
 }
 
 void do_versions_after_linking_270(Main *main)
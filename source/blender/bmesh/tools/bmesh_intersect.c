@@ -41,6 +41,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_memarena.h"
 #include "BLI_alloca.h"
+#include "BLI_bitmap.h"
 #include "BLI_sort_utils.h"
 
 #include "BLI_linklist_stack.h"
@@ -51,6 +52,7 @@
 
 #include "BLI_kdopbvh.h"
 #include "BLI_buffer.h"
+#include "BLI_task.h"
 
 #include "bmesh.h"
 #include "intern/bmesh_private.h"
@@ -80,6 +82,8 @@
 // #define USE_PARANOID
 /* use accelerated overlap check */
 #define USE_BVH
+/* find the overlapping triangle pairs which intersect in threads (needs USE_BVH) */
+#define USE_BVH_PARALLEL
 
 // #define USE_BOOLEAN_RAYCAST_DRAW
 
@@ -127,6 +131,14 @@ enum ISectType {
 	IX_TOT,
 };
 
+/* Tests of two triangles which may find intersections, see #bm_isect_tri_tri_test. */
+enum {
+	ISECT_TEST_EDGE_A = (1 << 0),  /* 3 bits, one per edge of the first triangle */
+	ISECT_TEST_EDGE_B = (1 << 3),  /* 3 bits, one per edge of the second triangle */
+	ISECT_TEST_VERT   = (1 << 6),  /* vert-vert, vert-edge & vert-tri */
+};
+#define ISECT_TEST_ALL ((1 << 7) - 1)
+
 struct ISectEpsilon {
 	float eps, eps_sq;
 	float eps2x, eps2x_sq;
@@ -140,6 +152,9 @@ struct ISectState {
 	GHash *face_edges;  /* BMFace-index: LinkList(of edges), only original faces */
 	GSet  *wire_edges;  /* BMEdge  (could use tags instead) */
 	LinkNode *vert_dissolve;  /* BMVert's */
+#ifdef USE_BVH_PARALLEL
+	BLI_bitmap *edgetri_cache_verts;  /* BMVert-index: used in an 'edgetri_cache' key */
+#endif
 
 	MemArena *mem_arena;
 
@@ -371,6 +386,7 @@ static BMVert *bm_isect_edge_tri(
         BMVert *e_v0, BMVert *e_v1,
         BMVert *t[3], const int t_index,
         const float *t_cos[3], const float t_nor[3],
+        const bool use_isect,
         enum ISectType *r_side)
 {
 	BMesh *bm = s->bm;
@@ -425,21 +441,35 @@ static BMVert *bm_isect_edge_tri(
 
 
 
-	for (i = 0; i < ARRAY_SIZE(k_arr); i++) {
-		BMVert *iv;
+#ifdef USE_BVH_PARALLEL
+	/* all keys contain the edge, skip the lookups when it's in none */
+	if (BLI_BITMAP_TEST(s->edgetri_cache_verts, BM_elem_index_get(e_v0)) &&
+	    BLI_BITMAP_TEST(s->edgetri_cache_verts, BM_elem_index_get(e_v1)))
+#endif
+	{
+		for (i = 0; i < ARRAY_SIZE(k_arr); i++) {
+			BMVert *iv;
 
-		iv = BLI_ghash_lookup(s->edgetri_cache, k_arr[i]);
+			iv = BLI_ghash_lookup(s->edgetri_cache, k_arr[i]);
 
-		if (iv) {
+			if (iv) {
 #ifdef USE_DUMP
-			printf("# cache hit (%d, %d, %d, %d)\n", UNPACK4(k_arr[i]));
+				printf("# cache hit (%d, %d, %d, %d)\n", UNPACK4(k_arr[i]));
 #endif
-			*r_side = (enum ISectType)i;
-			return iv;
+				*r_side = (enum ISectType)i;
+				return iv;
+			}
 		}
 	}
 
-	*r_side = intersect_line_tri(e_v0->co, e_v1->co, t_cos, t_nor, ix, &s->epsilon);
+	if (use_isect) {
+		*r_side = intersect_line_tri(e_v0->co, e_v1->co, t_cos, t_nor, ix, &s->epsilon);
+	}
+	else {
+		/* known not to intersect */
+		*r_side = IX_NONE;
+	}
+
 	if (*r_side != IX_NONE) {
 		BMVert *iv;
 		BMEdge *e;
@@ -481,6 +511,16 @@ static BMVert *bm_isect_edge_tri(
 			int *k = BLI_memarena_alloc(s->mem_arena, sizeof(int[4]));
 			memcpy(k, k_arr[*r_side], sizeof(int[4]));
 			BLI_ghash_insert(s->edgetri_cache, k, iv);
+
+#ifdef USE_BVH_PARALLEL
+			/* the triangle index in an IX_EDGE_TRI key isn't a vertex */
+			BLI_BITMAP_ENABLE(s->edgetri_cache_verts, k[0]);
+			BLI_BITMAP_ENABLE(s->edgetri_cache_verts, k[1]);
+			if (*r_side != IX_EDGE_TRI) {
+				BLI_BITMAP_ENABLE(s->edgetri_cache_verts, k[2]);
+				BLI_BITMAP_ENABLE(s->edgetri_cache_verts, k[3]);
+			}
+#endif
 		}
 
 		return iv;
@@ -523,11 +563,14 @@ static bool bm_loop_filter_fn(const BMLoop *l, void *user_data)
 
 /**
  * Return true if we have any intersections.
+ *
+ * \param isect_test: Tests which may find intersections (#ISECT_TEST_ALL when not known).
  */
 static void bm_isect_tri_tri(
         struct ISectState *s,
         int a_index, int b_index,
-        BMLoop **a, BMLoop **b)
+        BMLoop **a, BMLoop **b,
+        const uint isect_test)
 {
 	BMFace *f_a = (*a)->f;
 	BMFace *f_b = (*b)->f;
@@ -572,6 +615,10 @@ static void bm_isect_tri_tri(
 	} ((void)0)
 
 
+	if ((isect_test & ISECT_TEST_VERT) == 0) {
+		goto edge_tri;
+	}
+
 	/* vert-vert
 	 * --------- */
 	{
@@ -751,6 +798,7 @@ static void bm_isect_tri_tri(
 		goto finally;
 	}
 
+edge_tri:
 	normal_tri_v3(f_a_nor, UNPACK3(f_a_cos));
 	normal_tri_v3(f_b_nor, UNPACK3(f_b_cos));
 
@@ -768,7 +816,9 @@ static void bm_isect_tri_tri(
 				continue;
 			}
 
-			iv = bm_isect_edge_tri(s, fv_a[i_a_e0], fv_a[i_a_e1], fv_b, b_index, f_b_cos, f_b_nor, &side);
+			iv = bm_isect_edge_tri(
+			        s, fv_a[i_a_e0], fv_a[i_a_e1], fv_b, b_index, f_b_cos, f_b_nor,
+			        (isect_test & (ISECT_TEST_EDGE_A << i_a_e0)) != 0, &side);
 			if (iv) {
 				STACK_PUSH_TEST_A(iv);
 				STACK_PUSH_TEST_B(iv);
@@ -789,7 +839,9 @@ static void bm_isect_tri_tri(
 				continue;
 			}
 
-			iv = bm_isect_edge_tri(s, fv_b[i_b_e0], fv_b[i_b_e1], fv_a, a_index, f_a_cos, f_a_nor, &side);
+			iv = bm_isect_edge_tri(
+			        s, fv_b[i_b_e0], fv_b[i_b_e1], fv_a, a_index, f_a_cos, f_a_nor,
+			        (isect_test & (ISECT_TEST_EDGE_B << i_b_e0)) != 0, &side);
 			if (iv) {
 				STACK_PUSH_TEST_A(iv);
 				STACK_PUSH_TEST_B(iv);
@@ -856,6 +908,176 @@ finally:
 
 }
 
+#ifdef USE_BVH_PARALLEL
+
+/* The tests below match those in #bm_isect_tri_tri & #bm_isect_edge_tri,
+ * without changing the mesh (so they can run in threads). */
+
+static bool bm_isect_vert_edge_test(
+        const float v_co[3], const float e_co0[3], const float e_co1[3],
+        const struct ISectEpsilon *e)
+{
+	const float fac = line_point_factor_v3(v_co, e_co0, e_co1);
+	if ((fac > 0.0f - e->eps) && (fac < 1.0f + e->eps)) {
+		float ix[3];
+		interp_v3_v3v3(ix, e_co0, e_co1, fac);
+		return (len_squared_v3v3(ix, v_co) <= e->eps2x_sq);
+	}
+	return false;
+}
+
+static bool bm_isect_vert_tri_test(
+        const float *v_cos[3], const float *t_cos[3],
+        const struct ISectEpsilon *e)
+{
+	float t_scale[3][3];
+	uint i;
+
+	copy_v3_v3(t_scale[0], t_cos[0]);
+	copy_v3_v3(t_scale[1], t_cos[1]);
+	copy_v3_v3(t_scale[2], t_cos[2]);
+	tri_v3_scale(UNPACK3(t_scale), 1.0f - e->eps2x);
+
+	for (i = 0; i < 3; i++) {
+		float ix[3];
+		if (isect_point_tri_v3(v_cos[i], UNPACK3(t_scale), ix)) {
+			if (len_squared_v3v3(ix, v_cos[i]) <= e->eps2x_sq) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static bool bm_isect_edge_tri_test(
+        BMVert *e_v0, BMVert *e_v1,
+        const float *t_cos[3], const float t_nor[3],
+        const struct ISectEpsilon *e)
+{
+	float ix[3];
+
+	if (BM_elem_index_get(e_v0) > BM_elem_index_get(e_v1)) {
+		SWAP(BMVert *, e_v0, e_v1);
+	}
+
+	return (intersect_line_tri(e_v0->co, e_v1->co, t_cos, t_nor, ix, e) != IX_NONE);
+}
+
+/**
+ * Find which tests of #bm_isect_tri_tri can find intersections between two triangles.
+ *
+ * When none can, calling it may still add geometry for intersections
+ * other pairs added to the 'edgetri_cache', see #bm_isect_tri_tri_cache_test.
+ */
+static uint bm_isect_tri_tri_test(
+        const struct ISectEpsilon *e,
+        BMLoop **a, BMLoop **b)
+{
+	BMVert *fv_a[3] = {UNPACK3_EX(, a, ->v)};
+	BMVert *fv_b[3] = {UNPACK3_EX(, b, ->v)};
+	const float *f_a_cos[3] = {UNPACK3_EX(, fv_a, ->co)};
+	const float *f_b_cos[3] = {UNPACK3_EX(, fv_b, ->co)};
+	float f_a_nor[3];
+	float f_b_nor[3];
+	uint i_a, i_b;
+	uint isect_test = 0;
+
+	if (UNLIKELY(ELEM(fv_a[0], UNPACK3(fv_b)) ||
+	             ELEM(fv_a[1], UNPACK3(fv_b)) ||
+	             ELEM(fv_a[2], UNPACK3(fv_b))))
+	{
+		return 0;
+	}
+
+	/* vert-vert */
+	for (i_a = 0; i_a < 3; i_a++) {
+		for (i_b = 0; i_b < 3; i_b++) {
+			if (len_squared_v3v3(f_a_cos[i_a], f_b_cos[i_b]) <= e->eps2x_sq) {
+				isect_test |= ISECT_TEST_VERT;
+				goto edge_tri;
+			}
+		}
+	}
+
+	/* vert-edge */
+	for (i_a = 0; i_a < 3; i_a++) {
+		for (i_b = 0; i_b < 3; i_b++) {
+			if (bm_isect_vert_edge_test(f_a_cos[i_a], f_b_cos[i_b], f_b_cos[(i_b + 1) % 3], e) ||
+			    bm_isect_vert_edge_test(f_b_cos[i_b], f_a_cos[i_a], f_a_cos[(i_a + 1) % 3], e))
+			{
+				isect_test |= ISECT_TEST_VERT;
+				goto edge_tri;
+			}
+		}
+	}
+
+	/* vert-tri */
+	if (bm_isect_vert_tri_test(f_a_cos, f_b_cos, e) ||
+	    bm_isect_vert_tri_test(f_b_cos, f_a_cos, e))
+	{
+		isect_test |= ISECT_TEST_VERT;
+	}
+
+edge_tri:
+	normal_tri_v3(f_a_nor, UNPACK3(f_a_cos));
+	normal_tri_v3(f_b_nor, UNPACK3(f_b_cos));
+
+	/* edge-tri & edge-edge */
+	for (i_a = 0; i_a < 3; i_a++) {
+		if (bm_isect_edge_tri_test(fv_a[i_a], fv_a[(i_a + 1) % 3], f_b_cos, f_b_nor, e)) {
+			isect_test |= (ISECT_TEST_EDGE_A << i_a);
+		}
+	}
+	for (i_b = 0; i_b < 3; i_b++) {
+		if (bm_isect_edge_tri_test(fv_b[i_b], fv_b[(i_b + 1) % 3], f_a_cos, f_a_nor, e)) {
+			isect_test |= (ISECT_TEST_EDGE_B << i_b);
+		}
+	}
+
+	return isect_test;
+}
+
+/**
+ * Check if an edge of either triangle may be in an 'edgetri_cache' key.
+ */
+static bool bm_isect_tri_tri_cache_test(
+        const struct ISectState *s,
+        BMLoop **a, BMLoop **b)
+{
+	uint i;
+
+	for (i = 0; i < 3; i++) {
+		const uint i_next = (i + 1) % 3;
+		if ((BLI_BITMAP_TEST(s->edgetri_cache_verts, BM_elem_index_get(a[i]->v)) &&
+		     BLI_BITMAP_TEST(s->edgetri_cache_verts, BM_elem_index_get(a[i_next]->v))) ||
+		    (BLI_BITMAP_TEST(s->edgetri_cache_verts, BM_elem_index_get(b[i]->v)) &&
+		     BLI_BITMAP_TEST(s->edgetri_cache_verts, BM_elem_index_get(b[i_next]->v))))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+struct ISectTriTriTestData {
+	const struct ISectEpsilon *epsilon;
+	BMLoop *(*looptris)[3];
+	const BVHTreeOverlap *overlap;
+	uchar *overlap_isect_test;
+};
+
+static void bm_isect_tri_tri_test_cb(void *userdata, const int i)
+{
+	struct ISectTriTriTestData *data = userdata;
+
+	data->overlap_isect_test[i] = (uchar)bm_isect_tri_tri_test(
+	        data->epsilon,
+	        data->looptris[data->overlap[i].indexA],
+	        data->looptris[data->overlap[i].indexB]);
+}
+
+#endif  /* USE_BVH_PARALLEL */
+
 #ifdef USE_BVH
 
 struct RaycastData {
@@ -1040,6 +1262,10 @@ bool BM_mesh_intersect(
 	        0);
 
 
+#ifdef USE_BVH_PARALLEL
+	s.edgetri_cache_verts = BLI_BITMAP_NEW((size_t)bm->totvert, __func__);
+#endif
+
 	BM_mesh_elem_table_ensure(
 	        bm,
 #ifdef USE_SPLICE
@@ -1119,7 +1345,34 @@ bool BM_mesh_intersect(
 	if (overlap) {
 		uint i;
 
+#ifdef USE_BVH_PARALLEL
+		/* Test all pairs in threads, then only intersect the ones that may
+		 * change the mesh, in the same order so the result is the same. */
+		uchar *overlap_isect_test = MEM_mallocN(sizeof(*overlap_isect_test) * tree_overlap_tot, __func__);
+		{
+			struct ISectTriTriTestData data = {
+				.epsilon = &s.epsilon,
+				.looptris = looptris,
+				.overlap = overlap,
+				.overlap_isect_test = overlap_isect_test,
+			};
+			BLI_task_parallel_range(
+			        0, (int)tree_overlap_tot, &data, bm_isect_tri_tri_test_cb,
+			        tree_overlap_tot > BM_OMP_LIMIT);
+		}
+#endif
+
 		for (i = 0; i < tree_overlap_tot; i++) {
+#ifdef USE_BVH_PARALLEL
+			const uint isect_test = overlap_isect_test[i];
+			if ((isect_test == 0) &&
+			    !bm_isect_tri_tri_cache_test(&s, looptris[overlap[i].indexA], looptris[overlap[i].indexB]))
+			{
+				continue;
+			}
+#else
+			const uint isect_test = ISECT_TEST_ALL;
+#endif
 #ifdef USE_DUMP
 			printf("  ((%d, %d), (\n",
 			       overlap[i].indexA,
@@ -1130,11 +1383,15 @@ bool BM_mesh_intersect(
 			        overlap[i].indexA,
 			        overlap[i].indexB,
 			        looptris[overlap[i].indexA],
-			        looptris[overlap[i].indexB]);
+			        looptris[overlap[i].indexB],
+			        isect_test);
 #ifdef USE_DUMP
 			printf(")),\n");
 #endif
 		}
+#ifdef USE_BVH_PARALLEL
+		MEM_freeN(overlap_isect_test);
+#endif
 		MEM_freeN(overlap);
 	}
 
@@ -1173,7 +1430,8 @@ bool BM_mesh_intersect(
 				        i_a,
 				        i_b,
 				        looptris[i_a],
-				        looptris[i_b]);
+				        looptris[i_b],
+				        ISECT_TEST_ALL);
 #ifdef USE_DUMP
 			printf(")),\n");
 #endif
@@ -1694,6 +1952,9 @@ bool BM_mesh_intersect(
 
 	/* cleanup */
 	BLI_ghash_free(s.edgetri_cache, NULL, NULL);
+#ifdef USE_BVH_PARALLEL
+	MEM_freeN(s.edgetri_cache_verts);
+#endif
 
 	BLI_ghash_free(s.edge_verts, NULL, NULL);
 	BLI_ghash_free(s.face_edges, NULL, NULL);
@@ -1005,6 +1005,18 @@ static uiLayout *draw_modifier(
 		row = uiLayoutRow(box, false);
 		uiItemL(row, md->error, ICON_ERROR);
 	}
+
+	/* modifier stack cache statistics */
+	if (!isVirtual && (md->mode & eModifierMode_Expanded)) {
+		int hits, misses;
+		modifier_cache_stats_get(md, &hits, &misses);
+		if (hits != 0) {
+			BLI_snprintf(str, sizeof(str), IFACE_("Cached result used: %d%% (%d of %d updates)"),
+			             (hits * 100) / (hits + misses), hits, hits + misses);
+			row = uiLayoutRow(result, false);
+			uiItemL(row, str, ICON_NONE);
+		}
+	}
 	
 	return result;
 }
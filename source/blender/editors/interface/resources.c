@@ -2804,6 +2804,10 @@ void init_userdef_do_versions(void)
 		U.uiflag |= USER_LOCK_CURSOR_ADJUST;
 	}
 
+	if (!USER_VERSION_ATLEAST(279, 1)) {
+		U.modcachelimit = 256;
+	}
+
 	/**
 	 * Include next version bump.
 	 *
@@ -50,16 +50,13 @@
 
 #  include "BLI_array_store.h"
 #  include "BLI_array_store_utils.h"
+#  include "BLI_task.h"
    /* check on best size later... */
 #  define ARRAY_CHUNK_SIZE 256
 
 #  define USE_ARRAY_STORE_THREAD
 #endif
 
-#ifdef USE_ARRAY_STORE_THREAD
-#  include "BLI_task.h"
-#endif
-
 
 #ifdef USE_ARRAY_STORE
 
@@ -116,9 +113,106 @@ static struct {
 
 } um_arraystore = {{NULL}};
 
+/**
+ * Arrays are queued before being added to their store,
+ * so arrays which use different stores (different strides) can be added in parallel.
+ * Each store is only accessed by a single thread at a time.
+ */
+typedef struct UMArrayStoreJob {
+	BArrayStore *bs;
+	const void *data;
+	size_t data_len;
+	BArrayState *state_reference;
+	BArrayState **r_state;
+	int index;  /* queue order, kept within each store */
+} UMArrayStoreJob;
+
+typedef struct UMArrayStoreJobs {
+	UMArrayStoreJob *jobs;
+	int jobs_len;
+	/* ranges of 'jobs' which share a store, only set once all jobs are queued */
+	int *group_start;
+	int group_len;
+} UMArrayStoreJobs;
+
+static void um_arraystore_jobs_init(UMArrayStoreJobs *jobs, const Mesh *me)
+{
+	int jobs_max =
+	        me->vdata.totlayer + me->edata.totlayer + me->ldata.totlayer + me->pdata.totlayer +
+	        (me->key ? me->key->totkey : 0) + 1;
+
+	jobs->jobs = MEM_mallocN(sizeof(*jobs->jobs) * (size_t)jobs_max, __func__);
+	jobs->jobs_len = 0;
+	jobs->group_start = NULL;
+	jobs->group_len = 0;
+}
+
+static void um_arraystore_jobs_free(UMArrayStoreJobs *jobs)
+{
+	MEM_freeN(jobs->jobs);
+	MEM_SAFE_FREE(jobs->group_start);
+}
+
+static void um_arraystore_jobs_add(
+        UMArrayStoreJobs *jobs, BArrayStore *bs,
+        const void *data, const size_t data_len, BArrayState *state_reference,
+        BArrayState **r_state)
+{
+	UMArrayStoreJob *job = &jobs->jobs[jobs->jobs_len];
+	job->index = jobs->jobs_len++;
+	job->bs = bs;
+	job->data = data;
+	job->data_len = data_len;
+	job->state_reference = state_reference;
+	job->r_state = r_state;
+}
+
+static int um_arraystore_job_cmp(const void *a_v, const void *b_v)
+{
+	const UMArrayStoreJob *a = a_v, *b = b_v;
+	if (a->bs < b->bs) {
+		return -1;
+	}
+	else if (a->bs > b->bs) {
+		return 1;
+	}
+	return (a->index < b->index) ? -1 : (a->index > b->index);
+}
+
+static void um_arraystore_jobs_group_cb(void *userdata, const int group)
+{
+	const UMArrayStoreJobs *jobs = userdata;
+	const int job_end = (group + 1 < jobs->group_len) ? jobs->group_start[group + 1] : jobs->jobs_len;
+	for (int i = jobs->group_start[group]; i < job_end; i++) {
+		const UMArrayStoreJob *job = &jobs->jobs[i];
+		*job->r_state = BLI_array_store_state_add(job->bs, job->data, job->data_len, job->state_reference);
+	}
+}
+
+static void um_arraystore_jobs_run(UMArrayStoreJobs *jobs)
+{
+	if (jobs->jobs_len == 0) {
+		return;
+	}
+
+	qsort(jobs->jobs, (size_t)jobs->jobs_len, sizeof(*jobs->jobs), um_arraystore_job_cmp);
+
+	jobs->group_start = MEM_mallocN(sizeof(*jobs->group_start) * (size_t)jobs->jobs_len, __func__);
+	for (int i = 0; i < jobs->jobs_len; i++) {
+		if ((i == 0) || (jobs->jobs[i].bs != jobs->jobs[i - 1].bs)) {
+			jobs->group_start[jobs->group_len++] = i;
+		}
+	}
+
+	BLI_task_parallel_range(0, jobs->group_len, jobs, um_arraystore_jobs_group_cb, jobs->group_len > 1);
+}
+
+/**
+ * \param jobs: When creating, arrays are queued here (they're freed when \a create is false).
+ */
 static void um_arraystore_cd_compact(
         struct CustomData *cdata, const size_t data_len,
-        bool create,
+        bool create, UMArrayStoreJobs *jobs,
         const BArrayCustomData *bcd_reference,
         BArrayCustomData **r_bcd_first)
 {
@@ -188,15 +282,15 @@ static void um_arraystore_cd_compact(
 					BArrayState *state_reference =
 					        (bcd_reference_current && i < bcd_reference_current->states_len) ?
 					         bcd_reference_current->states[i] : NULL;
-					bcd->states[i] = BLI_array_store_state_add(
-					        bs, layer->data, (size_t)data_len * stride, state_reference);
+					um_arraystore_jobs_add(
+					        jobs, bs, layer->data, (size_t)data_len * stride, state_reference,
+					        &bcd->states[i]);
 				}
 				else {
 					bcd->states[i] = NULL;
 				}
 			}
-
-			if (layer->data) {
+			else if (layer->data) {
 				MEM_freeN(layer->data);
 				layer->data = NULL;
 			}
@@ -261,17 +355,20 @@ static void um_arraystore_cd_free(BArrayCustomData *bcd)
  * \param create: When false, only free the arrays.
  * This is done since when reading from an undo state, they must be temporarily expanded.
  * then discarded afterwards, having this argument avoids having 2x code paths.
+ * When true, the arrays are queued in \a jobs and kept, see #um_arraystore_compact.
  */
 static void um_arraystore_compact_ex(
         UndoMesh *um, const UndoMesh *um_ref,
-        bool create)
+        bool create, UMArrayStoreJobs *jobs)
 {
 	Mesh *me = &um->me;
 
-	um_arraystore_cd_compact(&me->vdata, me->totvert, create, um_ref ? um_ref->store.vdata : NULL, &um->store.vdata);
-	um_arraystore_cd_compact(&me->edata, me->totedge, create, um_ref ? um_ref->store.edata : NULL, &um->store.edata);
-	um_arraystore_cd_compact(&me->ldata, me->totloop, create, um_ref ? um_ref->store.ldata : NULL, &um->store.ldata);
-	um_arraystore_cd_compact(&me->pdata, me->totpoly, create, um_ref ? um_ref->store.pdata : NULL, &um->store.pdata);
+	BLI_assert(create == (jobs != NULL));
+
+	um_arraystore_cd_compact(&me->vdata, me->totvert, create, jobs, um_ref ? um_ref->store.vdata : NULL, &um->store.vdata);
+	um_arraystore_cd_compact(&me->edata, me->totedge, create, jobs, um_ref ? um_ref->store.edata : NULL, &um->store.edata);
+	um_arraystore_cd_compact(&me->ldata, me->totloop, create, jobs, um_ref ? um_ref->store.ldata : NULL, &um->store.ldata);
+	um_arraystore_cd_compact(&me->pdata, me->totpoly, create, jobs, um_ref ? um_ref->store.pdata : NULL, &um->store.pdata);
 
 	if (me->key && me->key->totkey) {
 		const size_t stride = me->key->elemsize;
@@ -285,12 +382,11 @@ static void um_arraystore_compact_ex(
 				BArrayState *state_reference =
 				        (um_ref && um_ref->me.key && (i < um_ref->me.key->totkey)) ?
 				         um_ref->store.keyblocks[i] : NULL;
-				um->store.keyblocks[i] = BLI_array_store_state_add(
-				        bs, keyblock->data, (size_t)keyblock->totelem * stride,
-				        state_reference);
+				um_arraystore_jobs_add(
+				        jobs, bs, keyblock->data, (size_t)keyblock->totelem * stride, state_reference,
+				        &um->store.keyblocks[i]);
 			}
-
-			if (keyblock->data) {
+			else if (keyblock->data) {
 				MEM_freeN(keyblock->data);
 				keyblock->data = NULL;
 			}
@@ -303,13 +399,15 @@ static void um_arraystore_compact_ex(
 			BArrayState *state_reference = um_ref ? um_ref->store.mselect : NULL;
 			const size_t stride = sizeof(*me->mselect);
 			BArrayStore *bs = BLI_array_store_at_size_ensure(&um_arraystore.bs_stride, stride, ARRAY_CHUNK_SIZE);
-			um->store.mselect = BLI_array_store_state_add(
-			        bs, me->mselect, (size_t)me->totselect * stride, state_reference);
+			um_arraystore_jobs_add(
+			        jobs, bs, me->mselect, (size_t)me->totselect * stride, state_reference,
+			        &um->store.mselect);
+		}
+		else {
+			/* keep me->totselect for validation */
+			MEM_freeN(me->mselect);
+			me->mselect = NULL;
 		}
-
-		/* keep me->totselect for validation */
-		MEM_freeN(me->mselect);
-		me->mselect = NULL;
 	}
 
 	if (create) {
@@ -324,7 +422,15 @@ static void um_arraystore_compact_ex(
  */
 static void um_arraystore_compact(UndoMesh *um, const UndoMesh *um_ref)
 {
-	um_arraystore_compact_ex(um, um_ref, true);
+	UMArrayStoreJobs jobs;
+	um_arraystore_jobs_init(&jobs, &um->me);
+
+	um_arraystore_compact_ex(um, um_ref, true, &jobs);
+	um_arraystore_jobs_run(&jobs);
+	um_arraystore_jobs_free(&jobs);
+
+	/* the arrays are now stored, free them */
+	um_arraystore_compact_ex(um, NULL, false, NULL);
 }
 
 static void um_arraystore_compact_with_info(UndoMesh *um, const UndoMesh *um_ref)
@@ -384,7 +490,7 @@ static void um_arraystore_compact_cb(TaskPool *__restrict UNUSED(pool),
  */
 static void um_arraystore_expand_clear(UndoMesh *um)
 {
-	um_arraystore_compact_ex(um, NULL, false);
+	um_arraystore_compact_ex(um, NULL, false, NULL);
 }
 
 static void um_arraystore_expand(UndoMesh *um)
@@ -112,6 +112,9 @@ typedef struct ModifierData {
 	struct Scene *scene;
 
 	char *error;
+
+	/* runtime only, cached result of the modifier stack (see modifier_cache.c) */
+	void *runtime;
 } ModifierData;
 
 typedef enum {
@@ -1309,6 +1312,9 @@ typedef struct LaplacianSmoothModifierData {
 	float lambda, lambda_border, pad1;
 	char defgrp_name[64];  /* MAX_VGROUP_NAME */
 	short flag, repeat;
+
+	/* runtime-only, topology derived data and the linear solver of the previous evaluation */
+	struct LaplacianSmoothCache *cache;
 } LaplacianSmoothModifierData;
 
 /* Smooth modifier flags */
@@ -1343,6 +1349,10 @@ typedef struct CorrectiveSmoothModifierData {
 	float (*delta_cache)[3];
 	unsigned int delta_cache_num;
 	char pad2[4];
+
+	/* runtime-only cache of topology derived data (vertex adjacency & boundaries),
+	 * kept while the topology of the input mesh doesn't change */
+	struct CorrectiveSmoothTopology *topology_cache;
 } CorrectiveSmoothModifierData;
 
 enum {
@@ -206,6 +206,8 @@ typedef struct PointCache {
 
 	struct PTCacheEdit *edit;
 	void (*free_edit)(struct PTCacheEdit *edit);	/* free callback */
+
+	struct PTCachePacked *packed;	/* runtime, open PTCACHE_DISK_PACKED file */
 } PointCache;
 
 typedef struct SBVertex {
@@ -412,6 +414,8 @@ typedef struct SoftBody {
 /* high resolution cache is saved for smoke for backwards compatibility, so set this flag to know it's a "fake" cache */
 #define PTCACHE_FAKE_SMOKE			(1<<12)
 #define PTCACHE_IGNORE_CLEAR		(1<<13)
+/* store all frames of the disk cache in a single file */
+#define PTCACHE_DISK_PACKED			(1<<14)
 
 /* PTCACHE_OUTDATED + PTCACHE_FRAMES_SKIPPED */
 #define PTCACHE_REDO_NEEDED			258
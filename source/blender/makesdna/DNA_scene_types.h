@@ -1695,7 +1695,7 @@ typedef struct Scene {
 	short flag;								/* various settings */
 	
 	char use_nodes;
-	char pad[1];
+	char cache_prefetch;					/* number of frames disk caches are read ahead during playback */
 	
 	struct bNodeTree *nodetree;
 	
@@ -103,6 +103,10 @@ enum {
 #define SM_BORDER_VERTICAL	1
 #define SM_BORDER_CLOSED	2
 
+/* pressure solvers */
+#define SM_PRESSURE_CG			0
+#define SM_PRESSURE_MULTIGRID	1
+
 /* collision types */
 #define SM_COLL_STATIC		0
 #define SM_COLL_RIGID		1
@@ -216,7 +220,7 @@ typedef struct SmokeDomainSettings {
 	char vector_draw_type;
 	char use_coba;
 	char coba_field;  /* simulation field used for the color mapping */
-	char pad2;
+	char pressure_solver;
 } SmokeDomainSettings;
 
 
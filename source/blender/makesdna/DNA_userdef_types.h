@@ -481,7 +481,7 @@ typedef struct UserDef {
 	int scrollback;     /* console scrollback limit */
 	int dpi;            /* range 48-128? */
 	float ui_scale;     /* interface scale */
-	int pad1;
+	int modcachelimit;  /* modifier stack cache limit (in megabytes), zero disables */
 	char node_margin;   /* node insert offset (aka auto-offset) margin, but might be useful for later stuff as well */
 	char pad2;
 	short transopts;    /* eUserpref_Translation_Flags */
@@ -341,6 +341,11 @@ static void rna_def_cloth_solver_result(BlenderRNA *brna)
 	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
 	RNA_def_property_ui_text(prop, "Average Iterations", "Average iterations during substeps");
 	
+	prop = RNA_def_property(srna, "collision_time", PROP_FLOAT, PROP_NONE);
+	RNA_def_property_float_sdna(prop, NULL, "collision_time");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Collision Time", "Time spent in collision handling during substeps, in seconds");
+	
 	RNA_define_verify_sdna(1);
 }
 
@@ -7327,6 +7327,15 @@ void RNA_def_scene(BlenderRNA *brna)
 	RNA_def_property_ui_text(prop, "Sync Mode", "How to sync playback");
 	RNA_def_property_update(prop, NC_SCENE, NULL);
 
+	prop = RNA_def_property(srna, "cache_prefetch_frames", PROP_INT, PROP_NONE);
+	RNA_def_property_int_sdna(prop, NULL, "cache_prefetch");
+	RNA_def_property_clear_flag(prop, PROP_ANIMATABLE);
+	RNA_def_property_range(prop, 0, 100);
+	RNA_def_property_ui_text(prop, "Cache Prefetch",
+	                         "Number of frames of disk caches to read ahead in the background during playback "
+	                         "(zero disables)");
+	RNA_def_property_update(prop, NC_SCENE, NULL);
+
 
 	/* Nodes (Compositing) */
 	prop = RNA_def_property(srna, "node_tree", PROP_POINTER, PROP_NONE);
@@ -60,6 +60,7 @@ EnumPropertyItem rna_enum_abc_compression_items[] = {
 #ifdef RNA_RUNTIME
 
 #include "BKE_animsys.h"
+#include "BKE_cache_prefetch.h"
 #include "BKE_depsgraph.h"
 #include "BKE_editmesh.h"
 #include "BKE_global.h"
@@ -152,6 +153,13 @@ static void rna_SceneRender_get_frame_path(RenderData *rd, int frame, int previe
 	}
 }
 
+static void rna_Scene_cache_prefetch_statistics(Scene *UNUSED(scene), int *r_frames, float *r_hit_rate)
+{
+	size_t mem;
+
+	BKE_cache_prefetch_stats(r_frames, r_hit_rate, &mem);
+}
+
 static void rna_Scene_ray_cast(
         Scene *scene, float origin[3], float direction[3], float ray_dist,
         int *r_success, float r_location[3], float r_normal[3], int *r_index,
@@ -373,6 +381,15 @@ void RNA_api_scene(StructRNA *srna)
 	parm = RNA_def_float_matrix(func, "matrix", 4, 4, NULL, 0.0f, 0.0f, "", "Matrix", 0.0f, 0.0f);
 	RNA_def_function_output(func, parm);
 
+	func = RNA_def_function(srna, "cache_prefetch_statistics", "rna_Scene_cache_prefetch_statistics");
+	RNA_def_function_ui_description(func, "Statistics of the disk caches read ahead during playback");
+	parm = RNA_def_int(func, "frames", 0, 0, INT_MAX, "Frames",
+	                   "Number of frames ahead of the current one which are read into memory", 0, INT_MAX);
+	RNA_def_function_output(func, parm);
+	parm = RNA_def_float_factor(func, "hit_rate", 0.0f, 0.0f, 1.0f, "Hit Rate",
+	                            "Fraction of recent cache reads which found their data in memory", 0.0f, 1.0f);
+	RNA_def_function_output(func, parm);
+
 #ifdef WITH_COLLADA
 	/* don't remove this, as COLLADA exporting cannot be done through operators in render() callback. */
 	func = RNA_def_function(srna, "collada_export", "rna_Scene_collada_export");
@@ -448,6 +448,14 @@ static void rna_def_smoke_domain_settings(BlenderRNA *brna)
 		{0, NULL, 0, NULL, NULL}
 	};
 
+	static EnumPropertyItem smoke_pressure_solver_items[] = {
+		{SM_PRESSURE_CG, "CG", 0, "Conjugate Gradient",
+		 "Jacobi preconditioned conjugate gradient, iterations grow with the resolution"},
+		{SM_PRESSURE_MULTIGRID, "MULTIGRID", 0, "Multigrid",
+		 "Multigrid preconditioned conjugate gradient, faster for high resolutions"},
+		{0, NULL, 0, NULL, NULL}
+	};
+
 	static EnumPropertyItem cache_file_type_items[] = {
 		{PTCACHE_FILE_PTCACHE, "POINTCACHE", 0, "Point Cache", "Blender specific point cache file format"},
 #ifdef WITH_OPENVDB
@@ -612,6 +620,12 @@ static void rna_def_smoke_domain_settings(BlenderRNA *brna)
 	                         "Select which domain border will be treated as collision object");
 	RNA_def_property_update(prop, NC_OBJECT | ND_MODIFIER, "rna_Smoke_reset");
 
+	prop = RNA_def_property(srna, "pressure_solver", PROP_ENUM, PROP_NONE);
+	RNA_def_property_enum_sdna(prop, NULL, "pressure_solver");
+	RNA_def_property_enum_items(prop, smoke_pressure_solver_items);
+	RNA_def_property_ui_text(prop, "Pressure Solver", "Method used to solve for the pressure");
+	RNA_def_property_update(prop, NC_OBJECT | ND_MODIFIER, "rna_Smoke_resetCache");
+
 	prop = RNA_def_property(srna, "effector_weights", PROP_POINTER, PROP_NONE);
 	RNA_def_property_struct_type(prop, "EffectorWeights");
 	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
@@ -36,7 +36,10 @@
 #include "DNA_object_types.h"
 #include "DNA_mesh_types.h"
 
+#include "BLI_bitmap.h"
+#include "BLI_hash_mm2a.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "MEM_guardedalloc.h"
@@ -77,6 +80,7 @@ static void initData(ModifierData *md)
 	csmd->defgrp_name[0] = '\0';
 
 	csmd->delta_cache = NULL;
+	csmd->topology_cache = NULL;
 }
 
 
@@ -93,6 +97,149 @@ static void copyData(ModifierData *md, ModifierData *target)
 
 	tcsmd->delta_cache = NULL;
 	tcsmd->delta_cache_num = 0;
+	tcsmd->topology_cache = NULL;
+}
+
+
+/* -------------------------------------------------------------------- */
+/* Topology Cache
+ *
+ * Vertex adjacency & boundaries only depend on the topology of the input mesh,
+ * so they're kept between evaluations, deformation only updates don't need to recalculate them.
+ */
+
+typedef struct CorrectiveSmoothTopology {
+	/* hash of the edges & loops this was calculated from */
+	unsigned int key;
+	unsigned int verts_num, edges_num, loops_num;
+
+	/* vertex -> connected vertices, one entry per edge (so duplicate edges are counted twice)
+	 * the vertices connected to 'i' are in: vert_edge_verts[vert_edge_offset[i] .. vert_edge_offset[i + 1]] */
+	unsigned int *vert_edge_offset;
+	unsigned int *vert_edge_verts;
+	/* number of connected edges,
+	 * calculate as floats to avoid int->float conversion in #smooth_iter */
+	float *vert_edge_count;
+
+	/* vertices on boundary edges, calculated on demand (MOD_CORRECTIVESMOOTH_PIN_BOUNDARY) */
+	BLI_bitmap *vert_boundary;
+} CorrectiveSmoothTopology;
+
+static void topology_cache_free(CorrectiveSmoothTopology *topology)
+{
+	MEM_freeN(topology->vert_edge_offset);
+	MEM_freeN(topology->vert_edge_verts);
+	MEM_freeN(topology->vert_edge_count);
+	MEM_SAFE_FREE(topology->vert_boundary);
+	MEM_freeN(topology);
+}
+
+static unsigned int topology_cache_key(DerivedMesh *dm)
+{
+	const unsigned int medge_num = (unsigned int)dm->getNumEdges(dm);
+	const MEdge *medge = dm->getEdgeArray(dm);
+	const MLoop *mloop = dm->getLoopArray(dm);
+	BLI_HashMurmur2A mm2;
+	unsigned int i;
+
+	BLI_hash_mm2a_init(&mm2, 0);
+	/* only the vertices, flags & crease don't change the topology */
+	for (i = 0; i < medge_num; i++) {
+		BLI_hash_mm2a_add(&mm2, (const unsigned char *)&medge[i].v1, sizeof(medge[i].v1) * 2);
+	}
+	BLI_hash_mm2a_add(&mm2, (const unsigned char *)mloop, sizeof(*mloop) * (size_t)dm->getNumLoops(dm));
+
+	return BLI_hash_mm2a_end(&mm2);
+}
+
+static void topology_cache_calc_boundaries(CorrectiveSmoothTopology *topology, DerivedMesh *dm)
+{
+	const MLoop *mloop = dm->getLoopArray(dm);
+	const MEdge *medge = dm->getEdgeArray(dm);
+	const unsigned int mloop_num = (unsigned int)dm->getNumLoops(dm);
+	const unsigned int medge_num = (unsigned int)dm->getNumEdges(dm);
+	unsigned int i;
+	unsigned short *boundaries;
+
+	boundaries = MEM_callocN(medge_num * sizeof(*boundaries), __func__);
+
+	/* count the number of adjacent faces */
+	for (i = 0; i < mloop_num; i++) {
+		boundaries[mloop[i].e]++;
+	}
+
+	topology->vert_boundary = BLI_BITMAP_NEW(topology->verts_num, __func__);
+	for (i = 0; i < medge_num; i++) {
+		if (boundaries[i] == 1) {
+			BLI_BITMAP_ENABLE(topology->vert_boundary, medge[i].v1);
+			BLI_BITMAP_ENABLE(topology->vert_boundary, medge[i].v2);
+		}
+	}
+
+	MEM_freeN(boundaries);
+}
+
+/**
+ * Return the topology data for \a dm, only recalculated when the topology changes.
+ */
+static const CorrectiveSmoothTopology *topology_cache_ensure(
+        CorrectiveSmoothModifierData *csmd, DerivedMesh *dm, const unsigned int numVerts,
+        const bool use_boundary)
+{
+	CorrectiveSmoothTopology *topology = csmd->topology_cache;
+	const unsigned int medge_num = (unsigned int)dm->getNumEdges(dm);
+	const unsigned int mloop_num = (unsigned int)dm->getNumLoops(dm);
+	const unsigned int key = topology_cache_key(dm);
+
+	if (topology &&
+	    ((topology->key != key) ||
+	     (topology->verts_num != numVerts) ||
+	     (topology->edges_num != medge_num) ||
+	     (topology->loops_num != mloop_num)))
+	{
+		topology_cache_free(topology);
+		topology = csmd->topology_cache = NULL;
+	}
+
+	if (topology == NULL) {
+		const MEdge *medge = dm->getEdgeArray(dm);
+		unsigned int *vert_edge_fill;
+		unsigned int i;
+
+		topology = MEM_callocN(sizeof(*topology), __func__);
+		topology->key = key;
+		topology->verts_num = numVerts;
+		topology->edges_num = medge_num;
+		topology->loops_num = mloop_num;
+
+		topology->vert_edge_offset = MEM_callocN(sizeof(*topology->vert_edge_offset) * (numVerts + 1), __func__);
+		topology->vert_edge_verts = MEM_mallocN(sizeof(*topology->vert_edge_verts) * medge_num * 2, __func__);
+		topology->vert_edge_count = MEM_mallocN(sizeof(*topology->vert_edge_count) * numVerts, __func__);
+
+		for (i = 0; i < medge_num; i++) {
+			topology->vert_edge_offset[medge[i].v1 + 1]++;
+			topology->vert_edge_offset[medge[i].v2 + 1]++;
+		}
+		for (i = 0; i < numVerts; i++) {
+			topology->vert_edge_count[i] = (float)topology->vert_edge_offset[i + 1];
+			topology->vert_edge_offset[i + 1] += topology->vert_edge_offset[i];
+		}
+
+		vert_edge_fill = MEM_dupallocN(topology->vert_edge_offset);
+		for (i = 0; i < medge_num; i++) {
+			topology->vert_edge_verts[vert_edge_fill[medge[i].v1]++] = medge[i].v2;
+			topology->vert_edge_verts[vert_edge_fill[medge[i].v2]++] = medge[i].v1;
+		}
+		MEM_freeN(vert_edge_fill);
+
+		csmd->topology_cache = topology;
+	}
+
+	if (use_boundary && (topology->vert_boundary == NULL)) {
+		topology_cache_calc_boundaries(topology, dm);
+	}
+
+	return topology;
 }
 
 
@@ -109,6 +256,11 @@ static void freeData(ModifierData *md)
 {
 	CorrectiveSmoothModifierData *csmd = (CorrectiveSmoothModifierData *)md;
 	freeBind(csmd);
+
+	if (csmd->topology_cache) {
+		topology_cache_free(csmd->topology_cache);
+		csmd->topology_cache = NULL;
+	}
 }
 
 
@@ -145,232 +297,152 @@ static void dm_get_weights(
 }
 
 
-static void dm_get_boundaries(DerivedMesh *dm, float *smooth_weights)
+static void dm_get_boundaries(const CorrectiveSmoothTopology *topology, float *smooth_weights)
 {
-	const MPoly *mpoly = dm->getPolyArray(dm);
-	const MLoop *mloop = dm->getLoopArray(dm);
-	const MEdge *medge = dm->getEdgeArray(dm);
-	unsigned int mpoly_num, medge_num, i;
-	unsigned short *boundaries;
-
-	mpoly_num = (unsigned int)dm->getNumPolys(dm);
-	medge_num = (unsigned int)dm->getNumEdges(dm);
-
-	boundaries = MEM_callocN(medge_num * sizeof(*boundaries), __func__);
-
-	/* count the number of adjacent faces */
-	for (i = 0; i < mpoly_num; i++) {
-		const MPoly *p = &mpoly[i];
-		const int totloop = p->totloop;
-		int j;
-		for (j = 0; j < totloop; j++) {
-			boundaries[mloop[p->loopstart + j].e]++;
-		}
-	}
+	unsigned int i;
 
-	for (i = 0; i < medge_num; i++) {
-		if (boundaries[i] == 1) {
-			smooth_weights[medge[i].v1] = 0.0f;
-			smooth_weights[medge[i].v2] = 0.0f;
+	for (i = 0; i < topology->verts_num; i++) {
+		if (BLI_BITMAP_TEST(topology->vert_boundary, i)) {
+			smooth_weights[i] = 0.0f;
 		}
 	}
-
-	MEM_freeN(boundaries);
 }
 
 
 /* -------------------------------------------------------------------- */
-/* Simple Weighted Smoothing
+/* Smoothing Iterations
  *
- * (average of surrounding verts)
+ * Each iteration reads the positions from the previous one, and writes to a second array,
+ * so vertices can be smoothed in parallel (gathering the offsets from their neighbors).
  */
-static void smooth_iter__simple(
-        CorrectiveSmoothModifierData *csmd, DerivedMesh *dm,
-        float (*vertexCos)[3], unsigned int numVerts,
-        const float *smooth_weights,
-        unsigned int iterations)
-{
-	const float lambda = csmd->lambda;
-	unsigned int i;
 
-	const unsigned int numEdges = (unsigned int)dm->getNumEdges(dm);
-	const MEdge *edges = dm->getEdgeArray(dm);
-	float *vertex_edge_count_div;
+typedef struct SmoothIterData {
+	const CorrectiveSmoothTopology *topology;
+	const float (*vertexCos_src)[3];
+	float (*vertexCos_dst)[3];
+	/* simple: 'lambda / edge_count', length weighted: 'lambda' (both scaled by the smoothing weights) */
+	const float *vertex_factor;
+} SmoothIterData;
 
-	struct SmoothingData_Simple {
-		float delta[3];
-	} *smooth_data = MEM_callocN((size_t)numVerts * sizeof(*smooth_data), __func__);
+static void smooth_iter__simple_cb(void *userdata, const int index)
+{
+	const SmoothIterData *data = userdata;
+	const CorrectiveSmoothTopology *topology = data->topology;
+	const float *co = data->vertexCos_src[index];
+	const unsigned int *vert_iter = &topology->vert_edge_verts[topology->vert_edge_offset[index]];
+	const unsigned int *vert_term = &topology->vert_edge_verts[topology->vert_edge_offset[index + 1]];
+	float delta[3] = {0.0f, 0.0f, 0.0f};
+
+	for (; vert_iter != vert_term; vert_iter++) {
+		float edge_dir[3];
+		sub_v3_v3v3(edge_dir, data->vertexCos_src[*vert_iter], co);
+		add_v3_v3(delta, edge_dir);
+	}
 
-	vertex_edge_count_div = MEM_callocN((size_t)numVerts * sizeof(float), __func__);
+	madd_v3_v3v3fl(data->vertexCos_dst[index], co, delta, data->vertex_factor[index]);
+}
 
-	/* calculate as floats to avoid int->float conversion in #smooth_iter */
-	for (i = 0; i < numEdges; i++) {
-		vertex_edge_count_div[edges[i].v1] += 1.0f;
-		vertex_edge_count_div[edges[i].v2] += 1.0f;
+static void smooth_iter__length_weight_cb(void *userdata, const int index)
+{
+	const float eps = FLT_EPSILON * 10.0f;
+	const SmoothIterData *data = userdata;
+	const CorrectiveSmoothTopology *topology = data->topology;
+	const float *co = data->vertexCos_src[index];
+	const unsigned int *vert_iter = &topology->vert_edge_verts[topology->vert_edge_offset[index]];
+	const unsigned int *vert_term = &topology->vert_edge_verts[topology->vert_edge_offset[index + 1]];
+	float delta[3] = {0.0f, 0.0f, 0.0f};
+	float edge_length_sum = 0.0f;
+	float div;
+
+	for (; vert_iter != vert_term; vert_iter++) {
+		float edge_dir[3];
+		float edge_dist;
+
+		sub_v3_v3v3(edge_dir, data->vertexCos_src[*vert_iter], co);
+		edge_dist = len_v3(edge_dir);
+
+		/* weight by distance */
+		madd_v3_v3fl(delta, edge_dir, edge_dist);
+		edge_length_sum += edge_dist;
 	}
 
-	/* a little confusing, but we can include 'lambda' and smoothing weight
-	 * here to avoid multiplying for every iteration */
-	if (smooth_weights == NULL) {
-		for (i = 0; i < numVerts; i++) {
-			vertex_edge_count_div[i] =
-			        lambda * (vertex_edge_count_div[i] ? (1.0f / vertex_edge_count_div[i]) : 1.0f);
-		}
+	/* divide by sum of all neighbour distances (weighted) and amount of neighbors, (mean average) */
+	div = edge_length_sum * topology->vert_edge_count[index];
+	if (div > eps) {
+		madd_v3_v3v3fl(data->vertexCos_dst[index], co, delta, data->vertex_factor[index] / div);
 	}
 	else {
-		for (i = 0; i < numVerts; i++) {
-			vertex_edge_count_div[i] =
-			        smooth_weights[i] * lambda * (vertex_edge_count_div[i] ? (1.0f / vertex_edge_count_div[i]) : 1.0f);
-		}
+		copy_v3_v3(data->vertexCos_dst[index], co);
 	}
-
-	/* -------------------------------------------------------------------- */
-	/* Main Smoothing Loop */
-
-	while (iterations--) {
-		for (i = 0; i < numEdges; i++) {
-			struct SmoothingData_Simple *sd_v1;
-			struct SmoothingData_Simple *sd_v2;
-			float edge_dir[3];
-
-			sub_v3_v3v3(edge_dir, vertexCos[edges[i].v2], vertexCos[edges[i].v1]);
-
-			sd_v1 = &smooth_data[edges[i].v1];
-			sd_v2 = &smooth_data[edges[i].v2];
-
-			add_v3_v3(sd_v1->delta, edge_dir);
-			sub_v3_v3(sd_v2->delta, edge_dir);
-		}
-
-
-		for (i = 0; i < numVerts; i++) {
-			struct SmoothingData_Simple *sd = &smooth_data[i];
-			madd_v3_v3fl(vertexCos[i], sd->delta, vertex_edge_count_div[i]);
-			/* zero for the next iteration (saves memset on entire array) */
-			memset(sd, 0, sizeof(*sd));
-		}
-	}
-
-	MEM_freeN(vertex_edge_count_div);
-	MEM_freeN(smooth_data);
 }
 
-
-/* -------------------------------------------------------------------- */
-/* Edge-Length Weighted Smoothing
- */
-static void smooth_iter__length_weight(
-        CorrectiveSmoothModifierData *csmd, DerivedMesh *dm,
+static void smooth_iter(
+        CorrectiveSmoothModifierData *csmd, const CorrectiveSmoothTopology *topology,
         float (*vertexCos)[3], unsigned int numVerts,
         const float *smooth_weights,
         unsigned int iterations)
 {
-	const float eps = FLT_EPSILON * 10.0f;
-	const unsigned int numEdges = (unsigned int)dm->getNumEdges(dm);
-	/* note: the way this smoothing method works, its approx half as strong as the simple-smooth,
+	const bool use_length_weight = (csmd->smooth_type == MOD_CORRECTIVESMOOTH_SMOOTH_LENGTH_WEIGHT);
+	/* note: the way the length weighted method works, its approx half as strong as the simple-smooth,
 	 * and 2.0 rarely spikes, double the value for consistent behavior. */
-	const float lambda = csmd->lambda * 2.0f;
-	const MEdge *edges = dm->getEdgeArray(dm);
-	float *vertex_edge_count;
+	const float lambda = use_length_weight ? csmd->lambda * 2.0f : csmd->lambda;
+	float (*vertexCos_tmp)[3];
+	float *vertex_factor;
 	unsigned int i;
 
-	struct SmoothingData_Weighted {
-		float delta[3];
-		float edge_length_sum;
-	} *smooth_data = MEM_callocN((size_t)numVerts * sizeof(*smooth_data), __func__);
-
-
-	/* calculate as floats to avoid int->float conversion in #smooth_iter */
-	vertex_edge_count = MEM_callocN((size_t)numVerts * sizeof(float), __func__);
-	for (i = 0; i < numEdges; i++) {
-		vertex_edge_count[edges[i].v1] += 1.0f;
-		vertex_edge_count[edges[i].v2] += 1.0f;
+	if (iterations == 0) {
+		return;
 	}
 
+	vertex_factor = MEM_mallocN((size_t)numVerts * sizeof(float), __func__);
 
-	/* -------------------------------------------------------------------- */
-	/* Main Smoothing Loop */
+	/* a little confusing, but we can include 'lambda' and smoothing weight
+	 * here to avoid multiplying for every iteration */
+	for (i = 0; i < numVerts; i++) {
+		const float edge_count = topology->vert_edge_count[i];
+		const float weight = smooth_weights ? smooth_weights[i] : 1.0f;
 
-	while (iterations--) {
-		for (i = 0; i < numEdges; i++) {
-			struct SmoothingData_Weighted *sd_v1;
-			struct SmoothingData_Weighted *sd_v2;
-			float edge_dir[3];
-			float edge_dist;
+		if (use_length_weight) {
+			/* divided by the edge lengths & count when iterating */
+			vertex_factor[i] = weight * lambda;
+		}
+		else {
+			vertex_factor[i] = weight * lambda * (edge_count != 0.0f ? (1.0f / edge_count) : 1.0f);
+		}
+	}
 
-			sub_v3_v3v3(edge_dir, vertexCos[edges[i].v2], vertexCos[edges[i].v1]);
-			edge_dist = len_v3(edge_dir);
+	vertexCos_tmp = MEM_mallocN((size_t)numVerts * sizeof(*vertexCos_tmp), __func__);
 
-			/* weight by distance */
-			mul_v3_fl(edge_dir, edge_dist);
+	{
+		SmoothIterData data = {
+		    .topology = topology,
+		    .vertexCos_src = (const float (*)[3])vertexCos,
+		    .vertexCos_dst = vertexCos_tmp,
+		    .vertex_factor = vertex_factor,
+		};
+		const TaskParallelRangeFunc func = use_length_weight ?
+		                                   smooth_iter__length_weight_cb : smooth_iter__simple_cb;
 
+		/* -------------------------------------------------------------------- */
+		/* Main Smoothing Loop */
 
-			sd_v1 = &smooth_data[edges[i].v1];
-			sd_v2 = &smooth_data[edges[i].v2];
+		for (i = 0; i < iterations; i++) {
+			float (*vertexCos_swap)[3] = (float (*)[3])data.vertexCos_src;
 
-			add_v3_v3(sd_v1->delta, edge_dir);
-			sub_v3_v3(sd_v2->delta, edge_dir);
+			BLI_task_parallel_range(0, (int)numVerts, &data, func, numVerts > 1000);
 
-			sd_v1->edge_length_sum += edge_dist;
-			sd_v2->edge_length_sum += edge_dist;
+			data.vertexCos_src = (const float (*)[3])data.vertexCos_dst;
+			data.vertexCos_dst = vertexCos_swap;
 		}
 
-		if (smooth_weights == NULL) {
-			/* fast-path */
-			for (i = 0; i < numVerts; i++) {
-				struct SmoothingData_Weighted *sd = &smooth_data[i];
-				/* divide by sum of all neighbour distances (weighted) and amount of neighbors, (mean average) */
-				const float div = sd->edge_length_sum * vertex_edge_count[i];
-				if (div > eps) {
-#if 0
-					/* first calculate the new location */
-					mul_v3_fl(sd->delta, 1.0f / div);
-					/* then interpolate */
-					madd_v3_v3fl(vertexCos[i], sd->delta, lambda);
-#else
-					/* do this in one step */
-					madd_v3_v3fl(vertexCos[i], sd->delta, lambda / div);
-#endif
-				}
-				/* zero for the next iteration (saves memset on entire array) */
-				memset(sd, 0, sizeof(*sd));
-			}
-		}
-		else {
-			for (i = 0; i < numVerts; i++) {
-				struct SmoothingData_Weighted *sd = &smooth_data[i];
-				const float div = sd->edge_length_sum * vertex_edge_count[i];
-				if (div > eps) {
-					const float lambda_w = lambda * smooth_weights[i];
-					madd_v3_v3fl(vertexCos[i], sd->delta, lambda_w / div);
-				}
-
-				memset(sd, 0, sizeof(*sd));
-			}
+		/* the result of the last iteration is in 'vertexCos_src' */
+		if (data.vertexCos_src != (const float (*)[3])vertexCos) {
+			memcpy(vertexCos, data.vertexCos_src, (size_t)numVerts * sizeof(*vertexCos));
 		}
 	}
 
-	MEM_freeN(vertex_edge_count);
-	MEM_freeN(smooth_data);
-}
-
-
-static void smooth_iter(
-        CorrectiveSmoothModifierData *csmd, DerivedMesh *dm,
-        float (*vertexCos)[3], unsigned int numVerts,
-        const float *smooth_weights,
-        unsigned int iterations)
-{
-	switch (csmd->smooth_type) {
-		case MOD_CORRECTIVESMOOTH_SMOOTH_LENGTH_WEIGHT:
-			smooth_iter__length_weight(csmd, dm, vertexCos, numVerts, smooth_weights, iterations);
-			break;
-
-		/* case MOD_CORRECTIVESMOOTH_SMOOTH_SIMPLE: */
-		default:
-			smooth_iter__simple(csmd, dm, vertexCos, numVerts, smooth_weights, iterations);
-			break;
-	}
+	MEM_freeN(vertexCos_tmp);
+	MEM_freeN(vertex_factor);
 }
 
 static void smooth_verts(
@@ -378,9 +450,11 @@ static void smooth_verts(
         MDeformVert *dvert, const int defgrp_index,
         float (*vertexCos)[3], unsigned int numVerts)
 {
+	const bool use_boundary = (csmd->flag & MOD_CORRECTIVESMOOTH_PIN_BOUNDARY) != 0;
+	const CorrectiveSmoothTopology *topology = topology_cache_ensure(csmd, dm, numVerts, use_boundary);
 	float *smooth_weights = NULL;
 
-	if (dvert || (csmd->flag & MOD_CORRECTIVESMOOTH_PIN_BOUNDARY)) {
+	if (dvert || use_boundary) {
 
 		smooth_weights = MEM_mallocN(numVerts * sizeof(float), __func__);
 
@@ -394,12 +468,12 @@ static void smooth_verts(
 			copy_vn_fl(smooth_weights, (int)numVerts, 1.0f);
 		}
 
-		if (csmd->flag & MOD_CORRECTIVESMOOTH_PIN_BOUNDARY) {
-			dm_get_boundaries(dm, smooth_weights);
+		if (use_boundary) {
+			dm_get_boundaries(topology, smooth_weights);
 		}
 	}
 
-	smooth_iter(csmd, dm, vertexCos, numVerts, smooth_weights, (unsigned int)csmd->repeat);
+	smooth_iter(csmd, topology, vertexCos, numVerts, smooth_weights, (unsigned int)csmd->repeat);
 
 	if (smooth_weights) {
 		MEM_freeN(smooth_weights);
@@ -565,6 +639,26 @@ static void calc_deltas(
 }
 
 
+typedef struct DeltaApplyData {
+	float (*tangent_spaces)[3][3];
+	const float (*delta_cache)[3];
+	float (*vertexCos)[3];
+} DeltaApplyData;
+
+static void delta_apply_cb(void *userdata, const int index)
+{
+	const DeltaApplyData *data = userdata;
+	float delta[3];
+
+#ifdef USE_TANGENT_CALC_INLINE
+	calc_tangent_ortho(data->tangent_spaces[index]);
+#endif
+
+	mul_v3_m3v3(delta, data->tangent_spaces[index], data->delta_cache[index]);
+	add_v3_v3(data->vertexCos[index], delta);
+}
+
+
 static void correctivesmooth_modifier_do(
         ModifierData *md, Object *ob, DerivedMesh *dm,
         float (*vertexCos)[3], unsigned int numVerts,
@@ -675,8 +769,6 @@ static void correctivesmooth_modifier_do(
 	smooth_verts(csmd, dm, dvert, defgrp_index, vertexCos, numVerts);
 
 	{
-		unsigned int i;
-
 		float (*tangent_spaces)[3][3];
 
 		/* calloc, since values are accumulated */
@@ -684,15 +776,13 @@ static void correctivesmooth_modifier_do(
 
 		calc_tangent_spaces(dm, vertexCos, tangent_spaces);
 
-		for (i = 0; i < numVerts; i++) {
-			float delta[3];
-
-#ifdef USE_TANGENT_CALC_INLINE
-			calc_tangent_ortho(tangent_spaces[i]);
-#endif
-
-			mul_v3_m3v3(delta, tangent_spaces[i], csmd->delta_cache[i]);
-			add_v3_v3(vertexCos[i], delta);
+		{
+			DeltaApplyData data = {
+			    .tangent_spaces = tangent_spaces,
+			    .delta_cache = (const float (*)[3])csmd->delta_cache,
+			    .vertexCos = vertexCos,
+			};
+			BLI_task_parallel_range(0, (int)numVerts, &data, delta_apply_cb, numVerts > 1000);
 		}
 
 		MEM_freeN(tangent_spaces);
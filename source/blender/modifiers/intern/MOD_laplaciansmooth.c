@@ -32,7 +32,9 @@
 #include "DNA_meshdata_types.h"
 #include "DNA_object_types.h"
 
+#include "BLI_hash_mm2a.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "MEM_guardedalloc.h"
@@ -77,6 +79,15 @@ struct BLaplacianSystem {
 };
 typedef struct BLaplacianSystem LaplacianSystem;
 
+/* Kept between evaluations (see LaplacianSmoothModifierData.cache),
+ * the system is reused while the topology doesn't change,
+ * so the neighbor counts & the symbolic factorization of the solver don't have to be recalculated. */
+typedef struct LaplacianSmoothCache {
+	LaplacianSystem *sys;
+	/* hash of the edges, loops & polys the system was created for */
+	unsigned int topology_key;
+} LaplacianSmoothCache;
+
 static CustomDataMask required_data_mask(Object *ob, ModifierData *md);
 static bool is_disabled(ModifierData *md, int useRenderParams);
 static float compute_volume(const float center[3], float (*vertexCos)[3], const MPoly *mpoly, int numPolys, const MLoop *mloop);
@@ -84,8 +95,10 @@ static LaplacianSystem *init_laplacian_system(int a_numEdges, int a_numPolys, in
 static void copy_data(ModifierData *md, ModifierData *target);
 static void delete_laplacian_system(LaplacianSystem *sys);
 static void fill_laplacian_matrix(LaplacianSystem *sys);
+static void free_data(ModifierData *md);
 static void init_data(ModifierData *md);
 static void init_laplacian_matrix(LaplacianSystem *sys);
+static void init_laplacian_topology(LaplacianSystem *sys);
 static void memset_laplacian_system(LaplacianSystem *sys, int val);
 static void volume_preservation(LaplacianSystem *sys, float vini, float vend, short flag);
 static void validate_solution(LaplacianSystem *sys, short flag, float lambda, float lambda_border);
@@ -113,10 +126,9 @@ static void delete_laplacian_system(LaplacianSystem *sys)
 
 static void memset_laplacian_system(LaplacianSystem *sys, int val)
 {
+	/* numNeEd & numNeFa are only calculated from the topology (see #init_laplacian_topology) */
 	memset(sys->eweights,     val, sizeof(float) * sys->numEdges);
 	memset(sys->fweights,     val, sizeof(float[3]) * sys->numLoops);
-	memset(sys->numNeEd,      val, sizeof(short) * sys->numVerts);
-	memset(sys->numNeFa,      val, sizeof(short) * sys->numVerts);
 	memset(sys->ring_areas,   val, sizeof(float) * sys->numVerts);
 	memset(sys->vlengths,     val, sizeof(float) * sys->numVerts);
 	memset(sys->vweights,     val, sizeof(float) * sys->numVerts);
@@ -196,6 +208,20 @@ static void volume_preservation(LaplacianSystem *sys, float vini, float vend, sh
 	}
 }
 
+static void init_laplacian_topology(LaplacianSystem *sys)
+{
+	int i;
+
+	for (i = 0; i < sys->numEdges; i++) {
+		sys->numNeEd[sys->medges[i].v1] += 1;
+		sys->numNeEd[sys->medges[i].v2] += 1;
+	}
+
+	for (i = 0; i < sys->numLoops; i++) {
+		sys->numNeFa[sys->mloop[i].v] += 1;
+	}
+}
+
 static void init_laplacian_matrix(LaplacianSystem *sys)
 {
 	float *v1, *v2;
@@ -211,8 +237,6 @@ static void init_laplacian_matrix(LaplacianSystem *sys)
 		v1 = sys->vertexCos[idv1];
 		v2 = sys->vertexCos[idv2];
 
-		sys->numNeEd[idv1] = sys->numNeEd[idv1] + 1;
-		sys->numNeEd[idv2] = sys->numNeEd[idv2] + 1;
 		w1 = len_v3v3(v1, v2);
 		if (w1 < sys->min_area) {
 			sys->zerola[idv1] = 1;
@@ -241,8 +265,6 @@ static void init_laplacian_matrix(LaplacianSystem *sys)
 			const float *v_next = sys->vertexCos[l_next->v];
 			const unsigned int l_curr_index = l_curr - sys->mloop;
 
-			sys->numNeFa[l_curr->v] += 1;
-
 			areaf = area_tri_v3(v_prev, v_curr, v_next);
 
 			if (areaf < sys->min_area) {
@@ -327,35 +349,130 @@ static void fill_laplacian_matrix(LaplacianSystem *sys)
 	}
 }
 
-static void validate_solution(LaplacianSystem *sys, short flag, float lambda, float lambda_border)
+typedef struct ValidateSolutionData {
+	LaplacianSystem *sys;
+	short flag;
+	float lambda, lambda_border;
+} ValidateSolutionData;
+
+static void validate_solution_cb(void *userdata, const int i)
 {
-	int i;
+	const ValidateSolutionData *data = userdata;
+	LaplacianSystem *sys = data->sys;
+	const short flag = data->flag;
 	float lam;
+
+	if (sys->zerola[i] == 0) {
+		lam = sys->numNeEd[i] == sys->numNeFa[i] ? (data->lambda >= 0.0f ? 1.0f : -1.0f) : (data->lambda_border >= 0.0f ? 1.0f : -1.0f);
+		if (flag & MOD_LAPLACIANSMOOTH_X) {
+			sys->vertexCos[i][0] += lam * ((float)EIG_linear_solver_variable_get(sys->context, 0, i) - sys->vertexCos[i][0]);
+		}
+		if (flag & MOD_LAPLACIANSMOOTH_Y) {
+			sys->vertexCos[i][1] += lam * ((float)EIG_linear_solver_variable_get(sys->context, 1, i) - sys->vertexCos[i][1]);
+		}
+		if (flag & MOD_LAPLACIANSMOOTH_Z) {
+			sys->vertexCos[i][2] += lam * ((float)EIG_linear_solver_variable_get(sys->context, 2, i) - sys->vertexCos[i][2]);
+		}
+	}
+}
+
+static void validate_solution(LaplacianSystem *sys, short flag, float lambda, float lambda_border)
+{
 	float vini, vend;
+	ValidateSolutionData data = {
+	    .sys = sys,
+	    .flag = flag,
+	    .lambda = lambda,
+	    .lambda_border = lambda_border,
+	};
 
 	if (flag & MOD_LAPLACIANSMOOTH_PRESERVE_VOLUME) {
 		vini = compute_volume(sys->vert_centroid, sys->vertexCos, sys->mpoly, sys->numPolys, sys->mloop);
 	}
-	for (i = 0; i < sys->numVerts; i++) {
-		if (sys->zerola[i] == 0) {
-			lam = sys->numNeEd[i] == sys->numNeFa[i] ? (lambda >= 0.0f ? 1.0f : -1.0f) : (lambda_border >= 0.0f ? 1.0f : -1.0f);
-			if (flag & MOD_LAPLACIANSMOOTH_X) {
-				sys->vertexCos[i][0] += lam * ((float)EIG_linear_solver_variable_get(sys->context, 0, i) - sys->vertexCos[i][0]);
-			}
-			if (flag & MOD_LAPLACIANSMOOTH_Y) {
-				sys->vertexCos[i][1] += lam * ((float)EIG_linear_solver_variable_get(sys->context, 1, i) - sys->vertexCos[i][1]);
-			}
-			if (flag & MOD_LAPLACIANSMOOTH_Z) {
-				sys->vertexCos[i][2] += lam * ((float)EIG_linear_solver_variable_get(sys->context, 2, i) - sys->vertexCos[i][2]);
-			}
-		}
-	}
+
+	BLI_task_parallel_range(0, sys->numVerts, &data, validate_solution_cb, sys->numVerts > 1000);
+
 	if (flag & MOD_LAPLACIANSMOOTH_PRESERVE_VOLUME) {
 		vend = compute_volume(sys->vert_centroid, sys->vertexCos, sys->mpoly, sys->numPolys, sys->mloop);
 		volume_preservation(sys, vini, vend, flag);
 	}
 }
 
+static unsigned int laplacian_topology_key(DerivedMesh *dm)
+{
+	const int numEdges = dm->getNumEdges(dm);
+	const int numPolys = dm->getNumPolys(dm);
+	const MEdge *medge = dm->getEdgeArray(dm);
+	const MPoly *mpoly = dm->getPolyArray(dm);
+	BLI_HashMurmur2A mm2;
+	int i;
+
+	BLI_hash_mm2a_init(&mm2, 0);
+	/* only the indices, flags & crease don't change the topology */
+	for (i = 0; i < numEdges; i++) {
+		BLI_hash_mm2a_add(&mm2, (const unsigned char *)&medge[i].v1, sizeof(medge[i].v1) * 2);
+	}
+	for (i = 0; i < numPolys; i++) {
+		BLI_hash_mm2a_add_int(&mm2, mpoly[i].loopstart);
+		BLI_hash_mm2a_add_int(&mm2, mpoly[i].totloop);
+	}
+	BLI_hash_mm2a_add(&mm2, (const unsigned char *)dm->getLoopArray(dm), sizeof(MLoop) * (size_t)dm->getNumLoops(dm));
+
+	return BLI_hash_mm2a_end(&mm2);
+}
+
+static void laplacian_cache_free(LaplacianSmoothModifierData *smd)
+{
+	if (smd->cache) {
+		delete_laplacian_system(smd->cache->sys);
+		MEM_freeN(smd->cache);
+		smd->cache = NULL;
+	}
+}
+
+/**
+ * Get the system of the previous evaluation when the topology is unchanged, otherwise create a new one.
+ */
+static LaplacianSystem *laplacian_system_ensure(LaplacianSmoothModifierData *smd, DerivedMesh *dm, int numVerts)
+{
+	const unsigned int topology_key = laplacian_topology_key(dm);
+	LaplacianSystem *sys;
+
+	if (smd->cache) {
+		sys = smd->cache->sys;
+		if ((smd->cache->topology_key != topology_key) ||
+		    (sys->numVerts != numVerts) ||
+		    (sys->numEdges != dm->getNumEdges(dm)) ||
+		    (sys->numPolys != dm->getNumPolys(dm)) ||
+		    (sys->numLoops != dm->getNumLoops(dm)))
+		{
+			laplacian_cache_free(smd);
+		}
+	}
+
+	if (smd->cache == NULL) {
+		sys = init_laplacian_system(dm->getNumEdges(dm), dm->getNumPolys(dm), dm->getNumLoops(dm), numVerts);
+		sys->mpoly = dm->getPolyArray(dm);
+		sys->mloop = dm->getLoopArray(dm);
+		sys->medges = dm->getEdgeArray(dm);
+		init_laplacian_topology(sys);
+		sys->context = EIG_linear_least_squares_solver_new(numVerts, numVerts, 3);
+
+		smd->cache = MEM_mallocN(sizeof(*smd->cache), __func__);
+		smd->cache->sys = sys;
+		smd->cache->topology_key = topology_key;
+	}
+	else {
+		sys = smd->cache->sys;
+		sys->mpoly = dm->getPolyArray(dm);
+		sys->mloop = dm->getLoopArray(dm);
+		sys->medges = dm->getEdgeArray(dm);
+		EIG_linear_solver_matrix_reset(sys->context);
+	}
+
+	return sys;
+}
+
 static void laplaciansmoothModifier_do(
         LaplacianSmoothModifierData *smd, Object *ob, DerivedMesh *dm,
         float (*vertexCos)[3], int numVerts)
@@ -367,14 +484,8 @@ static void laplaciansmoothModifier_do(
 	int i, iter;
 	int defgrp_index;
 
-	sys = init_laplacian_system(dm->getNumEdges(dm), dm->getNumPolys(dm), dm->getNumLoops(dm), numVerts);
-	if (!sys) {
-		return;
-	}
+	sys = laplacian_system_ensure(smd, dm, numVerts);
 
-	sys->mpoly = dm->getPolyArray(dm);
-	sys->mloop = dm->getLoopArray(dm);
-	sys->medges = dm->getEdgeArray(dm);
 	sys->vertexCos = vertexCos;
 	sys->min_area = 0.00001f;
 	modifier_get_vgroup(ob, dm, smd->defgrp_name, &dvert, &defgrp_index);
@@ -384,8 +495,6 @@ static void laplaciansmoothModifier_do(
 	sys->vert_centroid[2] = 0.0f;
 	memset_laplacian_system(sys, 0);
 
-	sys->context = EIG_linear_least_squares_solver_new(numVerts, numVerts, 3);
-
 	init_laplacian_matrix(sys);
 
 	for (iter = 0; iter < smd->repeat; iter++) {
@@ -456,10 +565,12 @@ static void laplaciansmoothModifier_do(
 			validate_solution(sys, smd->flag, smd->lambda, smd->lambda_border);
 		}
 	}
-	EIG_linear_solver_delete(sys->context);
-	sys->context = NULL;
 
-	delete_laplacian_system(sys);
+	/* the system is kept for the next evaluation, clear pointers to the derived mesh */
+	sys->vertexCos = NULL;
+	sys->mpoly = NULL;
+	sys->mloop = NULL;
+	sys->medges = NULL;
 }
 
 static void init_data(ModifierData *md)
@@ -470,16 +581,23 @@ static void init_data(ModifierData *md)
 	smd->repeat = 1;
 	smd->flag = MOD_LAPLACIANSMOOTH_X | MOD_LAPLACIANSMOOTH_Y | MOD_LAPLACIANSMOOTH_Z | MOD_LAPLACIANSMOOTH_PRESERVE_VOLUME | MOD_LAPLACIANSMOOTH_NORMALIZED;
 	smd->defgrp_name[0] = '\0';
+	smd->cache = NULL;
 }
 
 static void copy_data(ModifierData *md, ModifierData *target)
 {
-#if 0
-	LaplacianSmoothModifierData *smd = (LaplacianSmoothModifierData *) md;
 	LaplacianSmoothModifierData *tsmd = (LaplacianSmoothModifierData *) target;
-#endif
 
 	modifier_copyData_generic(md, target);
+
+	tsmd->cache = NULL;
+}
+
+static void free_data(ModifierData *md)
+{
+	LaplacianSmoothModifierData *smd = (LaplacianSmoothModifierData *) md;
+
+	laplacian_cache_free(smd);
 }
 
 static bool is_disabled(ModifierData *md, int UNUSED(useRenderParams))
@@ -559,7 +677,7 @@ ModifierTypeInfo modifierType_LaplacianSmooth = {
 	/* applyModifierEM */   NULL,
 	/* initData */          init_data,
 	/* requiredDataMask */  required_data_mask,
-	/* freeData */          NULL,
+	/* freeData */          free_data,
 	/* isDisabled */        is_disabled,
 	/* updateDepgraph */    NULL,
 	/* updateDepsgraph */   NULL,
@@ -37,6 +37,7 @@
 #include "BLI_math.h"
 
 #include "BKE_DerivedMesh.h"
+#include "BKE_cache_prefetch.h"
 #include "BKE_scene.h"
 #include "BKE_global.h"
 #include "BKE_mesh.h"
@@ -87,6 +88,65 @@ static bool isDisabled(ModifierData *md, int UNUSED(useRenderParams))
 	return (mcmd->factor <= 0.0f) || (mcmd->filepath[0] == '\0');
 }
 
+/* time in the file for the scene frame (MOD_MESHCACHE_PLAY_CFEA) */
+static float meshcache_time_from_frame(MeshCacheModifierData *mcmd, const float cfra, const float fps)
+{
+	float time;
+
+	switch (mcmd->time_mode) {
+		case MOD_MESHCACHE_TIME_FRAME:
+		{
+			time = cfra;
+			break;
+		}
+		case MOD_MESHCACHE_TIME_SECONDS:
+		{
+			time = cfra / fps;
+			break;
+		}
+		case MOD_MESHCACHE_TIME_FACTOR:
+		default:
+		{
+			time = cfra / fps;
+			break;
+		}
+	}
+
+	/* apply offset and scale */
+	return (mcmd->frame_scale * time) - mcmd->frame_start;
+}
+
+/* request the file data for the next scene frames to be read in the background during playback */
+static void meshcache_prefetch(
+        MeshCacheModifierData *mcmd, const char *filepath, const int numVerts,
+        const float cfra, const float fps)
+{
+	int step, i;
+	const int depth = BKE_cache_prefetch_depth(&step);
+	float *times;
+
+	if (depth == 0 || mcmd->play_mode != MOD_MESHCACHE_PLAY_CFEA) {
+		return;
+	}
+
+	times = MEM_mallocN(sizeof(float) * depth, __func__);
+
+	for (i = 0; i < depth; i++) {
+		times[i] = meshcache_time_from_frame(mcmd, cfra + (float)(step * (i + 1)), fps);
+	}
+
+	switch (mcmd->type) {
+		case MOD_MESHCACHE_TYPE_MDD:
+			MOD_meshcache_prefetch_mdd_times(filepath, numVerts, mcmd->interp, times, depth, fps, mcmd->time_mode);
+			break;
+		case MOD_MESHCACHE_TYPE_PC2:
+			MOD_meshcache_prefetch_pc2_times(filepath, numVerts, mcmd->interp, times, depth, fps, mcmd->time_mode);
+			break;
+	}
+
+	MEM_freeN(times);
+}
+
 
 static void meshcache_do(
         MeshCacheModifierData *mcmd, Object *ob, DerivedMesh *UNUSED(dm),
@@ -98,6 +158,7 @@ static void meshcache_do(
 	float (*vertexCos)[3] = vertexCos_Store ? vertexCos_Store : vertexCos_Real;
 
 	Scene *scene = mcmd->modifier.scene;
+	const float cfra = BKE_scene_frame_get(scene);
 	const float fps = FPS;
 
 	char filepath[FILE_MAX];
@@ -110,29 +171,7 @@ static void meshcache_do(
 	/* -------------------------------------------------------------------- */
 	/* Interpret Time (the reading functions also do some of this ) */
 	if (mcmd->play_mode == MOD_MESHCACHE_PLAY_CFEA) {
-		const float cfra = BKE_scene_frame_get(scene);
-
-		switch (mcmd->time_mode) {
-			case MOD_MESHCACHE_TIME_FRAME:
-			{
-				time = cfra;
-				break;
-			}
-			case MOD_MESHCACHE_TIME_SECONDS:
-			{
-				time = cfra / fps;
-				break;
-			}
-			case MOD_MESHCACHE_TIME_FACTOR:
-			default:
-			{
-				time = cfra / fps;
-				break;
-			}
-		}
-
-		/* apply offset and scale */
-		time = (mcmd->frame_scale * time) - mcmd->frame_start;
+		time = meshcache_time_from_frame(mcmd, cfra, fps);
 	}
 	else {  /*  if (mcmd->play_mode == MOD_MESHCACHE_PLAY_EVAL) { */
 		switch (mcmd->time_mode) {
@@ -177,6 +216,10 @@ static void meshcache_do(
 			break;
 	}
 
+	if (ok) {
+		meshcache_prefetch(mcmd, filepath, numVerts, cfra, fps);
+	}
+
 
 	/* -------------------------------------------------------------------- */
 	/* tricky shape key integration (slow!) */
@@ -28,6 +28,8 @@
 #include <string.h>
 #include <errno.h>
 
+#include "MEM_guardedalloc.h"
+
 #include "BLI_sys_types.h"
 #include "BLI_utildefines.h"
 #include "BLI_fileops.h"
@@ -97,34 +99,23 @@ static bool meshcache_read_mdd_range(FILE *fp,
 	return true;
 }
 
-static bool meshcache_read_mdd_range_from_time(FILE *fp,
-                                               const int verts_tot,
-                                               const float time, const float UNUSED(fps),
-                                               float *r_frame,
-                                               const char **err_str)
+/* frame of the file at time, \a f_times reaches up to the first frame at or after \a time */
+static float meshcache_mdd_frame_from_time_table(const float *f_times, const int f_times_len, const float time)
 {
-	MDDHead mdd_head;
 	int i;
-	float f_time, f_time_prev = FLT_MAX;
+	float f_time = 0.0f, f_time_prev = FLT_MAX;
 	float frame;
 
-	if (meshcache_read_mdd_head(fp, verts_tot, &mdd_head, err_str) == false) {
-		return false;
-	}
-
-	for (i = 0; i < mdd_head.frame_tot; i++) {
-		fread(&f_time, sizeof(float), 1, fp);
-#ifdef __LITTLE_ENDIAN__
-		BLI_endian_switch_float(&f_time);
-#endif
+	for (i = 0; i < f_times_len; i++) {
+		f_time = f_times[i];
 		if (f_time >= time) {
 			break;
 		}
 		f_time_prev = f_time;
 	}
 
-	if (i == mdd_head.frame_tot) {
-		frame = (float)(mdd_head.frame_tot - 1);
+	if (i == f_times_len) {
+		frame = (float)(f_times_len - 1);
 	}
 	if (UNLIKELY(f_time_prev == FLT_MAX)) {
 		frame = 0.0f;
@@ -140,16 +131,64 @@ static bool meshcache_read_mdd_range_from_time(FILE *fp,
 		}
 	}
 
-	*r_frame = frame;
+	return frame;
+}
+
+/**
+ * Read the times of the frames following the header,
+ * up to the first one at or after \a time_max (the file is only read as far as needed).
+ */
+static float *meshcache_read_mdd_time_table(FILE *fp, const MDDHead *mdd_head, const float time_max,
+                                            int *r_times_len)
+{
+	float *f_times = MEM_mallocN(sizeof(float) * (size_t)mdd_head->frame_tot, __func__);
+	int i;
+
+	for (i = 0; i < mdd_head->frame_tot; i++) {
+		if (!fread(&f_times[i], sizeof(float), 1, fp)) {
+			break;
+		}
+#ifdef __LITTLE_ENDIAN__
+		BLI_endian_switch_float(&f_times[i]);
+#endif
+		if (f_times[i] >= time_max) {
+			i++;
+			break;
+		}
+	}
+
+	*r_times_len = i;
+	return f_times;
+}
+
+static bool meshcache_read_mdd_range_from_time(FILE *fp,
+                                               const int verts_tot,
+                                               const float time, const float UNUSED(fps),
+                                               float *r_frame,
+                                               const char **err_str)
+{
+	MDDHead mdd_head;
+	float *f_times;
+	int f_times_len;
+
+	if (meshcache_read_mdd_head(fp, verts_tot, &mdd_head, err_str) == false) {
+		return false;
+	}
+
+	f_times = meshcache_read_mdd_time_table(fp, &mdd_head, time, &f_times_len);
+	*r_frame = meshcache_mdd_frame_from_time_table(f_times, f_times_len, time);
+
+	MEM_freeN(f_times);
 	return true;
 }
 
-bool MOD_meshcache_read_mdd_index(FILE *fp,
+bool MOD_meshcache_read_mdd_index(FILE *fp, const char *filepath,
                                   float (*vertexCos)[3], const int verts_tot,
                                   const int index, const float factor,
                                   const char **err_str)
 {
 	MDDHead mdd_head;
+	float *vco_file;
 
 	if (meshcache_read_mdd_head(fp, verts_tot, &mdd_head, err_str) == false) {
 		return false;
@@ -165,54 +204,39 @@ bool MOD_meshcache_read_mdd_index(FILE *fp,
 		return false;
 	}
 
+	vco_file = MOD_meshcache_read_coords(fp, filepath, mdd_head.verts_tot);
+
+	if (vco_file == NULL) {
+		*err_str = errno ? strerror(errno) : "Failed to read frame";
+		return false;
+	}
+
+#ifdef __LITTLE_ENDIAN__
+	BLI_endian_switch_float_array(vco_file, mdd_head.verts_tot * 3);
+#endif
+
 	if (factor >= 1.0f) {
-#if 1
-		float *vco = *vertexCos;
-		unsigned int i;
-		for (i = mdd_head.verts_tot; i != 0 ; i--, vco += 3) {
-			fread(vco, sizeof(float) * 3, 1, fp);
-
-#  ifdef __LITTLE_ENDIAN__
-			BLI_endian_switch_float(vco + 0);
-			BLI_endian_switch_float(vco + 1);
-			BLI_endian_switch_float(vco + 2);
-#  endif  /* __LITTLE_ENDIAN__ */
-		}
-#else
 		/* no blending */
-		if (!fread(vertexCos, sizeof(float) * 3, mdd_head.verts_tot, f)) {
-			*err_str = errno ? strerror(errno) : "Failed to read frame";
-			return false;
-		}
-#  ifdef __LITTLE_ENDIAN__
-		BLI_endian_switch_float_array(vertexCos[0], mdd_head.verts_tot * 3);
-#  endif
-#endif
+		memcpy(vertexCos, vco_file, sizeof(float[3]) * mdd_head.verts_tot);
 	}
 	else {
 		const float ifactor = 1.0f - factor;
+		const float *tvec = vco_file;
 		float *vco = *vertexCos;
 		unsigned int i;
-		for (i = mdd_head.verts_tot; i != 0 ; i--, vco += 3) {
-			float tvec[3];
-			fread(tvec, sizeof(float) * 3, 1, fp);
-
-#ifdef __LITTLE_ENDIAN__
-			BLI_endian_switch_float(tvec + 0);
-			BLI_endian_switch_float(tvec + 1);
-			BLI_endian_switch_float(tvec + 2);
-#endif
-
+		for (i = mdd_head.verts_tot; i != 0 ; i--, vco += 3, tvec += 3) {
 			vco[0] = (vco[0] * ifactor) + (tvec[0] * factor);
 			vco[1] = (vco[1] * ifactor) + (tvec[1] * factor);
 			vco[2] = (vco[2] * ifactor) + (tvec[2] * factor);
 		}
 	}
 
+	MEM_freeN(vco_file);
+
 	return true;
 }
 
-bool MOD_meshcache_read_mdd_frame(FILE *fp,
+bool MOD_meshcache_read_mdd_frame(FILE *fp, const char *filepath,
                                   float (*vertexCos)[3], const int verts_tot, const char interp,
                                   const float frame,
                                   const char **err_str)
@@ -230,7 +254,7 @@ bool MOD_meshcache_read_mdd_frame(FILE *fp,
 	if (index_range[0] == index_range[1]) {
 		/* read single */
 		if ((fseek(fp, 0, SEEK_SET) == 0) &&
-		    MOD_meshcache_read_mdd_index(fp, vertexCos, verts_tot, index_range[0], 1.0f, err_str))
+		    MOD_meshcache_read_mdd_index(fp, filepath, vertexCos, verts_tot, index_range[0], 1.0f, err_str))
 		{
 			return true;
 		}
@@ -241,9 +265,9 @@ bool MOD_meshcache_read_mdd_frame(FILE *fp,
 	else {
 		/* read both and interpolate */
 		if ((fseek(fp, 0, SEEK_SET) == 0) &&
-		    MOD_meshcache_read_mdd_index(fp, vertexCos, verts_tot, index_range[0], 1.0f, err_str) &&
+		    MOD_meshcache_read_mdd_index(fp, filepath, vertexCos, verts_tot, index_range[0], 1.0f, err_str) &&
 		    (fseek(fp, 0, SEEK_SET) == 0) &&
-		    MOD_meshcache_read_mdd_index(fp, vertexCos, verts_tot, index_range[1], factor, err_str))
+		    MOD_meshcache_read_mdd_index(fp, filepath, vertexCos, verts_tot, index_range[1], factor, err_str))
 		{
 			return true;
 		}
@@ -253,32 +277,23 @@ bool MOD_meshcache_read_mdd_frame(FILE *fp,
 	}
 }
 
-bool MOD_meshcache_read_mdd_times(const char *filepath,
-                                  float (*vertexCos)[3], const int verts_tot, const char interp,
-                                  const float time, const float fps, const char time_mode,
-                                  const char **err_str)
+/* frame of the file at time, fp is rewound when the file is read */
+static bool meshcache_read_mdd_frame_from_time(FILE *fp,
+                                               const int verts_tot,
+                                               const float time, const float fps, const char time_mode,
+                                               float *r_frame,
+                                               const char **err_str)
 {
-	float frame;
-
-	FILE *fp = BLI_fopen(filepath, "rb");
-	bool ok;
-
-	if (fp == NULL) {
-		*err_str = errno ? strerror(errno) : "Unknown error opening file";
-		return false;
-	}
-
 	switch (time_mode) {
 		case MOD_MESHCACHE_TIME_FRAME:
 		{
-			frame = time;
+			*r_frame = time;
 			break;
 		}
 		case MOD_MESHCACHE_TIME_SECONDS:
 		{
 			/* we need to find the closest time */
-			if (meshcache_read_mdd_range_from_time(fp, verts_tot, time, fps, &frame, err_str) == false) {
-				fclose(fp);
+			if (meshcache_read_mdd_range_from_time(fp, verts_tot, time, fps, r_frame, err_str) == false) {
 				return false;
 			}
 			rewind(fp);
@@ -289,18 +304,96 @@ bool MOD_meshcache_read_mdd_times(const char *filepath,
 		{
 			MDDHead mdd_head;
 			if (meshcache_read_mdd_head(fp, verts_tot, &mdd_head, err_str) == false) {
-				fclose(fp);
 				return false;
 			}
 
-			frame = CLAMPIS(time, 0.0f, 1.0f) * (float)mdd_head.frame_tot;
+			*r_frame = CLAMPIS(time, 0.0f, 1.0f) * (float)mdd_head.frame_tot;
 			rewind(fp);
 			break;
 		}
 	}
 
-	ok = MOD_meshcache_read_mdd_frame(fp, vertexCos, verts_tot, interp, frame, err_str);
+	return true;
+}
+
+bool MOD_meshcache_read_mdd_times(const char *filepath,
+                                  float (*vertexCos)[3], const int verts_tot, const char interp,
+                                  const float time, const float fps, const char time_mode,
+                                  const char **err_str)
+{
+	float frame;
+
+	FILE *fp = BLI_fopen(filepath, "rb");
+	bool ok;
+
+	if (fp == NULL) {
+		*err_str = errno ? strerror(errno) : "Unknown error opening file";
+		return false;
+	}
+
+	ok = (meshcache_read_mdd_frame_from_time(fp, verts_tot, time, fps, time_mode, &frame, err_str) &&
+	      MOD_meshcache_read_mdd_frame(fp, filepath, vertexCos, verts_tot, interp, frame, err_str));
 
 	fclose(fp);
 	return ok;
 }
+
+/**
+ * Request the frames needed at \a times to be read in the background,
+ * the first time is one scene frame ahead, the next two, and so on.
+ */
+void MOD_meshcache_prefetch_mdd_times(const char *filepath,
+                                      const int verts_tot, const char interp,
+                                      const float *times, const int times_len, const float UNUSED(fps), const char time_mode)
+{
+	FILE *fp = BLI_fopen(filepath, "rb");
+	const char *err_str = NULL;
+	MDDHead mdd_head;
+	float *f_times = NULL;
+	int f_times_len = 0;
+	int i;
+
+	if (fp == NULL) {
+		return;
+	}
+
+	/* the header and time table are read once for all times */
+	if (meshcache_read_mdd_head(fp, verts_tot, &mdd_head, &err_str)) {
+		const size_t offset = sizeof(MDDHead) + sizeof(int) * (size_t)mdd_head.frame_tot;
+
+		if (time_mode == MOD_MESHCACHE_TIME_SECONDS) {
+			float time_max = times[0];
+			for (i = 1; i < times_len; i++) {
+				time_max = max_ff(time_max, times[i]);
+			}
+			f_times = meshcache_read_mdd_time_table(fp, &mdd_head, time_max, &f_times_len);
+		}
+
+		for (i = 0; i < times_len; i++) {
+			int index_range[2];
+			float frame, factor;
+
+			switch (time_mode) {
+				case MOD_MESHCACHE_TIME_FRAME:
+					frame = times[i];
+					break;
+				case MOD_MESHCACHE_TIME_SECONDS:
+					frame = meshcache_mdd_frame_from_time_table(f_times, f_times_len, times[i]);
+					break;
+				case MOD_MESHCACHE_TIME_FACTOR:
+				default:
+					frame = CLAMPIS(times[i], 0.0f, 1.0f) * (float)mdd_head.frame_tot;
+					break;
+			}
+
+			MOD_meshcache_calc_range(frame, interp, mdd_head.frame_tot, index_range, &factor);
+			MOD_meshcache_prefetch_range(filepath, offset, verts_tot, index_range, i + 1);
+		}
+	}
+
+	if (f_times) {
+		MEM_freeN(f_times);
+	}
+
+	fclose(fp);
+}
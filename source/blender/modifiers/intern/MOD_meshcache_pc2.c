@@ -28,6 +28,8 @@
 #include <string.h>
 #include <errno.h>
 
+#include "MEM_guardedalloc.h"
+
 #include "BLI_sys_types.h"
 #include "BLI_utildefines.h"
 #include "BLI_fileops.h"
@@ -109,6 +111,21 @@ static bool meshcache_read_pc2_range(FILE *fp,
 	return true;
 }
 
+/* frame of the file at time in seconds */
+static float meshcache_pc2_frame_from_time(const PC2Head *pc2_head, const float time, const float fps)
+{
+	float frame = ((time / fps) - pc2_head->start) / pc2_head->sampling;
+
+	if (frame >= pc2_head->frame_tot) {
+		frame = (float)(pc2_head->frame_tot - 1);
+	}
+	else if (frame < 0.0f) {
+		frame = 0.0f;
+	}
+
+	return frame;
+}
+
 static bool meshcache_read_pc2_range_from_time(FILE *fp,
                                                const int verts_tot,
                                                const float time, const float fps,
@@ -116,79 +133,65 @@ static bool meshcache_read_pc2_range_from_time(FILE *fp,
                                                const char **err_str)
 {
 	PC2Head pc2_head;
-	float frame;
 
 	if (meshcache_read_pc2_head(fp, verts_tot, &pc2_head, err_str) == false) {
 		return false;
 	}
 
-	frame = ((time / fps) - pc2_head.start) / pc2_head.sampling;
-
-	if (frame >= pc2_head.frame_tot) {
-		frame = (float)(pc2_head.frame_tot - 1);
-	}
-	else if (frame < 0.0f) {
-		frame = 0.0f;
-	}
-
-	*r_frame = frame;
+	*r_frame = meshcache_pc2_frame_from_time(&pc2_head, time, fps);
 	return true;
 }
 
-bool MOD_meshcache_read_pc2_index(FILE *fp,
+bool MOD_meshcache_read_pc2_index(FILE *fp, const char *filepath,
                                   float (*vertexCos)[3], const int verts_tot,
                                   const int index, const float factor,
                                   const char **err_str)
 {
 	PC2Head pc2_head;
+	float *vco_file;
 
 	if (meshcache_read_pc2_head(fp, verts_tot, &pc2_head, err_str) == false) {
 		return false;
 	}
 
-	if (fseek(fp, sizeof(float) * 3 * index * pc2_head.verts_tot , SEEK_CUR) != 0) {
+	if (fseek(fp, sizeof(float) * 3 * index * pc2_head.verts_tot, SEEK_CUR) != 0) {
 		*err_str = "Failed to seek frame";
 		return false;
 	}
 
+	vco_file = MOD_meshcache_read_coords(fp, filepath, pc2_head.verts_tot);
+
+	if (vco_file == NULL) {
+		*err_str = errno ? strerror(errno) : "Failed to read frame";
+		return false;
+	}
+
+#ifdef __BIG_ENDIAN__
+	BLI_endian_switch_float_array(vco_file, pc2_head.verts_tot * 3);
+#endif
+
 	if (factor >= 1.0f) {
-		float *vco = *vertexCos;
-		unsigned int i;
-		for (i = pc2_head.verts_tot; i != 0 ; i--, vco += 3) {
-			fread(vco, sizeof(float) * 3, 1, fp);
-
-#  ifdef __BIG_ENDIAN__
-			BLI_endian_switch_float(vco + 0);
-			BLI_endian_switch_float(vco + 1);
-			BLI_endian_switch_float(vco + 2);
-#  endif  /* __BIG_ENDIAN__ */
-		}
+		/* no blending */
+		memcpy(vertexCos, vco_file, sizeof(float[3]) * pc2_head.verts_tot);
 	}
 	else {
 		const float ifactor = 1.0f - factor;
+		const float *tvec = vco_file;
 		float *vco = *vertexCos;
 		unsigned int i;
-		for (i = pc2_head.verts_tot; i != 0 ; i--, vco += 3) {
-			float tvec[3];
-			fread(tvec, sizeof(float) * 3, 1, fp);
-
-#ifdef __BIG_ENDIAN__
-			BLI_endian_switch_float(tvec + 0);
-			BLI_endian_switch_float(tvec + 1);
-			BLI_endian_switch_float(tvec + 2);
-#endif  /* __BIG_ENDIAN__ */
-
+		for (i = pc2_head.verts_tot; i != 0 ; i--, vco += 3, tvec += 3) {
 			vco[0] = (vco[0] * ifactor) + (tvec[0] * factor);
 			vco[1] = (vco[1] * ifactor) + (tvec[1] * factor);
 			vco[2] = (vco[2] * ifactor) + (tvec[2] * factor);
 		}
 	}
 
+	MEM_freeN(vco_file);
+
 	return true;
 }
 
-
-bool MOD_meshcache_read_pc2_frame(FILE *fp,
+bool MOD_meshcache_read_pc2_frame(FILE *fp, const char *filepath,
                                   float (*vertexCos)[3], const int verts_tot, const char interp,
                                   const float frame,
                                   const char **err_str)
@@ -206,7 +209,7 @@ bool MOD_meshcache_read_pc2_frame(FILE *fp,
 	if (index_range[0] == index_range[1]) {
 		/* read single */
 		if ((fseek(fp, 0, SEEK_SET) == 0) &&
-		    MOD_meshcache_read_pc2_index(fp, vertexCos, verts_tot, index_range[0], 1.0f, err_str))
+		    MOD_meshcache_read_pc2_index(fp, filepath, vertexCos, verts_tot, index_range[0], 1.0f, err_str))
 		{
 			return true;
 		}
@@ -217,9 +220,9 @@ bool MOD_meshcache_read_pc2_frame(FILE *fp,
 	else {
 		/* read both and interpolate */
 		if ((fseek(fp, 0, SEEK_SET) == 0) &&
-		    MOD_meshcache_read_pc2_index(fp, vertexCos, verts_tot, index_range[0], 1.0f, err_str) &&
+		    MOD_meshcache_read_pc2_index(fp, filepath, vertexCos, verts_tot, index_range[0], 1.0f, err_str) &&
 		    (fseek(fp, 0, SEEK_SET) == 0) &&
-		    MOD_meshcache_read_pc2_index(fp, vertexCos, verts_tot, index_range[1], factor, err_str))
+		    MOD_meshcache_read_pc2_index(fp, filepath, vertexCos, verts_tot, index_range[1], factor, err_str))
 		{
 			return true;
 		}
@@ -229,32 +232,23 @@ bool MOD_meshcache_read_pc2_frame(FILE *fp,
 	}
 }
 
-bool MOD_meshcache_read_pc2_times(const char *filepath,
-                                  float (*vertexCos)[3], const int verts_tot, const char interp,
-                                  const float time, const float fps, const char time_mode,
-                                  const char **err_str)
+/* frame of the file at time, fp is rewound when the file is read */
+static bool meshcache_read_pc2_frame_from_time(FILE *fp,
+                                               const int verts_tot,
+                                               const float time, const float fps, const char time_mode,
+                                               float *r_frame,
+                                               const char **err_str)
 {
-	float frame;
-
-	FILE *fp = BLI_fopen(filepath, "rb");
-	bool ok;
-
-	if (fp == NULL) {
-		*err_str = errno ? strerror(errno) : "Unknown error opening file";
-		return false;
-	}
-
 	switch (time_mode) {
 		case MOD_MESHCACHE_TIME_FRAME:
 		{
-			frame = time;
+			*r_frame = time;
 			break;
 		}
 		case MOD_MESHCACHE_TIME_SECONDS:
 		{
 			/* we need to find the closest time */
-			if (meshcache_read_pc2_range_from_time(fp, verts_tot, time, fps, &frame, err_str) == false) {
-				fclose(fp);
+			if (meshcache_read_pc2_range_from_time(fp, verts_tot, time, fps, r_frame, err_str) == false) {
 				return false;
 			}
 			rewind(fp);
@@ -265,18 +259,82 @@ bool MOD_meshcache_read_pc2_times(const char *filepath,
 		{
 			PC2Head pc2_head;
 			if (meshcache_read_pc2_head(fp, verts_tot, &pc2_head, err_str) == false) {
-				fclose(fp);
 				return false;
 			}
 
-			frame = CLAMPIS(time, 0.0f, 1.0f) * (float)pc2_head.frame_tot;
+			*r_frame = CLAMPIS(time, 0.0f, 1.0f) * (float)pc2_head.frame_tot;
 			rewind(fp);
 			break;
 		}
 	}
 
-	ok = MOD_meshcache_read_pc2_frame(fp, vertexCos, verts_tot, interp, frame, err_str);
+	return true;
+}
+
+bool MOD_meshcache_read_pc2_times(const char *filepath,
+                                  float (*vertexCos)[3], const int verts_tot, const char interp,
+                                  const float time, const float fps, const char time_mode,
+                                  const char **err_str)
+{
+	float frame;
+
+	FILE *fp = BLI_fopen(filepath, "rb");
+	bool ok;
+
+	if (fp == NULL) {
+		*err_str = errno ? strerror(errno) : "Unknown error opening file";
+		return false;
+	}
+
+	ok = (meshcache_read_pc2_frame_from_time(fp, verts_tot, time, fps, time_mode, &frame, err_str) &&
+	      MOD_meshcache_read_pc2_frame(fp, filepath, vertexCos, verts_tot, interp, frame, err_str));
 
 	fclose(fp);
 	return ok;
 }
+
+/**
+ * Request the frames needed at \a times to be read in the background,
+ * the first time is one scene frame ahead, the next two, and so on.
+ */
+void MOD_meshcache_prefetch_pc2_times(const char *filepath,
+                                      const int verts_tot, const char interp,
+                                      const float *times, const int times_len, const float fps, const char time_mode)
+{
+	FILE *fp = BLI_fopen(filepath, "rb");
+	const char *err_str = NULL;
+	PC2Head pc2_head;
+	int i;
+
+	if (fp == NULL) {
+		return;
+	}
+
+	/* the header is read once for all times */
+	if (meshcache_read_pc2_head(fp, verts_tot, &pc2_head, &err_str)) {
+		const size_t offset = sizeof(PC2Head);
+
+		for (i = 0; i < times_len; i++) {
+			int index_range[2];
+			float frame, factor;
+
+			switch (time_mode) {
+				case MOD_MESHCACHE_TIME_FRAME:
+					frame = times[i];
+					break;
+				case MOD_MESHCACHE_TIME_SECONDS:
+					frame = meshcache_pc2_frame_from_time(&pc2_head, times[i], fps);
+					break;
+				case MOD_MESHCACHE_TIME_FACTOR:
+				default:
+					frame = CLAMPIS(times[i], 0.0f, 1.0f) * (float)pc2_head.frame_tot;
+					break;
+			}
+
+			MOD_meshcache_calc_range(frame, interp, pc2_head.frame_tot, index_range, &factor);
+			MOD_meshcache_prefetch_range(filepath, offset, verts_tot, index_range, i + 1);
+		}
+	}
+
+	fclose(fp);
+}
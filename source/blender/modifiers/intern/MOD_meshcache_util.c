@@ -24,11 +24,17 @@
  *  \ingroup modifiers
  */
 
+#include <stdio.h>
+
+#include "MEM_guardedalloc.h"
+
 #include "BLI_utildefines.h"
 #include "BLI_math.h"
 
 #include "DNA_modifier_types.h"
 
+#include "BKE_cache_prefetch.h"
+
 #include "MOD_meshcache_util.h"
 
 void MOD_meshcache_calc_range(const float frame, const char interp,
@@ -69,3 +75,48 @@ void MOD_meshcache_calc_range(const float frame, const char interp,
 		}
 	}
 }
+
+/**
+ * Read the vertex coordinates of one frame at the current position of \a fp,
+ * using the data read ahead during playback when available.
+ *
+ * \return coordinates in the byte order of the file (free with MEM_freeN), NULL when reading fails.
+ */
+float *MOD_meshcache_read_coords(FILE *fp, const char *filepath, const int verts_tot)
+{
+	const size_t len = sizeof(float[3]) * (size_t)verts_tot;
+	const long offset = ftell(fp);
+	size_t data_len;
+	float *data = NULL;
+
+	if (offset >= 0) {
+		data = BKE_cache_prefetch_get(filepath, (size_t)offset, len, &data_len);
+	}
+
+	if (data == NULL) {
+		data = MEM_mallocN(len, __func__);
+
+		if (fread(data, len, 1, fp) != 1) {
+			MEM_freeN(data);
+			data = NULL;
+		}
+	}
+
+	return data;
+}
+
+/**
+ * Request the frames at \a index_range to be read in the background,
+ * \a ahead is the number of scene frames until they're needed.
+ */
+void MOD_meshcache_prefetch_range(const char *filepath, const size_t offset, const int verts_tot,
+                                  const int index_range[2], const int ahead)
+{
+	const size_t len = sizeof(float[3]) * (size_t)verts_tot;
+
+	BKE_cache_prefetch_request(filepath, offset + len * (size_t)index_range[0], len, ahead);
+
+	if (index_range[1] != index_range[0]) {
+		BKE_cache_prefetch_request(filepath, offset + len * (size_t)index_range[1], len, ahead);
+	}
+}
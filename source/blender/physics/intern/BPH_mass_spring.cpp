@@ -43,6 +43,8 @@ extern "C" {
 #include "BLI_linklist.h"
 #include "BLI_utildefines.h"
 
+#include "PIL_time.h"
+
 #include "BKE_cloth.h"
 #include "BKE_collision.h"
 #include "BKE_effect.h"
@@ -856,6 +858,7 @@ static void cloth_collision_solve_extra(Object *ob, ClothModifierData *clmd, Lis
 	const float spf = (float)clmd->sim_parms->stepsPerFrame / clmd->sim_parms->timescale;
 	
 	bool do_extra_solve;
+	double time_start;
 	int i;
 	
 	if (!(clmd->coll_parms->flags & CLOTH_COLLSETTINGS_FLAG_ENABLED))
@@ -879,7 +882,9 @@ static void cloth_collision_solve_extra(Object *ob, ClothModifierData *clmd, Lis
 	
 	// call collision function
 	// TODO: check if "step" or "step+dt" is correct - dg
+	time_start = PIL_check_seconds_timer();
 	do_extra_solve = cloth_bvh_objcollision(ob, clmd, step / clmd->sim_parms->timescale, dt / clmd->sim_parms->timescale);
+	clmd->solver_result->collision_time += (float)(PIL_check_seconds_timer() - time_start);
 	
 	// copy corrected positions back to simulation
 	for (i = 0; i < mvert_num; i++) {
@@ -935,6 +940,7 @@ static void cloth_clear_result(ClothModifierData *clmd)
 	sres->max_error = sres->min_error = sres->avg_error = 0.0f;
 	sres->max_iterations = sres->min_iterations = 0;
 	sres->avg_iterations = 0.0f;
+	sres->collision_time = 0.0f;
 }
 
 static void cloth_record_result(ClothModifierData *clmd, ImplicitSolverResult *result, int steps)
@@ -43,6 +43,7 @@
 
 #include "BLI_math.h"
 #include "BLI_linklist.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_cloth.h"
@@ -56,10 +57,6 @@
 #  pragma GCC diagnostic ignored "-Wtype-limits"
 #endif
 
-#ifdef _OPENMP
-#  define CLOTH_OPENMP_LIMIT 512
-#endif
-
 //#define DEBUG_TIME
 
 #ifdef DEBUG_TIME
@@ -94,6 +91,53 @@ typedef struct fmatrix3x3 {
 	unsigned int scount; /* spring count */ 
 } fmatrix3x3;
 
+/* Off-diagonal blocks of a big matrix by row, each block is listed in the rows of both its vertices.
+ * All matrices of the solver share the same block layout, so this is built once per solve. */
+typedef struct fmatrix3x3_rows {
+	unsigned int *offset; /* first entry in blocks for each row, vcount + 1 items */
+	unsigned int *blocks; /* block indices, two per off-diagonal block */
+} fmatrix3x3_rows;
+
+/* Long vector operations are done in chunks of vertices, which run in parallel for large vectors.
+ * The chunk size only depends on the vector length and dot products are summed per chunk,
+ * then in order, so results don't depend on the number of threads. */
+#define LFVECTOR_CHUNK_SIZE 1024
+#define LFVECTOR_CHUNK_MAX 64
+
+typedef struct LFVectorChunkData {
+	float (*to)[3];
+	float (*a)[3];
+	float (*b)[3];
+	float s;
+	fmatrix3x3 *m, *mto;
+	const fmatrix3x3_rows *rows;
+	float *chunk_dot;
+	unsigned int verts, chunk_size;
+} LFVectorChunkData;
+
+BLI_INLINE void lfvector_chunk_init(LFVectorChunkData *data, unsigned int verts)
+{
+	memset(data, 0, sizeof(*data));
+	data->verts = verts;
+	data->chunk_size = max_ii(LFVECTOR_CHUNK_SIZE, (verts + LFVECTOR_CHUNK_MAX - 1) / LFVECTOR_CHUNK_MAX);
+}
+
+BLI_INLINE void lfvector_chunk_range(const LFVectorChunkData *data, int chunk, unsigned int *r_start, unsigned int *r_end)
+{
+	*r_start = (unsigned int)chunk * data->chunk_size;
+	*r_end = min_ii(*r_start + data->chunk_size, data->verts);
+}
+
+/* returns the number of chunks */
+static int lfvector_chunk_parallel(LFVectorChunkData *data, TaskParallelRangeFunc func)
+{
+	const int chunks = (data->verts + data->chunk_size - 1) / data->chunk_size;
+
+	BLI_task_parallel_range(0, chunks, data, func, chunks > 1);
+
+	return chunks;
+}
+
 ///////////////////////////
 // float[3] vector
 ///////////////////////////
@@ -196,17 +240,36 @@ DO_INLINE void submul_lfvectorS(float (*to)[3], float (*fLongVector)[3], float s
 	}
 }
 /* dot product for big vector */
+static void dot_lfvector_cb(void *userdata, const int chunk)
+{
+	LFVectorChunkData *data = userdata;
+	unsigned int i, start, end;
+	float temp = 0.0f;
+
+	lfvector_chunk_range(data, chunk, &start, &end);
+	for (i = start; i < end; i++) {
+		temp += dot_v3v3(data->a[i], data->b[i]);
+	}
+	data->chunk_dot[chunk] = temp;
+}
 DO_INLINE float dot_lfvector(float (*fLongVectorA)[3], float (*fLongVectorB)[3], unsigned int verts)
 {
-	long i = 0;
-	float temp = 0.0;
-// XXX brecht, disabled this for now (first schedule line was already disabled),
-// due to non-commutative nature of floating point ops this makes the sim give
-// different results each time you run it!
-// schedule(guided, 2)
-//#pragma omp parallel for reduction(+: temp) if (verts > CLOTH_OPENMP_LIMIT)
-	for (i = 0; i < (long)verts; i++) {
-		temp += dot_v3v3(fLongVectorA[i], fLongVectorB[i]);
+	LFVectorChunkData data;
+	float chunk_dot[LFVECTOR_CHUNK_MAX];
+	float temp = 0.0f;
+	int i, chunks;
+
+	/* summed per chunk, not per thread: a reduction in order of completion
+	 * would make the sim give different results each time you run it! */
+	lfvector_chunk_init(&data, verts);
+	data.a = fLongVectorA;
+	data.b = fLongVectorB;
+	data.chunk_dot = chunk_dot;
+
+	chunks = lfvector_chunk_parallel(&data, dot_lfvector_cb);
+
+	for (i = 0; i < chunks; i++) {
+		temp += chunk_dot[i];
 	}
 	return temp;
 }
@@ -221,14 +284,27 @@ DO_INLINE void add_lfvector_lfvector(float (*to)[3], float (*fLongVectorA)[3], f
 
 }
 /* A = B + C * float --> for big vector */
+static void add_lfvector_lfvectorS_cb(void *userdata, const int chunk)
+{
+	LFVectorChunkData *data = userdata;
+	unsigned int i, start, end;
+
+	lfvector_chunk_range(data, chunk, &start, &end);
+	for (i = start; i < end; i++) {
+		VECADDS(data->to[i], data->a[i], data->b[i], data->s);
+	}
+}
 DO_INLINE void add_lfvector_lfvectorS(float (*to)[3], float (*fLongVectorA)[3], float (*fLongVectorB)[3], float bS, unsigned int verts)
 {
-	unsigned int i = 0;
+	LFVectorChunkData data;
 
-	for (i = 0; i < verts; i++) {
-		VECADDS(to[i], fLongVectorA[i], fLongVectorB[i], bS);
+	lfvector_chunk_init(&data, verts);
+	data.to = to;
+	data.a = fLongVectorA;
+	data.b = fLongVectorB;
+	data.s = bS;
 
-	}
+	lfvector_chunk_parallel(&data, add_lfvector_lfvectorS_cb);
 }
 /* A = B * float + C * float --> for big vector */
 DO_INLINE void add_lfvectorS_lfvectorS(float (*to)[3], float (*fLongVectorA)[3], float aS, float (*fLongVectorB)[3], float bS, unsigned int verts)
@@ -585,36 +661,92 @@ DO_INLINE void initdiag_bfmatrix(fmatrix3x3 *matrix, float m3[3][3])
 	}
 }
 
+/* build the rows of the first num_blocks off-diagonal blocks, the remaining blocks are unused (zero) */
+static void build_bfmatrix_rows(fmatrix3x3_rows *rows, fmatrix3x3 *matrix, unsigned int num_blocks)
+{
+	unsigned int vcount = matrix[0].vcount;
+	unsigned int *offset = rows->offset;
+	unsigned int i;
+
+	memset(offset, 0, sizeof(*offset) * (vcount + 1));
+
+	for (i = vcount; i < vcount + num_blocks; i++) {
+		offset[matrix[i].r + 1]++;
+		offset[matrix[i].c + 1]++;
+	}
+	for (i = 0; i < vcount; i++) {
+		offset[i + 1] += offset[i];
+	}
+
+	/* fill using the row start as cursor, then shift back */
+	for (i = vcount; i < vcount + num_blocks; i++) {
+		rows->blocks[offset[matrix[i].r]++] = i;
+		rows->blocks[offset[matrix[i].c]++] = i;
+	}
+	for (i = vcount; i > 0; i--) {
+		offset[i] = offset[i - 1];
+	}
+	offset[0] = 0;
+}
+
+static void mul_bfmatrix_lfvector_cb(void *userdata, const int chunk)
+{
+	LFVectorChunkData *data = userdata;
+	fmatrix3x3 *from = data->m;
+	const unsigned int *offset = data->rows->offset;
+	const unsigned int *blocks = data->rows->blocks;
+	unsigned int i, j, start, end;
+
+	lfvector_chunk_range(data, chunk, &start, &end);
+	for (i = start; i < end; i++) {
+		mul_v3_m3v3(data->to[i], from[i].m, data->a[i]);
+
+		for (j = offset[i]; j < offset[i + 1]; j++) {
+			fmatrix3x3 *block = &from[blocks[j]];
+			const unsigned int other = (block->r == i) ? block->c : block->r;
+
+			muladd_fmatrix_fvector(data->to[i], block->m, data->a[other]);
+		}
+	}
+}
+
 /* SPARSE SYMMETRIC multiply big matrix with long vector*/
 /* STATUS: verified */
-DO_INLINE void mul_bfmatrix_lfvector( float (*to)[3], fmatrix3x3 *from, lfVector *fLongVector)
+DO_INLINE void mul_bfmatrix_lfvector( float (*to)[3], fmatrix3x3 *from, const fmatrix3x3_rows *rows, lfVector *fLongVector)
 {
-	unsigned int i = 0;
-	unsigned int vcount = from[0].vcount;
-	lfVector *temp = create_lfvector(vcount);
-	
-	zero_lfvector(to, vcount);
+	LFVectorChunkData data;
 
-#pragma omp parallel sections private(i) if (vcount > CLOTH_OPENMP_LIMIT)
-	{
-#pragma omp section
-		{
-			for (i = from[0].vcount; i < from[0].vcount+from[0].scount; i++) {
-				muladd_fmatrix_fvector(to[from[i].c], from[i].m, fLongVector[from[i].r]);
-			}
-		}
-#pragma omp section
-		{
-			for (i = 0; i < from[0].vcount+from[0].scount; i++) {
-				muladd_fmatrix_fvector(temp[from[i].r], from[i].m, fLongVector[from[i].c]);
-			}
-		}
+	/* each vertex only writes its own row, so rows can be computed in parallel */
+	lfvector_chunk_init(&data, from[0].vcount);
+	data.to = to;
+	data.a = fLongVector;
+	data.m = from;
+	data.rows = rows;
+
+	lfvector_chunk_parallel(&data, mul_bfmatrix_lfvector_cb);
+}
+
+/* multiply the diagonal blocks of a big matrix with long vector */
+static void mul_bfmatrix_diag_lfvector_cb(void *userdata, const int chunk)
+{
+	LFVectorChunkData *data = userdata;
+	unsigned int i, start, end;
+
+	lfvector_chunk_range(data, chunk, &start, &end);
+	for (i = start; i < end; i++) {
+		mul_v3_m3v3(data->to[i], data->m[i].m, data->a[i]);
 	}
-	add_lfvector_lfvector(to, to, temp, from[0].vcount);
-	
-	del_lfvector(temp);
-	
-	
+}
+DO_INLINE void mul_bfmatrix_diag_lfvector(float (*to)[3], fmatrix3x3 *from, lfVector *fLongVector)
+{
+	LFVectorChunkData data;
+
+	lfvector_chunk_init(&data, from[0].vcount);
+	data.to = to;
+	data.a = fLongVector;
+	data.m = from;
+
+	lfvector_chunk_parallel(&data, mul_bfmatrix_diag_lfvector_cb);
 }
 
 /* SPARSE SYMMETRIC sub big matrix with big matrix*/
@@ -656,6 +788,7 @@ typedef struct Implicit_Data  {
 	lfVector *z;				/* target velocity in constrained directions */
 	fmatrix3x3 *S;				/* filtering matrix for constraints */
 	fmatrix3x3 *P, *Pinv;		/* pre-conditioning matrix */
+	fmatrix3x3_rows rows;		/* off-diagonal blocks by row (same for all matrices) */
 } Implicit_Data;
 
 Implicit_Data *BPH_mass_spring_solver_create(int numverts, int numsprings)
@@ -680,6 +813,8 @@ Implicit_Data *BPH_mass_spring_solver_create(int numverts, int numsprings)
 	id->B = create_lfvector(numverts);
 	id->dV = create_lfvector(numverts);
 	id->z = create_lfvector(numverts);
+	id->rows.offset = MEM_mallocN(sizeof(*id->rows.offset) * (numverts + 1), "cloth_implicit_alloc_rows");
+	id->rows.blocks = MEM_mallocN(sizeof(*id->rows.blocks) * (2 * numsprings + 1), "cloth_implicit_alloc_rows");
 
 	initdiag_bfmatrix(id->bigI, I);
 
@@ -706,6 +841,8 @@ void BPH_mass_spring_solver_free(Implicit_Data *id)
 	del_lfvector(id->B);
 	del_lfvector(id->dV);
 	del_lfvector(id->z);
+	MEM_freeN(id->rows.offset);
+	MEM_freeN(id->rows.blocks);
 	
 	MEM_freeN(id);
 }
@@ -738,14 +875,51 @@ BLI_INLINE void root_to_world_m3(Implicit_Data *data, int index, float r[3][3],
 
 /* ================================ */
 
+static void filter_cb(void *userdata, const int chunk)
+{
+	LFVectorChunkData *data = userdata;
+	fmatrix3x3 *S = data->m;
+	unsigned int i, start, end;
+
+	lfvector_chunk_range(data, chunk, &start, &end);
+	for (i = start; i < end; i++) {
+		mul_m3_v3(S[i].m, data->to[S[i].r]);
+	}
+}
 DO_INLINE void filter(lfVector *V, fmatrix3x3 *S)
 {
-	unsigned int i=0;
+	LFVectorChunkData data;
 
-	for (i = 0; i < S[0].vcount; i++) {
-		mul_m3_v3(S[i].m, V[S[i].r]);
+	lfvector_chunk_init(&data, S[0].vcount);
+	data.to = V;
+	data.m = S;
+
+	lfvector_chunk_parallel(&data, filter_cb);
+}
+
+/* block Jacobi preconditioner: inverse of the diagonal blocks of A */
+static void build_precond_cb(void *userdata, const int chunk)
+{
+	LFVectorChunkData *data = userdata;
+	unsigned int i, start, end;
+
+	lfvector_chunk_range(data, chunk, &start, &end);
+	for (i = start; i < end; i++) {
+		if (!invert_m3_m3(data->mto[i].m, data->m[i].m)) {
+			unit_m3(data->mto[i].m);
+		}
 	}
 }
+DO_INLINE void build_precond(fmatrix3x3 *lA, fmatrix3x3 *Pinv)
+{
+	LFVectorChunkData data;
+
+	lfvector_chunk_init(&data, lA[0].vcount);
+	data.m = lA;
+	data.mto = Pinv;
+
+	lfvector_chunk_parallel(&data, build_precond_cb);
+}
 
 #if 0 /* this version of the CG algorithm does not work very well with partial constraints (where S has non-zero elements) */
 static int  cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z, fmatrix3x3 *S)
@@ -814,7 +988,8 @@ static int  cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z
 }
 #endif
 
-static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z, fmatrix3x3 *S, ImplicitSolverResult *result)
+static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, const fmatrix3x3_rows *rows, lfVector *lB, lfVector *z, fmatrix3x3 *S,
+                       fmatrix3x3 *Pinv, ImplicitSolverResult *result)
 {
 	// Solves for unknown X in equation AX=B
 	unsigned int conjgrad_loopcount=0, conjgrad_looplimit=100;
@@ -829,21 +1004,24 @@ static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z,
 	lfVector *s = create_lfvector(numverts);
 	float bnorm2, delta_new, delta_old, delta_target, alpha;
 	
+	build_precond(lA, Pinv);
+	
 	cp_lfvector(ldV, z, numverts);
 	
-	/* d0 = filter(B)^T * P * filter(B) */
+	/* d0 = filter(B)^T * P^-1 * filter(B) */
 	cp_lfvector(fB, lB, numverts);
 	filter(fB, S);
-	bnorm2 = dot_lfvector(fB, fB, numverts);
+	mul_bfmatrix_diag_lfvector(s, Pinv, fB);
+	bnorm2 = dot_lfvector(fB, s, numverts);
 	delta_target = conjgrad_epsilon*conjgrad_epsilon * bnorm2;
 	
 	/* r = filter(B - A * dV) */
-	mul_bfmatrix_lfvector(AdV, lA, ldV);
+	mul_bfmatrix_lfvector(AdV, lA, rows, ldV);
 	sub_lfvector_lfvector(r, lB, AdV, numverts);
 	filter(r, S);
 	
 	/* c = filter(P^-1 * r) */
-	cp_lfvector(c, r, numverts);
+	mul_bfmatrix_diag_lfvector(c, Pinv, r);
 	filter(c, S);
 	
 	/* delta = r^T * c */
@@ -861,7 +1039,7 @@ static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z,
 #endif
 	
 	while (delta_new > delta_target && conjgrad_loopcount < conjgrad_looplimit) {
-		mul_bfmatrix_lfvector(q, lA, c);
+		mul_bfmatrix_lfvector(q, lA, rows, c);
 		filter(q, S);
 		
 		alpha = delta_new / dot_lfvector(c, q, numverts);
@@ -871,7 +1049,7 @@ static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z,
 		add_lfvector_lfvectorS(r, r, q, -alpha, numverts);
 		
 		/* s = P^-1 * r */
-		cp_lfvector(s, r, numverts);
+		mul_bfmatrix_diag_lfvector(s, Pinv, r);
 		delta_old = delta_new;
 		delta_new = dot_lfvector(r, s, numverts);
 		
@@ -1109,7 +1287,9 @@ bool BPH_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSol
 
 	subadd_bfmatrixS_bfmatrixS(data->A, data->dFdV, dt, data->dFdX, (dt*dt));
 
-	mul_bfmatrix_lfvector(dFdXmV, data->dFdX, data->V);
+	build_bfmatrix_rows(&data->rows, data->A, data->num_blocks);
+
+	mul_bfmatrix_lfvector(dFdXmV, data->dFdX, &data->rows, data->V);
 
 	add_lfvectorS_lfvectorS(data->B, data->F, dt, dFdXmV, (dt*dt), numverts);
 
@@ -1117,7 +1297,7 @@ bool BPH_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSol
 	double start = PIL_check_seconds_timer();
 #endif
 
-	cg_filtered(data->dV, data->A, data->B, data->z, data->S, result); /* conjugate gradient algorithm to solve Ax=b */
+	cg_filtered(data->dV, data->A, &data->rows, data->B, data->z, data->S, data->Pinv, result); /* conjugate gradient algorithm to solve Ax=b */
 	// cg_filtered_pre(id->dV, id->A, id->B, id->z, id->S, id->P, id->Pinv, id->bigI);
 
 #ifdef DEBUG_TIME
@@ -0,0 +1,110 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+#include "BLI_utildefines.h"
+#include "BLI_array_store.h"
+#include "BLI_array_store_utils.h"
+#include "BLI_rand.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "PIL_time.h"
+#include "PIL_time_utildefines.h"
+}
+
+/* Simulate mesh undo pushes: each step stores several layers (with different strides),
+ * after a few elements of each layer have been modified.
+ * Layers are added one after another, then with each store handled by its own thread. */
+
+#define CHUNK_SIZE 256
+
+typedef struct TestLayer {
+	BArrayStore *bs;
+	char *data;
+	size_t data_len;
+	BArrayState *state;
+	BArrayState *state_reference;
+} TestLayer;
+
+static void test_layer_add_cb(void *userdata, const int iter)
+{
+	TestLayer *layer = &((TestLayer *)userdata)[iter];
+	layer->state = BLI_array_store_state_add(layer->bs, layer->data, layer->data_len, layer->state_reference);
+}
+
+static void array_store_undo_push_test(
+        const char *id, const unsigned int elem_num, const unsigned int steps, const bool use_threading)
+{
+	/* each layer uses its own store, so they can be added in parallel */
+	const int strides[] = {12, 16, 8, 4};
+	const int layers_num = ARRAY_SIZE(strides);
+	struct BArrayStore_AtSize bs_stride = {NULL};
+	TestLayer layers[ARRAY_SIZE(strides)];
+	RNG *rng = BLI_rng_new(0);
+
+	printf("\n========== STARTING %s ==========\n", id);
+
+	BLI_threadapi_init();
+
+	for (int i = 0; i < layers_num; i++) {
+		layers[i].bs = BLI_array_store_at_size_ensure(&bs_stride, strides[i], CHUNK_SIZE);
+		layers[i].data_len = (size_t)strides[i] * elem_num;
+		layers[i].data = (char *)MEM_mallocN(layers[i].data_len, __func__);
+		BLI_rng_get_char_n(rng, layers[i].data, layers[i].data_len);
+		layers[i].state = NULL;
+	}
+
+	double time_total = 0.0;
+	for (unsigned int step = 0; step < steps; step++) {
+		for (int i = 0; i < layers_num; i++) {
+			/* modify some elements, & shift the array on some steps to avoid aligned chunks. */
+			const size_t stride = (size_t)strides[i];
+			for (int j = 0; j < 64; j++) {
+				const size_t offset = (BLI_rng_get_uint(rng) % elem_num) * stride;
+				BLI_rng_get_char_n(rng, &layers[i].data[offset], stride);
+			}
+			if (step % 2) {
+				memmove(&layers[i].data[stride], layers[i].data, layers[i].data_len - stride);
+			}
+			layers[i].state_reference = layers[i].state;
+		}
+
+		const double time_start = PIL_check_seconds_timer();
+		BLI_task_parallel_range(0, layers_num, layers, test_layer_add_cb, use_threading);
+		time_total += PIL_check_seconds_timer() - time_start;
+	}
+
+	printf("undo push: %.6f sec average over %u steps\n", time_total / steps, steps);
+
+	size_t size_expanded, size_compacted;
+	BLI_array_store_at_size_calc_memory_usage(&bs_stride, &size_expanded, &size_compacted);
+	printf("memory use: %.4f%% of expanded size\n", ((double)size_compacted / (double)size_expanded) * 100.0);
+
+	for (int i = 0; i < layers_num; i++) {
+		size_t state_len;
+		char *data = (char *)BLI_array_store_state_data_get_alloc(layers[i].state, &state_len);
+		EXPECT_EQ(layers[i].data_len, state_len);
+		EXPECT_EQ(0, memcmp(data, layers[i].data, state_len));
+		MEM_freeN(data);
+		MEM_freeN(layers[i].data);
+	}
+
+	BLI_array_store_at_size_clear(&bs_stride);
+	BLI_rng_free(rng);
+
+	printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(array_store, UndoPush_1000000)
+{
+	array_store_undo_push_test("UndoPush - 1000000 elements, serial", 1000000, 16, false);
+	array_store_undo_push_test("UndoPush - 1000000 elements, threaded", 1000000, 16, true);
+}
+
+TEST(array_store, UndoPush_5000000)
+{
+	array_store_undo_push_test("UndoPush - 5000000 elements, serial", 5000000, 8, false);
+	array_store_undo_push_test("UndoPush - 5000000 elements, threaded", 5000000, 8, true);
+}
@@ -644,6 +644,10 @@ TEST(array_store, TestData_Stride12_Chunk48_Mutate2) { random_data_mutate_helper
 TEST(array_store, TestData_Stride32_Chunk64_Mutate1) { random_data_mutate_helper(0,   256,  200, 32,  64,  3112, 1); }
 TEST(array_store, TestData_Stride32_Chunk64_Mutate8) { random_data_mutate_helper(0,   256,  200, 32,  64,  7117, 8); }
 
+/* large enough to calculate hashes using threads */
+TEST(array_store, TestData_Stride1_Chunk64_Mutate8_Large)  { random_data_mutate_helper(100000, 140000, 8,  1,  64, 4224, 8); }
+TEST(array_store, TestData_Stride12_Chunk32_Mutate8_Large) { random_data_mutate_helper(100000, 140000, 8, 12,  32, 5115, 8); }
+
 
 /* -------------------------------------------------------------------- */
 /* Randomized Chunks Test */
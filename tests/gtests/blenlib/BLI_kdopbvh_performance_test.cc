@@ -0,0 +1,190 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+#include "BLI_utildefines.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_math_geom.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "PIL_time_utildefines.h"
+}
+
+/* Build trees of 1M triangles with different branching and balancing,
+ * then cast the same rays at each of them.
+ * Trees with 4 or 8 children are traversed with SIMD when supported. */
+
+#define GRID_RES 708  /* 2 * 708 * 708 ~= 1M triangles */
+
+static void raycast_tris_cb(void *userdata, int index, const BVHTreeRay *ray, BVHTreeRayHit *hit)
+{
+	const float (*tris)[3][3] = (const float (*)[3][3])userdata;
+	float dist;
+
+	if (isect_ray_tri_v3(ray->origin, ray->direction, tris[index][0], tris[index][1], tris[index][2], &dist, NULL) &&
+	    (dist < hit->dist))
+	{
+		hit->index = index;
+		hit->dist = dist;
+		madd_v3_v3v3fl(hit->co, ray->origin, ray->direction, dist);
+	}
+}
+
+/* Wavy grid, evenly distributed triangles. */
+static unsigned int tris_grid_create(float (*tris)[3][3])
+{
+	unsigned int tris_len = 0;
+
+	for (int y = 0; y < GRID_RES; y++) {
+		for (int x = 0; x < GRID_RES; x++) {
+			float co[4][3];
+			for (int i = 0; i < 4; i++) {
+				const float fx = (float)(x + (i & 1)) / GRID_RES * 2.0f - 1.0f;
+				const float fy = (float)(y + (i >> 1)) / GRID_RES * 2.0f - 1.0f;
+				co[i][0] = fx;
+				co[i][1] = fy;
+				co[i][2] = 0.1f * sinf(fx * 10.0f) * cosf(fy * 7.0f);
+			}
+			copy_v3_v3(tris[tris_len][0], co[0]);
+			copy_v3_v3(tris[tris_len][1], co[1]);
+			copy_v3_v3(tris[tris_len][2], co[3]);
+			tris_len++;
+			copy_v3_v3(tris[tris_len][0], co[0]);
+			copy_v3_v3(tris[tris_len][1], co[3]);
+			copy_v3_v3(tris[tris_len][2], co[2]);
+			tris_len++;
+		}
+	}
+	return tris_len;
+}
+
+/* Spheres of different sizes with the same number of triangles, unevenly distributed triangles. */
+static unsigned int tris_spheres_create(float (*tris)[3][3], unsigned int tris_len, RNG *rng)
+{
+	const unsigned int spheres_len = 64;
+	const unsigned int sphere_tris_len = tris_len / spheres_len;
+	const float tri_size = 3.5f / sqrtf((float)sphere_tris_len);
+	float center[3], radius = 0.0f;
+
+	tris_len = sphere_tris_len * spheres_len;
+	for (unsigned int i = 0; i < tris_len; i++) {
+		float dir[3];
+
+		if (i % sphere_tris_len == 0) {
+			BLI_rng_get_float_unit_v3(rng, center);
+			mul_v3_fl(center, 0.8f * BLI_rng_get_float(rng));
+			radius = 0.02f + 0.3f * powf(BLI_rng_get_float(rng), 3.0f);
+		}
+
+		BLI_rng_get_float_unit_v3(rng, dir);
+		for (int j = 0; j < 3; j++) {
+			float offset[3];
+			BLI_rng_get_float_unit_v3(rng, offset);
+			madd_v3_v3v3fl(tris[i][j], dir, offset, tri_size);
+			normalize_v3(tris[i][j]);
+			mul_v3_fl(tris[i][j], radius);
+			add_v3_v3(tris[i][j], center);
+		}
+	}
+	return tris_len;
+}
+
+static void bvhtree_raycast_test(
+        const char *id, const float (*tris)[3][3], const unsigned int tris_len,
+        const float (*rays)[2][3], const unsigned int rays_len,
+        const char tree_type, const int balance_flag, BVHTreeRayHit *r_hits)
+{
+	BVHTree *tree = BLI_bvhtree_new((int)tris_len, 0.0f, tree_type, 6);
+	unsigned int i;
+
+	printf("--- %s ---\n", id);
+
+	for (i = 0; i < tris_len; i++) {
+		BLI_bvhtree_insert(tree, (int)i, tris[i][0], 3);
+	}
+
+	TIMEIT_START(bvhtree_balance);
+	BLI_bvhtree_balance_ex(tree, balance_flag);
+	TIMEIT_END(bvhtree_balance);
+
+	TIMEIT_START(bvhtree_ray_cast);
+	for (i = 0; i < rays_len; i++) {
+		r_hits[i].index = -1;
+		r_hits[i].dist = BVH_RAYCAST_DIST_MAX;
+		BLI_bvhtree_ray_cast(tree, rays[i][0], rays[i][1], 0.0f, &r_hits[i], raycast_tris_cb, (void *)tris);
+	}
+	TIMEIT_END(bvhtree_ray_cast);
+
+	BLI_bvhtree_free(tree);
+}
+
+static void bvhtree_tests(const char *id, const bool use_grid)
+{
+	const unsigned int tris_max = 2 * GRID_RES * GRID_RES;
+	const unsigned int rays_len = 1000000;
+	float (*tris)[3][3] = (float (*)[3][3])MEM_mallocN(sizeof(*tris) * tris_max, __func__);
+	float (*rays)[2][3] = (float (*)[2][3])MEM_mallocN(sizeof(*rays) * rays_len, __func__);
+	BVHTreeRayHit *hits_ref = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits_ref) * rays_len, __func__);
+	BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * rays_len, __func__);
+	RNG *rng = BLI_rng_new(0);
+	unsigned int tris_len, i;
+	unsigned int hits_num = 0;
+
+	printf("\n========== STARTING %s ==========\n", id);
+
+	BLI_threadapi_init();
+
+	tris_len = use_grid ? tris_grid_create(tris) : tris_spheres_create(tris, tris_max, rng);
+
+	/* rays from outside, towards random points inside the unit sphere */
+	for (i = 0; i < rays_len; i++) {
+		float target[3];
+		BLI_rng_get_float_unit_v3(rng, rays[i][0]);
+		mul_v3_fl(rays[i][0], 2.0f);
+		BLI_rng_get_float_unit_v3(rng, target);
+		mul_v3_fl(target, BLI_rng_get_float(rng));
+		sub_v3_v3v3(rays[i][1], target, rays[i][0]);
+		normalize_v3(rays[i][1]);
+	}
+	BLI_rng_free(rng);
+
+	bvhtree_raycast_test("Binary", tris, tris_len, rays, rays_len, 2, 0, hits_ref);
+	for (i = 0; i < rays_len; i++) {
+		hits_num += (hits_ref[i].index != -1);
+	}
+	printf("%u of %u rays hit\n", hits_num, rays_len);
+
+	bvhtree_raycast_test("Quad", tris, tris_len, rays, rays_len, 4, 0, hits);
+	bvhtree_raycast_test("Binary SAH", tris, tris_len, rays, rays_len, 2, BVH_BALANCE_SAH, hits);
+	bvhtree_raycast_test("Quad SAH", tris, tris_len, rays, rays_len, 4, BVH_BALANCE_SAH, hits);
+	bvhtree_raycast_test("Oct SAH", tris, tris_len, rays, rays_len, 8, BVH_BALANCE_SAH, hits);
+
+	/* only compare the last one, others are expected to give the same results
+	 * (the index may differ for rays hitting an edge) */
+	for (i = 0; i < rays_len; i++) {
+		EXPECT_EQ(hits_ref[i].index == -1, hits[i].index == -1);
+		if (hits_ref[i].index != -1) {
+			EXPECT_FLOAT_EQ(hits_ref[i].dist, hits[i].dist);
+		}
+	}
+
+	MEM_freeN(tris);
+	MEM_freeN(rays);
+	MEM_freeN(hits_ref);
+	MEM_freeN(hits);
+
+	printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdopbvh, RayCastGrid1M)
+{
+	bvhtree_tests("RayCast - 1M triangles grid, 1M rays", true);
+}
+
+TEST(kdopbvh, RayCastSpheres1M)
+{
+	bvhtree_tests("RayCast - 1M triangles spheres, 1M rays", false);
+}
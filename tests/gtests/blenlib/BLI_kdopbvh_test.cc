@@ -9,6 +9,7 @@ extern "C" {
 #include "BLI_kdopbvh.h"
 #include "BLI_rand.h"
 #include "BLI_math_vector.h"
+#include "BLI_math_geom.h"
 #include "MEM_guardedalloc.h"
 }
 
@@ -54,10 +55,12 @@ TEST(kdopbvh, Single)
  * Note that a small epsilon is added to the BVH nodes bounds, even if we pass in zero.
  * Use rounding to ensure very close nodes don't cause the wrong node to be found as nearest.
  */
-static void find_nearest_points_test(int points_len, float scale, int round, int random_seed)
+static void find_nearest_points_test(
+        int points_len, float scale, int round, int random_seed,
+        char tree_type = 8, int balance_flag = 0)
 {
 	struct RNG *rng = BLI_rng_new(random_seed);
-	BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 8, 8);
+	BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, tree_type, 8);
 
 	void *mem = MEM_mallocN(sizeof(float[3]) * points_len, __func__);
 	float (*points)[3] = (float (*)[3])mem;
@@ -66,7 +69,7 @@ static void find_nearest_points_test(int points_len, float scale, int round, int
 		rng_v3_round(points[i], 3, rng, round, scale);
 		BLI_bvhtree_insert(tree, i, points[i], 1);
 	}
-	BLI_bvhtree_balance(tree);
+	BLI_bvhtree_balance_ex(tree, balance_flag);
 	/* first find each point */
 	for (int i = 0; i < points_len; i++) {
 		const int j = BLI_bvhtree_find_nearest(tree, points[i], NULL, NULL, NULL);
@@ -93,3 +96,84 @@ static void find_nearest_points_test(int points_len, float scale, int round, int
 TEST(kdopbvh, FindNearest_1)		{ find_nearest_points_test(1, 1.0, 1000, 1234); }
 TEST(kdopbvh, FindNearest_2)		{ find_nearest_points_test(2, 1.0, 1000, 123); }
 TEST(kdopbvh, FindNearest_500)		{ find_nearest_points_test(500, 1.0, 1000, 12); }
+TEST(kdopbvh, FindNearest_SAH_500)	{ find_nearest_points_test(500, 1.0, 1000, 12, 8, BVH_BALANCE_SAH); }
+TEST(kdopbvh, FindNearest_SAH_Binary_500)	{ find_nearest_points_test(500, 1.0, 1000, 12, 2, BVH_BALANCE_SAH); }
+
+/* -------------------------------------------------------------------- */
+/* Ray-cast */
+
+static void raycast_tris_cb(void *userdata, int index, const BVHTreeRay *ray, BVHTreeRayHit *hit)
+{
+	const float (*tris)[3][3] = (const float (*)[3][3])userdata;
+	float dist;
+
+	if (isect_ray_tri_v3(ray->origin, ray->direction, tris[index][0], tris[index][1], tris[index][2], &dist, NULL) &&
+	    (dist < hit->dist))
+	{
+		hit->index = index;
+		hit->dist = dist;
+		madd_v3_v3v3fl(hit->co, ray->origin, ray->direction, dist);
+	}
+}
+
+/**
+ * Compare ray-cast results of trees with different branching and balancing
+ * (SIMD traversal is used for 4 and 8 children) against a binary tree.
+ */
+static void raycast_tris_test(int tris_len, char tree_type, int balance_flag, int random_seed)
+{
+	struct RNG *rng = BLI_rng_new(random_seed);
+	const int rays_len = 1000;
+
+	void *mem = MEM_mallocN(sizeof(float[3][3]) * tris_len, __func__);
+	float (*tris)[3][3] = (float (*)[3][3])mem;
+
+	BVHTree *tree_ref = BLI_bvhtree_new(tris_len, 0.0, 2, 6);
+	BVHTree *tree = BLI_bvhtree_new(tris_len, 0.0, tree_type, 6);
+
+	for (int i = 0; i < tris_len; i++) {
+		float center[3];
+		rng_v3_round(center, 3, rng, 100000, 1.0f);
+		for (int j = 0; j < 3; j++) {
+			rng_v3_round(tris[i][j], 3, rng, 100000, 0.05f);
+			add_v3_v3(tris[i][j], center);
+		}
+		BLI_bvhtree_insert(tree_ref, i, tris[i][0], 3);
+		BLI_bvhtree_insert(tree, i, tris[i][0], 3);
+	}
+	BLI_bvhtree_balance(tree_ref);
+	BLI_bvhtree_balance_ex(tree, balance_flag);
+
+	for (int i = 0; i < rays_len; i++) {
+		float co[3], dir[3];
+		BVHTreeRayHit hit_ref, hit;
+
+		rng_v3_round(co, 3, rng, 100000, 2.0f);
+		BLI_rng_get_float_unit_v3(rng, dir);
+		/* aim roughly at the center so most rays hit something */
+		sub_v3_v3v3(dir, dir, co);
+		normalize_v3(dir);
+
+		hit_ref.index = hit.index = -1;
+		hit_ref.dist = hit.dist = BVH_RAYCAST_DIST_MAX;
+
+		BLI_bvhtree_ray_cast(tree_ref, co, dir, 0.0f, &hit_ref, raycast_tris_cb, tris);
+		BLI_bvhtree_ray_cast(tree, co, dir, 0.0f, &hit, raycast_tris_cb, tris);
+
+		EXPECT_EQ(hit_ref.index, hit.index);
+		if (hit_ref.index != -1) {
+			EXPECT_FLOAT_EQ(hit_ref.dist, hit.dist);
+		}
+	}
+
+	BLI_bvhtree_free(tree_ref);
+	BLI_bvhtree_free(tree);
+	BLI_rng_free(rng);
+	MEM_freeN(tris);
+}
+
+TEST(kdopbvh, RayCast_Quad)		{ raycast_tris_test(5000, 4, 0, 123); }
+TEST(kdopbvh, RayCast_Oct)		{ raycast_tris_test(5000, 8, 0, 123); }
+TEST(kdopbvh, RayCast_SAH_Binary)	{ raycast_tris_test(5000, 2, BVH_BALANCE_SAH, 123); }
+TEST(kdopbvh, RayCast_SAH_Quad)	{ raycast_tris_test(5000, 4, BVH_BALANCE_SAH, 123); }
+TEST(kdopbvh, RayCast_SAH_Oct)		{ raycast_tris_test(5000, 8, BVH_BALANCE_SAH, 123); }
@@ -0,0 +1,99 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+#include "BLI_utildefines.h"
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "PIL_time_utildefines.h"
+}
+
+/* Build a tree of random points, then look up the nearest neighbors of random points,
+ * one query per call and batched. */
+
+static void kdtree_tests(const char *id, const unsigned int num, const unsigned int num_queries, const unsigned int n)
+{
+	float (*points)[3] = (float (*)[3])MEM_mallocN(sizeof(*points) * num, __func__);
+	float (*queries)[3] = (float (*)[3])MEM_mallocN(sizeof(*queries) * num_queries, __func__);
+	KDTreeNearest *nearest = (KDTreeNearest *)MEM_mallocN(sizeof(*nearest) * num_queries * n, __func__);
+	KDTreeNearest *nearest_batch = (KDTreeNearest *)MEM_mallocN(sizeof(*nearest) * num_queries * n, __func__);
+	RNG *rng = BLI_rng_new(0);
+	unsigned int i;
+
+	printf("\n========== STARTING %s ==========\n", id);
+
+	BLI_threadapi_init();
+
+	for (i = 0; i < num; i++) {
+		BLI_rng_get_float_unit_v3(rng, points[i]);
+		mul_v3_fl(points[i], BLI_rng_get_float(rng));
+	}
+	for (i = 0; i < num_queries; i++) {
+		BLI_rng_get_float_unit_v3(rng, queries[i]);
+		mul_v3_fl(queries[i], BLI_rng_get_float(rng));
+	}
+	BLI_rng_free(rng);
+
+	KDTree *tree = BLI_kdtree_new(num);
+	for (i = 0; i < num; i++) {
+		BLI_kdtree_insert(tree, (int)i, points[i]);
+	}
+
+	TIMEIT_START(kdtree_balance);
+	BLI_kdtree_balance(tree);
+	TIMEIT_END(kdtree_balance);
+
+	if (n == 1) {
+		TIMEIT_START(kdtree_find_nearest);
+		for (i = 0; i < num_queries; i++) {
+			BLI_kdtree_find_nearest(tree, queries[i], &nearest[i]);
+		}
+		TIMEIT_END(kdtree_find_nearest);
+
+		TIMEIT_START(kdtree_find_nearest_batch);
+		BLI_kdtree_find_nearest_batch(tree, queries, num_queries, nearest_batch);
+		TIMEIT_END(kdtree_find_nearest_batch);
+	}
+	else {
+		TIMEIT_START(kdtree_find_nearest_n);
+		for (i = 0; i < num_queries; i++) {
+			BLI_kdtree_find_nearest_n(tree, queries[i], &nearest[i * n], n);
+		}
+		TIMEIT_END(kdtree_find_nearest_n);
+
+		TIMEIT_START(kdtree_find_nearest_n_batch);
+		BLI_kdtree_find_nearest_n_batch(tree, queries, num_queries, nearest_batch, NULL, n);
+		TIMEIT_END(kdtree_find_nearest_n_batch);
+	}
+
+	for (i = 0; i < num_queries * n; i++) {
+		EXPECT_EQ(nearest[i].index, nearest_batch[i].index);
+	}
+
+	BLI_kdtree_free(tree);
+	MEM_freeN(points);
+	MEM_freeN(queries);
+	MEM_freeN(nearest);
+	MEM_freeN(nearest_batch);
+
+	printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdtree, FindNearest100000)
+{
+	kdtree_tests("FindNearest - 100000 points, 100000 queries", 100000, 100000, 1);
+}
+
+TEST(kdtree, FindNearest10000000)
+{
+	kdtree_tests("FindNearest - 10000000 points, 1000000 queries", 10000000, 1000000, 1);
+}
+
+TEST(kdtree, FindNearestN10000000)
+{
+	kdtree_tests("FindNearestN (8) - 10000000 points, 1000000 queries", 10000000, 1000000, 8);
+}
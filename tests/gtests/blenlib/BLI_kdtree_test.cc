@@ -0,0 +1,143 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+#include "BLI_utildefines.h"
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+}
+
+/* Large enough for the threaded balancing and batched queries. */
+#define TESTCASE_POINTS 50000
+#define TESTCASE_QUERIES 5000
+
+static void points_random(float (*co)[3], unsigned int num, unsigned int seed)
+{
+	RNG *rng = BLI_rng_new(seed);
+	for (unsigned int i = 0; i < num; i++) {
+		BLI_rng_get_float_unit_v3(rng, co[i]);
+		mul_v3_fl(co[i], BLI_rng_get_float(rng));
+	}
+	BLI_rng_free(rng);
+}
+
+static KDTree *kdtree_from_points(const float (*co)[3], unsigned int num)
+{
+	KDTree *tree = BLI_kdtree_new(num);
+	for (unsigned int i = 0; i < num; i++) {
+		BLI_kdtree_insert(tree, (int)i, co[i]);
+	}
+	BLI_kdtree_balance(tree);
+	return tree;
+}
+
+/* Brute force, to check the (threaded) balanced tree. */
+static int find_nearest_brute(const float (*points)[3], unsigned int num, const float co[3])
+{
+	float dist_min = FLT_MAX;
+	int index = -1;
+
+	for (unsigned int i = 0; i < num; i++) {
+		const float dist = len_squared_v3v3(points[i], co);
+		if (dist < dist_min) {
+			dist_min = dist;
+			index = (int)i;
+		}
+	}
+	return index;
+}
+
+TEST(kdtree, FindNearestBatch)
+{
+	float (*points)[3] = (float (*)[3])MEM_mallocN(sizeof(*points) * TESTCASE_POINTS, __func__);
+	float (*queries)[3] = (float (*)[3])MEM_mallocN(sizeof(*queries) * TESTCASE_QUERIES, __func__);
+	KDTreeNearest *nearest = (KDTreeNearest *)MEM_mallocN(sizeof(*nearest) * TESTCASE_QUERIES, __func__);
+
+	BLI_threadapi_init();
+
+	points_random(points, TESTCASE_POINTS, 0);
+	points_random(queries, TESTCASE_QUERIES, 1);
+
+	KDTree *tree = kdtree_from_points(points, TESTCASE_POINTS);
+
+	BLI_kdtree_find_nearest_batch(tree, queries, TESTCASE_QUERIES, nearest);
+
+	for (unsigned int i = 0; i < TESTCASE_QUERIES; i += 10) {
+		EXPECT_EQ(nearest[i].index, find_nearest_brute(points, TESTCASE_POINTS, queries[i]));
+	}
+	for (unsigned int i = 0; i < TESTCASE_QUERIES; i++) {
+		KDTreeNearest single;
+		EXPECT_EQ(nearest[i].index, BLI_kdtree_find_nearest(tree, queries[i], &single));
+		EXPECT_EQ(nearest[i].dist, single.dist);
+	}
+
+	BLI_kdtree_free(tree);
+	MEM_freeN(points);
+	MEM_freeN(queries);
+	MEM_freeN(nearest);
+}
+
+TEST(kdtree, FindNearestNBatch)
+{
+	const unsigned int n = 8;
+	float (*points)[3] = (float (*)[3])MEM_mallocN(sizeof(*points) * TESTCASE_POINTS, __func__);
+	float (*queries)[3] = (float (*)[3])MEM_mallocN(sizeof(*queries) * TESTCASE_QUERIES, __func__);
+	KDTreeNearest *nearest = (KDTreeNearest *)MEM_mallocN(sizeof(*nearest) * TESTCASE_QUERIES * n, __func__);
+	int *found = (int *)MEM_mallocN(sizeof(*found) * TESTCASE_QUERIES, __func__);
+
+	BLI_threadapi_init();
+
+	points_random(points, TESTCASE_POINTS, 2);
+	points_random(queries, TESTCASE_QUERIES, 3);
+
+	KDTree *tree = kdtree_from_points(points, TESTCASE_POINTS);
+
+	BLI_kdtree_find_nearest_n_batch(tree, queries, TESTCASE_QUERIES, nearest, found, n);
+
+	for (unsigned int i = 0; i < TESTCASE_QUERIES; i++) {
+		KDTreeNearest single[n];
+		EXPECT_EQ(found[i], BLI_kdtree_find_nearest_n(tree, queries[i], single, n));
+		for (unsigned int j = 0; j < n; j++) {
+			EXPECT_EQ(nearest[i * n + j].index, single[j].index);
+		}
+	}
+
+	BLI_kdtree_free(tree);
+	MEM_freeN(points);
+	MEM_freeN(queries);
+	MEM_freeN(nearest);
+	MEM_freeN(found);
+}
+
+/* Duplicate and few points, the threaded balancing mustn't lose any. */
+TEST(kdtree, BalanceDuplicates)
+{
+	const unsigned int num = TESTCASE_POINTS;
+	KDTree *tree = BLI_kdtree_new(num);
+	bool *visited = (bool *)MEM_callocN(sizeof(*visited) * num, __func__);
+
+	BLI_threadapi_init();
+
+	for (unsigned int i = 0; i < num; i++) {
+		const float co[3] = {(float)(i % 7), (float)(i % 3), 0.0f};
+		BLI_kdtree_insert(tree, (int)i, co);
+	}
+	BLI_kdtree_balance(tree);
+
+	KDTreeNearest *nearest;
+	const float co[3] = {3.0f, 1.0f, 0.0f};
+	const int found = BLI_kdtree_range_search(tree, co, &nearest, 100.0f);
+	EXPECT_EQ(found, (int)num);
+	for (int i = 0; i < found; i++) {
+		EXPECT_FALSE(visited[nearest[i].index]);
+		visited[nearest[i].index] = true;
+	}
+
+	MEM_freeN(nearest);
+	MEM_freeN(visited);
+	BLI_kdtree_free(tree);
+}
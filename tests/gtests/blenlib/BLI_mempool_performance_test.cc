@@ -0,0 +1,175 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+#include "BLI_utildefines.h"
+#include "BLI_memarena.h"
+#include "BLI_mempool.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "PIL_time_utildefines.h"
+}
+
+/* Allocate and free many small elements from tasks, comparing a concurrent mempool
+ * with a locked mempool, guarded-alloc and (allocation only) a memarena per task. */
+
+#define ELEM_SIZE 48
+#define TASK_NUM 256
+
+typedef enum AllocType {
+	ALLOC_MEMPOOL_CONCURRENT,
+	ALLOC_MEMPOOL_LOCKED,
+	ALLOC_GUARDEDALLOC,
+	ALLOC_MEMARENA,
+} AllocType;
+
+typedef struct BenchData {
+	AllocType type;
+	BLI_mempool *pool;
+	SpinLock lock;
+	unsigned int elem_num;
+	/* elements of all tasks, half of them are freed by the main thread */
+	void **elems;
+} BenchData;
+
+static void *bench_alloc(BenchData *data, int threadid)
+{
+	switch (data->type) {
+		case ALLOC_MEMPOOL_CONCURRENT:
+			return BLI_mempool_alloc_thread(data->pool, threadid);
+		case ALLOC_MEMPOOL_LOCKED:
+		{
+			void *elem;
+			BLI_spin_lock(&data->lock);
+			elem = BLI_mempool_alloc(data->pool);
+			BLI_spin_unlock(&data->lock);
+			return elem;
+		}
+		case ALLOC_GUARDEDALLOC:
+			return MEM_mallocN(ELEM_SIZE, __func__);
+		default:
+			BLI_assert(0);
+			return NULL;
+	}
+}
+
+static void bench_free(BenchData *data, void *elem, int threadid)
+{
+	switch (data->type) {
+		case ALLOC_MEMPOOL_CONCURRENT:
+			BLI_mempool_free_thread(data->pool, elem, threadid);
+			break;
+		case ALLOC_MEMPOOL_LOCKED:
+			BLI_spin_lock(&data->lock);
+			BLI_mempool_free(data->pool, elem);
+			BLI_spin_unlock(&data->lock);
+			break;
+		case ALLOC_GUARDEDALLOC:
+			MEM_freeN(elem);
+			break;
+		default:
+			BLI_assert(0);
+			break;
+	}
+}
+
+static void bench_task(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+	BenchData *data = (BenchData *)BLI_task_pool_userdata(pool);
+	const int task = GET_INT_FROM_POINTER(taskdata);
+	void **elems = &data->elems[(size_t)task * data->elem_num];
+
+	if (data->type == ALLOC_MEMARENA) {
+		MemArena *arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, __func__);
+		for (unsigned int i = 0; i < data->elem_num; i++) {
+			elems[i] = BLI_memarena_alloc(arena, ELEM_SIZE);
+			memset(elems[i], 0, sizeof(int));
+		}
+		BLI_memarena_free(arena);
+		return;
+	}
+
+	for (unsigned int i = 0; i < data->elem_num; i++) {
+		elems[i] = bench_alloc(data, threadid);
+		memset(elems[i], 0, sizeof(int));
+	}
+	/* free half of them, the other half is freed from the main thread */
+	for (unsigned int i = 0; i < data->elem_num; i += 2) {
+		bench_free(data, elems[i], threadid);
+		elems[i] = NULL;
+	}
+}
+
+static void mempool_bench(const char *id, AllocType type, unsigned int elem_num)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	BenchData data;
+
+	data.type = type;
+	data.elem_num = elem_num;
+	data.elems = (void **)MEM_mallocN(sizeof(void *) * elem_num * TASK_NUM, __func__);
+	data.pool = NULL;
+	if (type == ALLOC_MEMPOOL_CONCURRENT) {
+		data.pool = BLI_mempool_create_concurrent(
+		        ELEM_SIZE, 0, 512, BLI_MEMPOOL_NOP, (unsigned int)BLI_task_scheduler_num_threads(scheduler) + 1);
+	}
+	else if (type == ALLOC_MEMPOOL_LOCKED) {
+		data.pool = BLI_mempool_create(ELEM_SIZE, 0, 512, BLI_MEMPOOL_NOP);
+	}
+	BLI_spin_init(&data.lock);
+
+	printf("--- %s ---\n", id);
+
+	TIMEIT_START(alloc_free);
+
+	TaskPool *task_pool = BLI_task_pool_create(scheduler, &data);
+	for (int task = 0; task < TASK_NUM; task++) {
+		BLI_task_pool_push(task_pool, bench_task, SET_INT_IN_POINTER(task), false, TASK_PRIORITY_HIGH);
+	}
+	BLI_task_pool_work_and_wait(task_pool);
+	BLI_task_pool_free(task_pool);
+
+	/* free the remaining elements from the main thread */
+	if (type != ALLOC_MEMARENA) {
+		for (size_t i = 1; i < (size_t)elem_num * TASK_NUM; i += 2) {
+			bench_free(&data, data.elems[i], 0);
+		}
+	}
+
+	TIMEIT_END(alloc_free);
+
+	if (data.pool) {
+		EXPECT_EQ(0, BLI_mempool_count(data.pool));
+		BLI_mempool_destroy(data.pool);
+	}
+	BLI_spin_end(&data.lock);
+	MEM_freeN(data.elems);
+}
+
+static void mempool_tests(const char *id, unsigned int elem_num)
+{
+	printf("\n========== STARTING %s ==========\n", id);
+
+	BLI_threadapi_init();
+
+	printf("%d threads\n", BLI_task_scheduler_num_threads(BLI_task_scheduler_get()));
+
+	mempool_bench("MemPool Concurrent", ALLOC_MEMPOOL_CONCURRENT, elem_num);
+	mempool_bench("MemPool Locked", ALLOC_MEMPOOL_LOCKED, elem_num);
+	mempool_bench("GuardedAlloc", ALLOC_GUARDEDALLOC, elem_num);
+	mempool_bench("MemArena (no free)", ALLOC_MEMARENA, elem_num);
+
+	printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(mempool, AllocFree10000)
+{
+	mempool_tests("AllocFree - 256 tasks, 10000 elements", 10000);
+}
+
+TEST(mempool, AllocFree100000)
+{
+	mempool_tests("AllocFree - 256 tasks, 100000 elements", 100000);
+}
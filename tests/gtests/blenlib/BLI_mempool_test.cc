@@ -0,0 +1,179 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <set>
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+#include "BLI_utildefines.h"
+#include "BLI_mempool.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+}
+
+#define ELEM_NUM 10000
+#define TASK_NUM 64
+
+typedef struct Elem {
+	int task, index;
+	int data[2];
+} Elem;
+
+TEST(mempool, AllocFree)
+{
+	BLI_mempool *pool = BLI_mempool_create(sizeof(Elem), 0, 512, BLI_MEMPOOL_ALLOW_ITER);
+	Elem *elems[ELEM_NUM];
+
+	for (int i = 0; i < ELEM_NUM; i++) {
+		elems[i] = (Elem *)BLI_mempool_calloc(pool);
+		elems[i]->index = i;
+	}
+	EXPECT_EQ(ELEM_NUM, BLI_mempool_count(pool));
+
+	for (int i = 0; i < ELEM_NUM; i += 2) {
+		BLI_mempool_free(pool, elems[i]);
+	}
+	EXPECT_EQ(ELEM_NUM / 2, BLI_mempool_count(pool));
+
+	BLI_mempool_iter iter;
+	Elem *elem;
+	int elem_num = 0;
+	BLI_mempool_iternew(pool, &iter);
+	while ((elem = (Elem *)BLI_mempool_iterstep(&iter))) {
+		EXPECT_EQ(1, elem->index % 2);
+		elem_num++;
+	}
+	EXPECT_EQ(ELEM_NUM / 2, elem_num);
+
+	BLI_mempool_destroy(pool);
+}
+
+/* Elements freed by another thread go back to the thread owning them. */
+TEST(mempool, ConcurrentRemoteFree)
+{
+	BLI_threadapi_init();
+
+	BLI_mempool *pool = BLI_mempool_create_concurrent(sizeof(Elem), 0, 512, BLI_MEMPOOL_NOP, 2);
+	std::set<void *> elems_freed;
+	Elem *elems[ELEM_NUM];
+
+	for (int i = 0; i < ELEM_NUM; i++) {
+		elems[i] = (Elem *)BLI_mempool_alloc_thread(pool, 0);
+	}
+	for (int i = 0; i < ELEM_NUM; i++) {
+		BLI_mempool_free_thread(pool, elems[i], 1);
+		elems_freed.insert(elems[i]);
+	}
+	EXPECT_EQ(0, BLI_mempool_count(pool));
+
+	/* the main thread gets all freed elements back before allocating new chunks,
+	 * (after the remaining elements of its last chunk) */
+	int elems_reused = 0;
+	for (int i = 0; i < ELEM_NUM * 2; i++) {
+		Elem *elem = (Elem *)BLI_mempool_alloc_thread(pool, 0);
+		elems_reused += (int)elems_freed.count(elem);
+	}
+	EXPECT_EQ(ELEM_NUM, elems_reused);
+	EXPECT_EQ(ELEM_NUM * 2, BLI_mempool_count(pool));
+
+	/* while other threads use their own chunks */
+	Elem *elem = (Elem *)BLI_mempool_alloc_thread(pool, 1);
+	EXPECT_EQ(0, elems_freed.count(elem));
+	BLI_mempool_free(pool, elem);
+	EXPECT_EQ(ELEM_NUM * 2, BLI_mempool_count(pool));
+
+	BLI_mempool_clear(pool);
+	EXPECT_EQ(0, BLI_mempool_count(pool));
+
+	BLI_mempool_destroy(pool);
+}
+
+typedef struct StressData {
+	BLI_mempool *pool;
+	Elem *(*elems)[ELEM_NUM];
+} StressData;
+
+/* Allocate elements, freeing and re-allocating some of them. */
+static void stress_alloc_task(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+	StressData *data = (StressData *)BLI_task_pool_userdata(pool);
+	const int task = GET_INT_FROM_POINTER(taskdata);
+	Elem **elems = data->elems[task];
+
+	for (int i = 0; i < ELEM_NUM; i++) {
+		elems[i] = (Elem *)BLI_mempool_alloc_thread(data->pool, threadid);
+		elems[i]->task = task;
+		elems[i]->index = i;
+		if (i % 3 == 0) {
+			BLI_mempool_free_thread(data->pool, elems[i], threadid);
+			elems[i] = (Elem *)BLI_mempool_calloc_thread(data->pool, threadid);
+			elems[i]->task = task;
+			elems[i]->index = i;
+		}
+	}
+}
+
+/* Check and free the elements of another task, which are likely owned by another thread. */
+static void stress_free_task(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+	StressData *data = (StressData *)BLI_task_pool_userdata(pool);
+	const int task = (GET_INT_FROM_POINTER(taskdata) + 1) % TASK_NUM;
+	Elem **elems = data->elems[task];
+
+	for (int i = 0; i < ELEM_NUM; i += 2) {
+		EXPECT_EQ(task, elems[i]->task);
+		EXPECT_EQ(i, elems[i]->index);
+		BLI_mempool_free_thread(data->pool, elems[i], threadid);
+		elems[i] = NULL;
+	}
+}
+
+TEST(mempool, ConcurrentStress)
+{
+	BLI_threadapi_init();
+
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	StressData data;
+	data.pool = BLI_mempool_create_concurrent(
+	        sizeof(Elem), 0, 512, BLI_MEMPOOL_ALLOW_ITER, (unsigned int)BLI_task_scheduler_num_threads(scheduler) + 1);
+	data.elems = (Elem *(*)[ELEM_NUM])MEM_mallocN(sizeof(*data.elems) * TASK_NUM, __func__);
+
+	for (int pass = 0; pass < 2; pass++) {
+		TaskPool *task_pool = BLI_task_pool_create(scheduler, &data);
+		for (int task = 0; task < TASK_NUM; task++) {
+			BLI_task_pool_push(task_pool, stress_alloc_task, SET_INT_IN_POINTER(task), false, TASK_PRIORITY_HIGH);
+		}
+		BLI_task_pool_work_and_wait(task_pool);
+		BLI_task_pool_free(task_pool);
+
+		EXPECT_EQ(TASK_NUM * ELEM_NUM, BLI_mempool_count(data.pool));
+
+		task_pool = BLI_task_pool_create(scheduler, &data);
+		for (int task = 0; task < TASK_NUM; task++) {
+			BLI_task_pool_push(task_pool, stress_free_task, SET_INT_IN_POINTER(task), false, TASK_PRIORITY_HIGH);
+		}
+		BLI_task_pool_work_and_wait(task_pool);
+		BLI_task_pool_free(task_pool);
+
+		EXPECT_EQ(TASK_NUM * ELEM_NUM / 2, BLI_mempool_count(data.pool));
+
+		/* the remaining elements are intact */
+		BLI_mempool_iter iter;
+		Elem *elem;
+		int elem_num = 0;
+		BLI_mempool_iternew(data.pool, &iter);
+		while ((elem = (Elem *)BLI_mempool_iterstep(&iter))) {
+			EXPECT_EQ(1, elem->index % 2);
+			EXPECT_EQ(elem, data.elems[elem->task][elem->index]);
+			elem_num++;
+		}
+		EXPECT_EQ(TASK_NUM * ELEM_NUM / 2, elem_num);
+
+		/* second pass re-uses the freed elements */
+		BLI_mempool_clear(data.pool);
+	}
+
+	MEM_freeN(data.elems);
+	BLI_mempool_destroy(data.pool);
+}
@@ -0,0 +1,322 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+#include "BLI_utildefines.h"
+#include "BLI_ghash.h"
+#include "BLI_ohash.h"
+#include "BLI_edgehash.h"
+#include "BLI_smallhash.h"
+#include "PIL_time_utildefines.h"
+}
+
+/* Compare the open addressing OHash against the other blenlib hash containers,
+ * on the same set of integer keys (edge keys for EdgeHash). */
+
+/* Run the longest tests (10M and 100M entries, the latter needs several GB of memory)! */
+//#define OHASH_RUN_BIG
+
+/* Times the small case is repeated, to get measurable timings. */
+#define TESTCASE_SMALL_REPEAT 1000
+
+/* Unique keys in a scrambled order, multiplying by an odd constant is a bijection. */
+static unsigned int *init_keys(const unsigned int nbr)
+{
+	unsigned int *keys = (unsigned int *)MEM_mallocN(sizeof(*keys) * nbr, __func__);
+
+	for (unsigned int i = 0; i < nbr; i++) {
+		keys[i] = i * 2246822519u;
+	}
+	return keys;
+}
+
+static void ghash_tests(const unsigned int *keys, const unsigned int nbr, const int repeat)
+{
+	unsigned int i;
+	int r;
+
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+	TIMEIT_START(ghash_insert);
+	for (r = repeat; r--; ) {
+		BLI_ghash_clear(ghash, NULL, NULL);
+		for (i = 0; i < nbr; i++) {
+			BLI_ghash_insert(ghash, SET_UINT_IN_POINTER(keys[i]), SET_UINT_IN_POINTER(i));
+		}
+	}
+	TIMEIT_END(ghash_insert);
+
+	TIMEIT_START(ghash_lookup);
+	for (r = repeat; r--; ) {
+		for (i = 0; i < nbr; i++) {
+			void *v = BLI_ghash_lookup(ghash, SET_UINT_IN_POINTER(keys[i]));
+			EXPECT_EQ(GET_UINT_FROM_POINTER(v), i);
+		}
+	}
+	TIMEIT_END(ghash_lookup);
+
+	TIMEIT_START(ghash_lookup_missing);
+	for (r = repeat; r--; ) {
+		for (i = 0; i < nbr; i++) {
+			EXPECT_FALSE(BLI_ghash_haskey(ghash, SET_UINT_IN_POINTER(keys[i] + 1)));
+		}
+	}
+	TIMEIT_END(ghash_lookup_missing);
+
+	{
+		GHashIterator gh_iter;
+		unsigned int sum = 0;
+
+		TIMEIT_START(ghash_iter);
+		for (r = repeat; r--; ) {
+			GHASH_ITER (gh_iter, ghash) {
+				sum += GET_UINT_FROM_POINTER(BLI_ghashIterator_getValue(&gh_iter));
+			}
+		}
+		TIMEIT_END(ghash_iter);
+		printf("(sum %u)\n", sum);
+	}
+
+	TIMEIT_START(ghash_remove);
+	for (i = 0; i < nbr; i++) {
+		BLI_ghash_remove(ghash, SET_UINT_IN_POINTER(keys[i]), NULL, NULL);
+	}
+	TIMEIT_END(ghash_remove);
+	EXPECT_EQ(BLI_ghash_size(ghash), 0);
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+static void ohash_tests(const unsigned int *keys, const unsigned int nbr, const int repeat)
+{
+	unsigned int i;
+	int r;
+
+	OHash *ohash = BLI_ohash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+	TIMEIT_START(ohash_insert);
+	for (r = repeat; r--; ) {
+		BLI_ohash_clear(ohash, NULL, NULL);
+		for (i = 0; i < nbr; i++) {
+			BLI_ohash_insert(ohash, SET_UINT_IN_POINTER(keys[i]), SET_UINT_IN_POINTER(i));
+		}
+	}
+	TIMEIT_END(ohash_insert);
+
+	{
+		double load;
+		int dist_max;
+		double quality = BLI_ohash_calc_quality_ex(ohash, &load, &dist_max);
+		printf("OHash stats (%u entries):\n\tAverage probe length: %f\n\tLoad: %f\n\tLongest probe: %d\n",
+		       BLI_ohash_size(ohash), quality, load, dist_max);
+	}
+
+	TIMEIT_START(ohash_lookup);
+	for (r = repeat; r--; ) {
+		for (i = 0; i < nbr; i++) {
+			void *v = BLI_ohash_lookup(ohash, SET_UINT_IN_POINTER(keys[i]));
+			EXPECT_EQ(GET_UINT_FROM_POINTER(v), i);
+		}
+	}
+	TIMEIT_END(ohash_lookup);
+
+	TIMEIT_START(ohash_lookup_missing);
+	for (r = repeat; r--; ) {
+		for (i = 0; i < nbr; i++) {
+			EXPECT_FALSE(BLI_ohash_haskey(ohash, SET_UINT_IN_POINTER(keys[i] + 1)));
+		}
+	}
+	TIMEIT_END(ohash_lookup_missing);
+
+	{
+		OHashIterator oh_iter;
+		unsigned int sum = 0;
+
+		TIMEIT_START(ohash_iter);
+		for (r = repeat; r--; ) {
+			OHASH_ITER (oh_iter, ohash) {
+				sum += GET_UINT_FROM_POINTER(BLI_ohashIterator_getValue(&oh_iter));
+			}
+		}
+		TIMEIT_END(ohash_iter);
+		printf("(sum %u)\n", sum);
+	}
+
+	TIMEIT_START(ohash_remove);
+	for (i = 0; i < nbr; i++) {
+		BLI_ohash_remove(ohash, SET_UINT_IN_POINTER(keys[i]), NULL, NULL);
+	}
+	TIMEIT_END(ohash_remove);
+	EXPECT_EQ(BLI_ohash_size(ohash), 0);
+
+	BLI_ohash_free(ohash, NULL, NULL);
+}
+
+/* Edge keys are pairs, (key, key + 1) keeps them unique. */
+static void edgehash_tests(const unsigned int *keys, const unsigned int nbr, const int repeat)
+{
+	unsigned int i;
+	int r;
+
+	EdgeHash *ehash = BLI_edgehash_new(__func__);
+
+	TIMEIT_START(edgehash_insert);
+	for (r = repeat; r--; ) {
+		BLI_edgehash_clear(ehash, NULL);
+		for (i = 0; i < nbr; i++) {
+			BLI_edgehash_insert(ehash, keys[i], keys[i] + 1, SET_UINT_IN_POINTER(i));
+		}
+	}
+	TIMEIT_END(edgehash_insert);
+
+	TIMEIT_START(edgehash_lookup);
+	for (r = repeat; r--; ) {
+		for (i = 0; i < nbr; i++) {
+			void *v = BLI_edgehash_lookup(ehash, keys[i], keys[i] + 1);
+			EXPECT_EQ(GET_UINT_FROM_POINTER(v), i);
+		}
+	}
+	TIMEIT_END(edgehash_lookup);
+
+	TIMEIT_START(edgehash_lookup_missing);
+	for (r = repeat; r--; ) {
+		for (i = 0; i < nbr; i++) {
+			EXPECT_FALSE(BLI_edgehash_haskey(ehash, keys[i], keys[i] + 2));
+		}
+	}
+	TIMEIT_END(edgehash_lookup_missing);
+
+	{
+		EdgeHashIterator eh_iter;
+		unsigned int sum = 0;
+
+		TIMEIT_START(edgehash_iter);
+		for (r = repeat; r--; ) {
+			for (BLI_edgehashIterator_init(&eh_iter, ehash);
+			     BLI_edgehashIterator_isDone(&eh_iter) == false;
+			     BLI_edgehashIterator_step(&eh_iter))
+			{
+				sum += GET_UINT_FROM_POINTER(BLI_edgehashIterator_getValue(&eh_iter));
+			}
+		}
+		TIMEIT_END(edgehash_iter);
+		printf("(sum %u)\n", sum);
+	}
+
+	TIMEIT_START(edgehash_remove);
+	for (i = 0; i < nbr; i++) {
+		BLI_edgehash_remove(ehash, keys[i], keys[i] + 1, NULL);
+	}
+	TIMEIT_END(edgehash_remove);
+	EXPECT_EQ(BLI_edgehash_size(ehash), 0);
+
+	BLI_edgehash_free(ehash, NULL);
+}
+
+/* SmallHash iteration stops at a NULL value, values are offset by one. */
+static void smallhash_tests(const unsigned int *keys, const unsigned int nbr, const int repeat)
+{
+	unsigned int i;
+	int r;
+
+	SmallHash shash;
+	BLI_smallhash_init(&shash);
+
+	TIMEIT_START(smallhash_insert);
+	for (r = repeat; r--; ) {
+		BLI_smallhash_release(&shash);
+		BLI_smallhash_init(&shash);
+		for (i = 0; i < nbr; i++) {
+			BLI_smallhash_insert(&shash, (uintptr_t)keys[i], SET_UINT_IN_POINTER(i + 1));
+		}
+	}
+	TIMEIT_END(smallhash_insert);
+
+	TIMEIT_START(smallhash_lookup);
+	for (r = repeat; r--; ) {
+		for (i = 0; i < nbr; i++) {
+			void *v = BLI_smallhash_lookup(&shash, (uintptr_t)keys[i]);
+			EXPECT_EQ(GET_UINT_FROM_POINTER(v), i + 1);
+		}
+	}
+	TIMEIT_END(smallhash_lookup);
+
+	TIMEIT_START(smallhash_lookup_missing);
+	for (r = repeat; r--; ) {
+		for (i = 0; i < nbr; i++) {
+			EXPECT_FALSE(BLI_smallhash_haskey(&shash, (uintptr_t)(keys[i] + 1)));
+		}
+	}
+	TIMEIT_END(smallhash_lookup_missing);
+
+	{
+		SmallHashIter sh_iter;
+		uintptr_t key;
+		unsigned int sum = 0;
+
+		TIMEIT_START(smallhash_iter);
+		for (r = repeat; r--; ) {
+			for (void *v = BLI_smallhash_iternew(&shash, &sh_iter, &key);
+			     v;
+			     v = BLI_smallhash_iternext(&sh_iter, &key))
+			{
+				sum += GET_UINT_FROM_POINTER(v);
+			}
+		}
+		TIMEIT_END(smallhash_iter);
+		printf("(sum %u)\n", sum);
+	}
+
+	/* No removal, SmallHash is built without it (see USE_REMOVE). */
+
+	BLI_smallhash_release(&shash);
+}
+
+static void containers_tests(const char *id, const unsigned int nbr, const int repeat)
+{
+	unsigned int *keys = init_keys(nbr);
+
+	printf("\n========== STARTING %s ==========\n", id);
+
+	printf("\n--- GHash ---\n");
+	ghash_tests(keys, nbr, repeat);
+	printf("\n--- OHash ---\n");
+	ohash_tests(keys, nbr, repeat);
+	printf("\n--- EdgeHash ---\n");
+	edgehash_tests(keys, nbr, repeat);
+	printf("\n--- SmallHash ---\n");
+	smallhash_tests(keys, nbr, repeat);
+
+	printf("========== ENDED %s ==========\n\n", id);
+
+	MEM_freeN(keys);
+}
+
+TEST(ohash, Containers1000)
+{
+	containers_tests("Containers - 1000 (x1000)", 1000, TESTCASE_SMALL_REPEAT);
+}
+
+TEST(ohash, Containers100000)
+{
+	containers_tests("Containers - 100000", 100000, 1);
+}
+
+TEST(ohash, Containers1000000)
+{
+	containers_tests("Containers - 1000000", 1000000, 1);
+}
+
+#ifdef OHASH_RUN_BIG
+TEST(ohash, Containers10000000)
+{
+	containers_tests("Containers - 10000000", 10000000, 1);
+}
+
+TEST(ohash, Containers100000000)
+{
+	containers_tests("Containers - 100000000", 100000000, 1);
+}
+#endif
@@ -0,0 +1,244 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_ohash.h"
+}
+
+#define TESTCASE_SIZE 10000
+
+/* Note: keys are scrambled integers, multiplying by an odd constant is a bijection,
+ *       so all keys are unique (unlike random ones). */
+static void init_keys(unsigned int keys[TESTCASE_SIZE], const unsigned int seed)
+{
+	unsigned int i;
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		keys[i] = (i + seed * TESTCASE_SIZE) * 2246822519u;
+	}
+}
+
+/* Here we simply insert and then lookup all keys, ensuring we do get back the expected stored 'data'. */
+TEST(ohash, InsertLookup)
+{
+	OHash *ohash = BLI_ohash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	init_keys(keys, 0);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ohash_insert(ohash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+
+	EXPECT_EQ(BLI_ohash_size(ohash), TESTCASE_SIZE);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void *v = BLI_ohash_lookup(ohash, SET_UINT_IN_POINTER(*k));
+		EXPECT_EQ(GET_UINT_FROM_POINTER(v), *k);
+	}
+
+	EXPECT_FALSE(BLI_ohash_haskey(ohash, SET_UINT_IN_POINTER(1)));
+	EXPECT_EQ(BLI_ohash_lookup_default(ohash, SET_UINT_IN_POINTER(1), SET_UINT_IN_POINTER(42)),
+	          SET_UINT_IN_POINTER(42));
+
+	BLI_ohash_free(ohash, NULL, NULL);
+}
+
+/* Remove every other key, the remaining ones must still be found after the backward shifts. */
+TEST(ohash, InsertRemove)
+{
+	OHash *ohash = BLI_ohash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int keys[TESTCASE_SIZE];
+	int i;
+
+	init_keys(keys, 1);
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		BLI_ohash_insert(ohash, SET_UINT_IN_POINTER(keys[i]), SET_UINT_IN_POINTER(keys[i]));
+	}
+
+	for (i = 0; i < TESTCASE_SIZE; i += 2) {
+		void *v = BLI_ohash_popkey(ohash, SET_UINT_IN_POINTER(keys[i]), NULL);
+		EXPECT_EQ(GET_UINT_FROM_POINTER(v), keys[i]);
+	}
+
+	EXPECT_EQ(BLI_ohash_size(ohash), TESTCASE_SIZE / 2);
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		EXPECT_EQ(BLI_ohash_haskey(ohash, SET_UINT_IN_POINTER(keys[i])), (i % 2) != 0);
+	}
+
+	for (i = 1; i < TESTCASE_SIZE; i += 2) {
+		EXPECT_TRUE(BLI_ohash_remove(ohash, SET_UINT_IN_POINTER(keys[i]), NULL, NULL));
+	}
+	EXPECT_FALSE(BLI_ohash_remove(ohash, SET_UINT_IN_POINTER(keys[1]), NULL, NULL));
+
+	EXPECT_EQ(BLI_ohash_size(ohash), 0);
+
+	BLI_ohash_free(ohash, NULL, NULL);
+}
+
+/* Same as above, but this time we allow ohash to shrink. */
+TEST(ohash, InsertRemoveShrink)
+{
+	OHash *ohash = BLI_ohash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	double load;
+	int i;
+
+	BLI_ohash_flag_set(ohash, OHASH_FLAG_ALLOW_SHRINK);
+	init_keys(keys, 2);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ohash_insert(ohash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+
+	for (i = TESTCASE_SIZE - 10, k = keys; i--; k++) {
+		void *v = BLI_ohash_popkey(ohash, SET_UINT_IN_POINTER(*k), NULL);
+		EXPECT_EQ(GET_UINT_FROM_POINTER(v), *k);
+	}
+
+	EXPECT_EQ(BLI_ohash_size(ohash), 10);
+	BLI_ohash_calc_quality_ex(ohash, &load, NULL);
+	EXPECT_GT(load, 0.1);
+
+	for (i = 10; i--; k++) {
+		void *v = BLI_ohash_lookup(ohash, SET_UINT_IN_POINTER(*k));
+		EXPECT_EQ(GET_UINT_FROM_POINTER(v), *k);
+	}
+
+	BLI_ohash_free(ohash, NULL, NULL);
+}
+
+/* Check copy. */
+TEST(ohash, Copy)
+{
+	OHash *ohash = BLI_ohash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	OHash *ohash_copy;
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	init_keys(keys, 3);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ohash_insert(ohash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+
+	ohash_copy = BLI_ohash_copy(ohash, NULL, NULL);
+
+	EXPECT_EQ(BLI_ohash_size(ohash_copy), TESTCASE_SIZE);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void *v = BLI_ohash_lookup(ohash_copy, SET_UINT_IN_POINTER(*k));
+		EXPECT_EQ(GET_UINT_FROM_POINTER(v), *k);
+	}
+
+	BLI_ohash_free(ohash, NULL, NULL);
+	BLI_ohash_free(ohash_copy, NULL, NULL);
+}
+
+/* Check pop, with insertions in-between. */
+TEST(ohash, Pop)
+{
+	OHash *ohash = BLI_ohash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	BLI_ohash_flag_set(ohash, OHASH_FLAG_ALLOW_SHRINK);
+	init_keys(keys, 4);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ohash_insert(ohash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+
+	OHashIterState pop_state = {0};
+
+	for (i = TESTCASE_SIZE / 2; i--; ) {
+		void *k, *v;
+		bool success = BLI_ohash_pop(ohash, &pop_state, &k, &v);
+		EXPECT_EQ(k, v);
+		EXPECT_TRUE(success);
+
+		if (i % 2) {
+			BLI_ohash_insert(ohash, SET_UINT_IN_POINTER(i * 4 + 1), SET_UINT_IN_POINTER(i * 4 + 1));
+		}
+	}
+
+	EXPECT_EQ(BLI_ohash_size(ohash), (TESTCASE_SIZE - TESTCASE_SIZE / 2 + TESTCASE_SIZE / 4));
+
+	{
+		void *k, *v;
+		while (BLI_ohash_pop(ohash, &pop_state, &k, &v)) {
+			EXPECT_EQ(k, v);
+		}
+	}
+	EXPECT_EQ(BLI_ohash_size(ohash), 0);
+
+	BLI_ohash_free(ohash, NULL, NULL);
+}
+
+/* Check ensure and reinsert, and that iteration visits every entry once. */
+TEST(ohash, EnsureIter)
+{
+	OHash *ohash = BLI_ohash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	OHashIterator ohi;
+	unsigned int keys[TESTCASE_SIZE];
+	unsigned int sum = 0, sum_iter = 0;
+	int i;
+
+	init_keys(keys, 5);
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		void **val_p;
+		EXPECT_FALSE(BLI_ohash_ensure_p(ohash, SET_UINT_IN_POINTER(keys[i]), &val_p));
+		*val_p = SET_UINT_IN_POINTER(1);
+		EXPECT_TRUE(BLI_ohash_ensure_p(ohash, SET_UINT_IN_POINTER(keys[i]), &val_p));
+		EXPECT_EQ(*val_p, SET_UINT_IN_POINTER(1));
+	}
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		EXPECT_FALSE(BLI_ohash_reinsert(ohash, SET_UINT_IN_POINTER(keys[i]), SET_UINT_IN_POINTER(i), NULL, NULL));
+		sum += (unsigned int)i;
+	}
+
+	EXPECT_EQ(BLI_ohash_size(ohash), TESTCASE_SIZE);
+
+	i = 0;
+	OHASH_ITER (ohi, ohash) {
+		sum_iter += GET_UINT_FROM_POINTER(BLI_ohashIterator_getValue(&ohi));
+		i++;
+	}
+	EXPECT_EQ(i, TESTCASE_SIZE);
+	EXPECT_EQ(sum_iter, sum);
+
+	BLI_ohash_free(ohash, NULL, NULL);
+}
+
+/* Check the set variant. */
+TEST(oset, AddRemove)
+{
+	OSet *oset = BLI_oset_ptr_new(__func__);
+	unsigned int keys[TESTCASE_SIZE];
+	int i;
+
+	init_keys(keys, 6);
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		EXPECT_TRUE(BLI_oset_add(oset, SET_UINT_IN_POINTER(keys[i])));
+		EXPECT_FALSE(BLI_oset_add(oset, SET_UINT_IN_POINTER(keys[i])));
+	}
+
+	EXPECT_EQ(BLI_oset_size(oset), TESTCASE_SIZE);
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		EXPECT_TRUE(BLI_oset_remove(oset, SET_UINT_IN_POINTER(keys[i]), NULL));
+		EXPECT_FALSE(BLI_oset_haskey(oset, SET_UINT_IN_POINTER(keys[i])));
+	}
+
+	EXPECT_EQ(BLI_oset_size(oset), 0);
+
+	BLI_oset_free(oset, NULL);
+}
@@ -0,0 +1,135 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Time the cloth solver on grids of increasing resolution.
+#
+# Each test case is a grid pinned at two corners, falling under gravity,
+# simulated for a number of frames. Reported is the time per solver step,
+# the part of it spent in collision handling and the average number of
+# conjugate gradient iterations per step.
+#
+# This is not run as part of the test suite (timings depend on the system),
+# run manually to compare changes, optionally passing the names of the cases to run:
+#
+# ./blender.bin --background --factory-startup --python tests/python/bl_cloth_performance.py -- grid_64 grid_224
+
+import sys
+import time
+
+import bpy
+
+# number of frames simulated for each case
+FRAMES = 10
+
+
+# -----------------------------------------------------------------------------
+# utility functions
+
+def scene_clear(scene):
+    for ob in scene.objects[:]:
+        scene.objects.unlink(ob)
+        bpy.data.objects.remove(ob)
+
+
+def cloth_grid_add(scene, subdiv):
+    bpy.ops.mesh.primitive_grid_add(x_subdivisions=subdiv, y_subdivisions=subdiv, radius=1.0)
+    ob = scene.objects.active
+
+    # pin two corners
+    vgroup = ob.vertex_groups.new(name="Pin")
+    vgroup.add([0, subdiv - 1], 1.0, 'REPLACE')
+
+    md = ob.modifiers.new(name="Cloth", type='CLOTH')
+    settings = md.settings
+    settings.vertex_group_mass = vgroup.name
+    md.point_cache.frame_start = 1
+    md.point_cache.frame_end = FRAMES + 1
+    return ob, md
+
+
+# -----------------------------------------------------------------------------
+# test cases, each takes the scene and returns the cloth modifier
+
+def case_grid_64(scene):
+    return cloth_grid_add(scene, 64)[1]
+
+
+def case_grid_128(scene):
+    return cloth_grid_add(scene, 128)[1]
+
+
+def case_grid_224(scene):
+    # roughly 50k vertices, a high resolution garment
+    return cloth_grid_add(scene, 224)[1]
+
+
+def case_colliders_128(scene):
+    # grid falling onto a row of dense spheres
+    for i in range(4):
+        bpy.ops.mesh.primitive_uv_sphere_add(segments=64, ring_count=32, size=0.2, location=(i * 0.5 - 0.75, 0.0, -0.3))
+        scene.objects.active.modifiers.new(name="Collision", type='COLLISION')
+    return cloth_grid_add(scene, 128)[1]
+
+
+CASES = (
+    ("grid_64", case_grid_64),
+    ("grid_128", case_grid_128),
+    ("grid_224", case_grid_224),
+    ("colliders_128", case_colliders_128),
+)
+
+
+# -----------------------------------------------------------------------------
+# main
+
+def main():
+    argv = sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else []
+    scene = bpy.context.scene
+
+    print("\n========== cloth performance ==========")
+    print("%-14s %8s %12s %14s %14s" % ("case", "verts", "ms/step", "collision ms", "CG iterations"))
+    for name, case_fn in CASES:
+        if argv and name not in argv:
+            continue
+
+        scene_clear(scene)
+        scene.frame_set(1)
+        md = case_fn(scene)
+        steps = md.settings.quality
+
+        time_total = 0.0
+        time_collision = 0.0
+        iterations = 0.0
+        for frame in range(2, FRAMES + 2):
+            time_start = time.time()
+            scene.frame_set(frame)
+            time_total += time.time() - time_start
+            time_collision += md.solver_result.collision_time
+            iterations += md.solver_result.avg_iterations
+
+        print("%-14s %8d %12.3f %14.3f %14.1f" % (
+            name, len(scene.objects.active.data.vertices),
+            time_total * 1000.0 / (FRAMES * steps), time_collision * 1000.0 / (FRAMES * steps),
+            iterations / FRAMES))
+    print("==========\n")
+
+
+if __name__ == "__main__":
+    main()
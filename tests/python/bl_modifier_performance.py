@@ -0,0 +1,217 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Time the evaluation of individual modifiers on a dense mesh.
+#
+# Each test case sets up a scene with a single modifier, the time reported
+# is the time to evaluate the object with the modifier enabled,
+# minus the time it takes without (so only the modifier itself is measured).
+#
+# This is not run as part of the test suite (timings depend on the system),
+# run manually to compare changes, optionally passing the names of the cases to run:
+#
+# ./blender.bin --background --factory-startup --python tests/python/bl_modifier_performance.py -- lattice curve
+
+import math
+import sys
+import time
+
+import bpy
+
+# number of times each evaluation is repeated, the best time is used.
+REPEAT = 5
+
+# subdivisions of the test mesh (grid of SUBDIV x SUBDIV vertices, unless the test case uses less)
+SUBDIV = 512
+
+
+# -----------------------------------------------------------------------------
+# utility functions
+
+def scene_clear(scene):
+    for ob in scene.objects[:]:
+        scene.objects.unlink(ob)
+        bpy.data.objects.remove(ob)
+
+
+def mesh_grid_add(scene, subdiv=SUBDIV):
+    bpy.ops.mesh.primitive_grid_add(x_subdivisions=subdiv, y_subdivisions=subdiv, radius=1.0)
+    ob = scene.objects.active
+    # add some variation along Z so deformers have something to work with
+    for v in ob.data.vertices:
+        v.co.z = (v.co.x * v.co.y) * 0.25
+    return ob
+
+
+def evaluate_time(scene, ob):
+    time_best = None
+    for _ in range(REPEAT):
+        time_start = time.time()
+        me = ob.to_mesh(scene, True, 'PREVIEW')
+        time_delta = time.time() - time_start
+        bpy.data.meshes.remove(me)
+        if time_best is None or time_delta < time_best:
+            time_best = time_delta
+    return time_best
+
+
+# -----------------------------------------------------------------------------
+# test cases, each takes the scene and returns the object & modifier to time
+
+def case_lattice(scene):
+    ob = mesh_grid_add(scene)
+    bpy.ops.object.add(type='LATTICE')
+    ob_lattice = scene.objects.active
+    ob_lattice.scale = (1.5, 1.5, 1.5)
+    lt = ob_lattice.data
+    lt.points_u = lt.points_v = lt.points_w = 4
+    lt.interpolation_type_u = lt.interpolation_type_v = lt.interpolation_type_w = 'KEY_BSPLINE'
+    for i, pt in enumerate(lt.points):
+        pt.co_deform.z += 0.1 * (i % 3)
+    md = ob.modifiers.new(name="Lattice", type='LATTICE')
+    md.object = ob_lattice
+    return ob, md
+
+
+def case_curve(scene):
+    ob = mesh_grid_add(scene)
+    bpy.ops.curve.primitive_bezier_circle_add(radius=4.0)
+    ob_curve = scene.objects.active
+    md = ob.modifiers.new(name="Curve", type='CURVE')
+    md.object = ob_curve
+    return ob, md
+
+
+def case_corrective_smooth(scene):
+    ob = mesh_grid_add(scene)
+    md = ob.modifiers.new(name="CorrectiveSmooth", type='CORRECTIVE_SMOOTH')
+    md.rest_source = 'ORCO'
+    md.iterations = 10
+    md.use_pin_boundary = True
+    return ob, md
+
+
+def case_corrective_smooth_length_weighted(scene):
+    ob, md = case_corrective_smooth(scene)
+    md.smooth_type = 'LENGTH_WEIGHTED'
+    return ob, md
+
+
+def case_laplacian_smooth(scene):
+    # solving the system is much slower than the other deformers, use a smaller mesh
+    ob = mesh_grid_add(scene, subdiv=SUBDIV // 4)
+    md = ob.modifiers.new(name="LaplacianSmooth", type='LAPLACIANSMOOTH')
+    md.iterations = 2
+    return ob, md
+
+
+def remesh_add(scene, octree_depth):
+    bpy.ops.mesh.primitive_uv_sphere_add(segments=256, ring_count=128, size=1.0)
+    ob = scene.objects.active
+    md = ob.modifiers.new(name="Remesh", type='REMESH')
+    md.mode = 'SHARP'
+    md.octree_depth = octree_depth
+    md.use_remove_disconnected = False
+    return ob, md
+
+
+def case_remesh_7(scene):
+    return remesh_add(scene, 7)
+
+
+def case_remesh_8(scene):
+    return remesh_add(scene, 8)
+
+
+def case_remesh_9(scene):
+    return remesh_add(scene, 9)
+
+
+def case_remesh_10(scene):
+    return remesh_add(scene, 10)
+
+
+def boolean_add(scene, operation):
+    # two dense spheres, the second one bumpy so they intersect all over
+    bpy.ops.mesh.primitive_uv_sphere_add(segments=256, ring_count=128, size=1.0)
+    ob = scene.objects.active
+    bpy.ops.mesh.primitive_uv_sphere_add(segments=256, ring_count=128, size=1.0)
+    ob_other = scene.objects.active
+    for v in ob_other.data.vertices:
+        v.co *= 1.0 + 0.01 * math.sin(v.co.z * 100.0) * math.sin(math.atan2(v.co.y, v.co.x) * 16.0)
+    ob_other.hide = True
+    md = ob.modifiers.new(name="Boolean", type='BOOLEAN')
+    md.solver = 'BMESH'
+    md.operation = operation
+    md.object = ob_other
+    return ob, md
+
+
+def case_boolean_difference(scene):
+    return boolean_add(scene, 'DIFFERENCE')
+
+
+def case_boolean_union(scene):
+    return boolean_add(scene, 'UNION')
+
+
+CASES = (
+    ("lattice", case_lattice),
+    ("curve", case_curve),
+    ("corrective_smooth", case_corrective_smooth),
+    ("corrective_smooth_length_weighted", case_corrective_smooth_length_weighted),
+    ("laplacian_smooth", case_laplacian_smooth),
+    ("remesh_7", case_remesh_7),
+    ("remesh_8", case_remesh_8),
+    ("remesh_9", case_remesh_9),
+    ("remesh_10", case_remesh_10),
+    ("boolean_difference", case_boolean_difference),
+    ("boolean_union", case_boolean_union),
+)
+
+
+# -----------------------------------------------------------------------------
+# main
+
+def main():
+    argv = sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else []
+    scene = bpy.context.scene
+
+    print("\n========== modifier performance ==========")
+    for name, case_fn in CASES:
+        if argv and name not in argv:
+            continue
+
+        scene_clear(scene)
+        ob, md = case_fn(scene)
+        scene.objects.active = ob
+        scene.update()
+
+        md.show_viewport = False
+        time_base = evaluate_time(scene, ob)
+        md.show_viewport = True
+        time_mod = evaluate_time(scene, ob)
+
+        print("%-36s %8d verts %10.3f ms" % (name, len(ob.data.vertices), max(time_mod - time_base, 0.0) * 1000.0))
+    print("==========\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+# Apache License, Version 2.0
+
+# Clearing and converting disk caches stored in a single packed file
+# (PointCache.use_disk_cache_packed).
+#
+# ./blender.bin --background -noaudio --factory-startup --python tests/python/bl_pointcache_packed.py -- --verbose
+import bpy
+import os
+import shutil
+import tempfile
+import unittest
+
+FRAMES = 10
+
+
+class TestPointCachePacked(unittest.TestCase):
+
+    def setUp(self):
+        bpy.ops.wm.read_factory_settings()
+        scene = bpy.context.scene
+        for ob in scene.objects[:]:
+            scene.objects.unlink(ob)
+            bpy.data.objects.remove(ob)
+        scene.frame_start = 1
+        scene.frame_end = FRAMES
+        scene.frame_set(1)
+
+        # disk cache needs a saved file
+        self.directory = tempfile.mkdtemp()
+        bpy.ops.wm.save_as_mainfile(filepath=os.path.join(self.directory, "pointcache_packed.blend"))
+        self.cache_directory = os.path.join(self.directory, "blendcache_pointcache_packed")
+
+        bpy.ops.mesh.primitive_grid_add(x_subdivisions=8, y_subdivisions=8, radius=1.0)
+        self.ob = scene.objects.active
+        self.md = self.ob.modifiers.new(name="Cloth", type='CLOTH')
+        cache = self.md.point_cache
+        cache.frame_end = FRAMES
+        cache.use_disk_cache = True
+        cache.use_disk_cache_packed = True
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def cache_files(self, ext):
+        if not os.path.isdir(self.cache_directory):
+            return []
+        return [filename for filename in os.listdir(self.cache_directory) if filename.endswith(ext)]
+
+    def coords_at_frame(self, frame):
+        scene = bpy.context.scene
+        scene.frame_set(frame)
+        me = self.ob.to_mesh(scene, True, 'PREVIEW')
+        coords = [v.co.copy() for v in me.vertices]
+        bpy.data.meshes.remove(me)
+        return coords
+
+    def assertCoordsEqual(self, coords_a, coords_b):
+        self.assertEqual(len(coords_a), len(coords_b))
+        for co_a, co_b in zip(coords_a, coords_b):
+            self.assertAlmostEqual((co_a - co_b).length, 0.0, places=5)
+
+    def test_clear_all(self):
+        scene = bpy.context.scene
+        coords_rest = self.coords_at_frame(1)
+
+        bpy.ops.ptcache.bake_all(bake=True)
+        self.assertEqual(len(self.cache_files(".bpack")), 1)
+        # the cloth falls, so the cached frame differs from the rest shape
+        self.assertNotAlmostEqual((self.coords_at_frame(FRAMES)[0] - coords_rest[0]).length, 0.0, places=3)
+
+        # outdate the cache, evaluating the start frame clears all frames
+        bpy.ops.ptcache.free_bake_all()
+        self.md.settings.mass += 0.1
+        scene.frame_set(1)
+        scene.update()
+
+        self.assertEqual(self.cache_files(".bpack"), [])
+        # jumping to a frame with nothing cached leaves the cloth at rest
+        self.assertCoordsEqual(self.coords_at_frame(FRAMES), coords_rest)
+
+    def test_toggle_per_frame(self):
+        bpy.ops.ptcache.bake_all(bake=True)
+        coords_baked = self.coords_at_frame(FRAMES)
+
+        self.md.point_cache.use_disk_cache_packed = False
+
+        self.assertEqual(self.cache_files(".bpack"), [])
+        self.assertNotEqual(self.cache_files(".bphys"), [])
+        self.assertCoordsEqual(self.coords_at_frame(FRAMES), coords_baked)
+
+    def test_truncated_file(self):
+        bpy.ops.ptcache.bake_all(bake=True)
+        coords_baked = self.coords_at_frame(2)
+        filepath = bpy.data.filepath
+        name = self.ob.name
+        bpy.ops.wm.save_mainfile()
+
+        # an interrupted copy keeps the header but loses the frames at the end
+        filepath_cache = os.path.join(self.cache_directory, self.cache_files(".bpack")[0])
+        with open(filepath_cache, "r+b") as fh:
+            fh.truncate(os.path.getsize(filepath_cache) // 2)
+
+        bpy.ops.wm.open_mainfile(filepath=filepath)
+        self.ob = bpy.data.objects[name]
+        self.assertCoordsEqual(self.coords_at_frame(2), coords_baked)
+        # frames past the end of the file are missing, not read
+        self.coords_at_frame(FRAMES)
+
+
+if __name__ == '__main__':
+    import sys
+    sys.argv = [__file__] + (sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else [])
+    unittest.main()
@@ -0,0 +1,184 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Compare baking and reading back disk caches stored as a file per frame
+# and as a single packed file (PointCache.use_disk_cache_packed).
+#
+# For each test case the simulation is baked to disk with both layouts,
+# the bake time and the time to scrub through all cached frames
+# (forwards then backwards) is reported per frame, along with the size on disk.
+#
+# This is not run as part of the test suite (timings depend on the system),
+# run manually to compare changes, optionally passing the names of the cases to run:
+#
+# ./blender.bin --background --factory-startup --python tests/python/bl_pointcache_performance.py -- particles cloth
+
+import os
+import shutil
+import sys
+import tempfile
+import time
+
+import bpy
+
+# number of frames baked for each case
+FRAMES = 100
+
+COMPRESSION = 'LIGHT'
+
+
+# -----------------------------------------------------------------------------
+# utility functions
+
+def scene_clear(scene):
+    for ob in scene.objects[:]:
+        scene.objects.unlink(ob)
+        bpy.data.objects.remove(ob)
+
+
+def cache_dir_size(directory, ext):
+    size = 0
+    for filename in os.listdir(directory):
+        if filename.endswith(ext):
+            size += os.path.getsize(os.path.join(directory, filename))
+    return size
+
+
+def scrub_time(scene, frames):
+    time_start = time.time()
+    for frame in frames:
+        scene.frame_set(frame)
+    return time.time() - time_start
+
+
+# -----------------------------------------------------------------------------
+# test cases, each takes the scene and returns the point cache to bake
+
+def case_particles(scene):
+    bpy.ops.mesh.primitive_plane_add(radius=1.0)
+    ob = scene.objects.active
+    bpy.ops.object.particle_system_add()
+    psys = ob.particle_systems[0]
+    part = psys.settings
+    part.count = 100000
+    part.frame_start = 1
+    part.frame_end = FRAMES
+    part.lifetime = FRAMES
+    cache = psys.point_cache
+    cache.use_disk_cache = True
+    cache.compression = COMPRESSION
+    return cache
+
+
+def case_cloth(scene):
+    bpy.ops.mesh.primitive_grid_add(x_subdivisions=128, y_subdivisions=128, radius=1.0)
+    ob = scene.objects.active
+    md = ob.modifiers.new(name="Cloth", type='CLOTH')
+    cache = md.point_cache
+    cache.frame_end = FRAMES
+    cache.use_disk_cache = True
+    cache.compression = COMPRESSION
+    return cache
+
+
+def case_smoke(scene):
+    bpy.ops.mesh.primitive_cube_add(radius=2.0)
+    ob_domain = scene.objects.active
+    md = ob_domain.modifiers.new(name="Smoke", type='SMOKE')
+    md.smoke_type = 'DOMAIN'
+    domain = md.domain_settings
+    domain.resolution_max = 64
+    domain.cache_file_format = 'POINTCACHE'
+    domain.point_cache_compress_type = COMPRESSION
+
+    bpy.ops.mesh.primitive_uv_sphere_add(size=0.5, location=(0.0, 0.0, -1.0))
+    ob_flow = scene.objects.active
+    md = ob_flow.modifiers.new(name="Smoke", type='SMOKE')
+    md.smoke_type = 'FLOW'
+    md.flow_settings.smoke_flow_source = 'VOLUME'
+
+    cache = domain.point_cache
+    cache.frame_end = FRAMES
+    return cache
+
+
+CASES = (
+    ("particles", case_particles),
+    ("cloth", case_cloth),
+    ("smoke", case_smoke),
+)
+
+
+# -----------------------------------------------------------------------------
+# main
+
+def main():
+    argv = sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else []
+    scene = bpy.context.scene
+    scene.frame_start = 1
+    scene.frame_end = FRAMES
+
+    # disk cache needs a saved file
+    directory = tempfile.mkdtemp()
+    bpy.ops.wm.save_as_mainfile(filepath=os.path.join(directory, "pointcache_performance.blend"))
+    cache_directory = os.path.join(directory, "blendcache_pointcache_performance")
+
+    frames = list(range(1, FRAMES + 1))
+
+    print("\n========== point cache performance ==========")
+    print("%-12s %-10s %14s %14s %12s" % ("case", "layout", "bake ms/frame", "scrub ms/frame", "disk MB"))
+    for name, case_fn in CASES:
+        if argv and name not in argv:
+            continue
+        if name == "smoke" and not bpy.app.build_options.mod_smoke:
+            print("%-12s skipped, built without smoke" % name)
+            continue
+
+        for use_packed in (False, True):
+            scene_clear(scene)
+            scene.frame_set(1)
+            cache = case_fn(scene)
+            cache.use_disk_cache_packed = use_packed
+
+            time_start = time.time()
+            bpy.ops.ptcache.bake_all(bake=True)
+            time_bake = time.time() - time_start
+
+            time_scrub = scrub_time(scene, frames) + scrub_time(scene, reversed(frames))
+
+            disk_size = 0
+            if os.path.isdir(cache_directory):
+                disk_size = cache_dir_size(cache_directory, ".bpack" if use_packed else ".bphys")
+
+            print("%-12s %-10s %14.3f %14.3f %12.2f" % (
+                name, "packed" if use_packed else "per-frame",
+                time_bake * 1000.0 / FRAMES, time_scrub * 1000.0 / (FRAMES * 2),
+                disk_size / (1024.0 * 1024.0)))
+
+            bpy.ops.ptcache.free_bake_all()
+            if os.path.isdir(cache_directory):
+                shutil.rmtree(cache_directory)
+    print("==========\n")
+
+    shutil.rmtree(directory)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,134 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Time smoke simulation at increasing resolutions, for each pressure solver.
+#
+# Each test case is a cube domain with a smoke emitter at the bottom and a
+# sphere obstacle above it, simulated for a number of frames, optionally with
+# high resolution smoke. The smoke fills only part of the domain during these
+# frames, so empty space skipping in the advection is included in the timings.
+# Reported is the time per frame.
+#
+# This is not run as part of the test suite (timings depend on the system),
+# run manually to compare changes, optionally passing the names of the cases to run:
+#
+# ./blender.bin --background --factory-startup --python tests/python/bl_smoke_performance.py -- res_64 res_128
+
+import sys
+import time
+
+import bpy
+
+# number of frames simulated for each case
+FRAMES = 10
+
+SOLVERS = ('CG', 'MULTIGRID')
+
+
+# -----------------------------------------------------------------------------
+# utility functions
+
+def scene_clear(scene):
+    for ob in scene.objects[:]:
+        scene.objects.unlink(ob)
+        bpy.data.objects.remove(ob)
+
+
+def smoke_scene_add(scene, resolution, solver, amplify=0):
+    bpy.ops.mesh.primitive_cube_add(radius=0.2, location=(0.0, 0.0, -0.7))
+    md = scene.objects.active.modifiers.new(name="Smoke", type='SMOKE')
+    md.smoke_type = 'FLOW'
+    md.flow_settings.smoke_flow_type = 'BOTH'
+
+    bpy.ops.mesh.primitive_uv_sphere_add(size=0.25, location=(0.1, 0.0, 0.0))
+    md = scene.objects.active.modifiers.new(name="Smoke", type='SMOKE')
+    md.smoke_type = 'COLLISION'
+
+    bpy.ops.mesh.primitive_cube_add(radius=1.0)
+    md = scene.objects.active.modifiers.new(name="Smoke", type='SMOKE')
+    md.smoke_type = 'DOMAIN'
+    domain = md.domain_settings
+    domain.resolution_max = resolution
+    domain.pressure_solver = solver
+    if amplify:
+        domain.use_high_resolution = True
+        domain.amplify = amplify
+    domain.point_cache.frame_start = 1
+    domain.point_cache.frame_end = FRAMES + 1
+    return md
+
+
+# -----------------------------------------------------------------------------
+# test cases, each takes the scene and the solver and returns the smoke modifier
+
+def case_res_64(scene, solver):
+    return smoke_scene_add(scene, 64, solver)
+
+
+def case_res_128(scene, solver):
+    return smoke_scene_add(scene, 128, solver)
+
+
+def case_res_256(scene, solver):
+    return smoke_scene_add(scene, 256, solver)
+
+
+def case_high_res_64(scene, solver):
+    return smoke_scene_add(scene, 64, solver, amplify=3)
+
+
+CASES = (
+    ("res_64", case_res_64),
+    ("res_128", case_res_128),
+    ("res_256", case_res_256),
+    ("high_res_64", case_high_res_64),
+)
+
+
+# -----------------------------------------------------------------------------
+# main
+
+def main():
+    argv = sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else []
+    scene = bpy.context.scene
+
+    print("\n========== smoke performance ==========")
+    print("%-12s %-12s %12s" % ("case", "solver", "ms/frame"))
+    for name, case_fn in CASES:
+        if argv and name not in argv:
+            continue
+
+        for solver in SOLVERS:
+            scene_clear(scene)
+            scene.frame_set(1)
+            case_fn(scene, solver)
+
+            time_total = 0.0
+            for frame in range(2, FRAMES + 2):
+                time_start = time.time()
+                scene.frame_set(frame)
+                time_total += time.time() - time_start
+
+            print("%-12s %-12s %12.3f" % (name, solver, time_total * 1000.0 / FRAMES))
+    print("==========\n")
+
+
+if __name__ == "__main__":
+    main()